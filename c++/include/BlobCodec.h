@@ -0,0 +1,129 @@
+#ifndef BLOBCODEC_H_
+#define BLOBCODEC_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * Codecs to compress BLOB values such as spectra and flags.
+ *
+ * An encoded BLOB is self-describing. It starts with a header of
+ * HEADER_SIZE bytes which holds MAGIC, the id of the codec, the size of
+ * an element and the size of the raw value, followed by the payload
+ * produced by the codec. Values which the codec can't shrink are stored
+ * with the "raw" codec, so an encoded BLOB is never larger than
+ * HEADER_SIZE + the size of the raw value. Encoded values have no checksum.
+ *
+ * Elements of the raw value are byte-shuffled before compression,
+ * i.e. the first bytes of all elements come first, the second bytes next
+ * and so on, which makes floating point values much more compressible.
+ *
+ * Codecs available by default are:
+ * <dl>
+ * <dt>raw</dt><dd>no compression.</dd>
+ * <dt>rle</dt><dd>run length encoding, suitable for FLAG.</dd>
+ * <dt>deflate</dt><dd>zlib raw deflate at the fastest level applied to
+ * each byte plane of shuffled elements, suitable for spectra. Planes which
+ * don't shrink, such as the lower bytes of the mantissa of noisy values,
+ * are stored as is.</dd>
+ * </dl>
+ * Other codecs can be added by registerCodec().
+ *
+ * The functions in this namespace don't use SQLite, so they can be
+ * linked into SQLite extensions as well as applications.
+ */
+namespace blobcodec {
+
+size_t const HEADER_SIZE = 16;
+extern unsigned char const MAGIC[4];
+
+enum CodecId {
+  CODEC_RAW = 0,
+  CODEC_RLE = 1,
+  CODEC_DEFLATE = 2,
+  CODEC_USER = 128 // ids of user defined codecs should start from this.
+};
+
+class Codec {
+ public:
+  virtual ~Codec();
+  /**
+   * Returns a name which contains neither spaces nor ':'.
+   */
+  virtual char const *getName() const = 0;
+  virtual uint8_t getId() const = 0;
+  /**
+   * Compresses rawSize bytes of shuffled elements of elementSize bytes
+   * at src into dst.
+   * @return the size of the payload, or 0 if it failed or the payload
+   * doesn't fit in dstSize bytes.
+   */
+  virtual size_t encodePayload(void const *src, size_t rawSize,
+			       size_t elementSize,
+			       void *dst, size_t dstSize) const = 0;
+  /**
+   * Decompresses payloadSize bytes at src into rawSize bytes of
+   * shuffled elements of elementSize bytes at dst.
+   * @return false if the payload is broken.
+   */
+  virtual bool decodePayload(void const *src, size_t payloadSize,
+			     size_t elementSize,
+			     void *dst, size_t rawSize) const = 0;
+};
+
+/**
+ * @return NULL if not found.
+ */
+Codec const *findCodec(char const name[]);
+/**
+ * @return NULL if not found.
+ */
+Codec const *findCodec(unsigned id);
+/**
+ * Adds a codec. The codec must be valid while the process runs.
+ * @return false if a codec of the same id or name has been registered.
+ */
+bool registerCodec(Codec const *codec);
+
+/**
+ * Parses "name" or "name:elementSize" such as "deflate:4".
+ * The element size defaults to 1.
+ * @return false if spec is invalid.
+ */
+bool parseCodecSpec(char const spec[], size_t specLen,
+		    Codec const **codec, size_t *elementSize);
+
+/**
+ * Returns the size of the buffer which encode() requires for rawSize bytes.
+ */
+size_t getMaxEncodedSize(size_t rawSize);
+/**
+ * Encodes rawSize bytes at src as elements of elementSize bytes into dst
+ * which has getMaxEncodedSize(rawSize) bytes at least.
+ * @return the size of the encoded value.
+ */
+size_t encode(Codec const *codec, void const *src, size_t rawSize,
+	      size_t elementSize, void *dst);
+/**
+ * Returns true if data has a valid header of an encoded value.
+ */
+bool isEncoded(void const *data, size_t size);
+/**
+ * Returns the codec which encoded data, or NULL if data isn't encoded or
+ * the codec is unknown.
+ */
+Codec const *getCodec(void const *data, size_t size);
+/**
+ * Returns the size of the raw value of encoded data.
+ * @return false if data isn't encoded.
+ */
+bool getDecodedSize(void const *data, size_t size, size_t *rawSize);
+/**
+ * Decodes data into dst which has getDecodedSize() bytes at least.
+ * @return false if data isn't encoded, the codec is unknown or data is broken.
+ */
+bool decode(void const *data, size_t size, void *dst);
+
+}
+
+#endif /* BLOBCODEC_H_ */
@@ -0,0 +1,117 @@
+#ifndef MMAPCOLUMNSTORE_H_
+#define MMAPCOLUMNSTORE_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <sqlite3.h>
+
+/**
+ * Direct read access to tables of MMapVTable SQLite module.
+ *
+ * Values of a range of rows of an INTEGER or REAL column are read in bulk
+ * from the column file without going through SQLite row by row.
+ * It is implemented in libSQLiteMMapVTable.so and doesn't need SQLite
+ * connection.
+ *
+ * Lifetime of following objects should be:
+ *
+ * ColumnSpan within TableReader.
+ */
+namespace mmapvtable {
+
+/**
+ * This exception will be raised when there is an error while using this API.
+ */
+class ColumnStoreException {
+  char const *msg;
+ public:
+  ColumnStoreException(char const *staticString);
+  char const *getMessage() const;
+};
+
+/**
+ * This class represents values of contiguous rows of a column
+ * mapped into memory.
+ */
+class ColumnSpan {
+ public:
+  virtual ~ColumnSpan() throw (ColumnStoreException);
+  /**
+   * Returns the address of the value of the first row.
+   * The area is valid until this instance is deleted.
+   * You must not modify or release it.
+   * @return int64_t const * for INTEGER column, double const * for REAL
+   * column, or NULL if the span has no rows.
+   */
+  virtual void const *getData() const = 0;
+  /**
+   * Returns the number of rows in this span.
+   */
+  virtual size_t getNumberOfRows() const = 0;
+};
+
+/**
+ * This class represents a table created by MMapVTable module.
+ *
+ * Columns are identified by a position in CREATE VIRTUAL TABLE starting
+ * with 0, and rows by rowid starting with 1.
+ */
+class TableReader {
+ public:
+  /**
+   * This is a factory method for this class.
+   * @param path a path given to MMapVTable() when the table was created.
+   * @param tableName a name of the table.
+   * @return an instance which should be deleted by the caller.
+   */
+  static TableReader *open(char const path[], char const tableName[])
+    throw (ColumnStoreException);
+  virtual ~TableReader() throw (ColumnStoreException);
+
+  /**
+   * Returns the number of rows which have been saved by MMapVTable module.
+   */
+  virtual int64_t getNumberOfRows() const throw (ColumnStoreException) = 0;
+  virtual int getColumnCount() const throw (ColumnStoreException) = 0;
+  virtual char const *getColumnName(int col) const
+    throw (ColumnStoreException) = 0;
+  /**
+   * @return the position of the column, or -1 if not found.
+   */
+  virtual int findColumn(char const name[]) const
+    throw (ColumnStoreException) = 0;
+  /**
+   * @return SQLITE_INTEGER, SQLITE_FLOAT, SQLITE_TEXT or SQLITE_BLOB.
+   */
+  virtual int getColumnType(int col) const throw (ColumnStoreException) = 0;
+
+  /**
+   * Maps values of rows [firstRow, firstRow + nRows) of an INTEGER or REAL
+   * column other than INTEGER PRIMARY KEY without copying.
+   *
+   * The column file is mapped from a page boundary, so the returned data is
+   * aligned as much as (firstRow - 1) * 8 bytes is, e.g. to 32 bytes
+   * if firstRow - 1 is a multiple of 4. Use fetchRows() to get values of
+   * other ranges into an aligned array.
+   * @return an instance which should be deleted by the caller before
+   * this instance.
+   */
+  virtual ColumnSpan *mapRows(int col, int64_t firstRow, size_t nRows)
+    throw (ColumnStoreException) = 0;
+  /**
+   * Copies values of rows [firstRow, firstRow + nRows) of an INTEGER
+   * column, or rowids if the column is INTEGER PRIMARY KEY, to dst.
+   */
+  virtual void fetchRows(int col, int64_t firstRow, size_t nRows,
+			 int64_t dst[]) throw (ColumnStoreException) = 0;
+  /**
+   * Copies values of rows [firstRow, firstRow + nRows) of a REAL column
+   * to dst.
+   */
+  virtual void fetchRows(int col, int64_t firstRow, size_t nRows,
+			 double dst[]) throw (ColumnStoreException) = 0;
+};
+
+}
+
+#endif /* MMAPCOLUMNSTORE_H_ */
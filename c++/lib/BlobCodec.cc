@@ -0,0 +1,549 @@
+#include <cassert>
+#include <cstring>
+#include <cstdlib>
+#include <cmath>
+#include <string>
+#include <algorithm>
+#include <vector>
+#include <zlib.h>
+
+#include "BlobCodec.h"
+
+using namespace std;
+
+namespace {
+
+  using blobcodec::Codec;
+
+  size_t const MAX_CODECS = 256;
+  size_t const MAX_ELEMENT_SIZE = 255;
+
+#define elementsof(x) (sizeof(x) / sizeof(*(x)))
+
+  class RawCodec: public Codec {
+  public:
+    virtual char const *getName() const {
+      return "raw";
+    }
+    virtual uint8_t getId() const {
+      return blobcodec::CODEC_RAW;
+    }
+    virtual size_t encodePayload(void const *src, size_t rawSize,
+				 size_t elementSize,
+				 void *dst, size_t dstSize) const {
+      if (rawSize > dstSize) {
+	return 0;
+      }
+      memcpy(dst, src, rawSize);
+      return rawSize;
+    }
+    virtual bool decodePayload(void const *src, size_t payloadSize,
+			       size_t elementSize,
+			       void *dst, size_t rawSize) const {
+      if (payloadSize != rawSize) {
+	return false;
+      }
+      memcpy(dst, src, rawSize);
+      return true;
+    }
+  };
+
+  /*
+   * PackBits like run length encoding.
+   * A control byte c < 128 is followed by c + 1 literal bytes,
+   * and c >= 128 by a byte repeated c - 126 times.
+   */
+  class RLECodec: public Codec {
+    enum {
+      MAX_LITERAL = 128,
+      MIN_RUN = 2,
+      MAX_RUN = 129
+    };
+  public:
+    virtual char const *getName() const {
+      return "rle";
+    }
+    virtual uint8_t getId() const {
+      return blobcodec::CODEC_RLE;
+    }
+    virtual size_t encodePayload(void const *src, size_t rawSize,
+				 size_t elementSize,
+				 void *dst, size_t dstSize) const {
+      unsigned char const *s = static_cast<unsigned char const *>(src);
+      unsigned char *d = static_cast<unsigned char *>(dst);
+      size_t out = 0;
+      size_t i = 0;
+      while (i < rawSize) {
+	size_t run = 1;
+	while (i + run < rawSize && run < MAX_RUN && s[i + run] == s[i]) {
+	  run++;
+	}
+	if (run >= MIN_RUN) {
+	  if (out + 2 > dstSize) {
+	    return 0;
+	  }
+	  d[out++] = static_cast<unsigned char>(run + 126);
+	  d[out++] = s[i];
+	  i += run;
+	} else {
+	  size_t start = i;
+	  while (i < rawSize && i - start < MAX_LITERAL
+		 && !(i + 1 < rawSize && s[i] == s[i + 1])) {
+	    i++;
+	  }
+	  size_t len = i - start;
+	  assert(len > 0);
+	  if (out + 1 + len > dstSize) {
+	    return 0;
+	  }
+	  d[out++] = static_cast<unsigned char>(len - 1);
+	  memcpy(&d[out], &s[start], len);
+	  out += len;
+	}
+      }
+      return out;
+    }
+    virtual bool decodePayload(void const *src, size_t payloadSize,
+			       size_t elementSize,
+			       void *dst, size_t rawSize) const {
+      unsigned char const *s = static_cast<unsigned char const *>(src);
+      unsigned char *d = static_cast<unsigned char *>(dst);
+      size_t in = 0;
+      size_t out = 0;
+      while (in < payloadSize) {
+	unsigned c = s[in++];
+	if (c < MAX_LITERAL) {
+	  size_t len = c + 1;
+	  if (in + len > payloadSize || out + len > rawSize) {
+	    return false;
+	  }
+	  memcpy(&d[out], &s[in], len);
+	  in += len;
+	  out += len;
+	} else {
+	  size_t len = c - 126;
+	  if (in >= payloadSize || out + len > rawSize) {
+	    return false;
+	  }
+	  memset(&d[out], s[in++], len);
+	  out += len;
+	}
+      }
+      return out == rawSize;
+    }
+  };
+
+  /*
+   * Each byte plane, i.e. elementSize planes of rawSize / elementSize bytes
+   * and the rest, is preceded by the size of it in 4 bytes little endian.
+   * A plane is a raw deflate stream without zlib header nor checksum, or
+   * stored as is if the size equals to the size of the plane.
+   */
+  class DeflateCodec: public Codec {
+    enum {
+      MIN_WINDOW_BITS = 9,
+      MAX_WINDOW_BITS = 15,
+      MIN_MEM_LEVEL = 1,
+      PLANE_HEADER_SIZE = 4
+    };
+    // Small values don't need the whole window, which is expensive to set up.
+    static int getWindowBits(size_t rawSize) {
+      int bits = MIN_WINDOW_BITS;
+      while (bits < MAX_WINDOW_BITS
+	     && (static_cast<size_t>(1) << bits) < rawSize) {
+	bits++;
+      }
+      return bits;
+    }
+    static size_t getPlaneSize(size_t rawSize, size_t elementSize,
+			       size_t plane) {
+      size_t const n = rawSize / elementSize;
+      return plane < elementSize ? n : rawSize - n * elementSize;
+    }
+    /*
+     * Returns true if bytes look random enough for deflate not to shrink,
+     * which saves the time to try.
+     */
+    static bool isIncompressible(unsigned char const *src, size_t size) {
+      size_t count[256];
+      memset(count, 0, sizeof(count));
+      for (size_t i = 0; i < size; i++) {
+	count[src[i]]++;
+      }
+      double entropy = 0.; // bits per byte
+      for (size_t i = 0; i < elementsof(count); i++) {
+	if (count[i] > 0) {
+	  double p = static_cast<double>(count[i]) / size;
+	  entropy -= p * log2(p);
+	}
+      }
+      return entropy > 7.5 - 256. / size; // entropy of a short sequence is lower.
+    }
+    /*
+     * Returns the size of the compressed plane, or 0 if it doesn't shrink.
+     */
+    static size_t deflatePlane(z_stream *stream,
+			       unsigned char const *src, size_t size,
+			       unsigned char *dst, size_t dstSize) {
+      if (isIncompressible(src, size) || deflateReset(stream) != Z_OK) {
+	return 0;
+      }
+      stream->next_in = const_cast<Bytef *>(src);
+      stream->avail_in = size;
+      stream->next_out = dst;
+      stream->avail_out = min(dstSize, size - 1);
+      // Z_OK or Z_BUF_ERROR if it doesn't fit.
+      if (deflate(stream, Z_FINISH) != Z_STREAM_END) {
+	return 0;
+      }
+      return stream->total_out;
+    }
+    static void putSize(size_t size, unsigned char *dst) {
+      for (int i = 0; i < PLANE_HEADER_SIZE; i++) {
+	dst[i] = static_cast<unsigned char>(size >> (8 * i));
+      }
+    }
+    static size_t getSize(unsigned char const *src) {
+      size_t size = 0;
+      for (int i = 0; i < PLANE_HEADER_SIZE; i++) {
+	size |= static_cast<size_t>(src[i]) << (8 * i);
+      }
+      return size;
+    }
+  public:
+    virtual char const *getName() const {
+      return "deflate";
+    }
+    virtual uint8_t getId() const {
+      return blobcodec::CODEC_DEFLATE;
+    }
+    virtual size_t encodePayload(void const *src, size_t rawSize,
+				 size_t elementSize,
+				 void *dst, size_t dstSize) const {
+      if (rawSize > 0xffffffffUL) {
+	return 0;
+      }
+      z_stream stream;
+      memset(&stream, 0, sizeof(stream));
+      // Make the hash table, which is cleared for each plane, as large as
+      // the window.
+      int const windowBits = getWindowBits(rawSize / elementSize);
+      int const memLevel = max(windowBits - 7, static_cast<int>(MIN_MEM_LEVEL));
+      if (deflateInit2(&stream, Z_BEST_SPEED, Z_DEFLATED,
+		       -windowBits, memLevel, Z_DEFAULT_STRATEGY) != Z_OK) {
+	return 0;
+      }
+      unsigned char const *s = static_cast<unsigned char const *>(src);
+      unsigned char *d = static_cast<unsigned char *>(dst);
+      size_t out = 0;
+      for (size_t plane = 0; plane <= elementSize; plane++) {
+	size_t const size = getPlaneSize(rawSize, elementSize, plane);
+	if (size == 0) {
+	  continue;
+	}
+	if (out + PLANE_HEADER_SIZE > dstSize) {
+	  out = 0;
+	  break;
+	}
+	unsigned char *planeData = &d[out + PLANE_HEADER_SIZE];
+	size_t const avail = dstSize - out - PLANE_HEADER_SIZE;
+	size_t planeSize = size > 1
+	  ? deflatePlane(&stream, s, size, planeData, avail) : 0;
+	if (planeSize == 0) { // stored
+	  if (size > avail) {
+	    out = 0;
+	    break;
+	  }
+	  memcpy(planeData, s, size);
+	  planeSize = size;
+	}
+	putSize(planeSize, &d[out]);
+	out += PLANE_HEADER_SIZE + planeSize;
+	s += size;
+      }
+      deflateEnd(&stream);
+      return out;
+    }
+    virtual bool decodePayload(void const *src, size_t payloadSize,
+			       size_t elementSize,
+			       void *dst, size_t rawSize) const {
+      z_stream stream;
+      memset(&stream, 0, sizeof(stream));
+      if (inflateInit2(&stream, -MAX_WINDOW_BITS) != Z_OK) {
+	return false;
+      }
+      unsigned char const *s = static_cast<unsigned char const *>(src);
+      unsigned char *d = static_cast<unsigned char *>(dst);
+      size_t in = 0;
+      bool ok = true;
+      for (size_t plane = 0; ok && plane <= elementSize; plane++) {
+	size_t const size = getPlaneSize(rawSize, elementSize, plane);
+	if (size == 0) {
+	  continue;
+	}
+	if (in + PLANE_HEADER_SIZE > payloadSize) {
+	  ok = false;
+	  break;
+	}
+	size_t const planeSize = getSize(&s[in]);
+	in += PLANE_HEADER_SIZE;
+	if (planeSize > payloadSize - in) {
+	  ok = false;
+	  break;
+	}
+	if (planeSize == size) { // stored
+	  memcpy(d, &s[in], size);
+	} else {
+	  stream.next_in = const_cast<Bytef *>(&s[in]);
+	  stream.avail_in = planeSize;
+	  stream.next_out = d;
+	  stream.avail_out = size;
+	  // The window isn't allocated when the output fits in one call.
+	  ok = inflateReset(&stream) == Z_OK
+	    && inflate(&stream, Z_FINISH) == Z_STREAM_END
+	    && stream.total_out == size;
+	}
+	in += planeSize;
+	d += size;
+      }
+      inflateEnd(&stream);
+      return ok && in == payloadSize;
+    }
+  };
+
+  struct Registry {
+    Codec const *byId[MAX_CODECS];
+    Registry() {
+      static RawCodec raw;
+      static RLECodec rle;
+      static DeflateCodec deflate;
+      memset(byId, 0, sizeof(byId));
+      byId[raw.getId()] = &raw;
+      byId[rle.getId()] = &rle;
+      byId[deflate.getId()] = &deflate;
+    }
+  };
+
+  Registry &getRegistry() {
+    static Registry registry;
+    return registry;
+  }
+
+  struct Header {
+    uint8_t codecId;
+    size_t elementSize;
+    uint64_t rawSize;
+  };
+
+  void writeHeader(Header const &header, unsigned char *dst) {
+    memcpy(dst, blobcodec::MAGIC, sizeof(blobcodec::MAGIC));
+    dst[4] = header.codecId;
+    dst[5] = static_cast<unsigned char>(header.elementSize);
+    dst[6] = 0;
+    dst[7] = 0;
+    for (int i = 0; i < 8; i++) { // little endian
+      dst[8 + i] = static_cast<unsigned char>(header.rawSize >> (8 * i));
+    }
+  }
+
+  bool readHeader(void const *data, size_t size, Header *header) {
+    unsigned char const *p = static_cast<unsigned char const *>(data);
+    if (size < blobcodec::HEADER_SIZE
+	|| memcmp(p, blobcodec::MAGIC, sizeof(blobcodec::MAGIC)) != 0
+	|| p[5] == 0 || p[6] != 0 || p[7] != 0) {
+      return false;
+    }
+    header->codecId = p[4];
+    header->elementSize = p[5];
+    header->rawSize = 0;
+    for (int i = 0; i < 8; i++) {
+      header->rawSize |= static_cast<uint64_t>(p[8 + i]) << (8 * i);
+    }
+    if (header->codecId == blobcodec::CODEC_RAW
+	&& header->rawSize != size - blobcodec::HEADER_SIZE) {
+      return false;
+    }
+    return header->rawSize == static_cast<size_t>(header->rawSize);
+  }
+
+  void shuffle(unsigned char const *src, size_t size, size_t elementSize,
+	       unsigned char *dst) {
+    size_t const n = size / elementSize;
+    for (size_t b = 0; b < elementSize; b++) {
+      unsigned char *d = &dst[b * n];
+      unsigned char const *s = &src[b];
+      for (size_t i = 0; i < n; i++) {
+	d[i] = s[i * elementSize];
+      }
+    }
+    size_t const tail = n * elementSize;
+    memcpy(&dst[tail], &src[tail], size - tail);
+  }
+
+  void unshuffle(unsigned char const *src, size_t size, size_t elementSize,
+		 unsigned char *dst) {
+    size_t const n = size / elementSize;
+    for (size_t b = 0; b < elementSize; b++) {
+      unsigned char const *s = &src[b * n];
+      unsigned char *d = &dst[b];
+      for (size_t i = 0; i < n; i++) {
+	d[i * elementSize] = s[i];
+      }
+    }
+    size_t const tail = n * elementSize;
+    memcpy(&dst[tail], &src[tail], size - tail);
+  }
+
+}
+
+namespace blobcodec {
+
+  unsigned char const MAGIC[4] = { 0x89, 'S', 'K', 'Z' };
+
+  Codec::~Codec() {
+  }
+
+  Codec const *findCodec(char const name[]) {
+    assert(name != NULL);
+    Registry &registry = getRegistry();
+    for (size_t i = 0; i < MAX_CODECS; i++) {
+      if (registry.byId[i] != NULL
+	  && strcmp(registry.byId[i]->getName(), name) == 0) {
+	return registry.byId[i];
+      }
+    }
+    return NULL;
+  }
+
+  Codec const *findCodec(unsigned id) {
+    if (id >= MAX_CODECS) {
+      return NULL;
+    }
+    return getRegistry().byId[id];
+  }
+
+  bool registerCodec(Codec const *codec) {
+    assert(codec != NULL);
+    Registry &registry = getRegistry();
+    if (registry.byId[codec->getId()] != NULL
+	|| findCodec(codec->getName()) != NULL) {
+      return false;
+    }
+    registry.byId[codec->getId()] = codec;
+    return true;
+  }
+
+  bool parseCodecSpec(char const spec[], size_t specLen,
+		      Codec const **codec, size_t *elementSize) {
+    assert(spec != NULL);
+    assert(codec != NULL);
+    assert(elementSize != NULL);
+    string str(spec, specLen);
+    string::size_type colon = str.find(':');
+    size_t size = 1;
+    if (colon != string::npos) {
+      string sizeStr = str.substr(colon + 1);
+      char *end = NULL;
+      unsigned long value = strtoul(sizeStr.c_str(), &end, 10);
+      if (sizeStr.empty() || *end != '\0'
+	  || value == 0 || value > MAX_ELEMENT_SIZE) {
+	return false;
+      }
+      size = value;
+      str.erase(colon);
+    }
+    Codec const *found = findCodec(str.c_str());
+    if (found == NULL) {
+      return false;
+    }
+    *codec = found;
+    *elementSize = size;
+    return true;
+  }
+
+  size_t getMaxEncodedSize(size_t rawSize) {
+    return HEADER_SIZE + rawSize;
+  }
+
+  size_t encode(Codec const *codec, void const *src, size_t rawSize,
+		size_t elementSize, void *dst) {
+    assert(codec != NULL);
+    assert(0 < elementSize && elementSize <= MAX_ELEMENT_SIZE);
+    unsigned char *d = static_cast<unsigned char *>(dst);
+    Header header = { codec->getId(), elementSize, rawSize };
+    size_t payloadSize = 0;
+    if (codec->getId() != CODEC_RAW) {
+      void const *shuffled = src;
+      vector<unsigned char> buf;
+      if (elementSize > 1 && rawSize > 0) {
+	buf.resize(rawSize);
+	shuffle(static_cast<unsigned char const *>(src), rawSize, elementSize,
+		&buf[0]);
+	shuffled = &buf[0];
+      }
+      // Compression which doesn't shrink the value is useless.
+      payloadSize = codec->encodePayload(shuffled, rawSize, elementSize,
+					 &d[HEADER_SIZE], rawSize);
+    }
+    if (payloadSize == 0 && rawSize > 0) {
+      header.codecId = CODEC_RAW;
+      memcpy(&d[HEADER_SIZE], src, rawSize);
+      payloadSize = rawSize;
+    } else if (rawSize == 0) {
+      header.codecId = CODEC_RAW;
+    }
+    writeHeader(header, d);
+    return HEADER_SIZE + payloadSize;
+  }
+
+  bool isEncoded(void const *data, size_t size) {
+    Header header;
+    return readHeader(data, size, &header);
+  }
+
+  Codec const *getCodec(void const *data, size_t size) {
+    Header header;
+    if (! readHeader(data, size, &header)) {
+      return NULL;
+    }
+    return findCodec(header.codecId);
+  }
+
+  bool getDecodedSize(void const *data, size_t size, size_t *rawSize) {
+    assert(rawSize != NULL);
+    Header header;
+    if (! readHeader(data, size, &header)) {
+      return false;
+    }
+    *rawSize = header.rawSize;
+    return true;
+  }
+
+  bool decode(void const *data, size_t size, void *dst) {
+    Header header;
+    if (! readHeader(data, size, &header)) {
+      return false;
+    }
+    Codec const *codec = findCodec(header.codecId);
+    if (codec == NULL) {
+      return false;
+    }
+    unsigned char const *payload =
+      static_cast<unsigned char const *>(data) + HEADER_SIZE;
+    size_t const payloadSize = size - HEADER_SIZE;
+    if (header.codecId == CODEC_RAW || header.elementSize == 1
+	|| header.rawSize == 0) {
+      return codec->decodePayload(payload, payloadSize, header.elementSize,
+				  dst, header.rawSize);
+    }
+    vector<unsigned char> buf(header.rawSize);
+    if (! codec->decodePayload(payload, payloadSize, header.elementSize,
+			       &buf[0], header.rawSize)) {
+      return false;
+    }
+    unshuffle(&buf[0], header.rawSize, header.elementSize,
+	      static_cast<unsigned char *>(dst));
+    return true;
+  }
+
+}
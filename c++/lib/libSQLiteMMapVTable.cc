@@ -6,6 +6,7 @@
 #include <cerrno>
 #include <cassert>
 #include <cstdarg>
+#include <cmath>
 #include <unistd.h>
 #include <iostream>
 #include <memory>
@@ -19,6 +20,8 @@
 #include <sys/mman.h>
 #include <pthread.h>
 #include <sqlite3ext.h>
+#include "MMapColumnStore.h"
+#include "BlobCodec.h"
 
 SQLITE_EXTENSION_INIT1
 
@@ -921,6 +924,533 @@ namespace a {
 
   typedef Destructor<MMap *, 128> Destructor_t;
 
+  /**
+   * A number to be compared with values of an INTEGER or REAL column.
+   */
+  struct NumericKey {
+    bool isReal;
+    double real;
+    sqlite_int64 integer;
+
+    /**
+     * Returns false if value is not a number.
+     */
+    static bool fromValue(sqlite3_value *value, NumericKey *key) {
+      switch (sqlite3_value_type(value)) {
+      case SQLITE_INTEGER:
+	key->isReal = false;
+	key->integer = sqlite3_value_int64(value);
+	key->real = 0.;
+	return true;
+      case SQLITE_FLOAT:
+	key->isReal = true;
+	key->integer = 0;
+	key->real = sqlite3_value_double(value);
+	return true;
+      }
+      return false;
+    }
+  };
+
+  template <typename T>
+  bool lessThan(T value, NumericKey const &key) {
+    return key.isReal ? value < key.real : value < key.integer;
+  }
+
+  template <typename T>
+  bool lessThan(NumericKey const &key, T value) {
+    return key.isReal ? key.real < value : key.integer < value;
+  }
+
+  /**
+   * A constraint on an indexed column passed to xFilter.
+   */
+  struct IndexBound {
+    int op; // SQLITE_INDEX_CONSTRAINT_*
+    sqlite3_value *value;
+  };
+
+  /**
+   * Sorted secondary index of a numeric column.
+   *
+   * It is stored in a file of its own as (value, rowId) pairs sorted by
+   * value and then by rowId, and is brought up to date lazily when a query
+   * uses it, because rows are only appended.
+   */
+  class ColumnIndex: public virtual Openable, public virtual Closable {
+  public:
+    struct Statistics {
+      sqlite_int64 nRows; // rows covered by the index
+      sqlite_int64 nDistinct; // number of distinct values
+      sqlite_int64 nOrdered; // adjacent entries of which rowIds ascend
+    };
+    virtual ~ColumnIndex() THROWS((RTException)) {}
+
+    /**
+     * Adds rows up to nRows to the index.
+     * MT unsafe, caller should protect.
+     */
+    virtual void refresh(sqlite_int64 nRows) THROWS((RTException)) = 0;
+    /**
+     * Returns positions [*begin, *end) of the entries which may satisfy
+     * all of bounds. Bounds with non-numeric values don't narrow the range.
+     */
+    virtual void findRange(IndexBound const bounds[], size_t nBounds,
+			   sqlite_int64 *begin, sqlite_int64 *end)
+      const THROWS((RTException)) = 0;
+    virtual sqlite_int64 getRowId(sqlite_int64 pos) const = 0;
+    virtual Statistics getStatistics() const = 0;
+  };
+
+  template <typename T>
+  class SortedColumnIndex: public ColumnIndex {
+    struct Entry {
+      T value;
+      sqlite_int64 rowId;
+      bool operator <(Entry const &other) const {
+	return value < other.value
+	  || (value == other.value && rowId < other.rowId);
+      }
+    };
+    struct IndexHeader {
+      uint64_t magic;
+      Statistics stats;
+      char padding[256 - sizeof(uint64_t) - sizeof(Statistics)];
+      Entry entries[1];
+    };
+    struct KeyLess {
+      bool operator ()(Entry const &entry, NumericKey const &key) const {
+	return lessThan(entry.value, key);
+      }
+      bool operator ()(NumericKey const &key, Entry const &entry) const {
+	return lessThan(key, entry.value);
+      }
+    };
+    enum {
+      MAGIC = 0x5844494d4d53, // "SMMIDX"
+      ROWS_PER_READ = 1 << 20
+    };
+
+    File *dataFile_; // not owned
+    unique_ptr<File> file_;
+    unique_ptr<MMap> map_;
+    IndexHeader *header_;
+
+    IndexHeader *mapHeader(sqlite_int64 nEntries) THROWS((RTException)) {
+      off_t offset = 0;
+      size_t size = 0;
+      MMap::alignRegion(&offset, &size, 0,
+			offsetof(IndexHeader, entries) + nEntries * sizeof(Entry));
+      header_ = NULL;
+      map_->unmap();
+      map_->setMapRegion(offset, size);
+      header_ = map_->map<IndexHeader>();
+      return header_;
+    }
+
+    /**
+     * Copies values of rows (first, first + n] of the column to entries.
+     */
+    void readEntries(sqlite_int64 first, sqlite_int64 n, Entry entries[])
+      THROWS((RTException)) {
+      for (sqlite_int64 done = 0; done < n; ) {
+	size_t len = MIN(static_cast<sqlite_int64>(ROWS_PER_READ), n - done);
+	off_t offset = (first + done) * sizeof(T);
+	Referer<MMap> map(dataFile_->makeMapForRegion(offset, len * sizeof(T)));
+	LockHolder protect;
+	map->takeLock(protect);
+	T const *values = map->remapForRegion<T const>(offset, len * sizeof(T));
+	for (size_t i = 0; i < len; i++) {
+	  entries[done + i].value = values[i];
+	  entries[done + i].rowId = first + done + i + 1;
+	}
+	done += len;
+      }
+    }
+
+  public:
+    /**
+     * indexFile is owned by this instance.
+     */
+    SortedColumnIndex(File *dataFile, File *indexFile)
+      : dataFile_(dataFile), file_(indexFile), map_(), header_(NULL) {
+      assert(dataFile_ != NULL);
+      assert(file_.get() != NULL);
+    }
+    virtual ~SortedColumnIndex() THROWS((RTException)) {
+      enterP(this);
+    }
+
+    virtual void open() THROWS((RTException)) {
+      enter();
+      if (header_ != NULL) {
+	return;
+      }
+      file_->open();
+      if (map_.get() == NULL) {
+	map_.reset(new MMap(file_.get()));
+      }
+      IndexHeader *header = mapHeader(0);
+      if (header->magic != MAGIC) {
+	header->stats.nRows = 0;
+	header->stats.nDistinct = 0;
+	header->stats.nOrdered = 0;
+	header->magic = MAGIC;
+      }
+      mapHeader(header->stats.nRows);
+    }
+    virtual void close() THROWS((RTException)) {
+      enter();
+      header_ = NULL;
+      if (map_.get() != NULL) {
+	map_->close();
+      }
+      file_->close();
+    }
+
+    virtual void refresh(sqlite_int64 nRows) THROWS((RTException)) {
+      enter();
+      assert(header_ != NULL);
+      if (header_->stats.nRows == nRows) {
+	return;
+      }
+      sqlite_int64 nOld = header_->stats.nRows;
+      if (nOld > nRows) { // rows were removed, rebuild
+	nOld = 0;
+      }
+      // an interrupted refresh leaves the index empty rather than broken.
+      header_->stats.nRows = 0;
+      IndexHeader *header = mapHeader(nRows);
+      Entry *entries = header->entries;
+      readEntries(nOld, nRows - nOld, entries + nOld);
+      sort(entries + nOld, entries + nRows);
+      inplace_merge(entries, entries + nOld, entries + nRows);
+
+      sqlite_int64 nDistinct = nRows > 0 ? 1 : 0;
+      sqlite_int64 nOrdered = 0;
+      for (sqlite_int64 i = 1; i < nRows; i++) {
+	if (entries[i - 1].value != entries[i].value) {
+	  nDistinct++;
+	}
+	if (entries[i - 1].rowId < entries[i].rowId) {
+	  nOrdered++;
+	}
+      }
+      header->stats.nDistinct = nDistinct;
+      header->stats.nOrdered = nOrdered;
+      header->stats.nRows = nRows;
+      LOG cout << "index refreshed: " << nRows << " rows, "
+	       << nDistinct << " distinct\n";
+    }
+
+    virtual void findRange(IndexBound const bounds[], size_t nBounds,
+			   sqlite_int64 *begin, sqlite_int64 *end)
+      const THROWS((RTException)) {
+      assert(header_ != NULL);
+      Entry const *entries = header_->entries;
+      sqlite_int64 const nRows = header_->stats.nRows;
+      sqlite_int64 lower = 0;
+      sqlite_int64 upper = nRows;
+      for (size_t i = 0; i < nBounds && lower < upper; i++) {
+	if (sqlite3_value_type(bounds[i].value) == SQLITE_NULL) {
+	  upper = lower; // no value satisfies a comparison with NULL.
+	  continue;
+	}
+	NumericKey key;
+	if (! NumericKey::fromValue(bounds[i].value, &key)) {
+	  continue; // left to SQLite
+	}
+	sqlite_int64 first =
+	  lower_bound(entries, entries + nRows, key, KeyLess()) - entries;
+	sqlite_int64 last =
+	  upper_bound(entries, entries + nRows, key, KeyLess()) - entries;
+	switch (bounds[i].op) {
+	case SQLITE_INDEX_CONSTRAINT_EQ:
+	  lower = MAX(lower, first);
+	  upper = MIN(upper, last);
+	  break;
+	case SQLITE_INDEX_CONSTRAINT_GT:
+	  lower = MAX(lower, last);
+	  break;
+	case SQLITE_INDEX_CONSTRAINT_GE:
+	  lower = MAX(lower, first);
+	  break;
+	case SQLITE_INDEX_CONSTRAINT_LT:
+	  upper = MIN(upper, first);
+	  break;
+	case SQLITE_INDEX_CONSTRAINT_LE:
+	  upper = MIN(upper, last);
+	  break;
+	default:
+	  assert(false);
+	  throw ASSERTION_ERROR;
+	}
+      }
+      *begin = lower;
+      *end = MAX(lower, upper);
+    }
+
+    virtual sqlite_int64 getRowId(sqlite_int64 pos) const {
+      assert(header_ != NULL);
+      assert(0 <= pos && pos < header_->stats.nRows);
+      return header_->entries[pos].rowId;
+    }
+
+    virtual Statistics getStatistics() const {
+      if (header_ == NULL) {
+	Statistics stats = { 0, 0, 0 };
+	return stats;
+      }
+      return header_->stats;
+    }
+  };
+
+  /**
+   * indexFile is owned by the returned index.
+   */
+  ColumnIndex *createColumnIndex(SQLType type, File *dataFile, File *indexFile)
+    THROWS((RTException)) {
+    unique_ptr<File> file(indexFile);
+    ColumnIndex *index = NULL;
+    switch (type) {
+    case SQLTYPE_INTEGER:
+      index = new SortedColumnIndex<sqlite_int64>(dataFile, file.get());
+      break;
+    case SQLTYPE_FLOAT:
+      index = new SortedColumnIndex<double>(dataFile, file.get());
+      break;
+    default:
+      assert(false);
+      throw ASSERTION_ERROR;
+    }
+    file.release();
+    return index;
+  }
+
+  /**
+   * Minimum and maximum values of each block of rows of a numeric column.
+   *
+   * It is stored in a file of its own and lets a scan skip blocks whose
+   * values can't satisfy a constraint, without touching their pages.
+   * It is updated on insert, and rebuilt from the column lazily when it
+   * lags behind, e.g. for a table created without it.
+   */
+  class ZoneMap: public virtual Openable, public virtual Closable {
+  public:
+    enum {
+      ROWS_PER_ZONE = 1 << 16
+    };
+    virtual ~ZoneMap() THROWS((RTException)) {}
+
+    /**
+     * Adds value of rowId, which should be appended just now.
+     * MT unsafe, caller should protect.
+     */
+    virtual void update(sqlite_int64 rowId, sqlite3_value *value)
+      THROWS((RTException)) = 0;
+    /**
+     * Adds rows up to nRows from the column.
+     * MT unsafe, caller should protect.
+     */
+    virtual void refresh(sqlite_int64 nRows) THROWS((RTException)) = 0;
+    /**
+     * Returns the number of rows which zones cover.
+     */
+    virtual sqlite_int64 getNumberOfRows() const = 0;
+    /**
+     * Returns false if no row in zone satisfies "value op key".
+     */
+    virtual bool mayMatch(sqlite_int64 zone, int op, NumericKey const &key)
+      const = 0;
+  };
+
+  template <typename T>
+  class TypedZoneMap: public ZoneMap {
+    struct Zone {
+      T min;
+      T max;
+    };
+    struct ZoneHeader {
+      uint64_t magic;
+      sqlite_int64 nRows; // rows covered by zones
+      char padding[256 - sizeof(uint64_t) - sizeof(sqlite_int64)];
+      Zone zones[1];
+    };
+    enum {
+      MAGIC = 0x50414d454e4f5a // "ZONEMAP"
+    };
+
+    File *dataFile_; // not owned
+    unique_ptr<File> file_;
+    unique_ptr<MMap> map_;
+    ZoneHeader *header_;
+    sqlite_int64 nMappedZones;
+
+    static T valueOf(sqlite3_value *value, sqlite_int64 const *) {
+      return sqlite3_value_int64(value);
+    }
+    static T valueOf(sqlite3_value *value, double const *) {
+      return sqlite3_value_double(value);
+    }
+
+    void mapHeader(sqlite_int64 nZones) THROWS((RTException)) {
+      off_t offset = 0;
+      size_t size = 0;
+      MMap::alignRegion(&offset, &size, 0,
+			offsetof(ZoneHeader, zones) + nZones * sizeof(Zone));
+      header_ = NULL;
+      map_->unmap();
+      map_->setMapRegion(offset, size);
+      header_ = map_->map<ZoneHeader>();
+      nMappedZones = nZones;
+    }
+
+    static sqlite_int64 zonesFor(sqlite_int64 nRows) {
+      return (nRows + ROWS_PER_ZONE - 1) / ROWS_PER_ZONE;
+    }
+
+    /**
+     * Adds value as the row following header_->nRows.
+     */
+    void add(T value) {
+      sqlite_int64 pos = header_->nRows;
+      Zone &zone = header_->zones[pos / ROWS_PER_ZONE];
+      if (pos % ROWS_PER_ZONE == 0) {
+	zone.min = value;
+	zone.max = value;
+      } else {
+	zone.min = MIN(zone.min, value);
+	zone.max = MAX(zone.max, value);
+      }
+      header_->nRows = pos + 1;
+    }
+
+  public:
+    /**
+     * zoneFile is owned by this instance.
+     */
+    TypedZoneMap(File *dataFile, File *zoneFile)
+      : dataFile_(dataFile), file_(zoneFile), map_(), header_(NULL),
+	nMappedZones(0) {
+      assert(dataFile_ != NULL);
+      assert(file_.get() != NULL);
+    }
+    virtual ~TypedZoneMap() THROWS((RTException)) {
+      enterP(this);
+    }
+
+    virtual void open() THROWS((RTException)) {
+      enter();
+      if (header_ != NULL) {
+	return;
+      }
+      file_->open();
+      if (map_.get() == NULL) {
+	map_.reset(new MMap(file_.get()));
+      }
+      mapHeader(0);
+      if (header_->magic != MAGIC) {
+	header_->nRows = 0;
+	header_->magic = MAGIC;
+      }
+      mapHeader(zonesFor(header_->nRows));
+    }
+    virtual void close() THROWS((RTException)) {
+      enter();
+      header_ = NULL;
+      if (map_.get() != NULL) {
+	map_->close();
+      }
+      file_->close();
+    }
+
+    virtual void update(sqlite_int64 rowId, sqlite3_value *value)
+      THROWS((RTException)) {
+      assert(header_ != NULL);
+      if (header_->nRows != rowId - 1) { // lagging, refresh() will catch up.
+	return;
+      }
+      if (zonesFor(rowId) > nMappedZones) {
+	mapHeader(zonesFor(rowId));
+      }
+      add(valueOf(value, static_cast<T const *>(NULL)));
+    }
+
+    virtual void refresh(sqlite_int64 nRows) THROWS((RTException)) {
+      enter();
+      assert(header_ != NULL);
+      if (header_->nRows == nRows) {
+	return;
+      }
+      if (header_->nRows > nRows) { // rows were removed, rebuild
+	header_->nRows = 0;
+      }
+      if (zonesFor(nRows) > nMappedZones) {
+	mapHeader(zonesFor(nRows));
+      }
+      while (header_->nRows < nRows) {
+	sqlite_int64 first = header_->nRows;
+	size_t len = MIN(static_cast<sqlite_int64>(ROWS_PER_ZONE),
+			 nRows - first);
+	off_t offset = first * sizeof(T);
+	Referer<MMap> map(dataFile_->makeMapForRegion(offset, len * sizeof(T)));
+	LockHolder protect;
+	map->takeLock(protect);
+	T const *values = map->remapForRegion<T const>(offset, len * sizeof(T));
+	for (size_t i = 0; i < len; i++) {
+	  add(values[i]);
+	}
+      }
+      LOG cout << "zone map refreshed: " << nRows << " rows\n";
+    }
+
+    virtual sqlite_int64 getNumberOfRows() const {
+      return header_ == NULL ? 0 : header_->nRows;
+    }
+
+    virtual bool mayMatch(sqlite_int64 zone, int op, NumericKey const &key)
+      const {
+      assert(header_ != NULL);
+      assert(zone < zonesFor(header_->nRows));
+      Zone const &z = header_->zones[zone];
+      switch (op) {
+      case SQLITE_INDEX_CONSTRAINT_EQ:
+	return ! lessThan(key, z.min) && ! lessThan(z.max, key);
+      case SQLITE_INDEX_CONSTRAINT_GT:
+	return lessThan(key, z.max);
+      case SQLITE_INDEX_CONSTRAINT_GE:
+	return ! lessThan(z.max, key);
+      case SQLITE_INDEX_CONSTRAINT_LT:
+	return lessThan(z.min, key);
+      case SQLITE_INDEX_CONSTRAINT_LE:
+	return ! lessThan(key, z.min);
+      }
+      return true;
+    }
+  };
+
+  /**
+   * zoneFile is owned by the returned zone map.
+   */
+  ZoneMap *createZoneMap(SQLType type, File *dataFile, File *zoneFile)
+    THROWS((RTException)) {
+    unique_ptr<File> file(zoneFile);
+    ZoneMap *zoneMap = NULL;
+    switch (type) {
+    case SQLTYPE_INTEGER:
+      zoneMap = new TypedZoneMap<sqlite_int64>(dataFile, file.get());
+      break;
+    case SQLTYPE_FLOAT:
+      zoneMap = new TypedZoneMap<double>(dataFile, file.get());
+      break;
+    default:
+      assert(false);
+      throw ASSERTION_ERROR;
+    }
+    file.release();
+    return zoneMap;
+  }
+
   class Table;
   class Column: public virtual Openable, public virtual Closable {
   public:
@@ -941,8 +1471,13 @@ namespace a {
     size_t size;
     bool isPK_;
     bool notNull_;
+    bool indexed_;
   protected:
     unique_ptr<File> file;
+  private:
+    unique_ptr<ColumnIndex> index;
+    unique_ptr<ZoneMap> zoneMap;
+  protected:
 
     File *openFile(char const suffix[]) THROWS((RTException));
 
@@ -1014,14 +1549,15 @@ namespace a {
 				 Referer<MMap>&mapRef);
     Column(ColumnDesc const &colDesc)
       : table(NULL), name_(colDesc.name), type_(colDesc.type),
-	isPK_(colDesc.isPK), notNull_(colDesc.isNotNull),
-	file() {
+	isPK_(colDesc.isPK), notNull_(colDesc.isNotNull), indexed_(false),
+	file(), index(), zoneMap() {
       init(colDesc.name);
     }
-    Column(char const name[], SQLType type, bool isPk, bool notNull)
+    Column(char const name[], SQLType type, bool isPk, bool notNull,
+	   bool indexed = false)
       : table(NULL), name_(name), type_(type),
-	isPK_(isPk), notNull_(notNull),
-	file() {
+	isPK_(isPk), notNull_(notNull), indexed_(indexed),
+	file(), index(), zoneMap() {
       init(name);
     }
     virtual ~Column() THROWS((RTException)) {
@@ -1058,6 +1594,24 @@ namespace a {
 	  throw;
 	}
       }
+      if (hasZoneMap() && zoneMap.get() == NULL) {
+	zoneMap.reset(createZoneMap(type_, file.get(), openFile(".zm")));
+	try {
+	  zoneMap->open();
+	} catch (...) {
+	  zoneMap.reset(NULL);
+	  throw;
+	}
+      }
+      if (indexed_ && index.get() == NULL) {
+	index.reset(createColumnIndex(type_, file.get(), openFile(".idx")));
+	try {
+	  index->open();
+	} catch (...) {
+	  index.reset(NULL);
+	  throw;
+	}
+      }
     }
     /**
      * MT unsafe, callser shoud protect.
@@ -1067,6 +1621,24 @@ namespace a {
       if (isPK()) {
 	return;
       }
+      if (index.get() != NULL) {
+	try {
+	  index->close();
+	} catch (...) {
+	  index.reset(NULL);
+	  throw;
+	}
+	index.reset(NULL);
+      }
+      if (zoneMap.get() != NULL) {
+	try {
+	  zoneMap->close();
+	} catch (...) {
+	  zoneMap.reset(NULL);
+	  throw;
+	}
+	zoneMap.reset(NULL);
+      }
       if (file.get() != NULL) {
 	try {
 	  file->close();
@@ -1107,6 +1679,9 @@ namespace a {
 	  throw ASSERTION_ERROR;
 	}
       }
+      if (zoneMap.get() != NULL) {
+	zoneMap->update(rowId, value);
+      }
     }
 
     void fetch(sqlite3_context *pCtx, sqlite_int64 rowId) THROWS((RTException)) {
@@ -1133,7 +1708,7 @@ namespace a {
       THROWS((RTException)) {
       enter();
       assert(rowId > 0);
-      assert(setter > 0);
+      assert(setter != NULL);
       {
 	off_t offset = (rowId - 1) * size;
 	Referer<MMap> map(file->makeMapForRegion(offset, size));
@@ -1169,11 +1744,34 @@ namespace a {
     bool isNotNull() const {
       return notNull_;
     }
+    bool isIndexed() const {
+      return indexed_;
+    }
+    /**
+     * Returns NULL unless the column is indexed and opened.
+     */
+    ColumnIndex *getIndex() const {
+      return index.get();
+    }
+    /**
+     * Fixed size columns other than PK keep a zone map.
+     */
+    bool hasZoneMap() const {
+      return ! isPK_ && size > 0;
+    }
+    /**
+     * Returns NULL unless the column has a zone map and is opened.
+     */
+    ZoneMap *getZoneMap() const {
+      return zoneMap.get();
+    }
   };
 
   class VariableSizeColumn: public Column {
     unique_ptr<File> dataFile;
     unique_ptr<MMap> headerMap;
+    blobcodec::Codec const *codec_; // NULL means values are stored as is.
+    size_t codecElementSize_;
     struct Entry {
       off_t offset;
       size_t size;
@@ -1192,10 +1790,14 @@ namespace a {
     }
   public:
     VariableSizeColumn(ColumnDesc const &colDesc)
-      :Column(colDesc), dataFile(), headerMap() {
+      :Column(colDesc), dataFile(), headerMap(),
+       codec_(NULL), codecElementSize_(1) {
     }
-    VariableSizeColumn(char const name[], SQLType type, bool isPk, bool notNull)
-      : Column(name, type, isPk, notNull), dataFile(), headerMap() {
+    VariableSizeColumn(char const name[], SQLType type, bool isPk, bool notNull,
+		       blobcodec::Codec const *codec = NULL,
+		       size_t codecElementSize = 1)
+      : Column(name, type, isPk, notNull), dataFile(), headerMap(),
+	codec_(codec), codecElementSize_(codecElementSize) {
     }
     virtual ~VariableSizeColumn() THROWS((RTException)) {
       enterP(this);
@@ -1269,26 +1871,33 @@ namespace a {
 	  //assert(type == type_);
 	  DataHeader *header = headerMap->getMappedAddr<DataHeader>();
 	  off_t dataLocation = alignUp(header->tail);
-	  int size = sqlite3_value_bytes(value);
+	  void const *src = NULL;
+	  switch (type) {
+	  case SQLITE_TEXT:
+	    src = sqlite3_value_text(value);
+	    break;
+	  case SQLITE_BLOB:
+	    src = sqlite3_value_blob(value);
+	    break;
+	  default:
+	    assert(false);
+	    leave();
+	    throw ASSERTION_ERROR;
+	  }
+	  size_t size = sqlite3_value_bytes(value);
+	  vector<char> encoded;
+	  if (codec_ != NULL) {
+	    encoded.resize(blobcodec::getMaxEncodedSize(size));
+	    size = blobcodec::encode(codec_, src, size, codecElementSize_,
+				     &encoded[0]);
+	    src = &encoded[0];
+	  }
 	  {
 	    Referer<MMap> dataMap(dataFile->makeMapForRegion(dataLocation,
 							     size));
 	    LockHolder protectData;
 	    dataMap->takeLock(protectData);
 	    void *data = dataMap->remapForRegion<void>(dataLocation, size);
-	    void const *src = NULL;
-	    switch (type) {
-	    case SQLITE_TEXT:
-	      src = sqlite3_value_text(value);
-	      break;
-	    case SQLITE_BLOB:
-	      src = sqlite3_value_blob(value);
-	      break;
-	    default:
-	      assert(false);
-	      leave();
-	      throw ASSERTION_ERROR;
-	    }
 	    memcpy(data, src, size);
 	    header->tail = dataLocation + size;
 	    entry->offset = dataLocation;
@@ -1319,27 +1928,59 @@ namespace a {
 	  LockHolder protectData;
 	  dataMap->takeLock(protectData);
 	  void *data = dataMap->remapForRegion<void>(entry->offset, entry->size);
-	  setter(pCtx, data, entry->size, map);
+	  size_t rawSize = 0;
+	  if (codec_ != NULL
+	      && blobcodec::getDecodedSize(data, entry->size, &rawSize)) {
+	    void *buf = sqlite3_malloc(MAX(rawSize, 1));
+	    if (buf == NULL) {
+	      throw bad_alloc();
+	    }
+	    if (! blobcodec::decode(data, entry->size, buf)) {
+	      sqlite3_free(buf);
+	      static RTException ex("broken encoded value.");
+	      throw ex;
+	    }
+	    sqlite3_result_blob(pCtx, buf, rawSize, sqlite3_free);
+	  } else { // stored as is
+	    setter(pCtx, data, entry->size, map);
+	  }
 	}
       }
     }
   };
 
   Column *createColumn(char const name[], SQLType type,
-		       bool isPk, bool notNull) THROWS((RTException)) {
+		       bool isPk, bool notNull, bool indexed,
+		       blobcodec::Codec const *codec, size_t codecElementSize)
+    THROWS((RTException)) {
+    if (codec != NULL && type != SQLTYPE_BLOB) {
+      static RTException ex("only BLOB columns can have a codec.");
+      throw ex;
+    }
     switch (type) {
     case SQLITE_TEXT:
     case SQLITE_BLOB:
-      return new VariableSizeColumn(name, type, isPk, notNull);
+      if (indexed) {
+	static RTException ex("only INTEGER and REAL columns can be indexed.");
+	throw ex;
+      }
+      return new VariableSizeColumn(name, type, isPk, notNull,
+				    codec, codecElementSize);
     case SQLTYPE_INTEGER:
     case SQLTYPE_FLOAT:
-      return new Column(name, type, isPk, notNull);
+      if (indexed && (isPk || ! notNull)) {
+	static RTException ex("only NOT NULL non-PK columns can be indexed.");
+	throw ex;
+      }
+      return new Column(name, type, isPk, notNull, indexed);
     }
     assert(false);
     throw ASSERTION_ERROR;
   }
 
+  class TableReaderImpl;
   class Table: public virtual Openable, public virtual Closable  {
+    friend class TableReaderImpl;
     Mutex lock;
     string name_;
     string path_;
@@ -1738,6 +2379,48 @@ namespace a {
     }
   };
 
+  /**
+   * Skips zones of rows which can't satisfy a constraint on a column.
+   * Rows in the other zones still need to be checked by SQLite.
+   */
+  class ZonePredicate: public PredicateBase {
+    ZoneMap const *zoneMap_;
+    int op_;
+    bool isNull_;
+    bool isNumeric_;
+    NumericKey key_;
+  public:
+    /**
+     * value is copied since it is valid only during xFilter.
+     */
+    ZonePredicate(ZoneMap const *zoneMap, int op, sqlite3_value *value)
+      : zoneMap_(zoneMap), op_(op),
+	isNull_(sqlite3_value_type(value) == SQLITE_NULL), isNumeric_(false) {
+      assert(zoneMap_ != NULL);
+      isNumeric_ = NumericKey::fromValue(value, &key_);
+    }
+    virtual sqlite_int64 nextMatch(sqlite_int64 rowId, sqlite_int64 nRow)
+      const {
+      if (isNull_) { // no value satisfies a comparison with NULL.
+	return nRow + 1;
+      }
+      if (! isNumeric_) {
+	return rowId;
+      }
+      sqlite_int64 const covered = zoneMap_->getNumberOfRows();
+      while (rowId <= nRow) {
+	sqlite_int64 zone = (rowId - 1) / ZoneMap::ROWS_PER_ZONE;
+	sqlite_int64 zoneEnd = (zone + 1) * ZoneMap::ROWS_PER_ZONE;
+	if (MIN(zoneEnd, nRow) > covered // some rows are not in the zone
+	    || zoneMap_->mayMatch(zone, op_, key_)) {
+	  break;
+	}
+	rowId = zoneEnd + 1;
+      }
+      return rowId;
+    }
+  };
+
   class Cursor: public virtual Closable  {
     Mutex lock;
     enum State {
@@ -1748,18 +2431,51 @@ namespace a {
     Table *table_;
     sqlite_int64 rowId;
     vector<PredicateBase *> preds;
+    ColumnIndex *index_; // NULL for rowId order scan
+    sqlite_int64 indexPos;
+    sqlite_int64 indexEnd;
+
+    void deletePredicates() {
+      vector<PredicateBase *>::size_type end = preds.size();
+      for (vector<PredicateBase *>::size_type i = 0; i < end; i++) {
+	delete preds[i];
+	preds[i] = NULL;
+      }
+      preds.clear();
+    }
+
+    bool matchesAll(sqlite_int64 rowId, sqlite_int64 nRows) const {
+      vector<PredicateBase *>::size_type const end = preds.size();
+      for (vector<PredicateBase *>::size_type i = 0; i < end; i++) {
+	if (preds[i]->nextMatch(rowId, nRows) != rowId) {
+	  return false;
+	}
+      }
+      return true;
+    }
+
   public:
     Cursor(Table *table)
-      : lock(), state(NotSearchedYet), table_(table), rowId(0), preds() {
+      : lock(), state(NotSearchedYet), table_(table), rowId(0), preds(),
+	index_(NULL), indexPos(0), indexEnd(0) {
       enter();
     }
     virtual ~Cursor() THROWS((RTException)) {
       enter();
-      vector<PredicateBase *>::size_type end = preds.size();
-      for (vector<PredicateBase *>::size_type i = 0; i < end; i++) {
-	delete preds[i];
-	preds[i] = NULL;
-      }
+      deletePredicates();
+    }
+
+    /**
+     * Makes this cursor ready for another xFilter.
+     */
+    void reset() {
+      enter();
+      deletePredicates();
+      state = NotSearchedYet;
+      rowId = 0;
+      index_ = NULL;
+      indexPos = 0;
+      indexEnd = 0;
     }
 
     Table *getTable() const {
@@ -1774,6 +2490,20 @@ namespace a {
       preds.push_back(pred);
     }
 
+    /**
+     * Visits rows at [begin, end) of index in the index order
+     * instead of all rows. Predicates still apply to them.
+     */
+    void setIndexRange(ColumnIndex *index,
+		       sqlite_int64 begin, sqlite_int64 end) {
+      assert(state == NotSearchedYet);
+      assert(index != NULL);
+      assert(begin <= end);
+      index_ = index;
+      indexPos = begin;
+      indexEnd = end;
+    }
+
     void find() {
       enter();
       assert(state == NotSearchedYet);
@@ -1791,17 +2521,28 @@ namespace a {
 	sqlite_int64 const nRows = table_->getNumberOfRows();
 	LOG cout << "nRows: " << nRows << endl;
 
-	rowId++;
-	LOG cout << "rowId: " << rowId << endl;
-	vector<PredicateBase *>::size_type const end = preds.size();
-	LOG cout << "number of preds: " << end << endl;
-
-	for (sqlite_int64 lastRowId = rowId; rowId <= nRows; lastRowId = rowId) {
-	  for (vector<PredicateBase *>::size_type i = 0; i < end; i++) {
-	    rowId = preds[i]->nextMatch(rowId, nRows);
+	if (index_ != NULL) {
+	  rowId = nRows + 1;
+	  while (indexPos < indexEnd) {
+	    sqlite_int64 candidate = index_->getRowId(indexPos++);
+	    if (candidate <= nRows && matchesAll(candidate, nRows)) {
+	      rowId = candidate;
+	      break;
+	    }
 	  }
-	  if (rowId > nRows || lastRowId == rowId) { // matches all preds or not matches at all.
-	    break;
+	} else {
+	  rowId++;
+	  LOG cout << "rowId: " << rowId << endl;
+	  vector<PredicateBase *>::size_type const end = preds.size();
+	  LOG cout << "number of preds: " << end << endl;
+
+	  for (sqlite_int64 lastRowId = rowId; rowId <= nRows; lastRowId = rowId) {
+	    for (vector<PredicateBase *>::size_type i = 0; i < end; i++) {
+	      rowId = preds[i]->nextMatch(rowId, nRows);
+	    }
+	    if (rowId > nRows || lastRowId == rowId) { // matches all preds or not matches at all.
+	      break;
+	    }
 	  }
 	}
 	if (rowId > nRows) {
@@ -1855,7 +2596,7 @@ extern "C" {
     mmap->unref();
   }
 
-  void init_module() THROWS((RTException)) {
+  void initPageSize() THROWS((RTException)) {
     long pageSize = sysconf(_SC_PAGE_SIZE);
     if (pageSize <= 0) {
       static RTException ex("Failed to get page size.");
@@ -1866,7 +2607,10 @@ extern "C" {
       throw ex;
     }
     PAGE_SIZE = pageSize;
+  }
 
+  void init_module() THROWS((RTException)) {
+    initPageSize();
     Destructor_t::init(unrefMMap);
   }
 
@@ -1933,6 +2677,8 @@ extern "C" {
       T_key,
       T_not,
       T_null,
+      T_indexed,
+      T_codec,
       T_NUM,
       T_id,
       T_EOF
@@ -1946,18 +2692,32 @@ extern "C" {
       throw ASSERTION_ERROR;
     }
   public:
+    /**
+     * Parses
+     * "name type [PRIMARY KEY] [NOT NULL] [INDEXED] [CODEC codec[:size]]".
+     * Constraints may appear in any order. See BlobCodec.h for codec.
+     */
     static SQLType parse(char const *str,
 			 char const **name, size_t *nameLen,
-			 bool *isPK, bool *notNull) THROWS((RTException)) {
+			 bool *isPK, bool *notNull, bool *indexed,
+			 blobcodec::Codec const **codec,
+			 size_t *codecElementSize)
+      THROWS((RTException)) {
       assert(str != NULL);
       assert(name != NULL);
       assert(nameLen != NULL);
       assert(isPK != NULL);
       assert(notNull != NULL);
+      assert(indexed != NULL);
+      assert(codec != NULL);
+      assert(codecElementSize != NULL);
       *name = NULL;
       *nameLen = 0;
       *isPK = false;
       *notNull = false;
+      *indexed = false;
+      *codec = NULL;
+      *codecElementSize = 1;
 
       static RTException ex("parse error");
 
@@ -2003,27 +2763,30 @@ extern "C" {
 	size_t invTokLen = 0;
 	Token t = scanner.nextToken(&ctx, T_EOF, T_id, &invTok, &invTokLen);
 	if (t == T_EOF) {
-	  *isPK = false;
 	  break;
 	}
 	if (t == T_primary) {
 	  t = scanner.nextToken(&ctx, T_EOF, T_id, &invTok, &invTokLen);
 	  if (t == T_key) {
-	    t = scanner.nextToken(&ctx, T_EOF, T_id, &invTok, &invTokLen);
-	    if (t == T_EOF) {
-	      *isPK = true;
-	      *notNull = true;
-	      break;
-	    }
+	    *isPK = true;
+	    *notNull = true;
+	    continue;
 	  }
 	} else if (t == T_not) {
 	  t = scanner.nextToken(&ctx, T_EOF, T_id, &invTok, &invTokLen);
 	  if (t == T_null) {
-	    t = scanner.nextToken(&ctx, T_EOF, T_id, &invTok, &invTokLen);
-	    if (t == T_EOF) {
-	      *notNull = true;
-	      break;
-	    }
+	    *notNull = true;
+	    continue;
+	  }
+	} else if (t == T_indexed) {
+	  *indexed = true;
+	  continue;
+	} else if (t == T_codec) {
+	  t = scanner.nextToken(&ctx, T_EOF, T_id, &invTok, &invTokLen);
+	  if (t == T_id
+	      && blobcodec::parseCodecSpec(invTok, invTokLen,
+					   codec, codecElementSize)) {
+	    continue;
 	  }
 	}
 	throw ex;
@@ -2042,7 +2805,9 @@ extern "C" {
     NewTableParser::T_primary,
     NewTableParser::T_key,
     NewTableParser::T_not,
-    NewTableParser::T_null
+    NewTableParser::T_null,
+    NewTableParser::T_indexed,
+    NewTableParser::T_codec
   };
   char const *NewTableParser::tokenStrs[] = {
       "integer",
@@ -2053,7 +2818,9 @@ extern "C" {
       "primary",
       "key",
       "not",
-      "null"
+      "null",
+      "indexed",
+      "codec"
     };
   Scanner<NewTableParser::Token> const
   NewTableParser::scanner(NewTableParser::tokens,
@@ -2108,10 +2875,15 @@ extern "C" {
 	size_t colNameLen = 0;
 	bool isPK = false;
 	bool notNull = false;
+	bool indexed = false;
+	blobcodec::Codec const *codec = NULL;
+	size_t codecElementSize = 1;
 	SQLType type =
-	  NewTableParser::parse(argv[i], &colName, &colNameLen, &isPK, &notNull);
+	  NewTableParser::parse(argv[i], &colName, &colNameLen, &isPK, &notNull,
+				&indexed, &codec, &codecElementSize);
 	string colname(colName, colNameLen);
-	unique_ptr<Column> col(createColumn(colname.c_str(), type, isPK, notNull));
+	unique_ptr<Column> col(createColumn(colname.c_str(), type, isPK, notNull,
+					    indexed, codec, codecElementSize));
 	vt->addColumn(col.get());
 	col.release();
 	ddl += sep;
@@ -2261,6 +3033,75 @@ extern "C" {
     return SQLITE_OK;
   }
 
+  /*
+   * Cost model of xBestIndex. A unit is the cost of reading a row
+   * sequentially from the mmap'd column files.
+   */
+  double const COST_SEQUENTIAL_ROW = 1.0;
+  // a row visited out of rowId order by an index scan touches another page.
+  double const COST_RANDOM_ROW = 4.0;
+  // Same guesses as SQLite uses without ANALYZE: a range bound keeps 1/4 of
+  // rows, and an equality on a non-unique index matches 10 rows.
+  double const RANGE_BOUND_SELECTIVITY = 0.25;
+  double const ROWS_PER_KEY_GUESS = 10.0;
+
+  // Set to idxNum if constraints on a column other than rowId are for its
+  // index rather than for its zone map.
+  int const IDXNUM_INDEX_SCAN = 1 << 30;
+
+  bool isSupportedConstraint(int op) {
+    switch (op) {
+    case SQLITE_INDEX_CONSTRAINT_EQ:
+    case SQLITE_INDEX_CONSTRAINT_GT:
+    case SQLITE_INDEX_CONSTRAINT_GE:
+    case SQLITE_INDEX_CONSTRAINT_LT:
+    case SQLITE_INDEX_CONSTRAINT_LE:
+      return true;
+    }
+    return false;
+  }
+
+  /**
+   * Constraints on a column, which are used together for an access path.
+   */
+  struct AccessPath {
+    bool hasEQ;
+    bool hasLower;
+    bool hasUpper;
+  };
+
+  void addConstraint(AccessPath *path, int op) {
+    switch (op) {
+    case SQLITE_INDEX_CONSTRAINT_EQ:
+      path->hasEQ = true;
+      break;
+    case SQLITE_INDEX_CONSTRAINT_GT:
+    case SQLITE_INDEX_CONSTRAINT_GE:
+      path->hasLower = true;
+      break;
+    case SQLITE_INDEX_CONSTRAINT_LT:
+    case SQLITE_INDEX_CONSTRAINT_LE:
+      path->hasUpper = true;
+      break;
+    }
+  }
+
+  double estimateRows(AccessPath const &path, double nRows,
+		      double rowsPerKey) {
+    double rows = nRows;
+    if (path.hasEQ) {
+      rows = rowsPerKey;
+    } else {
+      if (path.hasLower) {
+	rows *= RANGE_BOUND_SELECTIVITY;
+      }
+      if (path.hasUpper) {
+	rows *= RANGE_BOUND_SELECTIVITY;
+      }
+    }
+    return MAX(1.0, MIN(rows, nRows));
+  }
+
   int mmapBestIndexMethod(sqlite3_vtab *pVTab, sqlite3_index_info *pIdxInfo)
     throw() {
     enter();
@@ -2274,31 +3115,101 @@ extern "C" {
     LOG cout << "best index\n";
     LOG cout << "best index: constraint: " << pIdxInfo->nConstraint << "\n";
     int pkCol = tab->getPKColumnIndex(); // may be -1
+    double const nRows = MAX(1.0, static_cast<double>(tab->getNumberOfRows()));
+
+    // Without usable constraints, all rows are read in rowId order.
+    AccessPath rowIdPath = { false, false, false };
+    bool useRowId = false;
+    int indexCol = -1;
+    double rows = nRows;
+    double cost = nRows * COST_SEQUENTIAL_ROW;
     for (int i = 0; i < pIdxInfo->nConstraint; i++) {
-      if (pIdxInfo->aConstraint[i].usable) {
-	if (pIdxInfo->aConstraint[i].iColumn != pkCol
-	    && pIdxInfo->aConstraint[i].iColumn != -1) {
-	  sqlite3_free(pVTab->zErrMsg);
-	  pVTab->zErrMsg = sqlite3_mprintf("Any column other than PK can't be a constraint.");
-	  leave();
-	  return SQLITE_ERROR;
-	}
-	switch (pIdxInfo->aConstraint[i].op) {
-	case SQLITE_INDEX_CONSTRAINT_MATCH:
-	  sqlite3_free(pVTab->zErrMsg);
-	  pVTab->zErrMsg = sqlite3_mprintf("LIKE operater is not allowed for this column.");
-	  leave();
-	  return SQLITE_ERROR;
+      sqlite3_index_info::sqlite3_index_constraint const &constraint =
+	pIdxInfo->aConstraint[i];
+      if (! constraint.usable) {
+	continue;
+      }
+      if (constraint.op == SQLITE_INDEX_CONSTRAINT_MATCH) {
+	sqlite3_free(pVTab->zErrMsg);
+	pVTab->zErrMsg = sqlite3_mprintf("LIKE operater is not allowed for this column.");
+	leave();
+	return SQLITE_ERROR;
+      }
+      if (isSupportedConstraint(constraint.op)
+	  && (constraint.iColumn == pkCol || constraint.iColumn == -1)) {
+	addConstraint(&rowIdPath, constraint.op);
+	useRowId = true;
+      }
+    }
+    if (useRowId) {
+      rows = estimateRows(rowIdPath, nRows, 1.0);
+      cost = rows * COST_SEQUENTIAL_ROW;
+    }
+
+    // Constraints on other columns are left to SQLite unless the column is
+    // indexed and the index is cheaper.
+    for (int i = 0; i < pIdxInfo->nConstraint; i++) {
+      int col = pIdxInfo->aConstraint[i].iColumn;
+      if (! pIdxInfo->aConstraint[i].usable
+	  || ! isSupportedConstraint(pIdxInfo->aConstraint[i].op)
+	  || col == pkCol || col < 0 || col == indexCol) {
+	continue;
+      }
+      ColumnIndex *index = tab->getColumn(col)->getIndex();
+      if (index == NULL) {
+	continue;
+      }
+      AccessPath path = { false, false, false };
+      for (int j = i; j < pIdxInfo->nConstraint; j++) {
+	if (pIdxInfo->aConstraint[j].usable
+	    && pIdxInfo->aConstraint[j].iColumn == col) {
+	  addConstraint(&path, pIdxInfo->aConstraint[j].op);
 	}
+      }
+      ColumnIndex::Statistics stats = index->getStatistics();
+      double rowsPerKey = ROWS_PER_KEY_GUESS;
+      double orderedRatio = 0.0;
+      if (stats.nRows > 0) {
+	rowsPerKey = static_cast<double>(stats.nRows) / stats.nDistinct;
+	orderedRatio = static_cast<double>(stats.nOrdered) / MAX(1, stats.nRows - 1);
+      }
+      double indexRows = estimateRows(path, nRows, rowsPerKey);
+      double costPerRow = COST_SEQUENTIAL_ROW
+	+ (1.0 - orderedRatio) * (COST_RANDOM_ROW - COST_SEQUENTIAL_ROW);
+      double indexCost = log(nRows + 1.0) / log(2.0) * COST_RANDOM_ROW
+	+ indexRows * costPerRow;
+      LOG cout << "index on column " << col << ": rows " << indexRows
+	       << ", cost " << indexCost << endl;
+      if (indexCost < cost) {
+	indexCol = col;
+	rows = indexRows;
+	cost = indexCost;
+      }
+    }
+
+    // A scan in rowId order skips zones with the other constraints. Whether
+    // it can depends on how values are clustered, which is unknown here,
+    // so the cost above doesn't count on it.
+    for (int i = 0; i < pIdxInfo->nConstraint; i++) {
+      sqlite3_index_info::sqlite3_index_constraint const &constraint =
+	pIdxInfo->aConstraint[i];
+      int col = constraint.iColumn;
+      bool isRowId = col == pkCol || col == -1;
+      bool use = constraint.usable && isSupportedConstraint(constraint.op)
+	&& ((useRowId && isRowId)
+	    || (indexCol >= 0 && col == indexCol)
+	    || (indexCol < 0 && ! isRowId
+		&& tab->getColumn(col)->hasZoneMap()));
+      if (use) {
 	assert(pIdxInfo->aConstraintUsage != NULL);
-	idxStr[idx++] = pIdxInfo->aConstraint[i].op;
-	idxStr[idx++] = pIdxInfo->aConstraint[i].iColumn + 1 + 'A';
+	idxStr[idx++] = constraint.op;
+	idxStr[idx++] = constraint.iColumn + 1 + 'A';
 	pIdxInfo->aConstraintUsage[i].argvIndex = idx / 2;
 	pIdxInfo->aConstraintUsage[i].omit = 0; // set to 1 after debug
       }
     }
     LOG cout << "best index loop end\n";
-    pIdxInfo->idxNum = idx;
+    pIdxInfo->idxNum = idx | (indexCol >= 0 ? IDXNUM_INDEX_SCAN : 0);
     idxStr[idx++] = '\0';
     assert(idx <= pIdxInfo->nConstraint * 2 + 1);
     pIdxInfo->needToFreeIdxStr = 1;
@@ -2307,8 +3218,29 @@ extern "C" {
       leave();
       return SQLITE_NOMEM;
     }
-    assert(! pIdxInfo->orderByConsumed);
-    pIdxInfo->estimatedCost = 200000.0;
+
+    // Rows come in rowId order, or in the order of the index.
+    if (pIdxInfo->nOrderBy == 1 && ! pIdxInfo->aOrderBy[0].desc) {
+      int orderCol = pIdxInfo->aOrderBy[0].iColumn;
+      if (indexCol >= 0) {
+	pIdxInfo->orderByConsumed = orderCol == indexCol;
+      } else {
+	pIdxInfo->orderByConsumed = orderCol == pkCol || orderCol == -1;
+      }
+    }
+    pIdxInfo->estimatedCost = cost + 1.0;
+#if SQLITE_VERSION_NUMBER >= 3008002
+    if (sqlite3_libversion_number() >= 3008002) {
+      pIdxInfo->estimatedRows = static_cast<sqlite3_int64>(rows);
+    }
+#endif
+#if SQLITE_VERSION_NUMBER >= 3009000
+    if (sqlite3_libversion_number() >= 3009000
+	&& indexCol < 0 && useRowId && rowIdPath.hasEQ) {
+      pIdxInfo->idxFlags |= SQLITE_INDEX_SCAN_UNIQUE;
+    }
+#endif
+    LOG cout << "estimated rows " << rows << ", cost " << cost << endl;
     leave();
     return SQLITE_OK;
   }
@@ -2321,8 +3253,14 @@ extern "C" {
     MMapCursor *mmapCursor = reinterpret_cast<MMapCursor *>(pCursor);
     Cursor *cursor = mmapCursor->cursor;
     Table *table = cursor->getTable();
-    const int nConstraint = idxNum / 2;
+    const int nConstraint = (idxNum & ~IDXNUM_INDEX_SCAN) / 2;
+    const bool isIndexScan = (idxNum & IDXNUM_INDEX_SCAN) != 0;
     assert(argc == nConstraint);
+    cursor->reset();
+    Column *indexCol = NULL;
+    vector<IndexBound> bounds;
+    vector<Column *> zoneCols;
+    vector<int> zoneArgs;
     for (int i = 0; i < nConstraint; i++) {
       int op = idxStr[i*2];
       int iColumn = idxStr[i*2 + 1] - 'A' - 1;
@@ -2377,36 +3315,49 @@ extern "C" {
 	  assert(false);
 	  throw ASSERTION_ERROR;
 	}
+      } else if (! isIndexScan) {
+	assert(col->hasZoneMap());
+	zoneCols.push_back(col);
+	zoneArgs.push_back(i);
       } else {
-#if 0
-	switch (op) {
-	case SQLITE_INDEX_CONSTRAINT_EQ:
-	  {
-	    PredicateBase *pred =
-	      new PredEQ<sqlite_int64>(static_cast<sqlite_int64>(sqlite3_value_int(argv[i])));
-	    cursor->addPredicate(pred);
-	  }
-	  break;
-	case SQLITE_INDEX_CONSTRAINT_GT:
-	  {
-	    PredicateBase *pred =
-	      new PredGT<sqlite_int64>(static_cast<sqlite_int64>(sqlite3_value_int(argv[i])));
-	    cursor->addPredicate(pred);
-	  }
-	  break;
-	case SQLITE_INDEX_CONSTRAINT_LE:
-	case SQLITE_INDEX_CONSTRAINT_LT:
-	case SQLITE_INDEX_CONSTRAINT_GE:
-	  break;
-	case SQLITE_INDEX_CONSTRAINT_MATCH:
-	default:
-	  assert(false);
-	  throw ASSERTION_ERROR;
+	// xBestIndex passes constraints on one indexed column at most.
+	assert(col->isIndexed());
+	assert(indexCol == NULL || indexCol == col);
+	indexCol = col;
+	IndexBound bound = { op, value };
+	bounds.push_back(bound);
+      }
+    }
+    if (indexCol != NULL) {
+      try {
+	LockHolder tableLH;
+	table->takeLock(tableLH);
+	indexCol->open();
+	ColumnIndex *index = indexCol->getIndex();
+	index->refresh(table->getNumberOfRows());
+	sqlite_int64 begin = 0;
+	sqlite_int64 end = 0;
+	index->findRange(&bounds[0], bounds.size(), &begin, &end);
+	LOG cout << "index range: [" << begin << ", " << end << ")\n";
+	cursor->setIndexRange(index, begin, end);
+      } catch (...) {
+	return SQLITE_ERROR;
+      }
+    }
+    if (! zoneCols.empty()) {
+      try {
+	LockHolder tableLH;
+	table->takeLock(tableLH);
+	for (vector<Column *>::size_type i = 0; i < zoneCols.size(); i++) {
+	  zoneCols[i]->open();
+	  ZoneMap *zoneMap = zoneCols[i]->getZoneMap();
+	  zoneMap->refresh(table->getNumberOfRows());
+	  int arg = zoneArgs[i];
+	  cursor->addPredicate(new ZonePredicate(zoneMap, idxStr[arg*2],
+						 argv[arg]));
 	}
-#else
-	assert(false);
-	throw ASSERTION_ERROR;
-#endif
+      } catch (...) {
+	return SQLITE_ERROR;
       }
     }
     cursor->find();
@@ -2556,8 +3507,248 @@ extern "C" {
     /* xRollbackTo   */ NULL, // mmapRollbackToMethod,
   };
 
+  /*------------------------------------------------*/
+  // C++ API in MMapColumnStore.h
+
+  using mmapvtable::ColumnStoreException;
+
+  class ColumnSpanImpl: public mmapvtable::ColumnSpan {
+    Referer<MMap> map_;
+    void const *data_;
+    size_t nRows_;
+  public:
+    /**
+     * map is unref'ed by this instance.
+     */
+    ColumnSpanImpl(MMap *map, void const *data, size_t nRows)
+      : map_(map), data_(data), nRows_(nRows) {
+    }
+    virtual ~ColumnSpanImpl() throw (ColumnStoreException) {
+    }
+    virtual void const *getData() const {
+      return data_;
+    }
+    virtual size_t getNumberOfRows() const {
+      return nRows_;
+    }
+  };
+
+  class TableReaderImpl: public mmapvtable::TableReader {
+    enum {
+      ROWS_PER_COPY = 1 << 20
+    };
+    unique_ptr<File> descFile;
+    unique_ptr<MMap> descMap;
+    Table::TableDescPage const *desc;
+    vector<File *> files; // NULL unless a fixed size column
+
+    Column::ColumnDesc const &getColumnDesc(int col) const
+      THROWS((ColumnStoreException)) {
+      if (col < 0 || col >= desc->nColumns) {
+	throw ColumnStoreException("no such column");
+      }
+      return desc->columns[col];
+    }
+
+    off_t checkRange(int64_t firstRow, size_t nRows) const
+      THROWS((ColumnStoreException)) {
+      if (firstRow < 1
+	  || static_cast<int64_t>(firstRow - 1 + nRows) > desc->nRows) {
+	throw ColumnStoreException("rows out of range");
+      }
+      return (firstRow - 1) * sizeof(int64_t);
+    }
+
+    template <typename T>
+    void copyRows(int col, SQLType type, int64_t firstRow, size_t nRows,
+		  T dst[]) THROWS((ColumnStoreException)) {
+      assert(sizeof(T) == sizeof(int64_t));
+      Column::ColumnDesc const &colDesc = getColumnDesc(col);
+      if (colDesc.type != type || colDesc.isPK) {
+	throw ColumnStoreException("column type mismatch");
+      }
+      off_t offset = checkRange(firstRow, nRows);
+      try {
+	for (size_t done = 0; done < nRows; ) {
+	  size_t len = MIN(static_cast<size_t>(ROWS_PER_COPY), nRows - done);
+	  Referer<MMap> map(files[col]->makeMapForRegion(offset, len * sizeof(T)));
+	  LockHolder protect;
+	  map->takeLock(protect);
+	  T const *src = map->remapForRegion<T const>(offset, len * sizeof(T));
+	  memcpy(&dst[done], src, len * sizeof(T));
+	  offset += len * sizeof(T);
+	  done += len;
+	}
+      } catch (RTException const &ex) {
+	throw ColumnStoreException(ex.getMessage());
+      }
+    }
+
+    void closeFiles() {
+      for (vector<File *>::size_type i = 0; i < files.size(); i++) {
+	delete files[i];
+	files[i] = NULL;
+      }
+      files.clear();
+    }
+
+  public:
+    TableReaderImpl(char const path[], char const tableName[])
+      THROWS((RTException, ColumnStoreException))
+      : descFile(), descMap(), desc(NULL), files() {
+      enterP(this);
+      if (strlen(tableName) >= sizeofMember(Table::TableDescPage, name)) {
+	throw ColumnStoreException("too long table name");
+      }
+      string dir = strprintf("%s/%s", path, tableName);
+      string descPath = strprintf("%s/%s", dir.c_str(), "_.desc");
+      descFile.reset(new File(descPath.c_str(), File::Mode_Read));
+      descFile->open();
+      descMap.reset(new MMap(descFile.get()));
+      descMap->setMapRegion(0, MMap::getPageSize());
+      desc = descMap->map<Table::TableDescPage const>();
+      if (strcmp(desc->name, tableName) != 0) {
+	throw ColumnStoreException("no such table");
+      }
+      try {
+	for (uint16_t i = 0; i < desc->nColumns; i++) {
+	  Column::ColumnDesc const &colDesc = desc->columns[i];
+	  files.push_back(NULL);
+	  if (colDesc.isPK || (colDesc.type != SQLTYPE_INTEGER
+			       && colDesc.type != SQLTYPE_FLOAT)) {
+	    continue;
+	  }
+	  string filePath = strprintf("%s/%s.0", dir.c_str(), colDesc.name);
+	  files[i] = new File(filePath.c_str(), File::Mode_Read);
+	  files[i]->open();
+	}
+      } catch (...) {
+	closeFiles();
+	throw;
+      }
+    }
+    virtual ~TableReaderImpl() throw (ColumnStoreException) {
+      enterP(this);
+      desc = NULL;
+      try {
+	closeFiles();
+	descMap.reset(NULL);
+	descFile.reset(NULL);
+      } catch (RTException const &ex) {
+	throw ColumnStoreException(ex.getMessage());
+      }
+    }
+
+    virtual int64_t getNumberOfRows() const throw (ColumnStoreException) {
+      return desc->nRows;
+    }
+    virtual int getColumnCount() const throw (ColumnStoreException) {
+      return desc->nColumns;
+    }
+    virtual char const *getColumnName(int col) const
+      throw (ColumnStoreException) {
+      return getColumnDesc(col).name;
+    }
+    virtual int findColumn(char const name[]) const
+      throw (ColumnStoreException) {
+      for (int i = 0; i < desc->nColumns; i++) {
+	if (strcasecmp(desc->columns[i].name, name) == 0) {
+	  return i;
+	}
+      }
+      return -1;
+    }
+    virtual int getColumnType(int col) const throw (ColumnStoreException) {
+      return getColumnDesc(col).type;
+    }
+
+    virtual mmapvtable::ColumnSpan *mapRows(int col, int64_t firstRow,
+					    size_t nRows)
+      throw (ColumnStoreException) {
+      enter();
+      getColumnDesc(col);
+      if (files[col] == NULL) {
+	throw ColumnStoreException("only INTEGER and REAL columns other than PK can be mapped.");
+      }
+      off_t offset = checkRange(firstRow, nRows);
+      if (nRows == 0) {
+	return new ColumnSpanImpl(NULL, NULL, 0);
+      }
+      size_t size = nRows * sizeof(int64_t);
+      try {
+	Referer<MMap> map(files[col]->makeMapForRegion(offset, size));
+	void const *data = NULL;
+	{
+	  LockHolder protect;
+	  map->takeLock(protect);
+	  data = map->remapForRegion<void const>(offset, size);
+	}
+	ColumnSpanImpl *span = new ColumnSpanImpl(map.get(), data, nRows);
+	map.release();
+	return span;
+      } catch (RTException const &ex) {
+	throw ColumnStoreException(ex.getMessage());
+      } catch (bad_alloc const &) {
+	throw ColumnStoreException("out of memory");
+      }
+    }
+
+    virtual void fetchRows(int col, int64_t firstRow, size_t nRows,
+			   int64_t dst[]) throw (ColumnStoreException) {
+      enter();
+      Column::ColumnDesc const &colDesc = getColumnDesc(col);
+      if (colDesc.isPK) {
+	checkRange(firstRow, nRows);
+	for (size_t i = 0; i < nRows; i++) {
+	  dst[i] = firstRow + i;
+	}
+	return;
+      }
+      copyRows(col, SQLTYPE_INTEGER, firstRow, nRows, dst);
+    }
+    virtual void fetchRows(int col, int64_t firstRow, size_t nRows,
+			   double dst[]) throw (ColumnStoreException) {
+      enter();
+      copyRows(col, SQLTYPE_FLOAT, firstRow, nRows, dst);
+    }
+  };
+
 } // namespace
 
+namespace mmapvtable {
+
+  ColumnStoreException::ColumnStoreException(char const *staticString)
+    : msg(staticString) {
+  }
+
+  char const *ColumnStoreException::getMessage() const {
+    return msg;
+  }
+
+  ColumnSpan::~ColumnSpan() throw (ColumnStoreException) {
+  }
+
+  TableReader::~TableReader() throw (ColumnStoreException) {
+  }
+
+  TableReader *TableReader::open(char const path[], char const tableName[])
+    throw (ColumnStoreException) {
+    assert(path != NULL);
+    assert(tableName != NULL);
+    try {
+      if (a::PAGE_SIZE == 0) { // not loaded as an extension
+	a::initPageSize();
+      }
+      return new a::TableReaderImpl(path, tableName);
+    } catch (a::RTException const &ex) {
+      throw ColumnStoreException(ex.getMessage());
+    } catch (bad_alloc const &) {
+      throw ColumnStoreException("out of memory");
+    }
+  }
+
+} // namespace mmapvtable
+
 using namespace a;
 
 extern "C" {
@@ -3,10 +3,13 @@
 #include <cstdlib>
 #include <cassert>
 #include <iostream>
+#include <new>
 #include <sys/types.h>
 #include <sys/time.h>
 #include <sqlite3ext.h>
 
+#include "BlobCodec.h"
+
 SQLITE_EXTENSION_INIT1
 
 using namespace std;
@@ -264,6 +267,133 @@ int registerDumpFuncs(sqlite3 *db,
   return 0;
 }
 
+// blob_decode(data) returns data as is unless it is encoded by BlobCodec.
+static void blob_decode(sqlite3_context *ctx, int argc, sqlite3_value *argv[]) {
+  assert(argc == 1);
+  if (sqlite3_value_type(argv[0]) != SQLITE_BLOB) {
+    sqlite3_result_value(ctx, argv[0]);
+    return;
+  }
+  int dataSize = sqlite3_value_bytes(argv[0]);
+  void const *data = sqlite3_value_blob(argv[0]);
+  size_t rawSize = 0;
+  if (! blobcodec::getDecodedSize(data, dataSize, &rawSize)) {
+    sqlite3_result_value(ctx, argv[0]);
+    return;
+  }
+  if (rawSize > static_cast<size_t>(sqlite3_limit(sqlite3_context_db_handle(ctx),
+						  SQLITE_LIMIT_LENGTH, -1))) {
+    sqlite3_result_error_toobig(ctx);
+    return;
+  }
+  void *buf = sqlite3_malloc(MAX(rawSize, 1));
+  if (buf == NULL) {
+    sqlite3_result_error_nomem(ctx);
+    return;
+  }
+  bool decoded;
+  try {
+    decoded = blobcodec::decode(data, dataSize, buf);
+  } catch (std::bad_alloc const &) {
+    // must not propagate through SQLite
+    sqlite3_free(buf);
+    sqlite3_result_error_nomem(ctx);
+    return;
+  }
+  if (! decoded) {
+    sqlite3_free(buf);
+    sqlite3_result_error(ctx, "Broken or unknown encoding of DATA.", -1);
+    return;
+  }
+  sqlite3_result_blob(ctx, buf, rawSize, sqlite3_free);
+}
+
+// blob_encode(data, codec) where codec is "name" or "name:elementSize",
+// or blob_encode(data, name, elementSize).
+static void blob_encode(sqlite3_context *ctx, int argc, sqlite3_value *argv[]) {
+  assert(argc == 2 || argc == 3);
+  if (sqlite3_value_type(argv[0]) == SQLITE_NULL) {
+    sqlite3_result_null(ctx);
+    return;
+  }
+  char const *spec =
+    reinterpret_cast<char const *>(sqlite3_value_text(argv[1]));
+  blobcodec::Codec const *codec = NULL;
+  size_t elementSize = 1;
+  if (spec == NULL
+      || ! blobcodec::parseCodecSpec(spec, strlen(spec), &codec, &elementSize)) {
+    sqlite3_result_error(ctx, "Unknown codec.", -1);
+    return;
+  }
+  if (argc == 3) {
+    int size = sqlite3_value_int(argv[2]);
+    if (sqlite3_value_type(argv[2]) != SQLITE_INTEGER
+	|| size <= 0 || size > 255) {
+      sqlite3_result_error(ctx, "Invalid size of an element.", -1);
+      return;
+    }
+    elementSize = size;
+  }
+  int dataSize = sqlite3_value_bytes(argv[0]);
+  void const *data = sqlite3_value_blob(argv[0]);
+  void *buf = sqlite3_malloc(blobcodec::getMaxEncodedSize(dataSize));
+  if (buf == NULL) {
+    sqlite3_result_error_nomem(ctx);
+    return;
+  }
+  size_t size;
+  try {
+    size = blobcodec::encode(codec, data, dataSize, elementSize, buf);
+  } catch (std::bad_alloc const &) {
+    // must not propagate through SQLite
+    sqlite3_free(buf);
+    sqlite3_result_error_nomem(ctx);
+    return;
+  }
+  sqlite3_result_blob(ctx, buf, size, sqlite3_free);
+}
+
+// blob_codec(data) returns the name of the codec which encoded data,
+// or NULL if data isn't encoded.
+static void blob_codec(sqlite3_context *ctx, int argc, sqlite3_value *argv[]) {
+  assert(argc == 1);
+  blobcodec::Codec const *codec = NULL;
+  if (sqlite3_value_type(argv[0]) == SQLITE_BLOB) {
+    codec = blobcodec::getCodec(sqlite3_value_blob(argv[0]),
+				sqlite3_value_bytes(argv[0]));
+  }
+  if (codec == NULL) {
+    sqlite3_result_null(ctx);
+    return;
+  }
+  sqlite3_result_text(ctx, codec->getName(), -1, SQLITE_STATIC);
+}
+
+int registerCodecFuncs(sqlite3 *db, char **pzErrMsg) {
+  struct {
+    char const *name;
+    int nArgs;
+    void (*func)(sqlite3_context *ctx, int argc, sqlite3_value *argv[]);
+  } const funcs[] = {
+    { "blob_decode", 1, blob_decode },
+    { "blob_encode", 2, blob_encode },
+    { "blob_encode", 3, blob_encode },
+    { "blob_codec", 1, blob_codec }
+  };
+  for (size_t i = 0; i < sizeof(funcs) / sizeof(funcs[0]); i++) {
+    int result =
+      sqlite3_create_function_v2(db, funcs[i].name, funcs[i].nArgs,
+				 SQLITE_ANY, NULL,
+				 funcs[i].func, NULL, NULL,
+				 NULL);
+    if (result != SQLITE_OK) {
+      *pzErrMsg = sqlite3_mprintf("Can't create function(s).");
+      return 1;
+    }
+  }
+  return 0;
+}
+
 };
 
 }
@@ -332,6 +462,13 @@ sqlite3_extension_init(sqlite3 *db,
     }
   }
 
+  {
+    int result = registerCodecFuncs(db, pzErrMsg);
+    if (result != 0) {
+      return result;
+    }
+  }
+
   return 0;
 }
 
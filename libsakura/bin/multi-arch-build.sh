@@ -36,7 +36,8 @@ suffix_map () {
 	return 0
 }
 
-archs="SSE4 AVX AVX2"
+# SIMD_ARCHS=DISPATCH builds one library for all of them
+archs="${SIMD_ARCHS:-SSE4 AVX AVX2}"
 
 for_each_arch () {
 	for arch in $archs; do
@@ -4,6 +4,8 @@
 #FFTW3_INCLUDE_DIRS where is include file
 #FFTW3_LIBRARIES where is library
 #FFTW3_DEFINITIONS other options
+#FFTW3F_FOUND this will be set to TRUE when the single precision library fftw3f was found.
+#  It is optional. FFTW3_LIBRARIES contains it only when it was found.
 
 message(STATUS "FFTW3_ROOT_DIR=${FFTW3_ROOT_DIR}")
 
@@ -16,7 +18,7 @@ find_path(FFTW3_INCLUDE_DIR fftw3.h)
 message(STATUS "FFTW3_INCLUDE_DIR=${FFTW3_INCLUDE_DIR}")
 # support for multiple fftw3 libraries
 # set multiple library names to _components, e.g., set(_components fftw3f fftw3)
-set(_components fftw3)
+set(_components fftw3f fftw3)
 foreach(_comp ${_components})
 	find_library(${_comp}_LIBRARY ${_comp}
 		PATHS ${FFTW3_ROOT_DIR} 
@@ -28,10 +30,18 @@ foreach(_comp ${_components})
 	endif(${_comp}_LIBRARY)
 endforeach(_comp ${_components})
 
+if(fftw3f_LIBRARY)
+	set(FFTW3F_FOUND TRUE)
+else(fftw3f_LIBRARY)
+	set(FFTW3F_FOUND FALSE)
+	message(STATUS "fftw3f is not found. Single precision FFT is not available.")
+endif(fftw3f_LIBRARY)
+
 #to use FindPackageHandleStandardArgs function 
 include(FindPackageHandleStandardArgs)
 # if it was succeeded, FFTW3_FOUND will be set to TRUE.
-find_package_handle_standard_args(FFTW3 DEFAULT_MSG FFTW3_LIBRARIES FFTW3_INCLUDE_DIR)
+# only the double precision library fftw3 is required.
+find_package_handle_standard_args(FFTW3 DEFAULT_MSG FFTW3_LIBRARIES fftw3_LIBRARY FFTW3_INCLUDE_DIR)
 
 #to store cache
 mark_as_advanced(FFTW3_INCLUDE_DIR FFTW3_LIBRARIES)
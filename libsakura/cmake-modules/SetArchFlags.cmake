@@ -2,12 +2,14 @@ set(NativeArch "")
 set(DefaultArch "")
 set(SandyBridgeArch "")
 set(HaswellArch "")
+set(SkylakeAvx512Arch "")
 
 if("${CMAKE_CXX_COMPILER_ID}" STREQUAL "Clang")
 	set(NativeArch "-march=native")
 	set(DefaultArch "-mtune=generic")
 	set(SandyBridgeArch "-march=corei7-avx")
 	set(HaswellArch "-march=core-avx2 -mfma") # -ffast-math is required to enable FMA
+	set(SkylakeAvx512Arch "-march=skylake-avx512")
 elseif("${CMAKE_CXX_COMPILER_ID}" STREQUAL "GNU")
 	set(NativeArch "-march=native")
 	set(DefaultArch "-mtune=generic")
@@ -18,11 +20,15 @@ elseif("${CMAKE_CXX_COMPILER_ID}" STREQUAL "GNU")
 		set(SandyBridgeArch "-march=sandybridge")
 		set(HaswellArch "-march=haswell")
 	endif(CMAKE_CXX_COMPILER_VERSION VERSION_LESS "4.9")
+	if(NOT CMAKE_CXX_COMPILER_VERSION VERSION_LESS "6.1")
+		set(SkylakeAvx512Arch "-march=skylake-avx512")
+	endif(NOT CMAKE_CXX_COMPILER_VERSION VERSION_LESS "6.1")
 elseif("${CMAKE_CXX_COMPILER_ID}" STREQUAL "Intel")
 	set(NativeArch "-march=native")
 	set(DefaultArch "-mkl=sequential -xSSE4.2")
 	set(SandyBridgeArch "-mkl=sequential -xAVX ")
 	set(HaswellArch "-mkl=sequential -xCORE-AVX2 -mtune=core-avx2")
+	set(SkylakeAvx512Arch "-mkl=sequential -xCORE-AVX512")
 elseif("${CMAKE_CXX_COMPILER_ID}" STREQUAL "MSVC")
 	# using Visual Studio C++
 	# not supported yet
@@ -32,6 +38,9 @@ macro(set_cxx_flags_from_arch SIMD_ARCH)
 	if("${SIMD_ARCH}" STREQUAL "NATIVE")
 		set(CMAKE_CXX_FLAGS "${CMAKE_CXX_FLAGS} ${NativeArch}")
 		set(CMAKE_C_FLAGS "${CMAKE_C_FLAGS} ${NativeArch}")
+	elseif("${SIMD_ARCH}" STREQUAL "AVX512")
+		set(CMAKE_CXX_FLAGS "${CMAKE_CXX_FLAGS} ${SkylakeAvx512Arch}")
+		set(CMAKE_C_FLAGS "${CMAKE_C_FLAGS} ${SkylakeAvx512Arch}")
 	elseif("${SIMD_ARCH}" STREQUAL "AVX2")
 		set(CMAKE_CXX_FLAGS "${CMAKE_CXX_FLAGS} ${HaswellArch}")
 		set(CMAKE_C_FLAGS "${CMAKE_C_FLAGS} ${HaswellArch}")
@@ -41,5 +50,15 @@ macro(set_cxx_flags_from_arch SIMD_ARCH)
 	elseif("${SIMD_ARCH}" STREQUAL "SSE4")
 		set(CMAKE_CXX_FLAGS "${CMAKE_CXX_FLAGS} ${DefaultArch}")
 		set(CMAKE_C_FLAGS "${CMAKE_C_FLAGS} ${DefaultArch}")
+	elseif("${SIMD_ARCH}" STREQUAL "DISPATCH")
+		# ISA specific modules are additionally compiled with
+		# ${DefaultArch}, ${SandyBridgeArch}, ${HaswellArch} and
+		# ${SkylakeAvx512Arch} if the compiler supports it
+		set(DispatchFlags "${DefaultArch} -DARCH_DISPATCH=1")
+		if(SkylakeAvx512Arch)
+			set(DispatchFlags "${DispatchFlags} -DARCH_DISPATCH_AVX512=1")
+		endif(SkylakeAvx512Arch)
+		set(CMAKE_CXX_FLAGS "${CMAKE_CXX_FLAGS} ${DispatchFlags}")
+		set(CMAKE_C_FLAGS "${CMAKE_C_FLAGS} ${DispatchFlags}")
 	endif("${SIMD_ARCH}" STREQUAL "NATIVE")
 endmacro(set_cxx_flags_from_arch)
@@ -0,0 +1,393 @@
+/*
+ * @SAKURA_LICENSE_HEADER_START@
+ * Copyright (C) 2013-2022
+ * Inter-University Research Institute Corporation, National Institutes of Natural Sciences
+ * 2-21-1, Osawa, Mitaka, Tokyo, 181-8588, Japan.
+ * 
+ * This file is part of Sakura.
+ * 
+ * Sakura is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or (at your
+ * option) any later version.
+ * 
+ * Sakura is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public
+ * License for more details.
+ * 
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Sakura.  If not, see <http://www.gnu.org/licenses/>.
+ * @SAKURA_LICENSE_HEADER_END@
+ */
+/*
+ * Run-time selection of the ISA specific variants of the API functions.
+ *
+ * With SIMD_ARCH=DISPATCH, the modules having ISA specific kernels are
+ * compiled once per ISA (Default, SandyBridge, Haswell and, if the
+ * compiler supports it, SkylakeAvx512, see SetArchFlags.cmake) and their API functions are exported with
+ * ARCH_SUFFIX appended (see LIBSAKURA_ARCH_SYMBOL in localdef.h).
+ * This file defines the unsuffixed API functions which forward to
+ * the variant selected by SelectArch() at Initialize.
+ */
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+
+#include "libsakura/sakura.h"
+#include "libsakura/localdef.h"
+#include "libsakura/logger.h"
+#include "libsakura/arch_dispatch.h"
+
+#if !defined(ARCH_DISPATCH)
+#error "arch_dispatch.cc must be compiled with ARCH_DISPATCH"
+#endif
+
+/*
+ * Not declared in sakura.h but exported by statistics.cc.
+ */
+extern "C" LIBSAKURA_SYMBOL(Status) LIBSAKURA_SYMBOL(ComputeStddevFloat)(
+		size_t degree_of_freedom, double mean, size_t num_data,
+		float const data[], bool const is_valid[], double *result) noexcept;
+
+/*
+ * X(name, parameters, arguments) for each API function to be dispatched.
+ */
+#define LIBSAKURA_DISPATCHED_FUNCTIONS(X) \
+	X(ComputeStatisticsFloat, (size_t num_data, float const data[], bool \
+		const is_valid[], LIBSAKURA_SYMBOL(StatisticsResultFloat) *result), \
+		(num_data, data, is_valid, result)) \
+	X(ComputeAccurateStatisticsFloat, (size_t num_data, float const data[], \
+		bool const is_valid[], LIBSAKURA_SYMBOL(StatisticsResultFloat) *result), \
+		(num_data, data, is_valid, result)) \
+	X(ComputeAccurateStatisticsParallelFloat, (size_t num_data, float const \
+		data[], bool const is_valid[], size_t num_threads, \
+		LIBSAKURA_SYMBOL(StatisticsResultFloat) *result), (num_data, data, \
+		is_valid, num_threads, result)) \
+	X(ComputeStatisticsBatchFloat, (size_t num_rows, size_t num_data, \
+		float const data[], bool const is_valid[], size_t num_threads, \
+		LIBSAKURA_SYMBOL(StatisticsResultFloat) result[]), \
+		(num_rows, num_data, data, is_valid, num_threads, result)) \
+	X(InitializeStatisticsAccumulatorFloat, \
+		(LIBSAKURA_SYMBOL(StatisticsAccumulatorFloat) *accumulator), \
+		(accumulator)) \
+	X(UpdateStatisticsAccumulatorFloat, (size_t num_data, float const data[], \
+		bool const is_valid[], \
+		LIBSAKURA_SYMBOL(StatisticsAccumulatorFloat) *accumulator), \
+		(num_data, data, is_valid, accumulator)) \
+	X(MergeStatisticsAccumulatorFloat, \
+		(LIBSAKURA_SYMBOL(StatisticsAccumulatorFloat) const *increment, \
+		LIBSAKURA_SYMBOL(StatisticsAccumulatorFloat) *accumulator), \
+		(increment, accumulator)) \
+	X(FinalizeStatisticsAccumulatorFloat, \
+		(LIBSAKURA_SYMBOL(StatisticsAccumulatorFloat) const *accumulator, \
+		LIBSAKURA_SYMBOL(StatisticsResultFloat) *result), \
+		(accumulator, result)) \
+	X(ComputeStddevFloat, (size_t degree_of_freedom, double mean, size_t \
+		num_data, float const data[], bool const is_valid[], double *result), \
+		(degree_of_freedom, mean, num_data, data, is_valid, result)) \
+	X(ComputeMeanAndStddevFloat, (size_t num_data, float const data[], \
+		bool const is_valid[], size_t delta_degree_of_freedom, double *mean, \
+		double *stddev), (num_data, data, is_valid, delta_degree_of_freedom, \
+		mean, stddev)) \
+	X(SortValidValuesDenselyFloat, (size_t num_data, bool const is_valid[], \
+		float data[], size_t *new_num_data), (num_data, is_valid, data, \
+		new_num_data)) \
+	X(ComputeMedianAbsoluteDeviationFloat, (size_t num_data, float const \
+		data[], float new_data[]), (num_data, data, new_data)) \
+	X(ComputeQuantilesFloat, (size_t num_data, bool const is_valid[], \
+		float data[], size_t num_probabilities, double const probability[], \
+		float quantile[], size_t *new_num_data), (num_data, is_valid, data, \
+		num_probabilities, probability, quantile, new_num_data)) \
+	X(ComputeMedianFloat, (size_t num_data, bool const is_valid[], \
+		float data[], float *median, size_t *new_num_data), (num_data, \
+		is_valid, data, median, new_num_data)) \
+	X(ComputeMedianAndMedianAbsoluteDeviationFloat, (size_t num_data, \
+		bool const is_valid[], float data[], float *median, float *mad, \
+		size_t *new_num_data), (num_data, is_valid, data, median, mad, \
+		new_num_data)) \
+	X(GridConvolvingFloat, (size_t num_spectra, size_t start_spectrum, \
+		size_t end_spectrum, bool const spectrum_mask[], double const x[], \
+		double const y[], size_t support, size_t sampling, size_t \
+		num_polarizations, uint32_t const polarization_map[], size_t \
+		num_channels, uint32_t const channel_map[], bool const mask[], float \
+		const value[], float const weight[], bool weight_only, size_t \
+		num_convolution_table, float const convolution_table[], size_t \
+		num_polarizations_for_grid, size_t num_channels_for_grid, size_t width, \
+		size_t height, double weight_sum[], float weight_of_grid[], float \
+		grid[]), (num_spectra, start_spectrum, end_spectrum, spectrum_mask, x, \
+		y, support, sampling, num_polarizations, polarization_map, num_channels, \
+		channel_map, mask, value, weight, weight_only, num_convolution_table, \
+		convolution_table, num_polarizations_for_grid, num_channels_for_grid, \
+		width, height, weight_sum, weight_of_grid, grid)) \
+	X(GridConvolvingParallelFloat, (size_t num_spectra, size_t \
+		start_spectrum, size_t end_spectrum, bool const spectrum_mask[], double \
+		const x[], double const y[], size_t support, size_t sampling, size_t \
+		num_polarizations, uint32_t const polarization_map[], size_t \
+		num_channels, uint32_t const channel_map[], bool const mask[], float \
+		const value[], float const weight[], bool weight_only, size_t \
+		num_convolution_table, float const convolution_table[], size_t \
+		num_polarizations_for_grid, size_t num_channels_for_grid, size_t width, \
+		size_t height, size_t num_threads, double weight_sum[], float \
+		weight_of_grid[], float grid[]), (num_spectra, start_spectrum, \
+		end_spectrum, spectrum_mask, x, y, support, sampling, num_polarizations, \
+		polarization_map, num_channels, channel_map, mask, value, weight, \
+		weight_only, num_convolution_table, convolution_table, \
+		num_polarizations_for_grid, num_channels_for_grid, width, height, \
+		num_threads, weight_sum, weight_of_grid, grid)) \
+	X(SetTrueIfInRangesInclusiveFloat, (size_t num_data, float const data[], \
+		size_t num_condition, float const lower_bounds[], float const \
+		upper_bounds[], bool result[]), (num_data, data, num_condition, \
+		lower_bounds, upper_bounds, result)) \
+	X(SetTrueIfInRangesInclusiveInt, (size_t num_data, int const data[], \
+		size_t num_condition, int const lower_bounds[], int const \
+		upper_bounds[], bool result[]), (num_data, data, num_condition, \
+		lower_bounds, upper_bounds, result)) \
+	X(SetTrueIfInRangesExclusiveFloat, (size_t num_data, float const data[], \
+		size_t num_condition, float const lower_bounds[], float const \
+		upper_bounds[], bool result[]), (num_data, data, num_condition, \
+		lower_bounds, upper_bounds, result)) \
+	X(SetTrueIfInRangesExclusiveInt, (size_t num_data, int const data[], \
+		size_t num_condition, int const lower_bounds[], int const \
+		upper_bounds[], bool result[]), (num_data, data, num_condition, \
+		lower_bounds, upper_bounds, result)) \
+	X(SetTrueIfGreaterThanFloat, (size_t num_data, float const data[], float \
+		threshold, bool result[]), (num_data, data, threshold, result)) \
+	X(SetTrueIfGreaterThanInt, (size_t num_data, int const data[], int \
+		threshold, bool result[]), (num_data, data, threshold, result)) \
+	X(SetTrueIfGreaterThanOrEqualsFloat, (size_t num_data, float const \
+		data[], float threshold, bool result[]), (num_data, data, threshold, \
+		result)) \
+	X(SetTrueIfGreaterThanOrEqualsInt, (size_t num_data, int const data[], \
+		int threshold, bool result[]), (num_data, data, threshold, result)) \
+	X(SetTrueIfLessThanFloat, (size_t num_data, float const data[], float \
+		threshold, bool result[]), (num_data, data, threshold, result)) \
+	X(SetTrueIfLessThanInt, (size_t num_data, int const data[], int \
+		threshold, bool result[]), (num_data, data, threshold, result)) \
+	X(SetTrueIfLessThanOrEqualsFloat, (size_t num_data, float const data[], \
+		float threshold, bool result[]), (num_data, data, threshold, result)) \
+	X(SetTrueIfLessThanOrEqualsInt, (size_t num_data, int const data[], int \
+		threshold, bool result[]), (num_data, data, threshold, result)) \
+	X(SetFalseIfNanOrInfFloat, (size_t num_data, float const data[], bool \
+		result[]), (num_data, data, result)) \
+	X(Uint8ToBool, (size_t num_data, uint8_t const data[], bool result[]), \
+		(num_data, data, result)) \
+	X(Uint32ToBool, (size_t num_data, uint32_t const data[], bool result[]), \
+		(num_data, data, result)) \
+	X(InvertBool, (size_t num_data, bool const data[], bool result[]), \
+		(num_data, data, result)) \
+	X(CalibrateDataWithArrayScalingFloat, (size_t num_data, float const \
+		scaling_factor[], float const data[], float const reference[], float \
+		result[]), (num_data, scaling_factor, data, reference, result)) \
+	X(CalibrateDataWithConstScalingFloat, (float scaling_factor, size_t \
+		num_data, float const data[], float const reference[], float result[]), \
+		(scaling_factor, num_data, data, reference, result)) \
+	X(CreateLSQFitContextPolynomialFloat, (LIBSAKURA_SYMBOL(LSQFitType) \
+		const lsqfit_type, uint16_t order, size_t num_data, struct \
+		LIBSAKURA_SYMBOL(LSQFitContextFloat) **context), (lsqfit_type, order, \
+		num_data, context)) \
+	X(CreateLSQFitContextCubicSplineFloat, (uint16_t npiece, size_t \
+		num_data, struct LIBSAKURA_SYMBOL(LSQFitContextFloat) **context), \
+		(npiece, num_data, context)) \
+	X(CreateLSQFitContextSinusoidFloat, (uint16_t nwave, size_t num_data, \
+		struct LIBSAKURA_SYMBOL(LSQFitContextFloat) **context), (nwave, \
+		num_data, context)) \
+	X(DestroyLSQFitContextFloat, (struct \
+		LIBSAKURA_SYMBOL(LSQFitContextFloat) *context), (context)) \
+	X(GetNumberOfCoefficientsFloat, (struct \
+		LIBSAKURA_SYMBOL(LSQFitContextFloat) const *context, uint16_t order, \
+		size_t *num_coeff), (context, order, num_coeff)) \
+	X(LSQFitPolynomialFloat, (struct LIBSAKURA_SYMBOL(LSQFitContextFloat) \
+		const *context, uint16_t order, size_t num_data, float const data[], \
+		bool const mask[], float clip_threshold_sigma, uint16_t num_fitting_max, \
+		size_t num_coeff, double coeff[], float best_fit[], float residual[], \
+		bool final_mask[], float *rms, LIBSAKURA_SYMBOL(LSQFitStatus) \
+		*lsqfit_status), (context, order, num_data, data, mask, \
+		clip_threshold_sigma, num_fitting_max, num_coeff, coeff, best_fit, \
+		residual, final_mask, rms, lsqfit_status)) \
+	X(LSQFitPolynomialBatchFloat, (struct LIBSAKURA_SYMBOL(LSQFitContextFloat) \
+		const *context, uint16_t order, size_t num_spectra, size_t num_data, \
+		float const data[], bool const mask[], size_t num_coeff, double coeff[], \
+		float best_fit[], float residual[], float rms[], size_t num_threads, \
+		LIBSAKURA_SYMBOL(LSQFitStatus) lsqfit_status[]), (context, order, \
+		num_spectra, num_data, data, mask, num_coeff, coeff, best_fit, \
+		residual, rms, num_threads, lsqfit_status)) \
+	X(LSQFitCubicSplineFloat, (struct LIBSAKURA_SYMBOL(LSQFitContextFloat) \
+		const *context, size_t num_pieces, size_t num_data, float const data[], \
+		bool const mask[], float clip_threshold_sigma, uint16_t num_fitting_max, \
+		double coeff[][4], float best_fit[], float residual[], bool \
+		final_mask[], float *rms, size_t boundary[], \
+		LIBSAKURA_SYMBOL(LSQFitStatus) *lsqfit_status), (context, num_pieces, \
+		num_data, data, mask, clip_threshold_sigma, num_fitting_max, coeff, \
+		best_fit, residual, final_mask, rms, boundary, lsqfit_status)) \
+	X(LSQFitSinusoidFloat, (struct LIBSAKURA_SYMBOL(LSQFitContextFloat) \
+		const *context, size_t num_nwave, size_t const nwave[], size_t num_data, \
+		float const data[], bool const mask[], float clip_threshold_sigma, \
+		uint16_t num_fitting_max, size_t num_coeff, double coeff[], float \
+		best_fit[], float residual[], bool final_mask[], float *rms, \
+		LIBSAKURA_SYMBOL(LSQFitStatus) *lsqfit_status), (context, num_nwave, \
+		nwave, num_data, data, mask, clip_threshold_sigma, num_fitting_max, \
+		num_coeff, coeff, best_fit, residual, final_mask, rms, lsqfit_status)) \
+	X(SubtractPolynomialFloat, (struct LIBSAKURA_SYMBOL(LSQFitContextFloat) \
+		const *context, size_t num_data, float const data[], size_t num_coeff, \
+		double const coeff[], float out[]), (context, num_data, data, num_coeff, \
+		coeff, out)) \
+	X(SubtractCubicSplineFloat, (struct LIBSAKURA_SYMBOL(LSQFitContextFloat) \
+		const *context, size_t num_data, float const data[], size_t num_pieces, \
+		double const coeff[][4], size_t const boundary[], float out[]), \
+		(context, num_data, data, num_pieces, coeff, boundary, out)) \
+	X(SubtractSinusoidFloat, (struct LIBSAKURA_SYMBOL(LSQFitContextFloat) \
+		const *context, size_t num_data, float const data[], size_t num_nwave, \
+		size_t const nwave[], size_t num_coeff, double const coeff[], float \
+		out[]), (context, num_data, data, num_nwave, nwave, num_coeff, coeff, \
+		out)) \
+	X(CreateGaussianKernelFloat, (float peak_location, float kernel_width, \
+		size_t num_kernel, float kernel[]), (peak_location, kernel_width, \
+		num_kernel, kernel)) \
+	X(CreateConvolve1DContextFFTFloat, (size_t num_kernel, float const \
+		kernel[], struct LIBSAKURA_SYMBOL(Convolve1DContextFloat) **context), \
+		(num_kernel, kernel, context)) \
+	X(CreateConvolve1DContextFFTBatchFloat, (size_t num_kernel, float const \
+		kernel[], size_t num_batch, LIBSAKURA_SYMBOL(FFTPrecision) precision, \
+		struct LIBSAKURA_SYMBOL(Convolve1DContextFloat) **context), \
+		(num_kernel, kernel, num_batch, precision, context)) \
+	X(Convolve1DFloat, (size_t num_kernel, float const kernel[], size_t \
+		num_data, float const input_data[], bool const input_mask[], float \
+		output_data[], float output_weight[]), (num_kernel, kernel, num_data, \
+		input_data, input_mask, output_data, output_weight)) \
+	X(Convolve1DFFTFloat, (struct LIBSAKURA_SYMBOL(Convolve1DContextFloat) \
+		const *context, size_t num_data, float const input_data[], float \
+		output_data[]), (context, num_data, input_data, output_data)) \
+	X(Convolve1DFFTBatchFloat, (struct \
+		LIBSAKURA_SYMBOL(Convolve1DContextFloat) const *context, size_t \
+		num_spectra, size_t num_data, float const input_data[], float \
+		output_data[]), (context, num_spectra, num_data, input_data, \
+		output_data)) \
+	X(DestroyConvolve1DContextFloat, (struct \
+		LIBSAKURA_SYMBOL(Convolve1DContextFloat) *context), (context))
+
+#define DECLARE_VARIANTS(name, params, args) \
+	extern "C" decltype(LIBSAKURA_SYMBOL(name)) \
+		ADDSUFFIX(LIBSAKURA_SYMBOL(name), Default), \
+		ADDSUFFIX(LIBSAKURA_SYMBOL(name), SandyBridge), \
+		ADDSUFFIX(LIBSAKURA_SYMBOL(name), Haswell);
+LIBSAKURA_DISPATCHED_FUNCTIONS(DECLARE_VARIANTS)
+#undef DECLARE_VARIANTS
+#if defined(ARCH_DISPATCH_AVX512)
+#define DECLARE_AVX512_VARIANT(name, params, args) \
+	extern "C" decltype(LIBSAKURA_SYMBOL(name)) \
+		ADDSUFFIX(LIBSAKURA_SYMBOL(name), SkylakeAvx512);
+LIBSAKURA_DISPATCHED_FUNCTIONS(DECLARE_AVX512_VARIANT)
+#undef DECLARE_AVX512_VARIANT
+#endif
+
+namespace {
+
+auto logger = LIBSAKURA_PREFIX::Logger::GetLogger("arch_dispatch");
+
+struct DispatchTable {
+	char const *name;
+#define DECLARE_ENTRY(name, params, args) \
+	decltype(&LIBSAKURA_SYMBOL(name)) name;
+	LIBSAKURA_DISPATCHED_FUNCTIONS(DECLARE_ENTRY)
+#undef DECLARE_ENTRY
+};
+
+#define DEFAULT_ENTRY(name, params, args) \
+	ADDSUFFIX(LIBSAKURA_SYMBOL(name), Default),
+#define SANDY_BRIDGE_ENTRY(name, params, args) \
+	ADDSUFFIX(LIBSAKURA_SYMBOL(name), SandyBridge),
+#define HASWELL_ENTRY(name, params, args) \
+	ADDSUFFIX(LIBSAKURA_SYMBOL(name), Haswell),
+#define SKYLAKE_AVX512_ENTRY(name, params, args) \
+	ADDSUFFIX(LIBSAKURA_SYMBOL(name), SkylakeAvx512),
+
+/*
+ * Ordered from the most conservative one.
+ */
+DispatchTable const kDispatchTables[] = {
+		{ "Default", LIBSAKURA_DISPATCHED_FUNCTIONS(DEFAULT_ENTRY) },
+		{ "SandyBridge", LIBSAKURA_DISPATCHED_FUNCTIONS(SANDY_BRIDGE_ENTRY) },
+		{ "Haswell", LIBSAKURA_DISPATCHED_FUNCTIONS(HASWELL_ENTRY) },
+#if defined(ARCH_DISPATCH_AVX512)
+		{ "SkylakeAvx512", LIBSAKURA_DISPATCHED_FUNCTIONS(SKYLAKE_AVX512_ENTRY) },
+#endif
+		};
+
+#undef DEFAULT_ENTRY
+#undef SANDY_BRIDGE_ENTRY
+#undef HASWELL_ENTRY
+#undef SKYLAKE_AVX512_ENTRY
+
+/*
+ * The most conservative variant is used until Initialize is called.
+ */
+DispatchTable const *dispatch_table = &kDispatchTables[0];
+
+/*
+ * Returns the index in kDispatchTables of the most capable variant
+ * runnable on this CPU.
+ */
+size_t DetectArch() {
+	size_t arch = 0;
+#if defined(__GNUC__)
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("avx") && __builtin_cpu_supports("popcnt")
+			&& __builtin_cpu_supports("sse4.2")) {
+		arch = 1;
+		if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")
+				&& __builtin_cpu_supports("bmi")
+				&& __builtin_cpu_supports("bmi2")) {
+			arch = 2;
+		}
+	}
+	if (arch == 2 && __builtin_cpu_supports("avx512f")
+			&& __builtin_cpu_supports("avx512bw")
+			&& __builtin_cpu_supports("avx512vl")
+			&& __builtin_cpu_supports("avx512dq")) {
+		arch = 3;
+	}
+#endif
+	return std::min(arch, ELEMENTSOF(kDispatchTables) - 1);
+}
+
+} /* namespace */
+
+namespace LIBSAKURA_PREFIX {
+
+void SelectArch() noexcept {
+	size_t arch = DetectArch();
+	LOG4CXX_INFO(logger,
+			"CPU supports " << kDispatchTables[arch].name << " variant");
+	// SAKURA_ARCH environment variable can lower the variant for testing
+	char const *requested = std::getenv("SAKURA_ARCH");
+	if (requested != nullptr && *requested != '\0') {
+		size_t i = 0;
+		while (i < ELEMENTSOF(kDispatchTables)
+				&& std::strcmp(requested, kDispatchTables[i].name) != 0) {
+			++i;
+		}
+		if (i < ELEMENTSOF(kDispatchTables) && i <= arch) {
+			arch = i;
+		} else {
+			LOG4CXX_WARN(logger,
+					"SAKURA_ARCH=" << requested << " is ignored since it is unknown or not supported by CPU");
+		}
+	}
+	dispatch_table = &kDispatchTables[arch];
+	LOG4CXX_INFO(logger, "Selected " << dispatch_table->name << " variant");
+}
+
+char const *GetSelectedArchName() noexcept {
+	return dispatch_table->name;
+}
+
+} /* namespace LIBSAKURA_PREFIX */
+
+#define DEFINE_TRAMPOLINE(name, params, args) \
+	extern "C" LIBSAKURA_SYMBOL(Status) LIBSAKURA_SYMBOL(name) params noexcept { \
+		return dispatch_table->name args; \
+	}
+LIBSAKURA_DISPATCHED_FUNCTIONS(DEFINE_TRAMPOLINE)
+#undef DEFINE_TRAMPOLINE
@@ -28,21 +28,38 @@
  */
 
 #include <algorithm>
+#include <atomic>
 #include <cassert>
 #include <climits>
 #include <cmath>
 #include <cstddef>
+#include <cstring>
 #include <memory>
 #include <sstream>
 #include <stdexcept>
+#include <thread>
+
+/*
+ * GCC 12 warns about the undefined upper half left by the casts in
+ * avx512fintrin.h when Eigen packs matrices for products, which is
+ * never used, and about unused variables in Eigen's bfloat16 packets.
+ */
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wunused-variable"
+#pragma GCC diagnostic ignored "-Wuninitialized"
+#pragma GCC diagnostic ignored "-Wmaybe-uninitialized"
+#include <Eigen/Core>
+#pragma GCC diagnostic pop
 
 #if defined(__AVX__) && !defined(ARCH_SCALAR)
 #	include <immintrin.h>
 #endif
 
+#include "libsakura/concurrent.h"
 #include "libsakura/localdef.h"
 #include "libsakura/logger.h"
 #include "libsakura/memory_manager.h"
+#include "libsakura/profiler.h"
 namespace {
 #include "libsakura/packed_operation.h"
 }
@@ -1500,6 +1517,336 @@ inline void SubtractCubicSpline(V const *context, size_t num_data,
 			num_boundary, boundary, coeff_apply, context->best_fit_model, out);
 }
 
+/**
+ * The number of spectra a thread takes at a time in LSQFitBatch().
+ */
+constexpr size_t kNumSpectraPerBatchBlock = 64;
+
+typedef ::Eigen::Matrix<double, ::Eigen::Dynamic, ::Eigen::Dynamic,
+		::Eigen::RowMajor> RowMajorMatrixXd;
+
+/**
+ * Per-thread work space of LSQFitBatch().
+ *
+ * It holds the Cholesky decomposition of the normal matrix for the
+ * last mask seen, so that the decomposition is reused for the
+ * following spectra which have an identical mask. The arrays are
+ * allocated by AllocateLSQFitBatchWorkSpaces().
+ */
+struct LSQFitBatchWorkSpace {
+	bool const *mask; /**< The mask @a cholesky is computed for, or nullptr. */
+	bool enough_data; /**< false if @a mask has too few unmasked data. */
+	size_t num_unmasked; /**< The number of unmasked data. */
+	size_t *unmasked_indices; /**< Indices of unmasked data. [num_data] */
+	double *unmasked_bases; /**< Bases at unmasked data. [num_unmasked][num_coeff] */
+	double *cholesky; /**< Lower triangle L of the normal matrix = L L^T. [num_coeff][num_coeff] */
+	double *unmasked_data; /**< Input data at unmasked data. [num_unmasked][kNumSpectraPerBatchBlock] */
+	double *coeff; /**< Coefficients. [num_coeff][kNumSpectraPerBatchBlock] */
+	double *model; /**< Best-fit model. [num_data][kNumSpectraPerBatchBlock] */
+};
+
+/**
+ * Returns @a size rounded up to a multiple of LIBSAKURA_ALIGNMENT .
+ */
+inline size_t AlignedSize(size_t size) {
+	return (size + LIBSAKURA_ALIGNMENT - 1) / LIBSAKURA_ALIGNMENT
+			* LIBSAKURA_ALIGNMENT;
+}
+
+/**
+ * Returns @a num_elements elements of type T at @a *cursor and advances
+ * @a *cursor keeping it aligned.
+ */
+template<typename T>
+inline T *TakeArray(size_t num_elements, char **cursor) {
+	T *array = reinterpret_cast<T *>(*cursor);
+	*cursor += AlignedSize(sizeof(T) * num_elements);
+	return array;
+}
+
+/**
+ * Returns the size of the arrays of a work space of LSQFitBatch().
+ * It must agree with TakeLSQFitBatchWorkSpace().
+ */
+inline size_t GetLSQFitBatchWorkSpaceSize(size_t num_data, size_t num_coeff) {
+	return AlignedSize(sizeof(size_t) * num_data)
+			+ AlignedSize(sizeof(double) * num_data * num_coeff)
+			+ AlignedSize(sizeof(double) * num_coeff * num_coeff)
+			+ AlignedSize(sizeof(double) * num_data * kNumSpectraPerBatchBlock)
+			+ AlignedSize(sizeof(double) * num_coeff * kNumSpectraPerBatchBlock)
+			+ AlignedSize(sizeof(double) * num_data * kNumSpectraPerBatchBlock);
+}
+
+/**
+ * Initializes @a work_space and takes its arrays from @a *cursor .
+ */
+inline void TakeLSQFitBatchWorkSpace(size_t num_data, size_t num_coeff,
+		char **cursor, LSQFitBatchWorkSpace *work_space) {
+	work_space->mask = nullptr;
+	work_space->enough_data = false;
+	work_space->num_unmasked = 0;
+	work_space->unmasked_indices = TakeArray<size_t>(num_data, cursor);
+	work_space->unmasked_bases = TakeArray<double>(num_data * num_coeff,
+			cursor);
+	work_space->cholesky = TakeArray<double>(num_coeff * num_coeff, cursor);
+	work_space->unmasked_data = TakeArray<double>(
+			num_data * kNumSpectraPerBatchBlock, cursor);
+	work_space->coeff = TakeArray<double>(num_coeff * kNumSpectraPerBatchBlock,
+			cursor);
+	work_space->model = TakeArray<double>(num_data * kNumSpectraPerBatchBlock,
+			cursor);
+}
+
+/**
+ * Allocates @a num_work_spaces work spaces of LSQFitBatch() by Memory
+ * and returns the storage to be freed.
+ */
+inline void *AllocateLSQFitBatchWorkSpaces(size_t num_data, size_t num_coeff,
+		size_t num_work_spaces, LSQFitBatchWorkSpace **work_spaces) {
+	size_t const size_of_structs = AlignedSize(
+			sizeof(LSQFitBatchWorkSpace) * num_work_spaces);
+	size_t const size_of_arrays = GetLSQFitBatchWorkSpaceSize(num_data,
+			num_coeff);
+	if (size_of_arrays > (SIZE_MAX - size_of_structs) / num_work_spaces) {
+		throw std::bad_alloc();
+	}
+	char *cursor = nullptr;
+	void *storage = LIBSAKURA_PREFIX::Memory::AlignedAllocateOrException(
+			size_of_structs + size_of_arrays * num_work_spaces, &cursor);
+	*work_spaces = TakeArray<LSQFitBatchWorkSpace>(num_work_spaces, &cursor);
+	for (size_t i = 0; i < num_work_spaces; ++i) {
+		TakeLSQFitBatchWorkSpace(num_data, num_coeff, &cursor,
+				&(*work_spaces)[i]);
+	}
+	return storage;
+}
+
+/**
+ * Compute the normal matrix for @a mask and its Cholesky decomposition.
+ *
+ * @param[in] bases Basis data. Its shape is [num_data][num_coeff].
+ * @param[in] num_data Length of @a mask .
+ * @param[in] mask Input mask.
+ * @param[in,out] work_space Work space to store the result.
+ */
+template<typename Bases>
+inline void FactorizeLSQMatrix(Bases const &bases, size_t num_data,
+		bool const *mask, LSQFitBatchWorkSpace *work_space) {
+	size_t *indices = work_space->unmasked_indices;
+	size_t num_unmasked = 0;
+	for (size_t i = 0; i < num_data; ++i) {
+		if (mask[i]) {
+			indices[num_unmasked++] = i;
+		}
+	}
+	size_t const num_coeff = bases.cols();
+	work_space->mask = mask;
+	work_space->num_unmasked = num_unmasked;
+	work_space->enough_data = (num_coeff <= num_unmasked);
+	if (!work_space->enough_data) {
+		return;
+	}
+	::Eigen::Map<RowMajorMatrixXd> unmasked_bases(work_space->unmasked_bases,
+			num_unmasked, num_coeff);
+	for (size_t k = 0; k < num_unmasked; ++k) {
+		unmasked_bases.row(k) = bases.row(indices[k]);
+	}
+	::Eigen::Map<RowMajorMatrixXd> l(work_space->cholesky, num_coeff,
+			num_coeff);
+	l.noalias() = unmasked_bases.transpose() * unmasked_bases;
+	// The normal matrix is positive definite unless the unmasked bases
+	// are linearly dependent.
+	for (size_t j = 0; j < num_coeff; ++j) {
+		double diagonal = l(j, j);
+		for (size_t k = 0; k < j; ++k) {
+			diagonal -= l(j, k) * l(j, k);
+		}
+		if (!(diagonal > 0.)) {
+			work_space->enough_data = false;
+			return;
+		}
+		l(j, j) = std::sqrt(diagonal);
+		for (size_t i = j + 1; i < num_coeff; ++i) {
+			double element = l(i, j);
+			for (size_t k = 0; k < j; ++k) {
+				element -= l(i, k) * l(j, k);
+			}
+			l(i, j) = element / l(j, j);
+		}
+	}
+}
+
+/**
+ * Fit spectra which have the mask given to the last
+ * FactorizeLSQMatrix() call. All the right-hand sides of
+ * the normal equations are computed and solved at once by
+ * matrix-matrix products.
+ *
+ * @param[in] begin The first spectrum to fit.
+ * @param[in] end The next of the last spectrum to fit.
+ * end - begin <= kNumSpectraPerBatchBlock
+ */
+template<typename Bases>
+inline void LSQFitSameMask(Bases const &bases, LSQFitTypeInternal type,
+		size_t num_data, float const *data, size_t begin, size_t end,
+		double *coeff, float *best_fit, float *residual, float *rms,
+		LSQFitBatchWorkSpace *work_space) {
+	size_t const num_coeff = bases.cols();
+	size_t const num_spectra = end - begin;
+	assert(num_spectra <= kNumSpectraPerBatchBlock);
+	size_t const *indices = work_space->unmasked_indices;
+	size_t const num_unmasked = work_space->num_unmasked;
+	::Eigen::Map<RowMajorMatrixXd> unmasked_data(work_space->unmasked_data,
+			num_unmasked, num_spectra);
+	for (size_t j = 0; j < num_spectra; ++j) {
+		float const *data_j = &data[(begin + j) * num_data];
+		for (size_t k = 0; k < num_unmasked; ++k) {
+			unmasked_data(k, j) = data_j[indices[k]];
+		}
+	}
+	::Eigen::Map<RowMajorMatrixXd const> unmasked_bases(
+			work_space->unmasked_bases, num_unmasked, num_coeff);
+	::Eigen::Map<RowMajorMatrixXd const> l(work_space->cholesky, num_coeff,
+			num_coeff);
+	::Eigen::Map<RowMajorMatrixXd> model_coeff(work_space->coeff, num_coeff,
+			num_spectra);
+	model_coeff.noalias() = unmasked_bases.transpose() * unmasked_data;
+	// solve L L^T x = b for all the spectra at once
+	for (size_t i = 0; i < num_coeff; ++i) {
+		for (size_t k = 0; k < i; ++k) {
+			model_coeff.row(i) -= l(i, k) * model_coeff.row(k);
+		}
+		model_coeff.row(i) /= l(i, i);
+	}
+	for (size_t i = num_coeff; i-- > 0;) {
+		for (size_t k = i + 1; k < num_coeff; ++k) {
+			model_coeff.row(i) -= l(k, i) * model_coeff.row(k);
+		}
+		model_coeff.row(i) /= l(i, i);
+	}
+	::Eigen::Map<RowMajorMatrixXd> model(work_space->model, num_data,
+			num_spectra);
+	model.noalias() = bases * model_coeff;
+
+	bool const *mask = work_space->mask;
+	for (size_t j = 0; j < num_spectra; ++j) {
+		size_t const spectrum = begin + j;
+		float const *data_j = &data[spectrum * num_data];
+		float *best_fit_j =
+				(best_fit != nullptr) ? &best_fit[spectrum * num_data] : nullptr;
+		float *residual_j =
+				(residual != nullptr) ? &residual[spectrum * num_data] : nullptr;
+		double sum = 0.0;
+		double square_sum = 0.0;
+		for (size_t i = 0; i < num_data; ++i) {
+			float const model_i = static_cast<float>(model(i, j));
+			float const diff = data_j[i] - model_i;
+			if (best_fit_j != nullptr) {
+				best_fit_j[i] = model_i;
+			}
+			if (residual_j != nullptr) {
+				residual_j[i] = diff;
+			}
+			if (mask[i]) {
+				sum += diff;
+				square_sum += static_cast<double>(diff) * diff;
+			}
+		}
+		double const mean = sum / num_unmasked;
+		rms[spectrum] = std::sqrt(
+				std::abs(square_sum / num_unmasked - mean * mean));
+		if (coeff != nullptr) {
+			double *coeff_j = &coeff[spectrum * num_coeff];
+			double const max_data_x = static_cast<double>(num_data - 1);
+			double factor = 1.0;
+			for (size_t i = 0; i < num_coeff; ++i) {
+				coeff_j[i] = model_coeff(i, j);
+				if (type == LSQFitTypeInternal_kPolynomial) {
+					coeff_j[i] /= factor;
+					factor *= max_data_x;
+				}
+			}
+		}
+	}
+}
+
+/**
+ * Fit polynomial or Chebyshev polynomial to each of
+ * @a num_spectra spectra. It is called from its C interface
+ * sakura_LSQFitPolynomialBatchFloat().
+ *
+ * Spectra are divided into blocks of kNumSpectraPerBatchBlock
+ * and the blocks are distributed to @a num_threads threads.
+ * The normal matrix is decomposed only when the mask differs
+ * from that of the previous spectrum processed by the thread.
+ *
+ * @return true if all spectra are fitted, or false if some
+ * of them have too few unmasked data.
+ */
+template<typename V>
+inline bool LSQFitBatch(V const *context, uint16_t order, size_t num_spectra,
+		size_t num_data, float const *data, bool const *mask, double *coeff,
+		float *best_fit, float *residual, float *rms, size_t num_threads,
+		LIBSAKURA_SYMBOL(LSQFitStatus) *lsqfit_status) {
+	auto const type = context->lsqfit_type;
+	assert(
+			(type == LSQFitTypeInternal_kPolynomial)||(type == LSQFitTypeInternal_kChebyshev));
+	size_t const num_coeff = DoGetNumberOfCoefficients(type, order, 0,
+			nullptr);
+	::Eigen::Map<RowMajorMatrixXd const> all_bases(context->basis_data,
+			num_data, context->num_bases);
+	auto const bases = all_bases.leftCols(num_coeff);
+
+	size_t const num_blocks = (num_spectra + kNumSpectraPerBatchBlock - 1)
+			/ kNumSpectraPerBatchBlock;
+	if (num_blocks == 0) {
+		return true;
+	}
+	LSQFitBatchWorkSpace *work_spaces = nullptr;
+	std::unique_ptr<void, LIBSAKURA_PREFIX::Memory> storage_for_work_spaces(
+			AllocateLSQFitBatchWorkSpaces(num_data, num_coeff,
+					std::max(size_t(1), std::min(num_threads, num_blocks)),
+					&work_spaces));
+	std::atomic<bool> all_fitted(true);
+	concurrent::ParallelFor(num_threads, num_blocks,
+			[&](size_t worker, size_t block) {
+				auto &work_space = work_spaces[worker];
+				size_t const block_end = std::min(num_spectra,
+						(block + 1) * kNumSpectraPerBatchBlock);
+				size_t begin = block * kNumSpectraPerBatchBlock;
+				while (begin < block_end) {
+					bool const *mask_begin = &mask[begin * num_data];
+					if (work_space.mask == nullptr
+							|| std::memcmp(work_space.mask, mask_begin,
+									sizeof(bool) * num_data) != 0) {
+						FactorizeLSQMatrix(bases, num_data, mask_begin,
+								&work_space);
+					}
+					size_t end = begin + 1;
+					while (end < block_end
+							&& std::memcmp(mask_begin, &mask[end * num_data],
+									sizeof(bool) * num_data) == 0) {
+						++end;
+					}
+					if (work_space.enough_data) {
+						LSQFitSameMask(bases, type, num_data, data, begin, end,
+								coeff, best_fit, residual, rms, &work_space);
+					}
+					auto const status =
+							work_space.enough_data ?
+									LIBSAKURA_SYMBOL(LSQFitStatus_kOK) :
+									LIBSAKURA_SYMBOL(LSQFitStatus_kNotEnoughData);
+					std::fill(&lsqfit_status[begin], &lsqfit_status[end],
+							status);
+					if (!work_space.enough_data) {
+						all_fitted = false;
+					}
+					begin = end;
+				}
+			});
+	return all_fitted;
+}
+
 } /* anonymous namespace */
 
 #define CHECK_ARGS(x) do { \
@@ -1512,7 +1859,7 @@ inline void SubtractCubicSpline(V const *context, size_t num_data,
  * Create a lsqfit context object for float data to fit.
  * It is only for polynomial and Chebyshev polynomial model.
  */
-extern "C" LIBSAKURA_SYMBOL(Status) LIBSAKURA_SYMBOL(CreateLSQFitContextPolynomialFloat)(
+extern "C" LIBSAKURA_SYMBOL(Status) LIBSAKURA_ARCH_SYMBOL(CreateLSQFitContextPolynomialFloat)(
 LIBSAKURA_SYMBOL(LSQFitType) const lsqfit_type, uint16_t order, size_t num_data,
 LIBSAKURA_SYMBOL(LSQFitContextFloat) **context) noexcept {
 	CHECK_ARGS(context != nullptr);
@@ -1552,7 +1899,7 @@ LIBSAKURA_SYMBOL(LSQFitContextFloat) **context) noexcept {
  * Create a lsqfit context object for float data to fit.
  * It is only for cubic spline model.
  */
-extern "C" LIBSAKURA_SYMBOL(Status) LIBSAKURA_SYMBOL(CreateLSQFitContextCubicSplineFloat)(
+extern "C" LIBSAKURA_SYMBOL(Status) LIBSAKURA_ARCH_SYMBOL(CreateLSQFitContextCubicSplineFloat)(
 		uint16_t npiece, size_t num_data,
 		LIBSAKURA_SYMBOL(LSQFitContextFloat) **context) noexcept {
 	CHECK_ARGS(context != nullptr);
@@ -1588,7 +1935,7 @@ extern "C" LIBSAKURA_SYMBOL(Status) LIBSAKURA_SYMBOL(CreateLSQFitContextCubicSpl
  * Create a lsqfit context object for float data to fit.
  * It is only for sinusoidal model.
  */
-extern "C" LIBSAKURA_SYMBOL(Status) LIBSAKURA_SYMBOL(CreateLSQFitContextSinusoidFloat)(
+extern "C" LIBSAKURA_SYMBOL(Status) LIBSAKURA_ARCH_SYMBOL(CreateLSQFitContextSinusoidFloat)(
 		uint16_t nwave, size_t num_data,
 		LIBSAKURA_SYMBOL(LSQFitContextFloat) **context) noexcept {
 	CHECK_ARGS(context != nullptr);
@@ -1624,7 +1971,7 @@ extern "C" LIBSAKURA_SYMBOL(Status) LIBSAKURA_SYMBOL(CreateLSQFitContextSinusoid
 /**
  * Destroy lsqfit context object.
  */
-extern "C" LIBSAKURA_SYMBOL(Status) LIBSAKURA_SYMBOL(DestroyLSQFitContextFloat)(
+extern "C" LIBSAKURA_SYMBOL(Status) LIBSAKURA_ARCH_SYMBOL(DestroyLSQFitContextFloat)(
 LIBSAKURA_SYMBOL(LSQFitContextFloat) *context) noexcept {
 	CHECK_ARGS(context != nullptr);
 
@@ -1643,7 +1990,7 @@ LIBSAKURA_SYMBOL(LSQFitContextFloat) *context) noexcept {
  * parameters. It can be used for polynomial, Chebyshev, and cubic
  * spline model.
  */
-extern "C" LIBSAKURA_SYMBOL(Status) LIBSAKURA_SYMBOL(GetNumberOfCoefficientsFloat)(
+extern "C" LIBSAKURA_SYMBOL(Status) LIBSAKURA_ARCH_SYMBOL(GetNumberOfCoefficientsFloat)(
 LIBSAKURA_SYMBOL(LSQFitContextFloat) const *context, uint16_t order,
 		size_t *num_coeff) noexcept {
 	CHECK_ARGS(context != nullptr);
@@ -1684,7 +2031,7 @@ LIBSAKURA_SYMBOL(LSQFitContextFloat) const *context, uint16_t order,
  * Note: either of the above parameters accept null
  * pointer in case users do not need it.
  */
-extern "C" LIBSAKURA_SYMBOL(Status) LIBSAKURA_SYMBOL(LSQFitPolynomialFloat)(
+extern "C" LIBSAKURA_SYMBOL(Status) LIBSAKURA_ARCH_SYMBOL(LSQFitPolynomialFloat)(
 LIBSAKURA_SYMBOL(LSQFitContextFloat) const *context, uint16_t order,
 		size_t num_data, float const data[/*num_data*/],
 		bool const mask[/*num_data*/], float clip_threshold_sigma,
@@ -1692,6 +2039,8 @@ LIBSAKURA_SYMBOL(LSQFitContextFloat) const *context, uint16_t order,
 		float best_fit[/*num_data*/], float residual[/*num_data*/],
 		bool final_mask[/*num_data*/], float *rms,
 		LIBSAKURA_SYMBOL(LSQFitStatus) *lsqfit_status) noexcept {
+	LIBSAKURA_PROFILE_KERNEL(LSQFitPolynomialFloat,
+			num_data * (sizeof(float) + sizeof(bool)));
 	CHECK_ARGS(lsqfit_status != nullptr);
 	*lsqfit_status = LIBSAKURA_SYMBOL(LSQFitStatus_kNG);
 	CHECK_ARGS(context != nullptr);
@@ -1741,6 +2090,75 @@ LIBSAKURA_SYMBOL(LSQFitContextFloat) const *context, uint16_t order,
 	return LIBSAKURA_SYMBOL(Status_kOK);
 }
 
+/**
+ * Fit polynomial or Chebyshev polynomial to many spectra at once.
+ * The normal matrix is shared by the spectra with an identical mask.
+ */
+extern "C" LIBSAKURA_SYMBOL(Status) LIBSAKURA_ARCH_SYMBOL(LSQFitPolynomialBatchFloat)(
+LIBSAKURA_SYMBOL(LSQFitContextFloat) const *context, uint16_t order,
+		size_t num_spectra, size_t num_data,
+		float const data/*[num_spectra]*/[/*num_data*/],
+		bool const mask/*[num_spectra]*/[/*num_data*/], size_t num_coeff,
+		double coeff/*[num_spectra]*/[/*num_coeff*/],
+		float best_fit/*[num_spectra]*/[/*num_data*/],
+		float residual/*[num_spectra]*/[/*num_data*/],
+		float rms[/*num_spectra*/], size_t num_threads,
+		LIBSAKURA_SYMBOL(LSQFitStatus) lsqfit_status[/*num_spectra*/]) noexcept {
+	LIBSAKURA_PROFILE_KERNEL(LSQFitPolynomialBatchFloat,
+			num_spectra * num_data * (sizeof(float) + sizeof(bool)));
+	CHECK_ARGS(lsqfit_status != nullptr);
+	std::fill(lsqfit_status, lsqfit_status + num_spectra,
+			LIBSAKURA_SYMBOL(LSQFitStatus_kNG));
+	CHECK_ARGS(context != nullptr);
+	auto const type = context->lsqfit_type;
+	CHECK_ARGS(
+			(type == LSQFitTypeInternal_kPolynomial)
+					|| (type == LSQFitTypeInternal_kChebyshev));
+	CHECK_ARGS(order <= context->lsqfit_param);
+	CHECK_ARGS(num_data == context->num_basis_data);
+	CHECK_ARGS(num_spectra <= SIZE_MAX / num_data);
+	CHECK_ARGS(data != nullptr);
+	CHECK_ARGS(LIBSAKURA_SYMBOL(IsAligned)(data));
+	CHECK_ARGS(mask != nullptr);
+	CHECK_ARGS(LIBSAKURA_SYMBOL(IsAligned)(mask));
+	if (coeff != nullptr) {
+		CHECK_ARGS(
+				num_coeff
+						== DoGetNumberOfCoefficients(type, order, 0, nullptr));
+		CHECK_ARGS(LIBSAKURA_SYMBOL(IsAligned)(coeff));
+	}
+	if (best_fit != nullptr) {
+		CHECK_ARGS(LIBSAKURA_SYMBOL(IsAligned)(best_fit));
+	}
+	if (residual != nullptr) {
+		CHECK_ARGS(LIBSAKURA_SYMBOL(IsAligned)(residual));
+	}
+	CHECK_ARGS(rms != nullptr);
+	if (num_threads == 0) {
+		num_threads = std::max(1u, std::thread::hardware_concurrency());
+	}
+
+	try {
+		if (!LSQFitBatch<LIBSAKURA_SYMBOL(LSQFitContextFloat)>(context, order,
+				num_spectra, num_data, data, mask, coeff, best_fit, residual,
+				rms, num_threads, lsqfit_status)) {
+			LOG4CXX_ERROR(logger,
+					"Too few unmasked data for fitting some spectra!");
+			return LIBSAKURA_SYMBOL(Status_kNG);
+		}
+	} catch (const std::bad_alloc &e) {
+		LOG4CXX_ERROR(logger, "Memory allocation failed.");
+		return LIBSAKURA_SYMBOL(Status_kNoMemory);
+	} catch (const std::runtime_error &e) {
+		LOG4CXX_ERROR(logger, e.what());
+		return LIBSAKURA_SYMBOL(Status_kNG);
+	} catch (...) {
+		assert(false);
+		return LIBSAKURA_SYMBOL(Status_kUnknownError);
+	}
+	return LIBSAKURA_SYMBOL(Status_kOK);
+}
+
 /**
  * Fit cubic spline to input data.
  *
@@ -1758,7 +2176,7 @@ LIBSAKURA_SYMBOL(LSQFitContextFloat) const *context, uint16_t order,
  * Note: either of the above parameters accept null
  * pointer in case users do not need it.
  */
-extern "C" LIBSAKURA_SYMBOL(Status) LIBSAKURA_SYMBOL(LSQFitCubicSplineFloat)(
+extern "C" LIBSAKURA_SYMBOL(Status) LIBSAKURA_ARCH_SYMBOL(LSQFitCubicSplineFloat)(
 LIBSAKURA_SYMBOL(LSQFitContextFloat) const *context, size_t num_pieces,
 		size_t num_data, float const data[/*num_data*/],
 		bool const mask[/*num_data*/], float clip_threshold_sigma,
@@ -1767,6 +2185,8 @@ LIBSAKURA_SYMBOL(LSQFitContextFloat) const *context, size_t num_pieces,
 		bool final_mask[/*num_data*/], float *rms,
 		size_t boundary[/*num_pieces+1*/],
 		LIBSAKURA_SYMBOL(LSQFitStatus) *lsqfit_status) noexcept {
+	LIBSAKURA_PROFILE_KERNEL(LSQFitCubicSplineFloat,
+			num_data * (sizeof(float) + sizeof(bool)));
 	CHECK_ARGS(lsqfit_status != nullptr);
 	*lsqfit_status = LIBSAKURA_SYMBOL(LSQFitStatus_kNG);
 	CHECK_ARGS(context != nullptr);
@@ -1832,7 +2252,7 @@ LIBSAKURA_SYMBOL(LSQFitContextFloat) const *context, size_t num_pieces,
  * Note: either of the above parameters accept null
  * pointer in case users do not need it.
  */
-extern "C" LIBSAKURA_SYMBOL(Status) LIBSAKURA_SYMBOL(LSQFitSinusoidFloat)(
+extern "C" LIBSAKURA_SYMBOL(Status) LIBSAKURA_ARCH_SYMBOL(LSQFitSinusoidFloat)(
 LIBSAKURA_SYMBOL(LSQFitContextFloat) const *context, size_t num_nwave,
 		size_t const nwave[/*num_nwave*/], size_t num_data,
 		float const data[/*num_data*/], bool const mask[/*num_data*/],
@@ -1841,6 +2261,8 @@ LIBSAKURA_SYMBOL(LSQFitContextFloat) const *context, size_t num_nwave,
 		float residual[/*num_data*/],
 		bool final_mask[/*num_data*/], float *rms,
 		LIBSAKURA_SYMBOL(LSQFitStatus) *lsqfit_status) noexcept {
+	LIBSAKURA_PROFILE_KERNEL(LSQFitSinusoidFloat,
+			num_data * (sizeof(float) + sizeof(bool)));
 	CHECK_ARGS(lsqfit_status != nullptr);
 	*lsqfit_status = LIBSAKURA_SYMBOL(LSQFitStatus_kNG);
 	CHECK_ARGS(context != nullptr);
@@ -1899,10 +2321,11 @@ LIBSAKURA_SYMBOL(LSQFitContextFloat) const *context, size_t num_nwave,
  *
  * @param[out] out Model-subtracted data.
  */
-extern "C" LIBSAKURA_SYMBOL(Status) LIBSAKURA_SYMBOL(SubtractPolynomialFloat)(
+extern "C" LIBSAKURA_SYMBOL(Status) LIBSAKURA_ARCH_SYMBOL(SubtractPolynomialFloat)(
 LIBSAKURA_SYMBOL(LSQFitContextFloat) const *context, size_t num_data,
 		float const data[/*num_data*/], size_t num_coeff,
 		double const coeff[/*num_coeff*/], float out[/*num_data*/]) noexcept {
+	LIBSAKURA_PROFILE_KERNEL(SubtractPolynomialFloat, num_data * sizeof(float));
 	CHECK_ARGS(context != nullptr);
 	auto const type = context->lsqfit_type;
 	CHECK_ARGS(
@@ -1938,7 +2361,7 @@ LIBSAKURA_SYMBOL(LSQFitContextFloat) const *context, size_t num_data,
  *
  * @param[out] out Model-subtracted data.
  */
-extern "C" LIBSAKURA_SYMBOL(Status) LIBSAKURA_SYMBOL(SubtractCubicSplineFloat)(
+extern "C" LIBSAKURA_SYMBOL(Status) LIBSAKURA_ARCH_SYMBOL(SubtractCubicSplineFloat)(
 LIBSAKURA_SYMBOL(LSQFitContextFloat) const *context, size_t num_data,
 		float const data[/*num_data*/], size_t num_pieces,
 		double const coeff[/*num_pieces*/][kNumBasesCubicSpline],
@@ -1980,7 +2403,7 @@ LIBSAKURA_SYMBOL(LSQFitContextFloat) const *context, size_t num_data,
  *
  * @param[out] out Model-subtracted data.
  */
-extern "C" LIBSAKURA_SYMBOL(Status) LIBSAKURA_SYMBOL(SubtractSinusoidFloat)(
+extern "C" LIBSAKURA_SYMBOL(Status) LIBSAKURA_ARCH_SYMBOL(SubtractSinusoidFloat)(
 LIBSAKURA_SYMBOL(LSQFitContextFloat) const *context, size_t num_data,
 		float const data[/*num_data*/], size_t num_nwave,
 		size_t const nwave[/*num_nwave*/], size_t num_coeff,
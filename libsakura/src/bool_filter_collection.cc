@@ -28,6 +28,7 @@
 #include "libsakura/localdef.h"
 #include "libsakura/sakura.h"
 #include "libsakura/packed_operation.h"
+#include "libsakura/profiler.h"
 
 // Vectorization by Compiler
 namespace {
@@ -56,7 +57,7 @@ struct SetTrueIfInRangesInclusiveVector {
 	}
 };
 
-#if defined(__AVX__)
+#if defined(__AVX__) && !defined(ARCH_AFTER_SKYLAKE_AVX512)
 template<size_t kNumBounds>
 struct SetTrueIfInRangesInclusiveVector<float, kNumBounds> {
 	inline static void process(size_t num_data, float const *data,
@@ -242,7 +243,7 @@ struct SetTrueIfInRangesExclusiveVector {
 }
 };
 
-#if defined(__AVX__)
+#if defined(__AVX__) && !defined(ARCH_AFTER_SKYLAKE_AVX512)
 template<size_t kNumBounds>
 struct SetTrueIfInRangesExclusiveVector<float, kNumBounds> {
 	inline static void process(size_t num_data, float const *data,
@@ -390,6 +391,138 @@ struct SetTrueIfInRangesExclusiveVector<int, kNumBounds> {
 };
 #endif
 
+#if defined(ARCH_AFTER_SKYLAKE_AVX512)
+/*
+ * AVX-512 versions of SetTrueIfInRanges{Inclusive,Exclusive}Vector.
+ * Results of the comparisons are chained in a k-mask which is expanded
+ * to bool directly, and the remainder is processed by masked load/store
+ * instead of a scalar loop.
+ */
+template<typename DataType>
+struct InRangeAvx512 {
+};
+
+template<>
+struct InRangeAvx512<float> {
+	typedef __m512 Packet;
+	static Packet Load(__mmask16 in_range, float const *data) {
+		return _mm512_maskz_loadu_ps(in_range, data);
+	}
+	static Packet Set1(float value) {
+		return _mm512_set1_ps(value);
+	}
+	static __mmask16 LessOrEqual(__mmask16 in_range, Packet a, Packet b) {
+		return _mm512_mask_cmp_ps_mask(in_range, a, b, _CMP_LE_OQ);
+	}
+	static __mmask16 Less(__mmask16 in_range, Packet a, Packet b) {
+		return _mm512_mask_cmp_ps_mask(in_range, a, b, _CMP_LT_OQ);
+	}
+};
+
+template<>
+struct InRangeAvx512<int> {
+	typedef __m512i Packet;
+	static Packet Load(__mmask16 in_range, int const *data) {
+		return _mm512_maskz_loadu_epi32(in_range, data);
+	}
+	static Packet Set1(int value) {
+		return _mm512_set1_epi32(value);
+	}
+	static __mmask16 LessOrEqual(__mmask16 in_range, Packet a, Packet b) {
+		return _mm512_mask_cmple_epi32_mask(in_range, a, b);
+	}
+	static __mmask16 Less(__mmask16 in_range, Packet a, Packet b) {
+		return _mm512_mask_cmplt_epi32_mask(in_range, a, b);
+	}
+};
+
+template<typename DataType, size_t kNumBounds, bool kInclusive>
+inline void SetTrueIfInRangesAvx512(size_t num_data, DataType const *data,
+		DataType const *lower_bounds, DataType const *upper_bounds,
+		bool *result) {
+	typedef InRangeAvx512<DataType> Op;
+	constexpr size_t kElementsPerLoop =
+	LIBSAKURA_SYMBOL(SimdPacketAVX512)::kSize / sizeof(data[0]);
+	STATIC_ASSERT(kElementsPerLoop == sizeof(__mmask16) * 8);
+	STATIC_ASSERT(true == 1);
+	typename Op::Packet lower[kNumBounds > 0 ? kNumBounds : 1];
+	typename Op::Packet upper[kNumBounds > 0 ? kNumBounds : 1];
+	for (size_t j = 0; j < kNumBounds; ++j) {
+		lower[j] = Op::Set1(lower_bounds[j]);
+		upper[j] = Op::Set1(upper_bounds[j]);
+	}
+	auto is_in_ranges = [&](__mmask16 in_range, size_t position) {
+		auto const value = Op::Load(in_range, &data[position]);
+		__mmask16 is_in_range = 0;
+		for (size_t j = 0; j < kNumBounds; ++j) {
+			// the second comparison is done only for lanes passed the first one
+			is_in_range |=
+					kInclusive ?
+							Op::LessOrEqual(
+									Op::LessOrEqual(in_range, lower[j], value),
+									value, upper[j]) :
+							Op::Less(Op::Less(in_range, lower[j], value), value,
+									upper[j]);
+		}
+		return is_in_range;
+	};
+	auto const truth = _mm_set1_epi8(true);
+	size_t const n = num_data / kElementsPerLoop;
+	for (size_t i = 0; i < n; ++i) {
+		auto const position = i * kElementsPerLoop;
+		_mm_storeu_si128(reinterpret_cast<__m128i *>(&result[position]),
+				_mm_maskz_mov_epi8(is_in_ranges(0xFFFF, position), truth));
+	}
+	size_t const num_extra = num_data - n * kElementsPerLoop;
+	if (num_extra > 0) {
+		auto const position = n * kElementsPerLoop;
+		__mmask16 const in_range = static_cast<__mmask16>((1u << num_extra) - 1);
+		_mm_mask_storeu_epi8(&result[position], in_range,
+				_mm_maskz_mov_epi8(is_in_ranges(in_range, position), truth));
+	}
+}
+
+template<size_t kNumBounds>
+struct SetTrueIfInRangesInclusiveVector<float, kNumBounds> {
+	inline static void process(size_t num_data, float const *data,
+			float const *lower_bounds, float const *upper_bounds,
+			bool *result) {
+		SetTrueIfInRangesAvx512<float, kNumBounds, true>(num_data, data,
+				lower_bounds, upper_bounds, result);
+	}
+};
+
+template<size_t kNumBounds>
+struct SetTrueIfInRangesInclusiveVector<int, kNumBounds> {
+	inline static void process(size_t num_data, int const *data,
+			int const *lower_bounds, int const *upper_bounds,
+			bool *result) {
+		SetTrueIfInRangesAvx512<int, kNumBounds, true>(num_data, data,
+				lower_bounds, upper_bounds, result);
+	}
+};
+
+template<size_t kNumBounds>
+struct SetTrueIfInRangesExclusiveVector<float, kNumBounds> {
+	inline static void process(size_t num_data, float const *data,
+			float const *lower_bounds, float const *upper_bounds,
+			bool *result) {
+		SetTrueIfInRangesAvx512<float, kNumBounds, false>(num_data, data,
+				lower_bounds, upper_bounds, result);
+	}
+};
+
+template<size_t kNumBounds>
+struct SetTrueIfInRangesExclusiveVector<int, kNumBounds> {
+	inline static void process(size_t num_data, int const *data,
+			int const *lower_bounds, int const *upper_bounds,
+			bool *result) {
+		SetTrueIfInRangesAvx512<int, kNumBounds, false>(num_data, data,
+				lower_bounds, upper_bounds, result);
+	}
+};
+#endif /* defined(ARCH_AFTER_SKYLAKE_AVX512) */
+
 template<typename DataType>
 inline void SetTrueIfInRangesExclusiveGeneric(size_t num_data,
 		DataType const *data, size_t num_condition,
@@ -666,7 +799,7 @@ LIBSAKURA_SYMBOL(Status) DoArrayFuncBoolFilter(Func func, size_t num_data,
 }
 /* anonymous namespace */
 
-extern "C" LIBSAKURA_SYMBOL(Status) LIBSAKURA_SYMBOL(SetTrueIfInRangesInclusiveFloat)(
+extern "C" LIBSAKURA_SYMBOL(Status) LIBSAKURA_ARCH_SYMBOL(SetTrueIfInRangesInclusiveFloat)(
 		size_t num_data, float const data[/*num_data*/], size_t num_condition,
 		float const lower_bounds[/*num_condition*/],
 		float const upper_bounds[/*num_condition*/], bool result[/*num_data*/])
@@ -676,7 +809,7 @@ extern "C" LIBSAKURA_SYMBOL(Status) LIBSAKURA_SYMBOL(SetTrueIfInRangesInclusiveF
 			num_data, data, num_condition, lower_bounds, upper_bounds, result);
 }
 
-extern "C" LIBSAKURA_SYMBOL(Status) LIBSAKURA_SYMBOL(SetTrueIfInRangesInclusiveInt)(
+extern "C" LIBSAKURA_SYMBOL(Status) LIBSAKURA_ARCH_SYMBOL(SetTrueIfInRangesInclusiveInt)(
 		size_t num_data, int const data[/*num_data*/], size_t num_condition,
 		int const lower_bounds[/*num_condition*/],
 		int const upper_bounds[/*num_condition*/], bool result[/*num_data*/])
@@ -686,7 +819,7 @@ extern "C" LIBSAKURA_SYMBOL(Status) LIBSAKURA_SYMBOL(SetTrueIfInRangesInclusiveI
 			num_data, data, num_condition, lower_bounds, upper_bounds, result);
 }
 
-extern "C" LIBSAKURA_SYMBOL(Status) LIBSAKURA_SYMBOL(SetTrueIfInRangesExclusiveFloat)(
+extern "C" LIBSAKURA_SYMBOL(Status) LIBSAKURA_ARCH_SYMBOL(SetTrueIfInRangesExclusiveFloat)(
 		size_t num_data, float const data[/*num_data*/], size_t num_condition,
 		float const lower_bounds[/*num_condition*/],
 		float const upper_bounds[/*num_condition*/], bool result[/*num_data*/])
@@ -696,7 +829,7 @@ extern "C" LIBSAKURA_SYMBOL(Status) LIBSAKURA_SYMBOL(SetTrueIfInRangesExclusiveF
 			num_data, data, num_condition, lower_bounds, upper_bounds, result);
 }
 
-extern "C" LIBSAKURA_SYMBOL(Status) LIBSAKURA_SYMBOL(SetTrueIfInRangesExclusiveInt)(
+extern "C" LIBSAKURA_SYMBOL(Status) LIBSAKURA_ARCH_SYMBOL(SetTrueIfInRangesExclusiveInt)(
 		size_t num_data, int const data[/*num_data*/], size_t num_condition,
 		int const lower_bounds[/*num_condition*/],
 		int const upper_bounds[/*num_condition*/], bool result[/*num_data*/])
@@ -706,7 +839,7 @@ extern "C" LIBSAKURA_SYMBOL(Status) LIBSAKURA_SYMBOL(SetTrueIfInRangesExclusiveI
 			num_data, data, num_condition, lower_bounds, upper_bounds, result);
 }
 
-extern "C" LIBSAKURA_SYMBOL(Status) LIBSAKURA_SYMBOL(SetTrueIfGreaterThanFloat)(
+extern "C" LIBSAKURA_SYMBOL(Status) LIBSAKURA_ARCH_SYMBOL(SetTrueIfGreaterThanFloat)(
 		size_t num_data, float const data[/*num_data*/], float threshold,
 		bool result[/*num_data*/]) noexcept {
 	auto operation_for_element = [threshold](decltype(data[0]) data_value) {
@@ -716,7 +849,7 @@ extern "C" LIBSAKURA_SYMBOL(Status) LIBSAKURA_SYMBOL(SetTrueIfGreaterThanFloat)(
 			result);
 }
 
-extern "C" LIBSAKURA_SYMBOL(Status) LIBSAKURA_SYMBOL(SetTrueIfGreaterThanInt)(
+extern "C" LIBSAKURA_SYMBOL(Status) LIBSAKURA_ARCH_SYMBOL(SetTrueIfGreaterThanInt)(
 		size_t num_data, int const data[/*num_data*/], int threshold,
 		bool result[/*num_data*/]) noexcept {
 	auto operation_for_element = [threshold](decltype(data[0]) data_value) {
@@ -726,7 +859,7 @@ extern "C" LIBSAKURA_SYMBOL(Status) LIBSAKURA_SYMBOL(SetTrueIfGreaterThanInt)(
 			result);
 }
 
-extern "C" LIBSAKURA_SYMBOL(Status) LIBSAKURA_SYMBOL(SetTrueIfGreaterThanOrEqualsFloat)(
+extern "C" LIBSAKURA_SYMBOL(Status) LIBSAKURA_ARCH_SYMBOL(SetTrueIfGreaterThanOrEqualsFloat)(
 		size_t num_data, float const data[/*num_data*/], float threshold,
 		bool result[/*num_data*/]) noexcept {
 	auto operation_for_element = [threshold](decltype(data[0]) data_value) {
@@ -736,7 +869,7 @@ extern "C" LIBSAKURA_SYMBOL(Status) LIBSAKURA_SYMBOL(SetTrueIfGreaterThanOrEqual
 			result);
 }
 
-extern "C" LIBSAKURA_SYMBOL(Status) LIBSAKURA_SYMBOL(SetTrueIfGreaterThanOrEqualsInt)(
+extern "C" LIBSAKURA_SYMBOL(Status) LIBSAKURA_ARCH_SYMBOL(SetTrueIfGreaterThanOrEqualsInt)(
 		size_t num_data, int const data[/*num_data*/], int threshold,
 		bool result[/*num_data*/]) noexcept {
 	auto operation_for_element = [threshold](decltype(data[0]) data_value) {
@@ -746,7 +879,7 @@ extern "C" LIBSAKURA_SYMBOL(Status) LIBSAKURA_SYMBOL(SetTrueIfGreaterThanOrEqual
 			result);
 }
 
-extern "C" LIBSAKURA_SYMBOL(Status) LIBSAKURA_SYMBOL(SetTrueIfLessThanFloat)(
+extern "C" LIBSAKURA_SYMBOL(Status) LIBSAKURA_ARCH_SYMBOL(SetTrueIfLessThanFloat)(
 		size_t num_data, float const data[/*num_data*/], float threshold,
 		bool result[/*num_data*/]) noexcept {
 	auto operation_for_element = [threshold](decltype(data[0]) data_value) {
@@ -756,7 +889,7 @@ extern "C" LIBSAKURA_SYMBOL(Status) LIBSAKURA_SYMBOL(SetTrueIfLessThanFloat)(
 			result);
 }
 
-extern "C" LIBSAKURA_SYMBOL(Status) LIBSAKURA_SYMBOL(SetTrueIfLessThanInt)(
+extern "C" LIBSAKURA_SYMBOL(Status) LIBSAKURA_ARCH_SYMBOL(SetTrueIfLessThanInt)(
 		size_t num_data, int const data[/*num_data*/], int threshold,
 		bool result[/*num_data*/]) noexcept {
 	auto operation_for_element = [threshold](decltype(data[0]) data_value) {
@@ -766,7 +899,7 @@ extern "C" LIBSAKURA_SYMBOL(Status) LIBSAKURA_SYMBOL(SetTrueIfLessThanInt)(
 			result);
 }
 
-extern "C" LIBSAKURA_SYMBOL(Status) LIBSAKURA_SYMBOL(SetTrueIfLessThanOrEqualsFloat)(
+extern "C" LIBSAKURA_SYMBOL(Status) LIBSAKURA_ARCH_SYMBOL(SetTrueIfLessThanOrEqualsFloat)(
 		size_t num_data, float const data[/*num_data*/], float threshold,
 		bool result[/*num_data*/]) noexcept {
 	auto operation_for_element = [threshold](decltype(data[0]) data_value) {
@@ -776,7 +909,7 @@ extern "C" LIBSAKURA_SYMBOL(Status) LIBSAKURA_SYMBOL(SetTrueIfLessThanOrEqualsFl
 			result);
 }
 
-extern "C" LIBSAKURA_SYMBOL(Status) LIBSAKURA_SYMBOL(SetTrueIfLessThanOrEqualsInt)(
+extern "C" LIBSAKURA_SYMBOL(Status) LIBSAKURA_ARCH_SYMBOL(SetTrueIfLessThanOrEqualsInt)(
 		size_t num_data, int const data[/*num_data*/], int threshold,
 		bool result[/*num_data*/]) noexcept {
 	auto operation_for_element = [threshold](decltype(data[0]) data_value) {
@@ -787,9 +920,10 @@ extern "C" LIBSAKURA_SYMBOL(Status) LIBSAKURA_SYMBOL(SetTrueIfLessThanOrEqualsIn
 }
 
 #if defined(__AVX2__)
-extern "C" LIBSAKURA_SYMBOL(Status) LIBSAKURA_SYMBOL(SetFalseIfNanOrInfFloat)(
+extern "C" LIBSAKURA_SYMBOL(Status) LIBSAKURA_ARCH_SYMBOL(SetFalseIfNanOrInfFloat)(
 		size_t num_data, float const data[/*num_data*/],
 		bool result[/*num_data*/]) noexcept {
+	LIBSAKURA_PROFILE_KERNEL(SetFalseIfNanOrInfFloat, num_data * sizeof(float));
 	CHECK_ARGS(IsValidDataAndResult(data, result));
 
 	constexpr uint32_t kExponetMask = 0x7F800000;
@@ -855,9 +989,10 @@ extern "C" LIBSAKURA_SYMBOL(Status) LIBSAKURA_SYMBOL(SetFalseIfNanOrInfFloat)(
 	return DoElementFuncBoolFilter(operation_for_element, num_data, data, result);
 }
 #else
-extern "C" LIBSAKURA_SYMBOL(Status) LIBSAKURA_SYMBOL(SetFalseIfNanOrInfFloat)(
+extern "C" LIBSAKURA_SYMBOL(Status) LIBSAKURA_ARCH_SYMBOL(SetFalseIfNanOrInfFloat)(
 		size_t num_data, float const data[/*num_data*/],
 		bool result[/*num_data*/]) noexcept {
+	LIBSAKURA_PROFILE_KERNEL(SetFalseIfNanOrInfFloat, num_data * sizeof(float));
 	constexpr uint32_t kExponetMask = 0x7F800000;
 	STATIC_ASSERT(sizeof(kExponetMask) == sizeof(data[0]));
 	// code 1'
@@ -877,7 +1012,7 @@ extern "C" LIBSAKURA_SYMBOL(Status) LIBSAKURA_SYMBOL(SetFalseIfNanOrInfFloat)(
 }
 #endif
 #if defined(__AVX2__)
-extern "C" LIBSAKURA_SYMBOL(Status) LIBSAKURA_SYMBOL(Uint8ToBool)(
+extern "C" LIBSAKURA_SYMBOL(Status) LIBSAKURA_ARCH_SYMBOL(Uint8ToBool)(
 		size_t num_data, uint8_t const data[/*num_data*/],
 		bool result[/*num_data*/]) noexcept {
 	CHECK_ARGS(IsValidDataAndResult(data, result));
@@ -913,7 +1048,7 @@ extern "C" LIBSAKURA_SYMBOL(Status) LIBSAKURA_SYMBOL(Uint8ToBool)(
 	}
 }
 #else
-extern "C" LIBSAKURA_SYMBOL(Status) LIBSAKURA_SYMBOL(Uint8ToBool)(
+extern "C" LIBSAKURA_SYMBOL(Status) LIBSAKURA_ARCH_SYMBOL(Uint8ToBool)(
 		size_t num_data, uint8_t const data[/*num_data*/],
 		bool result[/*num_data*/]) noexcept {
 	constexpr uint8_t kZero = 0;
@@ -925,7 +1060,7 @@ extern "C" LIBSAKURA_SYMBOL(Status) LIBSAKURA_SYMBOL(Uint8ToBool)(
 }
 #endif
 
-extern "C" LIBSAKURA_SYMBOL(Status) LIBSAKURA_SYMBOL(Uint32ToBool)(
+extern "C" LIBSAKURA_SYMBOL(Status) LIBSAKURA_ARCH_SYMBOL(Uint32ToBool)(
 		size_t num_data, uint32_t const data[/*num_data*/],
 		bool result[/*num_data*/]) noexcept {
 	constexpr uint8_t kZero = 0;
@@ -936,7 +1071,7 @@ extern "C" LIBSAKURA_SYMBOL(Status) LIBSAKURA_SYMBOL(Uint32ToBool)(
 			result);
 }
 
-extern "C" LIBSAKURA_SYMBOL(Status) LIBSAKURA_SYMBOL(InvertBool)(
+extern "C" LIBSAKURA_SYMBOL(Status) LIBSAKURA_ARCH_SYMBOL(InvertBool)(
 		size_t num_data,
 		bool const data[/*num_data*/], bool result[/*num_data*/]) noexcept {
 	return DoArrayFuncBoolFilter([=] {InvertBool(num_data, data, result);},
@@ -39,6 +39,16 @@
 #include <assert.h>
 #include <limits.h>
 
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <system_error>
+#include <thread>
+
 #include "libsakura/config.h"
 #include "libsakura/localdef.h"
 #include "libsakura/concurrent.h"
@@ -118,9 +128,10 @@ Semaphore::~Semaphore() {
 }
 
 void Semaphore::Up(unsigned amount) /* throw (int) */ {
-	assert(0 < amount && amount <= UINT_MAX - semaphore_);
+	assert(0 < amount);
 	int result = pthread_mutex_lock(&mutex_);
 	if (result == 0) {
+		assert(amount <= UINT_MAX - semaphore_);
 		semaphore_ += amount;
 		result = pthread_cond_signal(&condition_);
 		int result2 = pthread_mutex_unlock(&mutex_);
@@ -222,95 +233,76 @@ void Broker::Run(void *context, unsigned do_ahead) /* throw (PCException) */ {
 void Broker::_Run(void *context, unsigned do_ahead, ThreadSpec thread_spec)
 		/* throw (PCException) */ {
 	assert(do_ahead > 0);
-#if defined(_OPENMP)
-	PCException const *prod_ex = NULL;
-	PCException const *cons_ex = NULL;
-	unsigned queued_jobs = 0;
-	int consumer_terminated = 0;
+	std::exception_ptr prod_ex;
+	std::exception_ptr cons_ex;
+	std::atomic<unsigned> queued_jobs(0U);
+	std::atomic<bool> consumer_terminated(false);
 	Semaphore semaphore_for_consumer;
 	Semaphore semaphore_for_producer(do_ahead);
 
-#pragma omp parallel num_threads(2) \
-		shared(semaphore_for_consumer, semaphore_for_producer, \
-			   consumer_terminated, queued_jobs)
-	{
-		//fprintf(stderr, "run: %p %d\n", context, omp_get_thread_num());
-		bool run_prod = true;
-		if (thread_spec == kUnspecified) {
-#pragma omp single
-			{
-				run_prod = false;
-			}
-		} else {
-			bool is_master = false;
-#pragma omp master
-			{
-				is_master = true;
-			}
-			if (thread_spec == kProdAsMaster) {
-				run_prod = is_master;
-			} else { // ConsAsMaster
-				run_prod = ! is_master;
+	auto produce = [&]() {
+		for (;;) {
+			semaphore_for_producer.Down();
+			if (consumer_terminated) {
+				break;
 			}
-		}
-
-		if (run_prod) { // producer
-			for (;;) {
-				semaphore_for_producer.Down();
-				int consumers_dead = 0;
-#pragma omp atomic
-				consumers_dead += consumer_terminated;
-				if (consumers_dead) {
-					break;
-				}
-				try {
-					bool produced = producer_(context);
-					if (! produced) {
-						break;
-					}
-				} catch (PCException const &e) {
-					prod_ex = &e;
+			try {
+				bool produced = producer_(context);
+				if (! produced) {
 					break;
 				}
-#pragma omp atomic
-				++queued_jobs;
-				semaphore_for_consumer.Up();
+			} catch (...) {
+				prod_ex = std::current_exception();
+				break;
 			}
-			// additional 'up' to give consumer a chance to terminate.
+			++queued_jobs;
 			semaphore_for_consumer.Up();
-		} else { // consumer
-			for (;;) {
-				semaphore_for_consumer.Down();
-				unsigned remaining_jobs = 0U;
-#pragma omp atomic
-				remaining_jobs += queued_jobs;
-				if (remaining_jobs == 0U) {
-					break;
-				}
-#pragma omp atomic
-				--queued_jobs;
-				try {
-					consumer_(context);
-				} catch (PCException const &e) {
-					cons_ex = &e;
-					break;
-				}
-				semaphore_for_producer.Up();
+		}
+		// additional 'up' to give consumer a chance to terminate.
+		semaphore_for_consumer.Up();
+	};
+	auto consume = [&]() {
+		for (;;) {
+			semaphore_for_consumer.Down();
+			if (queued_jobs == 0U) {
+				break;
+			}
+			--queued_jobs;
+			try {
+				consumer_(context);
+			} catch (...) {
+				cons_ex = std::current_exception();
+				break;
 			}
-#pragma omp atomic
-			++consumer_terminated;
-			// additional 'up' to give producer a chance to terminate.
 			semaphore_for_producer.Up();
 		}
+		consumer_terminated = true;
+		// additional 'up' to give producer a chance to terminate.
+		semaphore_for_producer.Up();
+	};
+
+	std::thread worker;
+	try {
+		if (thread_spec == kConsAsMaster) {
+			worker = std::thread(produce);
+		} else {
+			worker = std::thread(consume);
+		}
+	} catch (std::system_error const &e) {
+		RunSequential(context);
+		return;
+	}
+	if (thread_spec == kConsAsMaster) {
+		consume();
+	} else {
+		produce();
 	}
+	worker.join();
 	if (prod_ex) {
-		prod_ex->Raise();
+		std::rethrow_exception(prod_ex);
 	} else if (cons_ex) {
-		cons_ex->Raise();
+		std::rethrow_exception(cons_ex);
 	}
-#else
-	RunSequential(context);
-#endif
 }
 
 void Broker::RunSequential(void *context) /* throw (PCException) */ {
@@ -323,4 +315,287 @@ void Broker::RunSequential(void *context) /* throw (PCException) */ {
 	}
 }
 
+/* ======================= ThreadPool ======================= */
+namespace {
+/**
+ * The pool which the current thread works for, or nullptr
+ */
+thread_local ThreadPool const *current_pool = nullptr;
+/**
+ * The index of the current thread in @ref current_pool
+ */
+thread_local size_t current_worker = 0;
+} // namespace
+
+ThreadPool::ThreadPool(size_t num_threads, size_t max_queued_tasks)
+/* throw (std::system_error, std::bad_alloc) */:
+		max_queued_tasks_(max_queued_tasks), num_pending_(0), num_queued_(0),
+		num_unfinished_(0), next_worker_(0), stopping_(false), cancelled_(
+				false) {
+	assert(0 < max_queued_tasks);
+	if (num_threads == 0) {
+		num_threads = std::max(1U, std::thread::hardware_concurrency());
+	}
+	for (size_t i = 0; i < num_threads; ++i) {
+		workers_.emplace_back(new Worker());
+	}
+	try {
+		for (size_t i = 0; i < num_threads; ++i) {
+			workers_[i]->thread = std::thread(&ThreadPool::RunWorker, this, i);
+		}
+	} catch (...) {
+		{
+			std::lock_guard<std::mutex> lock(mutex_);
+			stopping_ = true;
+		}
+		task_available_.notify_all();
+		for (auto &worker : workers_) {
+			if (worker->thread.joinable()) {
+				worker->thread.join();
+			}
+		}
+		throw;
+	}
+}
+
+ThreadPool::~ThreadPool() {
+	{
+		std::unique_lock<std::mutex> lock(mutex_);
+		all_finished_.wait(lock, [this]() {return num_unfinished_ == 0;});
+		stopping_ = true;
+	}
+	task_available_.notify_all();
+	for (auto &worker : workers_) {
+		worker->thread.join();
+	}
+}
+
+void ThreadPool::Submit(Task task) /* throw (std::bad_alloc) */ {
+	bool const is_worker = current_pool == this;
+	size_t index = current_worker;
+	{
+		std::unique_lock<std::mutex> lock(mutex_);
+		if (is_worker) {
+			if (num_pending_ >= max_queued_tasks_) {
+				// waiting here could block all the workers
+				++num_unfinished_;
+				lock.unlock();
+				Execute(task);
+				return;
+			}
+		} else {
+			space_available_.wait(lock,
+					[this]() {return num_pending_ < max_queued_tasks_;});
+			index = next_worker_++ % workers_.size();
+		}
+		++num_pending_;
+		++num_unfinished_;
+	}
+	auto &worker = *workers_[index];
+	try {
+		std::lock_guard<std::mutex> lock(worker.mutex);
+		worker.tasks.push_back(std::move(task));
+	} catch (...) {
+		{
+			std::lock_guard<std::mutex> lock(mutex_);
+			--num_pending_;
+			if (--num_unfinished_ == 0) {
+				all_finished_.notify_all();
+			}
+		}
+		space_available_.notify_one();
+		throw;
+	}
+	{
+		// counted after the task is queued so that a worker finds a task
+		// once it reserves one
+		std::lock_guard<std::mutex> lock(mutex_);
+		++num_queued_;
+	}
+	task_available_.notify_one();
+}
+
+void ThreadPool::Wait() {
+	assert(current_pool != this);
+	std::exception_ptr error;
+	{
+		std::unique_lock<std::mutex> lock(mutex_);
+		all_finished_.wait(lock, [this]() {return num_unfinished_ == 0;});
+		std::swap(error, error_);
+		cancelled_ = false;
+	}
+	if (error) {
+		std::rethrow_exception(error);
+	}
+}
+
+void ThreadPool::RunWorker(size_t index) {
+	current_pool = this;
+	current_worker = index;
+	for (;;) {
+		{
+			std::unique_lock<std::mutex> lock(mutex_);
+			task_available_.wait(lock,
+					[this]() {return num_queued_ > 0 || stopping_;});
+			if (num_queued_ == 0) {
+				assert(stopping_);
+				return;
+			}
+			--num_queued_;
+			--num_pending_;
+		}
+		space_available_.notify_one();
+		Execute(TakeTask(index));
+	}
+}
+
+ThreadPool::Task ThreadPool::TakeTask(size_t index) {
+	// A task has been reserved. It is in one of the queues though another
+	// worker may take the one found first.
+	size_t const num_workers = workers_.size();
+	for (;;) {
+		{
+			auto &own = *workers_[index];
+			std::lock_guard<std::mutex> lock(own.mutex);
+			if (!own.tasks.empty()) {
+				Task task = std::move(own.tasks.back());
+				own.tasks.pop_back();
+				return task;
+			}
+		}
+		for (size_t i = 1; i < num_workers; ++i) {
+			auto &victim = *workers_[(index + i) % num_workers];
+			std::lock_guard<std::mutex> lock(victim.mutex);
+			if (!victim.tasks.empty()) {
+				Task task = std::move(victim.tasks.front());
+				victim.tasks.pop_front();
+				return task;
+			}
+		}
+		std::this_thread::yield();
+	}
+}
+
+void ThreadPool::Execute(Task const &task) {
+	bool cancelled = false;
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		cancelled = cancelled_;
+	}
+	if (!cancelled) {
+		try {
+			task();
+		} catch (...) {
+			std::lock_guard<std::mutex> lock(mutex_);
+			if (!error_) {
+				error_ = std::current_exception();
+			}
+			cancelled_ = true;
+		}
+	}
+	std::lock_guard<std::mutex> lock(mutex_);
+	if (--num_unfinished_ == 0) {
+		all_finished_.notify_all();
+	}
+}
+
+/* ======================= ParallelFor ======================= */
+ThreadPool *GetSharedThreadPool() noexcept {
+	try {
+		static ThreadPool pool;
+		return &pool;
+	} catch (...) {
+		return nullptr;
+	}
+}
+
+namespace {
+/**
+ * State of a call of @ref ParallelFor() shared with its tasks
+ *
+ * A task started after all the items are taken returns without touching
+ * @ref body , so that @ref ParallelFor() needn't wait for queued tasks.
+ */
+struct ParallelForState {
+	ParallelForState(size_t num_items_arg,
+			std::function<void(size_t, size_t)> const *body_arg) :
+			num_items(num_items_arg), body(body_arg), next_item(0), failed(
+					false), num_running(0), next_worker(0) {
+	}
+
+	/**
+	 * Takes items until none is left. Returns false without calling
+	 * @ref body if no item is left on entry.
+	 */
+	bool Run(bool is_caller) {
+		size_t worker = 0;
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			if (next_item >= num_items || failed) {
+				return false;
+			}
+			++num_running;
+			worker = is_caller ? 0 : ++next_worker;
+		}
+		try {
+			for (size_t item = next_item++; item < num_items && !failed; item =
+					next_item++) {
+				(*body)(worker, item);
+			}
+		} catch (...) {
+			std::lock_guard<std::mutex> lock(mutex);
+			if (!error) {
+				error = std::current_exception();
+			}
+			failed = true;
+		}
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			--num_running;
+		}
+		finished.notify_all();
+		return true;
+	}
+
+	size_t const num_items;
+	std::function<void(size_t, size_t)> const *body;
+	std::atomic<size_t> next_item;
+	std::atomic<bool> failed;
+	std::mutex mutex;
+	std::condition_variable finished;
+	size_t num_running;
+	size_t next_worker;
+	std::exception_ptr error;
+};
+} // namespace
+
+void ParallelFor(size_t num_threads, size_t num_items,
+		std::function<void(size_t worker, size_t item)> const &body,
+		ThreadPool *pool) {
+	if (pool == nullptr) {
+		pool = GetSharedThreadPool();
+	}
+	size_t const num_workers = std::min(num_threads, num_items);
+	if (num_workers <= 1 || pool == nullptr) {
+		for (size_t item = 0; item < num_items; ++item) {
+			body(0, item);
+		}
+		return;
+	}
+	auto state = std::make_shared<ParallelForState>(num_items, &body);
+	try {
+		for (size_t i = 1; i < num_workers; ++i) {
+			pool->Submit([state]() {state->Run(false);});
+		}
+	} catch (std::bad_alloc const &e) {
+		// continue with the tasks which could be submitted.
+	}
+	state->Run(true);
+	std::unique_lock<std::mutex> lock(state->mutex);
+	state->finished.wait(lock, [&state]() {return state->num_running == 0;});
+	if (state->error) {
+		std::rethrow_exception(state->error);
+	}
+}
+
 } // namespace
@@ -39,23 +39,15 @@
 #include <fstream>
 #include <sstream>
 
+#if defined(__AVX__) && !defined(ARCH_SCALAR)
+#	include <immintrin.h>
+#endif
+
 #include <libsakura/sakura.h>
 #include <libsakura/localdef.h>
 #include <libsakura/logger.h>
 #include <libsakura/memory_manager.h>
-
-extern "C" {
-struct LIBSAKURA_SYMBOL(Convolve1DContextFloat) {
-	size_t num_kernel;
-	fftw_plan plan_r2c;
-	fftw_plan plan_c2r;
-	fftw_complex *ffted_kernel;
-	fftw_complex *ffted_input_data;
-	fftw_complex *ffted_convolve_data;
-	double *real_array;
-	void *real_array_work;
-};
-}
+#include <libsakura/profiler.h>
 
 namespace {
 
@@ -78,6 +70,300 @@ inline void DestroyFFTPlan(fftw_plan ptr) {
 	}
 }
 
+/**
+ * @brief Wrapper of FFTW functions for each precision.
+ *
+ * @tparam T real type of FFT, either double or float
+ */
+template<typename T>
+struct FFTW;
+
+template<>
+struct FFTW<double> {
+	typedef fftw_plan Plan;
+	typedef fftw_complex Complex;
+	/**
+	 * @brief Create a plan of in-place forward transform of @a howmany arrays
+	 * of @a n elements, each of which is padded to 2*(n/2+1) elements.
+	 */
+	static Plan PlanManyR2C(int n, int howmany, double *data, unsigned flags) {
+		int const padded = 2 * (n / 2 + 1);
+		return fftw_plan_many_dft_r2c(1, &n, howmany, data, nullptr, 1, padded,
+				reinterpret_cast<Complex *>(data), nullptr, 1, padded / 2, flags);
+	}
+	/**
+	 * @brief Create a plan of in-place backward transform corresponding to
+	 * @ref PlanManyR2C.
+	 */
+	static Plan PlanManyC2R(int n, int howmany, double *data, unsigned flags) {
+		int const padded = 2 * (n / 2 + 1);
+		return fftw_plan_many_dft_c2r(1, &n, howmany,
+				reinterpret_cast<Complex *>(data), nullptr, 1, padded / 2, data,
+				nullptr, 1, padded, flags);
+	}
+	static void Execute(Plan plan) {
+		fftw_execute(plan);
+	}
+	static void DestroyPlan(Plan plan) {
+		if (plan != nullptr) {
+			fftw_destroy_plan(plan);
+		}
+	}
+	static void *Malloc(size_t size) {
+		return fftw_malloc(size);
+	}
+	static void Free(void *ptr) {
+		if (ptr != nullptr) {
+			fftw_free(ptr);
+		}
+	}
+};
+
+#if LIBSAKURA_HAS_FFTW3F
+template<>
+struct FFTW<float> {
+	typedef fftwf_plan Plan;
+	typedef fftwf_complex Complex;
+	static Plan PlanManyR2C(int n, int howmany, float *data, unsigned flags) {
+		int const padded = 2 * (n / 2 + 1);
+		return fftwf_plan_many_dft_r2c(1, &n, howmany, data, nullptr, 1, padded,
+				reinterpret_cast<Complex *>(data), nullptr, 1, padded / 2, flags);
+	}
+	static Plan PlanManyC2R(int n, int howmany, float *data, unsigned flags) {
+		int const padded = 2 * (n / 2 + 1);
+		return fftwf_plan_many_dft_c2r(1, &n, howmany,
+				reinterpret_cast<Complex *>(data), nullptr, 1, padded / 2, data,
+				nullptr, 1, padded, flags);
+	}
+	static void Execute(Plan plan) {
+		fftwf_execute(plan);
+	}
+	static void DestroyPlan(Plan plan) {
+		if (plan != nullptr) {
+			fftwf_destroy_plan(plan);
+		}
+	}
+	static void *Malloc(size_t size) {
+		return fftwf_malloc(size);
+	}
+	static void Free(void *ptr) {
+		if (ptr != nullptr) {
+			fftwf_free(ptr);
+		}
+	}
+};
+
+/**
+ * @brief Multiply @a data by @a kernel element by element in Fourier domain.
+ *
+ * @param num_data number of complex elements
+ * @param kernel_arg complex array
+ * @param data_arg complex array to be multiplied
+ */
+inline void MultiplyComplexArray(size_t num_data,
+		fftwf_complex const kernel_arg[], fftwf_complex data_arg[]) {
+	auto kernel = reinterpret_cast<float const *>(kernel_arg);
+	auto data = reinterpret_cast<float *>(data_arg);
+	size_t i = 0;
+#if defined(__AVX__) && !defined(ARCH_SCALAR)
+	constexpr size_t kNumComplex = sizeof(__m256) / sizeof(fftwf_complex);
+	for (; i + kNumComplex <= num_data; i += kNumComplex) {
+		__m256 const k = _mm256_loadu_ps(&kernel[2 * i]);
+		__m256 const d = _mm256_loadu_ps(&data[2 * i]);
+		// (d.re * k.re - d.im * k.im, d.im * k.re + d.re * k.im)
+		__m256 const d_swapped = _mm256_permute_ps(d, 0xB1);
+		_mm256_storeu_ps(&data[2 * i],
+				_mm256_addsub_ps(_mm256_mul_ps(d, _mm256_moveldup_ps(k)),
+						_mm256_mul_ps(d_swapped, _mm256_movehdup_ps(k))));
+	}
+#endif
+	for (; i < num_data; ++i) {
+		float const re = data[2 * i];
+		float const im = data[2 * i + 1];
+		data[2 * i] = kernel[2 * i] * re - kernel[2 * i + 1] * im;
+		data[2 * i + 1] = kernel[2 * i] * im + kernel[2 * i + 1] * re;
+	}
+}
+#endif
+
+inline void MultiplyComplexArray(size_t num_data,
+		fftw_complex const kernel_arg[], fftw_complex data_arg[]) {
+	auto kernel = reinterpret_cast<double const *>(kernel_arg);
+	auto data = reinterpret_cast<double *>(data_arg);
+	size_t i = 0;
+#if defined(__AVX__) && !defined(ARCH_SCALAR)
+	constexpr size_t kNumComplex = sizeof(__m256d) / sizeof(fftw_complex);
+	for (; i + kNumComplex <= num_data; i += kNumComplex) {
+		__m256d const k = _mm256_loadu_pd(&kernel[2 * i]);
+		__m256d const d = _mm256_loadu_pd(&data[2 * i]);
+		__m256d const d_swapped = _mm256_permute_pd(d, 0x5);
+		_mm256_storeu_pd(&data[2 * i],
+				_mm256_addsub_pd(_mm256_mul_pd(d, _mm256_movedup_pd(k)),
+						_mm256_mul_pd(d_swapped, _mm256_permute_pd(k, 0xF))));
+	}
+#endif
+	for (; i < num_data; ++i) {
+		double const re = data[2 * i];
+		double const im = data[2 * i + 1];
+		data[2 * i] = kernel[2 * i] * re - kernel[2 * i + 1] * im;
+		data[2 * i + 1] = kernel[2 * i] * im + kernel[2 * i + 1] * re;
+	}
+}
+
+/**
+ * @brief FFT plans and working arrays to convolve spectra with a kernel.
+ *
+ * Spectra are copied to a working array of [num_batch][2*(num_data/2+1)]
+ * elements and transformed in-place. @a num_batch spectra are transformed
+ * at once by plans created by fftw_plan_many_dft_r2c/c2r.
+ * The object has no constructor since it is a member of
+ * @ref sakura_Convolve1DContextFloat, which is allocated by
+ * @ref sakura::Memory::Allocate. Call @ref Initialize to set up.
+ *
+ * @tparam T real type of FFT, either double or float
+ */
+template<typename T>
+struct FFTConvolver {
+	typedef typename FFTW<T>::Plan Plan;
+	typedef typename FFTW<T>::Complex Complex;
+
+	/**
+	 * @brief Create plans and working arrays.
+	 *
+	 * Members allocated before an exception is thrown must be released by
+	 * @ref Destroy.
+	 *
+	 * @param num_data number of elements of a spectrum
+	 * @param num_batch_arg number of spectra transformed at once
+	 * @param ffted_kernel_arg Fourier transform of the kernel normalized by
+	 * @a num_data. Its length must be num_data/2+1.
+	 */
+	void Initialize(size_t num_data, size_t num_batch_arg,
+			fftw_complex const ffted_kernel_arg[]) {
+		num_batch = num_batch_arg;
+		plan_r2c = nullptr;
+		plan_c2r = nullptr;
+		plan_r2c_batch = nullptr;
+		plan_c2r_batch = nullptr;
+		ffted_kernel = nullptr;
+		work = nullptr;
+
+		size_t const num_fft_data = num_data / 2 + 1;
+		ffted_kernel = static_cast<Complex *>(FFTW<T>::Malloc(
+				sizeof(Complex) * num_fft_data));
+		if (ffted_kernel == nullptr) {
+			throw std::bad_alloc();
+		}
+		for (size_t i = 0; i < num_fft_data; ++i) {
+			ffted_kernel[i][0] = static_cast<T>(ffted_kernel_arg[i][0]);
+			ffted_kernel[i][1] = static_cast<T>(ffted_kernel_arg[i][1]);
+		}
+		work = static_cast<T *>(FFTW<T>::Malloc(
+				sizeof(T) * 2 * num_fft_data * num_batch));
+		if (work == nullptr) {
+			throw std::bad_alloc();
+		}
+		int const n = static_cast<int>(num_data);
+		plan_r2c = FFTW<T>::PlanManyR2C(n, 1, work, FFTW_ESTIMATE);
+		plan_c2r = FFTW<T>::PlanManyC2R(n, 1, work, FFTW_ESTIMATE);
+		if (plan_r2c == nullptr || plan_c2r == nullptr) {
+			throw std::bad_alloc();
+		}
+		if (num_batch > 1) {
+			int const howmany = static_cast<int>(num_batch);
+			plan_r2c_batch = FFTW<T>::PlanManyR2C(n, howmany, work,
+					FFTW_ESTIMATE);
+			plan_c2r_batch = FFTW<T>::PlanManyC2R(n, howmany, work,
+					FFTW_ESTIMATE);
+			if (plan_r2c_batch == nullptr || plan_c2r_batch == nullptr) {
+				throw std::bad_alloc();
+			}
+		}
+	}
+	/**
+	 * @brief Release plans and working arrays.
+	 */
+	void Destroy() {
+		FFTW<T>::DestroyPlan(plan_r2c);
+		FFTW<T>::DestroyPlan(plan_c2r);
+		FFTW<T>::DestroyPlan(plan_r2c_batch);
+		FFTW<T>::DestroyPlan(plan_c2r_batch);
+		FFTW<T>::Free(ffted_kernel);
+		FFTW<T>::Free(work);
+	}
+	/**
+	 * @brief Convolve @a num_spectra spectra of @a num_data elements.
+	 *
+	 * @a input_data and @a output_data may be the same array.
+	 */
+	void Convolve(size_t num_spectra, size_t num_data, float const input_data[],
+			float output_data[]) const {
+		size_t i = 0;
+		if (num_batch > 1) {
+			for (; i + num_batch <= num_spectra; i += num_batch) {
+				ConvolveChunk(plan_r2c_batch, plan_c2r_batch, num_batch,
+						num_data, &input_data[i * num_data],
+						&output_data[i * num_data]);
+			}
+		}
+		for (; i < num_spectra; ++i) {
+			ConvolveChunk(plan_r2c, plan_c2r, 1, num_data,
+					&input_data[i * num_data], &output_data[i * num_data]);
+		}
+	}
+
+	size_t num_batch;
+	Plan plan_r2c;
+	Plan plan_c2r;
+	Plan plan_r2c_batch;
+	Plan plan_c2r_batch;
+	Complex *ffted_kernel;
+	T *work;
+
+private:
+	void ConvolveChunk(Plan forward, Plan backward, size_t num_spectra,
+			size_t num_data, float const input_data[],
+			float output_data[]) const {
+		size_t const num_fft_data = num_data / 2 + 1;
+		size_t const padded = 2 * num_fft_data;
+		for (size_t j = 0; j < num_spectra; ++j) {
+			T *dst = &work[j * padded];
+			float const *src = &input_data[j * num_data];
+			for (size_t k = 0; k < num_data; ++k) {
+				dst[k] = src[k];
+			}
+		}
+		FFTW<T>::Execute(forward);
+		for (size_t j = 0; j < num_spectra; ++j) {
+			MultiplyComplexArray(num_fft_data, ffted_kernel,
+					reinterpret_cast<Complex *>(&work[j * padded]));
+		}
+		FFTW<T>::Execute(backward);
+		for (size_t j = 0; j < num_spectra; ++j) {
+			T const *src = &work[j * padded];
+			float *dst = &output_data[j * num_data];
+			for (size_t k = 0; k < num_data; ++k) {
+				dst[k] = static_cast<float>(src[k]);
+			}
+		}
+	}
+};
+
+} /* anonymous namespace */
+
+extern "C" {
+struct LIBSAKURA_SYMBOL(Convolve1DContextFloat) {
+	size_t num_kernel;
+	LIBSAKURA_SYMBOL(FFTPrecision) precision;
+	FFTConvolver<double> double_convolver;
+#if LIBSAKURA_HAS_FFTW3F
+	FFTConvolver<float> single_convolver;
+#endif
+};
+}
+
+namespace {
+
 /**
  * @brief Create 1 dimensional Gaussian kernel
  *
@@ -121,27 +407,119 @@ inline void Create1DGaussianKernelFloat(size_t num_kernel, float peak_location,
 }
 
 /**
+ * @brief The number of output elements accumulated together by
+ * @ref AccumulateDirectBlock.
+ */
+constexpr size_t kDirectBlockSize = 16;
+
+/**
+ * @brief The number of output elements in a tile of direct convolution.
+ * Data of a tile and a block of taps are kept in L1 cache while all the
+ * output elements of the tile are accumulated.
+ */
+constexpr size_t kDirectTileSize = 512;
+
+/**
+ * @brief The number of taps of the kernel accumulated in a pass over a tile.
+ */
+constexpr size_t kDirectTapBlockSize = 1024;
+
+#if defined(__AVX__) && !defined(ARCH_SCALAR)
+/**
+ * @brief a * b + c
+ */
+inline __m256d MultiplyAdd(__m256d a, __m256d b, __m256d c) {
+#if defined(__FMA__)
+	return _mm256_fmadd_pd(a, b, c);
+#else
+	return _mm256_add_pd(_mm256_mul_pd(a, b), c);
+#endif
+}
+#endif
+
+/**
+ * @brief Accumulate weighted sums of @a num_tap taps to
+ * @ref kDirectBlockSize output elements.
  *
- * @param num_data
- * @param src
- * @param dst
- * @tparam T
+ * value[i] += sum_j kernel[j] * data[i + j]
+ * weight[i] += sum_j kernel[j] * mask[i + j]
+ *
+ * The taps are summed up in order of j so that the result does not depend
+ * on vectorization.
+ *
+ * @param num_tap the number of taps
+ * @param kernel reverted kernel
+ * @param data masked data. It must have @a num_tap + kDirectBlockSize - 1 elements.
+ * @param mask mask (1 or 0). It must have @a num_tap + kDirectBlockSize - 1 elements.
+ * @param value partial sums of values. must-be-aligned
+ * @param weight partial sums of weights. must-be-aligned
  */
-template<typename T>
-inline void RevertData1D(size_t num_data, T const src[/*num_data*/],
-		T dst[/*num_data*/]) {
-	for (size_t i = 0; i < num_data; ++i) {
-		dst[i] = src[num_data - 1 - i];
+inline void AccumulateDirectBlock(size_t num_tap, double const kernel[],
+		double const data[], double const mask[], double value[],
+		double weight[]) {
+#if defined(__AVX__) && !defined(ARCH_SCALAR)
+	STATIC_ASSERT(kDirectBlockSize == 4 * (sizeof(__m256d) / sizeof(double)));
+	__m256d value0 = _mm256_load_pd(&value[0]);
+	__m256d value1 = _mm256_load_pd(&value[4]);
+	__m256d value2 = _mm256_load_pd(&value[8]);
+	__m256d value3 = _mm256_load_pd(&value[12]);
+	__m256d weight0 = _mm256_load_pd(&weight[0]);
+	__m256d weight1 = _mm256_load_pd(&weight[4]);
+	__m256d weight2 = _mm256_load_pd(&weight[8]);
+	__m256d weight3 = _mm256_load_pd(&weight[12]);
+	for (size_t j = 0; j < num_tap; ++j) {
+		__m256d const k = _mm256_broadcast_sd(&kernel[j]);
+		value0 = MultiplyAdd(k, _mm256_loadu_pd(&data[j]), value0);
+		value1 = MultiplyAdd(k, _mm256_loadu_pd(&data[j + 4]), value1);
+		value2 = MultiplyAdd(k, _mm256_loadu_pd(&data[j + 8]), value2);
+		value3 = MultiplyAdd(k, _mm256_loadu_pd(&data[j + 12]), value3);
+		weight0 = MultiplyAdd(k, _mm256_loadu_pd(&mask[j]), weight0);
+		weight1 = MultiplyAdd(k, _mm256_loadu_pd(&mask[j + 4]), weight1);
+		weight2 = MultiplyAdd(k, _mm256_loadu_pd(&mask[j + 8]), weight2);
+		weight3 = MultiplyAdd(k, _mm256_loadu_pd(&mask[j + 12]), weight3);
 	}
+	_mm256_store_pd(&value[0], value0);
+	_mm256_store_pd(&value[4], value1);
+	_mm256_store_pd(&value[8], value2);
+	_mm256_store_pd(&value[12], value3);
+	_mm256_store_pd(&weight[0], weight0);
+	_mm256_store_pd(&weight[4], weight1);
+	_mm256_store_pd(&weight[8], weight2);
+	_mm256_store_pd(&weight[12], weight3);
+#else
+	for (size_t i = 0; i < kDirectBlockSize; ++i) {
+		double the_value = value[i];
+		double the_weight = weight[i];
+		for (size_t j = 0; j < num_tap; ++j) {
+			the_value += kernel[j] * data[i + j];
+			the_weight += kernel[j] * mask[i + j];
+		}
+		value[i] = the_value;
+		weight[i] = the_weight;
+	}
+#endif
 }
 
 /**
+ * @brief Direct convolution with mask.
  *
- * @param num_data
- * @param input_data_arg
- * @param num_kernel
- * @param kernel_arg
- * @param output_data_arg
+ * Masked data and mask are converted to double and padded by zeros of the
+ * half width of the kernel on both sides, so that the whole kernel is
+ * applied to every output element. Elements out of range and masked ones
+ * contribute nothing to both value and weight. Output elements are
+ * processed in tiles of @ref kDirectTileSize and taps in blocks of
+ * @ref kDirectTapBlockSize for cache reuse.
+ *
+ * Working arrays of about 2 * (@a num_data + @a num_kernel) doubles are
+ * allocated on heap.
+ *
+ * @param num_kernel the number of elements in @a kernel_arg
+ * @param kernel_arg kernel
+ * @param num_data the number of elements in data arrays
+ * @param input_data_arg input data
+ * @param input_mask_arg input mask
+ * @param output_data_arg output data
+ * @param output_weight_arg sum of weights of each output element
  */
 inline void ConvolutionWithoutFFT(size_t num_kernel, float const *kernel_arg,
 		size_t num_data, float const *input_data_arg,
@@ -153,52 +531,75 @@ inline void ConvolutionWithoutFFT(size_t num_kernel, float const *kernel_arg,
 	assert(LIBSAKURA_SYMBOL(IsAligned)(mask8));
 	assert(LIBSAKURA_SYMBOL(IsAligned)(output_data_arg));
 	assert(LIBSAKURA_SYMBOL(IsAligned)(output_weight_arg));
-	// Need to revert kernel array in direct convolution.
-	SIMD_ALIGN
-	float revert_kernel[num_kernel];
-	assert(LIBSAKURA_SYMBOL(IsAligned)(revert_kernel));
-	RevertData1D(num_kernel, kernel_arg, revert_kernel);
-
+	STATIC_ASSERT(sizeof(input_mask_arg[0]) == sizeof(mask8[0]));
+	STATIC_ASSERT(true == 1);
+	STATIC_ASSERT(false == 0);
 	auto raw_input_data = AssumeAligned(input_data_arg);
 	auto input_mask = AssumeAligned(mask8);
-	auto kernel = AssumeAligned(revert_kernel);
 	auto output_data = AssumeAligned(output_data_arg);
 	auto weight_data = AssumeAligned(output_weight_arg);
-	STATIC_ASSERT(sizeof(input_mask_arg[0]) == sizeof(input_mask[0]));
-	STATIC_ASSERT(true == 1);
-	STATIC_ASSERT(false == 0);
-	// temporal data array to handle Nan/Inf
-	SIMD_ALIGN
-	float input_data[num_data];
-	for (size_t i = 0; i < num_data; ++i) {
-		input_data[i] = input_mask[i] == 0 ? 0.0 : raw_input_data[i];
-	}
+
 	// the center index in *reverted* kernel
-	size_t center_index = num_kernel - 1 - (num_kernel / 2);
-	// the number of elements in the left half of kernel (excluding center)
-	size_t left_half = center_index;
-	// the number of elements in the right half of kernel (excluding center)
-	size_t right_half = num_kernel - left_half - 1;
+	size_t const center_index = num_kernel - 1 - (num_kernel / 2);
+	// output elements are computed by blocks of kDirectBlockSize
+	size_t const num_output = (num_data + kDirectBlockSize - 1)
+			/ kDirectBlockSize * kDirectBlockSize;
+	size_t const num_padded = num_output + num_kernel - 1;
+	size_t const num_tile = std::min(kDirectTileSize, num_output);
+	auto round_up = [](size_t n) {
+		constexpr size_t kUnit = LIBSAKURA_ALIGNMENT / sizeof(double);
+		return (n + kUnit - 1) / kUnit * kUnit;
+	};
+	size_t const kernel_offset = 0;
+	size_t const data_offset = kernel_offset + round_up(num_kernel);
+	size_t const mask_offset = data_offset + round_up(num_padded);
+	size_t const value_offset = mask_offset + round_up(num_padded);
+	size_t const weight_offset = value_offset + round_up(num_tile);
+	size_t const num_work = weight_offset + round_up(num_tile);
+	double *work = nullptr;
+	std::unique_ptr<void, LIBSAKURA_PREFIX::Memory> work_storage(
+			LIBSAKURA_PREFIX::Memory::AlignedAllocateOrException(
+					sizeof(double) * num_work, &work));
+	double *kernel = &work[kernel_offset];
+	double *data = &work[data_offset];
+	double *mask = &work[mask_offset];
+	double *value = AssumeAligned(&work[value_offset]);
+	double *weight = AssumeAligned(&work[weight_offset]);
+
+	// Need to revert kernel array in direct convolution.
+	for (size_t i = 0; i < num_kernel; ++i) {
+		kernel[i] = kernel_arg[num_kernel - 1 - i];
+	}
+	std::fill(data, data + center_index, 0.);
+	std::fill(mask, mask + center_index, 0.);
 	for (size_t i = 0; i < num_data; ++i) {
-		size_t lower_index = (i >= center_index) ? i - left_half : 0;
-		size_t kernel_start = (i >= center_index) ? 0 : center_index - i;
-		size_t kernel_end =
-				(num_data - 1 - i >= right_half) ?
-						num_kernel :
-						num_kernel - (right_half - (num_data - 1 - i)); // end index +1
-		size_t num_convolve = kernel_end - kernel_start;
-		assert(num_convolve <= num_kernel);
-		double value = 0.0;
-		double weight = 0.0;
-		for (size_t j = 0; j < num_convolve; ++j) {
-			double local_weight = static_cast<double>(kernel[kernel_start + j])
-					* static_cast<double>(input_mask[lower_index + j]);
-			value += (local_weight
-					* static_cast<double>(input_data[(lower_index + j)]));
-			weight += local_weight;
+		// masked elements may be NaN or Inf
+		bool const is_valid = input_mask[i] != 0;
+		data[center_index + i] = is_valid ? raw_input_data[i] : 0.;
+		mask[center_index + i] = is_valid ? 1. : 0.;
+	}
+	std::fill(data + center_index + num_data, data + num_padded, 0.);
+	std::fill(mask + center_index + num_data, mask + num_padded, 0.);
+
+	for (size_t tile = 0; tile < num_output; tile += kDirectTileSize) {
+		size_t const tile_end = std::min(tile + kDirectTileSize, num_output);
+		std::fill(value, value + (tile_end - tile), 0.);
+		std::fill(weight, weight + (tile_end - tile), 0.);
+		for (size_t tap = 0; tap < num_kernel; tap += kDirectTapBlockSize) {
+			size_t const num_tap = std::min(kDirectTapBlockSize,
+					num_kernel - tap);
+			for (size_t i = tile; i < tile_end; i += kDirectBlockSize) {
+				AccumulateDirectBlock(num_tap, &kernel[tap], &data[i + tap],
+						&mask[i + tap], &value[i - tile], &weight[i - tile]);
+			}
+		}
+		size_t const data_end = std::min(tile_end, num_data);
+		for (size_t i = tile; i < data_end; ++i) {
+			double const the_weight = weight[i - tile];
+			output_data[i] = (
+					the_weight == 0.0 ? 0.0 : value[i - tile] / the_weight);
+			weight_data[i] = the_weight;
 		}
-		output_data[i] = (weight == 0.0 ? 0.0 : value / weight);
-		weight_data[i] = weight;
 	}
 }
 
@@ -221,13 +622,34 @@ inline void FlipData1D(size_t num_data, T const src[], U dst[]) {
 	}
 }
 
+inline void DestroyConvolve1DContextFloat(
+LIBSAKURA_SYMBOL(Convolve1DContextFloat)* context) {
+	if (context != nullptr) {
+#if LIBSAKURA_HAS_FFTW3F
+		if (context->precision == LIBSAKURA_SYMBOL(FFTPrecision_kSingle)) {
+			context->single_convolver.Destroy();
+		} else
+#endif
+		{
+			context->double_convolver.Destroy();
+		}
+		LIBSAKURA_PREFIX::Memory::Free(context);
+	}
+}
+
 inline void CreateConvolve1DContextFFTFloat(size_t num_kernel,
-		float const kernel[],
+		float const kernel[], size_t num_batch,
+		LIBSAKURA_SYMBOL(FFTPrecision) precision,
 		LIBSAKURA_SYMBOL(Convolve1DContextFloat)** context) {
 
 	assert(context != nullptr);
 	assert(kernel != nullptr);
 	assert(LIBSAKURA_SYMBOL(IsAligned)(kernel));
+	assert(num_batch > 0);
+#if !LIBSAKURA_HAS_FFTW3F
+	// single precision falls back to double precision without fftw3f
+	precision = LIBSAKURA_SYMBOL(FFTPrecision_kDouble);
+#endif
 	std::unique_ptr<LIBSAKURA_SYMBOL(Convolve1DContextFloat),
 	LIBSAKURA_PREFIX::Memory> work_context(
 			static_cast<LIBSAKURA_SYMBOL(Convolve1DContextFloat)*>(LIBSAKURA_PREFIX::Memory::Allocate(
@@ -249,18 +671,8 @@ inline void CreateConvolve1DContextFFTFloat(size_t num_kernel,
 	if (ffted_kernel == nullptr) {
 		throw std::bad_alloc();
 	}
-	std::unique_ptr<fftw_complex[], decltype(&FreeFFTArray)> ffted_convolve_data(
-			AllocateFFTArray(num_fft_kernel), FreeFFTArray);
-	if (ffted_convolve_data == nullptr) {
-		throw std::bad_alloc();
-	}
-	std::unique_ptr<fftw_complex[], decltype(&FreeFFTArray)> ffted_input_data(
-			AllocateFFTArray(num_fft_kernel), FreeFFTArray);
-	if (ffted_input_data == nullptr) {
-		throw std::bad_alloc();
-	}
 
-	// FFT kernel array
+	// FFT kernel array in double precision regardless of precision
 	{
 		FlipData1D(num_kernel, kernel, real_array);
 		fftw_plan plan_r2c_kernel = fftw_plan_dft_r2c_1d(num_kernel, real_array,
@@ -272,98 +684,51 @@ inline void CreateConvolve1DContextFFTFloat(size_t num_kernel,
 		fftw_execute(plan_r2c_kernel);
 		DestroyFFTPlan(plan_r2c_kernel);
 	}
-
-	// Create plan for forward/backward FFT
-	fftw_plan plan_r2c = fftw_plan_dft_r2c_1d(num_kernel, real_array,
-			ffted_input_data.get(),
-			FFTW_ESTIMATE | FFTW_PRESERVE_INPUT);
-	ScopeGuard guard_for_fft_plan([&]() {
-		DestroyFFTPlan(plan_r2c);
-	});
-	if (plan_r2c == nullptr) {
-		guard_for_fft_plan.Disable();
-		throw std::bad_alloc();
-	}
-	fftw_plan plan_c2r = fftw_plan_dft_c2r_1d(num_kernel,
-			ffted_convolve_data.get(), real_array,
-			FFTW_ESTIMATE | FFTW_DESTROY_INPUT);
-	ScopeGuard guard_for_ifft_plan([&]() {
-		DestroyFFTPlan(plan_c2r);
-	});
-	if (plan_c2r == nullptr) {
-		guard_for_ifft_plan.Disable();
-		throw std::bad_alloc();
+	// normalization of backward FFT is applied to the kernel in advance
+	double const scale = 1.0 / static_cast<double>(num_kernel);
+	for (size_t i = 0; i < num_fft_kernel; ++i) {
+		ffted_kernel[i][0] *= scale;
+		ffted_kernel[i][1] *= scale;
 	}
 
+	// Create plans for forward/backward FFT
 	work_context->num_kernel = num_kernel;
-	work_context->plan_r2c = plan_r2c;
-	work_context->plan_c2r = plan_c2r;
-	work_context->ffted_kernel = ffted_kernel.release();
-	work_context->ffted_input_data = ffted_input_data.release();
-	work_context->ffted_convolve_data = ffted_convolve_data.release();
-	work_context->real_array = real_array;
-	work_context->real_array_work = real_array_work.release();
-	guard_for_fft_plan.Disable();
-	guard_for_ifft_plan.Disable();
+	work_context->precision = precision;
+	ScopeGuard guard_for_convolver([&]() {
+		DestroyConvolve1DContextFloat(work_context.release());
+	});
+#if LIBSAKURA_HAS_FFTW3F
+	if (precision == LIBSAKURA_SYMBOL(FFTPrecision_kSingle)) {
+		work_context->single_convolver.Initialize(num_kernel, num_batch,
+				ffted_kernel.get());
+	} else
+#endif
+	{
+		work_context->double_convolver.Initialize(num_kernel, num_batch,
+				ffted_kernel.get());
+	}
+	guard_for_convolver.Disable();
 	*context = work_context.release();
 }
 
 inline void ConvolutionWithFFT(
-LIBSAKURA_SYMBOL(Convolve1DContextFloat) const *context, size_t num_data,
-		float const input_data_arg[/*num_data*/],
-		float output_data_arg[/*num_data*/]) {
+LIBSAKURA_SYMBOL(Convolve1DContextFloat) const *context, size_t num_spectra,
+		size_t num_data, float const input_data_arg[/*num_spectra*num_data*/],
+		float output_data_arg[/*num_spectra*num_data*/]) {
 	assert(context->num_kernel == num_data);
 	assert(LIBSAKURA_SYMBOL(IsAligned)(input_data_arg));
 	assert(LIBSAKURA_SYMBOL(IsAligned)(output_data_arg));
 	auto input_data = AssumeAligned(input_data_arg);
 	auto output_data = AssumeAligned(output_data_arg);
-	size_t num_fft_data = num_data / 2 + 1;
-
-	// working arrays
-	auto work_data = AssumeAligned(context->real_array);
-	auto ffted_input_data = context->ffted_input_data;
-	auto ffted_convolve_data = context->ffted_convolve_data;
-
-	// copy input data to working array (float -> double)
-	for (size_t i = 0; i < num_data; ++i) {
-		work_data[i] = input_data[i];
-	}
-
-	// FFT input data
-	fftw_execute_dft_r2c(context->plan_r2c, work_data, ffted_input_data);
-
-	// data multiplication in Fourier domain
-	float scale = 1.0f / static_cast<float>(num_data);
-	for (size_t i = 0; i < num_fft_data; ++i) {
-		ffted_convolve_data[i][0] = (context->ffted_kernel[i][0]
-				* ffted_input_data[i][0]
-				- context->ffted_kernel[i][1] * ffted_input_data[i][1]) * scale;
-		ffted_convolve_data[i][1] = (context->ffted_kernel[i][0]
-				* ffted_input_data[i][1]
-				+ context->ffted_kernel[i][1] * ffted_input_data[i][0]) * scale;
-	}
-
-	// inverse FFT of multiplied data
-	fftw_execute_dft_c2r(context->plan_c2r, ffted_convolve_data, work_data);
-
-	// substitute into output data (double -> float)
-	for (size_t i = 0; i < num_data; ++i) {
-		output_data[i] = work_data[i];
-	}
-}
-
-inline void DestroyConvolve1DContextFloat(
-LIBSAKURA_SYMBOL(Convolve1DContextFloat)* context) {
-	if (context != nullptr) {
-		DestroyFFTPlan(context->plan_r2c);
-		DestroyFFTPlan(context->plan_c2r);
-		FreeFFTArray(context->ffted_kernel);
-		FreeFFTArray(context->ffted_input_data);
-		FreeFFTArray(context->ffted_convolve_data);
-		if (context->real_array_work != nullptr) {
-			LIBSAKURA_PREFIX::Memory::Free(context->real_array_work);
-		}
-		LIBSAKURA_PREFIX::Memory::Free(context);
+#if LIBSAKURA_HAS_FFTW3F
+	if (context->precision == LIBSAKURA_SYMBOL(FFTPrecision_kSingle)) {
+		context->single_convolver.Convolve(num_spectra, num_data, input_data,
+				output_data);
+	} else
+#endif
+	{
+		context->double_convolver.Convolve(num_spectra, num_data, input_data,
+				output_data);
 	}
 }
 
@@ -382,7 +747,7 @@ LIBSAKURA_SYMBOL(Convolve1DContextFloat)* context) {
 	} \
 } while (false)
 
-extern "C" LIBSAKURA_SYMBOL(Status) LIBSAKURA_SYMBOL(CreateGaussianKernelFloat)(
+extern "C" LIBSAKURA_SYMBOL(Status) LIBSAKURA_ARCH_SYMBOL(CreateGaussianKernelFloat)(
 		float peak_location, float kernel_width, size_t num_kernel,
 		float kernel[]) noexcept {
 	CHECK_ARGS(0 < num_kernel && num_kernel <= INT_MAX);
@@ -406,7 +771,7 @@ extern "C" LIBSAKURA_SYMBOL(Status) LIBSAKURA_SYMBOL(CreateGaussianKernelFloat)(
 	return LIBSAKURA_SYMBOL(Status_kOK);
 }
 
-extern "C" LIBSAKURA_SYMBOL(Status) LIBSAKURA_SYMBOL(CreateConvolve1DContextFFTFloat)(
+extern "C" LIBSAKURA_SYMBOL(Status) LIBSAKURA_ARCH_SYMBOL(CreateConvolve1DContextFFTFloat)(
 		size_t num_kernel, float const kernel[/*num_kernel*/],
 		LIBSAKURA_SYMBOL(Convolve1DContextFloat) **context) noexcept {
 	CHECK_ARGS_WITH_MESSAGE(context != nullptr, "context should not be NULL");
@@ -417,7 +782,8 @@ extern "C" LIBSAKURA_SYMBOL(Status) LIBSAKURA_SYMBOL(CreateConvolve1DContextFFTF
 	CHECK_ARGS_WITH_MESSAGE(LIBSAKURA_SYMBOL(IsAligned)(kernel),
 			"kernel should be aligned");
 	try {
-		CreateConvolve1DContextFFTFloat(num_kernel, kernel, context);
+		CreateConvolve1DContextFFTFloat(num_kernel, kernel, 1,
+				LIBSAKURA_SYMBOL(FFTPrecision_kDouble), context);
 	} catch (const std::bad_alloc &e) {
 		LOG4CXX_ERROR(logger, "Memory allocation failed");
 		return LIBSAKURA_SYMBOL(Status_kNoMemory);
@@ -431,11 +797,13 @@ extern "C" LIBSAKURA_SYMBOL(Status) LIBSAKURA_SYMBOL(CreateConvolve1DContextFFTF
 	return LIBSAKURA_SYMBOL(Status_kOK);
 }
 
-extern "C" LIBSAKURA_SYMBOL(Status) LIBSAKURA_SYMBOL(Convolve1DFloat)(
+extern "C" LIBSAKURA_SYMBOL(Status) LIBSAKURA_ARCH_SYMBOL(Convolve1DFloat)(
 		size_t num_kernel, float const kernel[/*num_kernel*/], size_t num_data,
 		float const input_data[/*num_data*/],
 		bool const input_mask[/*num_data*/], float output_data[/*num_data*/],
 		float output_weight[/*num_data*/]) noexcept {
+	LIBSAKURA_PROFILE_KERNEL(Convolve1DFloat,
+			num_data * (sizeof(float) + sizeof(bool)));
 	CHECK_ARGS_WITH_MESSAGE(0 < num_kernel && num_kernel <= INT_MAX,
 			"num_data must be 0 < num_kernel <= INT_MAX");
 	CHECK_ARGS_WITH_MESSAGE(0 < num_data && num_data <= INT_MAX,
@@ -472,10 +840,11 @@ extern "C" LIBSAKURA_SYMBOL(Status) LIBSAKURA_SYMBOL(Convolve1DFloat)(
 	return LIBSAKURA_SYMBOL(Status_kOK);
 }
 
-extern "C" LIBSAKURA_SYMBOL(Status) LIBSAKURA_SYMBOL(Convolve1DFFTFloat)(
+extern "C" LIBSAKURA_SYMBOL(Status) LIBSAKURA_ARCH_SYMBOL(Convolve1DFFTFloat)(
 LIBSAKURA_SYMBOL(Convolve1DContextFloat) const *context, size_t num_data,
 		float const input_data[/*num_data*/], float output_data[/*num_data*/])
 				noexcept {
+	LIBSAKURA_PROFILE_KERNEL(Convolve1DFFTFloat, num_data * sizeof(float));
 	CHECK_ARGS_WITH_MESSAGE(context != nullptr, "context should not be NULL");
 	CHECK_ARGS_WITH_MESSAGE(0 < num_data && num_data <= INT_MAX,
 			"num_data must be 0 < num_data <= INT_MAX");
@@ -490,7 +859,7 @@ LIBSAKURA_SYMBOL(Convolve1DContextFloat) const *context, size_t num_data,
 	//assert(fftw_alignment_of((double *)input_data) == 0);
 	//assert(fftw_alignment_of((double *)output_data) == 0);
 	try {
-		ConvolutionWithFFT(context, num_data, input_data, output_data);
+		ConvolutionWithFFT(context, 1, num_data, input_data, output_data);
 	} catch (const std::bad_alloc &e) {
 		LOG4CXX_ERROR(logger, "Memory allocation failed");
 		return LIBSAKURA_SYMBOL(Status_kNoMemory);
@@ -501,7 +870,75 @@ LIBSAKURA_SYMBOL(Convolve1DContextFloat) const *context, size_t num_data,
 	return LIBSAKURA_SYMBOL(Status_kOK);
 }
 
-extern "C" LIBSAKURA_SYMBOL(Status) LIBSAKURA_SYMBOL(DestroyConvolve1DContextFloat)(
+extern "C" LIBSAKURA_SYMBOL(Status) LIBSAKURA_ARCH_SYMBOL(CreateConvolve1DContextFFTBatchFloat)(
+		size_t num_kernel, float const kernel[/*num_kernel*/], size_t num_batch,
+		LIBSAKURA_SYMBOL(FFTPrecision) precision,
+		LIBSAKURA_SYMBOL(Convolve1DContextFloat) **context) noexcept {
+	CHECK_ARGS_WITH_MESSAGE(context != nullptr, "context should not be NULL");
+	*context = nullptr;
+	CHECK_ARGS_WITH_MESSAGE(0 < num_kernel && num_kernel <= INT_MAX,
+			"num_kernel must satisfy '0 < num_kernel <= INT_MAX'");
+	CHECK_ARGS_WITH_MESSAGE(kernel != nullptr, "kernel should not be NULL");
+	CHECK_ARGS_WITH_MESSAGE(LIBSAKURA_SYMBOL(IsAligned)(kernel),
+			"kernel should be aligned");
+	CHECK_ARGS_WITH_MESSAGE(0 < num_batch && num_batch <= INT_MAX,
+			"num_batch must satisfy '0 < num_batch <= INT_MAX'");
+	CHECK_ARGS_WITH_MESSAGE(
+			num_batch <= SIZE_MAX / sizeof(double) / (num_kernel + 2),
+			"num_batch is too large");
+	CHECK_ARGS_WITH_MESSAGE(
+			precision == LIBSAKURA_SYMBOL(FFTPrecision_kDouble)
+					|| precision == LIBSAKURA_SYMBOL(FFTPrecision_kSingle),
+			"invalid precision");
+	try {
+		CreateConvolve1DContextFFTFloat(num_kernel, kernel, num_batch,
+				precision, context);
+	} catch (const std::bad_alloc &e) {
+		LOG4CXX_ERROR(logger, "Memory allocation failed");
+		return LIBSAKURA_SYMBOL(Status_kNoMemory);
+	} catch (const std::runtime_error &e) {
+		LOG4CXX_ERROR(logger, e.what());
+		return LIBSAKURA_SYMBOL(Status_kNG);
+	} catch (...) {
+		assert(false);
+		return LIBSAKURA_SYMBOL(Status_kUnknownError);
+	}
+	return LIBSAKURA_SYMBOL(Status_kOK);
+}
+
+extern "C" LIBSAKURA_SYMBOL(Status) LIBSAKURA_ARCH_SYMBOL(Convolve1DFFTBatchFloat)(
+LIBSAKURA_SYMBOL(Convolve1DContextFloat) const *context, size_t num_spectra,
+		size_t num_data, float const input_data[/*num_spectra*num_data*/],
+		float output_data[/*num_spectra*num_data*/]) noexcept {
+	LIBSAKURA_PROFILE_KERNEL(Convolve1DFFTBatchFloat,
+			num_spectra * num_data * sizeof(float));
+	CHECK_ARGS_WITH_MESSAGE(context != nullptr, "context should not be NULL");
+	CHECK_ARGS_WITH_MESSAGE(0 < num_data && num_data <= INT_MAX,
+			"num_data must be 0 < num_data <= INT_MAX");
+	CHECK_ARGS_WITH_MESSAGE(context->num_kernel == num_data,
+			"using FFT for convolution. num_data must be equal to the one in the context");
+	CHECK_ARGS_WITH_MESSAGE(num_spectra <= SIZE_MAX / num_data,
+			"num_spectra is too large");
+	if (num_spectra == 0) {
+		return LIBSAKURA_SYMBOL(Status_kOK);
+	}
+	CHECK_ARGS_WITH_MESSAGE(
+			input_data != nullptr && LIBSAKURA_SYMBOL(IsAligned)(input_data),
+			"invalid input_data");
+	CHECK_ARGS_WITH_MESSAGE(
+			output_data != nullptr && LIBSAKURA_SYMBOL(IsAligned)(output_data),
+			"invalid output_data");
+	try {
+		ConvolutionWithFFT(context, num_spectra, num_data, input_data,
+				output_data);
+	} catch (...) {
+		assert(false);
+		return LIBSAKURA_SYMBOL(Status_kUnknownError);
+	}
+	return LIBSAKURA_SYMBOL(Status_kOK);
+}
+
+extern "C" LIBSAKURA_SYMBOL(Status) LIBSAKURA_ARCH_SYMBOL(DestroyConvolve1DContextFloat)(
 LIBSAKURA_SYMBOL(Convolve1DContextFloat) *context) noexcept {
 	if (context == nullptr) {
 		return LIBSAKURA_SYMBOL(Status_kInvalidArgument);
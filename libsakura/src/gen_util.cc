@@ -34,7 +34,11 @@
 #include <string>
 #include <memory>
 #include <algorithm>
+#include <atomic>
 #include <chrono>
+#include <mutex>
+#include <new>
+#include <type_traits>
 
 #if LIBSAKURA_HAS_LOG4CXX
 #include <log4cxx/propertyconfigurator.h>
@@ -44,6 +48,9 @@
 #include "libsakura/localdef.h"
 #include "libsakura/logger.h"
 #include "libsakura/memory_manager.h"
+#if defined(ARCH_DISPATCH)
+#include "libsakura/arch_dispatch.h"
+#endif
 
 namespace {
 
@@ -60,6 +67,417 @@ void DefaultFree(void *ptr) {
 	free(ptr);
 }
 
+/**
+ * @brief Header placed in front of each pooled block.
+ *
+ * Direct blocks have no header. The size of the header is a multiple of any
+ * alignment Sakura uses, so that the block is aligned if the address returned
+ * by the user allocator is aligned.
+ */
+struct BlockHeader {
+	/**
+	 * @brief The deallocator to release the block to.
+	 *
+	 * It is kept per block because blocks may be freed after the library
+	 * is initialized again with another deallocator.
+	 */
+	LIBSAKURA_SYMBOL(UserDeallocator) deallocator;
+	/**
+	 * @brief The next block in the free list.
+	 */
+	BlockHeader *next;
+	/**
+	 * @brief Index of the size class.
+	 */
+	size_t size_class;
+};
+
+constexpr size_t kBlockHeaderSize = 64;
+STATIC_ASSERT(sizeof(BlockHeader) <= kBlockHeaderSize);
+STATIC_ASSERT(kBlockHeaderSize % LIBSAKURA_ALIGNMENT == 0);
+
+inline BlockHeader *HeaderOf(void *ptr) {
+	return reinterpret_cast<BlockHeader *>(static_cast<char *>(ptr)
+			- kBlockHeaderSize);
+}
+
+inline void *BodyOf(BlockHeader *block) {
+	return reinterpret_cast<char *>(block) + kBlockHeaderSize;
+}
+
+/**
+ * @brief Addresses at or above 2^kMaxAddressBits are never pooled.
+ */
+constexpr size_t kMaxAddressBits = 48;
+/**
+ * @brief PooledBlockMap has a bit per 2^kMapGranularityBits bytes.
+ */
+constexpr size_t kMapGranularityBits = 6;
+constexpr size_t kMapLeafBits = 14;
+constexpr size_t kMapMiddleBits = 14;
+constexpr size_t kMapRootBits = kMaxAddressBits - kMapGranularityBits
+		- kMapMiddleBits - kMapLeafBits;
+// two blocks never share a bit, since a pooled block follows its header
+STATIC_ASSERT(
+		kBlockHeaderSize >= (static_cast<size_t>(1) << kMapGranularityBits));
+
+/**
+ * @brief Set of the addresses of pooled blocks.
+ *
+ * Memory::Free looks up a block in this set to know if it is pooled, since
+ * direct blocks have no header to tell it. The set is a radix tree of bits
+ * indexed by an address in units of 2^kMapGranularityBits bytes. Nodes are
+ * created on demand and never released. Lookups take no lock.
+ */
+class PooledBlockMap {
+public:
+	bool Contains(void const *ptr) const noexcept {
+		uintptr_t const key = KeyOf(ptr);
+		if (key >> (kMapRootBits + kMapMiddleBits + kMapLeafBits) != 0) {
+			return false;
+		}
+		Middle *middle = root_[key >> (kMapMiddleBits + kMapLeafBits)].load(
+				std::memory_order_acquire);
+		if (middle == nullptr) {
+			return false;
+		}
+		Leaf *leaf = middle->leaves[(key >> kMapLeafBits) & kMiddleMask].load(
+				std::memory_order_acquire);
+		if (leaf == nullptr) {
+			return false;
+		}
+		return (leaf->words[WordOf(key)].load(std::memory_order_relaxed)
+				& BitOf(key)) != 0;
+	}
+	/**
+	 * @brief Adds @a ptr to the set.
+	 * @return false if @a ptr cannot be added.
+	 */
+	bool Insert(void const *ptr) noexcept {
+		uintptr_t const key = KeyOf(ptr);
+		Leaf *leaf = GetOrCreateLeaf(key);
+		if (leaf == nullptr) {
+			return false;
+		}
+		leaf->words[WordOf(key)].fetch_or(BitOf(key), std::memory_order_relaxed);
+		return true;
+	}
+	void Erase(void const *ptr) noexcept {
+		assert(Contains(ptr));
+		uintptr_t const key = KeyOf(ptr);
+		Leaf *leaf = root_[key >> (kMapMiddleBits + kMapLeafBits)].load(
+				std::memory_order_acquire)->leaves[(key >> kMapLeafBits)
+				& kMiddleMask].load(std::memory_order_acquire);
+		leaf->words[WordOf(key)].fetch_and(~BitOf(key),
+				std::memory_order_relaxed);
+	}
+private:
+	static constexpr uintptr_t kMiddleMask = (static_cast<uintptr_t>(1)
+			<< kMapMiddleBits) - 1;
+	static constexpr uintptr_t kLeafMask = (static_cast<uintptr_t>(1)
+			<< kMapLeafBits) - 1;
+	struct Leaf {
+		std::atomic<uint64_t> words[(static_cast<size_t>(1) << kMapLeafBits)
+				/ 64];
+	};
+	struct Middle {
+		std::atomic<Leaf *> leaves[static_cast<size_t>(1) << kMapMiddleBits];
+	};
+
+	static uintptr_t KeyOf(void const *ptr) noexcept {
+		return reinterpret_cast<uintptr_t>(ptr) >> kMapGranularityBits;
+	}
+	static size_t WordOf(uintptr_t key) noexcept {
+		return (key & kLeafMask) / 64;
+	}
+	static uint64_t BitOf(uintptr_t key) noexcept {
+		return static_cast<uint64_t>(1) << (key % 64);
+	}
+	template<typename Node>
+	Node *GetOrCreate(std::atomic<Node *> &slot) noexcept {
+		Node *node = slot.load(std::memory_order_acquire);
+		if (node == nullptr) {
+			std::lock_guard<std::mutex> lock(mutex_);
+			node = slot.load(std::memory_order_relaxed);
+			if (node == nullptr) {
+				// value-initialization zero-fills the atomics
+				node = new (std::nothrow) Node();
+				slot.store(node, std::memory_order_release);
+			}
+		}
+		return node;
+	}
+	Leaf *GetOrCreateLeaf(uintptr_t key) noexcept {
+		if (key >> (kMapRootBits + kMapMiddleBits + kMapLeafBits) != 0) {
+			return nullptr;
+		}
+		Middle *middle = GetOrCreate(
+				root_[key >> (kMapMiddleBits + kMapLeafBits)]);
+		if (middle == nullptr) {
+			return nullptr;
+		}
+		return GetOrCreate(middle->leaves[(key >> kMapLeafBits) & kMiddleMask]);
+	}
+
+	std::mutex mutex_;
+	std::atomic<Middle *> root_[static_cast<size_t>(1) << kMapRootBits];
+};
+
+PooledBlockMap pooled_blocks;
+
+/**
+ * @brief log2 of the size of the smallest size class.
+ */
+constexpr size_t kMinSizeClassBits = 6;
+/**
+ * @brief The number of size classes. The largest one is 1 MiB.
+ * Larger blocks are not pooled.
+ */
+constexpr size_t kNumSizeClasses = 15;
+/**
+ * @brief Each thread caches up to this size of free blocks per size class.
+ */
+constexpr size_t kMaxCachedBytesPerClass = 1024 * 1024;
+/**
+ * @brief The number of free blocks cached per size class is limited to
+ * [kMinCachedBlocks, kMaxCachedBlocks].
+ */
+constexpr size_t kMinCachedBlocks = 2;
+constexpr size_t kMaxCachedBlocks = 64;
+
+inline size_t SizeOfClass(size_t size_class) {
+	return static_cast<size_t>(1) << (size_class + kMinSizeClassBits);
+}
+
+inline size_t SizeClassOf(size_t size) {
+	size_t size_class = 0;
+	while (size_class < kNumSizeClasses && SizeOfClass(size_class) < size) {
+		++size_class;
+	}
+	return size_class;
+}
+
+inline size_t MaxCachedBlocks(size_t size_class) {
+	return std::min(kMaxCachedBlocks,
+			std::max(kMinCachedBlocks,
+					kMaxCachedBytesPerClass / SizeOfClass(size_class)));
+}
+
+/**
+ * @brief Allocation counters of a thread.
+ *
+ * Only the owner thread updates the counters, so that no atomic
+ * read-modify-write is needed. Other threads only read them.
+ */
+struct MemoryCounters {
+	std::atomic<uint64_t> num_allocations;
+	std::atomic<uint64_t> num_frees;
+	std::atomic<uint64_t> num_pool_hits;
+	std::atomic<uint64_t> num_upstream_allocations;
+	std::atomic<uint64_t> num_upstream_frees;
+};
+
+inline void Increment(std::atomic<uint64_t> &counter) {
+	counter.store(counter.load(std::memory_order_relaxed) + 1,
+			std::memory_order_relaxed);
+}
+
+inline void AddTo(MemoryCounters const &counters,
+LIBSAKURA_SYMBOL(MemoryStatistics) *statistics) {
+	statistics->num_allocations += counters.num_allocations.load(
+			std::memory_order_relaxed);
+	statistics->num_frees += counters.num_frees.load(std::memory_order_relaxed);
+	statistics->num_pool_hits += counters.num_pool_hits.load(
+			std::memory_order_relaxed);
+	statistics->num_upstream_allocations +=
+			counters.num_upstream_allocations.load(std::memory_order_relaxed);
+	statistics->num_upstream_frees += counters.num_upstream_frees.load(
+			std::memory_order_relaxed);
+}
+
+class ThreadCache;
+
+/**
+ * @brief Guards the list of live thread caches and @ref retired_counters.
+ */
+std::mutex thread_cache_mutex;
+ThreadCache *thread_cache_list = nullptr;
+/**
+ * @brief Sum of the counters of exited threads.
+ */
+LIBSAKURA_SYMBOL(MemoryStatistics) retired_counters = { 0, 0, 0, 0, 0 };
+
+/**
+ * @brief Free lists and counters of a thread.
+ */
+class ThreadCache {
+public:
+	ThreadCache() :
+			counters_(), previous_(nullptr), next_(nullptr) {
+		for (size_t i = 0; i < kNumSizeClasses; ++i) {
+			free_list_[i] = nullptr;
+			num_cached_[i] = 0;
+		}
+		std::lock_guard<std::mutex> lock(thread_cache_mutex);
+		next_ = thread_cache_list;
+		if (next_ != nullptr) {
+			next_->previous_ = this;
+		}
+		thread_cache_list = this;
+	}
+	~ThreadCache() {
+		Flush();
+		std::lock_guard<std::mutex> lock(thread_cache_mutex);
+		AddTo(counters_, &retired_counters);
+		if (previous_ != nullptr) {
+			previous_->next_ = next_;
+		} else {
+			thread_cache_list = next_;
+		}
+		if (next_ != nullptr) {
+			next_->previous_ = previous_;
+		}
+	}
+	ThreadCache(ThreadCache const &) = delete;
+	ThreadCache &operator=(ThreadCache const &) = delete;
+
+	/**
+	 * @brief Allocates a block of the size class of @a size.
+	 * @return nullptr if the block is not allocated.
+	 */
+	void *Allocate(size_t size, LIBSAKURA_SYMBOL(UserAllocator) allocator,
+	LIBSAKURA_SYMBOL(UserDeallocator) deallocator) noexcept {
+		size_t const size_class = SizeClassOf(size);
+		assert(size_class < kNumSizeClasses);
+		BlockHeader *block = free_list_[size_class];
+		if (block != nullptr) {
+			free_list_[size_class] = block->next;
+			--num_cached_[size_class];
+			Increment(counters_.num_allocations);
+			Increment(counters_.num_pool_hits);
+			return BodyOf(block);
+		}
+		block = static_cast<BlockHeader *>(allocator(
+				kBlockHeaderSize + SizeOfClass(size_class)));
+		if (block == nullptr) {
+			return nullptr;
+		}
+		Increment(counters_.num_upstream_allocations);
+		block->deallocator = deallocator;
+		block->next = nullptr;
+		block->size_class = size_class;
+		if (!pooled_blocks.Insert(BodyOf(block))) {
+			Increment(counters_.num_upstream_frees);
+			deallocator(block);
+			return nullptr;
+		}
+		Increment(counters_.num_allocations);
+		return BodyOf(block);
+	}
+	void Free(BlockHeader *block) noexcept {
+		assert(block != nullptr && pooled_blocks.Contains(BodyOf(block)));
+		Increment(counters_.num_frees);
+		size_t const size_class = block->size_class;
+		if (num_cached_[size_class] < MaxCachedBlocks(size_class)) {
+			block->next = free_list_[size_class];
+			free_list_[size_class] = block;
+			++num_cached_[size_class];
+			return;
+		}
+		Release(block);
+	}
+	/**
+	 * @brief Release all the cached blocks to their deallocators.
+	 */
+	void Flush() noexcept {
+		for (size_t i = 0; i < kNumSizeClasses; ++i) {
+			while (free_list_[i] != nullptr) {
+				BlockHeader *block = free_list_[i];
+				free_list_[i] = block->next;
+				Release(block);
+			}
+			num_cached_[i] = 0;
+		}
+	}
+	MemoryCounters &counters() noexcept {
+		return counters_;
+	}
+	ThreadCache *next() const noexcept {
+		return next_;
+	}
+private:
+	void Release(BlockHeader *block) noexcept {
+		Increment(counters_.num_upstream_frees);
+		pooled_blocks.Erase(BodyOf(block));
+		block->deallocator(block);
+	}
+
+	MemoryCounters counters_;
+	BlockHeader *free_list_[kNumSizeClasses];
+	size_t num_cached_[kNumSizeClasses];
+	ThreadCache *previous_;
+	ThreadCache *next_;
+};
+
+/**
+ * @brief true after the cache of the calling thread is destroyed.
+ *
+ * It is trivially destructible, so that it is still valid while the other
+ * thread local and static objects are destroyed.
+ */
+thread_local bool is_thread_cache_destroyed = false;
+
+class ThreadLocalCache: public ThreadCache {
+public:
+	~ThreadLocalCache() {
+		is_thread_cache_destroyed = true;
+	}
+};
+
+/**
+ * @brief Guards the shared cache.
+ */
+std::mutex shared_cache_mutex;
+std::aligned_storage<sizeof(ThreadCache), alignof(ThreadCache)>::type shared_cache_storage;
+
+/**
+ * @brief Returns the cache shared by the threads whose own cache is destroyed.
+ *
+ * It is never destroyed, so that blocks freed by static destructors are
+ * returned to it. The caller must hold @ref shared_cache_mutex.
+ */
+ThreadCache &GetSharedCache() {
+	static ThreadCache *const cache = new (&shared_cache_storage) ThreadCache();
+	return *cache;
+}
+
+/**
+ * @brief Returns the cache of the calling thread, or nullptr if it is
+ * already destroyed.
+ */
+ThreadCache *GetThreadCache() {
+	if (is_thread_cache_destroyed) {
+		return nullptr;
+	}
+	static thread_local ThreadLocalCache cache;
+	return &cache;
+}
+
+/**
+ * @brief Calls @a func with the cache of the calling thread, or with the
+ * shared cache if the cache of the calling thread is already destroyed.
+ */
+template<typename Func>
+inline void WithThreadCache(Func func) {
+	ThreadCache *cache = GetThreadCache();
+	if (cache != nullptr) {
+		func(*cache);
+	} else {
+		std::lock_guard<std::mutex> lock(shared_cache_mutex);
+		func(GetSharedCache());
+	}
+}
+
 } /* namespace */
 
 namespace LIBSAKURA_PREFIX {
@@ -77,33 +495,85 @@ namespace LIBSAKURA_PREFIX {
 
 LIBSAKURA_SYMBOL(UserAllocator) Memory::allocator_;
 LIBSAKURA_SYMBOL(UserDeallocator) Memory::deallocator_;
+bool Memory::use_pool_ = false;
 
 void * Memory::Allocate(size_t size) noexcept {
-	void *ptr = allocator_(size);
+	void *ptr = nullptr;
+	if (use_pool_ && SizeClassOf(size) < kNumSizeClasses) {
+		WithThreadCache([&](ThreadCache &cache) {
+			ptr = cache.Allocate(size, allocator_, deallocator_);
+		});
+	}
+	if (ptr == nullptr) {
+		// large blocks and blocks that cannot be pooled are allocated directly
+		ptr = allocator_(size);
+	}
 	LOG4CXX_DEBUG(memory_logger, "Memory::Allocate: " << ptr);
 	return ptr;
 }
 
 void Memory::Free(void *ptr) noexcept {
 	LOG4CXX_DEBUG(memory_logger, "Memory::Free: " << ptr);
-	deallocator_(ptr);
+	if (ptr != nullptr && pooled_blocks.Contains(ptr)) {
+		WithThreadCache([ptr](ThreadCache &cache) {
+			cache.Free(HeaderOf(ptr));
+		});
+	} else {
+		deallocator_(ptr);
+	}
 }
 
 } /* namespace LIBSAKURA_PREFIX */
 
 
-extern "C" LIBSAKURA_SYMBOL(Status) LIBSAKURA_SYMBOL(Initialize)(
+extern "C" LIBSAKURA_SYMBOL(Status) LIBSAKURA_SYMBOL(InitializeWithMemoryPolicy)(
 LIBSAKURA_SYMBOL(UserAllocator) allocator,
-LIBSAKURA_SYMBOL(UserDeallocator) deallocator) noexcept {
+LIBSAKURA_SYMBOL(UserDeallocator) deallocator,
+LIBSAKURA_SYMBOL(MemoryPolicy) policy) noexcept {
+	if (policy != LIBSAKURA_SYMBOL(MemoryPolicy_kDirect)
+			&& policy != LIBSAKURA_SYMBOL(MemoryPolicy_kThreadLocalPool)) {
+		return LIBSAKURA_SYMBOL(Status_kInvalidArgument);
+	}
 	LIBSAKURA_PREFIX::Memory::allocator_ =
 			allocator == nullptr ? DefaultAllocator : allocator;
 	LIBSAKURA_PREFIX::Memory::deallocator_ =
 			deallocator == nullptr ? DefaultFree : deallocator;
+	LIBSAKURA_PREFIX::Memory::use_pool_ = policy
+			== LIBSAKURA_SYMBOL(MemoryPolicy_kThreadLocalPool);
+#if defined(ARCH_DISPATCH)
+	LIBSAKURA_PREFIX::SelectArch();
+#endif
 
 	return LIBSAKURA_SYMBOL(Status_kOK);
 }
 
+extern "C" LIBSAKURA_SYMBOL(Status) LIBSAKURA_SYMBOL(Initialize)(
+LIBSAKURA_SYMBOL(UserAllocator) allocator,
+LIBSAKURA_SYMBOL(UserDeallocator) deallocator) noexcept {
+	return LIBSAKURA_SYMBOL(InitializeWithMemoryPolicy)(allocator, deallocator,
+	LIBSAKURA_SYMBOL(MemoryPolicy_kDirect));
+}
+
 extern "C" void LIBSAKURA_SYMBOL(CleanUp)() noexcept {
+	WithThreadCache([](ThreadCache &cache) {
+		cache.Flush();
+	});
+	std::lock_guard<std::mutex> lock(shared_cache_mutex);
+	GetSharedCache().Flush();
+}
+
+extern "C" LIBSAKURA_SYMBOL(Status) LIBSAKURA_SYMBOL(GetMemoryStatistics)(
+LIBSAKURA_SYMBOL(MemoryStatistics) *statistics) noexcept {
+	if (statistics == nullptr) {
+		return LIBSAKURA_SYMBOL(Status_kInvalidArgument);
+	}
+	std::lock_guard<std::mutex> lock(thread_cache_mutex);
+	*statistics = retired_counters;
+	for (ThreadCache *cache = thread_cache_list; cache != nullptr;
+			cache = cache->next()) {
+		AddTo(cache->counters(), statistics);
+	}
+	return LIBSAKURA_SYMBOL(Status_kOK);
 }
 
 extern "C" size_t LIBSAKURA_SYMBOL (GetAlignment)() noexcept {
@@ -27,10 +27,16 @@
 #include <cassert>
 #include <cmath>
 #include <climits>
+#include <algorithm>
+#include <memory>
+#include <thread>
 
 #include "libsakura/sakura.h"
+#include "libsakura/concurrent.h"
 #include "libsakura/localdef.h"
+#include "libsakura/memory_manager.h"
 #include "libsakura/packed_type.h"
+#include "libsakura/profiler.h"
 
 namespace {
 #include "libsakura/packed_operation.h"
@@ -264,7 +270,8 @@ inline void Grid(integer locx, integer locy, integer const doubled_support,
 		integer num_convolution_table/*= sqrt(2)*support*sampling + extra*/,
 		float const convolution_table_arg[/*num_convolution_table*/],
 		integer num_polarization_for_grid, integer num_channels_for_grid,
-		integer const width, integer const height,
+		integer const width, integer const height, integer const begin_y,
+		integer const end_y,
 		double weight_sum_arg/*[num_polarization_for_grid]*/[/*num_channels_for_grid*/],
 		float weight_of_grid_arg/*[height][width][num_polarization_for_grid]*/[/*num_channels_for_grid*/],
 		float grid_arg/*[height][width][num_polarization_for_grid]*/[/*num_channels_for_grid*/]) {
@@ -277,9 +284,12 @@ inline void Grid(integer locx, integer locy, integer const doubled_support,
 	auto weight_of_grid = AssumeAligned(weight_of_grid_arg);
 	auto grid = AssumeAligned(grid_arg);
 
-	size_t ir = 0;
+	// only rows in [begin_y, end_y) are updated.
+	integer const iy_begin = std::max(0, begin_y - locy);
+	integer const iy_end = std::min(doubled_support, end_y - locy);
+	size_t ir = iy_begin * doubled_support;
 
-	for (integer iy = 0; iy < doubled_support; ++iy) {
+	for (integer iy = iy_begin; iy < iy_end; ++iy) {
 		integer ay = locy + iy;
 		for (integer ix = 0; ix < doubled_support; ++ix) {
 			integer ax = locx + ix;
@@ -311,6 +321,198 @@ inline void Grid(integer locx, integer locy, integer const doubled_support,
 	} // iy
 }
 
+template<typename OptimizedImpl>
+inline void GridSpectrum(size_t spectrum, double const x[/*num_spectra*/],
+		double const y[/*num_spectra*/], integer support, integer sampling,
+		integer num_polarization,
+		uint32_t const polarization_map[/*num_polarization*/],
+		integer num_channels, uint32_t const channel_map[/*num_channels*/],
+		bool const mask/*[num_spectra][num_polarization]*/[/*num_channels*/],
+		float const value/*[num_spectra][num_polarization]*/[/*num_channels*/],
+		float const weight/*[num_spectra]*/[/*num_channels*/],
+		integer num_convolution_table/*= sqrt(2)*support*sampling + extra*/,
+		float const convolution_table[/*num_convolution_table*/],
+		integer num_polarization_for_grid, integer num_channels_for_grid,
+		integer width, integer height, integer begin_y, integer end_y,
+		double weight_sum/*[num_polarization_for_grid]*/[/*num_channels_for_grid*/],
+		float weight_of_grid/*[height][width][num_polarization_for_grid]*/[/*num_channels_for_grid*/],
+		float grid/*[height][width][num_polarization_for_grid]*/[/*num_channels_for_grid*/]) {
+	integer const doubled_support = 2 * support + 1;
+	double xy[2] = { x[spectrum], y[spectrum] };
+	integer point[2], offset[2];
+	GridPosition(xy, sampling, point, offset);
+	if (OnGrid(xy, width, height, point, support)) {
+		SIMD_ALIGN
+		size_t integral_radius[Square(doubled_support)];
+		{
+			float initial_relative_location_x = -(support + 1) * sampling
+					+ offset[0];
+			float relative_location_y = -(support + 1) * sampling + offset[1];
+			size_t ir = 0;
+			for (integer iy = 0; iy < doubled_support; ++iy) {
+				relative_location_y += sampling;
+				float relative_location_x = initial_relative_location_x;
+				for (integer ix = 0; ix < doubled_support; ++ix) {
+					relative_location_x += sampling;
+					integral_radius[ir] = static_cast<size_t>(sqrt(
+							Square(relative_location_x)
+									+ Square(relative_location_y)));
+					assert(0 <= num_convolution_table);
+					assert(integral_radius[ir] < static_cast<size_t>(num_convolution_table));
+					++ir;
+				}
+			}
+		}
+
+		Grid<OptimizedImpl>(point[0] - support, point[1] - support,
+				doubled_support, sampling, integral_radius, num_polarization,
+				polarization_map, num_channels, channel_map,
+				&mask[At3(num_polarization, num_channels, spectrum, 0, 0)],
+				&value[At3(num_polarization, num_channels, spectrum, 0, 0)],
+				&weight[At2(num_channels, spectrum, 0)], num_convolution_table,
+				convolution_table, num_polarization_for_grid,
+				num_channels_for_grid, width, height, begin_y, end_y,
+				weight_sum, weight_of_grid, grid);
+	}
+}
+
+/**
+ * The number of tiles per thread.
+ * More tiles than threads are made to balance the load
+ * when spectra are not uniformly distributed on the grid.
+ */
+constexpr size_t kTilesPerThread = 4;
+
+/**
+ * Grids spectra in [@a start_spectrum, @a end_spectrum) using @a num_threads threads.
+ *
+ * The grid is divided into horizontal tiles (ranges of rows) and
+ * each spectrum is binned to the tiles its footprint (2 * @a support + 1 rows) overlaps.
+ * Each tile is processed by exactly one thread which updates only the rows in the tile,
+ * so neither atomic operations nor private copies of @a grid and @a weight_of_grid are needed.
+ * Since spectra in a tile are processed in ascending order,
+ * @a grid and @a weight_of_grid are bit-identical to those of the serial execution.
+ * @a weight_sum is accumulated per tile and the partial sums are added to @a weight_sum in tile order.
+ */
+template<typename OptimizedImpl>
+void InternalGridParallel(size_t num_spectra, size_t start_spectrum,
+		size_t end_spectrum,
+		bool const spectrum_mask[/*num_spectra*/],
+		double const x[/*num_spectra*/],
+		double const y[/*num_spectra*/], integer support, integer sampling,
+		integer num_polarization,
+		uint32_t const polarization_map[/*num_polarization*/],
+		integer num_channels, uint32_t const channel_map[/*num_channels*/],
+		bool const mask/*[num_spectra][num_polarization]*/[/*num_channels*/],
+		float const value/*[num_spectra][num_polarization]*/[/*num_channels*/],
+		float const weight/*[num_spectra]*/[/*num_channels*/],
+		integer num_convolution_table/*= sqrt(2)*support*sampling + extra*/,
+		float const convolution_table[/*num_convolution_table*/],
+		integer num_polarization_for_grid, integer num_channels_for_grid,
+		integer width, integer height, size_t num_threads,
+		double weight_sum/*[num_polarization_for_grid]*/[/*num_channels_for_grid*/],
+		float weight_of_grid/*[height][width][num_polarization_for_grid]*/[/*num_channels_for_grid*/],
+		float grid/*[height][width][num_polarization_for_grid]*/[/*num_channels_for_grid*/]) {
+	assert(num_threads > 1);
+	size_t const num_tiles_max = std::min(static_cast<size_t>(height),
+			num_threads * kTilesPerThread);
+	integer const tile_height = static_cast<integer>((height + num_tiles_max - 1)
+			/ num_tiles_max);
+	size_t const num_tiles = (height + tile_height - 1) / tile_height;
+
+	// bin spectra to tiles. tile_offset[t] is an index of the first spectrum of tile t in spectra_in_tile.
+	size_t *tile_offset = nullptr;
+	std::unique_ptr<void, LIBSAKURA_PREFIX::Memory> storage_for_tile_offset(
+			LIBSAKURA_PREFIX::Memory::AlignedAllocateOrException(
+					sizeof(*tile_offset) * (num_tiles + 1), &tile_offset));
+	std::fill_n(tile_offset, num_tiles + 1, 0);
+	auto tile_range = [&](size_t spectrum, size_t *first, size_t *last) -> bool {
+		if (!spectrum_mask[spectrum]) {
+			return false;
+		}
+		double xy[2] = {x[spectrum], y[spectrum]};
+		integer point[2], offset[2];
+		GridPosition(xy, sampling, point, offset);
+		if (!OnGrid(xy, width, height, point, support)) {
+			return false;
+		}
+		*first = (point[1] - support) / tile_height;
+		*last = (point[1] + support) / tile_height;
+		assert(*last < num_tiles);
+		return true;
+	};
+	for (size_t spectrum = start_spectrum; spectrum < end_spectrum;
+			++spectrum) {
+		size_t first, last;
+		if (tile_range(spectrum, &first, &last)) {
+			for (size_t tile = first; tile <= last; ++tile) {
+				++tile_offset[tile + 1];
+			}
+		}
+	}
+	for (size_t tile = 0; tile < num_tiles; ++tile) {
+		tile_offset[tile + 1] += tile_offset[tile];
+	}
+	size_t *spectra_in_tile = nullptr;
+	std::unique_ptr<void, LIBSAKURA_PREFIX::Memory> storage_for_spectra_in_tile(
+			LIBSAKURA_PREFIX::Memory::AlignedAllocateOrException(
+					sizeof(*spectra_in_tile) * tile_offset[num_tiles],
+					&spectra_in_tile));
+	{
+		size_t *tile_fill = nullptr;
+		std::unique_ptr<void, LIBSAKURA_PREFIX::Memory> storage_for_tile_fill(
+				LIBSAKURA_PREFIX::Memory::AlignedAllocateOrException(
+						sizeof(*tile_fill) * num_tiles, &tile_fill));
+		std::copy(tile_offset, tile_offset + num_tiles, tile_fill);
+		for (size_t spectrum = start_spectrum; spectrum < end_spectrum;
+				++spectrum) {
+			size_t first, last;
+			if (tile_range(spectrum, &first, &last)) {
+				for (size_t tile = first; tile <= last; ++tile) {
+					spectra_in_tile[tile_fill[tile]++] = spectrum;
+				}
+			}
+		}
+	}
+
+	// partial weight_sum for each tile. Its stride is rounded up to keep each part aligned.
+	constexpr size_t kDoublesInAlignment = LIBSAKURA_ALIGNMENT / sizeof(double);
+	size_t const num_weight_sum = static_cast<size_t>(num_polarization_for_grid)
+			* num_channels_for_grid;
+	size_t const weight_sum_stride = (num_weight_sum + kDoublesInAlignment - 1)
+			/ kDoublesInAlignment * kDoublesInAlignment;
+	double *tile_weight_sum = nullptr;
+	std::unique_ptr<void, LIBSAKURA_PREFIX::Memory> storage_for_tile_weight_sum(
+			LIBSAKURA_PREFIX::Memory::AlignedAllocateOrException(
+					sizeof(*tile_weight_sum) * weight_sum_stride * num_tiles,
+					&tile_weight_sum));
+	std::fill_n(tile_weight_sum, weight_sum_stride * num_tiles, 0.);
+
+	concurrent::ParallelFor(num_threads, num_tiles,
+			[&](size_t /*worker*/, size_t tile) {
+				integer const begin_y = static_cast<integer>(tile) * tile_height;
+				integer const end_y = std::min(height, begin_y + tile_height);
+				double *weight_sum_of_tile = &tile_weight_sum[weight_sum_stride * tile];
+				for (size_t i = tile_offset[tile]; i < tile_offset[tile + 1]; ++i) {
+					GridSpectrum<OptimizedImpl>(spectra_in_tile[i], x, y, support,
+							sampling, num_polarization, polarization_map,
+							num_channels, channel_map, mask, value, weight,
+							num_convolution_table, convolution_table,
+							num_polarization_for_grid, num_channels_for_grid, width,
+							height, begin_y, end_y, weight_sum_of_tile,
+							weight_of_grid, grid);
+				}
+			});
+
+	for (size_t tile = 0; tile < num_tiles; ++tile) {
+		double const *weight_sum_of_tile = &tile_weight_sum[weight_sum_stride
+				* tile];
+		for (size_t i = 0; i < num_weight_sum; ++i) {
+			weight_sum[i] += weight_sum_of_tile[i];
+		}
+	}
+}
+
 template<typename OptimizedImpl>
 inline void InternalGrid(size_t num_spectra, size_t start_spectrum,
 		size_t end_spectrum,
@@ -326,56 +528,31 @@ inline void InternalGrid(size_t num_spectra, size_t start_spectrum,
 		integer num_convolution_table/*= sqrt(2)*support*sampling + extra*/,
 		float const convolution_table[/*num_convolution_table*/],
 		integer num_polarization_for_grid, integer num_channels_for_grid,
-		integer width, integer height,
+		integer width, integer height, size_t num_threads,
 		double weight_sum/*[num_polarization_for_grid]*/[/*num_channels_for_grid*/],
 		float weight_of_grid/*[height][width][num_polarization_for_grid]*/[/*num_channels_for_grid*/],
 		float grid/*[height][width][num_polarization_for_grid]*/[/*num_channels_for_grid*/]) {
 
 	auto x = AssumeAligned(x_arg);
 	auto y = AssumeAligned(y_arg);
-	integer const doubled_support = 2 * support + 1;
+	if (num_threads > 1) {
+		InternalGridParallel<OptimizedImpl>(num_spectra, start_spectrum,
+				end_spectrum, spectrum_mask, x, y, support, sampling,
+				num_polarization, polarization_map, num_channels, channel_map,
+				mask, value, weight, num_convolution_table, convolution_table,
+				num_polarization_for_grid, num_channels_for_grid, width, height,
+				num_threads, weight_sum, weight_of_grid, grid);
+		return;
+	}
 	for (size_t spectrum = start_spectrum; spectrum < end_spectrum;
 			++spectrum) {
 		if (spectrum_mask[spectrum]) {
-			double xy[2] = { x[spectrum], y[spectrum] };
-			integer point[2], offset[2];
-			GridPosition(xy, sampling, point, offset);
-			if (OnGrid(xy, width, height, point, support)) {
-				SIMD_ALIGN
-				size_t integral_radius[Square(doubled_support)];
-				{
-					float initial_relative_location_x = -(support + 1)
-							* sampling + offset[0];
-					float relative_location_y = -(support + 1) * sampling
-							+ offset[1];
-					size_t ir = 0;
-					for (integer iy = 0; iy < doubled_support; ++iy) {
-						relative_location_y += sampling;
-						float relative_location_x = initial_relative_location_x;
-						for (integer ix = 0; ix < doubled_support; ++ix) {
-							relative_location_x += sampling;
-							integral_radius[ir] = static_cast<size_t>(sqrt(
-									Square(relative_location_x)
-											+ Square(relative_location_y)));
-                            assert(0 <= num_convolution_table);
-							assert(integral_radius[ir] < static_cast<size_t>(num_convolution_table));
-							++ir;
-						}
-					}
-				}
-
-				Grid<OptimizedImpl>(point[0] - support, point[1] - support,
-						doubled_support, sampling, integral_radius,
-						num_polarization, polarization_map, num_channels,
-						channel_map,
-						&mask[At3(num_polarization, num_channels, spectrum, 0,
-								0)],
-						&value[At3(num_polarization, num_channels, spectrum, 0,
-								0)], &weight[At2(num_channels, spectrum, 0)],
-						num_convolution_table, convolution_table,
-						num_polarization_for_grid, num_channels_for_grid, width,
-						height, weight_sum, weight_of_grid, grid);
-			}
+			GridSpectrum<OptimizedImpl>(spectrum, x, y, support, sampling,
+					num_polarization, polarization_map, num_channels,
+					channel_map, mask, value, weight, num_convolution_table,
+					convolution_table, num_polarization_for_grid,
+					num_channels_for_grid, width, height, 0, height, weight_sum,
+					weight_of_grid, grid);
 		}
 	}
 }
@@ -414,7 +591,7 @@ void GridConvolvingCasted(size_t num_spectra, size_t start_spectrum,
 		integer num_convolution_table/*= ceil(sqrt(2.)*(support+1)*sampling)*/,
 		float const convolution_table[/*num_convolution_table*/],
 		integer num_polarization_for_grid, integer num_channels_for_grid,
-		integer width, integer height,
+		integer width, integer height, size_t num_threads,
 		double weight_sum/*[num_polarization_for_grid]*/[/*num_channels_for_grid*/],
 		float weight_of_grid/*[height][width][num_polarization_for_grid]*/[/*num_channels_for_grid*/],
 		float grid/*[height][width][num_polarization_for_grid]*/[/*num_channels_for_grid*/]) {
@@ -425,16 +602,16 @@ void GridConvolvingCasted(size_t num_spectra, size_t start_spectrum,
 					sampling, num_polarization, polarization_map, num_channels,
 					channel_map, mask, value, weight, num_convolution_table,
 					convolution_table, num_polarization_for_grid,
-					num_channels_for_grid, width, height, weight_sum,
-					weight_of_grid, grid);
+					num_channels_for_grid, width, height, num_threads,
+					weight_sum, weight_of_grid, grid);
 		} else {
 			InternalGrid<ScalarImpl<WeightOnly> >(num_spectra, start_spectrum,
 					end_spectrum, spectrum_mask, x, y, support, sampling,
 					num_polarization, polarization_map, num_channels,
 					channel_map, mask, value, weight, num_convolution_table,
 					convolution_table, num_polarization_for_grid,
-					num_channels_for_grid, width, height, weight_sum,
-					weight_of_grid, grid);
+					num_channels_for_grid, width, height, num_threads,
+					weight_sum, weight_of_grid, grid);
 		}
 	} else {
 		if (IsVectorOperationApplicable(num_channels, channel_map)) {
@@ -443,16 +620,16 @@ void GridConvolvingCasted(size_t num_spectra, size_t start_spectrum,
 					sampling, num_polarization, polarization_map, num_channels,
 					channel_map, mask, value, weight, num_convolution_table,
 					convolution_table, num_polarization_for_grid,
-					num_channels_for_grid, width, height, weight_sum,
-					weight_of_grid, grid);
+					num_channels_for_grid, width, height, num_threads,
+					weight_sum, weight_of_grid, grid);
 		} else {
 			InternalGrid<ScalarImpl<WeightedValue> >(num_spectra,
 					start_spectrum, end_spectrum, spectrum_mask, x, y, support,
 					sampling, num_polarization, polarization_map, num_channels,
 					channel_map, mask, value, weight, num_convolution_table,
 					convolution_table, num_polarization_for_grid,
-					num_channels_for_grid, width, height, weight_sum,
-					weight_of_grid, grid);
+					num_channels_for_grid, width, height, num_threads,
+					weight_sum, weight_of_grid, grid);
 		}
 	}
 }
@@ -471,7 +648,7 @@ inline void GridConvolving(size_t num_spectra,
 		size_t num_convolution_table/*= ceil(sqrt(2.)*(support+1)*sampling)*/,
 		float const convolution_table[/*num_convolution_table*/],
 		size_t num_polarization_for_grid, size_t num_channels_for_grid,
-		size_t width, size_t height,
+		size_t width, size_t height, size_t num_threads,
 		double weight_sum/*[num_polarization_for_grid]*/[/*num_channels_for_grid*/],
 		float weight_of_grid/*[height][width][num_polarization_for_grid]*/[/*num_channels_for_grid*/],
 		float grid/*[height][width][num_polarization_for_grid]*/[/*num_channels_for_grid*/]) {
@@ -482,7 +659,7 @@ inline void GridConvolving(size_t num_spectra,
 			weight_only, (integer) num_convolution_table, convolution_table,
 			(integer) num_polarization_for_grid,
 			(integer) num_channels_for_grid, (integer) width, (integer) height,
-			weight_sum, weight_of_grid, grid);
+			num_threads, weight_sum, weight_of_grid, grid);
 }
 
 }
@@ -493,7 +670,9 @@ inline void GridConvolving(size_t num_spectra,
 	} \
 } while (false)
 
-extern "C" LIBSAKURA_SYMBOL(Status) LIBSAKURA_SYMBOL(GridConvolvingFloat)(
+namespace {
+
+LIBSAKURA_SYMBOL(Status) GridConvolvingGateKeeper(
 		size_t num_spectra, size_t start_spectrum, size_t end_spectrum,
 		bool const spectrum_mask[/*num_spectra*/],
 		double const x[/*num_spectra*/], double const y[/*num_spectra*/],
@@ -506,10 +685,10 @@ extern "C" LIBSAKURA_SYMBOL(Status) LIBSAKURA_SYMBOL(GridConvolvingFloat)(
 		size_t num_convolution_table/*= ceil(sqrt(2.)*(support+1)*sampling)*/,
 		float const convolution_table[/*num_convolution_table*/],
 		size_t num_polarization_for_grid, size_t num_channels_for_grid,
-		size_t width, size_t height,
+		size_t width, size_t height, size_t num_threads,
 		double weight_sum/*[num_polarization_for_grid]*/[/*num_channels_for_grid*/],
 		float weight_of_grid/*[height][width][num_polarization_for_grid]*/[/*num_channels_for_grid*/],
-		float grid/*[height][width][num_polarization_for_grid]*/[/*num_channels_for_grid*/]) noexcept {
+		float grid/*[height][width][num_polarization_for_grid]*/[/*num_channels_for_grid*/]) {
 	CHECK_ARGS(spectrum_mask != nullptr);
 	CHECK_ARGS(x != nullptr);
 	CHECK_ARGS(y != nullptr);
@@ -568,10 +747,73 @@ extern "C" LIBSAKURA_SYMBOL(Status) LIBSAKURA_SYMBOL(GridConvolvingFloat)(
 				polarization_map, num_channels, channel_map, mask, value,
 				weight, weight_only, num_convolution_table, convolution_table,
 				num_polarization_for_grid, num_channels_for_grid, width, height,
-				weight_sum, weight_of_grid, grid);
+				num_threads, weight_sum, weight_of_grid, grid);
+	} catch (const std::bad_alloc &e) {
+		return LIBSAKURA_SYMBOL(Status_kNoMemory);
 	} catch (...) {
 		assert(false); // No exception should be raised for the current implementation.
 		return LIBSAKURA_SYMBOL(Status_kUnknownError);
 	}
 	return LIBSAKURA_SYMBOL(Status_kOK);
 }
+
+} /* anonymous namespace */
+
+extern "C" LIBSAKURA_SYMBOL(Status) LIBSAKURA_ARCH_SYMBOL(GridConvolvingFloat)(
+		size_t num_spectra, size_t start_spectrum, size_t end_spectrum,
+		bool const spectrum_mask[/*num_spectra*/],
+		double const x[/*num_spectra*/], double const y[/*num_spectra*/],
+		size_t support, size_t sampling, size_t num_polarization,
+		uint32_t const polarization_map[/*num_polarization*/],
+		size_t num_channels, uint32_t const channel_map[/*num_channels*/],
+		bool const mask/*[num_spectra][num_polarization]*/[/*num_channels*/],
+		float const value/*[num_spectra][num_polarization]*/[/*num_channels*/],
+		float const weight/*[num_spectra]*/[/*num_channels*/], bool weight_only,
+		size_t num_convolution_table/*= ceil(sqrt(2.)*(support+1)*sampling)*/,
+		float const convolution_table[/*num_convolution_table*/],
+		size_t num_polarization_for_grid, size_t num_channels_for_grid,
+		size_t width, size_t height,
+		double weight_sum/*[num_polarization_for_grid]*/[/*num_channels_for_grid*/],
+		float weight_of_grid/*[height][width][num_polarization_for_grid]*/[/*num_channels_for_grid*/],
+		float grid/*[height][width][num_polarization_for_grid]*/[/*num_channels_for_grid*/]) noexcept {
+	LIBSAKURA_PROFILE_KERNEL(GridConvolvingFloat,
+			(end_spectrum > start_spectrum ? end_spectrum - start_spectrum : 0)
+			* num_polarization * num_channels * sizeof(float));
+	return GridConvolvingGateKeeper(num_spectra, start_spectrum, end_spectrum,
+			spectrum_mask, x, y, support, sampling, num_polarization,
+			polarization_map, num_channels, channel_map, mask, value, weight,
+			weight_only, num_convolution_table, convolution_table,
+			num_polarization_for_grid, num_channels_for_grid, width, height,
+			1, weight_sum, weight_of_grid, grid);
+}
+
+extern "C" LIBSAKURA_SYMBOL(Status) LIBSAKURA_ARCH_SYMBOL(GridConvolvingParallelFloat)(
+		size_t num_spectra, size_t start_spectrum, size_t end_spectrum,
+		bool const spectrum_mask[/*num_spectra*/],
+		double const x[/*num_spectra*/], double const y[/*num_spectra*/],
+		size_t support, size_t sampling, size_t num_polarization,
+		uint32_t const polarization_map[/*num_polarization*/],
+		size_t num_channels, uint32_t const channel_map[/*num_channels*/],
+		bool const mask/*[num_spectra][num_polarization]*/[/*num_channels*/],
+		float const value/*[num_spectra][num_polarization]*/[/*num_channels*/],
+		float const weight/*[num_spectra]*/[/*num_channels*/], bool weight_only,
+		size_t num_convolution_table/*= ceil(sqrt(2.)*(support+1)*sampling)*/,
+		float const convolution_table[/*num_convolution_table*/],
+		size_t num_polarization_for_grid, size_t num_channels_for_grid,
+		size_t width, size_t height, size_t num_threads,
+		double weight_sum/*[num_polarization_for_grid]*/[/*num_channels_for_grid*/],
+		float weight_of_grid/*[height][width][num_polarization_for_grid]*/[/*num_channels_for_grid*/],
+		float grid/*[height][width][num_polarization_for_grid]*/[/*num_channels_for_grid*/]) noexcept {
+	LIBSAKURA_PROFILE_KERNEL(GridConvolvingParallelFloat,
+			(end_spectrum > start_spectrum ? end_spectrum - start_spectrum : 0)
+			* num_polarization * num_channels * sizeof(float));
+	if (num_threads == 0) {
+		num_threads = std::max(1u, std::thread::hardware_concurrency());
+	}
+	return GridConvolvingGateKeeper(num_spectra, start_spectrum, end_spectrum,
+			spectrum_mask, x, y, support, sampling, num_polarization,
+			polarization_map, num_channels, channel_map, mask, value, weight,
+			weight_only, num_convolution_table, convolution_table,
+			num_polarization_for_grid, num_channels_for_grid, width, height,
+			num_threads, weight_sum, weight_of_grid, grid);
+}
@@ -30,8 +30,39 @@
 #include <libsakura/localdef.h>
 #include <libsakura/logger.h>
 #include <libsakura/memory_manager.h>
+#include <libsakura/profiler.h>
 #include <libsakura/sakura.h>
 
+/**
+ * @brief Interpolation plan.
+ * @details
+ * The plan is an interface to the implementation classes that are
+ * instantiated for each interpolation method. See
+ * @link sakura_CreateInterpolationPlanFloat sakura_CreateInterpolationPlanFloat @endlink.
+ */
+struct LIBSAKURA_SYMBOL(InterpolationPlanFloat) {
+	virtual ~LIBSAKURA_SYMBOL(InterpolationPlanFloat)() {
+	}
+	/**
+	 * Performs interpolation along column. Arguments correspond to those of
+	 * @link sakura_ExecuteInterpolationPlanXAxisFloat sakura_ExecuteInterpolationPlanXAxisFloat @endlink.
+	 */
+	virtual void ExecuteXAxis(size_t num_array, float const base_data[],
+			bool const base_mask[], float interpolated_data[],
+			bool interpolated_mask[]) = 0;
+	/**
+	 * Performs interpolation along row. Arguments correspond to those of
+	 * @link sakura_ExecuteInterpolationPlanYAxisFloat sakura_ExecuteInterpolationPlanYAxisFloat @endlink.
+	 */
+	virtual void ExecuteYAxis(size_t num_array, float const base_data[],
+			bool const base_mask[], float interpolated_data[],
+			bool interpolated_mask[]) = 0;
+	/**
+	 * Returns the number of base positions given on creation.
+	 */
+	virtual size_t GetNumBase() const = 0;
+};
+
 namespace {
 
 // a logger for this module
@@ -1055,6 +1086,70 @@ struct YInterpolatorHelper {
 	typedef YDescendingIndexer DescendingIndexer;
 };
 
+/**
+ * Interpolates one array from its valid base data, whose locations with
+ * respect to @a interpolated_position_ascending are already known. Out of
+ * range area is filled with the value of nearest base data.
+ *
+ * @tparam Interpolator interpolation engine class
+ * @tparam Helper class for interpolation
+ * @tparam XDataType data type for position
+ * @tparam YDataType data type for data
+ *
+ * @param[in] is_interp_ascending true if interpolated position given by user
+ * is in ascending order
+ * @param[in] num_valid_data number of valid base data. It must be greater than 1.
+ * @param[in] valid_base_position positions of valid base data in ascending order.
+ * must-be-aligned
+ * @param[in] valid_base_data valid base data. must-be-aligned
+ * @param[in] num_interpolated number of interpolated data
+ * @param[in] interpolated_position_ascending interpolated position in ascending order.
+ * must-be-aligned
+ * @param[in] num_location length of @a location
+ * @param[in] location location list returned by @a Locate
+ * @param[in] lower_index lower index list returned by @a Locate
+ * @param[in] work_data working data initialized for @a valid_base_data
+ * @param[in] num_array number of arrays
+ * @param[in] iarray index of the array to be interpolated
+ * @param[out] interpolated_data interpolated data
+ */
+template<class Interpolator, class Helper, class XDataType, class YDataType>
+inline void InterpolateValidData(bool is_interp_ascending,
+		size_t num_valid_data, XDataType const valid_base_position[],
+		YDataType const valid_base_data[], size_t num_interpolated,
+		XDataType const interpolated_position_ascending[], size_t num_location,
+		size_t const location[], size_t const lower_index[],
+		typename Interpolator::WorkingData const *work_data, size_t num_array,
+		size_t iarray, YDataType interpolated_data[]) {
+	typedef typename Helper::AscendingIndexer AscendingIndexer;
+	typedef typename Helper::DescendingIndexer DescendingIndexer;
+	auto interpolator =
+			(is_interp_ascending) ?
+					Interpolator::template Interpolate1D<AscendingIndexer> :
+					Interpolator::template Interpolate1D<DescendingIndexer>;
+	auto data_filler =
+			(is_interp_ascending) ?
+					FillOutOfRangeAreaWithValue<AscendingIndexer, YDataType> :
+					FillOutOfRangeAreaWithValue<DescendingIndexer, YDataType>;
+
+	// interpolated_position is less than base_position[0]
+	data_filler(valid_base_data[0], 0, location[0], num_interpolated,
+			num_array, iarray, interpolated_data);
+
+	// Perform 1-dimensional interpolation
+	// interpolated_position is located in between base_position[0]
+	// and base_position[num_base-1]
+	interpolator(num_valid_data, valid_base_position, valid_base_data,
+			num_interpolated, interpolated_position_ascending, num_location,
+			location, lower_index, work_data, num_array, iarray,
+			interpolated_data);
+
+	// interpolated_position is greater than base_position[num_base-1]
+	data_filler(valid_base_data[num_valid_data - 1],
+			location[num_location - 1], num_interpolated, num_interpolated,
+			num_array, iarray, interpolated_data);
+}
+
 /**
  * Core function for interpolation. The procedure is as follows:
  *
@@ -1138,15 +1233,6 @@ void Interpolate1D(uint8_t polynomial_order, size_t num_base,
 							YDataType> :
 					PickValidDataAsAscending<DescendingIndexer, XDataType,
 							YDataType>;
-	auto interpolator =
-			(is_interp_ascending) ?
-					Interpolator::template Interpolate1D<AscendingIndexer> :
-					Interpolator::template Interpolate1D<DescendingIndexer>;
-	auto data_filler =
-			(is_interp_ascending) ?
-					FillOutOfRangeAreaWithValue<AscendingIndexer, YDataType> :
-					FillOutOfRangeAreaWithValue<DescendingIndexer, YDataType>;
-
 	// Initialize interpolated_mask to true
 	for (size_t i = 0; i < num_interpolated * num_array; ++i) {
 		interpolated_mask[i] = true;
@@ -1205,29 +1291,17 @@ void Interpolate1D(uint8_t polynomial_order, size_t num_base,
 					interpolated_position_ascending, num_valid_data,
 					valid_base_position, location_base, lower_index_base);
 
-			// interpolated_position is less than base_position[0]
-			data_filler(valid_base_data[0], 0, location_base[0],
-					num_interpolated, num_array, iarray, interpolated_data);
-
-			// Perform 1-dimensional interpolation
-			// interpolated_position is located in between base_position[0]
-			// and base_position[num_base-1]
 			WorkingData::Initialize(num_valid_data, valid_base_position,
 					valid_base_data, work_data);
-			interpolator(num_valid_data, valid_base_position, valid_base_data,
+			InterpolateValidData<Interpolator, Helper>(is_interp_ascending,
+					num_valid_data, valid_base_position, valid_base_data,
 					num_interpolated, interpolated_position_ascending,
 					num_location_base, location_base, lower_index_base,
 					work_data, num_array, iarray, interpolated_data);
-
-			// interpolated_position is greater than base_position[num_base-1]
-			data_filler(valid_base_data[num_valid_data - 1],
-					location_base[num_location_base - 1], num_interpolated,
-					num_interpolated, num_array, iarray, interpolated_data);
 		}
 	}
 }
 
-#ifndef NDEBUG
 /**
  * Template utility function for sort check
  *
@@ -1279,7 +1353,6 @@ bool IsDuplicateOrNotSorted(size_t num_elements, DataType const data[]) {
 	}
 	return true;
 }
-#endif
 
 /**
  * Perform basic check of input arguments.
@@ -1458,6 +1531,391 @@ LIBSAKURA_SYMBOL(
 	return status;
 }
 
+/**
+ * @a PlanFactorization keeps the part of the initialization of working data
+ * that depends only on base positions so that an interpolation plan can
+ * initialize working data for each array with arithmetic only.
+ * This default implementation keeps nothing and just calls
+ * @a WorkingData::Initialize.
+ *
+ * @tparam WorkingData working data type
+ */
+template<class WorkingData>
+struct PlanFactorization {
+	/**
+	 * The @a Factorize method does nothing.
+	 * @param[in] num_base no effect
+	 * @param[in] base_position no effect
+	 */
+	template<class XDataType>
+	void Factorize(size_t num_base, XDataType const base_position[]) {
+	}
+	/**
+	 * The @a Initialize method initializes @a work_data by
+	 * @a WorkingData::Initialize.
+	 * @param[in] num_base number of base data
+	 * @param[in] base_position positions of base data. must-be-aligned
+	 * @param[in] base_data base data. must-be-aligned
+	 * @param[out] work_data working data
+	 */
+	template<class XDataType, class YDataType>
+	void Initialize(size_t num_base, XDataType const base_position[],
+			YDataType const base_data[], WorkingData *work_data) const {
+		WorkingData::Initialize(num_base, base_position, base_data, work_data);
+	}
+};
+
+/**
+ * @a PlanFactorization for spline interpolation. It keeps LU decomposition
+ * of the tri-diagonal system solved by @a SplineWorkingData::Initialize.
+ *
+ * @tparam XDataType data type for position
+ * @tparam YDataType data type for data
+ */
+template<class XDataType, class YDataType>
+struct PlanFactorization<SplineWorkingData<XDataType, YDataType> > {
+	typedef SplineWorkingData<XDataType, YDataType> WorkingData;
+	typedef typename WorkingData::WDataType WDataType;
+
+	/**
+	 * The @a Factorize method decomposes the tri-diagonal system for
+	 * @a base_position in the same way as @a SplineWorkingData::Initialize.
+	 * @param[in] num_base number of base data. It must be greater than 1.
+	 * @param[in] base_position positions of base data in ascending order.
+	 * must-be-aligned
+	 */
+	void Factorize(size_t num_base, XDataType const base_position[]) {
+		assert(num_base > 1);
+		AllocateAndAlign<WDataType>(num_base, &inverse_dx);
+		AllocateAndAlign<WDataType>(num_base, &rhs_factor);
+		AllocateAndAlign<WDataType>(num_base, &lower_diagonal);
+		AllocateAndAlign<WDataType>(num_base, &inverse_denominator);
+		AllocateAndAlign<WDataType>(num_base, &upper_triangular);
+		auto dx_inv = inverse_dx.pointer;
+		auto upper = upper_triangular.pointer;
+		constexpr auto kOne = WDataType(1);
+		constexpr auto kTwo = WDataType(2);
+		constexpr auto kThree = WDataType(3);
+		dx_inv[0] = WDataType(0);
+		upper[0] = WDataType(0);
+		for (size_t i = 1; i < num_base; ++i) {
+			auto const dx = WDataType(base_position[i] - base_position[i - 1]);
+			assert(dx != decltype(dx)(0));
+			dx_inv[i] = kOne / dx;
+		}
+		for (size_t i = 2; i < num_base; ++i) {
+			auto const a1 = WDataType(base_position[i - 1] - base_position[i - 2]);
+			auto const a2 = WDataType(base_position[i] - base_position[i - 1]);
+			auto const b1 = WDataType(base_position[i] - base_position[i - 2]);
+			auto const u = a2 / (kTwo * b1);
+			auto const l = a1 / (kTwo * b1);
+			auto const denominator = kOne - upper[i - 2] * l;
+			upper[i - 1] = u / denominator;
+			lower_diagonal.pointer[i - 1] = l;
+			inverse_denominator.pointer[i - 1] = kOne / denominator;
+			rhs_factor.pointer[i - 1] = kThree / b1;
+		}
+	}
+	/**
+	 * The @a Initialize method computes spline correction term using the
+	 * decomposition computed by @a Factorize.
+	 * @param[in] num_base number of base data. It must be the same as the one
+	 * given to @a Factorize.
+	 * @param[in] base_position no effect
+	 * @param[in] base_data base data. must-be-aligned
+	 * @param[out] work_data working data
+	 */
+	void Initialize(size_t num_base, XDataType const base_position[],
+			YDataType const base_data[], WorkingData *work_data) const {
+		auto d2ydx2 = work_data->second_derivative.pointer;
+		auto const dx_inv = inverse_dx.pointer;
+		auto const upper = upper_triangular.pointer;
+		auto const lower = lower_diagonal.pointer;
+		auto const denominator_inv = inverse_denominator.pointer;
+		auto const factor = rhs_factor.pointer;
+		d2ydx2[0] = WDataType(0);
+		d2ydx2[num_base - 1] = WDataType(0);
+		auto slope1 = WDataType(base_data[1] - base_data[0]) * dx_inv[1];
+		for (size_t i = 2; i < num_base; ++i) {
+			auto const slope2 = WDataType(base_data[i] - base_data[i - 1])
+					* dx_inv[i];
+			auto const r = (slope2 - slope1) * factor[i - 1];
+			d2ydx2[i - 1] = (r - lower[i - 1] * d2ydx2[i - 2])
+					* denominator_inv[i - 1];
+			slope1 = slope2;
+		}
+		for (size_t k = num_base; k >= 3; --k) {
+			d2ydx2[k - 2] -= upper[k - 2] * d2ydx2[k - 1];
+		}
+	}
+	/**
+	 * Inverse of the interval between adjacent base positions.
+	 */
+	StorageAndAlignedPointer<WDataType> inverse_dx;
+	/**
+	 * Factor to convert difference of slopes into right-hand-side vector.
+	 */
+	StorageAndAlignedPointer<WDataType> rhs_factor;
+	/**
+	 * Lower diagonal elements of the tri-diagonal matrix.
+	 */
+	StorageAndAlignedPointer<WDataType> lower_diagonal;
+	/**
+	 * Inverse of diagonal elements of the decomposed matrix.
+	 */
+	StorageAndAlignedPointer<WDataType> inverse_denominator;
+	/**
+	 * Upper triangular elements of the decomposed matrix.
+	 */
+	StorageAndAlignedPointer<WDataType> upper_triangular;
+};
+
+/**
+ * Implementation of interpolation plan for each interpolation method.
+ *
+ * All positions are stored in ascending order on creation. Location of
+ * base positions with respect to interpolated positions, as well as
+ * working arrays that are used when some of base data are masked, are
+ * also prepared on creation. Thus execution does not allocate memory.
+ *
+ * @tparam Interpolator interpolation engine class
+ */
+template<class Interpolator>
+struct InterpolationPlanImpl: public LIBSAKURA_SYMBOL(InterpolationPlanFloat),
+		public CustomizedMemoryManagement {
+	typedef double XDataType;
+	typedef float YDataType;
+	typedef typename Interpolator::WorkingData WorkingData;
+
+	/**
+	 * Constructor. See
+	 * @link sakura_CreateInterpolationPlanFloat sakura_CreateInterpolationPlanFloat @endlink
+	 * for parameter description.
+	 * @exception std::bad_alloc failed to allocate memory
+	 */
+	InterpolationPlanImpl(uint8_t polynomial_order, size_t num_base,
+			XDataType const base_position[], size_t num_interpolated,
+			XDataType const interpolated_position[]) :
+			num_base(num_base), num_interpolated(num_interpolated), is_base_ascending(
+					base_position[num_base - 1] > base_position[0]), is_interp_ascending(
+					interpolated_position[num_interpolated - 1]
+							> interpolated_position[0]), num_location(0) {
+		AllocateAndAlign(num_base, &base_position_ascending);
+		AllocateAndAlign(num_interpolated, &interpolated_position_ascending);
+		for (size_t i = 0; i < num_base; ++i) {
+			base_position_ascending.pointer[i] = base_position[
+					is_base_ascending ? i : num_base - 1 - i];
+		}
+		for (size_t i = 0; i < num_interpolated; ++i) {
+			interpolated_position_ascending.pointer[i] = interpolated_position[
+					is_interp_ascending ? i : num_interpolated - 1 - i];
+		}
+		AllocateAndAlign(num_base, &location);
+		AllocateAndAlign(num_base, &lower_index);
+		if (num_base > 1) {
+			num_location = Locate<XDataType>(num_interpolated,
+					interpolated_position_ascending.pointer, num_base,
+					base_position_ascending.pointer, location.pointer,
+					lower_index.pointer);
+			factorization.Factorize(num_base, base_position_ascending.pointer);
+		}
+
+		// working arrays
+		AllocateAndAlign(num_base, &valid_base_position);
+		AllocateAndAlign(num_base, &valid_base_data);
+		AllocateAndAlign(num_base, &valid_location);
+		AllocateAndAlign(num_base, &valid_lower_index);
+		work_data.reset(WorkingData::Allocate(polynomial_order, num_base));
+	}
+	virtual void ExecuteXAxis(size_t num_array, YDataType const base_data[],
+			bool const base_mask[], YDataType interpolated_data[],
+			bool interpolated_mask[]) {
+		Execute<XInterpolatorHelper>(num_array, base_data, base_mask,
+				interpolated_data, interpolated_mask);
+	}
+	virtual void ExecuteYAxis(size_t num_array, YDataType const base_data[],
+			bool const base_mask[], YDataType interpolated_data[],
+			bool interpolated_mask[]) {
+		Execute<YInterpolatorHelper>(num_array, base_data, base_mask,
+				interpolated_data, interpolated_mask);
+	}
+	virtual size_t GetNumBase() const {
+		return num_base;
+	}
+
+private:
+	/**
+	 * Same as @link ::Interpolate1D Interpolate1D @endlink except that
+	 * arrays whose base data are all valid are interpolated with the
+	 * locations and the factorization computed on creation.
+	 */
+	template<class Helper>
+	void Execute(size_t num_array, YDataType const base_data[],
+			bool const base_mask[], YDataType interpolated_data[],
+			bool interpolated_mask[]) {
+		typedef typename Helper::AscendingIndexer AscendingIndexer;
+		typedef typename Helper::DescendingIndexer DescendingIndexer;
+		auto data_picker =
+				(is_base_ascending) ?
+						PickValidData<AscendingIndexer> :
+						PickValidData<DescendingIndexer>;
+		auto position_picker =
+				(is_base_ascending) ?
+						PickValidPosition<AscendingIndexer> :
+						PickValidPosition<DescendingIndexer>;
+		XDataType *valid_position = valid_base_position.pointer;
+		YDataType *valid_data = valid_base_data.pointer;
+
+		for (size_t i = 0; i < num_interpolated * num_array; ++i) {
+			interpolated_mask[i] = true;
+		}
+
+		for (size_t iarray = 0; iarray < num_array; ++iarray) {
+			size_t const num_valid_data = data_picker(num_base, num_array,
+					iarray, base_mask, base_data, valid_data);
+			if (num_valid_data == 0) {
+				FillOneRowWithValue<AscendingIndexer, bool>(num_interpolated,
+						num_array, false, iarray, interpolated_mask);
+			} else if (num_valid_data == 1) {
+				FillOneRowWithValue<AscendingIndexer, YDataType>(
+						num_interpolated, num_array, valid_data[0], iarray,
+						interpolated_data);
+			} else if (num_valid_data == num_base) {
+				factorization.Initialize(num_base,
+						base_position_ascending.pointer, valid_data,
+						work_data.get());
+				InterpolateValidData<Interpolator, Helper>(is_interp_ascending,
+						num_base, base_position_ascending.pointer, valid_data,
+						num_interpolated, interpolated_position_ascending.pointer,
+						num_location, location.pointer, lower_index.pointer,
+						work_data.get(), num_array, iarray, interpolated_data);
+			} else {
+				// positions of valid data differ from those on creation
+				position_picker(num_base, num_array, iarray, base_mask,
+						base_position_ascending.pointer, valid_position);
+				size_t const num_valid_location = Locate<XDataType>(
+						num_interpolated, interpolated_position_ascending.pointer,
+						num_valid_data, valid_position, valid_location.pointer,
+						valid_lower_index.pointer);
+				WorkingData::Initialize(num_valid_data, valid_position,
+						valid_data, work_data.get());
+				InterpolateValidData<Interpolator, Helper>(is_interp_ascending,
+						num_valid_data, valid_position, valid_data,
+						num_interpolated, interpolated_position_ascending.pointer,
+						num_valid_location, valid_location.pointer,
+						valid_lower_index.pointer, work_data.get(), num_array,
+						iarray, interpolated_data);
+			}
+		}
+	}
+	/**
+	 * Packs valid base data of the @a iarray -th array in ascending order
+	 * of position.
+	 * @return number of valid data
+	 */
+	template<class Indexer>
+	static size_t PickValidData(size_t num_base, size_t num_array,
+			size_t iarray, bool const base_mask[], YDataType const base_data[],
+			YDataType out_data[]) {
+		size_t n = 0;
+		for (size_t i = 0; i < num_base; ++i) {
+			size_t const index = Indexer::GetIndex(num_base, num_array, iarray,
+					i);
+			out_data[n] = base_data[index];
+			n += base_mask[index] ? 1 : 0;
+		}
+		return n;
+	}
+	/**
+	 * Packs positions of valid base data of the @a iarray -th array.
+	 * @param[in] position base positions in ascending order
+	 */
+	template<class Indexer>
+	static void PickValidPosition(size_t num_base, size_t num_array,
+			size_t iarray, bool const base_mask[], XDataType const position[],
+			XDataType out_position[]) {
+		size_t n = 0;
+		for (size_t i = 0; i < num_base; ++i) {
+			out_position[n] = position[i];
+			n += base_mask[Indexer::GetIndex(num_base, num_array, iarray, i)] ?
+					1 : 0;
+		}
+	}
+
+	/**
+	 * Number of base data.
+	 */
+	size_t const num_base;
+	/**
+	 * Number of interpolated data.
+	 */
+	size_t const num_interpolated;
+	/**
+	 * true if base position given on creation is in ascending order.
+	 */
+	bool const is_base_ascending;
+	/**
+	 * true if interpolated position given on creation is in ascending order.
+	 */
+	bool const is_interp_ascending;
+	/**
+	 * Base position in ascending order.
+	 */
+	StorageAndAlignedPointer<XDataType> base_position_ascending;
+	/**
+	 * Interpolated position in ascending order.
+	 */
+	StorageAndAlignedPointer<XDataType> interpolated_position_ascending;
+	/**
+	 * Number of elements of @a location and @a lower_index.
+	 */
+	size_t num_location;
+	/**
+	 * Location of base positions. See @a Locate.
+	 */
+	StorageAndAlignedPointer<size_t> location;
+	/**
+	 * Lower index of interpolated positions. See @a Locate.
+	 */
+	StorageAndAlignedPointer<size_t> lower_index;
+	/**
+	 * Factorization of working data initialization.
+	 */
+	PlanFactorization<WorkingData> factorization;
+	/**
+	 * Working array for positions of valid base data.
+	 */
+	StorageAndAlignedPointer<XDataType> valid_base_position;
+	/**
+	 * Working array for valid base data.
+	 */
+	StorageAndAlignedPointer<YDataType> valid_base_data;
+	/**
+	 * Working array for location of valid base positions.
+	 */
+	StorageAndAlignedPointer<size_t> valid_location;
+	/**
+	 * Working array for lower index with respect to valid base positions.
+	 */
+	StorageAndAlignedPointer<size_t> valid_lower_index;
+	/**
+	 * Working data for interpolation.
+	 */
+	std::unique_ptr<WorkingData> work_data;
+};
+
+/**
+ * Creates interpolation plan for @a Interpolator.
+ */
+template<class Interpolator>
+LIBSAKURA_SYMBOL(InterpolationPlanFloat) *CreateInterpolationPlan(
+		uint8_t polynomial_order, size_t num_base,
+		double const base_position[], size_t num_interpolated,
+		double const interpolated_position[]) {
+	return new InterpolationPlanImpl<Interpolator>(polynomial_order, num_base,
+			base_position, num_interpolated, interpolated_position);
+}
+
 } /* anonymous namespace */
 
 /**
@@ -1483,6 +1941,8 @@ LIBSAKURA_SYMBOL(InterpolationMethod) interpolation_method,
 		double const interpolated_position[/*num_interpolated*/],
 		float interpolated_data[/*num_interpolated*num_array*/],
 		bool interpolated_mask[/*num_interpolated*num_array*/]) noexcept {
+	LIBSAKURA_PROFILE_KERNEL(InterpolateXAxisFloat,
+			num_base * num_array * (sizeof(float) + sizeof(bool)));
 
 	return DoInterpolate<double, float, XInterpolatorHelper>(
 			interpolation_method, polynomial_order, num_base, base_position,
@@ -1514,6 +1974,8 @@ LIBSAKURA_SYMBOL(InterpolationMethod) interpolation_method,
 		double const interpolated_position[/*num_interpolated*/],
 		float interpolated_data[/*num_interpolated*num_array*/],
 		bool interpolated_mask[/*num_interpolated*num_array*/]) noexcept {
+	LIBSAKURA_PROFILE_KERNEL(InterpolateYAxisFloat,
+			num_base * num_array * (sizeof(float) + sizeof(bool)));
 
 	return DoInterpolate<double, float, YInterpolatorHelper>(
 			interpolation_method, polynomial_order, num_base, base_position,
@@ -1521,3 +1983,181 @@ LIBSAKURA_SYMBOL(InterpolationMethod) interpolation_method,
 			interpolated_position, interpolated_data, interpolated_mask);
 
 }
+
+extern "C" LIBSAKURA_SYMBOL(Status) LIBSAKURA_SYMBOL(CreateInterpolationPlanFloat)(
+LIBSAKURA_SYMBOL(InterpolationMethod) interpolation_method,
+		uint8_t polynomial_order, size_t num_base,
+		double const base_position[/*num_base*/], size_t num_interpolated,
+		double const interpolated_position[/*num_interpolated*/],
+		LIBSAKURA_SYMBOL(InterpolationPlanFloat) **plan) noexcept {
+	if (plan == nullptr) {
+		LOG4CXX_ERROR(logger, "plan is null");
+		return LIBSAKURA_SYMBOL(Status_kInvalidArgument);
+	}
+	*plan = nullptr;
+	if (num_base == 0 || num_interpolated == 0) {
+		LOG4CXX_ERROR(logger, "num_base and num_interpolated must be >0");
+		return LIBSAKURA_SYMBOL(Status_kInvalidArgument);
+	}
+	if (base_position == nullptr || interpolated_position == nullptr) {
+		LOG4CXX_ERROR(logger, "input arrays are null");
+		return LIBSAKURA_SYMBOL(Status_kInvalidArgument);
+	}
+	if (!LIBSAKURA_SYMBOL(IsAligned)(base_position)
+			|| !LIBSAKURA_SYMBOL(IsAligned)(interpolated_position)) {
+		LOG4CXX_ERROR(logger, "input arrays are not aligned");
+		return LIBSAKURA_SYMBOL(Status_kInvalidArgument);
+	}
+	// the check is done only once for a plan
+	if (IsDuplicateOrNotSorted(num_base, base_position)
+			|| IsDuplicateOrNotSorted(num_interpolated, interpolated_position)) {
+		LOG4CXX_ERROR(logger,
+				"positions are not sorted or have duplicated elements");
+		return LIBSAKURA_SYMBOL(Status_kInvalidArgument);
+	}
+
+	try {
+		typedef NearestInterpolatorImpl<double, float> NearestInterpolator;
+		typedef LinearInterpolatorImpl<double, float> LinearInterpolator;
+		typedef PolynomialInterpolatorImpl<double, float> PolynomialInterpolator;
+		typedef SplineInterpolatorImpl<double, float> SplineInterpolator;
+		switch (interpolation_method) {
+		case LIBSAKURA_SYMBOL(InterpolationMethod_kNearest):
+			*plan = CreateInterpolationPlan<NearestInterpolator>(
+					polynomial_order, num_base, base_position, num_interpolated,
+					interpolated_position);
+			break;
+		case LIBSAKURA_SYMBOL(InterpolationMethod_kLinear):
+			*plan = CreateInterpolationPlan<LinearInterpolator>(
+					polynomial_order, num_base, base_position, num_interpolated,
+					interpolated_position);
+			break;
+		case LIBSAKURA_SYMBOL(InterpolationMethod_kPolynomial):
+			if (polynomial_order == 0) {
+				// 0-th polynomial interpolation acts like nearest interpolation
+				*plan = CreateInterpolationPlan<NearestInterpolator>(
+						polynomial_order, num_base, base_position,
+						num_interpolated, interpolated_position);
+			} else {
+				*plan = CreateInterpolationPlan<PolynomialInterpolator>(
+						polynomial_order, num_base, base_position,
+						num_interpolated, interpolated_position);
+			}
+			break;
+		case LIBSAKURA_SYMBOL(InterpolationMethod_kSpline):
+			*plan = CreateInterpolationPlan<SplineInterpolator>(
+					polynomial_order, num_base, base_position, num_interpolated,
+					interpolated_position);
+			break;
+		default:
+			LOG4CXX_ERROR(logger, "Invalid interpolation type.");
+			return LIBSAKURA_SYMBOL(Status_kInvalidArgument);
+		}
+	} catch (const std::bad_alloc &e) {
+		LOG4CXX_ERROR(logger, "Memory allocation failed.");
+		return LIBSAKURA_SYMBOL(Status_kNoMemory);
+	} catch (...) {
+		assert(false);
+		LOG4CXX_ERROR(logger, "Aborted due to unknown error");
+		return LIBSAKURA_SYMBOL(Status_kUnknownError);
+	}
+	return LIBSAKURA_SYMBOL(Status_kOK);
+}
+
+namespace {
+
+/**
+ * Perform basic check of arguments for execution of interpolation plan.
+ */
+bool IsValidPlanArguments(
+LIBSAKURA_SYMBOL(InterpolationPlanFloat) const *plan, size_t num_array,
+		float const base_data[], bool const base_mask[],
+		float const interpolated_data[], bool const interpolated_mask[],
+		LIBSAKURA_SYMBOL(Status) *status) {
+	if (plan == nullptr) {
+		LOG4CXX_ERROR(logger, "plan is null");
+		*status = LIBSAKURA_SYMBOL(Status_kInvalidArgument);
+		return false;
+	}
+	if (num_array == 0) {
+		*status = LIBSAKURA_SYMBOL(Status_kOK);
+		return false;
+	}
+	if (base_data == nullptr || base_mask == nullptr
+			|| interpolated_data == nullptr || interpolated_mask == nullptr) {
+		LOG4CXX_ERROR(logger, "input arrays are null");
+		*status = LIBSAKURA_SYMBOL(Status_kInvalidArgument);
+		return false;
+	}
+	if (!LIBSAKURA_SYMBOL(IsAligned)(base_data)
+			|| !LIBSAKURA_SYMBOL(IsAligned)(base_mask)
+			|| !LIBSAKURA_SYMBOL(IsAligned)(interpolated_data)
+			|| !LIBSAKURA_SYMBOL(IsAligned)(interpolated_mask)) {
+		LOG4CXX_ERROR(logger, "input arrays are not aligned");
+		*status = LIBSAKURA_SYMBOL(Status_kInvalidArgument);
+		return false;
+	}
+	return true;
+}
+
+} /* anonymous namespace */
+
+extern "C" LIBSAKURA_SYMBOL(Status) LIBSAKURA_SYMBOL(ExecuteInterpolationPlanXAxisFloat)(
+LIBSAKURA_SYMBOL(InterpolationPlanFloat) *plan, size_t num_array,
+		float const base_data[/*num_base*num_array*/],
+		bool const base_mask[/*num_base*num_array*/],
+		float interpolated_data[/*num_interpolated*num_array*/],
+		bool interpolated_mask[/*num_interpolated*num_array*/]) noexcept {
+	LIBSAKURA_PROFILE_KERNEL(ExecuteInterpolationPlanXAxisFloat,
+			(plan != nullptr ? plan->GetNumBase() : 0) * num_array
+					* (sizeof(float) + sizeof(bool)));
+	LIBSAKURA_SYMBOL(Status) status = LIBSAKURA_SYMBOL(Status_kOK);
+	if (!IsValidPlanArguments(plan, num_array, base_data, base_mask,
+			interpolated_data, interpolated_mask, &status)) {
+		return status;
+	}
+	try {
+		plan->ExecuteXAxis(num_array, base_data, base_mask, interpolated_data,
+				interpolated_mask);
+	} catch (...) {
+		assert(false);
+		LOG4CXX_ERROR(logger, "Aborted due to unknown error");
+		return LIBSAKURA_SYMBOL(Status_kUnknownError);
+	}
+	return status;
+}
+
+extern "C" LIBSAKURA_SYMBOL(Status) LIBSAKURA_SYMBOL(ExecuteInterpolationPlanYAxisFloat)(
+LIBSAKURA_SYMBOL(InterpolationPlanFloat) *plan, size_t num_array,
+		float const base_data[/*num_base*num_array*/],
+		bool const base_mask[/*num_base*num_array*/],
+		float interpolated_data[/*num_interpolated*num_array*/],
+		bool interpolated_mask[/*num_interpolated*num_array*/]) noexcept {
+	LIBSAKURA_PROFILE_KERNEL(ExecuteInterpolationPlanYAxisFloat,
+			(plan != nullptr ? plan->GetNumBase() : 0) * num_array
+					* (sizeof(float) + sizeof(bool)));
+	LIBSAKURA_SYMBOL(Status) status = LIBSAKURA_SYMBOL(Status_kOK);
+	if (!IsValidPlanArguments(plan, num_array, base_data, base_mask,
+			interpolated_data, interpolated_mask, &status)) {
+		return status;
+	}
+	try {
+		plan->ExecuteYAxis(num_array, base_data, base_mask, interpolated_data,
+				interpolated_mask);
+	} catch (...) {
+		assert(false);
+		LOG4CXX_ERROR(logger, "Aborted due to unknown error");
+		return LIBSAKURA_SYMBOL(Status_kUnknownError);
+	}
+	return status;
+}
+
+extern "C" LIBSAKURA_SYMBOL(Status) LIBSAKURA_SYMBOL(DestroyInterpolationPlanFloat)(
+LIBSAKURA_SYMBOL(InterpolationPlanFloat) *plan) noexcept {
+	if (plan == nullptr) {
+		LOG4CXX_ERROR(logger, "plan is null");
+		return LIBSAKURA_SYMBOL(Status_kInvalidArgument);
+	}
+	delete plan;
+	return LIBSAKURA_SYMBOL(Status_kOK);
+}
@@ -0,0 +1,62 @@
+/*
+ * @SAKURA_LICENSE_HEADER_START@
+ * Copyright (C) 2013-2022
+ * Inter-University Research Institute Corporation, National Institutes of Natural Sciences
+ * 2-21-1, Osawa, Mitaka, Tokyo, 181-8588, Japan.
+ * 
+ * This file is part of Sakura.
+ * 
+ * Sakura is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or (at your
+ * option) any later version.
+ * 
+ * Sakura is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public
+ * License for more details.
+ * 
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Sakura.  If not, see <http://www.gnu.org/licenses/>.
+ * @SAKURA_LICENSE_HEADER_END@
+ */
+/**
+ * @file
+ * Contains the entry point of run-time ISA selection
+ *
+ * This file is an internal header file for libsakura.
+ * This is not a part of libsakura API.
+ */
+
+#ifndef LIBSAKURA_LIBSAKURA_ARCH_DISPATCH_H_
+#define LIBSAKURA_LIBSAKURA_ARCH_DISPATCH_H_
+
+#include <libsakura/sakura.h>
+
+namespace LIBSAKURA_PREFIX {
+
+/**
+ * @~
+ * @brief
+ * Selects the ISA variant of the dispatched API functions
+ *
+ * Detects the instruction sets supported by the running CPU and
+ * makes the API functions forward to the best variant compiled in.
+ * Only available when libsakura is built with SIMD_ARCH=DISPATCH.
+ *
+ * MT-unsafe
+ */
+void SelectArch() noexcept;
+
+/**
+ * @~
+ * @brief
+ * Returns the name of the ISA variant currently selected
+ *
+ * MT-safe
+ */
+char const *GetSelectedArchName() noexcept;
+
+} /* namespace LIBSAKURA_PREFIX */
+
+#endif /* LIBSAKURA_LIBSAKURA_ARCH_DISPATCH_H_ */
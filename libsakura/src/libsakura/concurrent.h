@@ -37,6 +37,18 @@
 #include <assert.h>
 #include <pthread.h>
 
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
 namespace concurrent {
 /**
  * Producer/Consumer Exception
@@ -198,6 +210,236 @@ private:
 
 };
 
+/**
+ * Size of a cache line. Variables written by different threads are
+ * separated by this size to avoid false sharing.
+ */
+constexpr size_t kCacheLineSize = 64;
+
+/**
+ * A lock-free ring buffer for one producer thread and one consumer thread.
+ *
+ * Unlike @ref FIFO , it needs no lock and reports full or empty by return
+ * values. @ref TryPut() / @ref Put() must be called only by the producer
+ * and @ref TryGet() / @ref Get() only by the consumer.
+ *
+ * @tparam T Type of elements. It must be default constructible and
+ * copy assignable.
+ * @tparam N Capacity. It must be a power of two.
+ */
+template<class T, size_t N>
+class SPSCRingBuffer {
+	static_assert(N > 0 && (N & (N - 1)) == 0, "N must be a power of two");
+public:
+	SPSCRingBuffer() :
+			head_(0), cached_tail_(0), tail_(0), cached_head_(0) {
+	}
+
+	/**
+	 * Puts @a value and returns true, or returns false if full.
+	 */
+	bool TryPut(T const &value) {
+		size_t const tail = tail_.load(std::memory_order_relaxed);
+		if (tail - cached_head_ == N) {
+			cached_head_ = head_.load(std::memory_order_acquire);
+			if (tail - cached_head_ == N) {
+				return false;
+			}
+		}
+		elements_[tail & (N - 1)] = value;
+		tail_.store(tail + 1, std::memory_order_release);
+		return true;
+	}
+
+	/**
+	 * Gets a value to @a *value and returns true, or returns false if empty.
+	 */
+	bool TryGet(T *value) {
+		size_t const head = head_.load(std::memory_order_relaxed);
+		if (head == cached_tail_) {
+			cached_tail_ = tail_.load(std::memory_order_acquire);
+			if (head == cached_tail_) {
+				return false;
+			}
+		}
+		*value = std::move(elements_[head & (N - 1)]);
+		head_.store(head + 1, std::memory_order_release);
+		return true;
+	}
+
+	/**
+	 * Puts @a value. Yields the thread while full.
+	 */
+	void Put(T const &value) {
+		while (!TryPut(value)) {
+			std::this_thread::yield();
+		}
+	}
+
+	/**
+	 * Gets a value to @a *value . Yields the thread while empty.
+	 */
+	void Get(T *value) {
+		while (!TryGet(value)) {
+			std::this_thread::yield();
+		}
+	}
+
+	/**
+	 * Returns capacity size.
+	 */
+	size_t Size() const {
+		return N;
+	}
+
+	/**
+	 * Returns number of elements. It may be outdated when returned.
+	 */
+	size_t Length() const {
+		return tail_.load(std::memory_order_acquire)
+				- head_.load(std::memory_order_acquire);
+	}
+private:
+	SPSCRingBuffer(SPSCRingBuffer const &other);
+	SPSCRingBuffer &operator =(SPSCRingBuffer const &other);
+
+	// written by the consumer
+	std::atomic<size_t> head_;
+	size_t cached_tail_;
+	char padding_for_consumer_[kCacheLineSize];
+	// written by the producer
+	std::atomic<size_t> tail_;
+	size_t cached_head_;
+	char padding_for_producer_[kCacheLineSize];
+	T elements_[N];
+};
+
+/**
+ * A lock-free ring buffer for any number of producer and consumer threads.
+ *
+ * Each element has a sequence number telling whether it is ready to be
+ * put or got in the current round, so that producers and consumers only
+ * compete for their own position by compare-and-swap.
+ *
+ * @tparam T Type of elements. It must be default constructible and
+ * copy assignable.
+ * @tparam N Capacity. It must be a power of two larger than 1.
+ */
+template<class T, size_t N>
+class MPMCRingBuffer {
+	// a sequence number for getting must differ from that for putting
+	// in the next round
+	static_assert(N > 1 && (N & (N - 1)) == 0,
+			"N must be a power of two larger than 1");
+public:
+	MPMCRingBuffer() :
+			put_position_(0), get_position_(0) {
+		for (size_t i = 0; i < N; ++i) {
+			cells_[i].sequence.store(i, std::memory_order_relaxed);
+		}
+	}
+
+	/**
+	 * Puts @a value and returns true, or returns false if full.
+	 */
+	bool TryPut(T const &value) {
+		size_t position = put_position_.load(std::memory_order_relaxed);
+		for (;;) {
+			Cell &cell = cells_[position & (N - 1)];
+			size_t const sequence = cell.sequence.load(
+					std::memory_order_acquire);
+			auto const difference = static_cast<ptrdiff_t>(sequence - position);
+			if (difference == 0) {
+				if (put_position_.compare_exchange_weak(position, position + 1,
+						std::memory_order_relaxed)) {
+					cell.value = value;
+					cell.sequence.store(position + 1, std::memory_order_release);
+					return true;
+				}
+			} else if (difference < 0) {
+				return false;
+			} else {
+				position = put_position_.load(std::memory_order_relaxed);
+			}
+		}
+	}
+
+	/**
+	 * Gets a value to @a *value and returns true, or returns false if empty.
+	 */
+	bool TryGet(T *value) {
+		size_t position = get_position_.load(std::memory_order_relaxed);
+		for (;;) {
+			Cell &cell = cells_[position & (N - 1)];
+			size_t const sequence = cell.sequence.load(
+					std::memory_order_acquire);
+			auto const difference = static_cast<ptrdiff_t>(sequence
+					- (position + 1));
+			if (difference == 0) {
+				if (get_position_.compare_exchange_weak(position, position + 1,
+						std::memory_order_relaxed)) {
+					*value = std::move(cell.value);
+					cell.sequence.store(position + N, std::memory_order_release);
+					return true;
+				}
+			} else if (difference < 0) {
+				return false;
+			} else {
+				position = get_position_.load(std::memory_order_relaxed);
+			}
+		}
+	}
+
+	/**
+	 * Puts @a value. Yields the thread while full.
+	 */
+	void Put(T const &value) {
+		while (!TryPut(value)) {
+			std::this_thread::yield();
+		}
+	}
+
+	/**
+	 * Gets a value to @a *value . Yields the thread while empty.
+	 */
+	void Get(T *value) {
+		while (!TryGet(value)) {
+			std::this_thread::yield();
+		}
+	}
+
+	/**
+	 * Returns capacity size.
+	 */
+	size_t Size() const {
+		return N;
+	}
+private:
+	MPMCRingBuffer(MPMCRingBuffer const &other);
+	MPMCRingBuffer &operator =(MPMCRingBuffer const &other);
+
+	struct Cell {
+		std::atomic<size_t> sequence;
+		T value;
+	};
+
+	Cell cells_[N];
+	char padding_for_cells_[kCacheLineSize];
+	std::atomic<size_t> put_position_;
+	char padding_for_producers_[kCacheLineSize];
+	std::atomic<size_t> get_position_;
+	char padding_for_consumers_[kCacheLineSize];
+};
+
+/**
+ * Runs a producer and a consumer in two threads.
+ *
+ * The producer runs ahead of the consumer by up to @a do_ahead products.
+ * An exception thrown by the producer or the consumer is rethrown by
+ * Run methods after both threads finish.
+ * Use @ref ThreadPool and @ref RunProducersAndConsumers() for more
+ * producers and consumers.
+ */
 class Broker {
 public:
 	Broker(bool (*producer)(void *context) /* throw (PCException) */,
@@ -224,6 +466,239 @@ protected:
 			/* throw (PCException) */;
 };
 
+/**
+ * A pool of worker threads executing tasks by work stealing.
+ *
+ * Each worker has its own queue of tasks. A worker takes the task submitted
+ * last from its own queue, and steals the task submitted first from
+ * the queue of another worker when its own queue is empty.
+ * Tasks submitted by a worker go to the queue of the worker, so that they
+ * are likely to be executed while their data are in the cache of the worker.
+ * Tasks submitted by other threads are distributed to the queues in turn.
+ *
+ * The number of tasks waiting for execution is bounded.
+ * @ref Submit() called by a thread other than the workers blocks while
+ * the queues are full, and that called by a worker executes the task
+ * immediately instead.
+ *
+ * If a task throws an exception, the remaining tasks are discarded and
+ * the exception is rethrown by @ref Wait() .
+ */
+class ThreadPool {
+public:
+	typedef std::function<void()> Task;
+
+	/**
+	 * Starts worker threads.
+	 *
+	 * @param[in] num_threads The number of worker threads. If 0, the number
+	 * of hardware threads is used.
+	 * @param[in] max_queued_tasks The maximum number of tasks waiting for
+	 * execution. 0 < @a max_queued_tasks
+	 */
+	explicit ThreadPool(size_t num_threads = 0, size_t max_queued_tasks = 1024)
+			/* throw (std::system_error, std::bad_alloc) */;
+	/**
+	 * Waits for all tasks and stops worker threads.
+	 * An exception thrown by a task and not rethrown by @ref Wait() is ignored.
+	 */
+	virtual ~ThreadPool();
+
+	/**
+	 * Submits @a task to be executed by a worker.
+	 */
+	virtual void Submit(Task task) /* throw (std::bad_alloc) */;
+
+	/**
+	 * Waits until all submitted tasks have finished.
+	 * If a task has thrown an exception, rethrows the first one.
+	 * It must not be called by a worker.
+	 */
+	virtual void Wait();
+
+	/**
+	 * Returns the number of worker threads.
+	 */
+	size_t GetNumThreads() const {
+		return workers_.size();
+	}
+private:
+	ThreadPool(ThreadPool const &other);
+	ThreadPool &operator =(ThreadPool const &other);
+
+	struct Worker {
+		std::mutex mutex;
+		std::deque<Task> tasks;
+		std::thread thread;
+	};
+
+	void RunWorker(size_t index);
+	Task TakeTask(size_t index);
+	void Execute(Task const &task);
+
+	std::vector<std::unique_ptr<Worker> > workers_;
+	size_t max_queued_tasks_;
+	std::mutex mutex_;
+	std::condition_variable task_available_;
+	std::condition_variable space_available_;
+	std::condition_variable all_finished_;
+	/**
+	 * The number of tasks submitted and not reserved by workers yet
+	 */
+	size_t num_pending_;
+	/**
+	 * The number of tasks in the queues not reserved by workers yet
+	 */
+	size_t num_queued_;
+	/**
+	 * The number of tasks submitted and not finished yet
+	 */
+	size_t num_unfinished_;
+	size_t next_worker_;
+	bool stopping_;
+	bool cancelled_;
+	std::exception_ptr error_;
+};
+
+/**
+ * Returns the thread pool shared by the kernels of Sakura Library.
+ *
+ * It has as many workers as hardware threads and is created on the first
+ * call. Tasks submitted to it must not throw, since an exception would
+ * cancel the tasks of other users. Returns nullptr if it can't be created.
+ */
+ThreadPool *GetSharedThreadPool() noexcept;
+
+/**
+ * Calls @a body ( @a worker , @a item ) for each @a item in [0, @a num_items )
+ * in up to @a num_threads threads, i.e. the calling thread and up to
+ * @a num_threads - 1 workers of @a pool .
+ *
+ * The threads take items one by one from a shared counter. @a worker is
+ * the index of the thread in [0, min( @a num_threads , @a num_items )),
+ * and 0 for the calling thread, so that @a body can keep per-thread state
+ * indexed by it. As the calling thread takes items as well, all the items
+ * are processed even if the workers are busy with other tasks.
+ *
+ * If @a body throws an exception, the remaining items are skipped and
+ * the first exception is rethrown after all the calls of @a body finish.
+ * Unlike @ref ThreadPool::Wait() , it waits only for its own tasks, so that
+ * it may be called concurrently and by a worker of @a pool .
+ *
+ * @param[in] pool The pool to run the workers. If nullptr,
+ * @ref GetSharedThreadPool() is used.
+ */
+void ParallelFor(size_t num_threads, size_t num_items,
+		std::function<void(size_t worker, size_t item)> const &body,
+		ThreadPool *pool = nullptr);
+
+namespace detail {
+/**
+ * Producers and consumers run by @ref RunProducersAndConsumers() .
+ */
+template<class Product>
+class ProducersAndConsumers: public std::enable_shared_from_this<
+		ProducersAndConsumers<Product> > {
+public:
+	ProducersAndConsumers(ThreadPool *pool,
+			std::function<bool(size_t, Product *)> const &produce,
+			std::function<void(Product &)> const &consume, size_t max_products) :
+			pool_(pool), produce_(produce), consume_(consume), num_available_(
+					max_products) {
+	}
+
+	/**
+	 * Submits a task to produce a product by producer @a i .
+	 */
+	void SubmitProducer(size_t i) {
+		auto self = this->shared_from_this();
+		pool_->Submit([self, i]() {self->Produce(i);});
+	}
+private:
+	void Produce(size_t i) {
+		{
+			std::lock_guard<std::mutex> lock(mutex_);
+			if (num_available_ == 0) {
+				parked_producers_.push_back(i);
+				return;
+			}
+			--num_available_;
+		}
+		auto product = std::make_shared<Product>();
+		if (!produce_(i, product.get())) {
+			Release();
+			return;
+		}
+		auto self = this->shared_from_this();
+		pool_->Submit([self, product]() {
+			self->consume_(*product);
+			self->Release();
+		});
+		SubmitProducer(i);
+	}
+
+	/**
+	 * Makes room for a product and resumes a parked producer if any.
+	 */
+	void Release() {
+		size_t parked = 0;
+		{
+			std::lock_guard<std::mutex> lock(mutex_);
+			++num_available_;
+			if (parked_producers_.empty()) {
+				return;
+			}
+			parked = parked_producers_.back();
+			parked_producers_.pop_back();
+		}
+		SubmitProducer(parked);
+	}
+
+	ThreadPool *pool_;
+	std::function<bool(size_t, Product *)> produce_;
+	std::function<void(Product &)> consume_;
+	std::mutex mutex_;
+	size_t num_available_;
+	std::vector<size_t> parked_producers_;
+};
+} // namespace detail
+
+/**
+ * Runs @a num_producers producers and consumers as tasks of @a pool .
+ *
+ * Each call of @a produce( @a i , @a product ) by producer @a i makes one
+ * product into a default-constructed @a Product and returns true, or returns
+ * false if the producer has no more products. Each product is passed to
+ * @a consume by a task submitted by the worker which produced it. Calls of
+ * @a produce with different @a i and calls of @a consume may be executed
+ * concurrently, while calls of @a produce with the same @a i are executed
+ * one by one. Products are not necessarily consumed in the order of
+ * production.
+ *
+ * At most @a max_products products are produced and not consumed yet.
+ * A producer reaching this limit is resumed when a product is consumed,
+ * so that no worker blocks.
+ *
+ * Returns when all products have been consumed. If @a produce or @a consume
+ * throws an exception, the remaining tasks are discarded and the first
+ * exception is rethrown. Since it waits for all tasks of @a pool ,
+ * it must not be called by a worker of @a pool .
+ */
+template<class Product>
+void RunProducersAndConsumers(ThreadPool *pool, size_t num_producers,
+		std::function<bool(size_t producer, Product *product)> const &produce,
+		std::function<void(Product &product)> const &consume,
+		size_t max_products) {
+	assert(pool != nullptr);
+	assert(0 < max_products);
+	auto state = std::make_shared<detail::ProducersAndConsumers<Product> >(
+			pool, produce, consume, max_products);
+	for (size_t i = 0; i < num_producers; ++i) {
+		state->SubmitProducer(i);
+	}
+	pool->Wait();
+}
+
 #if 1
 template<class Context, class Product>
 class Producer {
@@ -46,6 +46,11 @@
 # define ARCH_AFTER_SANDY_BRIDGE 1
 #endif
 
+#if defined(__AVX512F__) && defined(__AVX512BW__) && defined(__AVX512VL__) \
+	&& defined(__AVX512DQ__) && !defined(ARCH_SCALAR)
+# define ARCH_AFTER_SKYLAKE_AVX512 1
+#endif
+
 #if !defined(ARCH_AFTER_SANDY_BRIDGE) && !defined(ARCH_SCALAR)
 # define ARCH_DEFAULT 1
 #endif
@@ -56,6 +61,19 @@
 #define CONCAT_SYM(A, B) A ## B
 #define ADDSUFFIX(A, B) CONCAT_SYM(A, B)
 
+/*
+ * With ARCH_DISPATCH, the modules having ISA specific kernels are compiled
+ * once per ISA and their API functions are suffixed by ARCH_SUFFIX
+ * (e.g. sakura_ComputeStatisticsFloatHaswell).
+ * arch_dispatch.cc provides the unsuffixed API which forwards to
+ * the variant selected at Initialize.
+ */
+#if defined(ARCH_DISPATCH)
+# define LIBSAKURA_ARCH_SYMBOL(x) ADDSUFFIX(LIBSAKURA_SYMBOL(x), ARCH_SUFFIX)
+#else
+# define LIBSAKURA_ARCH_SYMBOL(x) LIBSAKURA_SYMBOL(x)
+#endif
+
 #define ELEMENTSOF(x) (sizeof(x) / sizeof((x)[0]))
 #define STATIC_ASSERT(x) static_assert((x), # x)
 
@@ -77,7 +95,7 @@
 # undef LIBSAKURA_ALIGNMENT
 # define LIBSAKURA_ALIGNMENT (128u/* sse 128bits */ / 8u)
 #endif
-#if defined(__AVX__)
+#if defined(__AVX__) || defined(ARCH_DISPATCH)
 # undef LIBSAKURA_ALIGNMENT
 # define LIBSAKURA_ALIGNMENT (256u/* avx 256bits */ / 8u)
 #endif
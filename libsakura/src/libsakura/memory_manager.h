@@ -118,11 +118,13 @@ public:
 
 	Memory() = default;
 private:
-	friend ::LIBSAKURA_SYMBOL(Status) (::LIBSAKURA_SYMBOL(Initialize))(
+	friend ::LIBSAKURA_SYMBOL(Status) (::LIBSAKURA_SYMBOL(InitializeWithMemoryPolicy))(
 			::LIBSAKURA_SYMBOL(UserAllocator) allocator,
-			::LIBSAKURA_SYMBOL(UserDeallocator) deallocator) noexcept;
+			::LIBSAKURA_SYMBOL(UserDeallocator) deallocator,
+			::LIBSAKURA_SYMBOL(MemoryPolicy) policy) noexcept;
 	static ::LIBSAKURA_SYMBOL(UserAllocator) allocator_;
 	static ::LIBSAKURA_SYMBOL(UserDeallocator) deallocator_;
+	static bool use_pool_;
 };
 
 template<typename T>
@@ -215,6 +215,56 @@ typename LIBSAKURA_SYMBOL(FMA)::GetType<LIBSAKURA_SYMBOL(SimdPacketSSE), float>:
 }
 #endif
 
+#if defined(__AVX512F__)
+template<>
+inline typename LIBSAKURA_SYMBOL(FMA)::GetType<LIBSAKURA_SYMBOL(SimdPacketAVX512), double>::type LIBSAKURA_SYMBOL(FMA)::MultiplyAdd<
+		LIBSAKURA_SYMBOL(SimdPacketAVX512), double>(
+		typename LIBSAKURA_SYMBOL(FMA)::GetType<
+		LIBSAKURA_SYMBOL(SimdPacketAVX512), double>::type const &a,
+		typename LIBSAKURA_SYMBOL(FMA)::GetType<
+		LIBSAKURA_SYMBOL(SimdPacketAVX512), double>::type const &b,
+		typename LIBSAKURA_SYMBOL(FMA)::GetType<
+		LIBSAKURA_SYMBOL(SimdPacketAVX512), double>::type const &c) {
+	return _mm512_fmadd_pd(a, b, c);
+}
+
+template<>
+inline typename LIBSAKURA_SYMBOL(FMA)::GetType<LIBSAKURA_SYMBOL(SimdPacketAVX512), double>::type LIBSAKURA_SYMBOL(FMA)::MultiplySub<
+		LIBSAKURA_SYMBOL(SimdPacketAVX512), double>(
+		typename LIBSAKURA_SYMBOL(FMA)::GetType<
+		LIBSAKURA_SYMBOL(SimdPacketAVX512), double>::type const &a,
+		typename LIBSAKURA_SYMBOL(FMA)::GetType<
+		LIBSAKURA_SYMBOL(SimdPacketAVX512), double>::type const &b,
+		typename LIBSAKURA_SYMBOL(FMA)::GetType<
+		LIBSAKURA_SYMBOL(SimdPacketAVX512), double>::type const &c) {
+	return _mm512_fmsub_pd(a, b, c);
+}
+
+template<>
+inline typename LIBSAKURA_SYMBOL(FMA)::GetType<LIBSAKURA_SYMBOL(SimdPacketAVX512), float>::type LIBSAKURA_SYMBOL(FMA)::MultiplyAdd<
+		LIBSAKURA_SYMBOL(SimdPacketAVX512), float>(
+		typename LIBSAKURA_SYMBOL(FMA)::GetType<
+		LIBSAKURA_SYMBOL(SimdPacketAVX512), float>::type const &a,
+		typename LIBSAKURA_SYMBOL(FMA)::GetType<
+		LIBSAKURA_SYMBOL(SimdPacketAVX512), float>::type const &b,
+		typename LIBSAKURA_SYMBOL(FMA)::GetType<
+		LIBSAKURA_SYMBOL(SimdPacketAVX512), float>::type const &c) {
+	return _mm512_fmadd_ps(a, b, c);
+}
+
+template<>
+inline typename LIBSAKURA_SYMBOL(FMA)::GetType<LIBSAKURA_SYMBOL(SimdPacketAVX512), float>::type LIBSAKURA_SYMBOL(FMA)::MultiplySub<
+		LIBSAKURA_SYMBOL(SimdPacketAVX512), float>(
+		typename LIBSAKURA_SYMBOL(FMA)::GetType<
+		LIBSAKURA_SYMBOL(SimdPacketAVX512), float>::type const &a,
+		typename LIBSAKURA_SYMBOL(FMA)::GetType<
+		LIBSAKURA_SYMBOL(SimdPacketAVX512), float>::type const &b,
+		typename LIBSAKURA_SYMBOL(FMA)::GetType<
+		LIBSAKURA_SYMBOL(SimdPacketAVX512), float>::type const &c) {
+	return _mm512_fmsub_ps(a, b, c);
+}
+#endif
+
 /**
  * @~japanese
  *
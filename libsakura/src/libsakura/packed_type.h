@@ -391,9 +391,124 @@ typedef struct {
 	 */
 	typedef LIBSAKURA_SYMBOL(SimdArchSSE) PriorArch;
 }LIBSAKURA_SYMBOL(SimdArchAVX);
+
+#if defined(__AVX512F__)
+
+/**
+ * @~japanese
+ * @brief 	一度のベクトル演算で処理するデータの固まり(Packet)を格納する型(AVX-512用)である。
+ *
+ * 各メンバーの詳細は@ref sakura_SimdPacketMMX を参照。
+ *
+ * LIBSAKURA_ALIGNMENT はAVXの256bitのままなので、
+ * このパケット型の配列としてアラインされたデータにアクセスしてはならない。
+ * _mm512_loadu_ps などのアライメントを仮定しない命令を用いること。
+ */
+union LIBSAKURA_SYMBOL(SimdPacketAVX512) {
+	enum {
+		kSize = sizeof(__m512 ),
+		kNumFloat = kSize / sizeof(float),
+		kNumDouble = kSize / sizeof(double),
+		kNumInt32 = kSize / sizeof(int32_t),
+		kNumInt64 = kSize / sizeof(int64_t),
+	};
+
+	typedef __m512 RawFloat;
+	typedef __m512d RawDouble;
+	typedef __m512i RawInt32;
+	typedef __m512i RawInt64;
+	/**
+	 * @~japanese
+	 * @brief 要素ごとの真偽値を1bitずつ保持するマスクレジスタの型(float, int32_t用)
+	 */
+	typedef __mmask16 Mask32;
+	/**
+	 * @~japanese
+	 * @brief 要素ごとの真偽値を1bitずつ保持するマスクレジスタの型(double, int64_t用)
+	 */
+	typedef __mmask8 Mask64;
+	RawInt64 raw_int64;
+	RawFloat raw_float;
+	RawDouble raw_double;
+	RawInt32 raw_int32;
+
+	inline void set1(double value) {
+		raw_double = _mm512_set1_pd(value);
+	}
+	inline void set1(float value) {
+		raw_float = _mm512_set1_ps(value);
+	}
+	inline void set1(int8_t value) {
+		raw_int32 = _mm512_set1_epi8(value);
+	}
+	inline void set1(int16_t value) {
+		raw_int32 = _mm512_set1_epi16(value);
+	}
+	inline void set1(int32_t value) {
+		raw_int32 = _mm512_set1_epi32(value);
+	}
+	inline void set1(int64_t value) {
+		raw_int64 = _mm512_set1_epi64(value);
+	}
+
+	typedef struct {
+		float v[kNumFloat];
+	} VFloat;
+	typedef struct {
+		double v[kNumDouble];
+	} VDouble;
+	typedef struct {
+		int32_t v[kNumInt32];
+	} VInt32;
+	typedef struct {
+		int64_t v[kNumInt64];
+	} VInt64;
+	VFloat v_float;
+	VDouble v_double;
+	VInt32 v_int32;
+	VInt64 v_int64;
+
+	/**
+	 * @~japanese
+	 * @brief 	前の世代のSIMDアーキテクチャーのPacket型(@ref sakura_SimdPacketAVX)
+	 */
+	typedef struct {
+		LIBSAKURA_SYMBOL(SimdPacketAVX) v[kSize
+				/ LIBSAKURA_SYMBOL(SimdPacketAVX)::kSize];
+	} VPrior;
+	/**
+	 * @~japanese
+	 * @brief 	前の世代のSIMDアーキテクチャーのPacket型(@ref sakura_SimdPacketAVX)の配列としてアクセスするためのメンバー
+	 */
+	VPrior v_prior;
+};
+
+/**
+ * SIMDアーキテクチャーを識別する型(AVX-512)
+ */
+typedef struct {
+	// 512bit
+	/**
+	 * @~japanese
+	 * @brief
+	 * このアーキテクチャーにおけるPacket型
+	 */
+	typedef LIBSAKURA_SYMBOL(SimdPacketAVX512) PacketType;
+	/**
+	 * @~japanese
+	 * @brief
+	 * 前の世代のSIMDアーキテクチャーの型
+	 */
+	typedef LIBSAKURA_SYMBOL(SimdArchAVX) PriorArch;
+}LIBSAKURA_SYMBOL(SimdArchAVX512);
+#endif /* defined(__AVX512F__) */
 #endif /* defined(__AVX__) */
 
 #if defined(__AVX__)
+/*
+ * AVX-512 is not the native architecture even if it is available,
+ * since the packets are not aligned in LIBSAKURA_ALIGNMENT.
+ */
 /**
  * @~japanese
  * @brief サポートされている最新のSIMDアーキテクチャー
@@ -0,0 +1,156 @@
+/*
+ * @SAKURA_LICENSE_HEADER_START@
+ * Copyright (C) 2013-2022
+ * Inter-University Research Institute Corporation, National Institutes of Natural Sciences
+ * 2-21-1, Osawa, Mitaka, Tokyo, 181-8588, Japan.
+ *
+ * This file is part of Sakura.
+ *
+ * Sakura is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or (at your
+ * option) any later version.
+ *
+ * Sakura is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public
+ * License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Sakura.  If not, see <http://www.gnu.org/licenses/>.
+ * @SAKURA_LICENSE_HEADER_END@
+ */
+/*
+ * profiler.h
+ *
+ * Per-kernel call counters reported by sakura_GetKernelProfiles.
+ */
+
+#ifndef LIBSAKURA_LIBSAKURA_PROFILER_H_
+#define LIBSAKURA_LIBSAKURA_PROFILER_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <chrono>
+
+#include "libsakura/config.h"
+#include "libsakura/localdef.h"
+
+/*
+ * X(name) for each profiled API function.
+ */
+#define LIBSAKURA_PROFILED_KERNELS(X) \
+	X(ComputeStatisticsFloat) \
+	X(ComputeAccurateStatisticsFloat) \
+	X(ComputeAccurateStatisticsParallelFloat) \
+	X(ComputeStatisticsBatchFloat) \
+	X(UpdateStatisticsAccumulatorFloat) \
+	X(ComputeStddevFloat) \
+	X(ComputeMeanAndStddevFloat) \
+	X(SortValidValuesDenselyFloat) \
+	X(ComputeQuantilesFloat) \
+	X(ComputeMedianFloat) \
+	X(ComputeMedianAndMedianAbsoluteDeviationFloat) \
+	X(SetFalseIfNanOrInfFloat) \
+	X(CalibrateDataWithArrayScalingFloat) \
+	X(GridConvolvingFloat) \
+	X(GridConvolvingParallelFloat) \
+	X(LSQFitPolynomialFloat) \
+	X(LSQFitPolynomialBatchFloat) \
+	X(LSQFitCubicSplineFloat) \
+	X(LSQFitSinusoidFloat) \
+	X(SubtractPolynomialFloat) \
+	X(Convolve1DFloat) \
+	X(Convolve1DFFTFloat) \
+	X(Convolve1DFFTBatchFloat) \
+	X(InterpolateXAxisFloat) \
+	X(InterpolateYAxisFloat) \
+	X(ExecuteInterpolationPlanXAxisFloat) \
+	X(ExecuteInterpolationPlanYAxisFloat) \
+	X(ExecuteReductionPipelineFloat) \
+	X(UpdateQuantileSketchFloat)
+
+/*
+ * Name of the code path the including module is compiled for:
+ * the ISA variant with ARCH_DISPATCH, otherwise the widest ISA enabled.
+ */
+#define LIBSAKURA_STRINGIFY_(x) #x
+#define LIBSAKURA_STRINGIFY(x) LIBSAKURA_STRINGIFY_(x)
+#if defined(ARCH_DISPATCH) && defined(ARCH_SUFFIX)
+# define LIBSAKURA_SIMD_PATH LIBSAKURA_STRINGIFY(ARCH_SUFFIX)
+#elif defined(ARCH_SCALAR)
+# define LIBSAKURA_SIMD_PATH "Scalar"
+#elif defined(__AVX512F__)
+# define LIBSAKURA_SIMD_PATH "AVX512"
+#elif defined(__AVX2__)
+# define LIBSAKURA_SIMD_PATH "AVX2"
+#elif defined(__AVX__)
+# define LIBSAKURA_SIMD_PATH "AVX"
+#elif defined(__SSE4_1__)
+# define LIBSAKURA_SIMD_PATH "SSE4"
+#else
+# define LIBSAKURA_SIMD_PATH "Generic"
+#endif
+
+namespace LIBSAKURA_PREFIX {
+
+enum class ProfiledKernel {
+#define LIBSAKURA_PROFILED_KERNEL_ID(name) k##name,
+	LIBSAKURA_PROFILED_KERNELS(LIBSAKURA_PROFILED_KERNEL_ID)
+#undef LIBSAKURA_PROFILED_KERNEL_ID
+	kNumElements
+};
+
+/**
+ * @brief Adds a call of @a kernel to the counters of the calling thread.
+ *
+ * Defined in profiler.cc, outside of the modules compiled per ISA, so that
+ * all the variants share the same counters.
+ *
+ * MT-safe
+ */
+void RecordKernelCall(ProfiledKernel kernel, uint64_t num_bytes,
+		uint64_t nanoseconds, char const *simd_path) noexcept;
+
+/**
+ * @brief Measures the lifetime of the object as a call of a kernel.
+ */
+class ScopedKernelProfile {
+public:
+	ScopedKernelProfile(ProfiledKernel kernel, uint64_t num_bytes,
+			char const *simd_path) noexcept :
+			kernel_(kernel), num_bytes_(num_bytes), simd_path_(simd_path), start_(
+					std::chrono::steady_clock::now()) {
+	}
+	~ScopedKernelProfile() {
+		auto const elapsed = std::chrono::steady_clock::now() - start_;
+		RecordKernelCall(kernel_, num_bytes_,
+				std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count(),
+				simd_path_);
+	}
+	ScopedKernelProfile(ScopedKernelProfile const &) = delete;
+	ScopedKernelProfile &operator=(ScopedKernelProfile const &) = delete;
+private:
+	ProfiledKernel const kernel_;
+	uint64_t const num_bytes_;
+	char const * const simd_path_;
+	std::chrono::steady_clock::time_point const start_;
+};
+
+} /* namespace LIBSAKURA_PREFIX */
+
+/*
+ * Put LIBSAKURA_PROFILE_KERNEL(name, num_bytes) at the top of an API function
+ * listed in LIBSAKURA_PROFILED_KERNELS to count its calls.
+ * It expands to nothing unless Sakura is configured with ENABLE_PROFILING.
+ */
+#if LIBSAKURA_HAS_PROFILING
+# define LIBSAKURA_PROFILE_KERNEL(name, num_bytes) \
+	::LIBSAKURA_PREFIX::ScopedKernelProfile libsakura_kernel_profile( \
+			::LIBSAKURA_PREFIX::ProfiledKernel::k##name, (num_bytes), \
+			LIBSAKURA_SIMD_PATH)
+#else
+# define LIBSAKURA_PROFILE_KERNEL(name, num_bytes) static_cast<void>(0)
+#endif
+
+#endif /* LIBSAKURA_LIBSAKURA_PROFILER_H_ */
@@ -127,6 +127,56 @@ LIBSAKURA_SYMBOL(UserAllocator) allocator,
 LIBSAKURA_SYMBOL(UserDeallocator) deallocator)
 		LIBSAKURA_NOEXCEPT LIBSAKURA_WARN_UNUSED_RESULT;
 
+/**
+ * @brief Policies of dynamic memory allocation in Sakura Library.
+ */
+typedef enum {
+	/**
+	 * @brief Every allocation and deallocation is passed to the allocator and
+	 * the deallocator given to @ref sakura_InitializeWithMemoryPolicy .
+	 */LIBSAKURA_SYMBOL(MemoryPolicy_kDirect),
+	/**
+	 * @brief Blocks up to 1 MiB are rounded up to a power of 2 and cached per thread
+	 * after they are freed, so that they are reused by later allocations of the same
+	 * size class in the same thread without calling the allocator.
+	 *
+	 * Each thread caches at most about 1 MiB of free blocks per size class.
+	 * Cached blocks are released to the deallocator when the thread exits,
+	 * or when @ref sakura_CleanUp is called for the calling thread.
+	 * Blocks freed after the cache of the calling thread is destroyed, e.g. by
+	 * destructors of static objects, are cached in a cache shared by such
+	 * threads, which is released by @ref sakura_CleanUp .
+	 */LIBSAKURA_SYMBOL(MemoryPolicy_kThreadLocalPool),
+	/**
+	 * @brief Number of policies
+	 */LIBSAKURA_SYMBOL(MemoryPolicy_kNumElements)
+}LIBSAKURA_SYMBOL(MemoryPolicy);
+
+/**
+ * @brief Initializes Sakura Library with a policy of memory allocation.
+ *
+ * The same as @ref sakura_Initialize except that @a policy is used to allocate
+ * memory. @ref sakura_Initialize is equivalent to this function with
+ * @a policy = @link sakura_MemoryPolicy::sakura_MemoryPolicy_kDirect sakura_MemoryPolicy_kDirect @endlink.
+ *
+ * A block allocated before this function is called again with another policy
+ * is still freed correctly. A pooled block is released to the deallocator
+ * that was given when it was allocated, while the other blocks are released to
+ * the current deallocator.
+ *
+ * @param[in]	allocator	See @ref sakura_Initialize .
+ * @param[in]	deallocator	See @ref sakura_Initialize .
+ * @param[in]	policy	Policy of memory allocation.
+ * @return Only when @ref sakura_Status_kOK is returned, you can use Sakura Library.
+ * @ref sakura_Status_kInvalidArgument is returned if @a policy is invalid.
+ *
+ * MT-unsafe
+ */LIBSAKURA_SYMBOL(Status) LIBSAKURA_SYMBOL(InitializeWithMemoryPolicy)(
+LIBSAKURA_SYMBOL(UserAllocator) allocator,
+LIBSAKURA_SYMBOL(UserDeallocator) deallocator,
+LIBSAKURA_SYMBOL(MemoryPolicy) policy)
+		LIBSAKURA_NOEXCEPT LIBSAKURA_WARN_UNUSED_RESULT;
+
 /**
  * @brief Cleans up Sakura Library.
  *
@@ -136,6 +186,120 @@ LIBSAKURA_SYMBOL(UserDeallocator) deallocator)
  */
 void LIBSAKURA_SYMBOL(CleanUp)() LIBSAKURA_NOEXCEPT;
 
+/**
+ * @brief Statistics of dynamic memory allocation in Sakura Library.
+ *
+ * All the counts are cumulative since Sakura Library is loaded.
+ * Only blocks pooled with
+ * @link sakura_MemoryPolicy::sakura_MemoryPolicy_kThreadLocalPool sakura_MemoryPolicy_kThreadLocalPool @endlink
+ * are counted. Blocks larger than 1 MiB are not pooled.
+ */
+typedef struct {
+	/**
+	 * @brief The number of memory blocks requested by Sakura Library.
+	 */
+	uint64_t num_allocations;
+	/**
+	 * @brief The number of memory blocks freed by Sakura Library.
+	 */
+	uint64_t num_frees;
+	/**
+	 * @brief The number of allocations served by the thread local pool.
+	 */
+	uint64_t num_pool_hits;
+	/**
+	 * @brief The number of calls to the allocator.
+	 */
+	uint64_t num_upstream_allocations;
+	/**
+	 * @brief The number of calls to the deallocator.
+	 */
+	uint64_t num_upstream_frees;
+}LIBSAKURA_SYMBOL(MemoryStatistics);
+
+/**
+ * @brief Returns statistics of dynamic memory allocation.
+ *
+ * Counts of threads running in Sakura Library may not be up to date.
+ *
+ * @param[out] statistics Statistics of all the threads.
+ * @return Status code.
+ *
+ * MT-safe
+ */LIBSAKURA_SYMBOL(Status) LIBSAKURA_SYMBOL(GetMemoryStatistics)(
+LIBSAKURA_SYMBOL(MemoryStatistics) *statistics) LIBSAKURA_NOEXCEPT;
+
+/**
+ * @brief Counters of calls of an API function.
+ *
+ * All the counts are cumulative since Sakura Library is loaded
+ * or @ref sakura_ResetKernelProfiles is called.
+ */
+typedef struct {
+	/**
+	 * @brief Name of the API function without the prefix, e.g. "ComputeStatisticsFloat".
+	 */
+	char const *name;
+	/**
+	 * @brief Name of the code path the last call ran, e.g. "Haswell" if Sakura Library is built
+	 * with SIMD_ARCH=DISPATCH, or "AVX2". NULL if the function has not been called.
+	 */
+	char const *simd_path;
+	/**
+	 * @brief The number of calls.
+	 */
+	uint64_t num_calls;
+	/**
+	 * @brief The number of bytes of the main input arrays passed to the calls.
+	 */
+	uint64_t num_bytes;
+	/**
+	 * @brief Elapsed time of all the calls in nanoseconds.
+	 */
+	uint64_t total_nanoseconds;
+	/**
+	 * @brief Elapsed time of the longest call in nanoseconds.
+	 */
+	uint64_t max_nanoseconds;
+}LIBSAKURA_SYMBOL(KernelProfile);
+
+/**
+ * @brief Returns true if Sakura Library is built with ENABLE_PROFILING,
+ * i.e. calls of the major API functions are counted.
+ *
+ * @return true if profiling is enabled, otherwise false
+ *
+ * MT-safe
+ */
+bool LIBSAKURA_SYMBOL(IsKernelProfilingEnabled)() LIBSAKURA_NOEXCEPT;
+
+/**
+ * @brief Returns counters of calls of the profiled API functions.
+ *
+ * Each thread counts its own calls without any lock. Counts of threads running in Sakura Library
+ * may not be up to date.
+ *
+ * @param[in] num_elements The number of elements of @a profiles .
+ * @param[out] profiles Counters of the first min(@a num_elements, @a *num_kernels) functions.
+ * It may be NULL if @a num_elements is 0.
+ * @param[out] num_kernels The number of profiled functions. 0 if Sakura Library is built without
+ * ENABLE_PROFILING.
+ * @return Status code.
+ *
+ * MT-safe
+ */LIBSAKURA_SYMBOL(Status) LIBSAKURA_SYMBOL(GetKernelProfiles)(
+		size_t num_elements, LIBSAKURA_SYMBOL(KernelProfile) profiles[],
+		size_t *num_kernels) LIBSAKURA_NOEXCEPT;
+
+/**
+ * @brief Clears counters of calls of the profiled API functions.
+ *
+ * Calls running in other threads at the same time may or may not be counted.
+ *
+ * MT-safe
+ */
+void LIBSAKURA_SYMBOL(ResetKernelProfiles)() LIBSAKURA_NOEXCEPT;
+
 /*
  * memory alignment(for SIMD)
  */
@@ -265,6 +429,171 @@ typedef struct {
 		size_t num_data, float const data[], bool const is_valid[],
 		LIBSAKURA_SYMBOL(StatisticsResultFloat) *result) LIBSAKURA_NOEXCEPT;
 
+/**
+ * @brief Same as @ref sakura_ComputeAccurateStatisticsFloat but uses multiple threads for large data.
+ *
+ * Parts of the reduction tree of @ref sakura_ComputeAccurateStatisticsFloat are
+ * reduced by different threads, and their results are reduced in the same order.
+ * Thus, the result is exactly the same as that of @ref sakura_ComputeAccurateStatisticsFloat
+ * regardless of @a num_threads . Small data, about a million elements per thread or less,
+ * are processed with fewer threads.
+ *
+ * See @ref sakura_ComputeAccurateStatisticsFloat for the parameters not described below.
+ *
+ * @param[in] num_threads The number of threads to be used. If 0 is specified,
+ * the number of concurrent threads supported by the system is used.
+ * @return Status code
+ *
+ * MT-safe
+ */LIBSAKURA_SYMBOL(Status) LIBSAKURA_SYMBOL(ComputeAccurateStatisticsParallelFloat)(
+		size_t num_data, float const data[], bool const is_valid[],
+		size_t num_threads, LIBSAKURA_SYMBOL(StatisticsResultFloat) *result)
+				LIBSAKURA_NOEXCEPT;
+
+/**
+ * @brief Computes statistics of each row of 2D data.
+ *
+ * The result of each row is the same as that of @ref sakura_ComputeStatisticsFloat
+ * for the row. Calling this function once for many short rows, e.g. spectra of
+ * a few thousand channels, is faster than calling @ref sakura_ComputeStatisticsFloat
+ * for each of them, because arguments are checked once and the final reductions
+ * of several rows are done together.
+ *
+ * @param[in] num_rows The number of rows.
+ * @param[in] num_data The number of elements in each row. @a num_data <= INT32_MAX
+ * @param[in] data Data. Its shape is [ @a num_rows ][ @a num_data ].
+ * If corresponding element in @a is_valid is true, the element in @a data must not be Inf nor NaN.
+ * <br/>must-be-aligned. In case @a num_rows > 1, every row must be aligned.
+ * @param[in] is_valid Masks of @a data. Its shape is [ @a num_rows ][ @a num_data ].
+ * If a value of element is false, the corresponding element in @a data is ignored.
+ * <br/>must-be-aligned. In case @a num_rows > 1, every row must be aligned.
+ * @param[in] num_threads The number of threads to be used. If 0 is specified,
+ * the number of concurrent threads supported by the system is used.
+ * Results don't depend on @a num_threads .
+ * @param[out] result An array of @a num_rows elements where the result of each row should be stored.
+ * @return Status code
+ *
+ * MT-safe
+ */LIBSAKURA_SYMBOL(Status) LIBSAKURA_SYMBOL(ComputeStatisticsBatchFloat)(
+		size_t num_rows, size_t num_data,
+		float const data/*[num_rows]*/[/*num_data*/],
+		bool const is_valid/*[num_rows]*/[/*num_data*/], size_t num_threads,
+		LIBSAKURA_SYMBOL(StatisticsResultFloat) result[/*num_rows*/])
+				LIBSAKURA_NOEXCEPT;
+
+/**
+ * @brief Computes mean and standard deviation of valid data.
+ *
+ * Data are read only once. The standard deviation is as accurate as that
+ * computed from the differences from the mean given by another pass,
+ * even if the mean is far larger than the standard deviation.
+ *
+ * @param[in] num_data The number of elements in @a data and @a is_valid . @a num_data <= INT32_MAX
+ * @param[in] data Data. If corresponding element in @a is_valid is true, the element in @a data must not be Inf nor NaN.
+ * <br/>must-be-aligned
+ * @param[in] is_valid Masks of @a data. If a value of element is false,
+ * the corresponding element in @a data is ignored.
+ * <br/>must-be-aligned
+ * @param[in] delta_degree_of_freedom The sum of squared differences is divided by
+ * (the number of valid elements - @a delta_degree_of_freedom ), i.e.
+ * 0 for the population standard deviation and 1 for the sample standard deviation.
+ * @param[out] mean The mean of valid elements. NaN if there is no valid element.
+ * @param[out] stddev The standard deviation of valid elements. NaN if the number of
+ * valid elements is @a delta_degree_of_freedom or less.
+ * @return Status code
+ *
+ * MT-safe
+ */LIBSAKURA_SYMBOL(Status) LIBSAKURA_SYMBOL(ComputeMeanAndStddevFloat)(
+		size_t num_data, float const data[], bool const is_valid[],
+		size_t delta_degree_of_freedom, double *mean, double *stddev)
+				LIBSAKURA_NOEXCEPT;
+
+/**
+ * @brief Statistics of data given in chunks.
+ *
+ * An accumulator holds the statistics of data given so far by
+ * @ref sakura_UpdateStatisticsAccumulatorFloat , so that statistics of data
+ * which don't fit in memory can be computed chunk by chunk.
+ * Accumulators of consecutive parts of data, which may have been computed in
+ * parallel, can be combined by @ref sakura_MergeStatisticsAccumulatorFloat .
+ * As this is a plain structure, it can be copied or sent to other processes as is.
+ */
+typedef struct {
+	/**
+	 * Statistics of valid data given so far. @a index_of_min and @a index_of_max
+	 * are positions in the whole data given so far.
+	 */
+	LIBSAKURA_SYMBOL(StatisticsResultFloat) statistics;
+	/**
+	 * The number of elements including invalid ones given so far.
+	 */
+	size_t num_data;
+}LIBSAKURA_SYMBOL(StatisticsAccumulatorFloat);
+
+/**
+ * @brief Initializes an accumulator so that it has no data.
+ *
+ * @param[out] accumulator An accumulator.
+ * @return Status code
+ *
+ * MT-safe
+ */LIBSAKURA_SYMBOL(Status) LIBSAKURA_SYMBOL(InitializeStatisticsAccumulatorFloat)(
+		LIBSAKURA_SYMBOL(StatisticsAccumulatorFloat) *accumulator)
+				LIBSAKURA_NOEXCEPT;
+
+/**
+ * @brief Adds a chunk of data following the data given so far to an accumulator.
+ *
+ * The chunk is reduced in the same way as @ref sakura_ComputeAccurateStatisticsFloat .
+ *
+ * @param[in] num_data The number of elements in @a data and @a is_valid . @a num_data <= INT32_MAX
+ * @param[in] data Data. If corresponding element in @a is_valid is true, the element in @a data must not be Inf nor NaN.
+ * <br/>must-be-aligned
+ * @param[in] is_valid Masks of @a data. If a value of element is false,
+ * the corresponding element in @a data is ignored.
+ * <br/>must-be-aligned
+ * @param[in,out] accumulator An accumulator initialized by @ref sakura_InitializeStatisticsAccumulatorFloat .
+ * @return Status code
+ *
+ * MT-safe, but an accumulator must not be updated by more than one thread at a time.
+ */LIBSAKURA_SYMBOL(Status) LIBSAKURA_SYMBOL(UpdateStatisticsAccumulatorFloat)(
+		size_t num_data, float const data[], bool const is_valid[],
+		LIBSAKURA_SYMBOL(StatisticsAccumulatorFloat) *accumulator)
+				LIBSAKURA_NOEXCEPT;
+
+/**
+ * @brief Adds statistics of data following the data of an accumulator to it.
+ *
+ * Indices of min and max in @a increment are shifted by the number of elements of
+ * @a accumulator . Thus, merging accumulators of consecutive chunks in order gives
+ * the same result regardless of how the chunks were distributed to threads.
+ * If there is more than one occurrences of min or max value, the first one is kept.
+ *
+ * @param[in] increment An accumulator of the data following those of @a accumulator .
+ * It may be the same as @a accumulator .
+ * @param[in,out] accumulator An accumulator.
+ * @return Status code
+ *
+ * MT-safe, but an accumulator must not be updated by more than one thread at a time.
+ */LIBSAKURA_SYMBOL(Status) LIBSAKURA_SYMBOL(MergeStatisticsAccumulatorFloat)(
+		LIBSAKURA_SYMBOL(StatisticsAccumulatorFloat) const *increment,
+		LIBSAKURA_SYMBOL(StatisticsAccumulatorFloat) *accumulator)
+				LIBSAKURA_NOEXCEPT;
+
+/**
+ * @brief Gets statistics of all data given to an accumulator.
+ *
+ * @param[in] accumulator An accumulator.
+ * @param[out] result An address where the result should be stored.
+ * Its content is the same as that of @ref sakura_ComputeAccurateStatisticsFloat
+ * for the whole data except for rounding errors of @a sum and @a square_sum .
+ * @return Status code
+ *
+ * MT-safe
+ */LIBSAKURA_SYMBOL(Status) LIBSAKURA_SYMBOL(FinalizeStatisticsAccumulatorFloat)(
+		LIBSAKURA_SYMBOL(StatisticsAccumulatorFloat) const *accumulator,
+		LIBSAKURA_SYMBOL(StatisticsResultFloat) *result) LIBSAKURA_NOEXCEPT;
+
 /**
  * @brief Sorts only valid data in ascending order.
  *
@@ -307,6 +636,73 @@ LIBSAKURA_SYMBOL(Status) LIBSAKURA_SYMBOL(ComputeMedianAbsoluteDeviationFloat)(
 		size_t num_data, float const data[], float new_data[])
 				LIBSAKURA_NOEXCEPT;
 
+/**
+ * @brief Computes quantiles of valid data.
+ *
+ * Valid elements of @a data are packed to the front of @a data and partially
+ * reordered by selection instead of being sorted, so that this function runs in
+ * linear time on average.
+ * The quantile for probability p is the linear interpolation between
+ * the k-th and (k+1)-th smallest valid values where k = floor(p * (n - 1)) and
+ * n is the number of valid values. Thus, the quantile for 0.5 is the median as
+ * defined in @ref sakura_ComputeMedianAbsoluteDeviationFloat .
+ * If there is no valid data, all @a quantile are NaN.
+ *
+ * @param[in] num_data The number of elements in @a data and @a is_valid .
+ * @param[in] is_valid Masks of @a data. If a value of element is false,
+ * the corresponding element in @a data is ignored.
+ * @param[in,out] data Data. Contents of this array are not preserved.
+ * If corresponding element in @a is_valid is true, the element in @a data must not be Inf nor NaN.
+ * @param[in] num_probabilities The number of elements in @a probability and @a quantile .
+ * @param[in] probability Probabilities in [0, 1] to compute quantiles for. They need not be sorted.
+ * @param[out] quantile Quantiles for @a probability .
+ * @param[out] new_num_data The number of valid data( <= @a num_data ) is stored here.
+ * @return Status code
+ *
+ * MT-safe
+ */LIBSAKURA_SYMBOL(Status) LIBSAKURA_SYMBOL(ComputeQuantilesFloat)(
+		size_t num_data, bool const is_valid[], float data[],
+		size_t num_probabilities, double const probability[], float quantile[],
+		size_t *new_num_data) LIBSAKURA_NOEXCEPT;
+
+/**
+ * @brief Computes median of valid data.
+ *
+ * This function is equivalent to @ref sakura_ComputeMedianAndMedianAbsoluteDeviationFloat
+ * with null @a mad .
+ *
+ * MT-safe
+ */LIBSAKURA_SYMBOL(Status) LIBSAKURA_SYMBOL(ComputeMedianFloat)(
+		size_t num_data, bool const is_valid[], float data[], float *median,
+		size_t *new_num_data) LIBSAKURA_NOEXCEPT;
+
+/**
+ * @brief Computes median and median absolute deviation of valid data.
+ *
+ * Unlike @ref sakura_ComputeMedianAbsoluteDeviationFloat , @a data need not be sorted.
+ * The median and the median absolute deviation are obtained by selection
+ * in linear time on average.
+ * The median is a center value if the number of valid data is odd. Otherwise, the median is
+ * an average of two center values. The median absolute deviation is the median of
+ * abs( @a data[i] - median) over valid data.
+ * If there is no valid data, @a median and @a mad are NaN.
+ *
+ * @param[in] num_data The number of elements in @a data and @a is_valid .
+ * @param[in] is_valid Masks of @a data. If a value of element is false,
+ * the corresponding element in @a data is ignored.
+ * @param[in,out] data Data. Contents of this array are not preserved.
+ * If corresponding element in @a is_valid is true, the element in @a data must not be Inf nor NaN.
+ * @param[out] median The median.
+ * @param[out] mad The median absolute deviation. Null pointer can be given
+ * in case users do not need this value.
+ * @param[out] new_num_data The number of valid data( <= @a num_data ) is stored here.
+ * @return Status code
+ *
+ * MT-safe
+ */LIBSAKURA_SYMBOL(Status) LIBSAKURA_SYMBOL(ComputeMedianAndMedianAbsoluteDeviationFloat)(
+		size_t num_data, bool const is_valid[], float data[], float *median,
+		float *mad, size_t *new_num_data) LIBSAKURA_NOEXCEPT;
+
 /**
  * @brief Grids data with convolution.
  *
@@ -382,6 +778,51 @@ LIBSAKURA_SYMBOL(Status) LIBSAKURA_SYMBOL(ComputeMedianAbsoluteDeviationFloat)(
 		float grid/*[height][width][num_polarizations_for_grid]*/[/*num_channels_for_grid*/])
 				LIBSAKURA_NOEXCEPT LIBSAKURA_WARN_UNUSED_RESULT;
 
+/**
+ * @brief Grids data with convolution using multiple threads.
+ *
+ * This function computes the same result as @ref sakura_GridConvolvingFloat
+ * with @a num_threads threads.
+ * The grid is divided into tiles, each of which is a range of rows of the grid,
+ * and each spectrum is assigned to the tiles its convolution kernel overlaps.
+ * A tile is gridded by exactly one thread, so @a grid and @a weight_of_grid are
+ * updated without atomic operations or private copies of them.
+ * @a grid and @a weight_of_grid are identical to those computed by @ref sakura_GridConvolvingFloat .
+ * @a weight_sum may differ from that of @ref sakura_GridConvolvingFloat in the last few bits
+ * because the order of summation differs.
+ *
+ * In addition to @a grid and @a weight_of_grid, this function allocates
+ * at most 2 * (@a end_spectrum - @a start_spectrum) * sizeof(size_t) bytes to bin spectra to tiles and
+ * 4 * @a num_threads * @a num_polarizations_for_grid * @a num_channels_for_grid * sizeof(double) bytes
+ * for partial sums of @a weight_sum if @a height >= 2 * @a support + 1 .
+ *
+ * See @ref sakura_GridConvolvingFloat for the parameters not described below.
+ *
+ * @param[in] num_threads	The number of threads to be used. If 0 is specified,
+ * the number of concurrent threads supported by the system is used.
+ * If 1 is specified, this function is equivalent to @ref sakura_GridConvolvingFloat .
+ * @return Status code
+ *
+ * MT-safe
+ */LIBSAKURA_SYMBOL(Status) LIBSAKURA_SYMBOL(GridConvolvingParallelFloat)(
+		size_t num_spectra, size_t start_spectrum, size_t end_spectrum,
+		bool const spectrum_mask[/*num_spectra*/],
+		double const x[/*num_spectra*/], double const y[/*num_spectra*/],
+		size_t support, size_t sampling, size_t num_polarizations,
+		uint32_t const polarization_map[/*num_polarizations*/],
+		size_t num_channels, uint32_t const channel_map[/*num_channels*/],
+		bool const mask/*[num_spectra][num_polarizations]*/[/*num_channels*/],
+		float const value/*[num_spectra][num_polarizations]*/[/*num_channels*/],
+		float const weight/*[num_spectra]*/[/*num_channels*/], bool weight_only,
+		size_t num_convolution_table/*= ceil(sqrt(2.)*(support+1)*sampling)*/,
+		float const convolution_table[/*num_convolution_table*/],
+		size_t num_polarizations_for_grid, size_t num_channels_for_grid,
+		size_t width, size_t height, size_t num_threads,
+		double weight_sum/*[num_polarizations_for_grid]*/[/*num_channels_for_grid*/],
+		float weight_of_grid/*[height][width][num_polarizations_for_grid]*/[/*num_channels_for_grid*/],
+		float grid/*[height][width][num_polarizations_for_grid]*/[/*num_channels_for_grid*/])
+				LIBSAKURA_NOEXCEPT LIBSAKURA_WARN_UNUSED_RESULT;
+
 /**
  * @brief Sets true if the values in an input array (@a data ) are in any of specified range (inclusive).
  * @details Elements of the output array are set to true if the corresponding element in the input array
@@ -1095,6 +1536,118 @@ LIBSAKURA_SYMBOL(InterpolationMethod) interpolation_method,
 		bool interpolated_mask[/*num_interpolated*num_array*/])
 				LIBSAKURA_NOEXCEPT;
 
+/**
+ * @brief Interpolation plan that keeps everything determined by positions.
+ */
+struct LIBSAKURA_SYMBOL(InterpolationPlanFloat);
+
+/**
+ * @brief Create an interpolation plan for fixed base and interpolated positions.
+ * @details
+ * The plan performs the same interpolation as
+ * @ref sakura_InterpolateXAxisFloat or @ref sakura_InterpolateYAxisFloat
+ * for the positions given here. Locations of @a base_position with respect to
+ * @a interpolated_position, as well as factorization of the spline equation,
+ * are computed on creation. Working arrays are also allocated on creation so that
+ * @ref sakura_ExecuteInterpolationPlanXAxisFloat and
+ * @ref sakura_ExecuteInterpolationPlanYAxisFloat allocate no memory.
+ * It is efficient to interpolate many arrays sampled at the same positions
+ * by repeated executions of a plan.
+ *
+ * Unlike @ref sakura_InterpolateXAxisFloat, sort order and duplicates of
+ * @a base_position and @a interpolated_position are always checked.
+ *
+ * @note A plan can not be shared between threads, as it contains working areas
+ * exclusive for a specific thread.
+ *
+ * @param[in] interpolation_method Interpolation method.
+ * @param[in] polynomial_order Maximum polynomial order for polynomial interpolation.
+ * See @ref sakura_InterpolateXAxisFloat .
+ * @param[in] num_base Number of elements for data points. Its value must be greater than 0.
+ * @param[in] base_position Position of data points. Its length must be @a num_base.
+ * It must be sorted either ascending or descending and must not have duplicate values.
+ * must-be-aligned
+ * @param[in] num_interpolated Number of elements for points that wants to get
+ * interpolated value. Its value must be greater than 0.
+ * @param[in] interpolated_position Location of points that wants to get interpolated
+ * value. Its length must be @a num_interpolated.
+ * It must be sorted either ascending or descending and must not have duplicate values.
+ * must-be-aligned
+ * @param[out] plan Pointer to pointer to the plan. When no longer used,
+ * the plan must be destroyed by @ref sakura_DestroyInterpolationPlanFloat .
+ * Null pointer will be set to @a *plan in case this function fails.
+ * @return Status code.
+ *
+ * MT-safe
+ */LIBSAKURA_SYMBOL(Status) LIBSAKURA_SYMBOL(CreateInterpolationPlanFloat)(
+LIBSAKURA_SYMBOL(InterpolationMethod) interpolation_method,
+		uint8_t polynomial_order, size_t num_base,
+		double const base_position[/*num_base*/], size_t num_interpolated,
+		double const interpolated_position[/*num_interpolated*/],
+		struct LIBSAKURA_SYMBOL(InterpolationPlanFloat) **plan)
+				LIBSAKURA_NOEXCEPT LIBSAKURA_WARN_UNUSED_RESULT;
+
+/**
+ * @brief Perform interpolation along column by an interpolation plan.
+ * @details
+ * The result is the same as @ref sakura_InterpolateXAxisFloat with the arguments
+ * given to @ref sakura_CreateInterpolationPlanFloat . Arrays whose elements are
+ * all valid are interpolated without searching positions. Other arrays are
+ * interpolated after locating their valid elements.
+ *
+ * @param[in] plan A plan created by @ref sakura_CreateInterpolationPlanFloat .
+ * @param[in] num_array Number of arrays given in @a base_data.
+ * @param[in] base_data Value of data points. Its length must be @a num_base times @a num_array,
+ * where @a num_base is the one given to @ref sakura_CreateInterpolationPlanFloat .
+ * must-be-aligned
+ * @param[in] base_mask Boolean mask for data. Its length must be @a num_base times @a num_array.
+ * False points will be excluded from the interpolation
+ * must-be-aligned
+ * @param[out] interpolated_data Storage for interpolation result. Its length must be
+ * @a num_interpolated times @a num_array, where @a num_interpolated is the one given to
+ * @ref sakura_CreateInterpolationPlanFloat .
+ * must-be-aligned
+ * @param[out] interpolated_mask Boolean mask for interpolation result. Its length must be
+ * @a num_interpolated times @a num_array.
+ * must-be-aligned
+ * @return Status code.
+ *
+ * MT-unsafe
+ */LIBSAKURA_SYMBOL(Status) LIBSAKURA_SYMBOL(ExecuteInterpolationPlanXAxisFloat)(
+		struct LIBSAKURA_SYMBOL(InterpolationPlanFloat) *plan, size_t num_array,
+		float const base_data[/*num_base*num_array*/],
+		bool const base_mask[/*num_base*num_array*/],
+		float interpolated_data[/*num_interpolated*num_array*/],
+		bool interpolated_mask[/*num_interpolated*num_array*/])
+				LIBSAKURA_NOEXCEPT;
+
+/**
+ * @brief Perform interpolation along row by an interpolation plan.
+ * @details
+ * The result is the same as @ref sakura_InterpolateYAxisFloat with the arguments
+ * given to @ref sakura_CreateInterpolationPlanFloat . See
+ * @ref sakura_ExecuteInterpolationPlanXAxisFloat for parameters.
+ *
+ * MT-unsafe
+ */LIBSAKURA_SYMBOL(Status) LIBSAKURA_SYMBOL(ExecuteInterpolationPlanYAxisFloat)(
+		struct LIBSAKURA_SYMBOL(InterpolationPlanFloat) *plan, size_t num_array,
+		float const base_data[/*num_base*num_array*/],
+		bool const base_mask[/*num_base*num_array*/],
+		float interpolated_data[/*num_interpolated*num_array*/],
+		bool interpolated_mask[/*num_interpolated*num_array*/])
+				LIBSAKURA_NOEXCEPT;
+
+/**
+ * @brief Destroy an interpolation plan.
+ * @details
+ * @param[in] plan A plan created by @ref sakura_CreateInterpolationPlanFloat .
+ * @return Status code.
+ *
+ * MT-safe
+ */LIBSAKURA_SYMBOL(Status) LIBSAKURA_SYMBOL(DestroyInterpolationPlanFloat)(
+		struct LIBSAKURA_SYMBOL(InterpolationPlanFloat) *plan)
+				LIBSAKURA_NOEXCEPT;
+
 /**
  * @brief Normalize data against reference value with scaling factor.
  * @details
@@ -1185,6 +1738,26 @@ LIBSAKURA_SYMBOL(Status) LIBSAKURA_SYMBOL(CalibrateDataWithConstScalingFloat)(
  */
 struct LIBSAKURA_SYMBOL(Convolve1DContextFloat);
 
+/**
+ * @brief Enumerations to define precision of Fourier transformation.
+ */
+typedef enum {
+	/**
+	 * @brief Double precision
+	 */LIBSAKURA_SYMBOL(FFTPrecision_kDouble),
+
+	/**
+	 * @brief Single precision
+	 *
+	 * If Sakura Library is built without the single precision library of
+	 * FFTW (fftw3f), double precision is used instead.
+	 */LIBSAKURA_SYMBOL(FFTPrecision_kSingle),
+
+	/**
+	 * @brief Number of precisions
+	 */LIBSAKURA_SYMBOL(FFTPrecision_kNumElements)
+}LIBSAKURA_SYMBOL(FFTPrecision);
+
 /**
  * @brief Create Gaussian kernel.
  *
@@ -1286,7 +1859,14 @@ LIBSAKURA_SYMBOL(Status) LIBSAKURA_SYMBOL(CreateConvolve1DContextFFTFloat)(
  * used as an indicator of degree of mask affecting the corresponding
  * elements in @a output_data. @n
  * Note, however, elements near the edge of array also have small weights
- * because of boundary effect.
+ * because of boundary effect. @n
+ * Computational cost of this function is proportional to
+ * @a num_data * @a num_kernel , while that of @ref sakura_Convolve1DFFTFloat
+ * is proportional to @a num_data * log( @a num_data ). If @a input_mask is
+ * all true, @ref sakura_Convolve1DFFTFloat is faster for kernels longer than
+ * a few tens of elements (e.g., about 30 elements for @a num_data = 8192
+ * on AVX2 processors). Working arrays of about 2 * ( @a num_data + @a num_kernel )
+ * doubles are allocated in this function.
  *
  * MT-safe
  *
@@ -1319,6 +1899,69 @@ LIBSAKURA_SYMBOL(Status) LIBSAKURA_SYMBOL(CreateConvolve1DContextFFTFloat)(
 		struct LIBSAKURA_SYMBOL(Convolve1DContextFloat) const *context,
 		size_t num_data, float const input_data[/*num_data*/],
 		float output_data[/*num_data*/]) LIBSAKURA_NOEXCEPT;
+/**
+ * @brief Create context for convolution of many spectra using Fourier transformation.
+ * @details
+ * The context transforms @a num_batch spectra at once by a plan created by
+ * fftw_plan_many_dft_r2c (or fftwf_plan_many_dft_r2c) in place.
+ * It is used by @ref sakura_Convolve1DFFTBatchFloat and
+ * @ref sakura_Convolve1DFFTFloat .
+ * The context created by @ref sakura_CreateConvolve1DContextFFTFloat is equivalent to
+ * the one created by this function with @a num_batch = 1 and
+ * @a precision = @link sakura_FFTPrecision::sakura_FFTPrecision_kDouble sakura_FFTPrecision_kDouble @endlink.
+ *
+ * With @link sakura_FFTPrecision::sakura_FFTPrecision_kSingle sakura_FFTPrecision_kSingle @endlink,
+ * transformation and multiplication in Fourier domain are done in single precision,
+ * which halves size of working arrays. Fourier transformation of @a kernel is always
+ * computed in double precision.
+ *
+ * @param[in] num_kernel The number of elements in the @a kernel.
+ * @a num_kernel must be positive.  0 < num_kernel <= INT_MAX
+ * @param[in] kernel Convolution kernel. All elements in @a kernel must not be Inf nor NaN.
+ * @n must-be-aligned
+ * @param[in] num_batch The number of spectra transformed at once. 0 < num_batch <= INT_MAX .
+ * Working arrays of about @a num_batch * @a num_kernel elements are allocated.
+ * @param[in] precision Precision of Fourier transformation.
+ * @param[out] context Context for convolution.
+ * It has to be destroyed by @ref sakura_DestroyConvolve1DContextFloat after use.
+ * Note also that null pointer will be set to @a *context
+ * in case this function fails.
+ *
+ * @return Status code.
+ *
+ * MT-unsafe
+ */
+LIBSAKURA_SYMBOL(Status) LIBSAKURA_SYMBOL(CreateConvolve1DContextFFTBatchFloat)(
+		size_t num_kernel, float const kernel[/*num_kernel*/], size_t num_batch,
+		LIBSAKURA_SYMBOL(FFTPrecision) precision,
+		struct LIBSAKURA_SYMBOL(Convolve1DContextFloat) **context)
+				LIBSAKURA_NOEXCEPT LIBSAKURA_WARN_UNUSED_RESULT;
+
+/**
+ * @brief Convolution of many spectra is performed using Fourier transformation.
+ * @details Each of @a num_spectra spectra is convolved as @ref sakura_Convolve1DFFTFloat does.
+ * The spectra are transformed by the number of spectra given to the @a context at once.
+ * @param[in] context
+ * The context created by @ref sakura_CreateConvolve1DContextFFTBatchFloat or
+ * @ref sakura_CreateConvolve1DContextFFTFloat .
+ * @param[in] num_spectra The number of spectra.
+ * @param[in] num_data
+ * The number of elements in a spectrum. @a num_data must be equal to @a num_kernel in @a context .
+ * 0 < @a num_data <= INT_MAX
+ * @param[in] input_data Input data of [ @a num_spectra ][ @a num_data ] elements.
+ * All elements in @a input_data must not be Inf nor NaN.
+ * @n must-be-aligned
+ * @param[out] output_data Output data of [ @a num_spectra ][ @a num_data ] elements.
+ * In-place operation ( @a input_data == @a output_data ) is allowed.
+ * @n must-be-aligned
+ * @return Status code.
+ *
+ * MT-unsafe
+ */LIBSAKURA_SYMBOL(Status) LIBSAKURA_SYMBOL(Convolve1DFFTBatchFloat)(
+		struct LIBSAKURA_SYMBOL(Convolve1DContextFloat) const *context,
+		size_t num_spectra, size_t num_data,
+		float const input_data[/*num_spectra*num_data*/],
+		float output_data[/*num_spectra*num_data*/]) LIBSAKURA_NOEXCEPT;
 /**
  * @brief Destroy context for convolution.
  * @details
@@ -1780,6 +2423,69 @@ LIBSAKURA_SYMBOL(LSQFitType) const lsqfit_type, uint16_t order, size_t num_data,
 		LIBSAKURA_SYMBOL(LSQFitStatus) *lsqfit_status)
 				LIBSAKURA_NOEXCEPT LIBSAKURA_WARN_UNUSED_RESULT;
 
+/**
+ * @brief Fit a polynomial curve to each of many spectra.
+ * @details This function is equivalent to calling
+ * @ref sakura_LSQFitPolynomialFloat with @a num_fitting_max = 1 for
+ * each of @a num_spectra spectra, but is faster for a large number of
+ * spectra. The normal equation matrix is computed and decomposed only
+ * once for a run of consecutive spectra having an identical mask, and
+ * the equations for the spectra in the run are solved at once by
+ * matrix-matrix products. Recursive clipping is not supported because
+ * it makes the masks of spectra diverge.
+ *
+ * The results may differ from those of @ref sakura_LSQFitPolynomialFloat
+ * in the last few bits because the order of summation differs.
+ *
+ * See @ref sakura_LSQFitPolynomialFloat for the parameters not described below.
+ *
+ * @param[in] num_spectra Number of spectra.
+ * @param[in] num_data Number of elements in each spectrum. It must be equal
+ * to @a num_data which was given to
+ * @ref sakura_CreateLSQFitContextPolynomialFloat to create @a context .
+ * @param[in] data Input data. Its shape is [ @a num_spectra ][ @a num_data ].
+ * @n must-be-aligned
+ * @param[in] mask Input mask. Its shape is [ @a num_spectra ][ @a num_data ].
+ * Spectra sharing a mask should be stored consecutively to benefit from
+ * this function.
+ * @n must-be-aligned
+ * @param[in] num_coeff Number of coefficients per spectrum. In case
+ * @a coeff is not null pointer, it must be equal to ( @a order +1).
+ * @param[out] coeff Coefficients. Its shape is [ @a num_spectra ][ @a num_coeff ].
+ * Null pointer can be given in case users do not need this value.
+ * @n must-be-aligned
+ * @param[out] best_fit The best-fit curve data. Its shape is
+ * [ @a num_spectra ][ @a num_data ]. Null pointer can be given in case
+ * users do not need this value.
+ * @n must-be-aligned
+ * @param[out] residual Residual (input - best-fit) data. Its shape is
+ * [ @a num_spectra ][ @a num_data ]. @a data can be set to @a residual
+ * if users want to overwrite it in-place. Null pointer can be given in
+ * case users do not need this value.
+ * @n must-be-aligned
+ * @param[out] rms The root-mean-square of residual of each spectrum.
+ * Its length is @a num_spectra .
+ * @param[in] num_threads The number of threads to be used. If 0 is specified,
+ * the number of concurrent threads supported by the system is used.
+ * @param[out] lsqfit_status LSQFit-specific error code of each spectrum.
+ * Its length is @a num_spectra . The outputs of the spectra whose status
+ * is not @ref sakura_LSQFitStatus_kOK are not updated.
+ * @return Status code. @ref sakura_Status_kNG is returned if any spectrum
+ * could not be fitted.
+ *
+ * MT-safe
+ */LIBSAKURA_SYMBOL(Status) LIBSAKURA_SYMBOL(LSQFitPolynomialBatchFloat)(
+		struct LIBSAKURA_SYMBOL(LSQFitContextFloat) const *context,
+		uint16_t order, size_t num_spectra, size_t num_data,
+		float const data/*[num_spectra]*/[/*num_data*/],
+		bool const mask/*[num_spectra]*/[/*num_data*/], size_t num_coeff,
+		double coeff/*[num_spectra]*/[/*num_coeff*/],
+		float best_fit/*[num_spectra]*/[/*num_data*/],
+		float residual/*[num_spectra]*/[/*num_data*/],
+		float rms[/*num_spectra*/], size_t num_threads,
+		LIBSAKURA_SYMBOL(LSQFitStatus) lsqfit_status[/*num_spectra*/])
+				LIBSAKURA_NOEXCEPT LIBSAKURA_WARN_UNUSED_RESULT;
+
 /**
  * @brief Fit a cubic spline curve to input data.
  * @details A cubic spline curve is fitted to input data based on
@@ -2295,6 +3001,348 @@ LIBSAKURA_SYMBOL(Status) LIBSAKURA_SYMBOL(CreateMaskNearEdgeDouble)(
 		double const y[], double const *blc_x, double const *blc_y,
 		double const *trc_x, double const *trc_y, bool mask[]);
 
+/**
+ * @brief Enumerations to define stages of @ref sakura_ReductionPipelineFloat .
+ */
+typedef enum {
+	/**
+	 * @brief Set mask to true if flag is zero, otherwise false.
+	 * Equivalent to @ref sakura_Uint8ToBool followed by @ref sakura_InvertBool .
+	 */LIBSAKURA_SYMBOL(ReductionStageType_kFlagToMask),
+	/**
+	 * @brief Set mask to false if data is NaN or Inf.
+	 */LIBSAKURA_SYMBOL(ReductionStageType_kMaskNanOrInf),
+	/**
+	 * @brief Calibrate data against reference data.
+	 * Equivalent to @ref sakura_CalibrateDataWithArrayScalingFloat or
+	 * @ref sakura_CalibrateDataWithConstScalingFloat .
+	 */LIBSAKURA_SYMBOL(ReductionStageType_kCalibrate),
+	/**
+	 * @brief Subtract polynomial baseline. Equivalent to
+	 * @ref sakura_LSQFitPolynomialFloat whose residual replaces data.
+	 * Mask is not updated by clipping.
+	 */LIBSAKURA_SYMBOL(ReductionStageType_kSubtractBaseline),
+	/**
+	 * @brief Smooth data by a kernel taking mask into account.
+	 * Equivalent to @ref sakura_Convolve1DFloat . Mask is not updated.
+	 */LIBSAKURA_SYMBOL(ReductionStageType_kSmooth),
+	/**
+	 * @brief Compute statistics of valid data. Equivalent to
+	 * @ref sakura_ComputeStatisticsFloat .
+	 */LIBSAKURA_SYMBOL(ReductionStageType_kStatistics),
+	/**
+	 * @brief Number of stage types
+	 */LIBSAKURA_SYMBOL(ReductionStageType_kNumElements)
+}LIBSAKURA_SYMBOL(ReductionStageType);
+
+/**
+ * @brief A stage of @ref sakura_ReductionPipelineFloat .
+ *
+ * Only the members for @a type are used.
+ */
+typedef struct {
+	/**
+	 * @brief Type of the stage
+	 */
+	LIBSAKURA_SYMBOL(ReductionStageType) type;
+	/**
+	 * @brief The number of elements in @a scaling_factor for
+	 * @ref sakura_ReductionStageType_kCalibrate . It must be 1 or @a num_data
+	 * of the pipeline.
+	 */
+	size_t num_scaling_factor;
+	/**
+	 * @brief Scaling factors for @ref sakura_ReductionStageType_kCalibrate .
+	 * They are copied to the pipeline.
+	 */
+	float const *scaling_factor;
+	/**
+	 * @brief A context for @ref sakura_ReductionStageType_kSubtractBaseline
+	 * created by @ref sakura_CreateLSQFitContextPolynomialFloat with @a num_data
+	 * of the pipeline. It is not copied and must not be destroyed while the
+	 * pipeline is used.
+	 */
+	struct LIBSAKURA_SYMBOL(LSQFitContextFloat) const *lsqfit_context;
+	/**
+	 * @brief Polynomial order for @ref sakura_ReductionStageType_kSubtractBaseline .
+	 */
+	uint16_t order;
+	/**
+	 * @brief Threshold of clipping in unit of sigma for
+	 * @ref sakura_ReductionStageType_kSubtractBaseline .
+	 */
+	float clip_threshold_sigma;
+	/**
+	 * @brief Upper limit of how many times fitting is performed for
+	 * @ref sakura_ReductionStageType_kSubtractBaseline .
+	 */
+	uint16_t num_fitting_max;
+	/**
+	 * @brief The number of elements in @a kernel for
+	 * @ref sakura_ReductionStageType_kSmooth . 0 < @a num_kernel <= INT_MAX
+	 */
+	size_t num_kernel;
+	/**
+	 * @brief Kernel for @ref sakura_ReductionStageType_kSmooth .
+	 * It is copied to the pipeline.
+	 */
+	float const *kernel;
+}LIBSAKURA_SYMBOL(ReductionStageFloat);
+
+/**
+ * @brief A pipeline to reduce spectra by a list of stages.
+ */
+struct LIBSAKURA_SYMBOL(ReductionPipelineFloat);
+
+/**
+ * @brief Create a pipeline to reduce spectra.
+ * @details
+ * Stages are applied to a spectrum in the order of @a stages . Stages are
+ * grouped and each group is executed over blocks of channels small enough to
+ * stay in cache, so that a spectrum is read from and written to memory once
+ * per group instead of once per stage. Only
+ * @ref sakura_ReductionStageType_kSubtractBaseline , which needs the whole
+ * spectrum, separates groups. @ref sakura_ReductionStageType_kSmooth is
+ * executed one block behind the stages before it in the same group, and a
+ * group contains at most one smoothing stage.
+ *
+ * The result is the same as that of the equivalent functions called one by
+ * one for the whole spectrum except that statistics are summed up by blocks.
+ *
+ * There is no interpolation stage. Reference data interpolated along time,
+ * e.g. by @ref sakura_InterpolateYAxisFloat , are given to
+ * @ref sakura_ExecuteReductionPipelineFloat as @a reference .
+ *
+ * @param[in] num_stages The number of stages. 0 < @a num_stages
+ * @param[in] stages Stages. At most one @ref sakura_ReductionStageType_kStatistics
+ * is allowed.
+ * @param[in] num_data The number of elements in a spectrum.
+ * 0 < @a num_data <= INT_MAX
+ * @param[out] pipeline The pipeline. It has to be destroyed by
+ * @ref sakura_DestroyReductionPipelineFloat after use.
+ * Null pointer is set to @a *pipeline in case this function fails.
+ * @return Status code.
+ *
+ * MT-safe
+ */LIBSAKURA_SYMBOL(Status) LIBSAKURA_SYMBOL(CreateReductionPipelineFloat)(
+		size_t num_stages,
+		LIBSAKURA_SYMBOL(ReductionStageFloat) const stages[/*num_stages*/],
+		size_t num_data,
+		struct LIBSAKURA_SYMBOL(ReductionPipelineFloat) **pipeline)
+				LIBSAKURA_NOEXCEPT LIBSAKURA_WARN_UNUSED_RESULT;
+
+/**
+ * @brief Reduce a spectrum by a pipeline.
+ *
+ * @param[in] pipeline A pipeline created by @ref sakura_CreateReductionPipelineFloat .
+ * @param[in] num_data The number of elements in a spectrum. It must be equal to
+ * @a num_data given to @ref sakura_CreateReductionPipelineFloat .
+ * @param[in] input_data Input data.
+ * @n must-be-aligned
+ * @param[in] input_flag Flags for @ref sakura_ReductionStageType_kFlagToMask .
+ * It may be null if @a pipeline has no such stage.
+ * @n must-be-aligned
+ * @param[in] input_mask Initial mask. It may be null if the first stage of
+ * @a pipeline is @ref sakura_ReductionStageType_kFlagToMask .
+ * @n must-be-aligned
+ * @param[in] reference Reference data for @ref sakura_ReductionStageType_kCalibrate .
+ * It may be null if @a pipeline has no such stage.
+ * @n must-be-aligned
+ * @param[out] output_data Reduced data. It may be the same as @a input_data .
+ * @n must-be-aligned
+ * @param[out] output_mask Mask of @a output_data . It may be the same as @a input_mask .
+ * @n must-be-aligned
+ * @param[out] statistics Result of @ref sakura_ReductionStageType_kStatistics .
+ * It may be null if @a pipeline has no such stage.
+ * @param[out] lsqfit_status Status of @ref sakura_ReductionStageType_kSubtractBaseline .
+ * It may be null if @a pipeline has no such stage. If fitting fails, the
+ * stages after it are not executed and the status of the fitting is returned.
+ * @return Status code.
+ *
+ * MT-unsafe. A pipeline can not be shared between threads.
+ */LIBSAKURA_SYMBOL(Status) LIBSAKURA_SYMBOL(ExecuteReductionPipelineFloat)(
+		struct LIBSAKURA_SYMBOL(ReductionPipelineFloat) *pipeline,
+		size_t num_data, float const input_data[/*num_data*/],
+		uint8_t const input_flag[/*num_data*/],
+		bool const input_mask[/*num_data*/],
+		float const reference[/*num_data*/], float output_data[/*num_data*/],
+		bool output_mask[/*num_data*/],
+		LIBSAKURA_SYMBOL(StatisticsResultFloat) *statistics,
+		LIBSAKURA_SYMBOL(LSQFitStatus) *lsqfit_status) LIBSAKURA_NOEXCEPT;
+
+/**
+ * @brief Destroy a pipeline.
+ *
+ * @param[in] pipeline A pipeline created by @ref sakura_CreateReductionPipelineFloat .
+ * @return Status code.
+ *
+ * MT-safe
+ */LIBSAKURA_SYMBOL(Status) LIBSAKURA_SYMBOL(DestroyReductionPipelineFloat)(
+		struct LIBSAKURA_SYMBOL(ReductionPipelineFloat) *pipeline)
+				LIBSAKURA_NOEXCEPT;
+
+/**
+ * @brief A mergeable sketch to approximate quantiles of data too large to be
+ * kept in memory.
+ * @details
+ * The sketch is a KLL sketch (Z. Karnin, K. Lang and E. Liberty,
+ * "Optimal Quantile Approximation in Streams", FOCS 2016). It retains a
+ * random sample of data whose size depends only on the parameter @a k
+ * given to @ref sakura_CreateQuantileSketchFloat . Sketches of parts of a
+ * dataset, updated in different threads or nodes, can be merged into the
+ * sketch of the whole dataset by @ref sakura_MergeQuantileSketchFloat , and
+ * sent between nodes by @ref sakura_SerializeQuantileSketchFloat and
+ * @ref sakura_CreateQuantileSketchFromSerializedFloat .
+ *
+ * Error bound: let n be the number of valid data given to a sketch. The
+ * rank, among the n data, of a quantile returned by
+ * @ref sakura_QueryQuantileSketchFloat differs from the exact one by at most
+ * about 2.3 / @a k^0.97 * n with probability 99%, i.e., about 1.3% of n for
+ * @a k = 200 and 0.35% for @a k = 800. The bound does not depend on n nor on
+ * the order in which data and sketches are given. Quantiles for
+ * probabilities 0 and 1 are the exact minimum and maximum. While n is less
+ * than or equal to max( @a k , 1024), no data is discarded and quantiles are
+ * exact.
+ *
+ * Memory: a sketch allocates about 2 * (3 @a k + 1500) floats at creation and
+ * never allocates more while being updated or merged.
+ */
+struct LIBSAKURA_SYMBOL(QuantileSketchFloat);
+
+/**
+ * @brief Create an empty quantile sketch.
+ *
+ * @param[in] k The parameter of accuracy and size of the sketch.
+ * 200 is a good default. 8 <= @a k <= 65535
+ * @param[out] sketch The sketch. It has to be destroyed by
+ * @ref sakura_DestroyQuantileSketchFloat after use.
+ * Null pointer is set to @a *sketch in case this function fails.
+ * @return Status code.
+ *
+ * MT-safe
+ */LIBSAKURA_SYMBOL(Status) LIBSAKURA_SYMBOL(CreateQuantileSketchFloat)(
+		size_t k, struct LIBSAKURA_SYMBOL(QuantileSketchFloat) **sketch)
+				LIBSAKURA_NOEXCEPT LIBSAKURA_WARN_UNUSED_RESULT;
+
+/**
+ * @brief Add valid data to a quantile sketch.
+ *
+ * @param[in,out] sketch A sketch.
+ * @param[in] num_data The number of elements in @a data and @a is_valid .
+ * @param[in] data Data. If corresponding element in @a is_valid is true,
+ * the element in @a data must not be Inf nor NaN.
+ * @param[in] is_valid Masks of @a data. If a value of element is false,
+ * the corresponding element in @a data is ignored.
+ * @return Status code.
+ *
+ * MT-unsafe. A sketch can not be shared between threads. Use a sketch per
+ * thread and merge them by @ref sakura_MergeQuantileSketchFloat .
+ */LIBSAKURA_SYMBOL(Status) LIBSAKURA_SYMBOL(UpdateQuantileSketchFloat)(
+		struct LIBSAKURA_SYMBOL(QuantileSketchFloat) *sketch, size_t num_data,
+		float const data[/*num_data*/], bool const is_valid[/*num_data*/])
+				LIBSAKURA_NOEXCEPT;
+
+/**
+ * @brief Add data given to a quantile sketch to another one.
+ *
+ * The error bound of the merged @a sketch is the same as that of a sketch
+ * given all data at once.
+ *
+ * @param[in] increment A sketch to be merged. It is not modified.
+ * @param[in,out] sketch A sketch to which @a increment is merged.
+ * It must be created with the same @a k as @a increment and must not be
+ * @a increment .
+ * @return Status code.
+ *
+ * MT-unsafe
+ */LIBSAKURA_SYMBOL(Status) LIBSAKURA_SYMBOL(MergeQuantileSketchFloat)(
+		struct LIBSAKURA_SYMBOL(QuantileSketchFloat) const *increment,
+		struct LIBSAKURA_SYMBOL(QuantileSketchFloat) *sketch)
+				LIBSAKURA_NOEXCEPT;
+
+/**
+ * @brief Approximate quantiles of data given to a quantile sketch.
+ *
+ * Quantiles are defined in the same way as @ref sakura_ComputeQuantilesFloat
+ * with approximate ranks. If the sketch has no data, all @a quantile are NaN.
+ *
+ * @param[in] sketch A sketch.
+ * @param[in] num_probabilities The number of elements in @a probability and @a quantile .
+ * @param[in] probability Probabilities in [0, 1] to compute quantiles for. They need not be sorted.
+ * @param[out] quantile Quantiles for @a probability .
+ * @param[out] num_data The number of valid data given to @a sketch is stored here.
+ * @return Status code.
+ *
+ * MT-safe as long as @a sketch is not modified at the same time.
+ */LIBSAKURA_SYMBOL(Status) LIBSAKURA_SYMBOL(QueryQuantileSketchFloat)(
+		struct LIBSAKURA_SYMBOL(QuantileSketchFloat) const *sketch,
+		size_t num_probabilities,
+		double const probability[/*num_probabilities*/],
+		float quantile[/*num_probabilities*/], size_t *num_data)
+				LIBSAKURA_NOEXCEPT;
+
+/**
+ * @brief Return the size of a quantile sketch serialized by
+ * @ref sakura_SerializeQuantileSketchFloat .
+ *
+ * The size is bounded by @a k given to @ref sakura_CreateQuantileSketchFloat ,
+ * about 4 * (3 @a k + 1500) bytes.
+ *
+ * @param[in] sketch A sketch.
+ * @param[out] size The size in bytes.
+ * @return Status code.
+ *
+ * MT-safe as long as @a sketch is not modified at the same time.
+ */LIBSAKURA_SYMBOL(Status) LIBSAKURA_SYMBOL(GetQuantileSketchSerializedSizeFloat)(
+		struct LIBSAKURA_SYMBOL(QuantileSketchFloat) const *sketch,
+		size_t *size) LIBSAKURA_NOEXCEPT;
+
+/**
+ * @brief Serialize a quantile sketch to send it to another node.
+ *
+ * The serialized sketch is in the native byte order.
+ *
+ * @param[in] sketch A sketch.
+ * @param[in] size The size of @a buffer in bytes. It must be equal to the size
+ * returned by @ref sakura_GetQuantileSketchSerializedSizeFloat .
+ * @param[out] buffer The serialized sketch.
+ * @return Status code.
+ *
+ * MT-safe as long as @a sketch is not modified at the same time.
+ */LIBSAKURA_SYMBOL(Status) LIBSAKURA_SYMBOL(SerializeQuantileSketchFloat)(
+		struct LIBSAKURA_SYMBOL(QuantileSketchFloat) const *sketch, size_t size,
+		void *buffer) LIBSAKURA_NOEXCEPT;
+
+/**
+ * @brief Create a quantile sketch from a sketch serialized by
+ * @ref sakura_SerializeQuantileSketchFloat .
+ *
+ * @param[in] size The size of @a buffer in bytes.
+ * @param[in] buffer The serialized sketch. @ref sakura_Status_kInvalidArgument
+ * is returned if it is broken.
+ * @param[out] sketch The sketch. It has to be destroyed by
+ * @ref sakura_DestroyQuantileSketchFloat after use.
+ * Null pointer is set to @a *sketch in case this function fails.
+ * @return Status code.
+ *
+ * MT-safe
+ */LIBSAKURA_SYMBOL(Status) LIBSAKURA_SYMBOL(CreateQuantileSketchFromSerializedFloat)(
+		size_t size, void const *buffer,
+		struct LIBSAKURA_SYMBOL(QuantileSketchFloat) **sketch)
+				LIBSAKURA_NOEXCEPT LIBSAKURA_WARN_UNUSED_RESULT;
+
+/**
+ * @brief Destroy a quantile sketch.
+ *
+ * @param[in] sketch A sketch created by @ref sakura_CreateQuantileSketchFloat
+ * or @ref sakura_CreateQuantileSketchFromSerializedFloat .
+ * @return Status code.
+ *
+ * MT-safe
+ */LIBSAKURA_SYMBOL(Status) LIBSAKURA_SYMBOL(DestroyQuantileSketchFloat)(
+		struct LIBSAKURA_SYMBOL(QuantileSketchFloat) *sketch)
+				LIBSAKURA_NOEXCEPT;
+
 #ifdef __cplusplus
 }
 /* extern "C" */
@@ -29,6 +29,7 @@
 #include "libsakura/logger.h"
 #include "libsakura/packed_type.h"
 #include "libsakura/sakura.h"
+#include "libsakura/profiler.h"
 
 using ::Eigen::Map;
 using ::Eigen::Array;
@@ -68,7 +69,73 @@ struct InPlaceImpl {
 	}
 };
 
-#if defined(__AVX__) && !defined(ARCH_SCALAR)
+#if defined(ARCH_AFTER_SKYLAKE_AVX512)
+#include <immintrin.h>
+
+/*
+ * The remainder of the data is processed by masked load/store instead of
+ * a scalar loop. Loads are unaligned since LIBSAKURA_ALIGNMENT is smaller
+ * than a packet.
+ */
+template<>
+struct InPlaceImpl<float> {
+	typedef __m512 SimdType;
+	static void CalibrateData(size_t num_data,
+			float const scaling_factor[/*num_data*/],
+			float const reference[/*num_data*/], float result[/*num_data*/]) {
+		Iterate(
+				[scaling_factor] (__mmask16 in_range, size_t position) {
+					return _mm512_maskz_loadu_ps(in_range, &scaling_factor[position]);
+				}, num_data, reference, result);
+	}
+	static void CalibrateData(float scaling_factor, size_t num_data,
+			float const reference[/*num_data*/], float result[/*num_data*/]) {
+		SimdType const packed_scalar_factor = _mm512_set1_ps(scaling_factor);
+		Iterate([packed_scalar_factor] (__mmask16 in_range, size_t position) {
+			return packed_scalar_factor;
+		}, num_data, reference, result);
+	}
+private:
+	template<class Feeder>
+	static void Iterate(Feeder factor_feeder, size_t num_data,
+			float const *reference, float *result) {
+		constexpr size_t kNumFloat =
+		LIBSAKURA_SYMBOL(SimdPacketAVX512)::kNumFloat;
+		size_t const num_packed_operation = num_data / kNumFloat;
+		for (size_t i = 0; i < num_packed_operation; ++i) {
+			auto const position = i * kNumFloat;
+			auto const packed_reference = _mm512_loadu_ps(&reference[position]);
+			// _mm512_rcp14_ps is not used for the same reason as AVX version.
+			_mm512_storeu_ps(&result[position],
+					_mm512_div_ps(
+							_mm512_mul_ps(factor_feeder(0xFFFF, position),
+									_mm512_sub_ps(
+											_mm512_loadu_ps(&result[position]),
+											packed_reference)),
+							packed_reference));
+		}
+		size_t const num_extra = num_data - num_packed_operation * kNumFloat;
+		if (num_extra > 0) {
+			auto const position = num_packed_operation * kNumFloat;
+			__mmask16 const in_range =
+					static_cast<__mmask16>((1u << num_extra) - 1);
+			// masked out lanes are 1 to avoid division by zero
+			auto const one = _mm512_set1_ps(1.f);
+			auto const packed_reference = _mm512_mask_loadu_ps(one, in_range,
+					&reference[position]);
+			_mm512_mask_storeu_ps(&result[position], in_range,
+					_mm512_div_ps(
+							_mm512_mul_ps(factor_feeder(in_range, position),
+									_mm512_sub_ps(
+											_mm512_maskz_loadu_ps(in_range,
+													&result[position]),
+											packed_reference)),
+							packed_reference));
+		}
+	}
+};
+
+#elif defined(__AVX__) && !defined(ARCH_SCALAR)
 #include <immintrin.h>
 
 template<>
@@ -212,10 +279,12 @@ void CalibrateData(DataType scaling_factor, size_t num_data,
 
 } /* anonymous namespace */
 
-extern "C" LIBSAKURA_SYMBOL(Status) LIBSAKURA_SYMBOL(CalibrateDataWithArrayScalingFloat)(
+extern "C" LIBSAKURA_SYMBOL(Status) LIBSAKURA_ARCH_SYMBOL(CalibrateDataWithArrayScalingFloat)(
 		size_t num_data, float const scaling_factor[/*num_data*/],
 		float const target[/*num_data*/], float const reference[/*num_data*/],
 		float result[/*num_data*/]) noexcept {
+	LIBSAKURA_PROFILE_KERNEL(CalibrateDataWithArrayScalingFloat,
+			num_data * 3 * sizeof(float));
 	if (num_data == 0) {
 		// Nothing to do
 		return LIBSAKURA_SYMBOL(Status_kOK);
@@ -247,7 +316,7 @@ extern "C" LIBSAKURA_SYMBOL(Status) LIBSAKURA_SYMBOL(CalibrateDataWithArrayScali
 	}
 }
 
-extern "C" LIBSAKURA_SYMBOL(Status) LIBSAKURA_SYMBOL(CalibrateDataWithConstScalingFloat)(
+extern "C" LIBSAKURA_SYMBOL(Status) LIBSAKURA_ARCH_SYMBOL(CalibrateDataWithConstScalingFloat)(
 		float scaling_factor, size_t num_data, float const target[/*num_data*/],
 		float const reference[/*num_data*/], float result[/*num_data*/])
 				noexcept {
@@ -0,0 +1,257 @@
+/*
+ * @SAKURA_LICENSE_HEADER_START@
+ * Copyright (C) 2013-2022
+ * Inter-University Research Institute Corporation, National Institutes of Natural Sciences
+ * 2-21-1, Osawa, Mitaka, Tokyo, 181-8588, Japan.
+ *
+ * This file is part of Sakura.
+ *
+ * Sakura is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or (at your
+ * option) any later version.
+ *
+ * Sakura is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public
+ * License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Sakura.  If not, see <http://www.gnu.org/licenses/>.
+ * @SAKURA_LICENSE_HEADER_END@
+ */
+/*
+ * profiler.cc
+ *
+ * Per-thread counters of the kernels listed in LIBSAKURA_PROFILED_KERNELS.
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+
+#include "libsakura/sakura.h"
+#include "libsakura/localdef.h"
+#include "libsakura/profiler.h"
+
+namespace {
+
+constexpr size_t kNumKernels =
+		static_cast<size_t>(LIBSAKURA_PREFIX::ProfiledKernel::kNumElements);
+
+#if LIBSAKURA_HAS_PROFILING
+
+char const * const kKernelNames[] = {
+#define LIBSAKURA_PROFILED_KERNEL_NAME(name) #name,
+	LIBSAKURA_PROFILED_KERNELS(LIBSAKURA_PROFILED_KERNEL_NAME)
+#undef LIBSAKURA_PROFILED_KERNEL_NAME
+};
+STATIC_ASSERT(ELEMENTSOF(kKernelNames) == kNumKernels);
+
+/**
+ * @brief Counters of a kernel in a thread.
+ *
+ * Only the owner thread updates the counters, so that no atomic
+ * read-modify-write is needed. Other threads only read them.
+ */
+struct KernelCounters {
+	std::atomic<uint64_t> num_calls;
+	std::atomic<uint64_t> num_bytes;
+	std::atomic<uint64_t> total_nanoseconds;
+	std::atomic<uint64_t> max_nanoseconds;
+};
+
+inline void Add(uint64_t value, std::atomic<uint64_t> &counter) {
+	counter.store(counter.load(std::memory_order_relaxed) + value,
+			std::memory_order_relaxed);
+}
+
+inline void AddTo(KernelCounters const &counters,
+LIBSAKURA_SYMBOL(KernelProfile) *profile) {
+	profile->num_calls += counters.num_calls.load(std::memory_order_relaxed);
+	profile->num_bytes += counters.num_bytes.load(std::memory_order_relaxed);
+	profile->total_nanoseconds += counters.total_nanoseconds.load(
+			std::memory_order_relaxed);
+	profile->max_nanoseconds = std::max(profile->max_nanoseconds,
+			counters.max_nanoseconds.load(std::memory_order_relaxed));
+}
+
+class ThreadProfile;
+
+/**
+ * @brief Guards the list of live thread profiles and @ref retired_profiles.
+ */
+std::mutex thread_profile_mutex;
+ThreadProfile *thread_profile_list = nullptr;
+/**
+ * @brief Sum of the counters of exited threads.
+ */
+LIBSAKURA_SYMBOL(KernelProfile) retired_profiles[kNumKernels];
+/**
+ * @brief Incremented by @ref sakura_ResetKernelProfiles .
+ *
+ * A thread clears its own counters when it finds the epoch changed,
+ * so that resetting never writes to counters of other threads.
+ */
+std::atomic<uint64_t> reset_epoch(0);
+/**
+ * @brief The code path of the last call of each kernel.
+ */
+std::atomic<char const *> simd_paths[kNumKernels];
+
+/**
+ * @brief Kernel counters of a thread.
+ */
+class ThreadProfile {
+public:
+	ThreadProfile() :
+			epoch_(reset_epoch.load(std::memory_order_relaxed)), previous_(
+					nullptr), next_(nullptr) {
+		Clear();
+		std::lock_guard<std::mutex> lock(thread_profile_mutex);
+		next_ = thread_profile_list;
+		if (next_ != nullptr) {
+			next_->previous_ = this;
+		}
+		thread_profile_list = this;
+	}
+	~ThreadProfile() {
+		std::lock_guard<std::mutex> lock(thread_profile_mutex);
+		if (IsCurrent()) {
+			for (size_t i = 0; i < kNumKernels; ++i) {
+				AddTo(counters_[i], &retired_profiles[i]);
+			}
+		}
+		if (previous_ != nullptr) {
+			previous_->next_ = next_;
+		} else {
+			thread_profile_list = next_;
+		}
+		if (next_ != nullptr) {
+			next_->previous_ = previous_;
+		}
+	}
+	ThreadProfile(ThreadProfile const &) = delete;
+	ThreadProfile &operator=(ThreadProfile const &) = delete;
+
+	void Record(size_t kernel, uint64_t num_bytes,
+			uint64_t nanoseconds) noexcept {
+		if (!IsCurrent()) {
+			Clear();
+			epoch_.store(reset_epoch.load(std::memory_order_relaxed),
+					std::memory_order_relaxed);
+		}
+		KernelCounters &counters = counters_[kernel];
+		Add(1, counters.num_calls);
+		Add(num_bytes, counters.num_bytes);
+		Add(nanoseconds, counters.total_nanoseconds);
+		if (nanoseconds > counters.max_nanoseconds.load(std::memory_order_relaxed)) {
+			counters.max_nanoseconds.store(nanoseconds, std::memory_order_relaxed);
+		}
+	}
+	/**
+	 * @brief Returns true if the counters were cleared after the last reset.
+	 */
+	bool IsCurrent() const noexcept {
+		return epoch_.load(std::memory_order_relaxed)
+				== reset_epoch.load(std::memory_order_relaxed);
+	}
+	KernelCounters const &counters(size_t kernel) const noexcept {
+		return counters_[kernel];
+	}
+	ThreadProfile *next() const noexcept {
+		return next_;
+	}
+private:
+	void Clear() noexcept {
+		for (size_t i = 0; i < kNumKernels; ++i) {
+			counters_[i].num_calls.store(0, std::memory_order_relaxed);
+			counters_[i].num_bytes.store(0, std::memory_order_relaxed);
+			counters_[i].total_nanoseconds.store(0, std::memory_order_relaxed);
+			counters_[i].max_nanoseconds.store(0, std::memory_order_relaxed);
+		}
+	}
+
+	KernelCounters counters_[kNumKernels];
+	std::atomic<uint64_t> epoch_;
+	ThreadProfile *previous_;
+	ThreadProfile *next_;
+};
+
+ThreadProfile &GetThreadProfile() {
+	static thread_local ThreadProfile profile;
+	return profile;
+}
+
+#endif /* LIBSAKURA_HAS_PROFILING */
+
+} /* anonymous namespace */
+
+namespace LIBSAKURA_PREFIX {
+
+void RecordKernelCall(ProfiledKernel kernel, uint64_t num_bytes,
+		uint64_t nanoseconds, char const *simd_path) noexcept {
+#if LIBSAKURA_HAS_PROFILING
+	size_t const index = static_cast<size_t>(kernel);
+	GetThreadProfile().Record(index, num_bytes, nanoseconds);
+	// Avoid writing the shared cache line on every call.
+	if (simd_paths[index].load(std::memory_order_relaxed) != simd_path) {
+		simd_paths[index].store(simd_path, std::memory_order_relaxed);
+	}
+#else
+	static_cast<void>(kernel);
+	static_cast<void>(num_bytes);
+	static_cast<void>(nanoseconds);
+	static_cast<void>(simd_path);
+#endif
+}
+
+} /* namespace LIBSAKURA_PREFIX */
+
+extern "C" bool LIBSAKURA_SYMBOL(IsKernelProfilingEnabled)() noexcept {
+	return LIBSAKURA_HAS_PROFILING != 0;
+}
+
+extern "C" LIBSAKURA_SYMBOL(Status) LIBSAKURA_SYMBOL(GetKernelProfiles)(
+		size_t num_elements, LIBSAKURA_SYMBOL(KernelProfile) profiles[],
+		size_t *num_kernels) noexcept {
+	if (num_kernels == nullptr || (num_elements > 0 && profiles == nullptr)) {
+		return LIBSAKURA_SYMBOL(Status_kInvalidArgument);
+	}
+#if LIBSAKURA_HAS_PROFILING
+	*num_kernels = kNumKernels;
+	size_t const num_profiles = std::min(num_elements, kNumKernels);
+	std::lock_guard<std::mutex> lock(thread_profile_mutex);
+	for (size_t i = 0; i < num_profiles; ++i) {
+		profiles[i] = retired_profiles[i];
+		profiles[i].name = kKernelNames[i];
+		profiles[i].simd_path = simd_paths[i].load(std::memory_order_relaxed);
+	}
+	for (ThreadProfile *profile = thread_profile_list; profile != nullptr;
+			profile = profile->next()) {
+		if (!profile->IsCurrent()) {
+			continue;
+		}
+		for (size_t i = 0; i < num_profiles; ++i) {
+			AddTo(profile->counters(i), &profiles[i]);
+		}
+	}
+#else
+	static_cast<void>(profiles);
+	*num_kernels = 0;
+#endif
+	return LIBSAKURA_SYMBOL(Status_kOK);
+}
+
+extern "C" void LIBSAKURA_SYMBOL(ResetKernelProfiles)() noexcept {
+#if LIBSAKURA_HAS_PROFILING
+	std::lock_guard<std::mutex> lock(thread_profile_mutex);
+	reset_epoch.fetch_add(1, std::memory_order_relaxed);
+	for (size_t i = 0; i < kNumKernels; ++i) {
+		retired_profiles[i] = LIBSAKURA_SYMBOL(KernelProfile)();
+		simd_paths[i].store(nullptr, std::memory_order_relaxed);
+	}
+#endif
+}
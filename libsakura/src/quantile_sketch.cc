@@ -0,0 +1,770 @@
+/*
+ * @SAKURA_LICENSE_HEADER_START@
+ * Copyright (C) 2013-2022
+ * Inter-University Research Institute Corporation, National Institutes of Natural Sciences
+ * 2-21-1, Osawa, Mitaka, Tokyo, 181-8588, Japan.
+ *
+ * This file is part of Sakura.
+ *
+ * Sakura is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or (at your
+ * option) any later version.
+ *
+ * Sakura is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public
+ * License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Sakura.  If not, see <http://www.gnu.org/licenses/>.
+ * @SAKURA_LICENSE_HEADER_END@
+ */
+/*
+ * The sketch is a KLL sketch (Z. Karnin, K. Lang and E. Liberty,
+ * "Optimal Quantile Approximation in Streams", FOCS 2016) with lazy
+ * compaction.
+ *
+ * Retained items are grouped by levels. An item at level h stands for 2^h
+ * data. Levels are stored in a single array, the lowest level first, so that
+ * the highest level ends at the end of the array and a new item is put in
+ * front of level 0. Level 0 is unsorted and the other levels are sorted.
+ * When the array is filled up to the total capacity of the levels, the lowest
+ * level whose size reaches its capacity is compacted: it is sorted, every
+ * other item starting at a random offset is promoted to the next level and
+ * the rest are discarded.
+ */
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <utility>
+
+#include <libsakura/localdef.h>
+#include <libsakura/logger.h>
+#include <libsakura/sakura.h>
+#include <libsakura/memory_manager.h>
+#include <libsakura/profiler.h>
+
+namespace {
+// a logger for this module
+auto logger = LIBSAKURA_PREFIX::Logger::GetLogger("quantile_sketch");
+
+/**
+ * @brief The maximum number of levels.
+ *
+ * An item at the highest level stands for 2^( @a kMaxNumLevels - 1 ) data.
+ */
+constexpr size_t kMaxNumLevels = 61;
+
+/**
+ * @brief The minimum capacity of a level.
+ */
+constexpr size_t kMinLevelCapacity = 8;
+
+constexpr size_t kMinK = 8;
+constexpr size_t kMaxK = 65535;
+
+constexpr uint32_t kSerializedMagic = 0x534b4c4cu; // "SKLL"
+constexpr uint32_t kSerializedVersion = 1;
+
+/**
+ * @brief Header of a serialized sketch.
+ *
+ * It is followed by the sizes of levels as uint64_t and retained items of
+ * levels from the lowest one.
+ */
+struct SerializedHeader {
+	uint32_t magic;
+	uint32_t version;
+	uint64_t k;
+	uint64_t num_levels;
+	uint64_t num_data;
+	float min;
+	float max;
+	uint64_t random_state;
+};
+static_assert(sizeof(SerializedHeader) == 48,
+		"SerializedHeader must not have padding");
+
+/**
+ * @brief The minimum capacity of level 0.
+ *
+ * Level 0 is larger than KLL requires so that it is sorted less often by
+ * RadixSort(), whose fixed cost is amortized over the items. It only retains
+ * more items of weight 1 and never makes the error bound worse.
+ */
+constexpr size_t kMinLowestLevelCapacity = 1024;
+
+/**
+ * @brief Returns the capacity of @a level out of @a num_levels levels.
+ *
+ * The capacity decreases geometrically by a factor of 2/3 from @a k at the
+ * highest level down to @a kMinLevelCapacity .
+ */
+inline size_t LevelCapacity(size_t k, size_t num_levels, size_t level) {
+	if (level == 0) {
+		return std::max(k, kMinLowestLevelCapacity);
+	}
+	size_t const depth = num_levels - 1 - level;
+	size_t capacity = k;
+	for (size_t i = 0; i < depth && capacity > kMinLevelCapacity; ++i) {
+		capacity = capacity * 2 / 3;
+	}
+	return std::max(capacity, kMinLevelCapacity);
+}
+
+/**
+ * @brief Returns the total capacity of @a num_levels levels.
+ */
+inline size_t TotalCapacity(size_t k, size_t num_levels) {
+	size_t total = 0;
+	for (size_t level = 0; level < num_levels; ++level) {
+		total += LevelCapacity(k, num_levels, level);
+	}
+	return total;
+}
+
+/**
+ * @brief Returns an unsigned integer whose order is the same as @a value .
+ */
+inline uint32_t RadixKey(float value) {
+	uint32_t bits;
+	std::memcpy(&bits, &value, sizeof(bits));
+	uint32_t const sign = static_cast<uint32_t>(static_cast<int32_t>(bits) >> 31);
+	return bits ^ (sign | UINT32_C(0x80000000));
+}
+
+/**
+ * @brief Sorts @a data in ascending order by LSD radix sort of 8 bits digits.
+ *
+ * Unlike std::sort, it has no data-dependent branch.
+ *
+ * @param[in] num_data The number of elements in @a data . It must be positive.
+ * @param[in,out] data Data to be sorted.
+ * @param[out] work Working array of @a num_data elements.
+ */
+void RadixSort(size_t num_data, float data[], float work[]) {
+	assert(num_data > 0);
+	uint32_t count[sizeof(float)][256] = { };
+	for (size_t i = 0; i < num_data; ++i) {
+		uint32_t const key = RadixKey(data[i]);
+		for (size_t digit = 0; digit < sizeof(float); ++digit) {
+			++count[digit][(key >> (8 * digit)) & 0xff];
+		}
+	}
+	float *source = data;
+	float *destination = work;
+	for (size_t digit = 0; digit < sizeof(float); ++digit) {
+		uint32_t *offset = count[digit];
+		unsigned const shift = 8 * digit;
+		// skip the digit common to all data
+		if (offset[(RadixKey(source[0]) >> shift) & 0xff] == num_data) {
+			continue;
+		}
+		uint32_t sum = 0;
+		for (size_t i = 0; i < 256; ++i) {
+			uint32_t const the_count = offset[i];
+			offset[i] = sum;
+			sum += the_count;
+		}
+		for (size_t i = 0; i < num_data; ++i) {
+			destination[offset[(RadixKey(source[i]) >> shift) & 0xff]++] =
+					source[i];
+		}
+		std::swap(source, destination);
+	}
+	if (source != data) {
+		std::copy(source, &source[num_data], data);
+	}
+}
+
+} /* anonymous namespace */
+
+extern "C" {
+struct LIBSAKURA_SYMBOL(QuantileSketchFloat) {
+	size_t k;
+	size_t num_levels;
+	/**
+	 * @brief Index of the first item of each level in @a items .
+	 * @a level_begin[ @a num_levels ] is @a capacity .
+	 */
+	size_t level_begin[kMaxNumLevels + 1];
+	/**
+	 * @brief The smallest @a level_begin[0] allowed for the current
+	 * @a num_levels
+	 */
+	size_t level_limit;
+	/**
+	 * @brief The number of elements of @a items and @a work
+	 */
+	size_t capacity;
+	/**
+	 * @brief The number of data given to the sketch
+	 */
+	size_t num_data;
+	float min;
+	float max;
+	/**
+	 * @brief State of xorshift64* to choose items to be promoted
+	 */
+	uint64_t random_state;
+	float *items;
+	/**
+	 * @brief Working array to compact a level
+	 */
+	float *work;
+	void *storage;
+};
+}
+
+namespace {
+
+typedef LIBSAKURA_SYMBOL(QuantileSketchFloat) Sketch;
+
+inline size_t NumRetained(Sketch const &sketch) {
+	return sketch.capacity - sketch.level_begin[0];
+}
+
+inline size_t NextRandomBit(Sketch *sketch) {
+	uint64_t x = sketch->random_state;
+	x ^= x >> 12;
+	x ^= x << 25;
+	x ^= x >> 27;
+	sketch->random_state = x;
+	return static_cast<size_t>((x * UINT64_C(0x2545F4914F6CDD1D)) >> 63);
+}
+
+void AddLevel(Sketch *sketch) {
+	assert(sketch->num_levels < kMaxNumLevels);
+	sketch->level_begin[sketch->num_levels + 1] = sketch->capacity;
+	++sketch->num_levels;
+	sketch->level_limit = sketch->capacity
+			- TotalCapacity(sketch->k, sketch->num_levels);
+}
+
+/**
+ * @brief Promotes half of items at @a level to the next level.
+ *
+ * If the level has an odd number of items, its smallest item stays.
+ */
+void CompactLevel(size_t level, Sketch *sketch) {
+	if (level + 1 == sketch->num_levels) {
+		AddLevel(sketch);
+	}
+	float *items = sketch->items;
+	size_t *level_begin = sketch->level_begin;
+	size_t const begin = level_begin[level];
+	size_t const end = level_begin[level + 1];
+	if (level == 0) {
+		RadixSort(end - begin, &items[begin], sketch->work);
+	}
+	size_t const first = begin + (end - begin) % 2;
+	size_t const num_promoted = (end - first) / 2;
+	size_t const offset = NextRandomBit(sketch);
+	float *work = sketch->work;
+	for (size_t i = 0; i < num_promoted; ++i) {
+		work[i] = items[first + offset + 2 * i];
+	}
+
+	// merge promoted items into the next level from the front.
+	// Writes never pass over unread items of the next level.
+	size_t const upper_end = level_begin[level + 2];
+	size_t upper = end;
+	size_t out = end - num_promoted;
+	level_begin[level + 1] = out;
+	size_t promoted = 0;
+	while (promoted < num_promoted) {
+		if (upper < upper_end && items[upper] < work[promoted]) {
+			items[out++] = items[upper++];
+		} else {
+			items[out++] = work[promoted++];
+		}
+	}
+
+	// close the gap left by discarded items
+	std::copy_backward(&items[level_begin[0]], &items[first],
+			&items[level_begin[level + 1]]);
+	for (size_t i = 0; i <= level; ++i) {
+		level_begin[i] += num_promoted;
+	}
+}
+
+/**
+ * @brief Compacts the lowest level whose size reaches its capacity.
+ *
+ * The sketch must be filled up to the total capacity of levels so that such
+ * a level exists.
+ */
+void Compress(Sketch *sketch) {
+	assert(sketch->level_begin[0] == sketch->level_limit);
+	size_t const num_levels = sketch->num_levels;
+	for (size_t level = 0; level < num_levels; ++level) {
+		size_t const size = sketch->level_begin[level + 1]
+				- sketch->level_begin[level];
+		if (size >= LevelCapacity(sketch->k, num_levels, level)) {
+			CompactLevel(level, sketch);
+			return;
+		}
+	}
+	assert(false);
+}
+
+/**
+ * @brief Inserts items at @a level .
+ *
+ * @param[in] values Items to be inserted. They must be sorted unless @a level
+ * is 0.
+ */
+void InsertItems(size_t level, size_t num_values, float const values[],
+		Sketch *sketch) {
+	while (sketch->num_levels <= level) {
+		AddLevel(sketch);
+	}
+	float *items = sketch->items;
+	size_t *level_begin = sketch->level_begin;
+	size_t done = 0;
+	while (done < num_values) {
+		if (level_begin[0] == sketch->level_limit) {
+			Compress(sketch);
+			continue;
+		}
+		size_t const num_inserted = std::min(
+				level_begin[0] - sketch->level_limit, num_values - done);
+		float const *inserted = &values[done];
+
+		// make room in front of the level
+		size_t const begin = level_begin[level];
+		size_t const end = level_begin[level + 1];
+		std::copy(&items[level_begin[0]], &items[begin],
+				&items[level_begin[0] - num_inserted]);
+		for (size_t i = 0; i <= level; ++i) {
+			level_begin[i] -= num_inserted;
+		}
+		if (level == 0) {
+			std::copy(inserted, &inserted[num_inserted], &items[begin - num_inserted]);
+		} else {
+			// merge from the front. Writes never pass over unread items.
+			size_t out = begin - num_inserted;
+			size_t current = begin;
+			size_t j = 0;
+			while (j < num_inserted) {
+				if (current < end && items[current] < inserted[j]) {
+					items[out++] = items[current++];
+				} else {
+					items[out++] = inserted[j++];
+				}
+			}
+		}
+		done += num_inserted;
+	}
+}
+
+void InitializeSketch(size_t k, Sketch *sketch) {
+	sketch->k = k;
+	sketch->num_levels = 1;
+	sketch->level_begin[0] = sketch->capacity;
+	sketch->level_begin[1] = sketch->capacity;
+	sketch->level_limit = sketch->capacity - TotalCapacity(k, 1);
+	sketch->num_data = 0;
+	sketch->min = NAN;
+	sketch->max = NAN;
+	sketch->random_state = UINT64_C(0x9E3779B97F4A7C15);
+}
+
+void DestroyQuantileSketch(Sketch *sketch) {
+	if (sketch != nullptr) {
+		if (sketch->storage != nullptr) {
+			LIBSAKURA_PREFIX::Memory::Free(sketch->storage);
+		}
+		LIBSAKURA_PREFIX::Memory::Free(sketch);
+	}
+}
+
+void CreateQuantileSketch(size_t k, Sketch **sketch) {
+	std::unique_ptr<Sketch, decltype(&DestroyQuantileSketch)> work_sketch(
+			static_cast<Sketch *>(LIBSAKURA_PREFIX::Memory::Allocate(
+					sizeof(Sketch))), DestroyQuantileSketch);
+	if (work_sketch == nullptr) {
+		throw std::bad_alloc();
+	}
+	work_sketch->storage = nullptr;
+	size_t const capacity = TotalCapacity(k, kMaxNumLevels);
+	float *storage = nullptr;
+	work_sketch->storage = LIBSAKURA_PREFIX::Memory::AlignedAllocateOrException(
+			sizeof(float) * 2 * capacity, &storage);
+	work_sketch->capacity = capacity;
+	work_sketch->items = storage;
+	work_sketch->work = &storage[capacity];
+	InitializeSketch(k, work_sketch.get());
+	*sketch = work_sketch.release();
+}
+
+/**
+ * @brief A retained item and its weight.
+ */
+struct WeightedItem {
+	float value;
+	size_t weight;
+};
+
+/**
+ * @brief Returns the value whose rank is @a rank among data given to a sketch.
+ *
+ * @param[in] num_items The number of retained items.
+ * @param[in] items Retained items sorted in ascending order, whose weights
+ * are replaced by the accumulated weights of items before them.
+ */
+float ValueAtRank(size_t rank, Sketch const &sketch, size_t num_items,
+		WeightedItem const items[]) {
+	if (rank == 0) {
+		return sketch.min;
+	}
+	if (rank + 1 >= sketch.num_data) {
+		return sketch.max;
+	}
+	// the last item whose accumulated weight does not exceed rank
+	auto position = std::upper_bound(items, &items[num_items], rank,
+			[](size_t the_rank, WeightedItem const &item) {
+				return the_rank < item.weight;
+			});
+	assert(position != items);
+	return (position - 1)->value;
+}
+
+void QueryQuantileSketch(Sketch const &sketch, size_t num_probabilities,
+		double const probability[], float quantile[]) {
+	size_t const num_items = NumRetained(sketch);
+	WeightedItem *items = nullptr;
+	std::unique_ptr<void, LIBSAKURA_PREFIX::Memory> storage(
+			LIBSAKURA_PREFIX::Memory::AlignedAllocateOrException(
+					sizeof(WeightedItem) * num_items, &items));
+	for (size_t level = 0; level < sketch.num_levels; ++level) {
+		for (size_t i = sketch.level_begin[level];
+				i < sketch.level_begin[level + 1]; ++i) {
+			WeightedItem const item = { sketch.items[i], size_t(1) << level };
+			items[i - sketch.level_begin[0]] = item;
+		}
+	}
+	std::sort(items, &items[num_items],
+			[](WeightedItem const &a, WeightedItem const &b) {
+				return a.value < b.value;
+			});
+	// replace weights by the accumulated weights of items before them
+	size_t accumulated = 0;
+	for (size_t i = 0; i < num_items; ++i) {
+		auto const weight = items[i].weight;
+		items[i].weight = accumulated;
+		accumulated += weight;
+	}
+	assert(accumulated == sketch.num_data);
+
+	for (size_t i = 0; i < num_probabilities; ++i) {
+		double const position = probability[i] * (sketch.num_data - 1);
+		size_t const rank = static_cast<size_t>(position);
+		auto const lower = ValueAtRank(rank, sketch, num_items, items);
+		double const fraction = position - rank;
+		if (fraction > 0.) {
+			auto const upper = ValueAtRank(rank + 1, sketch, num_items,
+					items);
+			quantile[i] = static_cast<float>(lower
+					+ fraction * (static_cast<double>(upper) - lower));
+		} else {
+			quantile[i] = lower;
+		}
+	}
+}
+
+/**
+ * @brief Validates a serialized sketch and returns the number of items in it.
+ *
+ * @return false if the serialized sketch is broken.
+ */
+bool ValidateSerializedSketch(size_t size, char const *buffer,
+		SerializedHeader *header, size_t *num_items) {
+	if (size < sizeof(SerializedHeader)) {
+		return false;
+	}
+	std::memcpy(header, buffer, sizeof(SerializedHeader));
+	if (header->magic != kSerializedMagic
+			|| header->version != kSerializedVersion || header->k < kMinK
+			|| kMaxK < header->k || header->num_levels < 1
+			|| kMaxNumLevels < header->num_levels) {
+		return false;
+	}
+	size_t const num_levels = header->num_levels;
+	if (size < sizeof(SerializedHeader) + sizeof(uint64_t) * num_levels) {
+		return false;
+	}
+	size_t total_size = 0;
+	size_t total_weight = 0;
+	for (size_t level = 0; level < num_levels; ++level) {
+		uint64_t level_size;
+		std::memcpy(&level_size,
+				&buffer[sizeof(SerializedHeader) + sizeof(uint64_t) * level],
+				sizeof(level_size));
+		if (level_size > (SIZE_MAX - total_weight) >> level) {
+			return false;
+		}
+		total_size += level_size;
+		total_weight += static_cast<size_t>(level_size) << level;
+	}
+	if (total_size > TotalCapacity(header->k, num_levels)
+			|| total_weight != header->num_data
+			|| size
+					!= sizeof(SerializedHeader) + sizeof(uint64_t) * num_levels
+							+ sizeof(float) * total_size) {
+		return false;
+	}
+	if (header->num_data > 0
+			&& !(std::isfinite(header->min) && std::isfinite(header->max)
+					&& header->min <= header->max)) {
+		return false;
+	}
+	if (header->random_state == 0) {
+		return false;
+	}
+	char const *items = &buffer[sizeof(SerializedHeader)
+			+ sizeof(uint64_t) * num_levels];
+	for (size_t i = 0; i < total_size; ++i) {
+		float item;
+		std::memcpy(&item, &items[sizeof(float) * i], sizeof(item));
+		if (!(header->min <= item && item <= header->max)) {
+			return false;
+		}
+	}
+	// levels other than level 0 must be sorted
+	size_t level_begin = 0;
+	for (size_t level = 0; level < num_levels; ++level) {
+		uint64_t level_size;
+		std::memcpy(&level_size,
+				&buffer[sizeof(SerializedHeader) + sizeof(uint64_t) * level],
+				sizeof(level_size));
+		size_t const level_end = level_begin + level_size;
+		for (size_t i = level_begin + 1; level > 0 && i < level_end; ++i) {
+			float previous;
+			float item;
+			std::memcpy(&previous, &items[sizeof(float) * (i - 1)],
+					sizeof(previous));
+			std::memcpy(&item, &items[sizeof(float) * i], sizeof(item));
+			if (item < previous) {
+				return false;
+			}
+		}
+		level_begin = level_end;
+	}
+	*num_items = total_size;
+	return true;
+}
+
+} /* anonymous namespace */
+
+#define CHECK_ARGS(x) do { \
+	if (!(x)) { \
+		return LIBSAKURA_SYMBOL(Status_kInvalidArgument); \
+	} \
+} while (false)
+
+extern "C" LIBSAKURA_SYMBOL(Status) LIBSAKURA_SYMBOL(CreateQuantileSketchFloat)(
+		size_t k, LIBSAKURA_SYMBOL(QuantileSketchFloat) **sketch) noexcept {
+	CHECK_ARGS(sketch != nullptr);
+	*sketch = nullptr;
+	CHECK_ARGS(kMinK <= k && k <= kMaxK);
+
+	try {
+		CreateQuantileSketch(k, sketch);
+	} catch (const std::bad_alloc &e) {
+		LOG4CXX_ERROR(logger, "Memory allocation failed");
+		return LIBSAKURA_SYMBOL(Status_kNoMemory);
+	} catch (...) {
+		assert(false);
+		return LIBSAKURA_SYMBOL(Status_kUnknownError);
+	}
+	return LIBSAKURA_SYMBOL(Status_kOK);
+}
+
+extern "C" LIBSAKURA_SYMBOL(Status) LIBSAKURA_SYMBOL(UpdateQuantileSketchFloat)(
+		LIBSAKURA_SYMBOL(QuantileSketchFloat) *sketch, size_t num_data,
+		float const data[], bool const is_valid[]) noexcept {
+	LIBSAKURA_PROFILE_KERNEL(UpdateQuantileSketchFloat,
+			num_data * (sizeof(float) + sizeof(bool)));
+	CHECK_ARGS(sketch != nullptr);
+	CHECK_ARGS(num_data == 0 || data != nullptr);
+	CHECK_ARGS(num_data == 0 || is_valid != nullptr);
+
+	float *items = sketch->items;
+	size_t front = sketch->level_begin[0];
+	size_t count = 0;
+	float min = sketch->min;
+	float max = sketch->max;
+	if (sketch->num_data == 0) {
+		min = INFINITY;
+		max = -INFINITY;
+	}
+	for (size_t i = 0; i < num_data; ++i) {
+		if (is_valid[i]) {
+			auto const value = data[i];
+			assert(std::isfinite(value));
+			if (front == sketch->level_limit) {
+				sketch->level_begin[0] = front;
+				Compress(sketch);
+				front = sketch->level_begin[0];
+			}
+			items[--front] = value;
+			min = std::min(min, value);
+			max = std::max(max, value);
+			++count;
+		}
+	}
+	sketch->level_begin[0] = front;
+	if (count > 0) {
+		sketch->num_data += count;
+		sketch->min = min;
+		sketch->max = max;
+	}
+	return LIBSAKURA_SYMBOL(Status_kOK);
+}
+
+extern "C" LIBSAKURA_SYMBOL(Status) LIBSAKURA_SYMBOL(MergeQuantileSketchFloat)(
+		LIBSAKURA_SYMBOL(QuantileSketchFloat) const *increment,
+		LIBSAKURA_SYMBOL(QuantileSketchFloat) *sketch) noexcept {
+	CHECK_ARGS(increment != nullptr);
+	CHECK_ARGS(sketch != nullptr);
+	CHECK_ARGS(increment != sketch);
+	CHECK_ARGS(increment->k == sketch->k);
+
+	if (increment->num_data == 0) {
+		return LIBSAKURA_SYMBOL(Status_kOK);
+	}
+	for (size_t level = 0; level < increment->num_levels; ++level) {
+		size_t const begin = increment->level_begin[level];
+		size_t const end = increment->level_begin[level + 1];
+		if (begin < end) {
+			InsertItems(level, end - begin, &increment->items[begin], sketch);
+		}
+	}
+	if (sketch->num_data == 0) {
+		sketch->min = increment->min;
+		sketch->max = increment->max;
+	} else {
+		sketch->min = std::min(sketch->min, increment->min);
+		sketch->max = std::max(sketch->max, increment->max);
+	}
+	sketch->num_data += increment->num_data;
+	return LIBSAKURA_SYMBOL(Status_kOK);
+}
+
+extern "C" LIBSAKURA_SYMBOL(Status) LIBSAKURA_SYMBOL(QueryQuantileSketchFloat)(
+		LIBSAKURA_SYMBOL(QuantileSketchFloat) const *sketch,
+		size_t num_probabilities, double const probability[], float quantile[],
+		size_t *num_data) noexcept {
+	CHECK_ARGS(sketch != nullptr);
+	CHECK_ARGS(num_probabilities == 0 || probability != nullptr);
+	CHECK_ARGS(num_probabilities == 0 || quantile != nullptr);
+	CHECK_ARGS(num_data != nullptr);
+	for (size_t i = 0; i < num_probabilities; ++i) {
+		CHECK_ARGS(0. <= probability[i] && probability[i] <= 1.);
+	}
+
+	*num_data = sketch->num_data;
+	if (sketch->num_data == 0) {
+		std::fill(quantile, quantile + num_probabilities, NAN);
+		return LIBSAKURA_SYMBOL(Status_kOK);
+	}
+	try {
+		QueryQuantileSketch(*sketch, num_probabilities, probability, quantile);
+	} catch (const std::bad_alloc &e) {
+		LOG4CXX_ERROR(logger, "Memory allocation failed");
+		return LIBSAKURA_SYMBOL(Status_kNoMemory);
+	} catch (...) {
+		assert(false);
+		return LIBSAKURA_SYMBOL(Status_kUnknownError);
+	}
+	return LIBSAKURA_SYMBOL(Status_kOK);
+}
+
+extern "C" LIBSAKURA_SYMBOL(Status) LIBSAKURA_SYMBOL(GetQuantileSketchSerializedSizeFloat)(
+		LIBSAKURA_SYMBOL(QuantileSketchFloat) const *sketch, size_t *size) noexcept {
+	CHECK_ARGS(sketch != nullptr);
+	CHECK_ARGS(size != nullptr);
+
+	*size = sizeof(SerializedHeader) + sizeof(uint64_t) * sketch->num_levels
+			+ sizeof(float) * NumRetained(*sketch);
+	return LIBSAKURA_SYMBOL(Status_kOK);
+}
+
+extern "C" LIBSAKURA_SYMBOL(Status) LIBSAKURA_SYMBOL(SerializeQuantileSketchFloat)(
+		LIBSAKURA_SYMBOL(QuantileSketchFloat) const *sketch, size_t size,
+		void *buffer) noexcept {
+	CHECK_ARGS(sketch != nullptr);
+	CHECK_ARGS(buffer != nullptr);
+	size_t serialized_size = 0;
+	LIBSAKURA_SYMBOL(Status) status =
+			LIBSAKURA_SYMBOL(GetQuantileSketchSerializedSizeFloat)(sketch,
+					&serialized_size);
+	assert(status == LIBSAKURA_SYMBOL(Status_kOK));
+	CHECK_ARGS(size == serialized_size);
+
+	SerializedHeader const header = { kSerializedMagic, kSerializedVersion,
+			sketch->k, sketch->num_levels, sketch->num_data, sketch->min,
+			sketch->max, sketch->random_state };
+	char *out = static_cast<char *>(buffer);
+	std::memcpy(out, &header, sizeof(header));
+	out += sizeof(header);
+	for (size_t level = 0; level < sketch->num_levels; ++level) {
+		uint64_t const level_size = sketch->level_begin[level + 1]
+				- sketch->level_begin[level];
+		std::memcpy(out, &level_size, sizeof(level_size));
+		out += sizeof(level_size);
+	}
+	std::memcpy(out, &sketch->items[sketch->level_begin[0]],
+			sizeof(float) * NumRetained(*sketch));
+	return status;
+}
+
+extern "C" LIBSAKURA_SYMBOL(Status) LIBSAKURA_SYMBOL(CreateQuantileSketchFromSerializedFloat)(
+		size_t size, void const *buffer,
+		LIBSAKURA_SYMBOL(QuantileSketchFloat) **sketch) noexcept {
+	CHECK_ARGS(sketch != nullptr);
+	*sketch = nullptr;
+	CHECK_ARGS(buffer != nullptr);
+	char const *in = static_cast<char const *>(buffer);
+	SerializedHeader header;
+	size_t num_items = 0;
+	CHECK_ARGS(ValidateSerializedSketch(size, in, &header, &num_items));
+
+	LIBSAKURA_SYMBOL(Status) status = LIBSAKURA_SYMBOL(CreateQuantileSketchFloat)(
+			header.k, sketch);
+	if (status != LIBSAKURA_SYMBOL(Status_kOK)) {
+		return status;
+	}
+	auto restored = *sketch;
+	while (restored->num_levels < header.num_levels) {
+		AddLevel(restored);
+	}
+	in += sizeof(header);
+	size_t begin = restored->capacity - num_items;
+	for (size_t level = 0; level < header.num_levels; ++level) {
+		uint64_t level_size;
+		std::memcpy(&level_size, in, sizeof(level_size));
+		in += sizeof(level_size);
+		restored->level_begin[level] = begin;
+		begin += level_size;
+	}
+	std::memcpy(&restored->items[restored->level_begin[0]], in,
+			sizeof(float) * num_items);
+	restored->num_data = header.num_data;
+	restored->min = header.min;
+	restored->max = header.max;
+	restored->random_state = header.random_state;
+	return LIBSAKURA_SYMBOL(Status_kOK);
+}
+
+extern "C" LIBSAKURA_SYMBOL(Status) LIBSAKURA_SYMBOL(DestroyQuantileSketchFloat)(
+		LIBSAKURA_SYMBOL(QuantileSketchFloat) *sketch) noexcept {
+	CHECK_ARGS(sketch != nullptr);
+	DestroyQuantileSketch(sketch);
+	return LIBSAKURA_SYMBOL(Status_kOK);
+}
@@ -0,0 +1,630 @@
+/*
+ * @SAKURA_LICENSE_HEADER_START@
+ * Copyright (C) 2013-2022
+ * Inter-University Research Institute Corporation, National Institutes of Natural Sciences
+ * 2-21-1, Osawa, Mitaka, Tokyo, 181-8588, Japan.
+ *
+ * This file is part of Sakura.
+ *
+ * Sakura is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or (at your
+ * option) any later version.
+ *
+ * Sakura is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public
+ * License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Sakura.  If not, see <http://www.gnu.org/licenses/>.
+ * @SAKURA_LICENSE_HEADER_END@
+ */
+#include <algorithm>
+#include <cassert>
+#include <cfloat>
+#include <climits>
+#include <cmath>
+#include <cstdint>
+#include <memory>
+
+#include <libsakura/localdef.h>
+#include <libsakura/logger.h>
+#include <libsakura/sakura.h>
+#include <libsakura/memory_manager.h>
+#include <libsakura/profiler.h>
+
+namespace {
+// a logger for this module
+auto logger = LIBSAKURA_PREFIX::Logger::GetLogger("reduction_pipeline");
+
+/**
+ * @brief The number of channels processed at once by a group of stages.
+ *
+ * Data, mask and working arrays of a block fit in L2 cache.
+ */
+constexpr size_t kBlockSize = 4096;
+
+/**
+ * @brief Stages executed together over blocks of channels.
+ */
+struct StageGroup {
+	/**
+	 * @brief Index of the first stage
+	 */
+	size_t begin;
+	/**
+	 * @brief Index of the stage next to the last one
+	 */
+	size_t end;
+	/**
+	 * @brief Index of the smoothing stage, or @a end if the group has none
+	 */
+	size_t smooth;
+};
+
+inline size_t RoundUp(size_t value, size_t unit) {
+	return (value + unit - 1) / unit * unit;
+}
+
+/**
+ * @brief The number of floats in LIBSAKURA_ALIGNMENT bytes
+ */
+constexpr size_t kNumAlignedFloats = LIBSAKURA_ALIGNMENT / sizeof(float);
+
+} /* anonymous namespace */
+
+extern "C" {
+struct LIBSAKURA_SYMBOL(ReductionPipelineFloat) {
+	size_t num_data;
+	size_t block_size;
+	/**
+	 * @brief Maximum length of kernels of smoothing stages
+	 */
+	size_t halo;
+	size_t num_stages;
+	/**
+	 * @brief Stages whose kernel and scaling factors point copies in @a storage
+	 */
+	LIBSAKURA_SYMBOL(ReductionStageFloat) *stages;
+	size_t num_groups;
+	StageGroup *groups;
+	/**
+	 * @brief Working arrays of ( @a halo + @a block_size + @a halo ) elements
+	 * for smoothing
+	 */
+	float *window_data;
+	bool *window_mask;
+	float *window_output;
+	float *window_weight;
+	/**
+	 * @brief Data and mask of @a halo elements before the block to be smoothed
+	 */
+	float *tail_data;
+	bool *tail_mask;
+	/**
+	 * @brief Working array of @a num_data elements for baseline fitting
+	 */
+	bool *final_mask;
+	void *storage;
+};
+}
+
+namespace {
+
+/**
+ * @brief Arrays given to @ref sakura_ExecuteReductionPipelineFloat .
+ */
+struct ReductionArrays {
+	float const *input_data;
+	uint8_t const *input_flag;
+	bool const *input_mask;
+	float const *reference;
+	float *data;
+	bool *mask;
+	LIBSAKURA_SYMBOL(StatisticsResultFloat) statistics;
+};
+
+inline void MergeStatistics(
+LIBSAKURA_SYMBOL(StatisticsResultFloat) const &block, size_t offset,
+LIBSAKURA_SYMBOL(StatisticsResultFloat) *total) {
+	if (block.count == 0) {
+		return;
+	}
+	if (total->count == 0) {
+		*total = block;
+		total->index_of_min += offset;
+		total->index_of_max += offset;
+		return;
+	}
+	total->count += block.count;
+	total->sum += block.sum;
+	total->square_sum += block.square_sum;
+	if (block.min < total->min) {
+		total->min = block.min;
+		total->index_of_min = block.index_of_min + offset;
+	}
+	if (block.max > total->max) {
+		total->max = block.max;
+		total->index_of_max = block.index_of_max + offset;
+	}
+}
+
+/**
+ * @brief Copy input data and mask of [ @a begin , @a end ) to output arrays.
+ */
+inline void LoadBlock(size_t begin, size_t end, ReductionArrays *arrays) {
+	if (arrays->input_data != arrays->data) {
+		std::copy(&arrays->input_data[begin], &arrays->input_data[end],
+				&arrays->data[begin]);
+	}
+	if (arrays->input_mask == nullptr) {
+		std::fill(&arrays->mask[begin], &arrays->mask[end], true);
+	} else if (arrays->input_mask != arrays->mask) {
+		std::copy(&arrays->input_mask[begin], &arrays->input_mask[end],
+				&arrays->mask[begin]);
+	}
+}
+
+/**
+ * @brief Apply an element-wise or reduction stage to [ @a begin , @a end ).
+ */
+inline void ApplyStage(LIBSAKURA_SYMBOL(ReductionStageFloat) const &stage,
+		size_t begin, size_t end, ReductionArrays *arrays) {
+	float *data = arrays->data;
+	bool *mask = arrays->mask;
+	switch (stage.type) {
+	case LIBSAKURA_SYMBOL(ReductionStageType_kFlagToMask): {
+		uint8_t const *flag = arrays->input_flag;
+		for (size_t i = begin; i < end; ++i) {
+			mask[i] = flag[i] == 0;
+		}
+		break;
+	}
+	case LIBSAKURA_SYMBOL(ReductionStageType_kMaskNanOrInf): {
+		// compared as uint8_t so that the loop is vectorized.
+		// The comparison is false for NaN as well as Inf.
+		auto mask_as_uint8 = reinterpret_cast<uint8_t *>(mask);
+		for (size_t i = begin; i < end; ++i) {
+			uint8_t const is_finite = std::abs(data[i]) <= FLT_MAX;
+			mask_as_uint8[i] &= is_finite;
+		}
+		break;
+	}
+	case LIBSAKURA_SYMBOL(ReductionStageType_kCalibrate): {
+		float const *reference = arrays->reference;
+		float const *factor = stage.scaling_factor;
+		if (stage.num_scaling_factor == 1) {
+			float const the_factor = factor[0];
+			for (size_t i = begin; i < end; ++i) {
+				data[i] = the_factor * (data[i] - reference[i]) / reference[i];
+			}
+		} else {
+			for (size_t i = begin; i < end; ++i) {
+				data[i] = factor[i] * (data[i] - reference[i]) / reference[i];
+			}
+		}
+		break;
+	}
+	case LIBSAKURA_SYMBOL(ReductionStageType_kStatistics): {
+		LIBSAKURA_SYMBOL(StatisticsResultFloat) block;
+		LIBSAKURA_SYMBOL(Status) status = LIBSAKURA_SYMBOL(
+				ComputeStatisticsFloat)(end - begin, &data[begin], &mask[begin],
+				&block);
+		assert(status == LIBSAKURA_SYMBOL(Status_kOK));
+		(void) status;
+		MergeStatistics(block, begin, &arrays->statistics);
+		break;
+	}
+	default:
+		assert(false);
+	}
+}
+
+inline void ApplyStages(
+LIBSAKURA_SYMBOL(ReductionPipelineFloat) const &pipeline, size_t first_stage,
+		size_t last_stage, bool load, size_t begin, size_t end,
+		ReductionArrays *arrays) {
+	if (load) {
+		LoadBlock(begin, end, arrays);
+	}
+	for (size_t i = first_stage; i < last_stage; ++i) {
+		ApplyStage(pipeline.stages[i], begin, end, arrays);
+	}
+}
+
+/**
+ * @brief Smooth [ @a begin , @a end ).
+ *
+ * Data and mask of [ @a begin - halo , @a end + halo ) are copied to the
+ * window. Those before @a begin are taken from the tail saved when the previous
+ * block was smoothed, since they have been already overwritten.
+ */
+void SmoothBlock(LIBSAKURA_SYMBOL(ReductionPipelineFloat) const &pipeline,
+LIBSAKURA_SYMBOL(ReductionStageFloat) const &stage, size_t begin, size_t end,
+		ReductionArrays *arrays) {
+	size_t const halo = pipeline.halo;
+	size_t const window_begin = begin >= halo ? begin - halo : 0;
+	size_t const window_end = std::min(pipeline.num_data, end + halo);
+	size_t const num_left = begin - window_begin;
+	size_t const num_window = window_end - window_begin;
+	std::copy(&pipeline.tail_data[halo - num_left], &pipeline.tail_data[halo],
+			pipeline.window_data);
+	std::copy(&pipeline.tail_mask[halo - num_left], &pipeline.tail_mask[halo],
+			pipeline.window_mask);
+	std::copy(&arrays->data[begin], &arrays->data[window_end],
+			&pipeline.window_data[num_left]);
+	std::copy(&arrays->mask[begin], &arrays->mask[window_end],
+			&pipeline.window_mask[num_left]);
+	LIBSAKURA_SYMBOL(Status) status = LIBSAKURA_SYMBOL(Convolve1DFloat)(
+			stage.num_kernel, stage.kernel, num_window, pipeline.window_data,
+			pipeline.window_mask, pipeline.window_output,
+			pipeline.window_weight);
+	if (status == LIBSAKURA_SYMBOL(Status_kNoMemory)) {
+		throw std::bad_alloc();
+	}
+	assert(status == LIBSAKURA_SYMBOL(Status_kOK));
+	// save data before smoothing for the next block
+	size_t const num_tail = std::min(halo, end - window_begin);
+	std::copy(&pipeline.window_data[end - window_begin - num_tail],
+			&pipeline.window_data[end - window_begin],
+			&pipeline.tail_data[halo - num_tail]);
+	std::copy(&pipeline.window_mask[end - window_begin - num_tail],
+			&pipeline.window_mask[end - window_begin],
+			&pipeline.tail_mask[halo - num_tail]);
+	std::copy(&pipeline.window_output[num_left],
+			&pipeline.window_output[num_left + (end - begin)],
+			&arrays->data[begin]);
+}
+
+/**
+ * @brief Execute a group of stages over blocks.
+ *
+ * If the group has a smoothing stage, the stages before it are executed one
+ * block ahead since smoothing of a block needs data of the next block.
+ */
+void ExecuteGroup(LIBSAKURA_SYMBOL(ReductionPipelineFloat) const &pipeline,
+		StageGroup const &group, bool load, ReductionArrays *arrays) {
+	size_t const num_data = pipeline.num_data;
+	size_t const block_size = pipeline.block_size;
+	if (group.smooth == group.end) {
+		for (size_t begin = 0; begin < num_data; begin += block_size) {
+			size_t const end = std::min(begin + block_size, num_data);
+			ApplyStages(pipeline, group.begin, group.end, load, begin, end,
+					arrays);
+		}
+		return;
+	}
+	size_t prefix_end = 0;
+	for (size_t begin = 0; begin < num_data; begin += block_size) {
+		size_t const end = std::min(begin + block_size, num_data);
+		size_t const required = std::min(end + pipeline.halo, num_data);
+		while (prefix_end < required) {
+			size_t const next = std::min(prefix_end + block_size, num_data);
+			ApplyStages(pipeline, group.begin, group.smooth, load, prefix_end,
+					next, arrays);
+			prefix_end = next;
+		}
+		SmoothBlock(pipeline, pipeline.stages[group.smooth], begin, end,
+				arrays);
+		ApplyStages(pipeline, group.smooth + 1, group.end, false, begin, end,
+				arrays);
+	}
+}
+
+LIBSAKURA_SYMBOL(Status) SubtractBaseline(
+LIBSAKURA_SYMBOL(ReductionPipelineFloat) const &pipeline,
+LIBSAKURA_SYMBOL(ReductionStageFloat) const &stage, ReductionArrays *arrays,
+LIBSAKURA_SYMBOL(LSQFitStatus) *lsqfit_status) {
+	float rms = 0.f;
+	// the number of coefficients is used for fitting even if they are not
+	// returned
+	size_t const num_coeff = stage.order + 1;
+	return LIBSAKURA_SYMBOL(LSQFitPolynomialFloat)(stage.lsqfit_context,
+			stage.order, pipeline.num_data, arrays->data, arrays->mask,
+			stage.clip_threshold_sigma, stage.num_fitting_max, num_coeff, nullptr,
+			nullptr, arrays->data, pipeline.final_mask, &rms, lsqfit_status);
+}
+
+void DestroyReductionPipeline(
+LIBSAKURA_SYMBOL(ReductionPipelineFloat) *pipeline) {
+	if (pipeline != nullptr) {
+		if (pipeline->storage != nullptr) {
+			LIBSAKURA_PREFIX::Memory::Free(pipeline->storage);
+		}
+		LIBSAKURA_PREFIX::Memory::Free(pipeline);
+	}
+}
+
+void CreateReductionPipeline(size_t num_stages,
+LIBSAKURA_SYMBOL(ReductionStageFloat) const stages[], size_t num_data,
+LIBSAKURA_SYMBOL(ReductionPipelineFloat) **pipeline) {
+	size_t halo = 0;
+	size_t num_copied = 0;
+	bool has_baseline = false;
+	for (size_t i = 0; i < num_stages; ++i) {
+		switch (stages[i].type) {
+		case LIBSAKURA_SYMBOL(ReductionStageType_kCalibrate):
+			num_copied += RoundUp(stages[i].num_scaling_factor,
+					kNumAlignedFloats);
+			break;
+		case LIBSAKURA_SYMBOL(ReductionStageType_kSmooth):
+			num_copied += RoundUp(stages[i].num_kernel, kNumAlignedFloats);
+			halo = std::max(halo, stages[i].num_kernel);
+			break;
+		case LIBSAKURA_SYMBOL(ReductionStageType_kSubtractBaseline):
+			has_baseline = true;
+			break;
+		default:
+			break;
+		}
+	}
+	size_t const block_size = std::max(kBlockSize, RoundUp(halo, kBlockSize));
+	size_t const num_window = halo > 0 ? halo + block_size + halo : 0;
+
+	// layout of the storage
+	size_t const stages_offset = 0;
+	size_t const groups_offset = stages_offset
+			+ RoundUp(sizeof(stages[0]) * num_stages, LIBSAKURA_ALIGNMENT);
+	size_t const copied_offset = groups_offset
+			+ RoundUp(sizeof(StageGroup) * num_stages, LIBSAKURA_ALIGNMENT);
+	size_t const window_data_offset = copied_offset + sizeof(float) * num_copied;
+	size_t const window_output_offset = window_data_offset
+			+ RoundUp(sizeof(float) * num_window, LIBSAKURA_ALIGNMENT);
+	size_t const window_weight_offset = window_output_offset
+			+ RoundUp(sizeof(float) * num_window, LIBSAKURA_ALIGNMENT);
+	size_t const tail_data_offset = window_weight_offset
+			+ RoundUp(sizeof(float) * num_window, LIBSAKURA_ALIGNMENT);
+	size_t const window_mask_offset = tail_data_offset
+			+ RoundUp(sizeof(float) * halo, LIBSAKURA_ALIGNMENT);
+	size_t const tail_mask_offset = window_mask_offset
+			+ RoundUp(sizeof(bool) * num_window, LIBSAKURA_ALIGNMENT);
+	size_t const final_mask_offset = tail_mask_offset
+			+ RoundUp(sizeof(bool) * halo, LIBSAKURA_ALIGNMENT);
+	size_t const storage_size = final_mask_offset
+			+ (has_baseline ? sizeof(bool) * num_data : 0);
+
+	std::unique_ptr<LIBSAKURA_SYMBOL(ReductionPipelineFloat),
+			decltype(&DestroyReductionPipeline)> work_pipeline(
+			static_cast<LIBSAKURA_SYMBOL(ReductionPipelineFloat) *>(LIBSAKURA_PREFIX::Memory::Allocate(
+					sizeof(LIBSAKURA_SYMBOL(ReductionPipelineFloat)))),
+			DestroyReductionPipeline);
+	if (work_pipeline == nullptr) {
+		throw std::bad_alloc();
+	}
+	work_pipeline->storage = nullptr;
+	char *storage = nullptr;
+	work_pipeline->storage =
+			LIBSAKURA_PREFIX::Memory::AlignedAllocateOrException(
+					storage_size, &storage);
+
+	auto pipeline_ptr = work_pipeline.get();
+	pipeline_ptr->num_data = num_data;
+	pipeline_ptr->block_size = block_size;
+	pipeline_ptr->halo = halo;
+	pipeline_ptr->num_stages = num_stages;
+	pipeline_ptr->stages =
+			reinterpret_cast<LIBSAKURA_SYMBOL(ReductionStageFloat) *>(&storage[stages_offset]);
+	pipeline_ptr->groups =
+			reinterpret_cast<StageGroup *>(&storage[groups_offset]);
+	pipeline_ptr->window_data =
+			reinterpret_cast<float *>(&storage[window_data_offset]);
+	pipeline_ptr->window_output =
+			reinterpret_cast<float *>(&storage[window_output_offset]);
+	pipeline_ptr->window_weight =
+			reinterpret_cast<float *>(&storage[window_weight_offset]);
+	pipeline_ptr->tail_data =
+			reinterpret_cast<float *>(&storage[tail_data_offset]);
+	pipeline_ptr->window_mask =
+			reinterpret_cast<bool *>(&storage[window_mask_offset]);
+	pipeline_ptr->tail_mask =
+			reinterpret_cast<bool *>(&storage[tail_mask_offset]);
+	pipeline_ptr->final_mask =
+			has_baseline ?
+					reinterpret_cast<bool *>(&storage[final_mask_offset]) :
+					nullptr;
+
+	// copy stages with their arrays
+	float *copied = reinterpret_cast<float *>(&storage[copied_offset]);
+	for (size_t i = 0; i < num_stages; ++i) {
+		auto &stage = pipeline_ptr->stages[i];
+		stage = stages[i];
+		if (stage.type == LIBSAKURA_SYMBOL(ReductionStageType_kCalibrate)) {
+			std::copy(stages[i].scaling_factor,
+					stages[i].scaling_factor + stage.num_scaling_factor,
+					copied);
+			stage.scaling_factor = copied;
+			copied += RoundUp(stage.num_scaling_factor, kNumAlignedFloats);
+		} else if (stage.type == LIBSAKURA_SYMBOL(ReductionStageType_kSmooth)) {
+			std::copy(stages[i].kernel, stages[i].kernel + stage.num_kernel,
+					copied);
+			stage.kernel = copied;
+			copied += RoundUp(stage.num_kernel, kNumAlignedFloats);
+		}
+	}
+
+	// group stages
+	size_t num_groups = 0;
+	StageGroup *groups = pipeline_ptr->groups;
+	StageGroup current = { 0, 0, 0 };
+	bool has_smooth = false;
+	auto close_group = [&](size_t end) {
+		if (current.begin < end) {
+			current.end = end;
+			if (!has_smooth) {
+				current.smooth = end;
+			}
+			groups[num_groups++] = current;
+		}
+		current.begin = end;
+		has_smooth = false;
+	};
+	for (size_t i = 0; i < num_stages; ++i) {
+		auto const type = stages[i].type;
+		if (type == LIBSAKURA_SYMBOL(ReductionStageType_kSubtractBaseline)) {
+			close_group(i);
+			current.smooth = i + 1;
+			close_group(i + 1);
+		} else if (type == LIBSAKURA_SYMBOL(ReductionStageType_kSmooth)) {
+			if (has_smooth) {
+				close_group(i);
+			}
+			current.smooth = i;
+			has_smooth = true;
+		}
+	}
+	close_group(num_stages);
+	pipeline_ptr->num_groups = num_groups;
+
+	*pipeline = work_pipeline.release();
+}
+
+} /* anonymous namespace */
+
+#define CHECK_ARGS(x) do { \
+	if (!(x)) { \
+		return LIBSAKURA_SYMBOL(Status_kInvalidArgument); \
+	} \
+} while (false)
+
+extern "C" LIBSAKURA_SYMBOL(Status) LIBSAKURA_SYMBOL(CreateReductionPipelineFloat)(
+		size_t num_stages,
+		LIBSAKURA_SYMBOL(ReductionStageFloat) const stages[], size_t num_data,
+		LIBSAKURA_SYMBOL(ReductionPipelineFloat) **pipeline) noexcept {
+	CHECK_ARGS(pipeline != nullptr);
+	*pipeline = nullptr;
+	CHECK_ARGS(0 < num_stages);
+	CHECK_ARGS(stages != nullptr);
+	CHECK_ARGS(0 < num_data && num_data <= INT_MAX);
+	size_t num_statistics = 0;
+	for (size_t i = 0; i < num_stages; ++i) {
+		auto const &stage = stages[i];
+		switch (stage.type) {
+		case LIBSAKURA_SYMBOL(ReductionStageType_kFlagToMask):
+		case LIBSAKURA_SYMBOL(ReductionStageType_kMaskNanOrInf):
+			break;
+		case LIBSAKURA_SYMBOL(ReductionStageType_kCalibrate):
+			CHECK_ARGS(
+					stage.num_scaling_factor == 1
+							|| stage.num_scaling_factor == num_data);
+			CHECK_ARGS(stage.scaling_factor != nullptr);
+			break;
+		case LIBSAKURA_SYMBOL(ReductionStageType_kSubtractBaseline):
+			CHECK_ARGS(stage.lsqfit_context != nullptr);
+			break;
+		case LIBSAKURA_SYMBOL(ReductionStageType_kSmooth):
+			CHECK_ARGS(0 < stage.num_kernel && stage.num_kernel <= INT_MAX);
+			CHECK_ARGS(stage.kernel != nullptr);
+			break;
+		case LIBSAKURA_SYMBOL(ReductionStageType_kStatistics):
+			++num_statistics;
+			break;
+		default:
+			return LIBSAKURA_SYMBOL(Status_kInvalidArgument);
+		}
+	}
+	CHECK_ARGS(num_statistics <= 1);
+
+	try {
+		CreateReductionPipeline(num_stages, stages, num_data, pipeline);
+	} catch (const std::bad_alloc &e) {
+		LOG4CXX_ERROR(logger, "Memory allocation failed");
+		return LIBSAKURA_SYMBOL(Status_kNoMemory);
+	} catch (...) {
+		assert(false);
+		return LIBSAKURA_SYMBOL(Status_kUnknownError);
+	}
+	return LIBSAKURA_SYMBOL(Status_kOK);
+}
+
+extern "C" LIBSAKURA_SYMBOL(Status) LIBSAKURA_SYMBOL(ExecuteReductionPipelineFloat)(
+		LIBSAKURA_SYMBOL(ReductionPipelineFloat) *pipeline, size_t num_data,
+		float const input_data[], uint8_t const input_flag[],
+		bool const input_mask[], float const reference[], float output_data[],
+		bool output_mask[], LIBSAKURA_SYMBOL(StatisticsResultFloat) *statistics,
+		LIBSAKURA_SYMBOL(LSQFitStatus) *lsqfit_status) noexcept {
+	LIBSAKURA_PROFILE_KERNEL(ExecuteReductionPipelineFloat,
+			num_data * sizeof(float));
+	CHECK_ARGS(pipeline != nullptr);
+	CHECK_ARGS(num_data == pipeline->num_data);
+	CHECK_ARGS(
+			input_data != nullptr && LIBSAKURA_SYMBOL(IsAligned)(input_data));
+	CHECK_ARGS(
+			output_data != nullptr && LIBSAKURA_SYMBOL(IsAligned)(output_data));
+	CHECK_ARGS(
+			output_mask != nullptr && LIBSAKURA_SYMBOL(IsAligned)(output_mask));
+	CHECK_ARGS(input_mask == nullptr || LIBSAKURA_SYMBOL(IsAligned)(input_mask));
+	CHECK_ARGS(input_mask != nullptr
+					|| pipeline->stages[0].type
+							== LIBSAKURA_SYMBOL(ReductionStageType_kFlagToMask));
+	for (size_t i = 0; i < pipeline->num_stages; ++i) {
+		switch (pipeline->stages[i].type) {
+		case LIBSAKURA_SYMBOL(ReductionStageType_kFlagToMask):
+			CHECK_ARGS(
+					input_flag != nullptr
+							&& LIBSAKURA_SYMBOL(IsAligned)(input_flag));
+			break;
+		case LIBSAKURA_SYMBOL(ReductionStageType_kCalibrate):
+			CHECK_ARGS(
+					reference != nullptr
+							&& LIBSAKURA_SYMBOL(IsAligned)(reference));
+			break;
+		case LIBSAKURA_SYMBOL(ReductionStageType_kSubtractBaseline):
+			CHECK_ARGS(lsqfit_status != nullptr);
+			break;
+		case LIBSAKURA_SYMBOL(ReductionStageType_kStatistics):
+			CHECK_ARGS(statistics != nullptr);
+			break;
+		default:
+			break;
+		}
+	}
+
+	try {
+		ReductionArrays arrays = { input_data, input_flag, input_mask,
+				reference, output_data, output_mask, { 0, 0., 0., NAN, NAN, -1,
+						-1 } };
+		if (lsqfit_status != nullptr) {
+			*lsqfit_status = LIBSAKURA_SYMBOL(LSQFitStatus_kOK);
+		}
+		bool load = true;
+		for (size_t i = 0; i < pipeline->num_groups; ++i) {
+			auto const &group = pipeline->groups[i];
+			auto const &first_stage = pipeline->stages[group.begin];
+			if (first_stage.type
+					== LIBSAKURA_SYMBOL(ReductionStageType_kSubtractBaseline)) {
+				if (load) {
+					StageGroup const load_only = { group.begin, group.begin,
+							group.begin };
+					ExecuteGroup(*pipeline, load_only, true, &arrays);
+					load = false;
+				}
+				LIBSAKURA_SYMBOL(Status) status = SubtractBaseline(*pipeline,
+						first_stage, &arrays, lsqfit_status);
+				if (status != LIBSAKURA_SYMBOL(Status_kOK)) {
+					return status;
+				}
+			} else {
+				ExecuteGroup(*pipeline, group, load, &arrays);
+				load = false;
+			}
+		}
+		if (statistics != nullptr) {
+			*statistics = arrays.statistics;
+		}
+	} catch (const std::bad_alloc &e) {
+		LOG4CXX_ERROR(logger, "Memory allocation failed");
+		return LIBSAKURA_SYMBOL(Status_kNoMemory);
+	} catch (...) {
+		assert(false);
+		return LIBSAKURA_SYMBOL(Status_kUnknownError);
+	}
+	return LIBSAKURA_SYMBOL(Status_kOK);
+}
+
+extern "C" LIBSAKURA_SYMBOL(Status) LIBSAKURA_SYMBOL(DestroyReductionPipelineFloat)(
+		LIBSAKURA_SYMBOL(ReductionPipelineFloat) *pipeline) noexcept {
+	CHECK_ARGS(pipeline != nullptr);
+	DestroyReductionPipeline(pipeline);
+	return LIBSAKURA_SYMBOL(Status_kOK);
+}
@@ -25,18 +25,34 @@
 #include <cmath>
 #include <climits>
 #include <algorithm>
+#include <memory>
+#include <numeric>
+#include <thread>
+#include <vector>
 #include <sys/types.h>
 
+#if defined(__AVX2__) && !defined(ARCH_SCALAR)
+#include <immintrin.h>
+#endif
+
 #include "libsakura/sakura.h"
+#include "libsakura/concurrent.h"
 #include "libsakura/localdef.h"
+#include "libsakura/memory_manager.h"
+#include "libsakura/profiler.h"
 
 #define FORCE_EIGEN 0
 
 namespace {
 
+/*
+ * Reduces a (sub)tree of @a levels levels, of which the first leaf starts at @a start .
+ * The whole tree starts at @a offset .
+ */
 template<size_t kUnitSize, size_t kBlockSize, typename Reducer>
 typename Reducer::MiddleLevelAccumulator BlockWiseTraverse(size_t offset,
-		int levels, size_t stride, size_t num_blocks, size_t full_blocks,
+		size_t start, int levels, size_t stride, size_t num_blocks,
+		size_t full_blocks,
 		typename Reducer::MiddleLevelAccumulator const &residual,
 		Reducer *reducer) {
 	//std::cout << "stride = " << stride << std::endl;
@@ -47,7 +63,6 @@ typename Reducer::MiddleLevelAccumulator BlockWiseTraverse(size_t offset,
 	size_t indices_stack[levels + 1];
 	indices_stack[0] = 0;
 	size_t *indices = &indices_stack[1];
-	size_t start = offset;
 
 	int leaf = levels - 1;
 	int level = 0;
@@ -99,6 +114,69 @@ typename Reducer::MiddleLevelAccumulator BlockWiseTraverse(size_t offset,
 	return acc_stack[0][0];
 }
 
+/*
+ * Threads are used only if each of them reduces at least this number of elements.
+ */
+constexpr size_t kMinNumDataPerTraverseThread = 1024 * 1024;
+/*
+ * The tree is divided into at least this number of subtrees per thread
+ * to balance loads.
+ */
+constexpr size_t kNumSubtreesPerTraverseThread = 4;
+
+/*
+ * Same as BlockWiseTraverse for the whole tree, but the subtrees at
+ * a certain depth are reduced by up to @a num_workers threads.
+ * The results of the subtrees are reduced in the same order as
+ * BlockWiseTraverse, so that the result is the same as that of
+ * BlockWiseTraverse regardless of @a num_workers .
+ */
+template<size_t kUnitSize, size_t kBlockSize, typename Reducer>
+typename Reducer::MiddleLevelAccumulator ParallelBlockWiseTraverse(
+		size_t offset, int levels, size_t stride, size_t num_blocks,
+		size_t full_blocks,
+		typename Reducer::MiddleLevelAccumulator const &residual,
+		size_t num_workers, Reducer *reducer) {
+	typedef typename Reducer::MiddleLevelAccumulator Accumulator;
+	int depth = 0;
+	size_t num_subtrees = 1;
+	size_t leaves_per_subtree = 1;
+	for (int i = 1; i < levels; ++i) {
+		leaves_per_subtree *= kUnitSize;
+	}
+	while (depth < levels - 1
+			&& num_subtrees < kNumSubtreesPerTraverseThread * num_workers) {
+		++depth;
+		num_subtrees *= kUnitSize;
+		leaves_per_subtree /= kUnitSize;
+	}
+	num_workers = std::min(num_workers, num_subtrees);
+
+	Accumulator *results = nullptr;
+	std::unique_ptr<void, LIBSAKURA_PREFIX::Memory> storage(
+			LIBSAKURA_PREFIX::Memory::AlignedAllocateOrException(
+					sizeof(Accumulator) * num_subtrees, &results));
+	concurrent::ParallelFor(num_workers, num_subtrees,
+			[&](size_t /*worker*/, size_t i) {
+				results[i] = BlockWiseTraverse<kUnitSize, kBlockSize, Reducer>(
+						offset, offset + i * leaves_per_subtree * kBlockSize,
+						levels - depth, stride, num_blocks, full_blocks, residual,
+						reducer);
+			});
+
+	for (size_t n = num_subtrees; n > 1; n /= kUnitSize) {
+		for (size_t i = 0; i < n / kUnitSize; ++i) {
+			Accumulator accumulator = results[i * kUnitSize];
+			for (size_t j = 1; j < kUnitSize; ++j) {
+				reducer->MiddleLevelReduce(results[i * kUnitSize + j],
+						accumulator);
+			}
+			results[i] = accumulator;
+		}
+	}
+	return results[0];
+}
+
 /**
  * @brief Traverses data in a range [@a offset, @a offset + @a num_data)
  * to reduce them to @a Reducer::TopLevelAccumulator using @a reducer.
@@ -121,11 +199,14 @@ typename Reducer::MiddleLevelAccumulator BlockWiseTraverse(size_t offset,
  * @param offset	@a offset indicates a starting point of the range to be traversed.
  * @param num_data	@a num_data indicates the number of data in the range to be traversed.
  * @param reducer	@a reducer defines how to reduce data in the range.
+ * Its methods may be called concurrently if @a num_threads > 1.
+ * @param num_threads	The maximum number of threads to be used.
+ * The result doesn't depend on @a num_threads .
  * @return a reduced data
  */
 template<size_t kUnitSize, size_t kBlockSize, typename Reducer>
 typename Reducer::TopLevelAccumulator Traverse(size_t offset,
-		size_t const num_data, Reducer *reducer) {
+		size_t const num_data, Reducer *reducer, size_t num_threads = 1) {
 	STATIC_ASSERT(kUnitSize > 1 && kBlockSize > 0);
 	typename Reducer::TopLevelAccumulator top_level_result;
 	top_level_result.Clear();
@@ -154,11 +235,19 @@ typename Reducer::TopLevelAccumulator Traverse(size_t offset,
 
 	if (levels > 0) {
 		stride /= kUnitSize;
+		size_t const num_workers = std::min(num_threads,
+				num_data / kMinNumDataPerTraverseThread);
 		reducer->TopLevelReduce(
 				reducer->TopLevelReduce(
-						BlockWiseTraverse<kUnitSize, kBlockSize, Reducer>(
-								offset, levels, stride, num_blocks, full_blocks,
-								residual, reducer)), top_level_result);
+						num_workers > 1 && levels > 1 ?
+								ParallelBlockWiseTraverse<kUnitSize, kBlockSize,
+										Reducer>(offset, levels, stride,
+										num_blocks, full_blocks, residual,
+										num_workers, reducer) :
+								BlockWiseTraverse<kUnitSize, kBlockSize, Reducer>(
+										offset, offset, levels, stride,
+										num_blocks, full_blocks, residual,
+										reducer)), top_level_result);
 	} else {
 		reducer->TopLevelReduce(reducer->TopLevelReduce(residual),
 				top_level_result);
@@ -335,14 +424,12 @@ struct SIMDWordForInt {
 };
 #endif
 
-inline void StatsBlock(size_t i, __m256 const *data_arg, double const *mask_arg,
-		SIMDWordForInt &count, __m256d &sum, __m256d &square_sum, __m256 &min,
-		__m256 &max, __m256i &index_of_min, __m256i &index_of_max) {
-	auto const data = AssumeAligned(data_arg);
-
-	auto const zero = _mm256_setzero_ps();
-	auto const nan = _mm256_set1_ps(NAN);
-
+/*
+ * Loads validity of 8 elements at @a mask_arg and adds the number of
+ * valid ones to @a count .
+ * Each lane of the returned value has its sign bit set if the element is invalid.
+ */
+inline __m256 LoadInvalidMask(double const *mask_arg, SIMDWordForInt &count) {
 #if defined(__AVX2__)
 	auto const mask = AssumeAligned(mask_arg);
 	auto const zero256i = _mm256_setzero_si256();
@@ -363,7 +450,18 @@ inline void StatsBlock(size_t i, __m256 const *data_arg, double const *mask_arg,
 	auto mask8 = _mm256_insertf128_si256(_mm256_castsi128_si256(mask0),
 			mask1, 1);
 #endif
-	auto maskf = _mm256_cvtepi32_ps(mask8);
+	return _mm256_cvtepi32_ps(mask8);
+}
+
+inline void StatsBlock(size_t i, __m256 const *data_arg, double const *mask_arg,
+		SIMDWordForInt &count, __m256d &sum, __m256d &square_sum, __m256 &min,
+		__m256 &max, __m256i &index_of_min, __m256i &index_of_max) {
+	auto const data = AssumeAligned(data_arg);
+
+	auto const zero = _mm256_setzero_ps();
+	auto const nan = _mm256_set1_ps(NAN);
+
+	auto maskf = LoadInvalidMask(mask_arg, count);
 	/* maskf: 0xffffffff means invalid data, 0 means valid data. */
 
 	auto value = _mm256_blendv_ps(data[0], nan, maskf);
@@ -425,6 +523,95 @@ inline int32_t AddHorizontally128(__m128i packed_values) {
 }
 #endif
 
+/*
+ * Adds the number of valid elements and their sum in @a num_packets packets
+ * of 8 elements to @a count and @a sum .
+ */
+inline void SumPacketsSimd(size_t num_packets, float const data_arg[],
+		bool const is_valid[], size_t *count, double *sum) {
+	auto const data = AssumeAligned(reinterpret_cast<__m256 const *>(data_arg));
+	auto const mask = AssumeAligned(reinterpret_cast<double const *>(is_valid));
+	auto const zero = _mm256_setzero_ps();
+	SIMDWordForInt packed_count;
+	packed_count.Clear();
+	auto sum0 = _mm256_setzero_pd();
+	auto sum1 = _mm256_setzero_pd();
+	for (size_t i = 0; i < num_packets; ++i) {
+		auto const maskf = LoadInvalidMask(&mask[i], packed_count);
+		auto const value = _mm256_blendv_ps(data[i], zero, maskf);
+		sum0 = _mm256_add_pd(sum0,
+				_mm256_cvtps_pd(_mm256_castps256_ps128(value)));
+		sum1 = _mm256_add_pd(sum1,
+				_mm256_cvtps_pd(_mm256_extractf128_ps(value, 1)));
+	}
+	auto const packed_sum = _mm256_add_pd(sum0, sum1);
+#if defined(__AVX2__)
+	*count += static_cast<size_t>(uint32_t(AddHorizontally(
+			packed_count.IntValue())));
+#else
+	*count += static_cast<size_t>(uint32_t(AddHorizontally128(
+			packed_count.IntValue())));
+#endif
+	*sum += AddHorizontally(packed_sum);
+}
+
+/*
+ * Returns the sum of squared differences of valid elements from @a mean
+ * in @a num_packets packets of 8 elements.
+ */
+inline double SumSquaredDiffPacketsSimd(size_t num_packets,
+		float const data_arg[], bool const is_valid[], double mean) {
+	auto const data = AssumeAligned(reinterpret_cast<__m256 const *>(data_arg));
+	auto const mask = AssumeAligned(reinterpret_cast<double const *>(is_valid));
+	auto const zero = _mm256_setzero_pd();
+	auto const packed_mean = _mm256_set1_pd(mean);
+#if defined(__AVX2__)
+	auto const zero256i = _mm256_setzero_si256();
+#else
+	SIMDWordForInt unused_count;
+	unused_count.Clear();
+#endif
+	auto square_sum0 = zero;
+	auto square_sum1 = zero;
+	for (size_t i = 0; i < num_packets; ++i) {
+#if defined(__AVX2__)
+		// each lane is all ones if the element is invalid.
+		auto const mask8 = _mm_loadl_epi64(
+				reinterpret_cast<__m128i const *>(&mask[i]));
+		auto const maskd0 = _mm256_castsi256_pd(
+				_mm256_cmpeq_epi64(_mm256_cvtepu8_epi64(mask8), zero256i));
+		auto const maskd1 = _mm256_castsi256_pd(
+				_mm256_cmpeq_epi64(
+						_mm256_cvtepu8_epi64(_mm_srli_si128(mask8, 4)),
+						zero256i));
+#else
+		auto const maskf = LoadInvalidMask(&mask[i], unused_count);
+		// expands the sign bit of each float lane to a double lane.
+		auto const mask_lo = _mm256_castps256_ps128(maskf);
+		auto const mask_hi = _mm256_extractf128_ps(maskf, 1);
+		auto const maskd0 = _mm256_castps_pd(
+				_mm256_insertf128_ps(
+						_mm256_castps128_ps256(_mm_unpacklo_ps(mask_lo, mask_lo)),
+						_mm_unpackhi_ps(mask_lo, mask_lo), 1));
+		auto const maskd1 = _mm256_castps_pd(
+				_mm256_insertf128_ps(
+						_mm256_castps128_ps256(_mm_unpacklo_ps(mask_hi, mask_hi)),
+						_mm_unpackhi_ps(mask_hi, mask_hi), 1));
+#endif
+		auto diff0 = _mm256_sub_pd(
+				_mm256_cvtps_pd(_mm256_castps256_ps128(data[i])), packed_mean);
+		auto diff1 = _mm256_sub_pd(
+				_mm256_cvtps_pd(_mm256_extractf128_ps(data[i], 1)), packed_mean);
+		diff0 = _mm256_blendv_pd(diff0, zero, maskd0);
+		diff1 = _mm256_blendv_pd(diff1, zero, maskd1);
+		square_sum0 = LIBSAKURA_SYMBOL(FMA)::MultiplyAdd<
+		LIBSAKURA_SYMBOL(SimdPacketAVX), double>(diff0, diff0, square_sum0);
+		square_sum1 = LIBSAKURA_SYMBOL(FMA)::MultiplyAdd<
+		LIBSAKURA_SYMBOL(SimdPacketAVX), double>(diff1, diff1, square_sum1);
+	}
+	return AddHorizontally(_mm256_add_pd(square_sum0, square_sum1));
+}
+
 template<typename Scalar, typename Accumulator>
 struct SIMDStats {
 };
@@ -592,9 +779,24 @@ struct SIMDStats<float, double> {
 	}
 };
 
-void ComputeStatisticsSimdFloat(size_t num_data, float const data[],
-		bool const is_valid[],
-		LIBSAKURA_SYMBOL(StatisticsResultFloat) *result_arg) {
+#if !defined(ARCH_AFTER_SKYLAKE_AVX512)
+/*
+ * Packed accumulators of ComputeStatisticsSimdFloat.
+ */
+struct SimdStatsAccumulator {
+	SIMDWordForInt count;
+	__m256d sum;
+	__m256d square_sum;
+	__m256 min, max;
+	__m256i index_of_min, index_of_max;
+};
+
+/*
+ * Accumulates packets of 8 elements into @a acc .
+ * The elements after the last full packet are left to FinishStatsSimd.
+ */
+inline void AccumulateStatsSimd(size_t num_data, float const data[],
+		bool const is_valid[], SimdStatsAccumulator *acc) {
 	STATIC_ASSERT(sizeof(m256) == sizeof(__m256 ));
 	auto const zero_d = _mm256_setzero_pd();
 	auto sum = zero_d;
@@ -614,21 +816,37 @@ void ComputeStatisticsSimdFloat(size_t num_data, float const data[],
 		StatsBlock(i, &data_ptr[i], &mask_ptr[i], count, sum, square_sum, min, max,
 				index_of_min, index_of_max);
 	}
+	acc->count = count;
+	acc->sum = sum;
+	acc->square_sum = square_sum;
+	acc->min = min;
+	acc->max = max;
+	acc->index_of_min = index_of_min;
+	acc->index_of_max = index_of_max;
+}
+
+inline size_t CountHorizontally(SIMDWordForInt const &count) {
 #if defined(__AVX2__)
-	size_t counted = static_cast<size_t>(uint32_t(AddHorizontally(count.IntValue())));
+	return static_cast<size_t>(uint32_t(AddHorizontally(count.IntValue())));
 #else
-	size_t counted = static_cast<size_t>(uint32_t(AddHorizontally128(count.IntValue())));
+	return static_cast<size_t>(uint32_t(AddHorizontally128(count.IntValue())));
 #endif
+}
 
-	double total = AddHorizontally(sum);
-	double square_total = AddHorizontally(square_sum);
-
-	LIBSAKURA_SYMBOL(StatisticsResultFloat) result;
+/*
+ * Completes @a result , of which count, sum and square_sum already hold
+ * the horizontal sums of @a acc , by reducing min and max of @a acc and
+ * by adding the elements after the last full packet.
+ */
+inline void FinishStatsSimd(size_t num_data, float const data[],
+		bool const is_valid[], SimdStatsAccumulator const &acc,
+		LIBSAKURA_SYMBOL(StatisticsResultFloat) *result_arg) {
+	LIBSAKURA_SYMBOL(StatisticsResultFloat) result = *result_arg;
 	{
 		m256 tmp;
-		tmp.m256 = min;
+		tmp.m256 = acc.min;
 		m256 tmp_index;
-		tmp_index.m256i = index_of_min;
+		tmp_index.m256i = acc.index_of_min;
 
 		float r = tmp.floatv[0];
 		ssize_t result_index =
@@ -650,9 +868,9 @@ void ComputeStatisticsSimdFloat(size_t num_data, float const data[],
 
 	{
 		m256 tmp;
-		tmp.m256 = max;
+		tmp.m256 = acc.max;
 		m256 tmp_index;
-		tmp_index.m256i = index_of_max;
+		tmp_index.m256i = acc.index_of_max;
 
 		float r = tmp.floatv[0];
 		ssize_t result_index =
@@ -678,9 +896,9 @@ void ComputeStatisticsSimdFloat(size_t num_data, float const data[],
 		if (is_valid[i]) {
 			auto const float_data = data[i];
 			double const double_data = float_data;
-			++counted;
-			total += double_data;
-			square_total += double_data * double_data;
+			++result.count;
+			result.sum += double_data;
+			result.square_sum += double_data * double_data;
 			if (!std::isnan(float_data)) {
 				if (std::isnan(result.min) || float_data < result.min) {
 					result.min = float_data;
@@ -693,11 +911,216 @@ void ComputeStatisticsSimdFloat(size_t num_data, float const data[],
 			}
 		}
 	}
+	*result_arg = result;
+}
+
+void ComputeStatisticsSimdFloat(size_t num_data, float const data[],
+		bool const is_valid[],
+		LIBSAKURA_SYMBOL(StatisticsResultFloat) *result_arg) {
+	SimdStatsAccumulator acc;
+	AccumulateStatsSimd(num_data, data, is_valid, &acc);
+	LIBSAKURA_SYMBOL(StatisticsResultFloat) result;
+	result.count = CountHorizontally(acc.count);
+	result.sum = AddHorizontally(acc.sum);
+	result.square_sum = AddHorizontally(acc.square_sum);
+	FinishStatsSimd(num_data, data, is_valid, acc, &result);
+	*result_arg = result;
+}
+
+/*
+ * Adds elements of each of @a a , @a b , @a c and @a d horizontally
+ * in the same order as AddHorizontally(__m256d) and returns the 4 sums.
+ */
+inline __m256d AddHorizontally4(__m256d a, __m256d b, __m256d c, __m256d d) {
+	auto const ab = _mm256_hadd_pd(a, b);
+	auto const cd = _mm256_hadd_pd(c, d);
+	return _mm256_add_pd(_mm256_permute2f128_pd(ab, cd, 0x20),
+			_mm256_permute2f128_pd(ab, cd, 0x31));
+}
+
+/*
+ * Returns counts of 4 accumulators.
+ */
+inline m128 CountHorizontally4(SIMDWordForInt const count[4]) {
+	m128 result;
+#if defined(__AVX2__)
+	auto const packed = _mm256_hadd_epi32(
+			_mm256_hadd_epi32(count[0].IntValue(), count[1].IntValue()),
+			_mm256_hadd_epi32(count[2].IntValue(), count[3].IntValue()));
+	result.m128i = _mm_add_epi32(_mm256_castsi256_si128(packed),
+			_mm256_extractf128_si256(packed, 1));
+#else
+	result.m128i = _mm_hadd_epi32(
+			_mm_hadd_epi32(count[0].IntValue(), count[1].IntValue()),
+			_mm_hadd_epi32(count[2].IntValue(), count[3].IntValue()));
+#endif
+	return result;
+}
+
+/*
+ * Computes statistics of 4 consecutive rows of @a num_data elements.
+ * Horizontal additions of the rows share shuffles, and the results are
+ * the same as those of ComputeStatisticsSimdFloat for each row.
+ */
+void ComputeStatisticsSimdFloat4Rows(size_t num_data, float const data[],
+		bool const is_valid[],
+		LIBSAKURA_SYMBOL(StatisticsResultFloat) result[4]) {
+	constexpr size_t kNumRows = 4;
+	SimdStatsAccumulator acc[kNumRows];
+	SIMDWordForInt count[kNumRows];
+	for (size_t i = 0; i < kNumRows; ++i) {
+		AccumulateStatsSimd(num_data, &data[i * num_data],
+				&is_valid[i * num_data], &acc[i]);
+		count[i] = acc[i].count;
+	}
+	auto const counts = CountHorizontally4(count);
+	m256 sums, square_sums;
+	sums.m256d = AddHorizontally4(acc[0].sum, acc[1].sum, acc[2].sum,
+			acc[3].sum);
+	square_sums.m256d = AddHorizontally4(acc[0].square_sum,
+			acc[1].square_sum, acc[2].square_sum, acc[3].square_sum);
+	for (size_t i = 0; i < kNumRows; ++i) {
+		result[i].count = static_cast<size_t>(uint32_t(counts.intv[i]));
+		result[i].sum = sums.doublev[i];
+		result[i].square_sum = square_sums.doublev[i];
+		FinishStatsSimd(num_data, &data[i * num_data], &is_valid[i * num_data],
+				acc[i], &result[i]);
+	}
+}
+
+#else /* !defined(ARCH_AFTER_SKYLAKE_AVX512) */
+// GCC 12 warns about the undefined upper half left by the casts and
+// extractions in avx512fintrin.h, which is never used.
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wuninitialized"
+#pragma GCC diagnostic ignored "-Wmaybe-uninitialized"
+/*
+ * AVX-512 version of StatsBlock.
+ * Validity of each element is given as a k-mask, so that min/max and
+ * their indices are updated by masked moves and invalid elements are
+ * zeroed by a masked move instead of blending by the mask converted to
+ * float.
+ */
+inline void StatsBlockAvx512(__mmask16 valid, __m512 value, __m512i index,
+		__m512d &sum, __m512d &square_sum, __m512 &min, __m512 &max,
+		__m512i &index_of_min, __m512i &index_of_max) {
+	auto const zero = _mm512_setzero_si512();
+	{
+		// takes the first valid element even if min is NaN
+		__mmask16 take_increment = _mm512_mask_cmp_ps_mask(valid, value, min,
+		_CMP_LT_OQ) | _mm512_mask_cmplt_epi32_mask(valid, index_of_min, zero);
+		min = _mm512_mask_mov_ps(min, take_increment, value);
+		index_of_min = _mm512_mask_mov_epi32(index_of_min, take_increment,
+				index);
+	}
+	{
+		__mmask16 take_increment = _mm512_mask_cmp_ps_mask(valid, value, max,
+		_CMP_GT_OQ) | _mm512_mask_cmplt_epi32_mask(valid, index_of_max, zero);
+		max = _mm512_mask_mov_ps(max, take_increment, value);
+		index_of_max = _mm512_mask_mov_epi32(index_of_max, take_increment,
+				index);
+	}
+
+	value = _mm512_maskz_mov_ps(valid, value);
+	auto v = _mm512_cvtps_pd(_mm512_castps512_ps256(value));
+	sum = _mm512_add_pd(sum, v);
+	square_sum = LIBSAKURA_SYMBOL(FMA)::MultiplyAdd<
+	LIBSAKURA_SYMBOL(SimdPacketAVX512), double>(v, v, square_sum);
+
+	v = _mm512_cvtps_pd(_mm512_extractf32x8_ps(value, 1));
+	sum = _mm512_add_pd(sum, v);
+	square_sum = LIBSAKURA_SYMBOL(FMA)::MultiplyAdd<
+	LIBSAKURA_SYMBOL(SimdPacketAVX512), double>(v, v, square_sum);
+}
+
+/*
+ * Reduces min or max and its index held in each lane into a scalar.
+ * @a index holds the index of the packet and the lane is added.
+ */
+template<typename Compare>
+inline void ReduceLanesAvx512(__m512 packed_value, __m512i packed_index,
+		Compare is_better, float *value_arg, ssize_t *index_arg) {
+	constexpr size_t kNumFloat = LIBSAKURA_SYMBOL(SimdPacketAVX512)::kNumFloat;
+	LIBSAKURA_SYMBOL(SimdPacketAVX512) values, indices;
+	values.raw_float = packed_value;
+	indices.raw_int32 = packed_index;
+	float r = values.v_float.v[0];
+	ssize_t result_index =
+			indices.v_int32.v[0] < 0 ?
+					-1 : static_cast<ssize_t>(indices.v_int32.v[0]) * kNumFloat;
+	for (size_t i = 1; i < kNumFloat; ++i) {
+		if (!std::isnan(values.v_float.v[i])) {
+			assert(indices.v_int32.v[i] >= 0);
+			if (std::isnan(r) || is_better(values.v_float.v[i], r)) {
+				r = values.v_float.v[i];
+				result_index = static_cast<ssize_t>(indices.v_int32.v[i])
+						* kNumFloat + i;
+			}
+		}
+	}
+	*value_arg = r;
+	*index_arg = result_index;
+}
+
+/*
+ * AVX-512 version of ComputeStatisticsSimdFloat.
+ * The remainder of the data is processed by masked loads in the same
+ * way as the other elements instead of a scalar loop.
+ */
+void ComputeStatisticsAvx512Float(size_t num_data, float const data[],
+		bool const is_valid[],
+		LIBSAKURA_SYMBOL(StatisticsResultFloat) *result_arg) {
+	constexpr size_t kNumFloat = LIBSAKURA_SYMBOL(SimdPacketAVX512)::kNumFloat;
+	STATIC_ASSERT(true == 1 && false == 0 && sizeof(bool) == 1);
+	auto const zero_d = _mm512_setzero_pd();
+	auto sum = zero_d;
+	auto square_sum = zero_d;
+	auto const nan = _mm512_set1_ps(NAN);
+	auto min = nan;
+	auto max = nan;
+	auto index_of_min = _mm512_set1_epi32(-1);
+	auto index_of_max = _mm512_set1_epi32(-1);
+	auto const zero = _mm_setzero_si128();
+	size_t counted = 0;
+
+	// LIBSAKURA_ALIGNMENT is smaller than a packet, so loads are unaligned.
+	size_t const num_packets = num_data / kNumFloat;
+	for (size_t i = 0; i < num_packets; ++i) {
+		auto const position = i * kNumFloat;
+		__mmask16 valid = _mm_cmpneq_epi8_mask(
+				_mm_loadu_si128(
+						reinterpret_cast<__m128i const *>(&is_valid[position])),
+				zero);
+		counted += _mm_popcnt_u32(valid);
+		StatsBlockAvx512(valid, _mm512_loadu_ps(&data[position]),
+				_mm512_set1_epi32(i), sum, square_sum, min, max, index_of_min,
+				index_of_max);
+	}
+	size_t const num_extra = num_data - num_packets * kNumFloat;
+	if (num_extra > 0) {
+		auto const position = num_packets * kNumFloat;
+		__mmask16 const in_range = static_cast<__mmask16>((1u << num_extra) - 1);
+		__mmask16 valid = _mm_mask_cmpneq_epi8_mask(in_range,
+				_mm_maskz_loadu_epi8(in_range, &is_valid[position]), zero);
+		counted += _mm_popcnt_u32(valid);
+		StatsBlockAvx512(valid,
+				_mm512_maskz_loadu_ps(in_range, &data[position]),
+				_mm512_set1_epi32(num_packets), sum, square_sum, min, max,
+				index_of_min, index_of_max);
+	}
+
+	LIBSAKURA_SYMBOL(StatisticsResultFloat) result;
 	result.count = counted;
-	result.sum = total;
-	result.square_sum = square_total;
+	result.sum = _mm512_reduce_add_pd(sum);
+	result.square_sum = _mm512_reduce_add_pd(square_sum);
+	ReduceLanesAvx512(min, index_of_min, [](float a, float b) {return a < b;},
+			&result.min, &result.index_of_min);
+	ReduceLanesAvx512(max, index_of_max, [](float a, float b) {return a > b;},
+			&result.max, &result.index_of_max);
 	*result_arg = result;
 }
+#pragma GCC diagnostic pop
+#endif /* !defined(ARCH_AFTER_SKYLAKE_AVX512) */
 
 } /* anonymous namespace */
 
@@ -806,16 +1229,65 @@ void ComputeStatistics<float, LIBSAKURA_SYMBOL(StatisticsResultFloat)>(
 		size_t num_data, float const data[],
 		bool const is_valid[],
 		LIBSAKURA_SYMBOL(StatisticsResultFloat) *result) {
-#if defined(__AVX__) && !defined(ARCH_SCALAR) && (! FORCE_EIGEN)
+#if defined(ARCH_AFTER_SKYLAKE_AVX512) && (! FORCE_EIGEN)
+	ComputeStatisticsAvx512Float(num_data, data, is_valid, result);
+#elif defined(__AVX__) && !defined(ARCH_SCALAR) && (! FORCE_EIGEN)
 	ComputeStatisticsSimdFloat(num_data, data, is_valid, result);
 #else
 	ComputeStatisticsEigen<double, float>(num_data, data, is_valid, result);
 #endif
 }
 
+/*
+ * Rows are distributed to threads by blocks of at least this number of elements.
+ */
+constexpr size_t kNumDataPerStatisticsBatchBlock = 64 * 1024;
+
+/*
+ * Computes statistics of each of @a num_rows consecutive rows
+ * of @a num_data elements.
+ */
+void ComputeStatisticsRows(size_t num_rows, size_t num_data,
+		float const data[], bool const is_valid[],
+		LIBSAKURA_SYMBOL(StatisticsResultFloat) result[]) {
+	size_t row = 0;
+#if !defined(ARCH_AFTER_SKYLAKE_AVX512) && defined(__AVX__) && !defined(ARCH_SCALAR) && (! FORCE_EIGEN)
+	for (; row + 4 <= num_rows; row += 4) {
+		ComputeStatisticsSimdFloat4Rows(num_data, &data[row * num_data],
+				&is_valid[row * num_data], &result[row]);
+	}
+#endif
+	for (; row < num_rows; ++row) {
+		ComputeStatistics(num_data, &data[row * num_data],
+				&is_valid[row * num_data], &result[row]);
+	}
+}
+
+/*
+ * Rows are divided into blocks of a multiple of 4 rows and the blocks are
+ * distributed to @a num_threads threads. As each row is reduced by
+ * a thread, results don't depend on @a num_threads .
+ */
+void ComputeStatisticsBatch(size_t num_rows, size_t num_data,
+		float const data[], bool const is_valid[], size_t num_threads,
+		LIBSAKURA_SYMBOL(StatisticsResultFloat) result[]) {
+	size_t rows_per_block = std::max(static_cast<size_t>(1),
+			kNumDataPerStatisticsBatchBlock / std::max(num_data, size_t(1)));
+	rows_per_block = (rows_per_block + 3) / 4 * 4;
+	size_t const num_blocks = (num_rows + rows_per_block - 1) / rows_per_block;
+	concurrent::ParallelFor(num_threads, num_blocks,
+			[&](size_t /*worker*/, size_t block) {
+				size_t const begin = block * rows_per_block;
+				size_t const end = std::min(num_rows, begin + rows_per_block);
+				ComputeStatisticsRows(end - begin, num_data,
+						&data[begin * num_data], &is_valid[begin * num_data],
+						&result[begin]);
+			});
+}
+
 template<typename T, typename Result>
 void ComputeAccurateStatistics(size_t num_data, T const data[],
-bool const is_valid[], Result *result) {
+bool const is_valid[], Result *result, size_t num_threads = 1) {
 	assert(((void)"Not yet implemented", false));
 }
 
@@ -823,13 +1295,14 @@ template<>
 void ComputeAccurateStatistics<float, LIBSAKURA_SYMBOL(StatisticsResultFloat)>(
 		size_t num_data, float const data[],
 		bool const is_valid[],
-		LIBSAKURA_SYMBOL(StatisticsResultFloat) *result) {
+		LIBSAKURA_SYMBOL(StatisticsResultFloat) *result, size_t num_threads) {
 #if defined(__AVX__) && !defined(ARCH_SCALAR) && (! FORCE_EIGEN)
 	SIMDStats<float, double> reducer(data, is_valid);
 #else
 	ScalarStats<float, double> reducer(data, is_valid);
 #endif
-	auto stats = Traverse<4u, 8u, decltype(reducer)>(0u, num_data, &reducer);
+	auto stats = Traverse<4u, 8u, decltype(reducer)>(0u, num_data, &reducer,
+			num_threads);
 
 	result->count = stats.count;
 	result->sum = stats.sum;
@@ -861,6 +1334,8 @@ LIBSAKURA_SYMBOL(Status) ComputeStatisticsFloatGateKeeper(Func func,
 
 	try {
 		func(/*num_data, data, is_valid, result*/);
+	} catch (const std::bad_alloc &e) {
+		return LIBSAKURA_SYMBOL(Status_kNoMemory);
 	} catch (...) {
 		assert(false); // No exception should be raised for the current implementation.
 		return LIBSAKURA_SYMBOL(Status_kUnknownError);
@@ -868,63 +1343,285 @@ LIBSAKURA_SYMBOL(Status) ComputeStatisticsFloatGateKeeper(Func func,
 	return LIBSAKURA_SYMBOL(Status_kOK);
 }
 
-extern "C" LIBSAKURA_SYMBOL(Status) LIBSAKURA_SYMBOL(ComputeStatisticsFloat)(
+extern "C" LIBSAKURA_SYMBOL(Status) LIBSAKURA_ARCH_SYMBOL(ComputeStatisticsFloat)(
 		size_t num_data, float const data[], bool const is_valid[],
 		LIBSAKURA_SYMBOL(StatisticsResultFloat) *result) noexcept {
+	LIBSAKURA_PROFILE_KERNEL(ComputeStatisticsFloat,
+			num_data * (sizeof(float) + sizeof(bool)));
 	return ComputeStatisticsFloatGateKeeper(
 			[=] {ComputeStatistics(num_data, data, is_valid, result);},
 			num_data, data, is_valid, result);
 }
 
-extern "C" LIBSAKURA_SYMBOL(Status) LIBSAKURA_SYMBOL(ComputeAccurateStatisticsFloat)(
+extern "C" LIBSAKURA_SYMBOL(Status) LIBSAKURA_ARCH_SYMBOL(ComputeAccurateStatisticsFloat)(
 		size_t num_data, float const data[], bool const is_valid[],
 		LIBSAKURA_SYMBOL(StatisticsResultFloat) *result) noexcept {
+	LIBSAKURA_PROFILE_KERNEL(ComputeAccurateStatisticsFloat,
+			num_data * (sizeof(float) + sizeof(bool)));
 	return ComputeStatisticsFloatGateKeeper(
 			[=] {ComputeAccurateStatistics(num_data, data, is_valid, result);},
 			num_data, data, is_valid, result);
 }
 
-extern "C" LIBSAKURA_SYMBOL(Status) LIBSAKURA_SYMBOL(ComputeStddevFloat)(
-		size_t degree_of_freedom, double mean, size_t num_data, float const data[],
-		bool const is_valid[], double *result) noexcept {
+extern "C" LIBSAKURA_SYMBOL(Status) LIBSAKURA_ARCH_SYMBOL(ComputeAccurateStatisticsParallelFloat)(
+		size_t num_data, float const data[], bool const is_valid[],
+		size_t num_threads, LIBSAKURA_SYMBOL(StatisticsResultFloat) *result) noexcept {
+	LIBSAKURA_PROFILE_KERNEL(ComputeAccurateStatisticsParallelFloat,
+			num_data * (sizeof(float) + sizeof(bool)));
+	if (num_threads == 0) {
+		num_threads = std::max(1u, std::thread::hardware_concurrency());
+	}
+	return ComputeStatisticsFloatGateKeeper(
+			[=] {ComputeAccurateStatistics(num_data, data, is_valid, result,
+						num_threads);}, num_data, data, is_valid, result);
+}
+
+extern "C" LIBSAKURA_SYMBOL(Status) LIBSAKURA_ARCH_SYMBOL(ComputeStatisticsBatchFloat)(
+		size_t num_rows, size_t num_data,
+		float const data/*[num_rows]*/[/*num_data*/],
+		bool const is_valid/*[num_rows]*/[/*num_data*/], size_t num_threads,
+		LIBSAKURA_SYMBOL(StatisticsResultFloat) result[/*num_rows*/]) noexcept {
+	LIBSAKURA_PROFILE_KERNEL(ComputeStatisticsBatchFloat,
+			num_rows * num_data * (sizeof(float) + sizeof(bool)));
 	CHECK_ARGS(num_data <= INT32_MAX);
 	CHECK_ARGS(data != nullptr);
 	CHECK_ARGS(is_valid != nullptr);
 	CHECK_ARGS(LIBSAKURA_SYMBOL(IsAligned)(data));
 	CHECK_ARGS(LIBSAKURA_SYMBOL(IsAligned)(is_valid));
-	CHECK_ARGS(degree_of_freedom > 0);
+	if (num_rows > 1) {
+		CHECK_ARGS(num_data == 0 || num_rows <= SIZE_MAX / num_data);
+		// every row must be aligned
+		CHECK_ARGS(LIBSAKURA_SYMBOL(IsAligned)(&data[num_data]));
+		CHECK_ARGS(LIBSAKURA_SYMBOL(IsAligned)(&is_valid[num_data]));
+	}
 	CHECK_ARGS(result != nullptr);
+	if (num_threads == 0) {
+		num_threads = std::max(1u, std::thread::hardware_concurrency());
+	}
+
+	try {
+		ComputeStatisticsBatch(num_rows, num_data, data, is_valid, num_threads,
+				result);
+	} catch (const std::bad_alloc &e) {
+		return LIBSAKURA_SYMBOL(Status_kNoMemory);
+	} catch (...) {
+		assert(false); // No exception should be raised for the current implementation.
+		return LIBSAKURA_SYMBOL(Status_kUnknownError);
+	}
+	return LIBSAKURA_SYMBOL(Status_kOK);
+}
+
+namespace {
+
+/*
+ * Appends statistics of data, the first element of which is at @a offset
+ * in the whole data, to @a accumulator having statistics of the preceding data.
+ */
+void AppendStatistics(size_t offset,
+LIBSAKURA_SYMBOL(StatisticsResultFloat) const &increment,
+LIBSAKURA_SYMBOL(StatisticsResultFloat) *accumulator) {
+	accumulator->count += increment.count;
+	accumulator->sum += increment.sum;
+	accumulator->square_sum += increment.square_sum;
+	if (increment.index_of_min >= 0
+			&& (accumulator->index_of_min < 0
+					|| increment.min < accumulator->min)) {
+		accumulator->min = increment.min;
+		accumulator->index_of_min = offset + increment.index_of_min;
+	}
+	if (increment.index_of_max >= 0
+			&& (accumulator->index_of_max < 0
+					|| increment.max > accumulator->max)) {
+		accumulator->max = increment.max;
+		accumulator->index_of_max = offset + increment.index_of_max;
+	}
+}
 
-#if 1
+} /* anonymous namespace */
+
+extern "C" LIBSAKURA_SYMBOL(Status) LIBSAKURA_ARCH_SYMBOL(InitializeStatisticsAccumulatorFloat)(
+		LIBSAKURA_SYMBOL(StatisticsAccumulatorFloat) *accumulator) noexcept {
+	CHECK_ARGS(accumulator != nullptr);
+	auto &statistics = accumulator->statistics;
+	statistics.count = 0;
+	statistics.sum = 0.;
+	statistics.square_sum = 0.;
+	statistics.min = statistics.max = NAN;
+	statistics.index_of_min = statistics.index_of_max = -1;
+	accumulator->num_data = 0;
+	return LIBSAKURA_SYMBOL(Status_kOK);
+}
+
+extern "C" LIBSAKURA_SYMBOL(Status) LIBSAKURA_ARCH_SYMBOL(UpdateStatisticsAccumulatorFloat)(
+		size_t num_data, float const data[], bool const is_valid[],
+		LIBSAKURA_SYMBOL(StatisticsAccumulatorFloat) *accumulator) noexcept {
+	LIBSAKURA_PROFILE_KERNEL(UpdateStatisticsAccumulatorFloat,
+			num_data * (sizeof(float) + sizeof(bool)));
+	CHECK_ARGS(accumulator != nullptr);
+	LIBSAKURA_SYMBOL(StatisticsResultFloat) chunk;
+	auto status = ComputeStatisticsFloatGateKeeper(
+			[&] {ComputeAccurateStatistics(num_data, data, is_valid, &chunk);},
+			num_data, data, is_valid, &chunk);
+	if (status == LIBSAKURA_SYMBOL(Status_kOK)) {
+		AppendStatistics(accumulator->num_data, chunk, &accumulator->statistics);
+		accumulator->num_data += num_data;
+	}
+	return status;
+}
+
+extern "C" LIBSAKURA_SYMBOL(Status) LIBSAKURA_ARCH_SYMBOL(MergeStatisticsAccumulatorFloat)(
+		LIBSAKURA_SYMBOL(StatisticsAccumulatorFloat) const *increment,
+		LIBSAKURA_SYMBOL(StatisticsAccumulatorFloat) *accumulator) noexcept {
+	CHECK_ARGS(increment != nullptr);
+	CHECK_ARGS(accumulator != nullptr);
+	auto const copy = *increment; // increment may be accumulator
+	AppendStatistics(accumulator->num_data, copy.statistics,
+			&accumulator->statistics);
+	accumulator->num_data += copy.num_data;
+	return LIBSAKURA_SYMBOL(Status_kOK);
+}
+
+extern "C" LIBSAKURA_SYMBOL(Status) LIBSAKURA_ARCH_SYMBOL(FinalizeStatisticsAccumulatorFloat)(
+		LIBSAKURA_SYMBOL(StatisticsAccumulatorFloat) const *accumulator,
+		LIBSAKURA_SYMBOL(StatisticsResultFloat) *result) noexcept {
+	CHECK_ARGS(accumulator != nullptr);
+	CHECK_ARGS(result != nullptr);
+	*result = accumulator->statistics;
+	return LIBSAKURA_SYMBOL(Status_kOK);
+}
+
+namespace {
+
+/*
+ * Data are processed by blocks of this number of elements, which fit in
+ * L1 cache. It must be a multiple of the alignment.
+ */
+constexpr size_t kStddevBlockSize = 4096;
+
+/*
+ * Returns the number of valid elements and their sum.
+ */
+inline void SumValid(size_t num_data, float const data[],
+bool const is_valid[], size_t *count, double *sum) {
+	*count = 0;
+	*sum = 0.;
+	size_t start = 0;
+#if defined(__AVX__) && !defined(ARCH_SCALAR) && (! FORCE_EIGEN)
+	SumPacketsSimd(num_data / 8, data, is_valid, count, sum);
+	start = num_data / 8 * 8;
+#endif
+	for (size_t i = start; i < num_data; ++i) {
+		if (is_valid[i]) {
+			++*count;
+			*sum += data[i];
+		}
+	}
+}
+
+/*
+ * Returns the sum of squared differences of valid elements from @a mean .
+ */
+inline double SumSquaredDiff(size_t num_data, float const data[],
+bool const is_valid[], double mean) {
 	double sq_diff = 0.;
-	for (size_t i = 0; i < num_data; ++i) {
+	size_t start = 0;
+#if defined(__AVX__) && !defined(ARCH_SCALAR) && (! FORCE_EIGEN)
+	sq_diff = SumSquaredDiffPacketsSimd(num_data / 8, data, is_valid, mean);
+	start = num_data / 8 * 8;
+#endif
+	for (size_t i = start; i < num_data; ++i) {
 		if (is_valid[i]) {
 			double diff = data[i] - mean;
 			sq_diff += diff * diff;
 		}
 	}
-	*result = std::sqrt(sq_diff / degree_of_freedom);
-#else
-	{
-		size_t n = 0;
-		double mean = 0;
-		double M2 = 0;
+	return sq_diff;
+}
 
-		for (size_t i = 0; i < num_data; ++i) {
-			if (is_valid[i]) {
-				++n;
-				double delta = data[i] - mean;
-				mean += delta / n;
-				M2 += delta * (data[i] - mean);
-			}
+/*
+ * Each block is reduced to its count, mean and the sum of squared
+ * differences from the mean (M2) by two passes over the block in cache,
+ * and the results of blocks are merged by the formula of Chan et al.
+ * Thus, data are read from memory once while the accuracy is that of
+ * the two-pass algorithm.
+ */
+void ComputeMeanAndStddev(size_t num_data, float const data[],
+bool const is_valid[], size_t delta_degree_of_freedom, double *mean_arg,
+		double *stddev_arg) {
+	size_t count = 0;
+	double mean = 0.;
+	double m2 = 0.;
+	for (size_t offset = 0; offset < num_data; offset += kStddevBlockSize) {
+		size_t const block_size = std::min(kStddevBlockSize, num_data - offset);
+		size_t block_count;
+		double block_sum;
+		SumValid(block_size, &data[offset], &is_valid[offset], &block_count,
+				&block_sum);
+		if (block_count == 0) {
+			continue;
 		}
+		double const block_mean = block_sum / block_count;
+		double const block_m2 = SumSquaredDiff(block_size, &data[offset],
+				&is_valid[offset], block_mean);
+		size_t const new_count = count + block_count;
+		double const delta = block_mean - mean;
+		double const block_weight = static_cast<double>(block_count)
+				/ new_count;
+		mean += delta * block_weight;
+		m2 += block_m2 + delta * delta * count * block_weight;
+		count = new_count;
+	}
+	if (count == 0) {
+		*mean_arg = NAN;
+		*stddev_arg = NAN;
+		return;
+	}
+	*mean_arg = mean;
+	*stddev_arg =
+			count > delta_degree_of_freedom ?
+					std::sqrt(m2 / (count - delta_degree_of_freedom)) : NAN;
+}
 
-		if (n < 2) {
-			*result = 0.;
-		}
-		*result = std::sqrt(M2 / (n - 1));
+} /* anonymous namespace */
+
+extern "C" LIBSAKURA_SYMBOL(Status) LIBSAKURA_ARCH_SYMBOL(ComputeStddevFloat)(
+		size_t degree_of_freedom, double mean, size_t num_data, float const data[],
+		bool const is_valid[], double *result) noexcept {
+	LIBSAKURA_PROFILE_KERNEL(ComputeStddevFloat,
+			num_data * (sizeof(float) + sizeof(bool)));
+	CHECK_ARGS(num_data <= INT32_MAX);
+	CHECK_ARGS(data != nullptr);
+	CHECK_ARGS(is_valid != nullptr);
+	CHECK_ARGS(LIBSAKURA_SYMBOL(IsAligned)(data));
+	CHECK_ARGS(LIBSAKURA_SYMBOL(IsAligned)(is_valid));
+	CHECK_ARGS(degree_of_freedom > 0);
+	CHECK_ARGS(result != nullptr);
+
+	// sums of blocks are added to reduce rounding errors for large data.
+	double sq_diff = 0.;
+	for (size_t offset = 0; offset < num_data; offset += kStddevBlockSize) {
+		sq_diff += SumSquaredDiff(std::min(kStddevBlockSize, num_data - offset),
+				&data[offset], &is_valid[offset], mean);
 	}
-#endif
+	*result = std::sqrt(sq_diff / degree_of_freedom);
+	return LIBSAKURA_SYMBOL(Status_kOK);
+}
+
+extern "C" LIBSAKURA_SYMBOL(Status) LIBSAKURA_ARCH_SYMBOL(ComputeMeanAndStddevFloat)(
+		size_t num_data, float const data[], bool const is_valid[],
+		size_t delta_degree_of_freedom, double *mean, double *stddev) noexcept {
+	LIBSAKURA_PROFILE_KERNEL(ComputeMeanAndStddevFloat,
+			num_data * (sizeof(float) + sizeof(bool)));
+	CHECK_ARGS(num_data <= INT32_MAX);
+	CHECK_ARGS(data != nullptr);
+	CHECK_ARGS(is_valid != nullptr);
+	CHECK_ARGS(LIBSAKURA_SYMBOL(IsAligned)(data));
+	CHECK_ARGS(LIBSAKURA_SYMBOL(IsAligned)(is_valid));
+	CHECK_ARGS(mean != nullptr);
+	CHECK_ARGS(stddev != nullptr);
+
+	ComputeMeanAndStddev(num_data, data, is_valid, delta_degree_of_freedom,
+			mean, stddev);
 	return LIBSAKURA_SYMBOL(Status_kOK);
 }
 
@@ -932,10 +1629,10 @@ namespace {
 
 template<typename T, typename COMPARATOR>
 void QuickSort(size_t num_data, T data[]) {
-	// TODO implement quick sort using expression template to avoid overhead of calling COMPARATOR.
-	qsort(data, num_data, sizeof(T),
-			reinterpret_cast<int (*)(void const*,
-					void const*)>(COMPARATOR::Compare));}
+	std::sort(data, data + num_data, [](T const &a, T const &b) {
+		return COMPARATOR::Compare(&a, &b) < 0;
+	});
+}
 
 template<typename T>
 struct AscendingOrder {
@@ -964,9 +1661,11 @@ struct AscendingOrder {
 
 }
 
-extern "C" LIBSAKURA_SYMBOL(Status) LIBSAKURA_SYMBOL(SortValidValuesDenselyFloat)(
+extern "C" LIBSAKURA_SYMBOL(Status) LIBSAKURA_ARCH_SYMBOL(SortValidValuesDenselyFloat)(
 		size_t num_data, bool const is_valid[], float data[],
 		size_t *new_num_data) noexcept {
+	LIBSAKURA_PROFILE_KERNEL(SortValidValuesDenselyFloat,
+			num_data * (sizeof(float) + sizeof(bool)));
 	CHECK_ARGS(data != nullptr);
 	CHECK_ARGS(is_valid != nullptr);
 	CHECK_ARGS(new_num_data != nullptr);
@@ -1025,7 +1724,325 @@ LIBSAKURA_SYMBOL(Status) ComputeMedianAbsoluteDeviation(size_t num_data,
 
 }
 
-extern "C" LIBSAKURA_SYMBOL(Status) LIBSAKURA_SYMBOL(ComputeMedianAbsoluteDeviationFloat)(
+extern "C" LIBSAKURA_SYMBOL(Status) LIBSAKURA_ARCH_SYMBOL(ComputeMedianAbsoluteDeviationFloat)(
 		size_t num_data, float const data[], float new_data[]) noexcept {
 	return ComputeMedianAbsoluteDeviation(num_data, data, new_data);
 }
+
+namespace {
+
+/**
+ * The number of floats written beyond the end of the output by a vector
+ * in PartitionFloat().
+ */
+constexpr size_t kPartitionPadding = 16;
+
+/**
+ * Ranges not longer than this are selected by std::nth_element.
+ */
+constexpr size_t kMaxNthElementSize = 64;
+
+#if defined(__AVX2__) && !defined(ARCH_AFTER_SKYLAKE_AVX512) && !defined(ARCH_SCALAR)
+/**
+ * Permutations to gather the elements selected by an 8-bit mask
+ * to the lower part of __m256.
+ */
+struct CompressTable {
+	CompressTable() {
+		for (size_t mask = 0; mask < ELEMENTSOF(index); ++mask) {
+			size_t k = 0;
+			for (int32_t i = 0; i < 8; ++i) {
+				if ((mask >> i) & 1) {
+					index[mask][k++] = i;
+				}
+			}
+			for (; k < 8; ++k) {
+				index[mask][k] = 0;
+			}
+		}
+	}
+	int32_t index[256][8];
+};
+#endif
+
+/**
+ * Partitions @a data so that the elements less than @a pivot
+ * (or equal to it if @a kInclusive is true) come first.
+ *
+ * The elements are distributed to @a left and @a right , then
+ * copied back to @a data .
+ *
+ * @param[in] num_data The number of elements in @a data .
+ * @param[in,out] data Data to be partitioned. It need not be aligned.
+ * @param[out] left Work area of ( @a num_data + kPartitionPadding ) elements.
+ * @param[out] right Work area of ( @a num_data + kPartitionPadding ) elements.
+ * @return The number of elements in the first part.
+ */
+template<bool kInclusive>
+size_t PartitionFloat(float pivot, size_t num_data, float data[],
+		float left[], float right[]) {
+	size_t num_left = 0;
+	size_t num_right = 0;
+	size_t i = 0;
+#if defined(ARCH_AFTER_SKYLAKE_AVX512)
+	constexpr size_t kNumFloat = sizeof(__m512) / sizeof(float);
+	auto const packed_pivot = _mm512_set1_ps(pivot);
+	for (; i + kNumFloat <= num_data; i += kNumFloat) {
+		auto const value = _mm512_loadu_ps(&data[i]);
+		__mmask16 const is_left = _mm512_cmp_ps_mask(value, packed_pivot,
+				kInclusive ? _CMP_LE_OQ : _CMP_LT_OQ);
+		_mm512_storeu_ps(&left[num_left],
+				_mm512_maskz_compress_ps(is_left, value));
+		_mm512_storeu_ps(&right[num_right],
+				_mm512_maskz_compress_ps(static_cast<__mmask16>(~is_left),
+						value));
+		size_t const count = _mm_popcnt_u32(is_left);
+		num_left += count;
+		num_right += kNumFloat - count;
+	}
+#elif defined(__AVX2__) && !defined(ARCH_SCALAR)
+	static CompressTable const table;
+	constexpr size_t kNumFloat = sizeof(__m256) / sizeof(float);
+	auto const packed_pivot = _mm256_set1_ps(pivot);
+	for (; i + kNumFloat <= num_data; i += kNumFloat) {
+		auto const value = _mm256_loadu_ps(&data[i]);
+		int const is_left = _mm256_movemask_ps(
+				_mm256_cmp_ps(value, packed_pivot,
+						kInclusive ? _CMP_LE_OQ : _CMP_LT_OQ));
+		_mm256_storeu_ps(&left[num_left],
+				_mm256_permutevar8x32_ps(value,
+						_mm256_loadu_si256(
+								reinterpret_cast<__m256i const *>(table.index[is_left]))));
+		_mm256_storeu_ps(&right[num_right],
+				_mm256_permutevar8x32_ps(value,
+						_mm256_loadu_si256(
+								reinterpret_cast<__m256i const *>(table.index[~is_left
+										& 0xff]))));
+		size_t const count = _mm_popcnt_u32(is_left);
+		num_left += count;
+		num_right += kNumFloat - count;
+	}
+#endif
+	for (; i < num_data; ++i) {
+		auto const value = data[i];
+		bool const is_left = kInclusive ? (value <= pivot) : (value < pivot);
+		left[num_left] = value;
+		right[num_right] = value;
+		num_left += is_left;
+		num_right += !is_left;
+	}
+	assert(num_left + num_right == num_data);
+	std::copy(left, left + num_left, data);
+	std::copy(right, right + num_right, data + num_left);
+	return num_left;
+}
+
+/**
+ * Rearranges @a data[ @a begin : @a end ] so that @a data[ @a k ] is
+ * the element which would be there if it were sorted, the elements
+ * before it are not greater than it and those after it are not less
+ * than it. The same as std::nth_element, but each partition step is
+ * vectorized.
+ *
+ * @param[in,out] data Data. Its elements must not be NaN.
+ * @param[out] work Work area of 2 * ( @a end - @a begin + kPartitionPadding )
+ * elements.
+ * @return @a data[ @a k ]
+ */
+float SelectFloat(size_t k, size_t begin, size_t end, float data[],
+		float work[]) {
+	assert(begin <= k && k < end);
+	float *left = work;
+	float *right = &work[end - begin + kPartitionPadding];
+	// fall back to std::nth_element if pivots are persistently bad
+	size_t depth_limit = 2 * (sizeof(size_t) * CHAR_BIT);
+	while (end - begin > kMaxNthElementSize && depth_limit-- > 0) {
+		auto const a = data[begin];
+		auto const b = data[begin + (end - begin) / 2];
+		auto const c = data[end - 1];
+		auto const pivot = std::max(std::min(a, b), std::min(std::max(a, b), c));
+		size_t boundary = begin
+				+ PartitionFloat<false>(pivot, end - begin, &data[begin], left,
+						right);
+		if (k < boundary) {
+			end = boundary;
+			continue;
+		}
+		if (boundary == begin) {
+			// pivot is the minimum. Separate the elements equal to it.
+			boundary = begin
+					+ PartitionFloat<true>(pivot, end - begin, &data[begin],
+							left, right);
+			if (k < boundary) {
+				return pivot;
+			}
+		}
+		begin = boundary;
+	}
+	std::nth_element(&data[begin], &data[k], &data[end]);
+	return data[k];
+}
+
+/**
+ * Moves valid elements of @a data to its front.
+ *
+ * @return The number of valid elements.
+ */
+size_t PackValidValues(size_t num_data, bool const is_valid[], float data[]) {
+	size_t valid_count = 0;
+	for (size_t i = 0; i < num_data; ++i) {
+		if (is_valid[i]) {
+			auto const the_data = data[i];
+			assert(!std::isnan(the_data) && !std::isinf(the_data));
+			data[valid_count] = the_data;
+			++valid_count;
+		}
+	}
+	return valid_count;
+}
+
+/**
+ * Returns the median of @a data . @a data is rearranged by SelectFloat().
+ *
+ * @param[in] num_data The number of elements in @a data . It must be positive.
+ */
+float SelectMedianFloat(size_t num_data, float data[], float work[]) {
+	assert(num_data > 0);
+	size_t const center = num_data / 2;
+	if (num_data % 2 != 0) {
+		return SelectFloat(center, 0, num_data, data, work);
+	}
+	auto const lower = SelectFloat(center - 1, 0, num_data, data, work);
+	auto const upper = *std::min_element(&data[center], &data[num_data]);
+	return (upper + lower) / 2;
+}
+
+/**
+ * Allocates a work area for SelectFloat() to select from @a num_data elements.
+ */
+std::unique_ptr<void, LIBSAKURA_PREFIX::Memory> AllocateSelectionWorkArea(
+		size_t num_data, float **work) {
+	return std::unique_ptr<void, LIBSAKURA_PREFIX::Memory>(
+			LIBSAKURA_PREFIX::Memory::AlignedAllocateOrException(
+					sizeof(float) * 2 * (num_data + kPartitionPadding), work));
+}
+
+} /* anonymous namespace */
+
+extern "C" LIBSAKURA_SYMBOL(Status) LIBSAKURA_ARCH_SYMBOL(ComputeQuantilesFloat)(
+		size_t num_data, bool const is_valid[], float data[],
+		size_t num_probabilities, double const probability[], float quantile[],
+		size_t *new_num_data) noexcept {
+	LIBSAKURA_PROFILE_KERNEL(ComputeQuantilesFloat,
+			num_data * (sizeof(float) + sizeof(bool)));
+	CHECK_ARGS(data != nullptr);
+	CHECK_ARGS(is_valid != nullptr);
+	CHECK_ARGS(num_probabilities == 0 || probability != nullptr);
+	CHECK_ARGS(num_probabilities == 0 || quantile != nullptr);
+	CHECK_ARGS(new_num_data != nullptr);
+	for (size_t i = 0; i < num_probabilities; ++i) {
+		CHECK_ARGS(0. <= probability[i] && probability[i] <= 1.);
+	}
+
+	try {
+		size_t const valid_count = PackValidValues(num_data, is_valid, data);
+		*new_num_data = valid_count;
+		if (valid_count == 0) {
+			std::fill(quantile, quantile + num_probabilities, NAN);
+			return LIBSAKURA_SYMBOL(Status_kOK);
+		}
+		// select in ascending order of rank to narrow the range to be selected
+		std::vector<size_t> order(num_probabilities);
+		std::iota(order.begin(), order.end(), 0);
+		std::sort(order.begin(), order.end(), [probability](size_t a, size_t b) {
+			return probability[a] < probability[b];
+		});
+		float *work = nullptr;
+		auto work_storage = AllocateSelectionWorkArea(valid_count, &work);
+		size_t begin = 0;
+		for (auto i : order) {
+			double const position = probability[i] * (valid_count - 1);
+			size_t const rank = static_cast<size_t>(position);
+			auto const lower = SelectFloat(rank, begin, valid_count, data, work);
+			begin = rank;
+			double const fraction = position - rank;
+			if (fraction > 0.) {
+				auto const upper = *std::min_element(&data[rank + 1],
+						&data[valid_count]);
+				quantile[i] = static_cast<float>(
+						lower + fraction * (static_cast<double>(upper) - lower));
+			} else {
+				quantile[i] = lower;
+			}
+		}
+	} catch (const std::bad_alloc &e) {
+		return LIBSAKURA_SYMBOL(Status_kNoMemory);
+	} catch (...) {
+		assert(false);
+		return LIBSAKURA_SYMBOL(Status_kUnknownError);
+	}
+	return LIBSAKURA_SYMBOL(Status_kOK);
+}
+
+namespace {
+
+/**
+ * Common body of ComputeMedianFloat and
+ * ComputeMedianAndMedianAbsoluteDeviationFloat. @a mad may be nullptr.
+ */
+LIBSAKURA_SYMBOL(Status) ComputeMedianAndMad(size_t num_data,
+		bool const is_valid[], float data[], float *median, float *mad,
+		size_t *new_num_data) noexcept {
+	CHECK_ARGS(data != nullptr);
+	CHECK_ARGS(is_valid != nullptr);
+	CHECK_ARGS(median != nullptr);
+	CHECK_ARGS(new_num_data != nullptr);
+
+	try {
+		size_t const valid_count = PackValidValues(num_data, is_valid, data);
+		*new_num_data = valid_count;
+		if (valid_count == 0) {
+			*median = NAN;
+			if (mad != nullptr) {
+				*mad = NAN;
+			}
+			return LIBSAKURA_SYMBOL(Status_kOK);
+		}
+		float *work = nullptr;
+		auto work_storage = AllocateSelectionWorkArea(valid_count, &work);
+		auto const the_median = SelectMedianFloat(valid_count, data, work);
+		*median = the_median;
+		if (mad != nullptr) {
+			for (size_t i = 0; i < valid_count; ++i) {
+				data[i] = std::abs(data[i] - the_median);
+			}
+			*mad = SelectMedianFloat(valid_count, data, work);
+		}
+	} catch (const std::bad_alloc &e) {
+		return LIBSAKURA_SYMBOL(Status_kNoMemory);
+	} catch (...) {
+		assert(false);
+		return LIBSAKURA_SYMBOL(Status_kUnknownError);
+	}
+	return LIBSAKURA_SYMBOL(Status_kOK);
+}
+
+} /* anonymous namespace */
+
+extern "C" LIBSAKURA_SYMBOL(Status) LIBSAKURA_ARCH_SYMBOL(ComputeMedianAndMedianAbsoluteDeviationFloat)(
+		size_t num_data, bool const is_valid[], float data[], float *median,
+		float *mad, size_t *new_num_data) noexcept {
+	LIBSAKURA_PROFILE_KERNEL(ComputeMedianAndMedianAbsoluteDeviationFloat,
+			num_data * (sizeof(float) + sizeof(bool)));
+	return ComputeMedianAndMad(num_data, is_valid, data, median, mad,
+			new_num_data);
+}
+
+extern "C" LIBSAKURA_SYMBOL(Status) LIBSAKURA_ARCH_SYMBOL(ComputeMedianFloat)(
+		size_t num_data, bool const is_valid[], float data[], float *median,
+		size_t *new_num_data) noexcept {
+	LIBSAKURA_PROFILE_KERNEL(ComputeMedianFloat,
+			num_data * (sizeof(float) + sizeof(bool)));
+	return ComputeMedianAndMad(num_data, is_valid, data, median, nullptr,
+			new_num_data);
+}
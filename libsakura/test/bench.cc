@@ -0,0 +1,1509 @@
+/*
+ * @SAKURA_LICENSE_HEADER_START@
+ * Copyright (C) 2013-2022
+ * Inter-University Research Institute Corporation, National Institutes of Natural Sciences
+ * 2-21-1, Osawa, Mitaka, Tokyo, 181-8588, Japan.
+ *
+ * This file is part of Sakura.
+ *
+ * Sakura is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or (at your
+ * option) any later version.
+ *
+ * Sakura is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public
+ * License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Sakura.  If not, see <http://www.gnu.org/licenses/>.
+ * @SAKURA_LICENSE_HEADER_END@
+ */
+/*
+ * bench.cc
+ *
+ * Micro benchmarks of the kernels of Sakura Library.
+ *
+ * Each kernel is run with arrays from L1 resident to DRAM bound sizes.
+ * The number of iterations is increased until a measurement takes
+ * --min_time seconds. Time per call, time per element and
+ * throughput of the arrays read and written are reported, and written
+ * in JSON with --json so that results of releases and SIMD_ARCH builds
+ * can be compared.
+ *
+ * With SIMD_ARCH=DISPATCH, every ISA variant runnable on the CPU
+ * is measured by selecting it with SAKURA_ARCH environment variable.
+ *
+ * usage: sakurabench [--filter=SUBSTRING] [--sizes=N,N,...]
+ *            [--min_time=SECONDS] [--paths=NAME,NAME,...] [--json=FILE]
+ */
+
+#include <libsakura/sakura.h>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#define STRINGIFY_(x) #x
+#define STRINGIFY(x) STRINGIFY_(x)
+
+#ifndef BENCH_SIMD_PATH
+# define BENCH_SIMD_PATH NATIVE
+#endif
+
+namespace {
+
+typedef LIBSAKURA_SYMBOL(Status) Status;
+
+constexpr size_t kAlignment = 64;
+
+/*
+ * Aligned array of which contents are not initialized.
+ */
+template<typename T>
+class Array {
+public:
+	explicit Array(size_t size) :
+			size_(size), data_(Allocate(size), free) {
+	}
+	T *data() const {
+		return data_.get();
+	}
+	T &operator[](size_t i) const {
+		return data_.get()[i];
+	}
+	size_t size() const {
+		return size_;
+	}
+private:
+	static T *Allocate(size_t size) {
+		void *ptr = nullptr;
+		if (posix_memalign(&ptr, kAlignment,
+				std::max(size, static_cast<size_t>(1)) * sizeof(T)) != 0) {
+			throw std::bad_alloc();
+		}
+		return static_cast<T *>(ptr);
+	}
+
+	size_t size_;
+	std::unique_ptr<T, decltype(&free)> data_;
+};
+
+template<typename T>
+void FillRandom(Array<T> const &array, double lower, double upper) {
+	std::mt19937 engine(static_cast<std::mt19937::result_type>(array.size()));
+	std::uniform_real_distribution<double> distribution(lower, upper);
+	for (size_t i = 0; i < array.size(); ++i) {
+		array[i] = static_cast<T>(distribution(engine));
+	}
+}
+
+/*
+ * Sets 90% of elements to true.
+ */
+void FillMask(Array<bool> const &mask) {
+	std::mt19937 engine(static_cast<std::mt19937::result_type>(mask.size()));
+	std::uniform_int_distribution<int> distribution(0, 9);
+	for (size_t i = 0; i < mask.size(); ++i) {
+		mask[i] = distribution(engine) != 0;
+	}
+}
+
+void Fill(Array<bool> const &mask, bool value) {
+	std::fill(mask.data(), mask.data() + mask.size(), value);
+}
+
+void Check(Status status) {
+	if (status != LIBSAKURA_SYMBOL(Status_kOK)) {
+		throw std::runtime_error(
+				"returned status " + std::to_string(static_cast<int>(status)));
+	}
+}
+
+struct Result {
+	std::string name;
+	std::string path;
+	size_t num_elements;
+	size_t iterations;
+	double seconds_per_iteration;
+	uint64_t bytes_per_iteration;
+};
+
+/*
+ * Measures a benchmark at a size.
+ */
+class State {
+public:
+	State(size_t num_elements, double min_time) :
+			num_elements_(num_elements), min_time_(min_time), iterations_(0), seconds_per_iteration_(
+					0.), bytes_per_iteration_(0) {
+	}
+	size_t num_elements() const {
+		return num_elements_;
+	}
+	/*
+	 * Calls func repeatedly. bytes_per_iteration is the size of the arrays
+	 * read and written by a call.
+	 */
+	template<typename Func>
+	void Run(uint64_t bytes_per_iteration, Func func) {
+		constexpr size_t kMaxIterations = 1000000000;
+		bytes_per_iteration_ = bytes_per_iteration;
+		func(); // warm up caches and page tables
+		size_t iterations = 1;
+		for (;;) {
+			auto const start = std::chrono::steady_clock::now();
+			for (size_t i = 0; i < iterations; ++i) {
+				func();
+			}
+			double const elapsed = std::chrono::duration<double>(
+					std::chrono::steady_clock::now() - start).count();
+			if (elapsed >= min_time_ || iterations >= kMaxIterations) {
+				iterations_ = iterations;
+				seconds_per_iteration_ = elapsed / iterations;
+				return;
+			}
+			// aim at 1.4 times min_time not to fall short again
+			double const scale =
+					elapsed > 0. ? 1.4 * min_time_ / elapsed : 10.;
+			iterations = std::max(iterations + 1,
+					std::min(iterations * 10,
+							static_cast<size_t>(iterations * scale)));
+		}
+	}
+	size_t iterations() const {
+		return iterations_;
+	}
+	double seconds_per_iteration() const {
+		return seconds_per_iteration_;
+	}
+	uint64_t bytes_per_iteration() const {
+		return bytes_per_iteration_;
+	}
+private:
+	size_t const num_elements_;
+	double const min_time_;
+	size_t iterations_;
+	double seconds_per_iteration_;
+	uint64_t bytes_per_iteration_;
+};
+
+struct Benchmark {
+	char const *name;
+	/*
+	 * Larger sizes are skipped for kernels of which cost is superlinear.
+	 */
+	size_t max_elements;
+	void (*func)(State &state);
+};
+
+constexpr size_t kUnlimited = SIZE_MAX;
+
+/*
+ * statistics
+ */
+template<Status (*Func)(size_t, float const[], bool const[],
+LIBSAKURA_SYMBOL(StatisticsResultFloat) *)>
+void BenchStatistics(State &state) {
+	size_t const n = state.num_elements();
+	Array<float> data(n);
+	Array<bool> is_valid(n);
+	FillRandom(data, -1., 1.);
+	FillMask(is_valid);
+	LIBSAKURA_SYMBOL(StatisticsResultFloat) result;
+	state.Run(n * (sizeof(float) + sizeof(bool)), [&] {
+		Check(Func(n, data.data(), is_valid.data(), &result));
+	});
+}
+
+void BenchComputeMeanAndStddev(State &state) {
+	size_t const n = state.num_elements();
+	Array<float> data(n);
+	Array<bool> is_valid(n);
+	FillRandom(data, -1., 1.);
+	FillMask(is_valid);
+	double mean, stddev;
+	state.Run(n * (sizeof(float) + sizeof(bool)), [&] {
+		Check(LIBSAKURA_SYMBOL(ComputeMeanAndStddevFloat)(n, data.data(),
+						is_valid.data(), 1, &mean, &stddev));
+	});
+}
+
+/*
+ * All hardware threads are used.
+ */
+void BenchComputeAccurateStatisticsParallel(State &state) {
+	size_t const n = state.num_elements();
+	Array<float> data(n);
+	Array<bool> is_valid(n);
+	FillRandom(data, -1., 1.);
+	FillMask(is_valid);
+	LIBSAKURA_SYMBOL(StatisticsResultFloat) result;
+	state.Run(n * (sizeof(float) + sizeof(bool)), [&] {
+		Check(LIBSAKURA_SYMBOL(ComputeAccurateStatisticsParallelFloat)(n,
+						data.data(), is_valid.data(), 0, &result));
+	});
+}
+
+/*
+ * Data are divided into rows of 2048 channels and processed by one thread.
+ */
+void BenchComputeStatisticsBatch(State &state) {
+	size_t const n = state.num_elements();
+	size_t const num_data = std::min(n, static_cast<size_t>(2048));
+	size_t const num_rows = n / num_data;
+	Array<float> data(num_rows * num_data);
+	Array<bool> is_valid(num_rows * num_data);
+	Array<LIBSAKURA_SYMBOL(StatisticsResultFloat)> result(num_rows);
+	FillRandom(data, -1., 1.);
+	FillMask(is_valid);
+	state.Run(num_rows * num_data * (sizeof(float) + sizeof(bool)), [&] {
+		Check(LIBSAKURA_SYMBOL(ComputeStatisticsBatchFloat)(num_rows, num_data,
+						data.data(), is_valid.data(), 1, result.data()));
+	});
+}
+
+/*
+ * The accumulator is updated with the whole data each time.
+ */
+void BenchUpdateStatisticsAccumulator(State &state) {
+	size_t const n = state.num_elements();
+	Array<float> data(n);
+	Array<bool> is_valid(n);
+	FillRandom(data, -1., 1.);
+	FillMask(is_valid);
+	LIBSAKURA_SYMBOL(StatisticsAccumulatorFloat) accumulator;
+	Check(LIBSAKURA_SYMBOL(InitializeStatisticsAccumulatorFloat)(&accumulator));
+	state.Run(n * (sizeof(float) + sizeof(bool)), [&] {
+		Check(LIBSAKURA_SYMBOL(UpdateStatisticsAccumulatorFloat)(n, data.data(),
+						is_valid.data(), &accumulator));
+	});
+}
+
+/*
+ * The kernels below sort data in place. Each call copies the original
+ * data first and the copy is included in the time.
+ */
+void BenchSortValidValuesDensely(State &state) {
+	size_t const n = state.num_elements();
+	Array<float> data(n);
+	Array<float> work(n);
+	Array<bool> is_valid(n);
+	FillRandom(data, -1., 1.);
+	FillMask(is_valid);
+	size_t new_num_data = 0;
+	state.Run(n * (3 * sizeof(float) + sizeof(bool)), [&] {
+		std::copy(data.data(), data.data() + n, work.data());
+		Check(LIBSAKURA_SYMBOL(SortValidValuesDenselyFloat)(n, is_valid.data(),
+						work.data(), &new_num_data));
+	});
+}
+
+void BenchComputeMedianAbsoluteDeviation(State &state) {
+	size_t const n = state.num_elements();
+	Array<float> data(n);
+	Array<float> result(n);
+	FillRandom(data, -1., 1.);
+	std::sort(data.data(), data.data() + n);
+	state.Run(n * 2 * sizeof(float), [&] {
+		Check(LIBSAKURA_SYMBOL(ComputeMedianAbsoluteDeviationFloat)(n,
+						data.data(), result.data()));
+	});
+}
+
+void BenchComputeQuantiles(State &state) {
+	size_t const n = state.num_elements();
+	Array<float> data(n);
+	Array<float> work(n);
+	Array<bool> is_valid(n);
+	Array<double> probability(3);
+	Array<float> quantile(3);
+	FillRandom(data, -1., 1.);
+	FillMask(is_valid);
+	probability[0] = 0.25;
+	probability[1] = 0.5;
+	probability[2] = 0.75;
+	size_t new_num_data = 0;
+	state.Run(n * (3 * sizeof(float) + sizeof(bool)), [&] {
+		std::copy(data.data(), data.data() + n, work.data());
+		Check(LIBSAKURA_SYMBOL(ComputeQuantilesFloat)(n, is_valid.data(),
+						work.data(), probability.size(), probability.data(),
+						quantile.data(), &new_num_data));
+	});
+}
+
+/*
+ * The sketch keeps being updated across calls so that compaction at all
+ * levels is included in the time.
+ */
+void BenchUpdateQuantileSketch(State &state) {
+	size_t const n = state.num_elements();
+	Array<float> data(n);
+	Array<bool> is_valid(n);
+	FillRandom(data, -1., 1.);
+	FillMask(is_valid);
+	LIBSAKURA_SYMBOL(QuantileSketchFloat) *sketch = nullptr;
+	Check(LIBSAKURA_SYMBOL(CreateQuantileSketchFloat)(200, &sketch));
+	std::unique_ptr<LIBSAKURA_SYMBOL(QuantileSketchFloat),
+			decltype(&LIBSAKURA_SYMBOL(DestroyQuantileSketchFloat))> guard(
+			sketch, LIBSAKURA_SYMBOL(DestroyQuantileSketchFloat));
+	state.Run(n * (sizeof(float) + sizeof(bool)), [&] {
+		Check(LIBSAKURA_SYMBOL(UpdateQuantileSketchFloat)(sketch, n,
+						data.data(), is_valid.data()));
+	});
+}
+
+void BenchComputeMedian(State &state) {
+	size_t const n = state.num_elements();
+	Array<float> data(n);
+	Array<float> work(n);
+	Array<bool> is_valid(n);
+	FillRandom(data, -1., 1.);
+	FillMask(is_valid);
+	float median = 0.f;
+	size_t new_num_data = 0;
+	state.Run(n * (3 * sizeof(float) + sizeof(bool)), [&] {
+		std::copy(data.data(), data.data() + n, work.data());
+		Check(LIBSAKURA_SYMBOL(ComputeMedianFloat)(n, is_valid.data(),
+						work.data(), &median, &new_num_data));
+	});
+}
+
+void BenchComputeMedianAndMedianAbsoluteDeviation(State &state) {
+	size_t const n = state.num_elements();
+	Array<float> data(n);
+	Array<float> work(n);
+	Array<bool> is_valid(n);
+	FillRandom(data, -1., 1.);
+	FillMask(is_valid);
+	float median = 0.f;
+	float mad = 0.f;
+	size_t new_num_data = 0;
+	state.Run(n * (3 * sizeof(float) + sizeof(bool)), [&] {
+		std::copy(data.data(), data.data() + n, work.data());
+		Check(LIBSAKURA_SYMBOL(ComputeMedianAndMedianAbsoluteDeviationFloat)(n,
+						is_valid.data(), work.data(), &median, &mad,
+						&new_num_data));
+	});
+}
+
+/*
+ * bool filters
+ */
+template<typename T, Status (*Func)(size_t, T const[], T, bool[])>
+void BenchCompare(State &state) {
+	size_t const n = state.num_elements();
+	Array<T> data(n);
+	Array<bool> result(n);
+	FillRandom(data, -1000., 1000.);
+	state.Run(n * (sizeof(T) + sizeof(bool)), [&] {
+		Check(Func(n, data.data(), static_cast<T>(0), result.data()));
+	});
+}
+
+template<typename T, Status (*Func)(size_t, T const[], size_t, T const[],
+		T const[], bool[])>
+void BenchInRanges(State &state) {
+	size_t const n = state.num_elements();
+	size_t const kNumCondition = 4;
+	Array<T> data(n);
+	Array<T> lower_bounds(kNumCondition);
+	Array<T> upper_bounds(kNumCondition);
+	Array<bool> result(n);
+	FillRandom(data, -1000., 1000.);
+	for (size_t i = 0; i < kNumCondition; ++i) {
+		lower_bounds[i] = static_cast<T>(-800 + 500 * static_cast<int>(i));
+		upper_bounds[i] = static_cast<T>(-600 + 500 * static_cast<int>(i));
+	}
+	state.Run(n * (sizeof(T) + sizeof(bool)), [&] {
+		Check(Func(n, data.data(), kNumCondition, lower_bounds.data(),
+						upper_bounds.data(), result.data()));
+	});
+}
+
+void BenchSetFalseIfNanOrInf(State &state) {
+	size_t const n = state.num_elements();
+	Array<float> data(n);
+	Array<bool> result(n);
+	FillRandom(data, -1., 1.);
+	for (size_t i = 0; i < n; i += 97) {
+		data[i] = NAN;
+	}
+	state.Run(n * (sizeof(float) + sizeof(bool)), [&] {
+		Check(LIBSAKURA_SYMBOL(SetFalseIfNanOrInfFloat)(n, data.data(),
+						result.data()));
+	});
+}
+
+template<typename T, Status (*Func)(size_t, T const[], bool[])>
+void BenchToBool(State &state) {
+	size_t const n = state.num_elements();
+	Array<T> data(n);
+	Array<bool> result(n);
+	FillRandom(data, 0., 4.);
+	state.Run(n * (sizeof(T) + sizeof(bool)), [&] {
+		Check(Func(n, data.data(), result.data()));
+	});
+}
+
+void BenchInvertBool(State &state) {
+	size_t const n = state.num_elements();
+	Array<bool> data(n);
+	Array<bool> result(n);
+	FillMask(data);
+	state.Run(n * 2 * sizeof(bool), [&] {
+		Check(LIBSAKURA_SYMBOL(InvertBool)(n, data.data(), result.data()));
+	});
+}
+
+/*
+ * bit operations
+ */
+template<typename T, Status (*Func)(T, size_t, T const[], bool const[], T[])>
+void BenchBitwise(State &state) {
+	size_t const n = state.num_elements();
+	Array<T> data(n);
+	Array<bool> edit_mask(n);
+	Array<T> result(n);
+	FillRandom(data, 0., 255.);
+	FillMask(edit_mask);
+	state.Run(n * (2 * sizeof(T) + sizeof(bool)), [&] {
+		Check(Func(static_cast<T>(0x5a), n, data.data(), edit_mask.data(),
+						result.data()));
+	});
+}
+
+template<typename T, Status (*Func)(size_t, T const[], bool const[], T[])>
+void BenchBitwiseNot(State &state) {
+	size_t const n = state.num_elements();
+	Array<T> data(n);
+	Array<bool> edit_mask(n);
+	Array<T> result(n);
+	FillRandom(data, 0., 255.);
+	FillMask(edit_mask);
+	state.Run(n * (2 * sizeof(T) + sizeof(bool)), [&] {
+		Check(Func(n, data.data(), edit_mask.data(), result.data()));
+	});
+}
+
+/*
+ * normalization
+ */
+void BenchCalibrateDataWithArrayScaling(State &state) {
+	size_t const n = state.num_elements();
+	Array<float> scaling_factor(n);
+	Array<float> data(n);
+	Array<float> reference(n);
+	Array<float> result(n);
+	FillRandom(scaling_factor, 100., 200.);
+	FillRandom(data, 1., 2.);
+	FillRandom(reference, 1., 2.);
+	state.Run(n * 4 * sizeof(float), [&] {
+		Check(LIBSAKURA_SYMBOL(CalibrateDataWithArrayScalingFloat)(n,
+						scaling_factor.data(), data.data(), reference.data(),
+						result.data()));
+	});
+}
+
+void BenchCalibrateDataWithConstScaling(State &state) {
+	size_t const n = state.num_elements();
+	Array<float> data(n);
+	Array<float> reference(n);
+	Array<float> result(n);
+	FillRandom(data, 1., 2.);
+	FillRandom(reference, 1., 2.);
+	state.Run(n * 3 * sizeof(float), [&] {
+		Check(LIBSAKURA_SYMBOL(CalibrateDataWithConstScalingFloat)(150.f, n,
+						data.data(), reference.data(), result.data()));
+	});
+}
+
+/*
+ * convolution
+ */
+typedef std::unique_ptr<LIBSAKURA_SYMBOL(Convolve1DContextFloat),
+		decltype(&LIBSAKURA_SYMBOL(DestroyConvolve1DContextFloat))> ConvolveContext;
+
+void BenchCreateGaussianKernel(State &state) {
+	size_t const n = state.num_elements();
+	Array<float> kernel(n);
+	state.Run(n * sizeof(float), [&] {
+		Check(LIBSAKURA_SYMBOL(CreateGaussianKernelFloat)(n / 2.f, n / 8.f, n,
+						kernel.data()));
+	});
+}
+
+void BenchConvolve1D(State &state) {
+	size_t const n = state.num_elements();
+	size_t const kNumKernel = 25;
+	Array<float> kernel(kNumKernel);
+	Array<float> data(n);
+	Array<bool> mask(n);
+	Array<float> output(n);
+	Array<float> weight(n);
+	Check(LIBSAKURA_SYMBOL(CreateGaussianKernelFloat)(kNumKernel / 2, 5.f,
+					kNumKernel, kernel.data()));
+	FillRandom(data, -1., 1.);
+	FillMask(mask);
+	state.Run(n * (3 * sizeof(float) + sizeof(bool)), [&] {
+		Check(LIBSAKURA_SYMBOL(Convolve1DFloat)(kNumKernel, kernel.data(), n,
+						data.data(), mask.data(), output.data(), weight.data()));
+	});
+}
+
+void BenchConvolve1DFFT(State &state) {
+	size_t const n = state.num_elements();
+	Array<float> kernel(n);
+	Array<float> data(n);
+	Array<float> output(n);
+	Check(LIBSAKURA_SYMBOL(CreateGaussianKernelFloat)(n / 2, 5.f, n,
+					kernel.data()));
+	FillRandom(data, -1., 1.);
+	LIBSAKURA_SYMBOL(Convolve1DContextFloat) *context = nullptr;
+	Check(LIBSAKURA_SYMBOL(CreateConvolve1DContextFFTFloat)(n, kernel.data(),
+					&context));
+	ConvolveContext guard(context,
+			LIBSAKURA_SYMBOL(DestroyConvolve1DContextFloat));
+	state.Run(n * 2 * sizeof(float), [&] {
+		Check(LIBSAKURA_SYMBOL(Convolve1DFFTFloat)(context, n, data.data(),
+						output.data()));
+	});
+}
+
+void BenchConvolve1DFFTBatch(State &state) {
+	size_t const n = state.num_elements();
+	size_t const kNumSpectra = 8;
+	size_t const num_data = n / kNumSpectra;
+	Array<float> kernel(num_data);
+	Array<float> data(n);
+	Array<float> output(n);
+	Check(LIBSAKURA_SYMBOL(CreateGaussianKernelFloat)(num_data / 2, 5.f,
+					num_data, kernel.data()));
+	FillRandom(data, -1., 1.);
+	LIBSAKURA_SYMBOL(Convolve1DContextFloat) *context = nullptr;
+	Check(LIBSAKURA_SYMBOL(CreateConvolve1DContextFFTBatchFloat)(num_data,
+					kernel.data(), kNumSpectra,
+					LIBSAKURA_SYMBOL(FFTPrecision_kSingle), &context));
+	ConvolveContext guard(context,
+			LIBSAKURA_SYMBOL(DestroyConvolve1DContextFloat));
+	state.Run(n * 2 * sizeof(float), [&] {
+		Check(LIBSAKURA_SYMBOL(Convolve1DFFTBatchFloat)(context, kNumSpectra,
+						num_data, data.data(), output.data()));
+	});
+}
+
+/*
+ * interpolation
+ *
+ * Along X axis, a spectrum of n channels is resampled at shifted channels.
+ * Along Y axis, n / 64 channels of 64 spectra are interpolated.
+ */
+constexpr size_t kNumRows = 64;
+
+void SetPositions(Array<double> const &base_position,
+		Array<double> const &interpolated_position) {
+	for (size_t i = 0; i < base_position.size(); ++i) {
+		base_position[i] = static_cast<double>(i);
+	}
+	for (size_t i = 0; i < interpolated_position.size(); ++i) {
+		interpolated_position[i] = i * (base_position.size() - 1.)
+				/ interpolated_position.size() + 0.25;
+	}
+}
+
+template<Status (*Func)(LIBSAKURA_SYMBOL(InterpolationMethod), uint8_t,
+		size_t, double const[], size_t, float const[], bool const[], size_t,
+		double const[], float[], bool[]),
+		LIBSAKURA_SYMBOL(InterpolationMethod) kMethod, bool kXAxis>
+void BenchInterpolate(State &state) {
+	size_t const n = state.num_elements();
+	size_t const num_base = kXAxis ? n : kNumRows;
+	size_t const num_array = n / num_base;
+	Array<double> base_position(num_base);
+	Array<double> interpolated_position(num_base);
+	Array<float> base_data(n);
+	Array<bool> base_mask(n);
+	Array<float> interpolated_data(n);
+	Array<bool> interpolated_mask(n);
+	SetPositions(base_position, interpolated_position);
+	FillRandom(base_data, -1., 1.);
+	Fill(base_mask, true);
+	state.Run(n * 2 * (sizeof(float) + sizeof(bool)), [&] {
+		Check(Func(kMethod, 2, num_base, base_position.data(), num_array,
+						base_data.data(), base_mask.data(), num_base,
+						interpolated_position.data(), interpolated_data.data(),
+						interpolated_mask.data()));
+	});
+}
+
+void BenchCreateInterpolationPlan(State &state) {
+	size_t const n = state.num_elements();
+	Array<double> base_position(n);
+	Array<double> interpolated_position(n);
+	SetPositions(base_position, interpolated_position);
+	state.Run(n * 2 * sizeof(double), [&] {
+		LIBSAKURA_SYMBOL(InterpolationPlanFloat) *plan = nullptr;
+		Check(LIBSAKURA_SYMBOL(CreateInterpolationPlanFloat)(
+						LIBSAKURA_SYMBOL(InterpolationMethod_kSpline), 2, n,
+						base_position.data(), n, interpolated_position.data(),
+						&plan));
+		Check(LIBSAKURA_SYMBOL(DestroyInterpolationPlanFloat)(plan));
+	});
+}
+
+template<Status (*Func)(LIBSAKURA_SYMBOL(InterpolationPlanFloat) *, size_t,
+		float const[], bool const[], float[], bool[]), bool kXAxis>
+void BenchExecuteInterpolationPlan(State &state) {
+	size_t const n = state.num_elements();
+	size_t const num_base = kXAxis ? n : kNumRows;
+	size_t const num_array = n / num_base;
+	Array<double> base_position(num_base);
+	Array<double> interpolated_position(num_base);
+	Array<float> base_data(n);
+	Array<bool> base_mask(n);
+	Array<float> interpolated_data(n);
+	Array<bool> interpolated_mask(n);
+	SetPositions(base_position, interpolated_position);
+	FillRandom(base_data, -1., 1.);
+	Fill(base_mask, true);
+	LIBSAKURA_SYMBOL(InterpolationPlanFloat) *plan = nullptr;
+	Check(LIBSAKURA_SYMBOL(CreateInterpolationPlanFloat)(
+					LIBSAKURA_SYMBOL(InterpolationMethod_kSpline), 2, num_base,
+					base_position.data(), num_base,
+					interpolated_position.data(), &plan));
+	std::unique_ptr<LIBSAKURA_SYMBOL(InterpolationPlanFloat),
+			decltype(&LIBSAKURA_SYMBOL(DestroyInterpolationPlanFloat))> guard(
+			plan, LIBSAKURA_SYMBOL(DestroyInterpolationPlanFloat));
+	state.Run(n * 2 * (sizeof(float) + sizeof(bool)), [&] {
+		Check(Func(plan, num_array, base_data.data(), base_mask.data(),
+						interpolated_data.data(), interpolated_mask.data()));
+	});
+}
+
+/*
+ * least-square fitting
+ *
+ * Data are a cubic polynomial plus noise.
+ */
+typedef std::unique_ptr<LIBSAKURA_SYMBOL(LSQFitContextFloat),
+		decltype(&LIBSAKURA_SYMBOL(DestroyLSQFitContextFloat))> LSQFitContext;
+
+constexpr uint16_t kOrder = 3;
+constexpr size_t kNumPieces = 4;
+constexpr size_t kNumWaves = 4; // 0, 1, 2 and 3
+constexpr size_t kNumSinusoidCoeff = 2 * kNumWaves - 1;
+constexpr float kClipThreshold = 5.f;
+constexpr uint16_t kNumFittingMax = 2;
+
+void FillBaseline(Array<float> const &data) {
+	FillRandom(data, -0.1, 0.1);
+	size_t const n = data.size();
+	for (size_t i = 0; i < n; ++i) {
+		double const x = 2. * i / n - 1.;
+		data[i] += static_cast<float>(1. + x * (0.5 + x * (0.25 - x)));
+	}
+}
+
+LSQFitContext CreatePolynomialContext(size_t num_data) {
+	LIBSAKURA_SYMBOL(LSQFitContextFloat) *context = nullptr;
+	Check(LIBSAKURA_SYMBOL(CreateLSQFitContextPolynomialFloat)(
+					LIBSAKURA_SYMBOL(LSQFitType_kPolynomial), kOrder, num_data,
+					&context));
+	return LSQFitContext(context, LIBSAKURA_SYMBOL(DestroyLSQFitContextFloat));
+}
+
+LSQFitContext CreateCubicSplineContext(size_t num_data) {
+	LIBSAKURA_SYMBOL(LSQFitContextFloat) *context = nullptr;
+	Check(LIBSAKURA_SYMBOL(CreateLSQFitContextCubicSplineFloat)(kNumPieces,
+					num_data, &context));
+	return LSQFitContext(context, LIBSAKURA_SYMBOL(DestroyLSQFitContextFloat));
+}
+
+LSQFitContext CreateSinusoidContext(size_t num_data) {
+	LIBSAKURA_SYMBOL(LSQFitContextFloat) *context = nullptr;
+	Check(LIBSAKURA_SYMBOL(CreateLSQFitContextSinusoidFloat)(kNumWaves - 1,
+					num_data, &context));
+	return LSQFitContext(context, LIBSAKURA_SYMBOL(DestroyLSQFitContextFloat));
+}
+
+void BenchCreateLSQFitContextPolynomial(State &state) {
+	size_t const n = state.num_elements();
+	state.Run(n * (kOrder + 1) * sizeof(double), [&] {
+		CreatePolynomialContext(n);
+	});
+}
+
+void BenchCreateLSQFitContextCubicSpline(State &state) {
+	size_t const n = state.num_elements();
+	state.Run(n * (kNumPieces + 3) * sizeof(double), [&] {
+		CreateCubicSplineContext(n);
+	});
+}
+
+void BenchCreateLSQFitContextSinusoid(State &state) {
+	size_t const n = state.num_elements();
+	state.Run(n * kNumSinusoidCoeff * sizeof(double), [&] {
+		CreateSinusoidContext(n);
+	});
+}
+
+void BenchGetNumberOfCoefficients(State &state) {
+	auto context = CreatePolynomialContext(state.num_elements());
+	size_t num_coeff = 0;
+	state.Run(0, [&] {
+		Check(LIBSAKURA_SYMBOL(GetNumberOfCoefficientsFloat)(context.get(),
+						kOrder, &num_coeff));
+	});
+}
+
+/*
+ * Arrays passed to the LSQ fitting functions.
+ */
+struct FitArrays {
+	explicit FitArrays(size_t n) :
+			data(n), mask(n), best_fit(n), residual(n), final_mask(n), out(n) {
+		FillBaseline(data);
+		FillMask(mask);
+	}
+	// input, mask, best fit, residual and final mask
+	static uint64_t BytesPerFit(size_t n) {
+		return n * (3 * sizeof(float) + 2 * sizeof(bool));
+	}
+	Array<float> data;
+	Array<bool> mask;
+	Array<float> best_fit;
+	Array<float> residual;
+	Array<bool> final_mask;
+	Array<float> out;
+	float rms = 0.f;
+	LIBSAKURA_SYMBOL(LSQFitStatus) lsqfit_status = LIBSAKURA_SYMBOL(
+			LSQFitStatus_kOK);
+};
+
+void BenchLSQFitPolynomial(State &state) {
+	size_t const n = state.num_elements();
+	auto context = CreatePolynomialContext(n);
+	FitArrays arrays(n);
+	alignas(kAlignment) double coeff[kOrder + 1];
+	state.Run(FitArrays::BytesPerFit(n), [&] {
+		Check(LIBSAKURA_SYMBOL(LSQFitPolynomialFloat)(context.get(), kOrder, n,
+						arrays.data.data(), arrays.mask.data(), kClipThreshold,
+						kNumFittingMax, kOrder + 1, coeff, arrays.best_fit.data(),
+						arrays.residual.data(), arrays.final_mask.data(),
+						&arrays.rms, &arrays.lsqfit_status));
+	});
+}
+
+void BenchLSQFitPolynomialBatch(State &state) {
+	size_t const n = state.num_elements();
+	size_t const kNumSpectra = 8;
+	size_t const num_data = n / kNumSpectra;
+	auto context = CreatePolynomialContext(num_data);
+	FitArrays arrays(n);
+	Array<double> coeff(kNumSpectra * (kOrder + 1));
+	Array<float> rms(kNumSpectra);
+	std::vector<LIBSAKURA_SYMBOL(LSQFitStatus)> lsqfit_status(kNumSpectra);
+	state.Run(n * (3 * sizeof(float) + sizeof(bool)), [&] {
+		Check(LIBSAKURA_SYMBOL(LSQFitPolynomialBatchFloat)(context.get(), kOrder,
+						kNumSpectra, num_data, arrays.data.data(),
+						arrays.mask.data(), kOrder + 1, coeff.data(),
+						arrays.best_fit.data(), arrays.residual.data(), rms.data(),
+						1, lsqfit_status.data()));
+	});
+}
+
+void BenchLSQFitCubicSpline(State &state) {
+	size_t const n = state.num_elements();
+	auto context = CreateCubicSplineContext(n);
+	FitArrays arrays(n);
+	alignas(kAlignment) double coeff[kNumPieces][4];
+	alignas(kAlignment) size_t boundary[kNumPieces + 1];
+	state.Run(FitArrays::BytesPerFit(n), [&] {
+		Check(LIBSAKURA_SYMBOL(LSQFitCubicSplineFloat)(context.get(), kNumPieces,
+						n, arrays.data.data(), arrays.mask.data(), kClipThreshold,
+						kNumFittingMax, coeff, arrays.best_fit.data(),
+						arrays.residual.data(), arrays.final_mask.data(),
+						&arrays.rms, boundary, &arrays.lsqfit_status));
+	});
+}
+
+size_t const kWaves[kNumWaves] = { 0, 1, 2, 3 };
+
+void BenchLSQFitSinusoid(State &state) {
+	size_t const n = state.num_elements();
+	auto context = CreateSinusoidContext(n);
+	FitArrays arrays(n);
+	alignas(kAlignment) double coeff[kNumSinusoidCoeff];
+	state.Run(FitArrays::BytesPerFit(n), [&] {
+		Check(LIBSAKURA_SYMBOL(LSQFitSinusoidFloat)(context.get(), kNumWaves,
+						kWaves, n, arrays.data.data(), arrays.mask.data(),
+						kClipThreshold, kNumFittingMax, kNumSinusoidCoeff, coeff,
+						arrays.best_fit.data(), arrays.residual.data(),
+						arrays.final_mask.data(), &arrays.rms,
+						&arrays.lsqfit_status));
+	});
+}
+
+void BenchSubtractPolynomial(State &state) {
+	size_t const n = state.num_elements();
+	auto context = CreatePolynomialContext(n);
+	FitArrays arrays(n);
+	alignas(kAlignment) double const coeff[kOrder + 1] = { 1., 0.5, 0.25, -1. };
+	state.Run(n * 2 * sizeof(float), [&] {
+		Check(LIBSAKURA_SYMBOL(SubtractPolynomialFloat)(context.get(), n,
+						arrays.data.data(), kOrder + 1, coeff,
+						arrays.out.data()));
+	});
+}
+
+void BenchSubtractCubicSpline(State &state) {
+	size_t const n = state.num_elements();
+	auto context = CreateCubicSplineContext(n);
+	FitArrays arrays(n);
+	alignas(kAlignment) double coeff[kNumPieces][4];
+	alignas(kAlignment) size_t boundary[kNumPieces + 1];
+	Check(LIBSAKURA_SYMBOL(LSQFitCubicSplineFloat)(context.get(), kNumPieces, n,
+					arrays.data.data(), arrays.mask.data(), kClipThreshold,
+					kNumFittingMax, coeff, nullptr, nullptr,
+					arrays.final_mask.data(), &arrays.rms, boundary,
+					&arrays.lsqfit_status));
+	state.Run(n * 2 * sizeof(float), [&] {
+		Check(LIBSAKURA_SYMBOL(SubtractCubicSplineFloat)(context.get(), n,
+						arrays.data.data(), kNumPieces, coeff, boundary,
+						arrays.out.data()));
+	});
+}
+
+void BenchSubtractSinusoid(State &state) {
+	size_t const n = state.num_elements();
+	auto context = CreateSinusoidContext(n);
+	FitArrays arrays(n);
+	alignas(kAlignment) double const coeff[kNumSinusoidCoeff] = { 1., 0.5, 0.5, 0.25, 0.25, 0.1,
+			0.1 };
+	state.Run(n * 2 * sizeof(float), [&] {
+		Check(LIBSAKURA_SYMBOL(SubtractSinusoidFloat)(context.get(), n,
+						arrays.data.data(), kNumWaves, kWaves, kNumSinusoidCoeff,
+						coeff, arrays.out.data()));
+	});
+}
+
+/*
+ * Polynomial basis of [num_data][kNumBases] for the low level LSQ functions.
+ */
+constexpr size_t kNumBases = kOrder + 1;
+size_t const kUseBasesIndex[kNumBases] = { 0, 1, 2, 3 };
+
+void FillBasis(Array<double> const &basis) {
+	size_t const n = basis.size() / kNumBases;
+	for (size_t i = 0; i < n; ++i) {
+		double const x = 2. * i / n - 1.;
+		double value = 1.;
+		for (size_t j = 0; j < kNumBases; ++j) {
+			basis[i * kNumBases + j] = value;
+			value *= x;
+		}
+	}
+}
+
+void BenchGetLSQCoefficients(State &state) {
+	size_t const n = state.num_elements();
+	Array<float> data(n);
+	Array<bool> mask(n);
+	Array<double> basis(n * kNumBases);
+	Array<double> lsq_matrix(kNumBases * kNumBases);
+	Array<double> lsq_vector(kNumBases);
+	FillBaseline(data);
+	FillMask(mask);
+	FillBasis(basis);
+	state.Run(n * (sizeof(float) + sizeof(bool) + kNumBases * sizeof(double)),
+			[&] {
+				Check(LIBSAKURA_SYMBOL(GetLSQCoefficientsDouble)(n, data.data(),
+								mask.data(), kNumBases, basis.data(), kNumBases,
+								kUseBasesIndex, lsq_matrix.data(),
+								lsq_vector.data()));
+			});
+}
+
+/*
+ * 1% of data are excluded from the coefficients of all data.
+ */
+void BenchUpdateLSQCoefficients(State &state) {
+	size_t const n = state.num_elements();
+	Array<float> data(n);
+	Array<bool> mask(n);
+	Array<double> basis(n * kNumBases);
+	Array<double> lsq_matrix(kNumBases * kNumBases);
+	Array<double> lsq_vector(kNumBases);
+	Array<double> updated_matrix(kNumBases * kNumBases);
+	Array<double> updated_vector(kNumBases);
+	FillBaseline(data);
+	Fill(mask, true);
+	FillBasis(basis);
+	Check(LIBSAKURA_SYMBOL(GetLSQCoefficientsDouble)(n, data.data(),
+					mask.data(), kNumBases, basis.data(), kNumBases,
+					kUseBasesIndex, lsq_matrix.data(), lsq_vector.data()));
+	size_t const num_exclude = std::max(n / 100, static_cast<size_t>(1));
+	Array<size_t> exclude_indices(num_exclude);
+	for (size_t i = 0; i < num_exclude; ++i) {
+		exclude_indices[i] = i * (n / num_exclude);
+		mask[exclude_indices[i]] = false;
+	}
+	state.Run(
+			num_exclude
+					* (sizeof(float) + sizeof(size_t)
+							+ kNumBases * sizeof(double)), [&] {
+				std::copy(lsq_matrix.data(), lsq_matrix.data() + lsq_matrix.size(),
+						updated_matrix.data());
+				std::copy(lsq_vector.data(), lsq_vector.data() + lsq_vector.size(),
+						updated_vector.data());
+				Check(LIBSAKURA_SYMBOL(UpdateLSQCoefficientsDouble)(n, data.data(),
+								mask.data(), num_exclude, exclude_indices.data(),
+								kNumBases, basis.data(), kNumBases, kUseBasesIndex,
+								updated_matrix.data(), updated_vector.data()));
+			});
+}
+
+/*
+ * n is the number of elements of the matrix.
+ */
+void BenchSolveSimultaneousEquationsByLU(State &state) {
+	size_t const num_equations = static_cast<size_t>(std::sqrt(
+			static_cast<double>(state.num_elements())));
+	Array<double> matrix(num_equations * num_equations);
+	Array<double> vector(num_equations);
+	Array<double> out(num_equations);
+	FillRandom(matrix, -1., 1.);
+	FillRandom(vector, -1., 1.);
+	for (size_t i = 0; i < num_equations; ++i) {
+		matrix[i * num_equations + i] += num_equations;
+	}
+	state.Run(matrix.size() * sizeof(double), [&] {
+		Check(LIBSAKURA_SYMBOL(SolveSimultaneousEquationsByLUDouble)(
+						num_equations, matrix.data(), vector.data(), out.data()));
+	});
+}
+
+void BenchLMFitGaussian(State &state) {
+	size_t const n = state.num_elements();
+	Array<float> data(n);
+	Array<bool> mask(n);
+	FillRandom(data, -0.1, 0.1);
+	Fill(mask, true);
+	double const kCenter = n * 0.4;
+	double const kSigma = n * 0.05;
+	for (size_t i = 0; i < n; ++i) {
+		double const x = (i - kCenter) / kSigma;
+		data[i] += static_cast<float>(2. * std::exp(-0.5 * x * x));
+	}
+	state.Run(n * (sizeof(float) + sizeof(bool)), [&] {
+		double height = 1.5;
+		double center = kCenter * 1.1;
+		double sigma = kSigma * 0.8;
+		double err_height;
+		double err_center;
+		double err_sigma;
+		Check(LIBSAKURA_SYMBOL(LMFitGaussianFloat)(n, data.data(), mask.data(),
+						1, &height, &err_height, &center, &err_center, &sigma,
+						&err_sigma));
+	});
+}
+
+/*
+ * gridding
+ *
+ * n values of kNumPolarizations x kNumChannels per spectrum are gridded
+ * on kGridSize x kGridSize pixels.
+ */
+void BenchGridConvolving(State &state, size_t num_threads) {
+	constexpr size_t kNumPolarizations = 2;
+	constexpr size_t kNumChannels = 64;
+	constexpr size_t kGridSize = 128;
+	constexpr size_t kSupport = 3;
+	constexpr size_t kSampling = 100;
+	size_t const num_spectra = std::max(
+			state.num_elements() / (kNumPolarizations * kNumChannels),
+			static_cast<size_t>(1));
+	size_t const num_values = num_spectra * kNumPolarizations * kNumChannels;
+	size_t const num_table = static_cast<size_t>(std::ceil(
+			std::sqrt(2.) * (kSupport + 1) * kSampling));
+	size_t const num_grid = kGridSize * kGridSize * kNumPolarizations
+			* kNumChannels;
+	Array<bool> spectrum_mask(num_spectra);
+	Array<double> x(num_spectra);
+	Array<double> y(num_spectra);
+	Array<uint32_t> polarization_map(kNumPolarizations);
+	Array<uint32_t> channel_map(kNumChannels);
+	Array<bool> mask(num_values);
+	Array<float> value(num_values);
+	Array<float> weight(num_spectra * kNumChannels);
+	Array<float> table(num_table);
+	Array<double> weight_sum(kNumPolarizations * kNumChannels);
+	Array<float> weight_of_grid(num_grid);
+	Array<float> grid(num_grid);
+	Fill(spectrum_mask, true);
+	FillRandom(x, 2. * kSupport, kGridSize - 2. * kSupport);
+	FillRandom(y, 2. * kSupport, kGridSize - 2. * kSupport);
+	for (size_t i = 0; i < kNumPolarizations; ++i) {
+		polarization_map[i] = static_cast<uint32_t>(i);
+	}
+	for (size_t i = 0; i < kNumChannels; ++i) {
+		channel_map[i] = static_cast<uint32_t>(i);
+	}
+	FillMask(mask);
+	FillRandom(value, -1., 1.);
+	FillRandom(weight, 0.5, 1.);
+	for (size_t i = 0; i < num_table; ++i) {
+		double const r = 2. * i / num_table;
+		table[i] = static_cast<float>(std::exp(-r * r));
+	}
+	std::fill(weight_sum.data(), weight_sum.data() + weight_sum.size(), 0.);
+	std::fill(weight_of_grid.data(), weight_of_grid.data() + num_grid, 0.f);
+	std::fill(grid.data(), grid.data() + num_grid, 0.f);
+	state.Run(num_values * (sizeof(float) + sizeof(bool)) + weight.size() * sizeof(float), [&] {
+		if (num_threads == 0) {
+			Check(LIBSAKURA_SYMBOL(GridConvolvingFloat)(num_spectra, 0,
+							num_spectra, spectrum_mask.data(), x.data(), y.data(),
+							kSupport, kSampling, kNumPolarizations,
+							polarization_map.data(), kNumChannels,
+							channel_map.data(), mask.data(), value.data(),
+							weight.data(), false, num_table, table.data(),
+							kNumPolarizations, kNumChannels, kGridSize, kGridSize,
+							weight_sum.data(), weight_of_grid.data(), grid.data()));
+		} else {
+			Check(LIBSAKURA_SYMBOL(GridConvolvingParallelFloat)(num_spectra, 0,
+							num_spectra, spectrum_mask.data(), x.data(), y.data(),
+							kSupport, kSampling, kNumPolarizations,
+							polarization_map.data(), kNumChannels,
+							channel_map.data(), mask.data(), value.data(),
+							weight.data(), false, num_table, table.data(),
+							kNumPolarizations, kNumChannels, kGridSize, kGridSize,
+							num_threads, weight_sum.data(), weight_of_grid.data(),
+							grid.data()));
+		}
+	});
+}
+
+void BenchGridConvolvingSerial(State &state) {
+	BenchGridConvolving(state, 0);
+}
+
+void BenchGridConvolvingParallel(State &state) {
+	BenchGridConvolving(state,
+			std::max(std::thread::hardware_concurrency(), 1u));
+}
+
+/*
+ * array flipping of [n / 64][64] elements
+ */
+template<typename T, Status (*Func)(bool, size_t, size_t const[],
+		T const[], T[])>
+void BenchFlip(State &state) {
+	size_t const n = state.num_elements();
+	size_t const elements[] = { kNumRows, n / kNumRows };
+	Array<T> src(n);
+	Array<T> dst(n);
+	FillRandom(src, -1., 1.);
+	state.Run(n * 2 * sizeof(T), [&] {
+		Check(Func(false, 2, elements, src.data(), dst.data()));
+	});
+}
+
+template<Status (*Func)(bool, size_t, size_t const[], double const[][2],
+		double[][2])>
+void BenchFlipDouble2(State &state) {
+	size_t const n = state.num_elements();
+	size_t const elements[] = { kNumRows, n / kNumRows };
+	Array<double> src(2 * n);
+	Array<double> dst(2 * n);
+	FillRandom(src, -1., 1.);
+	state.Run(n * 4 * sizeof(double), [&] {
+		Check(Func(false, 2, elements,
+						reinterpret_cast<double const (*)[2]>(src.data()),
+						reinterpret_cast<double (*)[2]>(dst.data())));
+	});
+}
+
+void BenchCreateMaskNearEdge(State &state) {
+	size_t const n = state.num_elements();
+	Array<double> x(n);
+	Array<double> y(n);
+	Array<bool> mask(n);
+	FillRandom(x, -1., 1.);
+	FillRandom(y, -1., 1.);
+	std::reverse(y.data(), y.data() + n);
+	state.Run(n * (2 * sizeof(double) + sizeof(bool)), [&] {
+		Check(LIBSAKURA_SYMBOL(CreateMaskNearEdgeDouble)(0.1f, 0., n, x.data(),
+						y.data(), nullptr, nullptr, nullptr, nullptr, mask.data()));
+	});
+}
+
+/*
+ * flag to mask, NaN/Inf masking, calibration, smoothing and statistics
+ */
+void BenchExecuteReductionPipeline(State &state) {
+	size_t const n = state.num_elements();
+	size_t const kNumKernel = 25;
+	Array<float> scaling_factor(n);
+	Array<float> kernel(kNumKernel);
+	Array<float> data(n);
+	Array<uint8_t> flag(n);
+	Array<float> reference(n);
+	Array<float> output(n);
+	Array<bool> output_mask(n);
+	FillRandom(scaling_factor, 100., 200.);
+	Check(LIBSAKURA_SYMBOL(CreateGaussianKernelFloat)(kNumKernel / 2, 5.f,
+					kNumKernel, kernel.data()));
+	FillRandom(data, 1., 2.);
+	FillRandom(flag, 0., 1.02);
+	FillRandom(reference, 1., 2.);
+	constexpr size_t kNumStages = 5;
+	LIBSAKURA_SYMBOL(ReductionStageFloat) stages[kNumStages] = { };
+	stages[0].type = LIBSAKURA_SYMBOL(ReductionStageType_kFlagToMask);
+	stages[1].type = LIBSAKURA_SYMBOL(ReductionStageType_kMaskNanOrInf);
+	stages[2].type = LIBSAKURA_SYMBOL(ReductionStageType_kCalibrate);
+	stages[2].num_scaling_factor = n;
+	stages[2].scaling_factor = scaling_factor.data();
+	stages[3].type = LIBSAKURA_SYMBOL(ReductionStageType_kSmooth);
+	stages[3].num_kernel = kNumKernel;
+	stages[3].kernel = kernel.data();
+	stages[4].type = LIBSAKURA_SYMBOL(ReductionStageType_kStatistics);
+	LIBSAKURA_SYMBOL(ReductionPipelineFloat) *pipeline = nullptr;
+	Check(LIBSAKURA_SYMBOL(CreateReductionPipelineFloat)(kNumStages,
+					stages, n, &pipeline));
+	std::unique_ptr<LIBSAKURA_SYMBOL(ReductionPipelineFloat),
+			decltype(&LIBSAKURA_SYMBOL(DestroyReductionPipelineFloat))> guard(
+			pipeline, LIBSAKURA_SYMBOL(DestroyReductionPipelineFloat));
+	LIBSAKURA_SYMBOL(StatisticsResultFloat) statistics;
+	state.Run(n * (4 * sizeof(float) + sizeof(uint8_t) + sizeof(bool)), [&] {
+		Check(LIBSAKURA_SYMBOL(ExecuteReductionPipelineFloat)(pipeline, n,
+						data.data(), flag.data(), nullptr, reference.data(),
+						output.data(), output_mask.data(), &statistics, nullptr));
+	});
+}
+
+#define BENCH_STATISTICS(name) \
+	{ #name, kUnlimited, BenchStatistics<LIBSAKURA_SYMBOL(name)> }
+#define BENCH_COMPARE(type, name) \
+	{ #name, kUnlimited, BenchCompare<type, LIBSAKURA_SYMBOL(name)> }
+#define BENCH_IN_RANGES(type, name) \
+	{ #name, kUnlimited, BenchInRanges<type, LIBSAKURA_SYMBOL(name)> }
+#define BENCH_BITWISE(type, name) \
+	{ #name, kUnlimited, BenchBitwise<type, LIBSAKURA_SYMBOL(name)> }
+#define BENCH_FLIP(type, name) \
+	{ #name, kUnlimited, BenchFlip<type, LIBSAKURA_SYMBOL(name)> }
+
+Benchmark const kBenchmarks[] = {
+		BENCH_STATISTICS(ComputeStatisticsFloat),
+		BENCH_STATISTICS(ComputeAccurateStatisticsFloat),
+		{ "ComputeMeanAndStddevFloat", kUnlimited, BenchComputeMeanAndStddev },
+		{ "ComputeAccurateStatisticsParallelFloat", kUnlimited,
+				BenchComputeAccurateStatisticsParallel },
+		{ "ComputeStatisticsBatchFloat", kUnlimited,
+				BenchComputeStatisticsBatch },
+		{ "UpdateStatisticsAccumulatorFloat", kUnlimited,
+				BenchUpdateStatisticsAccumulator },
+		{ "SortValidValuesDenselyFloat", kUnlimited, BenchSortValidValuesDensely },
+		{ "ComputeMedianAbsoluteDeviationFloat", kUnlimited,
+				BenchComputeMedianAbsoluteDeviation },
+		{ "ComputeQuantilesFloat", kUnlimited, BenchComputeQuantiles },
+		{ "UpdateQuantileSketchFloat", kUnlimited, BenchUpdateQuantileSketch },
+		{ "ComputeMedianFloat", kUnlimited, BenchComputeMedian },
+		{ "ComputeMedianAndMedianAbsoluteDeviationFloat", kUnlimited,
+				BenchComputeMedianAndMedianAbsoluteDeviation },
+		BENCH_IN_RANGES(float, SetTrueIfInRangesInclusiveFloat),
+		BENCH_IN_RANGES(int, SetTrueIfInRangesInclusiveInt),
+		BENCH_IN_RANGES(float, SetTrueIfInRangesExclusiveFloat),
+		BENCH_IN_RANGES(int, SetTrueIfInRangesExclusiveInt),
+		BENCH_COMPARE(float, SetTrueIfGreaterThanFloat),
+		BENCH_COMPARE(int, SetTrueIfGreaterThanInt),
+		BENCH_COMPARE(float, SetTrueIfGreaterThanOrEqualsFloat),
+		BENCH_COMPARE(int, SetTrueIfGreaterThanOrEqualsInt),
+		BENCH_COMPARE(float, SetTrueIfLessThanFloat),
+		BENCH_COMPARE(int, SetTrueIfLessThanInt),
+		BENCH_COMPARE(float, SetTrueIfLessThanOrEqualsFloat),
+		BENCH_COMPARE(int, SetTrueIfLessThanOrEqualsInt),
+		{ "SetFalseIfNanOrInfFloat", kUnlimited, BenchSetFalseIfNanOrInf },
+		{ "Uint8ToBool", kUnlimited, BenchToBool<uint8_t,
+				LIBSAKURA_SYMBOL(Uint8ToBool)> },
+		{ "Uint32ToBool", kUnlimited, BenchToBool<uint32_t,
+				LIBSAKURA_SYMBOL(Uint32ToBool)> },
+		{ "InvertBool", kUnlimited, BenchInvertBool },
+		BENCH_BITWISE(uint8_t, OperateBitwiseAndUint8),
+		BENCH_BITWISE(uint32_t, OperateBitwiseAndUint32),
+		BENCH_BITWISE(uint8_t, OperateBitwiseConverseNonImplicationUint8),
+		BENCH_BITWISE(uint32_t, OperateBitwiseConverseNonImplicationUint32),
+		BENCH_BITWISE(uint8_t, OperateBitwiseImplicationUint8),
+		BENCH_BITWISE(uint32_t, OperateBitwiseImplicationUint32),
+		{ "OperateBitwiseNotUint8", kUnlimited, BenchBitwiseNot<uint8_t,
+				LIBSAKURA_SYMBOL(OperateBitwiseNotUint8)> },
+		{ "OperateBitwiseNotUint32", kUnlimited, BenchBitwiseNot<uint32_t,
+				LIBSAKURA_SYMBOL(OperateBitwiseNotUint32)> },
+		BENCH_BITWISE(uint8_t, OperateBitwiseOrUint8),
+		BENCH_BITWISE(uint32_t, OperateBitwiseOrUint32),
+		BENCH_BITWISE(uint8_t, OperateBitwiseXorUint8),
+		BENCH_BITWISE(uint32_t, OperateBitwiseXorUint32),
+		{ "CalibrateDataWithArrayScalingFloat", kUnlimited,
+				BenchCalibrateDataWithArrayScaling },
+		{ "CalibrateDataWithConstScalingFloat", kUnlimited,
+				BenchCalibrateDataWithConstScaling },
+		{ "CreateGaussianKernelFloat", kUnlimited, BenchCreateGaussianKernel },
+		{ "Convolve1DFloat", kUnlimited, BenchConvolve1D },
+		{ "Convolve1DFFTFloat", kUnlimited, BenchConvolve1DFFT },
+		{ "Convolve1DFFTBatchFloat", kUnlimited, BenchConvolve1DFFTBatch },
+		{ "InterpolateXAxisFloat/Linear", kUnlimited, BenchInterpolate<
+				LIBSAKURA_SYMBOL(InterpolateXAxisFloat),
+				LIBSAKURA_SYMBOL(InterpolationMethod_kLinear), true> },
+		{ "InterpolateXAxisFloat/Spline", kUnlimited, BenchInterpolate<
+				LIBSAKURA_SYMBOL(InterpolateXAxisFloat),
+				LIBSAKURA_SYMBOL(InterpolationMethod_kSpline), true> },
+		{ "InterpolateYAxisFloat/Linear", kUnlimited, BenchInterpolate<
+				LIBSAKURA_SYMBOL(InterpolateYAxisFloat),
+				LIBSAKURA_SYMBOL(InterpolationMethod_kLinear), false> },
+		{ "InterpolateYAxisFloat/Spline", kUnlimited, BenchInterpolate<
+				LIBSAKURA_SYMBOL(InterpolateYAxisFloat),
+				LIBSAKURA_SYMBOL(InterpolationMethod_kSpline), false> },
+		{ "CreateInterpolationPlanFloat", kUnlimited,
+				BenchCreateInterpolationPlan },
+		{ "ExecuteInterpolationPlanXAxisFloat", kUnlimited,
+				BenchExecuteInterpolationPlan<
+						LIBSAKURA_SYMBOL(ExecuteInterpolationPlanXAxisFloat), true> },
+		{ "ExecuteInterpolationPlanYAxisFloat", kUnlimited,
+				BenchExecuteInterpolationPlan<
+						LIBSAKURA_SYMBOL(ExecuteInterpolationPlanYAxisFloat), false> },
+		{ "CreateLSQFitContextPolynomialFloat", kUnlimited,
+				BenchCreateLSQFitContextPolynomial },
+		{ "CreateLSQFitContextCubicSplineFloat", kUnlimited,
+				BenchCreateLSQFitContextCubicSpline },
+		{ "CreateLSQFitContextSinusoidFloat", kUnlimited,
+				BenchCreateLSQFitContextSinusoid },
+		{ "GetNumberOfCoefficientsFloat", kUnlimited,
+				BenchGetNumberOfCoefficients },
+		{ "LSQFitPolynomialFloat", kUnlimited, BenchLSQFitPolynomial },
+		{ "LSQFitPolynomialBatchFloat", kUnlimited, BenchLSQFitPolynomialBatch },
+		{ "LSQFitCubicSplineFloat", kUnlimited, BenchLSQFitCubicSpline },
+		{ "LSQFitSinusoidFloat", kUnlimited, BenchLSQFitSinusoid },
+		{ "SubtractPolynomialFloat", kUnlimited, BenchSubtractPolynomial },
+		{ "SubtractCubicSplineFloat", kUnlimited, BenchSubtractCubicSpline },
+		{ "SubtractSinusoidFloat", kUnlimited, BenchSubtractSinusoid },
+		{ "GetLSQCoefficientsDouble", kUnlimited, BenchGetLSQCoefficients },
+		{ "UpdateLSQCoefficientsDouble", kUnlimited, BenchUpdateLSQCoefficients },
+		{ "SolveSimultaneousEquationsByLUDouble", 1 << 18,
+				BenchSolveSimultaneousEquationsByLU },
+		{ "LMFitGaussianFloat", 1 << 20, BenchLMFitGaussian },
+		{ "GridConvolvingFloat", 1 << 20, BenchGridConvolvingSerial },
+		{ "GridConvolvingParallelFloat", 1 << 20, BenchGridConvolvingParallel },
+		BENCH_FLIP(float, FlipArrayFloat),
+		BENCH_FLIP(float, UnflipArrayFloat),
+		BENCH_FLIP(double, FlipArrayDouble),
+		BENCH_FLIP(double, UnflipArrayDouble),
+		{ "FlipArrayDouble2", kUnlimited, BenchFlipDouble2<
+				LIBSAKURA_SYMBOL(FlipArrayDouble2)> },
+		{ "UnflipArrayDouble2", kUnlimited, BenchFlipDouble2<
+				LIBSAKURA_SYMBOL(UnflipArrayDouble2)> },
+		{ "CreateMaskNearEdgeDouble", kUnlimited, BenchCreateMaskNearEdge },
+		{ "ExecuteReductionPipelineFloat", kUnlimited,
+				BenchExecuteReductionPipeline }, };
+
+#undef BENCH_STATISTICS
+#undef BENCH_COMPARE
+#undef BENCH_IN_RANGES
+#undef BENCH_BITWISE
+#undef BENCH_FLIP
+
+/*
+ * Code paths to be measured. Only the path the library is built for is
+ * available unless it is built with SIMD_ARCH=DISPATCH.
+ */
+std::vector<std::string> GetDefaultPaths() {
+	std::vector<std::string> paths;
+#if defined(ARCH_DISPATCH)
+	// the same criteria as the dispatcher of Sakura Library
+	paths.push_back("Default");
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("avx") && __builtin_cpu_supports("popcnt")
+			&& __builtin_cpu_supports("sse4.2")) {
+		paths.push_back("SandyBridge");
+		if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")
+				&& __builtin_cpu_supports("bmi")
+				&& __builtin_cpu_supports("bmi2")) {
+			paths.push_back("Haswell");
+# if defined(ARCH_DISPATCH_AVX512)
+			if (__builtin_cpu_supports("avx512f")
+					&& __builtin_cpu_supports("avx512bw")
+					&& __builtin_cpu_supports("avx512vl")
+					&& __builtin_cpu_supports("avx512dq")) {
+				paths.push_back("SkylakeAvx512");
+			}
+# endif
+		}
+	}
+#else
+	paths.push_back(STRINGIFY(BENCH_SIMD_PATH));
+#endif
+	return paths;
+}
+
+std::vector<std::string> Split(std::string const &list) {
+	std::vector<std::string> items;
+	std::istringstream stream(list);
+	std::string item;
+	while (std::getline(stream, item, ',')) {
+		if (!item.empty()) {
+			items.push_back(item);
+		}
+	}
+	return items;
+}
+
+std::string EscapeJson(std::string const &text) {
+	std::string escaped;
+	for (char c : text) {
+		if (c == '"' || c == '\\') {
+			escaped.push_back('\\');
+		}
+		escaped.push_back(c);
+	}
+	return escaped;
+}
+
+void WriteJson(std::ostream &out, double min_time,
+		std::vector<Result> const &results) {
+	char date[64];
+	std::time_t const now = std::time(nullptr);
+	std::strftime(date, sizeof(date), "%Y-%m-%dT%H:%M:%S%z",
+			std::localtime(&now));
+	out << "{\n  \"context\": {\n";
+	out << "    \"date\": \"" << date << "\",\n";
+	out << "    \"library_version\": \"" << LIBSAKURA_VERSION_STRING << "\",\n";
+	out << "    \"simd_arch\": \"" << STRINGIFY(BENCH_SIMD_PATH) << "\",\n";
+	out << "    \"num_cpus\": " << std::thread::hardware_concurrency() << ",\n";
+	out << "    \"min_time\": " << min_time << "\n";
+	out << "  },\n  \"benchmarks\": [";
+	char const *separator = "\n";
+	for (auto const &result : results) {
+		double const ns_per_iteration = result.seconds_per_iteration * 1e9;
+		out << separator << "    {\"name\": \"" << EscapeJson(result.name)
+				<< "\", \"path\": \"" << EscapeJson(result.path)
+				<< "\", \"num_elements\": " << result.num_elements
+				<< ", \"iterations\": " << result.iterations
+				<< ", \"ns_per_iteration\": " << ns_per_iteration
+				<< ", \"ns_per_element\": "
+				<< ns_per_iteration / result.num_elements
+				<< ", \"bytes_per_second\": "
+				<< result.bytes_per_iteration / result.seconds_per_iteration
+				<< "}";
+		separator = ",\n";
+	}
+	out << "\n  ]\n}\n";
+}
+
+void PrintUsage(char const *program) {
+	std::cerr << "usage: " << program
+			<< " [--filter=SUBSTRING] [--sizes=N,N,...] [--min_time=SECONDS]"
+					" [--paths=NAME,NAME,...] [--json=FILE]" << std::endl;
+}
+
+} /* anonymous namespace */
+
+int main(int argc, char *argv[]) {
+	// 4 KiB (L1) to 32 MiB (DRAM) of float
+	std::vector<size_t> sizes = { 1 << 10, 1 << 14, 1 << 18, 1 << 23 };
+	std::vector<std::string> paths = GetDefaultPaths();
+	std::string filter;
+	std::string json_file;
+	double min_time = 0.1;
+	for (int i = 1; i < argc; ++i) {
+		std::string const arg = argv[i];
+		auto const equal = arg.find('=');
+		std::string const option = arg.substr(0, equal);
+		std::string const value =
+				equal == std::string::npos ? "" : arg.substr(equal + 1);
+		if (option == "--filter") {
+			filter = value;
+		} else if (option == "--sizes") {
+			sizes.clear();
+			for (auto const &size : Split(value)) {
+				sizes.push_back(std::stoul(size));
+			}
+		} else if (option == "--min_time") {
+			min_time = std::stod(value);
+		} else if (option == "--paths") {
+			paths = Split(value);
+		} else if (option == "--json") {
+			json_file = value;
+		} else {
+			PrintUsage(argv[0]);
+			return 1;
+		}
+	}
+
+	std::vector<Result> results;
+	bool failed = false;
+	std::printf("%-45s %-14s %10s %12s %10s %10s\n", "name", "path",
+			"elements", "ns/call", "ns/elem", "GB/s");
+	for (auto const &path : paths) {
+#if defined(ARCH_DISPATCH)
+		setenv("SAKURA_ARCH", path.c_str(), 1);
+#endif
+		if (LIBSAKURA_SYMBOL(Initialize)(nullptr, nullptr)
+				!= LIBSAKURA_SYMBOL(Status_kOK)) {
+			std::cerr << "failed to initialize Sakura Library" << std::endl;
+			return 1;
+		}
+		for (auto const &benchmark : kBenchmarks) {
+			if (std::string(benchmark.name).find(filter) == std::string::npos) {
+				continue;
+			}
+			for (size_t size : sizes) {
+				if (size > benchmark.max_elements) {
+					continue;
+				}
+				State state(size, min_time);
+				try {
+					benchmark.func(state);
+				} catch (std::exception const &e) {
+					std::printf("%-45s %-14s %10zu %s\n", benchmark.name,
+							path.c_str(), size, e.what());
+					failed = true;
+					continue;
+				}
+				Result const result = { benchmark.name, path, size,
+						state.iterations(), state.seconds_per_iteration(),
+						state.bytes_per_iteration() };
+				std::printf("%-45s %-14s %10zu %12.1f %10.3f %10.2f\n",
+						benchmark.name, path.c_str(), size,
+						result.seconds_per_iteration * 1e9,
+						result.seconds_per_iteration * 1e9 / size,
+						result.bytes_per_iteration / result.seconds_per_iteration
+								* 1e-9);
+				std::fflush(stdout);
+				results.push_back(result);
+			}
+		}
+		LIBSAKURA_SYMBOL(CleanUp)();
+	}
+
+	if (!json_file.empty()) {
+		std::ofstream out(json_file);
+		WriteJson(out, min_time, results);
+		if (!out) {
+			std::cerr << "failed to write " << json_file << std::endl;
+			return 1;
+		}
+	}
+	return failed ? 1 : 0;
+}
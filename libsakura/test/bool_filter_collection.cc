@@ -326,9 +326,10 @@ protected:
 	 * Actual test definitions
 	 */
 	void RunRangesVariousLengthTest() {
-		size_t const array_length[] = { 5, NUM_IN, 11, 16, 0 };
+		// 37 covers more than two full 16-element blocks plus a remainder
+		size_t const array_length[] = { 5, NUM_IN, 11, 16, 37, 0 };
 		size_t const num_test(ELEMENTSOF(array_length));
-		size_t const num_max(16);
+		size_t const num_max(37);
 		//num_max = max(array_length);
 		SIMD_ALIGN
 		DataType data[num_max];
@@ -346,7 +347,7 @@ protected:
 			RunRangesTest(num_data, data, num_range, lower, upper, result,
 					ELEMENTSOF(RangesTestCase), RangesTestCase,
 					LIBSAKURA_SYMBOL(Status_kOK), true,
-					num_data == num_max ? MAX_NUM_RANGE + 1 : 1);
+					num_data >= 16 ? MAX_NUM_RANGE + 1 : 1);
 		}
 	}
 
@@ -0,0 +1,513 @@
+/*
+ * @SAKURA_LICENSE_HEADER_START@
+ * Copyright (C) 2013-2022
+ * Inter-University Research Institute Corporation, National Institutes of Natural Sciences
+ * 2-21-1, Osawa, Mitaka, Tokyo, 181-8588, Japan.
+ *
+ * This file is part of Sakura.
+ *
+ * Sakura is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or (at your
+ * option) any later version.
+ *
+ * Sakura is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public
+ * License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Sakura.  If not, see <http://www.gnu.org/licenses/>.
+ * @SAKURA_LICENSE_HEADER_END@
+ */
+/*
+ * concurrent.cc
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include <libsakura/concurrent.h>
+#include "gtest/gtest.h"
+#include "testutil.h"
+
+namespace {
+
+/*
+ * Sums up [begin, end) by splitting it into tasks recursively
+ */
+void SumRecursively(concurrent::ThreadPool *pool, uint64_t begin,
+		uint64_t end, std::atomic<uint64_t> *sum) {
+	if (end - begin <= 16) {
+		uint64_t partial = 0;
+		for (uint64_t i = begin; i < end; ++i) {
+			partial += i;
+		}
+		*sum += partial;
+		return;
+	}
+	uint64_t const middle = begin + (end - begin) / 2;
+	pool->Submit([=]() {SumRecursively(pool, begin, middle, sum);});
+	SumRecursively(pool, middle, end, sum);
+}
+
+/*
+ * Something to be computed by a consumer
+ */
+double Compute(uint64_t seed, size_t num_iterations) {
+	double value = static_cast<double>(seed);
+	for (size_t i = 0; i < num_iterations; ++i) {
+		value = std::sqrt(value + 1.);
+	}
+	return value;
+}
+
+struct BrokerContext {
+	static size_t const kNumSlots = 4;
+	size_t num_products;
+	size_t num_produced;
+	size_t num_consumed;
+	size_t slots[kNumSlots];
+	size_t throw_at;
+	bool error;
+};
+
+class BrokerException: public concurrent::PCException {
+};
+
+bool ProduceForBroker(void *context) {
+	auto ctx = static_cast<BrokerContext *>(context);
+	if (ctx->num_produced == ctx->num_products) {
+		return false;
+	}
+	if (ctx->num_produced == ctx->throw_at) {
+		throw BrokerException();
+	}
+	ctx->slots[ctx->num_produced % BrokerContext::kNumSlots] =
+			ctx->num_produced;
+	++ctx->num_produced;
+	return true;
+}
+
+void ConsumeForBroker(void *context) {
+	auto ctx = static_cast<BrokerContext *>(context);
+	if (ctx->slots[ctx->num_consumed % BrokerContext::kNumSlots]
+			!= ctx->num_consumed) {
+		ctx->error = true;
+	}
+	++ctx->num_consumed;
+}
+
+template<class RingBuffer>
+void TestTryPutAndTryGet() {
+	RingBuffer buffer;
+	size_t const size = buffer.Size();
+	uint64_t value = 0;
+	uint64_t next_get = 0;
+	uint64_t next_put = 0;
+	for (size_t round = 0; round < 5; ++round) {
+		EXPECT_FALSE(buffer.TryGet(&value));
+		for (size_t i = 0; i < size; ++i) {
+			EXPECT_TRUE(buffer.TryPut(next_put++));
+		}
+		EXPECT_FALSE(buffer.TryPut(next_put));
+		// get a part to shift the positions
+		for (size_t i = 0; i <= round % size; ++i) {
+			ASSERT_TRUE(buffer.TryGet(&value));
+			EXPECT_EQ(next_get++, value);
+		}
+		while (buffer.TryGet(&value)) {
+			EXPECT_EQ(next_get++, value);
+		}
+		EXPECT_EQ(next_put, next_get);
+	}
+}
+
+/*
+ * Passes values from one thread to another and returns elapsed time
+ */
+template<class Put, class Get>
+double HandOff(uint64_t num_values, Put put, Get get) {
+	double start = GetCurrentTime();
+	std::thread producer([&]() {
+		for (uint64_t i = 0; i < num_values; ++i) {
+			put(i);
+		}
+	});
+	uint64_t value = 0;
+	for (uint64_t i = 0; i < num_values; ++i) {
+		get(&value);
+		EXPECT_EQ(i, value);
+		if (i != value) {
+			break;
+		}
+	}
+	producer.join();
+	return GetCurrentTime() - start;
+}
+
+} /* anonymous namespace */
+
+TEST(ThreadPool, Submit) {
+	for (size_t num_threads : { 0, 1, 4 }) {
+		concurrent::ThreadPool pool(num_threads);
+		if (num_threads > 0) {
+			EXPECT_EQ(num_threads, pool.GetNumThreads());
+		} else {
+			EXPECT_LT(0U, pool.GetNumThreads());
+		}
+		std::atomic<uint64_t> sum(0);
+		uint64_t const num_tasks = 10000;
+		for (uint64_t i = 0; i < num_tasks; ++i) {
+			pool.Submit([i, &sum]() {sum += i;});
+		}
+		pool.Wait();
+		EXPECT_EQ(num_tasks * (num_tasks - 1) / 2, sum);
+		// the pool is reusable
+		pool.Submit([&sum]() {sum = 0;});
+		pool.Wait();
+		EXPECT_EQ(0U, sum);
+	}
+}
+
+TEST(ThreadPool, SubmitFromWorkers) {
+	// small queues make workers execute tasks immediately
+	for (size_t max_queued_tasks : { 1, 4, 1024 }) {
+		concurrent::ThreadPool pool(4, max_queued_tasks);
+		std::atomic<uint64_t> sum(0);
+		uint64_t const num_data = 100000;
+		pool.Submit([&]() {SumRecursively(&pool, 0, num_data, &sum);});
+		pool.Wait();
+		EXPECT_EQ(num_data * (num_data - 1) / 2, sum) << max_queued_tasks;
+	}
+}
+
+TEST(ThreadPool, Exception) {
+	concurrent::ThreadPool pool(3, 16);
+	std::atomic<size_t> num_executed(0);
+	for (size_t i = 0; i < 1000; ++i) {
+		pool.Submit([i, &num_executed]() {
+			if (i == 10) {
+				throw std::runtime_error("error in a task");
+			}
+			++num_executed;
+		});
+	}
+	EXPECT_THROW(pool.Wait(), std::runtime_error);
+	EXPECT_GE(999U, num_executed);
+	// the error is cleared
+	num_executed = 0;
+	for (size_t i = 0; i < 100; ++i) {
+		pool.Submit([&num_executed]() {++num_executed;});
+	}
+	EXPECT_NO_THROW(pool.Wait());
+	EXPECT_EQ(100U, num_executed);
+}
+
+TEST(ThreadPool, ProducersAndConsumers) {
+	size_t const num_producers = 5;
+	uint64_t const num_products = 2000;
+	size_t const max_products = 8;
+	for (size_t num_threads : { 1, 2, 8 }) {
+		concurrent::ThreadPool pool(num_threads);
+		std::vector<uint64_t> produced(num_producers, 0);
+		std::atomic<uint64_t> sum(0);
+		std::atomic<size_t> num_in_flight(0);
+		std::atomic<size_t> max_in_flight(0);
+		concurrent::RunProducersAndConsumers<uint64_t>(&pool, num_producers,
+				[&](size_t i, uint64_t *product) {
+					if (produced[i] == num_products) {
+						return false;
+					}
+					*product = produced[i]++;
+					size_t const n = ++num_in_flight;
+					size_t current = max_in_flight;
+					while (n > current && !max_in_flight.compare_exchange_weak(current, n)) {
+					}
+					return true;
+				}, [&](uint64_t &product) {
+					sum += product;
+					--num_in_flight;
+				}, max_products);
+		EXPECT_EQ(num_producers * num_products * (num_products - 1) / 2, sum);
+		EXPECT_GE(max_products, max_in_flight);
+		EXPECT_EQ(0U, num_in_flight);
+	}
+}
+
+TEST(ThreadPool, ProducersAndConsumersException) {
+	concurrent::ThreadPool pool(4);
+	std::vector<size_t> produced(3, 0);
+	EXPECT_THROW(
+			(concurrent::RunProducersAndConsumers<size_t>(&pool, produced.size(), [&](size_t i, size_t *product) {
+								*product = produced[i]++;
+								return *product < 100;
+							}, [](size_t &product) {
+								if (product == 50) {
+									throw std::runtime_error("error in a consumer");
+								}
+							}, 4)), std::runtime_error);
+}
+
+TEST(ParallelFor, Items) {
+	size_t const num_items = 1000;
+	for (size_t num_threads : { 1, 3, 8, 2000 }) {
+		std::vector<std::atomic<size_t> > count(num_items);
+		for (auto &c : count) {
+			c = 0;
+		}
+		size_t const num_workers = std::min(num_threads, num_items);
+		std::atomic<size_t> max_worker(0);
+		concurrent::ParallelFor(num_threads, num_items,
+				[&](size_t worker, size_t item) {
+					++count[item];
+					size_t current = max_worker;
+					while (worker > current && !max_worker.compare_exchange_weak(current, worker)) {
+					}
+				});
+		for (auto &c : count) {
+			EXPECT_EQ(1U, c);
+		}
+		EXPECT_GT(num_workers, max_worker);
+	}
+	concurrent::ParallelFor(4, 0, [](size_t, size_t) {
+		FAIL();
+	});
+}
+
+TEST(ParallelFor, Exception) {
+	std::atomic<size_t> num_executed(0);
+	EXPECT_THROW(
+			concurrent::ParallelFor(3, 1000, [&](size_t, size_t item) {
+						if (item == 10) {
+							throw std::runtime_error("error in an item");
+						}
+						++num_executed;
+					}), std::runtime_error);
+	EXPECT_GE(999U, num_executed);
+}
+
+TEST(ParallelFor, SharedPool) {
+	ASSERT_NE(nullptr, concurrent::GetSharedThreadPool());
+	EXPECT_EQ(concurrent::GetSharedThreadPool(),
+			concurrent::GetSharedThreadPool());
+	// concurrent calls, and calls from workers, wait only for their own items
+	concurrent::ThreadPool pool(2);
+	uint64_t const num_items = 1000;
+	std::vector<std::atomic<uint64_t> > sums(8);
+	for (size_t i = 0; i < sums.size(); ++i) {
+		sums[i] = 0;
+		auto &sum = sums[i];
+		auto const run = [&sum, num_items]() {
+			concurrent::ParallelFor(4, num_items, [&sum](size_t, size_t item) {
+						sum += item;
+					});
+		};
+		if (i % 2 == 0) {
+			pool.Submit(run);
+		} else {
+			run();
+		}
+	}
+	pool.Wait();
+	for (auto &sum : sums) {
+		EXPECT_EQ(num_items * (num_items - 1) / 2, sum);
+	}
+	std::atomic<uint64_t> sum(0);
+	concurrent::ParallelFor(3, num_items, [&sum](size_t worker, size_t item) {
+				EXPECT_GT(3U, worker);
+				sum += item;
+			}, &pool);
+	EXPECT_EQ(num_items * (num_items - 1) / 2, sum);
+}
+
+TEST(Broker, Run) {
+	concurrent::Broker broker(ProduceForBroker, ConsumeForBroker);
+	for (int spec = 0; spec < 3; ++spec) {
+		for (unsigned do_ahead = 1; do_ahead <= BrokerContext::kNumSlots;
+				++do_ahead) {
+			BrokerContext context = { 1000, 0, 0, { }, size_t(-1), false };
+			switch (spec) {
+			case 0:
+				broker.Run(&context, do_ahead);
+				break;
+			case 1:
+				broker.RunProducerAsMasterThread(&context, do_ahead);
+				break;
+			default:
+				broker.RunConsumerAsMasterThread(&context, do_ahead);
+				break;
+			}
+			EXPECT_EQ(1000U, context.num_produced);
+			EXPECT_EQ(1000U, context.num_consumed);
+			EXPECT_FALSE(context.error);
+		}
+	}
+}
+
+TEST(Broker, Exception) {
+	concurrent::Broker broker(ProduceForBroker, ConsumeForBroker);
+	BrokerContext context = { 1000, 0, 0, { }, 500, false };
+	EXPECT_THROW(broker.Run(&context, 2), BrokerException);
+	EXPECT_EQ(500U, context.num_consumed);
+	EXPECT_FALSE(context.error);
+}
+
+TEST(ThreadPool, PerformanceProducersAndConsumers) {
+	size_t const num_producers = 4;
+	uint64_t const num_products = 2000;
+	size_t const num_iterations = 20000;
+	double sequential_result = 0.;
+	double start = GetCurrentTime();
+	for (size_t i = 0; i < num_producers; ++i) {
+		for (uint64_t j = 0; j < num_products; ++j) {
+			sequential_result += Compute(j, num_iterations);
+		}
+	}
+	double end = GetCurrentTime();
+	std::cout << std::setprecision(5) << "#x# benchmark Concurrent_Sequential "
+			<< end - start << std::endl;
+
+	concurrent::ThreadPool pool;
+	std::vector<uint64_t> produced(num_producers, 0);
+	std::vector<double> results(num_producers * num_products);
+	start = GetCurrentTime();
+	concurrent::RunProducersAndConsumers<uint64_t>(&pool, num_producers,
+			[&](size_t i, uint64_t *product) {
+				if (produced[i] == num_products) {
+					return false;
+				}
+				*product = i * num_products + produced[i]++;
+				return true;
+			}, [&](uint64_t &product) {
+				results[product] = Compute(product % num_products, num_iterations);
+			}, 64);
+	end = GetCurrentTime();
+	std::cout << std::setprecision(5) << "#x# benchmark Concurrent_ThreadPool"
+			<< pool.GetNumThreads() << " " << end - start << std::endl;
+	double pool_result = 0.;
+	for (auto value : results) {
+		pool_result += value;
+	}
+	EXPECT_DOUBLE_EQ(sequential_result, pool_result);
+}
+
+TEST(RingBuffer, TryPutAndTryGet) {
+	TestTryPutAndTryGet<concurrent::SPSCRingBuffer<uint64_t, 1> >();
+	TestTryPutAndTryGet<concurrent::SPSCRingBuffer<uint64_t, 8> >();
+	TestTryPutAndTryGet<concurrent::MPMCRingBuffer<uint64_t, 2> >();
+	TestTryPutAndTryGet<concurrent::MPMCRingBuffer<uint64_t, 8> >();
+	concurrent::SPSCRingBuffer<uint64_t, 4> buffer;
+	buffer.Put(1);
+	buffer.Put(2);
+	EXPECT_EQ(2U, buffer.Length());
+}
+
+TEST(RingBuffer, SingleProducerSingleConsumer) {
+	std::unique_ptr<concurrent::SPSCRingBuffer<uint64_t, 64> > buffer(
+			new concurrent::SPSCRingBuffer<uint64_t, 64>());
+	HandOff(1000000, [&](uint64_t value) {buffer->Put(value);},
+			[&](uint64_t *value) {buffer->Get(value);});
+	EXPECT_EQ(0U, buffer->Length());
+}
+
+TEST(RingBuffer, MultiProducerMultiConsumer) {
+	size_t const num_producers = 4;
+	size_t const num_consumers = 3;
+	uint64_t const num_values = 100000;
+	std::unique_ptr<concurrent::MPMCRingBuffer<uint64_t, 16> > buffer(
+			new concurrent::MPMCRingBuffer<uint64_t, 16>());
+	std::atomic<uint64_t> sum(0);
+	std::atomic<uint64_t> num_got(0);
+	std::vector<std::thread> threads;
+	for (size_t i = 0; i < num_producers; ++i) {
+		threads.emplace_back([&]() {
+			for (uint64_t j = 0; j < num_values; ++j) {
+				buffer->Put(j);
+			}
+		});
+	}
+	for (size_t i = 0; i < num_consumers; ++i) {
+		threads.emplace_back([&]() {
+			uint64_t value = 0;
+			while (num_got < num_producers * num_values) {
+				if (buffer->TryGet(&value)) {
+					sum += value;
+					++num_got;
+				} else {
+					std::this_thread::yield();
+				}
+			}
+		});
+	}
+	for (auto &thread : threads) {
+		thread.join();
+	}
+	EXPECT_EQ(num_producers * num_values, num_got);
+	EXPECT_EQ(num_producers * num_values * (num_values - 1) / 2, sum);
+	uint64_t value = 0;
+	EXPECT_FALSE(buffer->TryGet(&value));
+}
+
+TEST(RingBuffer, PerformanceHandOff) {
+	uint64_t const num_values = 2000000;
+	size_t const kSize = 1024;
+	std::unique_ptr<concurrent::FIFO<uint64_t, kSize> > fifo(
+			new concurrent::FIFO<uint64_t, kSize>());
+	double elapsed = HandOff(num_values, [&](uint64_t value) {
+		for (;;) {
+			bool put = true;
+			fifo->Lock();
+			try {
+				fifo->Put(value);
+			} catch (concurrent::FullException const &e) {
+				put = false;
+			}
+			fifo->Unlock();
+			if (put) {
+				break;
+			}
+			std::this_thread::yield();
+		}
+	}, [&](uint64_t *value) {
+		for (;;) {
+			bool got = true;
+			fifo->Lock();
+			try {
+				*value = fifo->Get();
+			} catch (concurrent::EmptyException const &e) {
+				got = false;
+			}
+			fifo->Unlock();
+			if (got) {
+				break;
+			}
+			std::this_thread::yield();
+		}
+	});
+	std::cout << std::setprecision(5) << "#x# benchmark Concurrent_FIFO "
+			<< elapsed << std::endl;
+
+	std::unique_ptr<concurrent::SPSCRingBuffer<uint64_t, kSize> > spsc(
+			new concurrent::SPSCRingBuffer<uint64_t, kSize>());
+	elapsed = HandOff(num_values, [&](uint64_t value) {spsc->Put(value);},
+			[&](uint64_t *value) {spsc->Get(value);});
+	std::cout << std::setprecision(5) << "#x# benchmark Concurrent_SPSCRingBuffer "
+			<< elapsed << std::endl;
+
+	std::unique_ptr<concurrent::MPMCRingBuffer<uint64_t, kSize> > mpmc(
+			new concurrent::MPMCRingBuffer<uint64_t, kSize>());
+	elapsed = HandOff(num_values, [&](uint64_t value) {mpmc->Put(value);},
+			[&](uint64_t *value) {mpmc->Get(value);});
+	std::cout << std::setprecision(5) << "#x# benchmark Concurrent_MPMCRingBuffer "
+			<< elapsed << std::endl;
+}
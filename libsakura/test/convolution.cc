@@ -56,13 +56,7 @@
 extern "C" {
 struct LIBSAKURA_SYMBOL(Convolve1DContextFloat) {
 	size_t num_kernel;
-	fftw_plan plan_r2c;
-	fftw_plan plan_c2r;
-	fftw_complex *ffted_kernel;
-	fftw_complex *ffted_input_data;
-	fftw_complex *ffted_convolve_data;
-	double *real_array;
-	void *real_array_work;
+	// other members are private to the library
 };
 }
 typedef enum {
@@ -1274,6 +1268,223 @@ TEST_F(Convolve1DOperation , PerformanceTestWithFFTDataIsEven) {
 			StandardArrayInitializer, StandardArrayInitializer,
 			StatusOKValidator>(ELEMENTSOF(TestList), TestList, num_repeat);
 }
+/*
+ * Convolution of many spectra by a batched context
+ */
+namespace {
+void RunBatchConvolution(size_t num_data, size_t num_spectra,
+		size_t num_batch, LIBSAKURA_SYMBOL(FFTPrecision) precision,
+		bool in_place, double tolerance) {
+	SCOPED_TRACE(
+			"num_data=" + std::to_string(num_data) + " num_batch="
+					+ std::to_string(num_batch) + " precision="
+					+ std::to_string(precision) + (in_place ? " in-place" : ""));
+	size_t const num_elements = num_data * num_spectra;
+	float *kernel = nullptr;
+	std::unique_ptr<void, DefaultAlignedMemory> kernel_storage(
+			DefaultAlignedMemory::AlignedAllocateOrException(
+					sizeof(float) * num_data, &kernel));
+	float *input = nullptr;
+	std::unique_ptr<void, DefaultAlignedMemory> input_storage(
+			DefaultAlignedMemory::AlignedAllocateOrException(
+					sizeof(float) * num_elements, &input));
+	float *output = nullptr;
+	std::unique_ptr<void, DefaultAlignedMemory> output_storage(
+			DefaultAlignedMemory::AlignedAllocateOrException(
+					sizeof(float) * num_elements, &output));
+	float *reference = nullptr;
+	std::unique_ptr<void, DefaultAlignedMemory> reference_storage(
+			DefaultAlignedMemory::AlignedAllocateOrException(
+					sizeof(float) * num_elements, &reference));
+	ASSERT_EQ(LIBSAKURA_SYMBOL(Status_kOK),
+			LIBSAKURA_SYMBOL(CreateGaussianKernelFloat)(num_data / 2.f,
+					NUM_WIDTH, num_data, kernel));
+	for (size_t i = 0; i < num_elements; ++i) {
+		input[i] = static_cast<float>(rand()) / RAND_MAX - 0.5f;
+	}
+
+	LIBSAKURA_SYMBOL(Convolve1DContextFloat) *context = nullptr;
+	ASSERT_EQ(LIBSAKURA_SYMBOL(Status_kOK),
+			LIBSAKURA_SYMBOL(CreateConvolve1DContextFFTFloat)(num_data, kernel,
+					&context));
+	// rows of input are not always aligned
+	float *row = nullptr;
+	std::unique_ptr<void, DefaultAlignedMemory> row_storage(
+			DefaultAlignedMemory::AlignedAllocateOrException(
+					sizeof(float) * num_data, &row));
+	for (size_t i = 0; i < num_spectra; ++i) {
+		std::copy(&input[i * num_data], &input[(i + 1) * num_data], row);
+		ASSERT_EQ(LIBSAKURA_SYMBOL(Status_kOK),
+				LIBSAKURA_SYMBOL(Convolve1DFFTFloat)(context, num_data, row,
+						row));
+		std::copy(row, row + num_data, &reference[i * num_data]);
+	}
+	ASSERT_EQ(LIBSAKURA_SYMBOL(Status_kOK),
+			LIBSAKURA_SYMBOL(DestroyConvolve1DContextFloat)(context));
+
+	LIBSAKURA_SYMBOL(Convolve1DContextFloat) *batch_context = nullptr;
+	ASSERT_EQ(LIBSAKURA_SYMBOL(Status_kOK),
+			LIBSAKURA_SYMBOL(CreateConvolve1DContextFFTBatchFloat)(num_data,
+					kernel, num_batch, precision, &batch_context));
+	ASSERT_NE(nullptr, batch_context);
+	EXPECT_EQ(num_data, batch_context->num_kernel);
+	if (in_place) {
+		std::copy(input, input + num_elements, output);
+	}
+	EXPECT_EQ(LIBSAKURA_SYMBOL(Status_kOK),
+			LIBSAKURA_SYMBOL(Convolve1DFFTBatchFloat)(batch_context,
+					num_spectra, num_data, in_place ? output : input, output));
+	for (size_t i = 0; i < num_elements; ++i) {
+		ASSERT_NEAR(reference[i], output[i], tolerance) << "i=" << i;
+	}
+	// a single spectrum is convolved by the same context
+	EXPECT_EQ(LIBSAKURA_SYMBOL(Status_kOK),
+			LIBSAKURA_SYMBOL(Convolve1DFFTFloat)(batch_context, num_data, input,
+					output));
+	for (size_t i = 0; i < num_data; ++i) {
+		ASSERT_NEAR(reference[i], output[i], tolerance) << "i=" << i;
+	}
+	ASSERT_EQ(LIBSAKURA_SYMBOL(Status_kOK),
+			LIBSAKURA_SYMBOL(DestroyConvolve1DContextFloat)(batch_context));
+}
+} /* anonymous namespace */
+
+TEST_F(Convolve1DOperation , BatchWithFFT) {
+	size_t const num_spectra = 7;
+	for (size_t num_data : { 1, NUM_IN_EVEN, NUM_IN_ODD, 1000 }) {
+		for (size_t num_batch : { 1, 3, 7, 10 }) {
+			RunBatchConvolution(num_data, num_spectra, num_batch,
+			LIBSAKURA_SYMBOL(FFTPrecision_kDouble), false, 1e-6);
+			RunBatchConvolution(num_data, num_spectra, num_batch,
+			LIBSAKURA_SYMBOL(FFTPrecision_kSingle), false, 1e-5);
+		}
+	}
+	RunBatchConvolution(NUM_IN_ODD, num_spectra, 3,
+	LIBSAKURA_SYMBOL(FFTPrecision_kDouble), true, 1e-6);
+	RunBatchConvolution(NUM_IN_EVEN, num_spectra, 3,
+	LIBSAKURA_SYMBOL(FFTPrecision_kSingle), true, 1e-5);
+}
+
+TEST_F(Convolve1DOperation , BatchWithFFTInvalidArguments) {
+	size_t const num_data = NUM_IN_EVEN;
+	size_t const num_spectra = 2;
+	float *kernel = nullptr;
+	std::unique_ptr<void, DefaultAlignedMemory> kernel_storage(
+			DefaultAlignedMemory::AlignedAllocateOrException(
+					sizeof(float) * (num_data + 1), &kernel));
+	float *data = nullptr;
+	std::unique_ptr<void, DefaultAlignedMemory> data_storage(
+			DefaultAlignedMemory::AlignedAllocateOrException(
+					sizeof(float) * (num_data * num_spectra + 1), &data));
+	ASSERT_EQ(LIBSAKURA_SYMBOL(Status_kOK),
+			LIBSAKURA_SYMBOL(CreateGaussianKernelFloat)(num_data / 2.f,
+					NUM_WIDTH, num_data, kernel));
+	std::fill(data, data + num_data * num_spectra + 1, 0.f);
+	auto const kDouble = LIBSAKURA_SYMBOL(FFTPrecision_kDouble);
+
+	LIBSAKURA_SYMBOL(Convolve1DContextFloat) *context = nullptr;
+	EXPECT_EQ(LIBSAKURA_SYMBOL(Status_kInvalidArgument),
+			LIBSAKURA_SYMBOL(CreateConvolve1DContextFFTBatchFloat)(num_data,
+					kernel, 4, kDouble, nullptr));
+	EXPECT_EQ(LIBSAKURA_SYMBOL(Status_kInvalidArgument),
+			LIBSAKURA_SYMBOL(CreateConvolve1DContextFFTBatchFloat)(num_data,
+					kernel, 0, kDouble, &context));
+	EXPECT_EQ(nullptr, context);
+	EXPECT_EQ(LIBSAKURA_SYMBOL(Status_kInvalidArgument),
+			LIBSAKURA_SYMBOL(CreateConvolve1DContextFFTBatchFloat)(num_data,
+					kernel, 4, LIBSAKURA_SYMBOL(FFTPrecision_kNumElements),
+					&context));
+	EXPECT_EQ(nullptr, context);
+	EXPECT_EQ(LIBSAKURA_SYMBOL(Status_kInvalidArgument),
+			LIBSAKURA_SYMBOL(CreateConvolve1DContextFFTBatchFloat)(0, kernel,
+					4, kDouble, &context));
+	EXPECT_EQ(LIBSAKURA_SYMBOL(Status_kInvalidArgument),
+			LIBSAKURA_SYMBOL(CreateConvolve1DContextFFTBatchFloat)(num_data,
+					nullptr, 4, kDouble, &context));
+	EXPECT_EQ(LIBSAKURA_SYMBOL(Status_kInvalidArgument),
+			LIBSAKURA_SYMBOL(CreateConvolve1DContextFFTBatchFloat)(num_data,
+					kernel + 1, 4, kDouble, &context));
+
+	ASSERT_EQ(LIBSAKURA_SYMBOL(Status_kOK),
+			LIBSAKURA_SYMBOL(CreateConvolve1DContextFFTBatchFloat)(num_data,
+					kernel, 4, kDouble, &context));
+	EXPECT_EQ(LIBSAKURA_SYMBOL(Status_kInvalidArgument),
+			LIBSAKURA_SYMBOL(Convolve1DFFTBatchFloat)(nullptr, num_spectra,
+					num_data, data, data));
+	EXPECT_EQ(LIBSAKURA_SYMBOL(Status_kInvalidArgument),
+			LIBSAKURA_SYMBOL(Convolve1DFFTBatchFloat)(context, num_spectra,
+					num_data + 1, data, data));
+	EXPECT_EQ(LIBSAKURA_SYMBOL(Status_kInvalidArgument),
+			LIBSAKURA_SYMBOL(Convolve1DFFTBatchFloat)(context, num_spectra,
+					num_data, nullptr, data));
+	EXPECT_EQ(LIBSAKURA_SYMBOL(Status_kInvalidArgument),
+			LIBSAKURA_SYMBOL(Convolve1DFFTBatchFloat)(context, num_spectra,
+					num_data, data + 1, data));
+	EXPECT_EQ(LIBSAKURA_SYMBOL(Status_kInvalidArgument),
+			LIBSAKURA_SYMBOL(Convolve1DFFTBatchFloat)(context, num_spectra,
+					num_data, data, nullptr));
+	EXPECT_EQ(LIBSAKURA_SYMBOL(Status_kInvalidArgument),
+			LIBSAKURA_SYMBOL(Convolve1DFFTBatchFloat)(context, num_spectra,
+					num_data, data, data + 1));
+	EXPECT_EQ(LIBSAKURA_SYMBOL(Status_kOK),
+			LIBSAKURA_SYMBOL(Convolve1DFFTBatchFloat)(context, 0, num_data,
+					nullptr, nullptr));
+	ASSERT_EQ(LIBSAKURA_SYMBOL(Status_kOK),
+			LIBSAKURA_SYMBOL(DestroyConvolve1DContextFloat)(context));
+}
+
+TEST_F(Convolve1DOperation , PerformanceTestWithFFTBatch) {
+	size_t const num_data = NUM_IN_LARGE;
+	size_t const num_spectra = 2000;
+	size_t const num_batch = 8;
+	size_t const num_elements = num_data * num_spectra;
+	float *kernel = nullptr;
+	std::unique_ptr<void, DefaultAlignedMemory> kernel_storage(
+			DefaultAlignedMemory::AlignedAllocateOrException(
+					sizeof(float) * num_data, &kernel));
+	float *data = nullptr;
+	std::unique_ptr<void, DefaultAlignedMemory> data_storage(
+			DefaultAlignedMemory::AlignedAllocateOrException(
+					sizeof(float) * num_elements, &data));
+	ASSERT_EQ(LIBSAKURA_SYMBOL(Status_kOK),
+			LIBSAKURA_SYMBOL(CreateGaussianKernelFloat)(num_data / 2.f,
+					NUM_WIDTH, num_data, kernel));
+	for (size_t i = 0; i < num_elements; ++i) {
+		data[i] = static_cast<float>(rand()) / RAND_MAX;
+	}
+
+	LIBSAKURA_SYMBOL(Convolve1DContextFloat) *context = nullptr;
+	ASSERT_EQ(LIBSAKURA_SYMBOL(Status_kOK),
+			LIBSAKURA_SYMBOL(CreateConvolve1DContextFFTFloat)(num_data, kernel,
+					&context));
+	double start = GetCurrentTime();
+	for (size_t i = 0; i < num_spectra; ++i) {
+		ASSERT_EQ(LIBSAKURA_SYMBOL(Status_kOK),
+				LIBSAKURA_SYMBOL(Convolve1DFFTFloat)(context, num_data,
+						&data[i * num_data], &data[i * num_data]));
+	}
+	double end = GetCurrentTime();
+	cout << BENCH << "Convolve1DFFTFloat_Loop " << end - start << endl;
+	ASSERT_EQ(LIBSAKURA_SYMBOL(Status_kOK),
+			LIBSAKURA_SYMBOL(DestroyConvolve1DContextFloat)(context));
+
+	for (auto precision : { LIBSAKURA_SYMBOL(FFTPrecision_kDouble),
+	LIBSAKURA_SYMBOL(FFTPrecision_kSingle) }) {
+		ASSERT_EQ(LIBSAKURA_SYMBOL(Status_kOK),
+				LIBSAKURA_SYMBOL(CreateConvolve1DContextFFTBatchFloat)(num_data,
+						kernel, num_batch, precision, &context));
+		start = GetCurrentTime();
+		ASSERT_EQ(LIBSAKURA_SYMBOL(Status_kOK),
+				LIBSAKURA_SYMBOL(Convolve1DFFTBatchFloat)(context, num_spectra,
+						num_data, data, data));
+		end = GetCurrentTime();
+		cout << BENCH << "Convolve1DFFTBatchFloat_"
+				<< (precision == LIBSAKURA_SYMBOL(FFTPrecision_kDouble) ?
+						"Double" : "Single") << " " << end - start << endl;
+		ASSERT_EQ(LIBSAKURA_SYMBOL(Status_kOK),
+				LIBSAKURA_SYMBOL(DestroyConvolve1DContextFloat)(context));
+	}
+}
 /*
  * Convolution by user defined asymmetric kernel (right angled triangle)
  */
@@ -1838,6 +2049,157 @@ TEST_F(Convolve1DOperation, PerformanceTestWithoutFFT) {
 			StandardArrayInitializer, StandardArrayInitializer,
 			StatusOKValidator>(ELEMENTSOF(TestList), TestList, num_repeat);
 }
+/*
+ * Compare direct convolution with a naive implementation for various
+ * lengths of kernel and data including long spectra and kernels longer
+ * than a block of taps.
+ */
+namespace {
+void ConvolveNaively(size_t num_kernel, float const kernel[], size_t num_data,
+		float const data[], bool const mask[], float output_data[],
+		float output_weight[]) {
+	size_t const center = num_kernel / 2;
+	for (size_t i = 0; i < num_data; ++i) {
+		double value = 0.;
+		double weight = 0.;
+		for (size_t j = 0; j < num_kernel; ++j) {
+			// data[i + center - j] is weighted by kernel[j]
+			if (i + center < j || i + center - j >= num_data) {
+				continue;
+			}
+			size_t const k = i + center - j;
+			if (mask[k]) {
+				value += static_cast<double>(kernel[j]) * data[k];
+				weight += kernel[j];
+			}
+		}
+		output_data[i] = weight == 0. ? 0. : value / weight;
+		output_weight[i] = weight;
+	}
+}
+} /* anonymous namespace */
+
+TEST_F(Convolve1DOperation, WithOutFFTCompareWithNaiveConvolution) {
+	struct {
+		size_t num_kernel;
+		size_t num_data;
+	} const test_cases[] = { { 1, 1 }, { 1, 100 }, { 4, 3 }, { 25, 17 }, {
+			25, 8192 }, { 100, 1000 }, { 1500, 3001 }, { 1500, 1000 }, { 2049,
+			262144 } };
+	for (auto const &test_case : test_cases) {
+		size_t const num_kernel = test_case.num_kernel;
+		size_t const num_data = test_case.num_data;
+		SCOPED_TRACE(
+				"num_kernel=" + std::to_string(num_kernel) + " num_data="
+						+ std::to_string(num_data));
+		float *kernel = nullptr;
+		std::unique_ptr<void, DefaultAlignedMemory> kernel_storage(
+				DefaultAlignedMemory::AlignedAllocateOrException(
+						sizeof(float) * num_kernel, &kernel));
+		float *data = nullptr;
+		std::unique_ptr<void, DefaultAlignedMemory> data_storage(
+				DefaultAlignedMemory::AlignedAllocateOrException(
+						sizeof(float) * num_data, &data));
+		bool *mask = nullptr;
+		std::unique_ptr<void, DefaultAlignedMemory> mask_storage(
+				DefaultAlignedMemory::AlignedAllocateOrException(
+						sizeof(bool) * num_data, &mask));
+		float *output = nullptr;
+		std::unique_ptr<void, DefaultAlignedMemory> output_storage(
+				DefaultAlignedMemory::AlignedAllocateOrException(
+						sizeof(float) * num_data, &output));
+		float *weight = nullptr;
+		std::unique_ptr<void, DefaultAlignedMemory> weight_storage(
+				DefaultAlignedMemory::AlignedAllocateOrException(
+						sizeof(float) * num_data, &weight));
+		// asymmetric kernel
+		for (size_t i = 0; i < num_kernel; ++i) {
+			kernel[i] = static_cast<float>(rand()) / RAND_MAX;
+		}
+		for (size_t i = 0; i < num_data; ++i) {
+			mask[i] = rand() % 5 != 0;
+			data[i] = mask[i] ? static_cast<float>(rand()) / RAND_MAX : NAN;
+		}
+		vector<float> reference_output(num_data);
+		vector<float> reference_weight(num_data);
+		ConvolveNaively(num_kernel, kernel, num_data, data, mask,
+				reference_output.data(), reference_weight.data());
+		ASSERT_EQ(LIBSAKURA_SYMBOL(Status_kOK),
+				LIBSAKURA_SYMBOL(Convolve1DFloat)(num_kernel, kernel, num_data,
+						data, mask, output, weight));
+		for (size_t i = 0; i < num_data; ++i) {
+			ASSERT_FLOAT_EQ(reference_weight[i], weight[i]) << "i=" << i;
+			ASSERT_FLOAT_EQ(reference_output[i], output[i]) << "i=" << i;
+		}
+	}
+}
+
+/*
+ * Compare performance of direct convolution with that of FFT to find
+ * the crossover length of the kernel.
+ */
+TEST_F(Convolve1DOperation, PerformanceTestCrossoverWithoutFFTAndWithFFT) {
+	size_t const num_data = NUM_IN_LARGE;
+	size_t const num_repeat = 200;
+	float *kernel = nullptr;
+	std::unique_ptr<void, DefaultAlignedMemory> kernel_storage(
+			DefaultAlignedMemory::AlignedAllocateOrException(
+					sizeof(float) * num_data, &kernel));
+	float *data = nullptr;
+	std::unique_ptr<void, DefaultAlignedMemory> data_storage(
+			DefaultAlignedMemory::AlignedAllocateOrException(
+					sizeof(float) * num_data, &data));
+	bool *mask = nullptr;
+	std::unique_ptr<void, DefaultAlignedMemory> mask_storage(
+			DefaultAlignedMemory::AlignedAllocateOrException(
+					sizeof(bool) * num_data, &mask));
+	float *output = nullptr;
+	std::unique_ptr<void, DefaultAlignedMemory> output_storage(
+			DefaultAlignedMemory::AlignedAllocateOrException(
+					sizeof(float) * num_data, &output));
+	float *weight = nullptr;
+	std::unique_ptr<void, DefaultAlignedMemory> weight_storage(
+			DefaultAlignedMemory::AlignedAllocateOrException(
+					sizeof(float) * num_data, &weight));
+	for (size_t i = 0; i < num_data; ++i) {
+		data[i] = static_cast<float>(rand()) / RAND_MAX;
+		mask[i] = true;
+	}
+
+	ASSERT_EQ(LIBSAKURA_SYMBOL(Status_kOK),
+			LIBSAKURA_SYMBOL(CreateGaussianKernelFloat)(num_data / 2.f,
+					NUM_WIDTH, num_data, kernel));
+	LIBSAKURA_SYMBOL(Convolve1DContextFloat) *context = nullptr;
+	ASSERT_EQ(LIBSAKURA_SYMBOL(Status_kOK),
+			LIBSAKURA_SYMBOL(CreateConvolve1DContextFFTFloat)(num_data, kernel,
+					&context));
+	double start = GetCurrentTime();
+	for (size_t i = 0; i < num_repeat; ++i) {
+		ASSERT_EQ(LIBSAKURA_SYMBOL(Status_kOK),
+				LIBSAKURA_SYMBOL(Convolve1DFFTFloat)(context, num_data, data,
+						output));
+	}
+	double end = GetCurrentTime();
+	cout << BENCH << "Convolve1DFloat_WithFFT_Crossover " << end - start
+			<< endl;
+	ASSERT_EQ(LIBSAKURA_SYMBOL(Status_kOK),
+			LIBSAKURA_SYMBOL(DestroyConvolve1DContextFloat)(context));
+
+	for (size_t num_kernel : { 16, 32, 64, 128, 256, 512 }) {
+		ASSERT_EQ(LIBSAKURA_SYMBOL(Status_kOK),
+				LIBSAKURA_SYMBOL(CreateGaussianKernelFloat)(num_kernel / 2.f,
+						num_kernel / 8.f, num_kernel, kernel));
+		start = GetCurrentTime();
+		for (size_t i = 0; i < num_repeat; ++i) {
+			ASSERT_EQ(LIBSAKURA_SYMBOL(Status_kOK),
+					LIBSAKURA_SYMBOL(Convolve1DFloat)(num_kernel, kernel,
+							num_data, data, mask, output, weight));
+		}
+		end = GetCurrentTime();
+		cout << BENCH << "Convolve1DFloat_WithOutFFT_Crossover_Kernel"
+				<< num_kernel << " " << end - start << endl;
+	}
+}
 /*
  * Test user defined asymmetric kernel (right angled triangle)
  */
@@ -887,6 +887,50 @@ public:
 		}
 	}
 
+	/**
+	 * Grids @a rows by @ref sakura_GridConvolvingFloat into @a sumwt2, @a wgrid2 and @a grid2
+	 * and by @ref sakura_GridConvolvingParallelFloat with @a num_threads threads into
+	 * @a sumwt, @a wgrid and @a grid, then compares them.
+	 */
+	template<typename RT>
+	void TryParallel(size_t num_threads, bool weight_only, RT *rows,
+			double (*sumwt2)[kNPol][kNChan], float (*wgrid2)[kNY][kNX][kNPol][kNChan],
+			float (*grid2)[kNY][kNX][kNPol][kNChan], char const *key = nullptr) {
+		STATIC_ASSERT(RT::kNVisChan == kNVisChan);
+		STATIC_ASSERT(RT::kNVisPol == kNVisPol);
+		ClearResults(sumwt2, wgrid2, grid2);
+		ClearResults();
+		double start = CurrentTime();
+		for (size_t i = 0; i < RT::kRowFactor; ++i) {
+			LIBSAKURA_SYMBOL(Status) result = LIBSAKURA_SYMBOL(GridConvolvingFloat)(RT::kNRow,
+					0, RT::kNRow, rows->sp_mask, rows->x, rows->y, SUPPORT,
+					SAMPLING, RT::kNVisPol, polmap, RT::kNVisChan, chanmap,
+					rows->mask[0][0], rows->values[0][0], rows->weight[0],
+					weight_only, ELEMENTSOF(conv_tab), conv_tab, kNPol, kNChan,
+					kNX, kNY, (*sumwt2)[0], (*wgrid2)[0][0][0], (*grid2)[0][0][0]);
+			EXPECT_EQ(LIBSAKURA_SYMBOL(Status_kOK), result);
+		}
+		double serial = CurrentTime() - start;
+		start = CurrentTime();
+		for (size_t i = 0; i < RT::kRowFactor; ++i) {
+			LIBSAKURA_SYMBOL(Status) result = LIBSAKURA_SYMBOL(GridConvolvingParallelFloat)(RT::kNRow,
+					0, RT::kNRow, rows->sp_mask, rows->x, rows->y, SUPPORT,
+					SAMPLING, RT::kNVisPol, polmap, RT::kNVisChan, chanmap,
+					rows->mask[0][0], rows->values[0][0], rows->weight[0],
+					weight_only, ELEMENTSOF(conv_tab), conv_tab, kNPol, kNChan,
+					kNX, kNY, num_threads, sumwt[0], wgrid[0][0][0], grid[0][0][0]);
+			EXPECT_EQ(LIBSAKURA_SYMBOL(Status_kOK), result);
+		}
+		double parallel = CurrentTime() - start;
+		if (key) {
+			ReportBenchmark(string(key) + "_Serial", serial);
+			ReportBenchmark(string(key) + "_Parallel" + to_string(num_threads), parallel);
+		}
+		EXPECT_TRUE(CmpSumwt(&sumwt, sumwt2));
+		EXPECT_EQ(0, memcmp(wgrid, wgrid2, sizeof(wgrid)));
+		EXPECT_EQ(0, memcmp(grid, grid2, sizeof(grid)));
+	}
+
 	template<typename RT>
 	void TestGrid(
 			function<
@@ -2003,6 +2047,65 @@ TEST(Gridding, VectorizedWeightOnly) {
 			});
 }
 
+TEST(Gridding, Parallel) {
+	typedef TestTypical TestCase;
+	typedef RowBase<512, 1, TestCase::kNVisChan, TestCase::kNVisPol> RowType;
+
+	TestCase *test_case;
+	unique_ptr<void, DefaultAlignedMemory> test_case_storage(
+			DefaultAlignedMemory::AlignedAllocateOrException(sizeof(*test_case),
+					&test_case));
+	test_case->SetUp();
+	auto fin_func = [=]() {test_case->TearDown();};
+	auto fin = Finalizer<decltype(fin_func)>(fin_func);
+
+	test_case->TestGrid<RowType>(
+			[](TestCase *tc, RowType *rows, TestCase::SumType *sumwt2, TestCase::GridType *wgrid2, TestCase::GridType *grid2) {
+				rows->SetRandomValues(-1, 1);
+				rows->SetRandomXY(-2. * TestCase::kSupport,
+						TestCase::kNX + 2 * TestCase::kSupport,
+						-2. * TestCase::kSupport,
+						TestCase::kNY + 2 * TestCase::kSupport);
+				rows->sp_mask[3] = false;
+				rows->mask[5][1][7] = false;
+				for (size_t num_threads : {1, 2, 3, 7, 64}) {
+					for (bool weight_only : {false, true}) {
+						tc->TryParallel(num_threads, weight_only, rows, sumwt2, wgrid2, grid2);
+					}
+				}
+				// all spectra on the same location
+				rows->SetXY(TestCase::kNX / 2, TestCase::kNY / 2);
+				tc->TryParallel(4, false, rows, sumwt2, wgrid2, grid2);
+				// channel mapping prevents vectorization
+				tc->chanmap[0] = 1;
+				rows->SetRandomXY(0, TestCase::kNX, 0, TestCase::kNY);
+				tc->TryParallel(4, false, rows, sumwt2, wgrid2, grid2);
+			});
+}
+
+TEST(Gridding, PerformanceParallel) {
+	typedef TestTypical TestCase;
+	typedef RowBase<512, 2, TestCase::kNVisChan, TestCase::kNVisPol> RowType;
+
+	TestCase *test_case;
+	unique_ptr<void, DefaultAlignedMemory> test_case_storage(
+			DefaultAlignedMemory::AlignedAllocateOrException(sizeof(*test_case),
+					&test_case));
+	test_case->SetUp();
+	auto fin_func = [=]() {test_case->TearDown();};
+	auto fin = Finalizer<decltype(fin_func)>(fin_func);
+
+	test_case->TestGrid<RowType>(
+			[](TestCase *tc, RowType *rows, TestCase::SumType *sumwt2, TestCase::GridType *wgrid2, TestCase::GridType *grid2) {
+				rows->SetValues(1);
+				rows->SetRandomXY(-2. * TestCase::kSupport,
+						TestCase::kNX + 2 * TestCase::kSupport,
+						-2. * TestCase::kSupport,
+						TestCase::kNY + 2 * TestCase::kSupport);
+				tc->TryParallel(0, false, rows, sumwt2, wgrid2, grid2, "Gridding_VectorizedWeighted");
+			});
+}
+
 TEST(Gridding, PerformanceVectorized) {
 	typedef TestTypical TestCase;
 	typedef RowBase<512, 2, TestCase::kNVisChan, TestCase::kNVisPol> RowType;
@@ -31,6 +31,11 @@
 #include <unistd.h>
 #include <iostream>
 #include <cstdlib>
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
 #include "loginit.h"
 #include "gtest/gtest.h"
 
@@ -281,3 +286,358 @@ TEST(Global, AlignShort) {
 	sakura_CleanUp();
 }
 
+
+namespace {
+
+void CreateAndDestroyContexts(size_t num_repeat) {
+	for (size_t i = 0; i < num_repeat; ++i) {
+		LIBSAKURA_SYMBOL(LSQFitContextFloat) *context = nullptr;
+		auto status = LIBSAKURA_SYMBOL(CreateLSQFitContextPolynomialFloat)(
+				LIBSAKURA_SYMBOL(LSQFitType_kPolynomial), 5, 100, &context);
+		ASSERT_EQ(status, sakura_Status_kOK);
+		status = LIBSAKURA_SYMBOL(DestroyLSQFitContextFloat)(context);
+		ASSERT_EQ(status, sakura_Status_kOK);
+	}
+}
+
+std::atomic<size_t> atomic_alloc_count(0);
+std::atomic<size_t> atomic_free_count(0);
+
+void *MyAtomicAllocate(size_t size) {
+	++atomic_alloc_count;
+	return malloc(size);
+}
+
+void MyAtomicFree(void *ptr) {
+	if (ptr != nullptr) {
+		++atomic_free_count;
+	}
+	free(ptr);
+}
+
+}
+
+TEST(Global, MemoryPolicyInvalidArguments) {
+	EXPECT_EQ(sakura_Status_kInvalidArgument,
+			LIBSAKURA_SYMBOL(InitializeWithMemoryPolicy)(nullptr, nullptr,
+					LIBSAKURA_SYMBOL(MemoryPolicy_kNumElements)));
+	EXPECT_EQ(sakura_Status_kInvalidArgument,
+			LIBSAKURA_SYMBOL(GetMemoryStatistics)(nullptr));
+}
+
+TEST(Global, ThreadLocalPool) {
+	sakura_Status result = LIBSAKURA_SYMBOL(InitializeWithMemoryPolicy)(
+			MyAtomicAllocate, MyAtomicFree,
+			LIBSAKURA_SYMBOL(MemoryPolicy_kThreadLocalPool));
+	ASSERT_EQ(result, sakura_Status_kOK);
+	atomic_alloc_count = 0;
+	atomic_free_count = 0;
+	LIBSAKURA_SYMBOL(MemoryStatistics) before;
+	ASSERT_EQ(sakura_Status_kOK, LIBSAKURA_SYMBOL(GetMemoryStatistics)(&before));
+
+	size_t const kNumRepeat = 100;
+	CreateAndDestroyContexts(kNumRepeat);
+
+	LIBSAKURA_SYMBOL(MemoryStatistics) after;
+	ASSERT_EQ(sakura_Status_kOK, LIBSAKURA_SYMBOL(GetMemoryStatistics)(&after));
+	auto const num_allocations = after.num_allocations - before.num_allocations;
+	auto const num_upstream_allocations = after.num_upstream_allocations
+			- before.num_upstream_allocations;
+	EXPECT_LT(0U, num_allocations);
+	EXPECT_EQ(num_allocations, after.num_frees - before.num_frees);
+	EXPECT_EQ(num_allocations,
+			num_upstream_allocations + after.num_pool_hits
+					- before.num_pool_hits);
+	// blocks of the first iteration are reused by the others
+	EXPECT_GE(num_allocations / kNumRepeat, num_upstream_allocations);
+	EXPECT_EQ(num_upstream_allocations, atomic_alloc_count);
+	EXPECT_GT(atomic_alloc_count, atomic_free_count);
+
+	// blocks are released by worker threads when they exit
+	std::vector<std::thread> threads;
+	for (size_t i = 0; i < 4; ++i) {
+		threads.push_back(std::thread(CreateAndDestroyContexts, kNumRepeat));
+	}
+	for (auto &thread : threads) {
+		thread.join();
+	}
+	LIBSAKURA_SYMBOL(CleanUp)();
+	EXPECT_EQ(atomic_alloc_count, atomic_free_count);
+	ASSERT_EQ(sakura_Status_kOK, LIBSAKURA_SYMBOL(GetMemoryStatistics)(&after));
+	EXPECT_EQ(atomic_alloc_count,
+			after.num_upstream_allocations - before.num_upstream_allocations);
+	EXPECT_EQ(atomic_free_count,
+			after.num_upstream_frees - before.num_upstream_frees);
+	EXPECT_EQ(5 * num_allocations,
+			after.num_allocations - before.num_allocations);
+}
+
+TEST(Global, ChangeMemoryPolicy) {
+	// blocks allocated before the policy is changed are freed correctly
+	for (auto policy : { LIBSAKURA_SYMBOL(MemoryPolicy_kThreadLocalPool),
+	LIBSAKURA_SYMBOL(MemoryPolicy_kDirect) }) {
+		auto const other_policy =
+				policy == LIBSAKURA_SYMBOL(MemoryPolicy_kDirect) ?
+						LIBSAKURA_SYMBOL(MemoryPolicy_kThreadLocalPool) :
+						LIBSAKURA_SYMBOL(MemoryPolicy_kDirect);
+		ASSERT_EQ(sakura_Status_kOK,
+				LIBSAKURA_SYMBOL(InitializeWithMemoryPolicy)(MyAtomicAllocate,
+						MyAtomicFree, policy));
+		LIBSAKURA_SYMBOL(CleanUp)();
+		atomic_alloc_count = 0;
+		atomic_free_count = 0;
+		LIBSAKURA_SYMBOL(LSQFitContextFloat) *context = nullptr;
+		ASSERT_EQ(sakura_Status_kOK,
+				LIBSAKURA_SYMBOL(CreateLSQFitContextPolynomialFloat)(
+						LIBSAKURA_SYMBOL(LSQFitType_kPolynomial), 5, 100,
+						&context));
+		LIBSAKURA_SYMBOL(CleanUp)();
+
+		ASSERT_EQ(sakura_Status_kOK,
+				LIBSAKURA_SYMBOL(InitializeWithMemoryPolicy)(MyAtomicAllocate,
+						MyAtomicFree, other_policy));
+		EXPECT_EQ(sakura_Status_kOK,
+				LIBSAKURA_SYMBOL(DestroyLSQFitContextFloat)(context));
+		LIBSAKURA_SYMBOL(CleanUp)();
+		EXPECT_LT(0U, atomic_alloc_count);
+		EXPECT_EQ(atomic_alloc_count, atomic_free_count);
+	}
+}
+
+namespace {
+
+/**
+ * Destroys a context when the thread exits, after the memory pool of the
+ * thread is destroyed.
+ */
+struct ContextHolder {
+	~ContextHolder() {
+		EXPECT_EQ(sakura_Status_kOK,
+				LIBSAKURA_SYMBOL(DestroyLSQFitContextFloat)(context));
+	}
+	LIBSAKURA_SYMBOL(LSQFitContextFloat) *context = nullptr;
+};
+
+void DestroyContextAtExit() {
+	// constructed before the pool, so that it is destroyed after the pool
+	static thread_local ContextHolder holder;
+	ASSERT_EQ(sakura_Status_kOK,
+			LIBSAKURA_SYMBOL(CreateLSQFitContextPolynomialFloat)(
+					LIBSAKURA_SYMBOL(LSQFitType_kPolynomial), 5, 100,
+					&holder.context));
+}
+
+}
+
+TEST(Global, FreeAfterThreadLocalPool) {
+	ASSERT_EQ(sakura_Status_kOK,
+			LIBSAKURA_SYMBOL(InitializeWithMemoryPolicy)(MyAtomicAllocate,
+					MyAtomicFree, LIBSAKURA_SYMBOL(MemoryPolicy_kThreadLocalPool)));
+	atomic_alloc_count = 0;
+	atomic_free_count = 0;
+	std::thread thread(DestroyContextAtExit);
+	thread.join();
+	EXPECT_LT(0U, atomic_alloc_count);
+	LIBSAKURA_SYMBOL(CleanUp)();
+	EXPECT_EQ(atomic_alloc_count, atomic_free_count);
+}
+
+TEST(Global, PerformanceThreadLocalPool) {
+	size_t const kNumRepeat = 100000;
+	for (auto policy : { LIBSAKURA_SYMBOL(MemoryPolicy_kDirect),
+	LIBSAKURA_SYMBOL(MemoryPolicy_kThreadLocalPool) }) {
+		sakura_Status result = LIBSAKURA_SYMBOL(InitializeWithMemoryPolicy)(
+				nullptr, nullptr, policy);
+		ASSERT_EQ(result, sakura_Status_kOK);
+		LIBSAKURA_SYMBOL(MemoryStatistics) before;
+		ASSERT_EQ(sakura_Status_kOK,
+				LIBSAKURA_SYMBOL(GetMemoryStatistics)(&before));
+		auto start = std::chrono::steady_clock::now();
+		std::vector<std::thread> threads;
+		for (size_t i = 0; i < 4; ++i) {
+			threads.push_back(
+					std::thread(CreateAndDestroyContexts, kNumRepeat / 4));
+		}
+		for (auto &thread : threads) {
+			thread.join();
+		}
+		auto end = std::chrono::steady_clock::now();
+		LIBSAKURA_SYMBOL(MemoryStatistics) after;
+		ASSERT_EQ(sakura_Status_kOK,
+				LIBSAKURA_SYMBOL(GetMemoryStatistics)(&after));
+		bool const is_pool = policy
+				== LIBSAKURA_SYMBOL(MemoryPolicy_kThreadLocalPool);
+		cout << "allocations: "
+				<< after.num_allocations - before.num_allocations
+				<< ", calls to allocator: "
+				<< after.num_upstream_allocations
+						- before.num_upstream_allocations << endl;
+		cout << "#x# benchmark MemoryPolicy_" << (is_pool ? "Pool" : "Direct")
+				<< " "
+				<< std::chrono::duration<double>(end - start).count() << endl;
+		LIBSAKURA_SYMBOL(CleanUp)();
+	}
+}
+
+namespace {
+
+LIBSAKURA_SYMBOL(KernelProfile) GetKernelProfile(char const *name) {
+	size_t num_kernels = 0;
+	EXPECT_EQ(sakura_Status_kOK,
+			LIBSAKURA_SYMBOL(GetKernelProfiles)(0, nullptr, &num_kernels));
+	std::vector<LIBSAKURA_SYMBOL(KernelProfile)> profiles(num_kernels);
+	size_t num_returned = 0;
+	EXPECT_EQ(sakura_Status_kOK,
+			LIBSAKURA_SYMBOL(GetKernelProfiles)(profiles.size(), profiles.data(),
+					&num_returned));
+	EXPECT_EQ(num_kernels, num_returned);
+	for (auto const &profile : profiles) {
+		if (string(profile.name) == name) {
+			return profile;
+		}
+	}
+	ADD_FAILURE() << name << " is not profiled";
+	return LIBSAKURA_SYMBOL(KernelProfile)();
+}
+
+void ComputeStatistics(size_t num_repeat) {
+	size_t const kNumData = 1024;
+	float *data = nullptr;
+	bool *is_valid = nullptr;
+	ASSERT_EQ(0, posix_memalign(reinterpret_cast<void **>(&data),
+			LIBSAKURA_SYMBOL(GetAlignment)(), sizeof(float) * kNumData));
+	ASSERT_EQ(0, posix_memalign(reinterpret_cast<void **>(&is_valid),
+			LIBSAKURA_SYMBOL(GetAlignment)(), sizeof(bool) * kNumData));
+	for (size_t i = 0; i < kNumData; ++i) {
+		data[i] = i;
+		is_valid[i] = true;
+	}
+	for (size_t i = 0; i < num_repeat; ++i) {
+		LIBSAKURA_SYMBOL(StatisticsResultFloat) result;
+		EXPECT_EQ(sakura_Status_kOK,
+				LIBSAKURA_SYMBOL(ComputeStatisticsFloat)(kNumData, data, is_valid,
+						&result));
+	}
+	free(is_valid);
+	free(data);
+}
+
+}
+
+TEST(Global, KernelProfilesInvalidArguments) {
+	LIBSAKURA_SYMBOL(KernelProfile) profile;
+	size_t num_kernels = 0;
+	EXPECT_EQ(sakura_Status_kInvalidArgument,
+			LIBSAKURA_SYMBOL(GetKernelProfiles)(1, &profile, nullptr));
+	EXPECT_EQ(sakura_Status_kInvalidArgument,
+			LIBSAKURA_SYMBOL(GetKernelProfiles)(1, nullptr, &num_kernels));
+}
+
+TEST(Global, KernelProfiles) {
+	sakura_Status result = LIBSAKURA_SYMBOL(Initialize)(nullptr, nullptr);
+	ASSERT_EQ(result, sakura_Status_kOK);
+	size_t num_kernels = 0;
+	ASSERT_EQ(sakura_Status_kOK,
+			LIBSAKURA_SYMBOL(GetKernelProfiles)(0, nullptr, &num_kernels));
+	if (!LIBSAKURA_SYMBOL(IsKernelProfilingEnabled)()) {
+		EXPECT_EQ(0U, num_kernels);
+		LIBSAKURA_SYMBOL(CleanUp)();
+		return;
+	}
+	EXPECT_LT(0U, num_kernels);
+
+	LIBSAKURA_SYMBOL(ResetKernelProfiles)();
+	auto profile = GetKernelProfile("ComputeStatisticsFloat");
+	EXPECT_EQ(0U, profile.num_calls);
+	EXPECT_EQ(nullptr, profile.simd_path);
+
+	// counts of the calling thread and an exited thread are summed up
+	ComputeStatistics(3);
+	std::thread thread(ComputeStatistics, 2);
+	thread.join();
+	profile = GetKernelProfile("ComputeStatisticsFloat");
+	EXPECT_EQ(5U, profile.num_calls);
+	EXPECT_EQ(5U * 1024 * (sizeof(float) + sizeof(bool)), profile.num_bytes);
+	EXPECT_LT(0U, profile.total_nanoseconds);
+	EXPECT_LE(profile.max_nanoseconds, profile.total_nanoseconds);
+	EXPECT_LE(profile.total_nanoseconds, 5 * profile.max_nanoseconds);
+	ASSERT_NE(nullptr, profile.simd_path);
+	cout << "ComputeStatisticsFloat ran " << profile.simd_path << endl;
+	EXPECT_EQ(0U, GetKernelProfile("ComputeQuantilesFloat").num_calls);
+
+	LIBSAKURA_SYMBOL(ResetKernelProfiles)();
+	profile = GetKernelProfile("ComputeStatisticsFloat");
+	EXPECT_EQ(0U, profile.num_calls);
+	EXPECT_EQ(0U, profile.total_nanoseconds);
+	ComputeStatistics(1);
+	EXPECT_EQ(1U, GetKernelProfile("ComputeStatisticsFloat").num_calls);
+	LIBSAKURA_SYMBOL(CleanUp)();
+}
+
+TEST(Global, KernelProfilesOfPlanAndMedian) {
+	sakura_Status result = LIBSAKURA_SYMBOL(Initialize)(nullptr, nullptr);
+	ASSERT_EQ(result, sakura_Status_kOK);
+	if (!LIBSAKURA_SYMBOL(IsKernelProfilingEnabled)()) {
+		LIBSAKURA_SYMBOL(CleanUp)();
+		return;
+	}
+	LIBSAKURA_SYMBOL(ResetKernelProfiles)();
+
+	size_t const kNumBase = 4;
+	size_t const kNumInterpolated = 3;
+	size_t const kNumArray = 2;
+	double const base_position[kNumBase] = { 0., 1., 2., 3. };
+	double const interpolated_position[kNumInterpolated] = { 0.5, 1.5, 2.5 };
+	size_t const kNumElements = kNumBase * kNumArray;
+	float *data = nullptr;
+	bool *mask = nullptr;
+	float *interpolated_data = nullptr;
+	bool *interpolated_mask = nullptr;
+	ASSERT_EQ(0, posix_memalign(reinterpret_cast<void **>(&data),
+			LIBSAKURA_SYMBOL(GetAlignment)(), sizeof(float) * kNumElements));
+	ASSERT_EQ(0, posix_memalign(reinterpret_cast<void **>(&mask),
+			LIBSAKURA_SYMBOL(GetAlignment)(), sizeof(bool) * kNumElements));
+	ASSERT_EQ(0, posix_memalign(reinterpret_cast<void **>(&interpolated_data),
+			LIBSAKURA_SYMBOL(GetAlignment)(), sizeof(float) * kNumElements));
+	ASSERT_EQ(0, posix_memalign(reinterpret_cast<void **>(&interpolated_mask),
+			LIBSAKURA_SYMBOL(GetAlignment)(), sizeof(bool) * kNumElements));
+	for (size_t i = 0; i < kNumElements; ++i) {
+		data[i] = i;
+		mask[i] = true;
+	}
+
+	LIBSAKURA_SYMBOL(InterpolationPlanFloat) *plan = nullptr;
+	ASSERT_EQ(sakura_Status_kOK,
+			LIBSAKURA_SYMBOL(CreateInterpolationPlanFloat)(
+					LIBSAKURA_SYMBOL(InterpolationMethod_kLinear), 0, kNumBase,
+					base_position, kNumInterpolated, interpolated_position,
+					&plan));
+	EXPECT_EQ(sakura_Status_kOK,
+			LIBSAKURA_SYMBOL(ExecuteInterpolationPlanXAxisFloat)(plan,
+					kNumArray, data, mask, interpolated_data,
+					interpolated_mask));
+	EXPECT_EQ(sakura_Status_kOK,
+			LIBSAKURA_SYMBOL(DestroyInterpolationPlanFloat)(plan));
+	auto profile = GetKernelProfile("ExecuteInterpolationPlanXAxisFloat");
+	EXPECT_EQ(1U, profile.num_calls);
+	EXPECT_EQ(kNumBase * kNumArray * (sizeof(float) + sizeof(bool)),
+			profile.num_bytes);
+	EXPECT_EQ(0U, GetKernelProfile("ExecuteInterpolationPlanYAxisFloat").num_calls);
+	EXPECT_EQ(0U, GetKernelProfile("InterpolateXAxisFloat").num_calls);
+
+	// the median is not counted as a median absolute deviation
+	float median = 0.f;
+	size_t num_valid = 0;
+	EXPECT_EQ(sakura_Status_kOK,
+			LIBSAKURA_SYMBOL(ComputeMedianFloat)(kNumElements, mask, data,
+					&median, &num_valid));
+	EXPECT_EQ(1U, GetKernelProfile("ComputeMedianFloat").num_calls);
+	EXPECT_EQ(0U,
+			GetKernelProfile("ComputeMedianAndMedianAbsoluteDeviationFloat").num_calls);
+
+	free(interpolated_mask);
+	free(interpolated_data);
+	free(mask);
+	free(data);
+	LIBSAKURA_SYMBOL(CleanUp)();
+}
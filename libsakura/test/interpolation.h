@@ -100,6 +100,45 @@ protected:
 		//std::cout << "Elapsed time " << elapsed << " sec" << std::endl;
 		return elapsed;
 	}
+	double RunInterpolationPlan(sakura_InterpolationMethod interpolation_method,
+			size_t num_base, size_t num_interpolated, size_t num_array,
+			size_t iteration = 1) {
+		// sakura must be properly initialized
+		EXPECT_EQ(sakura_Status_kOK, initialize_result_)
+				<< "sakura must be properly initialized!";
+
+		// result of the plan must be identical to the one without plan
+		for (size_t i = 0; i < num_interpolated * num_array; ++i) {
+			y_expected_[i] = 0.0f;
+			y_interpolated_[i] = 0.0f;
+		}
+		sakura_Status result = T::Run(interpolation_method, polynomial_order_,
+				num_base, x_base_, num_array, y_base_, mask_base_,
+				num_interpolated, x_interpolated_, y_expected_, mask_expected_);
+		EXPECT_EQ(sakura_Status_kOK, result);
+
+		sakura_InterpolationPlanFloat *plan = nullptr;
+		result = sakura_CreateInterpolationPlanFloat(interpolation_method,
+				polynomial_order_, num_base, x_base_, num_interpolated,
+				x_interpolated_, &plan);
+		EXPECT_EQ(sakura_Status_kOK, result);
+		if (result != sakura_Status_kOK) {
+			return 0.0;
+		}
+		double elapsed = 0.0;
+		for (size_t iter = 0; iter < iteration; ++iter) {
+			double start = GetCurrentTime();
+			result = T::RunPlan(plan, num_array, y_base_, mask_base_,
+					y_interpolated_, mask_interpolated_);
+			double end = GetCurrentTime();
+			elapsed += end - start;
+			EXPECT_EQ(sakura_Status_kOK, result);
+		}
+		EXPECT_EQ(sakura_Status_kOK, sakura_DestroyInterpolationPlanFloat(plan));
+		InspectResult(sakura_Status_kOK, result, num_interpolated, num_array,
+				true, true);
+		return elapsed;
+	}
 	void InitializePointers() {
 		x_base_ = nullptr;
 		y_base_ = nullptr;
@@ -48,6 +48,12 @@ struct Runner {
 				x_base, num_array, y_base, mask_base, num_interpolated,
 				x_interpolated, y_interpolated, mask_interpolated);
 	}
+	static sakura_Status RunPlan(sakura_InterpolationPlanFloat *plan,
+			size_t num_array, float const y_base[], bool const mask_base[],
+			float y_interpolated[], bool mask_interpolated[]) {
+		return sakura_ExecuteInterpolationPlanXAxisFloat(plan, num_array,
+				y_base, mask_base, y_interpolated, mask_interpolated);
+	}
 };
 typedef InterpolateFloatTestBase<Runner> InterpolateArray1DFloatTest;
 
@@ -1366,3 +1372,126 @@ TEST_INTERP_X(SplineComparisonWithAsap) {
 //	}
 //}
 
+TEST_INTERP_X(InterpolationPlan) {
+	// initial setup
+	size_t const num_base = 37;
+	size_t const num_interpolated = 301;
+	size_t const num_array = 5;
+	polynomial_order_ = 3;
+	AllocateMemory(num_base, num_interpolated, num_array);
+	sakura_InterpolationMethod const methods[] = {
+			sakura_InterpolationMethod_kNearest,
+			sakura_InterpolationMethod_kLinear,
+			sakura_InterpolationMethod_kPolynomial,
+			sakura_InterpolationMethod_kSpline };
+	for (auto method : methods) {
+		for (size_t sort_order = 0; sort_order < 4; ++sort_order) {
+			bool const is_base_ascending = (sort_order & 1) == 0;
+			bool const is_interp_ascending = (sort_order & 2) == 0;
+			for (size_t i = 0; i < num_base; ++i) {
+				// positions are not equally spaced
+				double const x = static_cast<double>(i)
+						+ 0.3 * std::sin(static_cast<double>(i));
+				x_base_[is_base_ascending ? i : num_base - 1 - i] = x;
+			}
+			EquallySpacedGrid(num_interpolated,
+					is_interp_ascending ? -2.0 : 40.0,
+					is_interp_ascending ? 40.0 : -2.0, x_interpolated_);
+			for (size_t iarray = 0; iarray < num_array; ++iarray) {
+				for (size_t i = 0; i < num_base; ++i) {
+					size_t const index = iarray * num_base + i;
+					y_base_[index] = 1.5f
+							+ std::sin(0.37f * static_cast<float>(index));
+					// array 1 is partially masked, array 2 is fully masked
+					// and array 3 has only one valid data
+					mask_base_[index] = (iarray != 1 || i % 5 != 2)
+							&& iarray != 2 && (iarray != 3 || i == 10);
+				}
+			}
+			RunInterpolationPlan(method, num_base, num_interpolated,
+					num_array);
+		}
+	}
+}
+
+TEST_INTERP_X(InterpolationPlanInvalidArguments) {
+	// initial setup
+	size_t const num_base = 3;
+	size_t const num_interpolated = 4;
+	size_t const num_array = 1;
+	AllocateMemory(num_base, num_interpolated, num_array);
+	InitializeDoubleArray(num_base, x_base_, 0.0, 1.0, 2.0);
+	InitializeDoubleArray(num_interpolated, x_interpolated_, 0.0, 0.5, 1.0,
+			1.5);
+
+	sakura_InterpolationPlanFloat *plan = nullptr;
+	EXPECT_EQ(sakura_Status_kInvalidArgument,
+			sakura_CreateInterpolationPlanFloat(
+					sakura_InterpolationMethod_kNumElements, 0, num_base,
+					x_base_, num_interpolated, x_interpolated_, &plan));
+	EXPECT_EQ(nullptr, plan);
+	EXPECT_EQ(sakura_Status_kInvalidArgument,
+			sakura_CreateInterpolationPlanFloat(
+					sakura_InterpolationMethod_kLinear, 0, 0, x_base_,
+					num_interpolated, x_interpolated_, &plan));
+	EXPECT_EQ(sakura_Status_kInvalidArgument,
+			sakura_CreateInterpolationPlanFloat(
+					sakura_InterpolationMethod_kLinear, 0, num_base, nullptr,
+					num_interpolated, x_interpolated_, &plan));
+	EXPECT_EQ(sakura_Status_kInvalidArgument,
+			sakura_CreateInterpolationPlanFloat(
+					sakura_InterpolationMethod_kLinear, 0, num_base, x_base_,
+					num_interpolated, x_interpolated_, nullptr));
+	// not sorted
+	InitializeDoubleArray(num_base, x_base_, 0.0, 2.0, 1.0);
+	EXPECT_EQ(sakura_Status_kInvalidArgument,
+			sakura_CreateInterpolationPlanFloat(
+					sakura_InterpolationMethod_kLinear, 0, num_base, x_base_,
+					num_interpolated, x_interpolated_, &plan));
+	EXPECT_EQ(nullptr, plan);
+
+	InitializeDoubleArray(num_base, x_base_, 0.0, 1.0, 2.0);
+	ASSERT_EQ(sakura_Status_kOK,
+			sakura_CreateInterpolationPlanFloat(
+					sakura_InterpolationMethod_kLinear, 0, num_base, x_base_,
+					num_interpolated, x_interpolated_, &plan));
+	EXPECT_EQ(sakura_Status_kInvalidArgument,
+			sakura_ExecuteInterpolationPlanXAxisFloat(nullptr, num_array,
+					y_base_, mask_base_, y_interpolated_, mask_interpolated_));
+	EXPECT_EQ(sakura_Status_kInvalidArgument,
+			sakura_ExecuteInterpolationPlanXAxisFloat(plan, num_array,
+					nullptr, mask_base_, y_interpolated_, mask_interpolated_));
+	EXPECT_EQ(sakura_Status_kInvalidArgument,
+			sakura_ExecuteInterpolationPlanXAxisFloat(plan, num_array,
+					y_base_ + 1, mask_base_, y_interpolated_,
+					mask_interpolated_));
+	EXPECT_EQ(sakura_Status_kOK,
+			sakura_ExecuteInterpolationPlanXAxisFloat(plan, 0, nullptr,
+					nullptr, nullptr, nullptr));
+	EXPECT_EQ(sakura_Status_kOK, sakura_DestroyInterpolationPlanFloat(plan));
+	EXPECT_EQ(sakura_Status_kInvalidArgument,
+			sakura_DestroyInterpolationPlanFloat(nullptr));
+}
+
+TEST_INTERP_X(InterpolationPlanPerformance) {
+	// initial setup
+	size_t const num_base = 256;
+	size_t const num_interpolated = 4096;
+	size_t const num_array = 1;
+	size_t const iter = 20000;
+	AllocateMemory(num_base, num_interpolated, num_array);
+	EquallySpacedGrid(num_base, 0.0, 100.0, x_base_);
+	for (size_t i = 0; i < num_base * num_array; ++i) {
+		y_base_[i] = static_cast<float>(i);
+	}
+	EquallySpacedGrid(num_interpolated, 0.0, 100.0, x_interpolated_);
+
+	// execute interpolation
+	double elapsed = RunInterpolateArray1D(sakura_InterpolationMethod_kSpline,
+			num_base, num_interpolated, num_array, sakura_Status_kOK, false,
+			false, iter);
+	LogElapsed("InterpolationX_SplineWithoutPlanPerformance", elapsed);
+	elapsed = RunInterpolationPlan(sakura_InterpolationMethod_kSpline, num_base,
+			num_interpolated, num_array, iter);
+	LogElapsed("InterpolationX_SplineWithPlanPerformance", elapsed);
+}
@@ -47,6 +47,12 @@ struct Runner {
 				x_base, num_array, y_base, mask_base, num_interpolated,
 				x_interpolated, y_interpolated, mask_interpolated);
 	}
+	static sakura_Status RunPlan(sakura_InterpolationPlanFloat *plan,
+			size_t num_array, float const y_base[], bool const mask_base[],
+			float y_interpolated[], bool mask_interpolated[]) {
+		return sakura_ExecuteInterpolationPlanYAxisFloat(plan, num_array,
+				y_base, mask_base, y_interpolated, mask_interpolated);
+	}
 };
 typedef InterpolateFloatTestBase<Runner> InterpolateArray1DFloatTest;
 
@@ -1002,3 +1008,44 @@ PERFORMANCE_TEST(SplineOppositePerformance, sakura_InterpolationMethod_kSpline,
 //	}
 //}
 
+TEST_INTERP_Y(InterpolationPlan) {
+	// initial setup
+	size_t const num_base = 37;
+	size_t const num_interpolated = 301;
+	size_t const num_array = 5;
+	polynomial_order_ = 3;
+	AllocateMemory(num_base, num_interpolated, num_array);
+	sakura_InterpolationMethod const methods[] = {
+			sakura_InterpolationMethod_kNearest,
+			sakura_InterpolationMethod_kLinear,
+			sakura_InterpolationMethod_kPolynomial,
+			sakura_InterpolationMethod_kSpline };
+	for (auto method : methods) {
+		for (size_t sort_order = 0; sort_order < 4; ++sort_order) {
+			bool const is_base_ascending = (sort_order & 1) == 0;
+			bool const is_interp_ascending = (sort_order & 2) == 0;
+			for (size_t i = 0; i < num_base; ++i) {
+				// positions are not equally spaced
+				double const x = static_cast<double>(i)
+						+ 0.3 * std::sin(static_cast<double>(i));
+				x_base_[is_base_ascending ? i : num_base - 1 - i] = x;
+			}
+			EquallySpacedGrid(num_interpolated,
+					is_interp_ascending ? -2.0 : 40.0,
+					is_interp_ascending ? 40.0 : -2.0, x_interpolated_);
+			for (size_t iarray = 0; iarray < num_array; ++iarray) {
+				for (size_t i = 0; i < num_base; ++i) {
+					size_t const index = i * num_array + iarray;
+					y_base_[index] = 1.5f
+							+ std::sin(0.37f * static_cast<float>(index));
+					// array 1 is partially masked, array 2 is fully masked
+					// and array 3 has only one valid data
+					mask_base_[index] = (iarray != 1 || i % 5 != 2)
+							&& iarray != 2 && (iarray != 3 || i == 10);
+				}
+			}
+			RunInterpolationPlan(method, num_base, num_interpolated,
+					num_array);
+		}
+	}
+}
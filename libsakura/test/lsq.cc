@@ -2305,6 +2305,166 @@ TEST_F(Lsq, SubtractSinusoidFloat) {
 	RunTest(ApiName_kSubtractSinusoidFloat);
 }
 
+/*
+ * Fit many spectra by LSQFitPolynomialBatchFloat and compare the
+ * results with those of LSQFitPolynomialFloat for each spectrum.
+ * Runs of identical masks cross the blocks assigned to threads.
+ */
+void RunLSQFitPolynomialBatch(size_t num_spectra, size_t num_data,
+		uint16_t order, size_t num_threads, size_t num_repeat) {
+	size_t const num_coeff = order + 1;
+	LIBSAKURA_SYMBOL(LSQFitContextFloat) *context = nullptr;
+	ASSERT_EQ(Ret_kOK,
+			LIBSAKURA_SYMBOL(CreateLSQFitContextPolynomialFloat)(
+					LIBSAKURA_SYMBOL(LSQFitType_kPolynomial), order, num_data,
+					&context));
+	float *data = nullptr, *best_fit = nullptr, *residual = nullptr, *rms =
+			nullptr;
+	bool *mask = nullptr, *final_mask = nullptr;
+	double *coeff = nullptr;
+	LIBSAKURA_SYMBOL(LSQFitStatus) *lsqfit_status = nullptr;
+	void *storage[8];
+	size_t const num_total = num_spectra * num_data;
+	AllocateAligned(num_total, &data, &storage[0]);
+	AllocateAligned(num_total, &mask, &storage[1]);
+	AllocateAligned(num_spectra * num_coeff, &coeff, &storage[2]);
+	AllocateAligned(num_total, &best_fit, &storage[3]);
+	AllocateAligned(num_total, &residual, &storage[4]);
+	AllocateAligned(num_spectra, &rms, &storage[5]);
+	AllocateAligned(num_spectra, &lsqfit_status, &storage[6]);
+	AllocateAligned(num_data, &final_mask, &storage[7]);
+
+	std::mt19937 engine(0);
+	std::normal_distribution<float> noise(0.0f, 0.1f);
+	for (size_t j = 0; j < num_spectra; ++j) {
+		// a few distinct masks, each shared by consecutive spectra
+		size_t const mask_id = (j / 100) % 3;
+		for (size_t i = 0; i < num_data; ++i) {
+			double const x = static_cast<double>(i) / num_data;
+			data[j * num_data + i] = static_cast<float>(1.0 + j % 7
+					- 2.0 * x + 3.0 * x * x) + noise(engine);
+			mask[j * num_data + i] = (i % (mask_id + 3) != 0);
+		}
+	}
+
+	double start = GetCurrentTime();
+	for (size_t irun = 0; irun < num_repeat; ++irun) {
+		ASSERT_EQ(Ret_kOK,
+				LIBSAKURA_SYMBOL(LSQFitPolynomialBatchFloat)(context, order,
+						num_spectra, num_data, data, mask, num_coeff, coeff,
+						best_fit, residual, rms, num_threads, lsqfit_status));
+	}
+	double end = GetCurrentTime();
+	if (num_repeat > 1) {
+		cout << setprecision(5) << "#x# benchmark Lsq_LSQFitPolynomialBatchFloat_"
+				<< num_threads << "threads " << end - start << endl;
+	}
+
+	SIMD_ALIGN
+	double coeff_single[num_coeff];
+	float *best_fit_single = nullptr, *residual_single = nullptr;
+	void *storage_single[2];
+	AllocateAligned(num_data, &best_fit_single, &storage_single[0]);
+	AllocateAligned(num_data, &residual_single, &storage_single[1]);
+	start = GetCurrentTime();
+	for (size_t irun = 0; irun < num_repeat; ++irun) {
+		for (size_t j = 0; j < num_spectra; ++j) {
+			float rms_single;
+			LIBSAKURA_SYMBOL(LSQFitStatus) status_single;
+			ASSERT_EQ(Ret_kOK,
+					LIBSAKURA_SYMBOL(LSQFitPolynomialFloat)(context, order,
+							num_data, &data[j * num_data], &mask[j * num_data],
+							5.0f, 1, num_coeff, coeff_single, best_fit_single,
+							residual_single, final_mask, &rms_single,
+							&status_single));
+			if (num_repeat > 1) {
+				continue;
+			}
+			EXPECT_EQ(LIBSAKURA_SYMBOL(LSQFitStatus_kOK), lsqfit_status[j]);
+			CheckAlmostEqual(rms_single, rms[j], 1e-3f);
+			for (size_t i = 0; i < num_coeff; ++i) {
+				CheckAlmostEqual(coeff_single[i], coeff[j * num_coeff + i],
+						1e-4);
+			}
+			for (size_t i = 0; i < num_data; ++i) {
+				CheckAlmostEqual(best_fit_single[i],
+						best_fit[j * num_data + i], 1e-5f);
+				CheckAlmostEqual(residual_single[i],
+						residual[j * num_data + i], 1e-4f);
+			}
+		}
+	}
+	end = GetCurrentTime();
+	if (num_repeat > 1) {
+		cout << setprecision(5) << "#x# benchmark Lsq_LSQFitPolynomialFloat_"
+				<< num_spectra << "spectra " << end - start << endl;
+	}
+
+	for (auto ptr : storage) {
+		LIBSAKURA_PREFIX::Memory::Free(ptr);
+	}
+	for (auto ptr : storage_single) {
+		LIBSAKURA_PREFIX::Memory::Free(ptr);
+	}
+	EXPECT_EQ(Ret_kOK, LIBSAKURA_SYMBOL(DestroyLSQFitContextFloat)(context));
+}
+
+TEST_F(Lsq, LSQFitPolynomialBatchFloat) {
+	RunLSQFitPolynomialBatch(450, 128, 3, 1, 1);
+	RunLSQFitPolynomialBatch(450, 128, 3, 4, 1);
+	RunLSQFitPolynomialBatch(0, 128, 3, 4, 1);
+}
+
+TEST_F(Lsq, LSQFitPolynomialBatchFloatNotEnoughData) {
+	size_t const num_spectra = 3;
+	size_t const num_data = NUM_DATA;
+	uint16_t const order = 2;
+	size_t const num_coeff = order + 1;
+	LIBSAKURA_SYMBOL(LSQFitContextFloat) *context = nullptr;
+	ASSERT_EQ(Ret_kOK,
+			LIBSAKURA_SYMBOL(CreateLSQFitContextPolynomialFloat)(
+					LIBSAKURA_SYMBOL(LSQFitType_kPolynomial), order, num_data,
+					&context));
+	SIMD_ALIGN
+	float data[num_spectra * num_data];
+	SIMD_ALIGN
+	bool mask[ELEMENTSOF(data)];
+	SIMD_ALIGN
+	double coeff[num_spectra * num_coeff];
+	SIMD_ALIGN
+	float rms[num_spectra];
+	LIBSAKURA_SYMBOL(LSQFitStatus) lsqfit_status[num_spectra];
+	for (size_t i = 0; i < ELEMENTSOF(data); ++i) {
+		data[i] = 1.0f;
+		// the second spectrum has only two unmasked data
+		mask[i] = (i / num_data != 1) || (i % num_data < 2);
+	}
+	EXPECT_EQ(Ret_kNG,
+			LIBSAKURA_SYMBOL(LSQFitPolynomialBatchFloat)(context, order,
+					num_spectra, num_data, data, mask, num_coeff, coeff,
+					nullptr, nullptr, rms, 1, lsqfit_status));
+	EXPECT_EQ(LIBSAKURA_SYMBOL(LSQFitStatus_kOK), lsqfit_status[0]);
+	EXPECT_EQ(LIBSAKURA_SYMBOL(LSQFitStatus_kNotEnoughData), lsqfit_status[1]);
+	EXPECT_EQ(LIBSAKURA_SYMBOL(LSQFitStatus_kOK), lsqfit_status[2]);
+	CheckAlmostEqual(1.0, coeff[2 * num_coeff]);
+	CheckAlmostEqual(0.0f, rms[2]);
+
+	EXPECT_EQ(Ret_kIA,
+			LIBSAKURA_SYMBOL(LSQFitPolynomialBatchFloat)(context, order + 1,
+					num_spectra, num_data, data, mask, num_coeff, coeff,
+					nullptr, nullptr, rms, 1, lsqfit_status));
+	EXPECT_EQ(Ret_kIA,
+			LIBSAKURA_SYMBOL(LSQFitPolynomialBatchFloat)(context, order,
+					num_spectra, num_data, data, mask, num_coeff, coeff,
+					nullptr, nullptr, nullptr, 1, lsqfit_status));
+	EXPECT_EQ(Ret_kOK, LIBSAKURA_SYMBOL(DestroyLSQFitContextFloat)(context));
+}
+
+TEST_F(Lsq, LSQFitPolynomialBatchFloatPerformance) {
+	RunLSQFitPolynomialBatch(20000, 1024, 3, 1, 5);
+	RunLSQFitPolynomialBatch(20000, 1024, 3, 4, 5);
+}
+
 //*******************************************************
 //Test variadic template handling
 //*******************************************************
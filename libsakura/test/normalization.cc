@@ -168,6 +168,23 @@ struct IntrinsicsTestInitializer {
 	}
 };
 
+template<size_t NUM_DATA, size_t NUM_SCALING>
+struct RemainderTestInitializer {
+	static void Initialize(float scaling_factor[], float target[],
+			float reference[], float expected[]) {
+		static_assert(NUM_SCALING == NUM_DATA || NUM_SCALING == 1, "");
+		for (size_t i = 0; i < NUM_SCALING; ++i) {
+			scaling_factor[i] = 0.5f + i;
+		}
+		for (size_t i = 0; i < NUM_DATA; ++i) {
+			target[i] = 3.0f * i - 7.0f;
+			reference[i] = 1.0f + 0.25f * i;
+			float const factor = scaling_factor[(NUM_SCALING == 1) ? 0 : i];
+			expected[i] = factor * (target[i] - reference[i]) / reference[i];
+		}
+	}
+};
+
 class TestLogger {
 public:
 	static void LogElapsed(const char *name, size_t num_segments,
@@ -398,6 +415,17 @@ APPLYCAL_FLOAT_TEST(IntrinsicsTest) {
 			"Intrinsics");
 }
 
+APPLYCAL_FLOAT_TEST(RemainderTest) {
+	// the length is not a multiple of any SIMD width
+	RunTest<RemainderTestInitializer<37, 37>, EmptyHelper, 37, 37, false>(
+			"Remainder");
+}
+
+APPLYCAL_FLOAT_TEST(InPlaceRemainderSingleScalingFactor) {
+	RunTest<RemainderTestInitializer<37, 1>, EmptyHelper, 37, 1, true>(
+			"InPlaceRemainderSingleScalingFactor");
+}
+
 APPLYCAL_FLOAT_TEST(PerformanceTestAllAtOnce) {
 	RunPerformanceTest<10, 1, 40000000, 40000000, false>("AllAtOnce");
 }
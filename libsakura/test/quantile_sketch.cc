@@ -0,0 +1,498 @@
+/*
+ * @SAKURA_LICENSE_HEADER_START@
+ * Copyright (C) 2013-2022
+ * Inter-University Research Institute Corporation, National Institutes of Natural Sciences
+ * 2-21-1, Osawa, Mitaka, Tokyo, 181-8588, Japan.
+ *
+ * This file is part of Sakura.
+ *
+ * Sakura is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or (at your
+ * option) any later version.
+ *
+ * Sakura is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public
+ * License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Sakura.  If not, see <http://www.gnu.org/licenses/>.
+ * @SAKURA_LICENSE_HEADER_END@
+ */
+/*
+ * quantile_sketch.cc
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <vector>
+
+#include <libsakura/sakura.h>
+#include <libsakura/localdef.h>
+#include "loginit.h"
+#include "gtest/gtest.h"
+#include "testutil.h"
+
+namespace {
+
+constexpr size_t kK = 200;
+
+/*
+ * Rank error allowed in the tests. The documented bound for k = 200 is about
+ * 1.3% with probability 99%.
+ */
+constexpr double kMaxNormalizedRankError = 0.02;
+
+/*
+ * Data drawn from a mixture of two normal distributions with 10% masked
+ */
+struct Dataset {
+	Dataset(size_t num_data, unsigned seed) :
+			data(num_data), is_valid(num_data) {
+		std::mt19937 engine(seed);
+		std::normal_distribution<float> narrow(0.f, 1.f);
+		std::normal_distribution<float> wide(5.f, 10.f);
+		std::uniform_int_distribution<int> percent(0, 99);
+		for (size_t i = 0; i < num_data; ++i) {
+			data[i] = percent(engine) < 70 ? narrow(engine) : wide(engine);
+			is_valid[i] = percent(engine) >= 10;
+			if (!is_valid[i] && percent(engine) < 50) {
+				data[i] = NAN;
+			}
+		}
+	}
+	/*
+	 * Returns valid data sorted in ascending order
+	 */
+	std::vector<float> SortedValidData() const {
+		std::vector<float> sorted;
+		for (size_t i = 0; i < data.size(); ++i) {
+			if (is_valid[i]) {
+				sorted.push_back(data[i]);
+			}
+		}
+		std::sort(sorted.begin(), sorted.end());
+		return sorted;
+	}
+	std::vector<float> data;
+	// std::vector<bool> can not be passed as bool[]
+	struct Mask {
+		explicit Mask(size_t n) :
+				storage(new bool[n]) {
+		}
+		bool &operator[](size_t i) {
+			return storage[i];
+		}
+		bool operator[](size_t i) const {
+			return storage[i];
+		}
+		bool const *get() const {
+			return storage.get();
+		}
+		std::unique_ptr<bool[]> storage;
+	} is_valid;
+};
+
+/*
+ * Returns the largest distance, normalized by the number of data, between
+ * the rank of an approximate quantile and p * (n - 1) over probabilities p.
+ */
+double MaxNormalizedRankError(std::vector<float> const &sorted,
+		std::vector<double> const &probability,
+		std::vector<float> const &quantile) {
+	double max_error = 0.;
+	double const n = static_cast<double>(sorted.size());
+	for (size_t i = 0; i < probability.size(); ++i) {
+		double const expected_rank = probability[i] * (n - 1);
+		// ranks of elements equal to the quantile are [lower, upper)
+		double const lower = std::lower_bound(sorted.begin(), sorted.end(),
+				quantile[i]) - sorted.begin();
+		double const upper = std::upper_bound(sorted.begin(), sorted.end(),
+				quantile[i]) - sorted.begin();
+		double error = 0.;
+		if (expected_rank < lower) {
+			error = lower - expected_rank;
+		} else if (expected_rank > upper) {
+			error = expected_rank - upper;
+		}
+		max_error = std::max(max_error, error / n);
+	}
+	return max_error;
+}
+
+std::vector<double> MakeProbabilities() {
+	std::vector<double> probability;
+	for (int i = 0; i <= 100; ++i) {
+		probability.push_back(i / 100.);
+	}
+	return probability;
+}
+
+class QuantileSketch: public ::testing::Test {
+protected:
+	virtual void SetUp() {
+		LIBSAKURA_SYMBOL(Status) status = LIBSAKURA_SYMBOL(Initialize)(nullptr,
+				nullptr);
+		ASSERT_EQ(LIBSAKURA_SYMBOL(Status_kOK), status);
+	}
+	virtual void TearDown() {
+		LIBSAKURA_SYMBOL(CleanUp)();
+	}
+};
+
+typedef std::unique_ptr<LIBSAKURA_SYMBOL(QuantileSketchFloat),
+		decltype(&LIBSAKURA_SYMBOL(DestroyQuantileSketchFloat))> SketchPtr;
+
+SketchPtr CreateSketch(size_t k) {
+	LIBSAKURA_SYMBOL(QuantileSketchFloat) *sketch = nullptr;
+	LIBSAKURA_SYMBOL(Status) status = LIBSAKURA_SYMBOL(
+			CreateQuantileSketchFloat)(k, &sketch);
+	EXPECT_EQ(LIBSAKURA_SYMBOL(Status_kOK), status);
+	return SketchPtr(sketch, LIBSAKURA_SYMBOL(DestroyQuantileSketchFloat));
+}
+
+std::vector<float> Query(LIBSAKURA_SYMBOL(QuantileSketchFloat) const *sketch,
+		std::vector<double> const &probability, size_t *num_data) {
+	std::vector<float> quantile(probability.size());
+	LIBSAKURA_SYMBOL(Status) status = LIBSAKURA_SYMBOL(
+			QueryQuantileSketchFloat)(sketch, probability.size(),
+			probability.data(), quantile.data(), num_data);
+	EXPECT_EQ(LIBSAKURA_SYMBOL(Status_kOK), status);
+	return quantile;
+}
+
+std::vector<char> Serialize(
+LIBSAKURA_SYMBOL(QuantileSketchFloat) const *sketch) {
+	size_t size = 0;
+	EXPECT_EQ(LIBSAKURA_SYMBOL(Status_kOK),
+			LIBSAKURA_SYMBOL(GetQuantileSketchSerializedSizeFloat)(sketch,
+					&size));
+	std::vector<char> buffer(size);
+	EXPECT_EQ(LIBSAKURA_SYMBOL(Status_kOK),
+			LIBSAKURA_SYMBOL(SerializeQuantileSketchFloat)(sketch, size,
+					buffer.data()));
+	return buffer;
+}
+
+} /* anonymous namespace */
+
+/*
+ * An empty sketch returns NaN
+ */
+TEST_F(QuantileSketch, Empty) {
+	auto sketch = CreateSketch(kK);
+	Dataset dataset(100, 1);
+	std::fill(&dataset.is_valid[0], &dataset.is_valid[0] + 100, false);
+	EXPECT_EQ(LIBSAKURA_SYMBOL(Status_kOK),
+			LIBSAKURA_SYMBOL(UpdateQuantileSketchFloat)(sketch.get(), 100,
+					dataset.data.data(), dataset.is_valid.get()));
+	auto const probability = MakeProbabilities();
+	size_t num_data = 1;
+	auto quantile = Query(sketch.get(), probability, &num_data);
+	EXPECT_EQ(0u, num_data);
+	for (auto q : quantile) {
+		EXPECT_TRUE(std::isnan(q));
+	}
+}
+
+/*
+ * Quantiles are exact until data are discarded
+ */
+TEST_F(QuantileSketch, ExactForSmallData) {
+	auto const probability = MakeProbabilities();
+	for (size_t num_data : { size_t(1), size_t(2), size_t(3), size_t(100), kK,
+			size_t(1024) }) {
+		auto sketch = CreateSketch(kK);
+		Dataset dataset(num_data, static_cast<unsigned>(num_data));
+		dataset.is_valid[0] = true;
+		dataset.data[0] = 0.5f;
+		// update in two steps
+		size_t const half = num_data / 2;
+		EXPECT_EQ(LIBSAKURA_SYMBOL(Status_kOK),
+				LIBSAKURA_SYMBOL(UpdateQuantileSketchFloat)(sketch.get(), half,
+						dataset.data.data(), dataset.is_valid.get()));
+		EXPECT_EQ(LIBSAKURA_SYMBOL(Status_kOK),
+				LIBSAKURA_SYMBOL(UpdateQuantileSketchFloat)(sketch.get(),
+						num_data - half, &dataset.data[half],
+						&dataset.is_valid.get()[half]));
+		size_t sketch_num_data = 0;
+		auto quantile = Query(sketch.get(), probability, &sketch_num_data);
+
+		std::vector<float> work(dataset.data);
+		std::vector<float> expected(probability.size());
+		size_t valid_count = 0;
+		EXPECT_EQ(LIBSAKURA_SYMBOL(Status_kOK),
+				LIBSAKURA_SYMBOL(ComputeQuantilesFloat)(num_data,
+						dataset.is_valid.get(), work.data(), probability.size(),
+						probability.data(), expected.data(), &valid_count));
+		EXPECT_EQ(valid_count, sketch_num_data);
+		for (size_t i = 0; i < probability.size(); ++i) {
+			EXPECT_EQ(expected[i], quantile[i]) << "p = " << probability[i];
+		}
+	}
+}
+
+/*
+ * Ranks of quantiles of a large dataset are within the error bound, and
+ * the size of the sketch is within the bound independent of the number of data
+ */
+TEST_F(QuantileSketch, ErrorBound) {
+	size_t const num_data = 1000000;
+	size_t const num_data_per_update = 4096;
+	Dataset dataset(num_data, 2);
+	auto const sorted = dataset.SortedValidData();
+	auto const probability = MakeProbabilities();
+	auto sketch = CreateSketch(kK);
+	for (size_t i = 0; i < num_data; i += num_data_per_update) {
+		size_t const n = std::min(num_data_per_update, num_data - i);
+		ASSERT_EQ(LIBSAKURA_SYMBOL(Status_kOK),
+				LIBSAKURA_SYMBOL(UpdateQuantileSketchFloat)(sketch.get(), n,
+						&dataset.data[i], &dataset.is_valid.get()[i]));
+	}
+	size_t sketch_num_data = 0;
+	auto quantile = Query(sketch.get(), probability, &sketch_num_data);
+	EXPECT_EQ(sorted.size(), sketch_num_data);
+	EXPECT_EQ(sorted.front(), quantile.front());
+	EXPECT_EQ(sorted.back(), quantile.back());
+	double const error = MaxNormalizedRankError(sorted, probability, quantile);
+	std::cout << "max normalized rank error " << error << std::endl;
+	EXPECT_LE(error, kMaxNormalizedRankError);
+
+	size_t const size = Serialize(sketch.get()).size();
+	EXPECT_LE(size, sizeof(float) * (3 * kK + 1500) + 1024);
+}
+
+/*
+ * Sketches of parts of a dataset merged in a tree are as accurate as one sketch
+ */
+TEST_F(QuantileSketch, Merge) {
+	size_t const num_data = 1000000;
+	size_t const num_parts = 7;
+	Dataset dataset(num_data, 3);
+	auto const sorted = dataset.SortedValidData();
+	auto const probability = MakeProbabilities();
+	std::vector<SketchPtr> sketches;
+	size_t begin = 0;
+	for (size_t i = 0; i < num_parts; ++i) {
+		// parts of different sizes
+		size_t const end = (i + 1 == num_parts) ?
+				num_data : begin + num_data / (2 * num_parts) * (i % 3 + 1);
+		sketches.push_back(CreateSketch(kK));
+		ASSERT_EQ(LIBSAKURA_SYMBOL(Status_kOK),
+				LIBSAKURA_SYMBOL(UpdateQuantileSketchFloat)(
+						sketches.back().get(), end - begin,
+						&dataset.data[begin], &dataset.is_valid.get()[begin]));
+		begin = end;
+	}
+	for (size_t stride = 1; stride < num_parts; stride *= 2) {
+		for (size_t i = 0; i + stride < num_parts; i += 2 * stride) {
+			ASSERT_EQ(LIBSAKURA_SYMBOL(Status_kOK),
+					LIBSAKURA_SYMBOL(MergeQuantileSketchFloat)(
+							sketches[i + stride].get(), sketches[i].get()));
+		}
+	}
+	// merging an empty sketch changes nothing
+	auto empty = CreateSketch(kK);
+	ASSERT_EQ(LIBSAKURA_SYMBOL(Status_kOK),
+			LIBSAKURA_SYMBOL(MergeQuantileSketchFloat)(empty.get(),
+					sketches[0].get()));
+
+	size_t sketch_num_data = 0;
+	auto quantile = Query(sketches[0].get(), probability, &sketch_num_data);
+	EXPECT_EQ(sorted.size(), sketch_num_data);
+	EXPECT_EQ(sorted.front(), quantile.front());
+	EXPECT_EQ(sorted.back(), quantile.back());
+	double const error = MaxNormalizedRankError(sorted, probability, quantile);
+	std::cout << "max normalized rank error " << error << std::endl;
+	EXPECT_LE(error, kMaxNormalizedRankError);
+
+	// merging into an empty sketch copies it
+	ASSERT_EQ(LIBSAKURA_SYMBOL(Status_kOK),
+			LIBSAKURA_SYMBOL(MergeQuantileSketchFloat)(sketches[0].get(),
+					empty.get()));
+	size_t copy_num_data = 0;
+	auto copy_quantile = Query(empty.get(), probability, &copy_num_data);
+	EXPECT_EQ(sketch_num_data, copy_num_data);
+	EXPECT_EQ(sorted.front(), copy_quantile.front());
+	EXPECT_EQ(sorted.back(), copy_quantile.back());
+	EXPECT_LE(MaxNormalizedRankError(sorted, probability, copy_quantile),
+			kMaxNormalizedRankError);
+}
+
+/*
+ * A deserialized sketch behaves the same as the original one
+ */
+TEST_F(QuantileSketch, Serialize) {
+	size_t const num_data = 300000;
+	Dataset dataset(num_data, 4);
+	auto const probability = MakeProbabilities();
+	auto sketch = CreateSketch(kK);
+	size_t const half = num_data / 2;
+	ASSERT_EQ(LIBSAKURA_SYMBOL(Status_kOK),
+			LIBSAKURA_SYMBOL(UpdateQuantileSketchFloat)(sketch.get(), half,
+					dataset.data.data(), dataset.is_valid.get()));
+	auto buffer = Serialize(sketch.get());
+
+	LIBSAKURA_SYMBOL(QuantileSketchFloat) *restored_ptr = nullptr;
+	ASSERT_EQ(LIBSAKURA_SYMBOL(Status_kOK),
+			LIBSAKURA_SYMBOL(CreateQuantileSketchFromSerializedFloat)(
+					buffer.size(), buffer.data(), &restored_ptr));
+	SketchPtr restored(restored_ptr,
+			LIBSAKURA_SYMBOL(DestroyQuantileSketchFloat));
+	EXPECT_EQ(buffer, Serialize(restored.get()));
+
+	// both are updated in the same way
+	for (auto target : { sketch.get(), restored.get() }) {
+		ASSERT_EQ(LIBSAKURA_SYMBOL(Status_kOK),
+				LIBSAKURA_SYMBOL(UpdateQuantileSketchFloat)(target,
+						num_data - half, &dataset.data[half],
+						&dataset.is_valid.get()[half]));
+	}
+	size_t num_data_original = 0;
+	size_t num_data_restored = 0;
+	auto original_quantile = Query(sketch.get(), probability,
+			&num_data_original);
+	auto restored_quantile = Query(restored.get(), probability,
+			&num_data_restored);
+	EXPECT_EQ(num_data_original, num_data_restored);
+	EXPECT_EQ(original_quantile, restored_quantile);
+
+	// broken buffers
+	LIBSAKURA_SYMBOL(QuantileSketchFloat) *broken = restored_ptr;
+	EXPECT_EQ(LIBSAKURA_SYMBOL(Status_kInvalidArgument),
+			LIBSAKURA_SYMBOL(CreateQuantileSketchFromSerializedFloat)(
+					buffer.size() - 1, buffer.data(), &broken));
+	EXPECT_EQ(nullptr, broken);
+	auto bad_magic = buffer;
+	bad_magic[0] ^= 1;
+	EXPECT_EQ(LIBSAKURA_SYMBOL(Status_kInvalidArgument),
+			LIBSAKURA_SYMBOL(CreateQuantileSketchFromSerializedFloat)(
+					bad_magic.size(), bad_magic.data(), &broken));
+	auto bad_item = buffer;
+	float const nan = NAN;
+	std::copy(reinterpret_cast<char const *>(&nan),
+			reinterpret_cast<char const *>(&nan) + sizeof(nan),
+			bad_item.end() - sizeof(nan));
+	EXPECT_EQ(LIBSAKURA_SYMBOL(Status_kInvalidArgument),
+			LIBSAKURA_SYMBOL(CreateQuantileSketchFromSerializedFloat)(
+					bad_item.size(), bad_item.data(), &broken));
+	// the last two items belong to the sorted top level
+	auto unsorted = buffer;
+	float last_items[2];
+	std::copy(unsorted.end() - sizeof(last_items), unsorted.end(),
+			reinterpret_cast<char *>(last_items));
+	ASSERT_LT(last_items[0], last_items[1]);
+	std::swap(last_items[0], last_items[1]);
+	std::copy(reinterpret_cast<char const *>(last_items),
+			reinterpret_cast<char const *>(last_items) + sizeof(last_items),
+			unsorted.end() - sizeof(last_items));
+	EXPECT_EQ(LIBSAKURA_SYMBOL(Status_kInvalidArgument),
+			LIBSAKURA_SYMBOL(CreateQuantileSketchFromSerializedFloat)(
+					unsorted.size(), unsorted.data(), &broken));
+	EXPECT_EQ(nullptr, broken);
+}
+
+TEST_F(QuantileSketch, InvalidArguments) {
+	LIBSAKURA_SYMBOL(QuantileSketchFloat) *sketch_ptr = nullptr;
+	EXPECT_EQ(LIBSAKURA_SYMBOL(Status_kInvalidArgument),
+			LIBSAKURA_SYMBOL(CreateQuantileSketchFloat)(kK, nullptr));
+	EXPECT_EQ(LIBSAKURA_SYMBOL(Status_kInvalidArgument),
+			LIBSAKURA_SYMBOL(CreateQuantileSketchFloat)(7, &sketch_ptr));
+	EXPECT_EQ(nullptr, sketch_ptr);
+	EXPECT_EQ(LIBSAKURA_SYMBOL(Status_kInvalidArgument),
+			LIBSAKURA_SYMBOL(CreateQuantileSketchFloat)(65536, &sketch_ptr));
+
+	auto sketch = CreateSketch(kK);
+	auto other = CreateSketch(kK + 1);
+	float data[] = { 1.f };
+	bool is_valid[] = { true };
+	EXPECT_EQ(LIBSAKURA_SYMBOL(Status_kInvalidArgument),
+			LIBSAKURA_SYMBOL(UpdateQuantileSketchFloat)(nullptr, 1, data,
+					is_valid));
+	EXPECT_EQ(LIBSAKURA_SYMBOL(Status_kInvalidArgument),
+			LIBSAKURA_SYMBOL(UpdateQuantileSketchFloat)(sketch.get(), 1,
+					nullptr, is_valid));
+	EXPECT_EQ(LIBSAKURA_SYMBOL(Status_kInvalidArgument),
+			LIBSAKURA_SYMBOL(UpdateQuantileSketchFloat)(sketch.get(), 1, data,
+					nullptr));
+	EXPECT_EQ(LIBSAKURA_SYMBOL(Status_kOK),
+			LIBSAKURA_SYMBOL(UpdateQuantileSketchFloat)(sketch.get(), 0,
+					nullptr, nullptr));
+
+	EXPECT_EQ(LIBSAKURA_SYMBOL(Status_kInvalidArgument),
+			LIBSAKURA_SYMBOL(MergeQuantileSketchFloat)(nullptr, sketch.get()));
+	EXPECT_EQ(LIBSAKURA_SYMBOL(Status_kInvalidArgument),
+			LIBSAKURA_SYMBOL(MergeQuantileSketchFloat)(sketch.get(), nullptr));
+	EXPECT_EQ(LIBSAKURA_SYMBOL(Status_kInvalidArgument),
+			LIBSAKURA_SYMBOL(MergeQuantileSketchFloat)(sketch.get(),
+					sketch.get()));
+	EXPECT_EQ(LIBSAKURA_SYMBOL(Status_kInvalidArgument),
+			LIBSAKURA_SYMBOL(MergeQuantileSketchFloat)(other.get(),
+					sketch.get()));
+
+	double probability[] = { 0.5 };
+	float quantile[1];
+	size_t num_data = 0;
+	EXPECT_EQ(LIBSAKURA_SYMBOL(Status_kInvalidArgument),
+			LIBSAKURA_SYMBOL(QueryQuantileSketchFloat)(nullptr, 1, probability,
+					quantile, &num_data));
+	EXPECT_EQ(LIBSAKURA_SYMBOL(Status_kInvalidArgument),
+			LIBSAKURA_SYMBOL(QueryQuantileSketchFloat)(sketch.get(), 1,
+					nullptr, quantile, &num_data));
+	EXPECT_EQ(LIBSAKURA_SYMBOL(Status_kInvalidArgument),
+			LIBSAKURA_SYMBOL(QueryQuantileSketchFloat)(sketch.get(), 1,
+					probability, nullptr, &num_data));
+	EXPECT_EQ(LIBSAKURA_SYMBOL(Status_kInvalidArgument),
+			LIBSAKURA_SYMBOL(QueryQuantileSketchFloat)(sketch.get(), 1,
+					probability, quantile, nullptr));
+	double bad_probability[] = { 1.5 };
+	EXPECT_EQ(LIBSAKURA_SYMBOL(Status_kInvalidArgument),
+			LIBSAKURA_SYMBOL(QueryQuantileSketchFloat)(sketch.get(), 1,
+					bad_probability, quantile, &num_data));
+
+	size_t size = 0;
+	EXPECT_EQ(LIBSAKURA_SYMBOL(Status_kInvalidArgument),
+			LIBSAKURA_SYMBOL(GetQuantileSketchSerializedSizeFloat)(nullptr,
+					&size));
+	EXPECT_EQ(LIBSAKURA_SYMBOL(Status_kInvalidArgument),
+			LIBSAKURA_SYMBOL(GetQuantileSketchSerializedSizeFloat)(
+					sketch.get(), nullptr));
+	EXPECT_EQ(LIBSAKURA_SYMBOL(Status_kOK),
+			LIBSAKURA_SYMBOL(GetQuantileSketchSerializedSizeFloat)(
+					sketch.get(), &size));
+	std::vector<char> buffer(size + 1);
+	EXPECT_EQ(LIBSAKURA_SYMBOL(Status_kInvalidArgument),
+			LIBSAKURA_SYMBOL(SerializeQuantileSketchFloat)(sketch.get(),
+					size + 1, buffer.data()));
+	EXPECT_EQ(LIBSAKURA_SYMBOL(Status_kInvalidArgument),
+			LIBSAKURA_SYMBOL(SerializeQuantileSketchFloat)(sketch.get(), size,
+					nullptr));
+	EXPECT_EQ(LIBSAKURA_SYMBOL(Status_kInvalidArgument),
+			LIBSAKURA_SYMBOL(CreateQuantileSketchFromSerializedFloat)(size,
+					nullptr, &sketch_ptr));
+	EXPECT_EQ(LIBSAKURA_SYMBOL(Status_kInvalidArgument),
+			LIBSAKURA_SYMBOL(DestroyQuantileSketchFloat)(nullptr));
+}
+
+TEST_F(QuantileSketch, PerformanceUpdate) {
+	size_t const num_data = 4096;
+	size_t const num_repeat = 2000;
+	Dataset dataset(num_data, 5);
+	auto sketch = CreateSketch(kK);
+	double start = GetCurrentTime();
+	for (size_t i = 0; i < num_repeat; ++i) {
+		ASSERT_EQ(LIBSAKURA_SYMBOL(Status_kOK),
+				LIBSAKURA_SYMBOL(UpdateQuantileSketchFloat)(sketch.get(),
+						num_data, dataset.data.data(), dataset.is_valid.get()));
+	}
+	double end = GetCurrentTime();
+	std::cout << std::setprecision(5)
+			<< "#x# benchmark QuantileSketch_Update " << end - start
+			<< std::endl;
+}
@@ -0,0 +1,524 @@
+/*
+ * @SAKURA_LICENSE_HEADER_START@
+ * Copyright (C) 2013-2022
+ * Inter-University Research Institute Corporation, National Institutes of Natural Sciences
+ * 2-21-1, Osawa, Mitaka, Tokyo, 181-8588, Japan.
+ *
+ * This file is part of Sakura.
+ *
+ * Sakura is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or (at your
+ * option) any later version.
+ *
+ * Sakura is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public
+ * License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Sakura.  If not, see <http://www.gnu.org/licenses/>.
+ * @SAKURA_LICENSE_HEADER_END@
+ */
+/*
+ * reduction_pipeline.cc
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <libsakura/sakura.h>
+#include <libsakura/localdef.h>
+#include "loginit.h"
+#include "aligned_memory.h"
+#include "gtest/gtest.h"
+#include "testutil.h"
+
+namespace {
+
+/*
+ * An aligned array of num_elements elements
+ */
+template<typename T>
+struct AlignedArray {
+	explicit AlignedArray(size_t num_elements) :
+			data(nullptr), storage(
+					DefaultAlignedMemory::AlignedAllocateOrException(
+							sizeof(T) * num_elements, &data)) {
+	}
+	T *data;
+	std::unique_ptr<void, DefaultAlignedMemory> storage;
+};
+
+/*
+ * Input of a spectrum: data with some NaNs and Infs, flags, mask and reference
+ */
+struct Spectrum {
+	explicit Spectrum(size_t num_data, bool has_nan_or_inf = true) :
+			num_data(num_data), data(num_data), flag(num_data), mask(
+					num_data), reference(num_data), scaling_factor(num_data) {
+		std::mt19937 engine(static_cast<unsigned>(num_data));
+		std::normal_distribution<float> noise(0.f, 0.1f);
+		std::uniform_int_distribution<int> percent(0, 99);
+		for (size_t i = 0; i < num_data; ++i) {
+			float const x = static_cast<float>(i) / num_data;
+			reference.data[i] = 10.f + x;
+			data.data[i] = reference.data[i]
+					* (1.f + 0.1f * (1.f + x * x) + noise(engine));
+			flag.data[i] = percent(engine) < 5 ? 1 : 0;
+			mask.data[i] = percent(engine) >= 3;
+			scaling_factor.data[i] = 2.f + x;
+			if (has_nan_or_inf && percent(engine) < 1) {
+				data.data[i] = percent(engine) < 50 ? NAN : INFINITY;
+			}
+		}
+	}
+	size_t num_data;
+	AlignedArray<float> data;
+	AlignedArray<uint8_t> flag;
+	AlignedArray<bool> mask;
+	AlignedArray<float> reference;
+	AlignedArray<float> scaling_factor;
+};
+
+AlignedArray<float> MakeKernel(size_t num_kernel) {
+	AlignedArray<float> kernel(num_kernel);
+	float const center = static_cast<float>(num_kernel / 2);
+	float const width = std::max(1.f, num_kernel / 6.f);
+	for (size_t i = 0; i < num_kernel; ++i) {
+		float const d = (i - center) / width;
+		kernel.data[i] = std::exp(-0.5f * d * d);
+	}
+	return kernel;
+}
+
+/*
+ * Applies stages one by one by the existing functions
+ */
+void ApplyStagesByChain(size_t num_stages,
+LIBSAKURA_SYMBOL(ReductionStageFloat) const stages[],
+		Spectrum const &spectrum, bool const input_mask[], float data[],
+		bool mask[], LIBSAKURA_SYMBOL(StatisticsResultFloat) *statistics) {
+	size_t const num_data = spectrum.num_data;
+	AlignedArray<bool> work_mask(num_data);
+	AlignedArray<float> work_data(num_data);
+	AlignedArray<float> weight(num_data);
+	std::copy(spectrum.data.data, spectrum.data.data + num_data, data);
+	if (input_mask == nullptr) {
+		std::fill(mask, mask + num_data, true);
+	} else {
+		std::copy(input_mask, input_mask + num_data, mask);
+	}
+	for (size_t i = 0; i < num_stages; ++i) {
+		auto const &stage = stages[i];
+		LIBSAKURA_SYMBOL(Status) status = LIBSAKURA_SYMBOL(Status_kOK);
+		switch (stage.type) {
+		case LIBSAKURA_SYMBOL(ReductionStageType_kFlagToMask):
+			status = LIBSAKURA_SYMBOL(Uint8ToBool)(num_data, spectrum.flag.data,
+					work_mask.data);
+			ASSERT_EQ(LIBSAKURA_SYMBOL(Status_kOK), status);
+			status = LIBSAKURA_SYMBOL(InvertBool)(num_data, work_mask.data,
+					mask);
+			break;
+		case LIBSAKURA_SYMBOL(ReductionStageType_kMaskNanOrInf):
+			status = LIBSAKURA_SYMBOL(SetFalseIfNanOrInfFloat)(num_data, data,
+					work_mask.data);
+			for (size_t j = 0; j < num_data; ++j) {
+				mask[j] = mask[j] && work_mask.data[j];
+			}
+			break;
+		case LIBSAKURA_SYMBOL(ReductionStageType_kCalibrate):
+			if (stage.num_scaling_factor == 1) {
+				status = LIBSAKURA_SYMBOL(CalibrateDataWithConstScalingFloat)(
+						stage.scaling_factor[0], num_data, data,
+						spectrum.reference.data, data);
+			} else {
+				status = LIBSAKURA_SYMBOL(CalibrateDataWithArrayScalingFloat)(
+						num_data, stage.scaling_factor, data,
+						spectrum.reference.data, data);
+			}
+			break;
+		case LIBSAKURA_SYMBOL(ReductionStageType_kSubtractBaseline): {
+			float rms = 0.f;
+			LIBSAKURA_SYMBOL(LSQFitStatus) lsqfit_status;
+			status = LIBSAKURA_SYMBOL(LSQFitPolynomialFloat)(
+					stage.lsqfit_context, stage.order, num_data, data, mask,
+					stage.clip_threshold_sigma, stage.num_fitting_max,
+					stage.order + 1, nullptr, nullptr, data, work_mask.data, &rms,
+					&lsqfit_status);
+			break;
+		}
+		case LIBSAKURA_SYMBOL(ReductionStageType_kSmooth):
+			status = LIBSAKURA_SYMBOL(Convolve1DFloat)(stage.num_kernel,
+					stage.kernel, num_data, data, mask, work_data.data,
+					weight.data);
+			std::copy(work_data.data, work_data.data + num_data, data);
+			break;
+		case LIBSAKURA_SYMBOL(ReductionStageType_kStatistics):
+			status = LIBSAKURA_SYMBOL(ComputeStatisticsFloat)(num_data, data,
+					mask, statistics);
+			break;
+		default:
+			FAIL();
+		}
+		ASSERT_EQ(LIBSAKURA_SYMBOL(Status_kOK), status) << "stage " << i;
+	}
+}
+
+void ExpectNear(float expected, float actual, size_t index) {
+	if (std::isfinite(expected)) {
+		EXPECT_NEAR(expected, actual,
+				1.e-4f * std::max(1.f, std::abs(expected))) << "index " << index;
+	} else {
+		EXPECT_EQ(std::isnan(expected), std::isnan(actual)) << "index "
+				<< index;
+	}
+}
+
+void CompareWithChain(size_t num_stages,
+LIBSAKURA_SYMBOL(ReductionStageFloat) const stages[], size_t num_data,
+		bool use_input_mask, bool has_nan_or_inf = true) {
+	SCOPED_TRACE(
+			"num_data = " + std::to_string(num_data) + ", num_stages = "
+					+ std::to_string(num_stages));
+	Spectrum spectrum(num_data, has_nan_or_inf);
+	bool const *input_mask = use_input_mask ? spectrum.mask.data : nullptr;
+	AlignedArray<float> expected_data(num_data);
+	AlignedArray<bool> expected_mask(num_data);
+	LIBSAKURA_SYMBOL(StatisticsResultFloat) expected_statistics;
+	ApplyStagesByChain(num_stages, stages, spectrum, input_mask,
+			expected_data.data, expected_mask.data, &expected_statistics);
+
+	LIBSAKURA_SYMBOL(ReductionPipelineFloat) *pipeline = nullptr;
+	LIBSAKURA_SYMBOL(Status) status = LIBSAKURA_SYMBOL(
+			CreateReductionPipelineFloat)(num_stages, stages, num_data,
+			&pipeline);
+	ASSERT_EQ(LIBSAKURA_SYMBOL(Status_kOK), status);
+	ScopeGuard guard([pipeline]() {
+		LIBSAKURA_SYMBOL(DestroyReductionPipelineFloat)(pipeline);
+	});
+	AlignedArray<float> data(num_data);
+	AlignedArray<bool> mask(num_data);
+	LIBSAKURA_SYMBOL(StatisticsResultFloat) statistics;
+	LIBSAKURA_SYMBOL(LSQFitStatus) lsqfit_status;
+	// repeat to check that nothing is left in the pipeline
+	for (size_t repeat = 0; repeat < 2; ++repeat) {
+		status = LIBSAKURA_SYMBOL(ExecuteReductionPipelineFloat)(pipeline,
+				num_data, spectrum.data.data, spectrum.flag.data, input_mask,
+				spectrum.reference.data, data.data, mask.data, &statistics,
+				&lsqfit_status);
+		ASSERT_EQ(LIBSAKURA_SYMBOL(Status_kOK), status);
+		for (size_t i = 0; i < num_data; ++i) {
+			ASSERT_EQ(expected_mask.data[i], mask.data[i]) << "index " << i;
+			if (mask.data[i]) {
+				ExpectNear(expected_data.data[i], data.data[i], i);
+			}
+		}
+		EXPECT_EQ(expected_statistics.count, statistics.count);
+		if (expected_statistics.count == 0) {
+			EXPECT_TRUE(std::isnan(statistics.min));
+			EXPECT_TRUE(std::isnan(statistics.max));
+			continue;
+		}
+		EXPECT_NEAR(expected_statistics.sum, statistics.sum,
+				1.e-5 * std::max(1., std::abs(expected_statistics.sum)));
+		EXPECT_NEAR(expected_statistics.square_sum, statistics.square_sum,
+				1.e-5 * std::max(1., expected_statistics.square_sum));
+		EXPECT_EQ(expected_statistics.min, statistics.min);
+		EXPECT_EQ(expected_statistics.max, statistics.max);
+		EXPECT_EQ(expected_statistics.min, data.data[statistics.index_of_min]);
+		EXPECT_EQ(expected_statistics.max, data.data[statistics.index_of_max]);
+	}
+}
+
+constexpr size_t kNumDataList[] = { 1, 100, 4096, 4097, 10000, 12289 };
+
+struct LSQFitContext {
+	LSQFitContext(uint16_t order, size_t num_data) :
+			context(nullptr) {
+		LIBSAKURA_SYMBOL(Status) status = LIBSAKURA_SYMBOL(
+				CreateLSQFitContextPolynomialFloat)(
+				LIBSAKURA_SYMBOL(LSQFitType_kPolynomial), order, num_data,
+				&context);
+		EXPECT_EQ(LIBSAKURA_SYMBOL(Status_kOK), status);
+	}
+	~LSQFitContext() {
+		LIBSAKURA_SYMBOL(DestroyLSQFitContextFloat)(context);
+	}
+	LIBSAKURA_SYMBOL(LSQFitContextFloat) *context;
+};
+
+LIBSAKURA_SYMBOL(ReductionStageFloat) MakeStage(
+LIBSAKURA_SYMBOL(ReductionStageType) type) {
+	LIBSAKURA_SYMBOL(ReductionStageFloat) stage = { };
+	stage.type = type;
+	return stage;
+}
+
+LIBSAKURA_SYMBOL(ReductionStageFloat) MakeSmoothStage(
+		AlignedArray<float> const &kernel, size_t num_kernel) {
+	auto stage = MakeStage(LIBSAKURA_SYMBOL(ReductionStageType_kSmooth));
+	stage.num_kernel = num_kernel;
+	stage.kernel = kernel.data;
+	return stage;
+}
+
+class ReductionPipeline: public ::testing::Test {
+protected:
+	virtual void SetUp() {
+		LIBSAKURA_SYMBOL(Status) status = LIBSAKURA_SYMBOL(Initialize)(nullptr,
+				nullptr);
+		ASSERT_EQ(LIBSAKURA_SYMBOL(Status_kOK), status);
+	}
+	virtual void TearDown() {
+		LIBSAKURA_SYMBOL(CleanUp)();
+	}
+};
+
+} /* anonymous namespace */
+
+/*
+ * Element-wise stages and a smoothing stage in a group
+ */
+TEST_F(ReductionPipeline, CalibrateAndSmooth) {
+	size_t const num_kernel = 21;
+	auto kernel = MakeKernel(num_kernel);
+	for (auto num_data : kNumDataList) {
+		Spectrum spectrum(num_data);
+		LIBSAKURA_SYMBOL(ReductionStageFloat) stages[] = { MakeStage(
+		LIBSAKURA_SYMBOL(ReductionStageType_kFlagToMask)), MakeStage(
+		LIBSAKURA_SYMBOL(ReductionStageType_kMaskNanOrInf)), MakeStage(
+		LIBSAKURA_SYMBOL(ReductionStageType_kCalibrate)), MakeSmoothStage(
+				kernel, num_kernel), MakeStage(
+		LIBSAKURA_SYMBOL(ReductionStageType_kStatistics)) };
+		stages[2].num_scaling_factor = num_data;
+		stages[2].scaling_factor = spectrum.scaling_factor.data;
+		CompareWithChain(ELEMENTSOF(stages), stages, num_data, false);
+	}
+}
+
+/*
+ * Baseline subtraction separates groups and smoothing is followed by
+ * element-wise stages. Data are finite since fitting fails if masked data
+ * are NaN.
+ */
+TEST_F(ReductionPipeline, BaselineAndSmooth) {
+	size_t const num_kernel = 5;
+	auto kernel = MakeKernel(num_kernel);
+	float const scaling_factor[] = { 3.f };
+	uint16_t const order = 3;
+	for (auto num_data : kNumDataList) {
+		if (num_data <= order) {
+			continue;
+		}
+		LSQFitContext lsqfit(order, num_data);
+		LIBSAKURA_SYMBOL(ReductionStageFloat) stages[] = { MakeStage(
+		LIBSAKURA_SYMBOL(ReductionStageType_kFlagToMask)), MakeStage(
+		LIBSAKURA_SYMBOL(ReductionStageType_kMaskNanOrInf)), MakeStage(
+		LIBSAKURA_SYMBOL(ReductionStageType_kCalibrate)), MakeStage(
+		LIBSAKURA_SYMBOL(ReductionStageType_kSubtractBaseline)),
+				MakeSmoothStage(kernel, num_kernel), MakeStage(
+				LIBSAKURA_SYMBOL(ReductionStageType_kMaskNanOrInf)), MakeStage(
+				LIBSAKURA_SYMBOL(ReductionStageType_kStatistics)) };
+		stages[2].num_scaling_factor = 1;
+		stages[2].scaling_factor = scaling_factor;
+		stages[3].lsqfit_context = lsqfit.context;
+		stages[3].order = order;
+		stages[3].clip_threshold_sigma = 3.f;
+		stages[3].num_fitting_max = 2;
+		CompareWithChain(ELEMENTSOF(stages), stages, num_data, false, false);
+	}
+}
+
+/*
+ * Two smoothing stages with a kernel longer than a block and an input mask
+ */
+TEST_F(ReductionPipeline, TwoSmoothingStages) {
+	size_t const num_short_kernel = 4;
+	size_t const num_long_kernel = 5001;
+	auto short_kernel = MakeKernel(num_short_kernel);
+	auto long_kernel = MakeKernel(num_long_kernel);
+	for (auto num_data : kNumDataList) {
+		LIBSAKURA_SYMBOL(ReductionStageFloat) stages[] = { MakeStage(
+		LIBSAKURA_SYMBOL(ReductionStageType_kMaskNanOrInf)), MakeSmoothStage(
+				short_kernel, num_short_kernel), MakeSmoothStage(long_kernel,
+				num_long_kernel), MakeStage(
+		LIBSAKURA_SYMBOL(ReductionStageType_kStatistics)) };
+		CompareWithChain(ELEMENTSOF(stages), stages, num_data, true);
+	}
+}
+
+TEST_F(ReductionPipeline, InvalidArguments) {
+	size_t const num_data = 128;
+	auto kernel = MakeKernel(3);
+	Spectrum spectrum(num_data);
+	LIBSAKURA_SYMBOL(ReductionPipelineFloat) *pipeline = nullptr;
+	auto create = [&](size_t num_stages,
+	LIBSAKURA_SYMBOL(ReductionStageFloat) const stages[], size_t n) {
+		LIBSAKURA_SYMBOL(Status) status = LIBSAKURA_SYMBOL(
+				CreateReductionPipelineFloat)(num_stages, stages, n, &pipeline);
+		if (status != LIBSAKURA_SYMBOL(Status_kOK)) {
+			EXPECT_EQ(nullptr, pipeline);
+		}
+		return status;
+	};
+	auto const kInvalid = LIBSAKURA_SYMBOL(Status_kInvalidArgument);
+
+	auto statistics = MakeStage(
+	LIBSAKURA_SYMBOL(ReductionStageType_kStatistics));
+	EXPECT_EQ(kInvalid, create(0, &statistics, num_data));
+	EXPECT_EQ(kInvalid, create(1, nullptr, num_data));
+	EXPECT_EQ(kInvalid, create(1, &statistics, 0));
+	EXPECT_EQ(kInvalid,
+			LIBSAKURA_SYMBOL(CreateReductionPipelineFloat)(1, &statistics,
+					num_data, nullptr));
+	{
+		LIBSAKURA_SYMBOL(ReductionStageFloat) stages[] = { statistics,
+				statistics };
+		EXPECT_EQ(kInvalid, create(ELEMENTSOF(stages), stages, num_data));
+	}
+	{
+		auto stage = MakeStage(
+		LIBSAKURA_SYMBOL(ReductionStageType_kNumElements));
+		EXPECT_EQ(kInvalid, create(1, &stage, num_data));
+	}
+	{
+		auto stage = MakeStage(LIBSAKURA_SYMBOL(ReductionStageType_kCalibrate));
+		stage.num_scaling_factor = 2;
+		stage.scaling_factor = spectrum.scaling_factor.data;
+		EXPECT_EQ(kInvalid, create(1, &stage, num_data));
+		stage.num_scaling_factor = 1;
+		stage.scaling_factor = nullptr;
+		EXPECT_EQ(kInvalid, create(1, &stage, num_data));
+	}
+	{
+		auto stage = MakeStage(
+		LIBSAKURA_SYMBOL(ReductionStageType_kSubtractBaseline));
+		EXPECT_EQ(kInvalid, create(1, &stage, num_data));
+	}
+	{
+		auto stage = MakeSmoothStage(kernel, 0);
+		EXPECT_EQ(kInvalid, create(1, &stage, num_data));
+		stage = MakeSmoothStage(kernel, 3);
+		stage.kernel = nullptr;
+		EXPECT_EQ(kInvalid, create(1, &stage, num_data));
+	}
+
+	// execution
+	LIBSAKURA_SYMBOL(ReductionStageFloat) stages[] = { MakeStage(
+	LIBSAKURA_SYMBOL(ReductionStageType_kFlagToMask)), MakeStage(
+	LIBSAKURA_SYMBOL(ReductionStageType_kCalibrate)), statistics };
+	stages[1].num_scaling_factor = 1;
+	stages[1].scaling_factor = spectrum.scaling_factor.data;
+	ASSERT_EQ(LIBSAKURA_SYMBOL(Status_kOK),
+			create(ELEMENTSOF(stages), stages, num_data));
+	ScopeGuard guard([pipeline]() {
+		LIBSAKURA_SYMBOL(DestroyReductionPipelineFloat)(pipeline);
+	});
+	AlignedArray<float> data(num_data + 1);
+	AlignedArray<bool> mask(num_data + 1);
+	LIBSAKURA_SYMBOL(StatisticsResultFloat) result;
+	auto execute = [&](size_t n, float const *input_data,
+			uint8_t const *input_flag, float const *reference,
+			float *output_data, bool *output_mask,
+			LIBSAKURA_SYMBOL(StatisticsResultFloat) *stats) {
+		return LIBSAKURA_SYMBOL(ExecuteReductionPipelineFloat)(pipeline, n,
+				input_data, input_flag, nullptr, reference, output_data,
+				output_mask, stats, nullptr);
+	};
+	float const *input = spectrum.data.data;
+	uint8_t const *flag = spectrum.flag.data;
+	float const *reference = spectrum.reference.data;
+	EXPECT_EQ(LIBSAKURA_SYMBOL(Status_kOK),
+			execute(num_data, input, flag, reference, data.data, mask.data,
+					&result));
+	EXPECT_EQ(kInvalid,
+			LIBSAKURA_SYMBOL(ExecuteReductionPipelineFloat)(nullptr, num_data,
+					input, flag, nullptr, reference, data.data, mask.data,
+					&result, nullptr));
+	EXPECT_EQ(kInvalid,
+			execute(num_data - 1, input, flag, reference, data.data,
+					mask.data, &result));
+	EXPECT_EQ(kInvalid,
+			execute(num_data, nullptr, flag, reference, data.data, mask.data,
+					&result));
+	EXPECT_EQ(kInvalid,
+			execute(num_data, input + 1, flag, reference, data.data,
+					mask.data, &result));
+	EXPECT_EQ(kInvalid,
+			execute(num_data, input, nullptr, reference, data.data,
+					mask.data, &result));
+	EXPECT_EQ(kInvalid,
+			execute(num_data, input, flag, nullptr, data.data, mask.data,
+					&result));
+	EXPECT_EQ(kInvalid,
+			execute(num_data, input, flag, reference, data.data + 1,
+					mask.data, &result));
+	EXPECT_EQ(kInvalid,
+			execute(num_data, input, flag, reference, data.data, nullptr,
+					&result));
+	EXPECT_EQ(kInvalid,
+			execute(num_data, input, flag, reference, data.data, mask.data,
+					nullptr));
+	EXPECT_EQ(kInvalid, LIBSAKURA_SYMBOL(DestroyReductionPipelineFloat)(nullptr));
+}
+
+/*
+ * Compares the pipeline with the chain of the existing functions
+ */
+TEST_F(ReductionPipeline, PerformanceChainVsPipeline) {
+	size_t const num_data = 8192;
+	size_t const num_spectra = 1000;
+	size_t const num_kernel = 21;
+	auto kernel = MakeKernel(num_kernel);
+	Spectrum spectrum(num_data);
+	LIBSAKURA_SYMBOL(ReductionStageFloat) stages[] = { MakeStage(
+	LIBSAKURA_SYMBOL(ReductionStageType_kFlagToMask)), MakeStage(
+	LIBSAKURA_SYMBOL(ReductionStageType_kMaskNanOrInf)), MakeStage(
+	LIBSAKURA_SYMBOL(ReductionStageType_kCalibrate)), MakeSmoothStage(kernel,
+			num_kernel), MakeStage(
+	LIBSAKURA_SYMBOL(ReductionStageType_kStatistics)) };
+	stages[2].num_scaling_factor = num_data;
+	stages[2].scaling_factor = spectrum.scaling_factor.data;
+	AlignedArray<float> data(num_data);
+	AlignedArray<bool> mask(num_data);
+	LIBSAKURA_SYMBOL(StatisticsResultFloat) statistics;
+
+	double start = GetCurrentTime();
+	for (size_t i = 0; i < num_spectra; ++i) {
+		ApplyStagesByChain(ELEMENTSOF(stages), stages, spectrum, nullptr,
+				data.data, mask.data, &statistics);
+	}
+	double end = GetCurrentTime();
+	std::cout << std::setprecision(5)
+			<< "#x# benchmark ReductionPipeline_Chain " << end - start
+			<< std::endl;
+
+	LIBSAKURA_SYMBOL(ReductionPipelineFloat) *pipeline = nullptr;
+	ASSERT_EQ(LIBSAKURA_SYMBOL(Status_kOK),
+			LIBSAKURA_SYMBOL(CreateReductionPipelineFloat)(ELEMENTSOF(stages),
+					stages, num_data, &pipeline));
+	ScopeGuard guard([pipeline]() {
+		LIBSAKURA_SYMBOL(DestroyReductionPipelineFloat)(pipeline);
+	});
+	start = GetCurrentTime();
+	for (size_t i = 0; i < num_spectra; ++i) {
+		LIBSAKURA_SYMBOL(Status) status = LIBSAKURA_SYMBOL(
+				ExecuteReductionPipelineFloat)(pipeline, num_data,
+				spectrum.data.data, spectrum.flag.data, nullptr,
+				spectrum.reference.data, data.data, mask.data, &statistics,
+				nullptr);
+		ASSERT_EQ(LIBSAKURA_SYMBOL(Status_kOK), status);
+	}
+	end = GetCurrentTime();
+	std::cout << std::setprecision(5)
+			<< "#x# benchmark ReductionPipeline_Pipeline " << end - start
+			<< std::endl;
+}
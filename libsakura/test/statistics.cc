@@ -38,6 +38,8 @@
 #include <array>
 #include <algorithm>
 #include <numeric>
+#include <random>
+#include <vector>
 
 #include <libsakura/sakura.h>
 
@@ -965,6 +967,388 @@ TEST(Statistics, ComputeMedianAbsoluteDeviation) {
 			LIBSAKURA_SYMBOL(ComputeMedianAbsoluteDeviationFloat));
 }
 
+TEST(Statistics, ComputeMeanAndStddev) {
+	LIBSAKURA_SYMBOL(Status) status = LIBSAKURA_SYMBOL(Initialize)(nullptr,
+			nullptr);
+	EXPECT_EQ(LIBSAKURA_SYMBOL(Status_kOK), status);
+
+	SIMD_ALIGN
+	static std::array<float, 100003> data;
+	SIMD_ALIGN
+	static std::array<bool, data.size()> is_valid;
+	std::mt19937 mt(2468);
+	// the mean is much larger than the standard deviation
+	std::normal_distribution<float> value(1.e4f, 0.5f);
+	std::bernoulli_distribution valid(0.8);
+	for (size_t i = 0; i < data.size(); ++i) {
+		is_valid[i] = valid(mt);
+		data[i] = is_valid[i] ? value(mt) : NAN;
+	}
+
+	for (size_t num_data : { size_t(1), size_t(7), size_t(8), size_t(4095),
+			size_t(4097), size_t(12345), data.size() }) {
+		// two-pass reference
+		long double sum = 0;
+		size_t count = 0;
+		for (size_t i = 0; i < num_data; ++i) {
+			if (is_valid[i]) {
+				sum += data[i];
+				++count;
+			}
+		}
+		long double const ref_mean = sum / count;
+		long double sq_diff = 0;
+		for (size_t i = 0; i < num_data; ++i) {
+			if (is_valid[i]) {
+				long double const diff = data[i] - ref_mean;
+				sq_diff += diff * diff;
+			}
+		}
+		for (size_t ddof : { 0, 1 }) {
+			double mean = 0;
+			double stddev = 0;
+			status = LIBSAKURA_SYMBOL(ComputeMeanAndStddevFloat)(num_data,
+					data.data(), is_valid.data(), ddof, &mean, &stddev);
+			EXPECT_EQ(LIBSAKURA_SYMBOL(Status_kOK), status);
+			EXPECT_NEAR(ref_mean, mean, std::abs(ref_mean) * 1e-14);
+			if (count > ddof) {
+				double const ref_stddev = std::sqrt(sq_diff / (count - ddof));
+				EXPECT_NEAR(ref_stddev, stddev, ref_stddev * 1e-12);
+			} else {
+				EXPECT_TRUE(std::isnan(stddev));
+			}
+		}
+		if (count > 0) {
+			double const ref_stddev = std::sqrt(sq_diff / count);
+			double stddev = 0;
+			status = LIBSAKURA_SYMBOL(ComputeStddevFloat)(count, ref_mean,
+					num_data, data.data(), is_valid.data(), &stddev);
+			EXPECT_EQ(LIBSAKURA_SYMBOL(Status_kOK), status);
+			EXPECT_NEAR(ref_stddev, stddev, ref_stddev * 1e-12);
+		}
+	}
+
+	{ // no valid data
+		double mean = 0;
+		double stddev = 0;
+		status = LIBSAKURA_SYMBOL(ComputeMeanAndStddevFloat)(0, data.data(),
+				is_valid.data(), 0, &mean, &stddev);
+		EXPECT_EQ(LIBSAKURA_SYMBOL(Status_kOK), status);
+		EXPECT_TRUE(std::isnan(mean));
+		EXPECT_TRUE(std::isnan(stddev));
+		SIMD_ALIGN
+		static std::array<bool, 64> none;
+		none.fill(false);
+		status = LIBSAKURA_SYMBOL(ComputeMeanAndStddevFloat)(none.size(),
+				data.data(), none.data(), 0, &mean, &stddev);
+		EXPECT_EQ(LIBSAKURA_SYMBOL(Status_kOK), status);
+		EXPECT_TRUE(std::isnan(mean));
+		EXPECT_TRUE(std::isnan(stddev));
+	}
+	{ // invalid arguments
+		double mean = 0;
+		double stddev = 0;
+		EXPECT_EQ(LIBSAKURA_SYMBOL(Status_kInvalidArgument),
+				LIBSAKURA_SYMBOL(ComputeMeanAndStddevFloat)(data.size(),
+						nullptr, is_valid.data(), 0, &mean, &stddev));
+		EXPECT_EQ(LIBSAKURA_SYMBOL(Status_kInvalidArgument),
+				LIBSAKURA_SYMBOL(ComputeMeanAndStddevFloat)(data.size(),
+						data.data(), nullptr, 0, &mean, &stddev));
+		EXPECT_EQ(LIBSAKURA_SYMBOL(Status_kInvalidArgument),
+				LIBSAKURA_SYMBOL(ComputeMeanAndStddevFloat)(data.size(),
+						data.data(), is_valid.data(), 0, nullptr, &stddev));
+		EXPECT_EQ(LIBSAKURA_SYMBOL(Status_kInvalidArgument),
+				LIBSAKURA_SYMBOL(ComputeMeanAndStddevFloat)(data.size(),
+						data.data(), is_valid.data(), 0, &mean, nullptr));
+		EXPECT_EQ(LIBSAKURA_SYMBOL(Status_kInvalidArgument),
+				LIBSAKURA_SYMBOL(ComputeMeanAndStddevFloat)(data.size() - 1,
+						data.data() + 1, is_valid.data() + 1, 0, &mean,
+						&stddev));
+	}
+	LIBSAKURA_SYMBOL(CleanUp)();
+}
+
+TEST(Statistics, ComputeAccurateStatisticsParallel) {
+	LIBSAKURA_SYMBOL(Status) status = LIBSAKURA_SYMBOL(Initialize)(nullptr,
+			nullptr);
+	EXPECT_EQ(LIBSAKURA_SYMBOL(Status_kOK), status);
+
+	SIMD_ALIGN
+	static std::array<float, 9 * 1024 * 1024> data;
+	SIMD_ALIGN
+	static std::array<bool, data.size()> is_valid;
+	std::mt19937 mt(98765);
+	std::uniform_real_distribution<float> value(-1.e4f, 1.e4f);
+	std::bernoulli_distribution valid(0.7);
+	for (size_t i = 0; i < data.size(); ++i) {
+		data[i] = value(mt);
+		is_valid[i] = valid(mt);
+	}
+
+	// sizes with a partial unit and remaining elements of a partial block
+	for (size_t num_data : { size_t(1000), size_t(3 * 1024 * 1024 + 7),
+			size_t(8 * 1024 * 1024 + 12345), data.size() }) {
+		LIBSAKURA_SYMBOL(StatisticsResultFloat) ref;
+		status = LIBSAKURA_SYMBOL(ComputeAccurateStatisticsFloat)(num_data,
+				data.data(), is_valid.data(), &ref);
+		EXPECT_EQ(LIBSAKURA_SYMBOL(Status_kOK), status);
+		for (size_t num_threads : { 1, 2, 3, 5, 8, 0 }) {
+			LIBSAKURA_SYMBOL(StatisticsResultFloat) result;
+			status = LIBSAKURA_SYMBOL(ComputeAccurateStatisticsParallelFloat)(
+					num_data, data.data(), is_valid.data(), num_threads,
+					&result);
+			EXPECT_EQ(LIBSAKURA_SYMBOL(Status_kOK), status);
+			// exactly the same as the result of a single thread
+			EXPECT_EQ(ref.count, result.count);
+			EXPECT_EQ(ref.index_of_min, result.index_of_min);
+			EXPECT_EQ(ref.index_of_max, result.index_of_max);
+			EXPECT_EQ(ref.min, result.min);
+			EXPECT_EQ(ref.max, result.max);
+			EXPECT_EQ(ref.sum, result.sum);
+			EXPECT_EQ(ref.square_sum, result.square_sum);
+		}
+	}
+
+	{ // invalid arguments
+		LIBSAKURA_SYMBOL(StatisticsResultFloat) result;
+		EXPECT_EQ(LIBSAKURA_SYMBOL(Status_kInvalidArgument),
+				LIBSAKURA_SYMBOL(ComputeAccurateStatisticsParallelFloat)(
+						data.size(), nullptr, is_valid.data(), 2, &result));
+		EXPECT_EQ(LIBSAKURA_SYMBOL(Status_kInvalidArgument),
+				LIBSAKURA_SYMBOL(ComputeAccurateStatisticsParallelFloat)(
+						data.size(), data.data(), nullptr, 2, &result));
+		EXPECT_EQ(LIBSAKURA_SYMBOL(Status_kInvalidArgument),
+				LIBSAKURA_SYMBOL(ComputeAccurateStatisticsParallelFloat)(
+						data.size(), data.data(), is_valid.data(), 2, nullptr));
+		EXPECT_EQ(LIBSAKURA_SYMBOL(Status_kInvalidArgument),
+				LIBSAKURA_SYMBOL(ComputeAccurateStatisticsParallelFloat)(
+						data.size() - 1, data.data() + 1, is_valid.data(), 2,
+						&result));
+	}
+	LIBSAKURA_SYMBOL(CleanUp)();
+}
+
+TEST(Statistics, ComputeStatisticsBatch) {
+	LIBSAKURA_SYMBOL(Status) status = LIBSAKURA_SYMBOL(Initialize)(nullptr,
+			nullptr);
+	EXPECT_EQ(LIBSAKURA_SYMBOL(Status_kOK), status);
+
+	SIMD_ALIGN
+	static std::array<float, 3000 * 64> data;
+	SIMD_ALIGN
+	static std::array<bool, data.size()> is_valid;
+	std::mt19937 mt(4321);
+	std::uniform_real_distribution<float> value(-1000.f, 1000.f);
+	std::bernoulli_distribution valid(0.9);
+	for (size_t i = 0; i < data.size(); ++i) {
+		data[i] = value(mt);
+		is_valid[i] = valid(mt);
+	}
+	// a row with no valid data
+	std::fill(&is_valid[64], &is_valid[128], false);
+
+	struct {
+		size_t num_rows;
+		size_t num_data;
+	} const kShapes[] = { { 0, 64 }, { 1, 37 }, { 3, 64 }, { 4, 64 },
+			{ 7, 2048 }, { 13, 8192 }, { 3000, 64 }, { 5, 0 } };
+	std::vector<LIBSAKURA_SYMBOL(StatisticsResultFloat)> result;
+	for (auto const &shape : kShapes) {
+		assert(shape.num_rows * shape.num_data <= data.size());
+		for (size_t num_threads : { 1, 2, 0 }) {
+			result.assign(shape.num_rows + 1,
+					LIBSAKURA_SYMBOL(StatisticsResultFloat)());
+			status = LIBSAKURA_SYMBOL(ComputeStatisticsBatchFloat)(
+					shape.num_rows, shape.num_data, data.data(),
+					is_valid.data(), num_threads, result.data());
+			EXPECT_EQ(LIBSAKURA_SYMBOL(Status_kOK), status);
+			for (size_t i = 0; i < shape.num_rows; ++i) {
+				LIBSAKURA_SYMBOL(StatisticsResultFloat) ref;
+				status = LIBSAKURA_SYMBOL(ComputeStatisticsFloat)(
+						shape.num_data, &data[i * shape.num_data],
+						&is_valid[i * shape.num_data], &ref);
+				EXPECT_EQ(LIBSAKURA_SYMBOL(Status_kOK), status);
+				// the same reduction order as ComputeStatisticsFloat
+				EXPECT_EQ(ref.count, result[i].count);
+				EXPECT_EQ(ref.index_of_min, result[i].index_of_min);
+				EXPECT_EQ(ref.index_of_max, result[i].index_of_max);
+				ExpectEQ(ref.min, result[i].min);
+				ExpectEQ(ref.max, result[i].max);
+				EXPECT_EQ(ref.sum, result[i].sum);
+				EXPECT_EQ(ref.square_sum, result[i].square_sum);
+			}
+			// no more than num_rows results are written
+			EXPECT_EQ(0u, result[shape.num_rows].count);
+		}
+	}
+
+	{ // invalid arguments
+		LIBSAKURA_SYMBOL(StatisticsResultFloat) results[2];
+		EXPECT_EQ(LIBSAKURA_SYMBOL(Status_kInvalidArgument),
+				LIBSAKURA_SYMBOL(ComputeStatisticsBatchFloat)(2, 64, nullptr,
+						is_valid.data(), 1, results));
+		EXPECT_EQ(LIBSAKURA_SYMBOL(Status_kInvalidArgument),
+				LIBSAKURA_SYMBOL(ComputeStatisticsBatchFloat)(2, 64,
+						data.data(), nullptr, 1, results));
+		EXPECT_EQ(LIBSAKURA_SYMBOL(Status_kInvalidArgument),
+				LIBSAKURA_SYMBOL(ComputeStatisticsBatchFloat)(2, 64,
+						data.data(), is_valid.data(), 1, nullptr));
+		EXPECT_EQ(LIBSAKURA_SYMBOL(Status_kInvalidArgument),
+				LIBSAKURA_SYMBOL(ComputeStatisticsBatchFloat)(2, 64,
+						data.data() + 1, is_valid.data() + 1, 1, results));
+		// the second row is not aligned
+		EXPECT_EQ(LIBSAKURA_SYMBOL(Status_kInvalidArgument),
+				LIBSAKURA_SYMBOL(ComputeStatisticsBatchFloat)(2, 37,
+						data.data(), is_valid.data(), 1, results));
+		EXPECT_EQ(LIBSAKURA_SYMBOL(Status_kInvalidArgument),
+				LIBSAKURA_SYMBOL(ComputeStatisticsBatchFloat)(2,
+						size_t(INT32_MAX) + 1, data.data(), is_valid.data(), 1,
+						results));
+	}
+	LIBSAKURA_SYMBOL(CleanUp)();
+}
+
+TEST(Statistics, StatisticsAccumulator) {
+	LIBSAKURA_SYMBOL(Status) status = LIBSAKURA_SYMBOL(Initialize)(nullptr,
+			nullptr);
+	EXPECT_EQ(LIBSAKURA_SYMBOL(Status_kOK), status);
+
+	constexpr size_t kNumChunks = 16;
+	constexpr size_t kChunkSize = 256;
+	SIMD_ALIGN
+	static std::array<float, kNumChunks * kChunkSize> data;
+	SIMD_ALIGN
+	static std::array<bool, data.size()> is_valid;
+	// distinct integral values so that min, max and sums are unique and exact.
+	for (size_t i = 0; i < data.size(); ++i) {
+		data[i] = float(i) - 1000.f;
+		is_valid[i] = i % 3 != 0;
+	}
+	std::mt19937 mt(1234);
+	std::shuffle(data.begin(), data.end(), mt);
+
+	LIBSAKURA_SYMBOL(StatisticsResultFloat) ref;
+	status = LIBSAKURA_SYMBOL(ComputeAccurateStatisticsFloat)(data.size(),
+			data.data(), is_valid.data(), &ref);
+	EXPECT_EQ(LIBSAKURA_SYMBOL(Status_kOK), status);
+
+	{ // sequential updates
+		LIBSAKURA_SYMBOL(StatisticsAccumulatorFloat) acc;
+		EXPECT_EQ(LIBSAKURA_SYMBOL(Status_kOK),
+				LIBSAKURA_SYMBOL(InitializeStatisticsAccumulatorFloat)(&acc));
+		for (size_t i = 0; i < kNumChunks; ++i) {
+			EXPECT_EQ(LIBSAKURA_SYMBOL(Status_kOK),
+					LIBSAKURA_SYMBOL(UpdateStatisticsAccumulatorFloat)(kChunkSize,
+							&data[i * kChunkSize], &is_valid[i * kChunkSize], &acc));
+		}
+		EXPECT_EQ(data.size(), acc.num_data);
+		LIBSAKURA_SYMBOL(StatisticsResultFloat) result;
+		EXPECT_EQ(LIBSAKURA_SYMBOL(Status_kOK),
+				LIBSAKURA_SYMBOL(FinalizeStatisticsAccumulatorFloat)(&acc, &result));
+		TestResult(ref, result);
+	}
+	{ // merge accumulators of each chunk, as if they were computed in parallel
+		std::array<LIBSAKURA_SYMBOL(StatisticsAccumulatorFloat), kNumChunks> accs;
+		for (size_t i = 0; i < kNumChunks; ++i) {
+			LIBSAKURA_SYMBOL(InitializeStatisticsAccumulatorFloat)(&accs[i]);
+			EXPECT_EQ(LIBSAKURA_SYMBOL(Status_kOK),
+					LIBSAKURA_SYMBOL(UpdateStatisticsAccumulatorFloat)(kChunkSize,
+							&data[i * kChunkSize], &is_valid[i * kChunkSize],
+							&accs[i]));
+		}
+		// merge pairwise as a reduction tree does
+		for (size_t step = 1; step < kNumChunks; step *= 2) {
+			for (size_t i = 0; i + step < kNumChunks; i += 2 * step) {
+				EXPECT_EQ(LIBSAKURA_SYMBOL(Status_kOK),
+						LIBSAKURA_SYMBOL(MergeStatisticsAccumulatorFloat)(
+								&accs[i + step], &accs[i]));
+			}
+		}
+		LIBSAKURA_SYMBOL(StatisticsResultFloat) result;
+		EXPECT_EQ(LIBSAKURA_SYMBOL(Status_kOK),
+				LIBSAKURA_SYMBOL(FinalizeStatisticsAccumulatorFloat)(&accs[0],
+						&result));
+		TestResult(ref, result);
+	}
+	{ // self merge is the same as giving the same data twice
+		LIBSAKURA_SYMBOL(StatisticsAccumulatorFloat) acc;
+		LIBSAKURA_SYMBOL(InitializeStatisticsAccumulatorFloat)(&acc);
+		LIBSAKURA_SYMBOL(UpdateStatisticsAccumulatorFloat)(kChunkSize,
+				data.data(), is_valid.data(), &acc);
+		LIBSAKURA_SYMBOL(StatisticsAccumulatorFloat) twice = acc;
+		LIBSAKURA_SYMBOL(UpdateStatisticsAccumulatorFloat)(kChunkSize,
+				data.data(), is_valid.data(), &twice);
+		EXPECT_EQ(LIBSAKURA_SYMBOL(Status_kOK),
+				LIBSAKURA_SYMBOL(MergeStatisticsAccumulatorFloat)(&acc, &acc));
+		EXPECT_EQ(twice.num_data, acc.num_data);
+		TestResult(twice.statistics, acc.statistics);
+	}
+	{ // no valid data
+		SIMD_ALIGN
+		static std::array<bool, kChunkSize> none;
+		none.fill(false);
+		LIBSAKURA_SYMBOL(StatisticsAccumulatorFloat) acc;
+		LIBSAKURA_SYMBOL(InitializeStatisticsAccumulatorFloat)(&acc);
+		EXPECT_EQ(LIBSAKURA_SYMBOL(Status_kOK),
+				LIBSAKURA_SYMBOL(UpdateStatisticsAccumulatorFloat)(0,
+						data.data(), none.data(), &acc));
+		EXPECT_EQ(LIBSAKURA_SYMBOL(Status_kOK),
+				LIBSAKURA_SYMBOL(UpdateStatisticsAccumulatorFloat)(kChunkSize,
+						data.data(), none.data(), &acc));
+		LIBSAKURA_SYMBOL(StatisticsResultFloat) result;
+		LIBSAKURA_SYMBOL(FinalizeStatisticsAccumulatorFloat)(&acc, &result);
+		EXPECT_EQ(kChunkSize, acc.num_data);
+		EXPECT_EQ(0, result.count);
+		EXPECT_EQ(0., result.sum);
+		EXPECT_EQ(0., result.square_sum);
+		EXPECT_TRUE(std::isnan(result.min));
+		EXPECT_TRUE(std::isnan(result.max));
+		EXPECT_EQ(-1, result.index_of_min);
+		EXPECT_EQ(-1, result.index_of_max);
+
+		// valid data after no valid data
+		EXPECT_EQ(LIBSAKURA_SYMBOL(Status_kOK),
+				LIBSAKURA_SYMBOL(UpdateStatisticsAccumulatorFloat)(data.size(),
+						data.data(), is_valid.data(), &acc));
+		LIBSAKURA_SYMBOL(FinalizeStatisticsAccumulatorFloat)(&acc, &result);
+		EXPECT_EQ(ref.count, result.count);
+		EXPECT_EQ(ref.min, result.min);
+		EXPECT_EQ(ref.max, result.max);
+		EXPECT_EQ(ref.index_of_min + ssize_t(kChunkSize), result.index_of_min);
+		EXPECT_EQ(ref.index_of_max + ssize_t(kChunkSize), result.index_of_max);
+	}
+	{ // invalid arguments
+		LIBSAKURA_SYMBOL(StatisticsAccumulatorFloat) acc;
+		LIBSAKURA_SYMBOL(InitializeStatisticsAccumulatorFloat)(&acc);
+		LIBSAKURA_SYMBOL(StatisticsResultFloat) result;
+		EXPECT_EQ(LIBSAKURA_SYMBOL(Status_kInvalidArgument),
+				LIBSAKURA_SYMBOL(InitializeStatisticsAccumulatorFloat)(nullptr));
+		EXPECT_EQ(LIBSAKURA_SYMBOL(Status_kInvalidArgument),
+				LIBSAKURA_SYMBOL(UpdateStatisticsAccumulatorFloat)(kChunkSize,
+						data.data(), is_valid.data(), nullptr));
+		EXPECT_EQ(LIBSAKURA_SYMBOL(Status_kInvalidArgument),
+				LIBSAKURA_SYMBOL(UpdateStatisticsAccumulatorFloat)(kChunkSize,
+						nullptr, is_valid.data(), &acc));
+		EXPECT_EQ(LIBSAKURA_SYMBOL(Status_kInvalidArgument),
+				LIBSAKURA_SYMBOL(UpdateStatisticsAccumulatorFloat)(kChunkSize - 1,
+						&data[1], &is_valid[1], &acc));
+		EXPECT_EQ(LIBSAKURA_SYMBOL(Status_kInvalidArgument),
+				LIBSAKURA_SYMBOL(MergeStatisticsAccumulatorFloat)(nullptr, &acc));
+		EXPECT_EQ(LIBSAKURA_SYMBOL(Status_kInvalidArgument),
+				LIBSAKURA_SYMBOL(MergeStatisticsAccumulatorFloat)(&acc, nullptr));
+		EXPECT_EQ(LIBSAKURA_SYMBOL(Status_kInvalidArgument),
+				LIBSAKURA_SYMBOL(FinalizeStatisticsAccumulatorFloat)(nullptr,
+						&result));
+		EXPECT_EQ(LIBSAKURA_SYMBOL(Status_kInvalidArgument),
+				LIBSAKURA_SYMBOL(FinalizeStatisticsAccumulatorFloat)(&acc,
+						nullptr));
+		// a failed update leaves the accumulator as it was.
+		EXPECT_EQ(0u, acc.num_data);
+		EXPECT_EQ(0, acc.statistics.count);
+	}
+	LIBSAKURA_SYMBOL(CleanUp)();
+}
+
 namespace {
 
 template<typename MessageType>
@@ -1023,3 +1407,209 @@ TEST(Statistics, ComputeStatistics_Performance) {
 }
 	LIBSAKURA_SYMBOL(CleanUp)();
 }
+
+namespace {
+
+/*
+ * Random data with many duplicated values and random validity.
+ */
+void MakeSelectionTestData(size_t num_data, unsigned seed, std::vector<float> *data,
+		std::vector<char> *is_valid) {
+	std::mt19937 engine(seed);
+	std::uniform_int_distribution<int> value(-50, 50);
+	std::uniform_int_distribution<int> validity(0, 9);
+	// reserve so that data() is not null even if num_data is 0
+	data->reserve(num_data + 1);
+	is_valid->reserve(num_data + 1);
+	data->resize(num_data);
+	is_valid->resize(num_data);
+	for (size_t i = 0; i < num_data; ++i) {
+		(*data)[i] = value(engine) * 0.5f;
+		(*is_valid)[i] = validity(engine) != 0;
+	}
+}
+
+std::vector<float> SortedValidValues(std::vector<float> const &data,
+		std::vector<char> const &is_valid) {
+	std::vector<float> sorted;
+	for (size_t i = 0; i < data.size(); ++i) {
+		if (is_valid[i]) {
+			sorted.push_back(data[i]);
+		}
+	}
+	std::sort(sorted.begin(), sorted.end());
+	return sorted;
+}
+
+float MedianOfSorted(std::vector<float> const &sorted) {
+	size_t const n = sorted.size();
+	return (sorted[n / 2] + sorted[n / 2 - (1 - n % 2)]) / 2;
+}
+
+size_t const kSelectionTestLengths[] = { 0, 1, 2, 3, 15, 16, 17, 63, 64, 65,
+		100, 1000, 4097, 100000 };
+
+}
+
+TEST(Statistics, ComputeQuantiles) {
+	LIBSAKURA_SYMBOL(Status) result = LIBSAKURA_SYMBOL(Initialize)(nullptr,
+			nullptr);
+	EXPECT_EQ(LIBSAKURA_SYMBOL(Status_kOK), result);
+
+	double const probability[] = { 0.75, 0., 0.5, 1., 0.1, 0.5, 0.99 };
+	float quantile[ELEMENTSOF(probability)];
+	for (auto num_data : kSelectionTestLengths) {
+		std::vector<float> data;
+		std::vector<char> is_valid;
+		MakeSelectionTestData(num_data, num_data, &data, &is_valid);
+		auto const sorted = SortedValidValues(data, is_valid);
+		size_t new_elements = size_t(-1);
+		result = LIBSAKURA_SYMBOL(ComputeQuantilesFloat)(num_data,
+				reinterpret_cast<bool const *>(is_valid.data()), data.data(),
+				ELEMENTSOF(probability), probability, quantile, &new_elements);
+		EXPECT_EQ(LIBSAKURA_SYMBOL(Status_kOK), result);
+		ASSERT_EQ(sorted.size(), new_elements);
+		for (size_t i = 0; i < ELEMENTSOF(probability); ++i) {
+			if (sorted.empty()) {
+				EXPECT_TRUE(std::isnan(quantile[i]));
+				continue;
+			}
+			double const position = probability[i] * (sorted.size() - 1);
+			size_t const rank = static_cast<size_t>(position);
+			float expected = sorted[rank];
+			if (rank + 1 < sorted.size()) {
+				expected = static_cast<float>(sorted[rank]
+						+ (position - rank)
+								* (static_cast<double>(sorted[rank + 1])
+										- sorted[rank]));
+			}
+			EXPECT_EQ(expected, quantile[i]) << "num_data = " << num_data
+					<< ", probability = " << probability[i];
+		}
+		if (!sorted.empty()) {
+			EXPECT_EQ(MedianOfSorted(sorted), quantile[2]);
+		}
+	}
+
+	{
+		SIMD_ALIGN
+		float data[] = { 2.f, -2.f, 3.f };
+		SIMD_ALIGN
+		bool const is_valid[] = { true, true, true };
+		double const bad_probability[] = { 0.5, 1.5 };
+		size_t new_elements = size_t(-1);
+		result = LIBSAKURA_SYMBOL(ComputeQuantilesFloat)(ELEMENTSOF(data),
+				is_valid, data, ELEMENTSOF(bad_probability), bad_probability,
+				quantile, &new_elements);
+		EXPECT_EQ(LIBSAKURA_SYMBOL(Status_kInvalidArgument), result);
+		result = LIBSAKURA_SYMBOL(ComputeQuantilesFloat)(ELEMENTSOF(data),
+				nullptr, data, 1, probability, quantile, &new_elements);
+		EXPECT_EQ(LIBSAKURA_SYMBOL(Status_kInvalidArgument), result);
+		EXPECT_EQ(size_t(-1), new_elements);
+	}
+	LIBSAKURA_SYMBOL(CleanUp)();
+}
+
+TEST(Statistics, ComputeMedianAndMedianAbsoluteDeviation) {
+	LIBSAKURA_SYMBOL(Status) result = LIBSAKURA_SYMBOL(Initialize)(nullptr,
+			nullptr);
+	EXPECT_EQ(LIBSAKURA_SYMBOL(Status_kOK), result);
+
+	for (auto num_data : kSelectionTestLengths) {
+		std::vector<float> data;
+		std::vector<char> is_valid;
+		MakeSelectionTestData(num_data, num_data + 1, &data, &is_valid);
+		auto sorted = SortedValidValues(data, is_valid);
+		std::vector<float> data_copy;
+		data_copy.reserve(num_data + 1);
+		data_copy.assign(data.begin(), data.end());
+		float median = 0.f;
+		float mad = 0.f;
+		size_t new_elements = size_t(-1);
+		result = LIBSAKURA_SYMBOL(ComputeMedianAndMedianAbsoluteDeviationFloat)(
+				num_data, reinterpret_cast<bool const *>(is_valid.data()),
+				data.data(), &median, &mad, &new_elements);
+		EXPECT_EQ(LIBSAKURA_SYMBOL(Status_kOK), result);
+		ASSERT_EQ(sorted.size(), new_elements);
+		float median_only = 0.f;
+		result = LIBSAKURA_SYMBOL(ComputeMedianFloat)(num_data,
+				reinterpret_cast<bool const *>(is_valid.data()),
+				data_copy.data(), &median_only, &new_elements);
+		EXPECT_EQ(LIBSAKURA_SYMBOL(Status_kOK), result);
+		if (sorted.empty()) {
+			EXPECT_TRUE(std::isnan(median));
+			EXPECT_TRUE(std::isnan(mad));
+			EXPECT_TRUE(std::isnan(median_only));
+			continue;
+		}
+		auto const expected_median = MedianOfSorted(sorted);
+		EXPECT_EQ(expected_median, median) << "num_data = " << num_data;
+		EXPECT_EQ(expected_median, median_only) << "num_data = " << num_data;
+		for (auto &value : sorted) {
+			value = std::abs(value - expected_median);
+		}
+		std::sort(sorted.begin(), sorted.end());
+		EXPECT_EQ(MedianOfSorted(sorted), mad) << "num_data = " << num_data;
+	}
+
+	{
+		SIMD_ALIGN
+		float data[] = { 2.f, -2.f, 3.f };
+		float median = 0.f;
+		size_t new_elements = size_t(-1);
+		result = LIBSAKURA_SYMBOL(ComputeMedianAndMedianAbsoluteDeviationFloat)(
+				ELEMENTSOF(data), nullptr, data, &median, nullptr,
+				&new_elements);
+		EXPECT_EQ(LIBSAKURA_SYMBOL(Status_kInvalidArgument), result);
+		EXPECT_EQ(size_t(-1), new_elements);
+	}
+	LIBSAKURA_SYMBOL(CleanUp)();
+}
+
+TEST(Statistics, ComputeMedian_Performance) {
+	LIBSAKURA_SYMBOL(Status) result = LIBSAKURA_SYMBOL(Initialize)(nullptr,
+			nullptr);
+	EXPECT_EQ(LIBSAKURA_SYMBOL(Status_kOK), result);
+
+	size_t const num_data = 100000;
+	size_t const num_repeat = 200;
+	std::vector<float> original(num_data);
+	std::mt19937 engine(0);
+	std::normal_distribution<float> noise(0.f, 1.f);
+	for (auto &value : original) {
+		value = noise(engine);
+	}
+	std::vector<char> is_valid(num_data, true);
+	std::vector<float> data;
+	float median = 0.f;
+	float mad = 0.f;
+	size_t new_elements = 0;
+
+	double elapsed = 0.;
+	for (size_t i = 0; i < num_repeat; ++i) {
+		data = original;
+		double start = GetCurrentTime();
+		result = LIBSAKURA_SYMBOL(SortValidValuesDenselyFloat)(num_data,
+				reinterpret_cast<bool const *>(is_valid.data()), data.data(),
+				&new_elements);
+		EXPECT_EQ(LIBSAKURA_SYMBOL(Status_kOK), result);
+		result = LIBSAKURA_SYMBOL(ComputeMedianAbsoluteDeviationFloat)(
+				new_elements, data.data(), data.data());
+		EXPECT_EQ(LIBSAKURA_SYMBOL(Status_kOK), result);
+		elapsed += GetCurrentTime() - start;
+	}
+	ReportBenchmark("SortAndComputeMedianAbsoluteDeviationFloat", elapsed);
+
+	elapsed = 0.;
+	for (size_t i = 0; i < num_repeat; ++i) {
+		data = original;
+		double start = GetCurrentTime();
+		result = LIBSAKURA_SYMBOL(ComputeMedianAndMedianAbsoluteDeviationFloat)(
+				num_data, reinterpret_cast<bool const *>(is_valid.data()),
+				data.data(), &median, &mad, &new_elements);
+		EXPECT_EQ(LIBSAKURA_SYMBOL(Status_kOK), result);
+		elapsed += GetCurrentTime() - start;
+	}
+	ReportBenchmark("ComputeMedianAndMedianAbsoluteDeviationFloat", elapsed);
+	LIBSAKURA_SYMBOL(CleanUp)();
+}
@@ -1,12 +1,14 @@
 #include <sys/time.h>
 #include <unistd.h>
 #include <getopt.h>
+#include <pthread.h>
 #include <cstdio>
 #include <cassert>
 #include <cstring>
 #include <cstdlib>
 #include <string>
 #include <memory>
+#include <vector>
 #include <iostream>
 
 #include <casa/aips.h>
@@ -17,6 +19,7 @@
 #include <tables/Tables/Table.h>
 #include <ms/MeasurementSets.h>
 #include "SQLite.h"
+#include "BlobCodec.h"
 
 #define unique_ptr auto_ptr
 #define enter() do { cout << "Enter: " << __FUNCTION__ << endl; } while (0)
@@ -29,6 +32,14 @@ namespace {
 char const ENV_VAR_SAKURA_ROOT[] = "SAKURA_ROOT";
 
 bool ignore_error = false;
+bool bulk_load = false;
+int main_readers = 1;
+// Codecs for spectra and flags of MAIN, or NULL to store them as is.
+blobcodec::Codec const *spectrum_codec = NULL;
+blobcodec::Codec const *flag_codec = NULL;
+
+// Rows committed at once in bulk-load mode.
+uInt const BULK_BATCH_ROWS = 100000;
 
 union {
   int i;
@@ -38,45 +49,195 @@ union {
   int64_t i64;
 } DUMMY_AREA[1];
 
+// Rows of MAIN read at once by a reader thread.
+uInt const MAIN_STAGING_ROWS = 1024;
+
+/**
+ * Values of rows to be inserted later, possibly by another thread.
+ * Values of the last row are set by the same setters as PreparedStatement.
+ */
+class StagedRows {
+  enum Type {
+    NULL_VALUE,
+    INT_VALUE,
+    DOUBLE_VALUE,
+    BLOB_VALUE
+  };
+  struct Value {
+    Type type;
+    int64_t i;
+    double d;
+    size_t offset; // in blobs
+    size_t size;
+  };
+  int const nCols;
+  vector<Value> values; // nCols values for each row
+  vector<char> blobs;
+
+  Value &at(int pos) {
+    assert(1 <= pos && pos <= nCols);
+    assert(values.size() >= static_cast<size_t>(nCols));
+    return values[values.size() - nCols + pos - 1];
+  }
+
+public:
+  StagedRows(int nCols) : nCols(nCols), values(), blobs() {
+  }
+  void clear() {
+    values.clear();
+    blobs.clear();
+  }
+  /**
+   * Appends a row whose values are NULL.
+   */
+  void addRow() {
+    Value null = { NULL_VALUE, 0, 0., 0, 0 };
+    values.resize(values.size() + nCols, null);
+  }
+  size_t getNumberOfRows() const {
+    return values.size() / nCols;
+  }
+  void setNull(int pos) {
+    at(pos).type = NULL_VALUE;
+  }
+  void setInt(int pos, int64_t value) {
+    Value &v = at(pos);
+    v.type = INT_VALUE;
+    v.i = value;
+  }
+  void setDouble(int pos, double value) {
+    Value &v = at(pos);
+    v.type = DOUBLE_VALUE;
+    v.d = value;
+  }
+  void setTransientBlob(int pos, void const *value, int size) {
+    Value &v = at(pos);
+    v.type = BLOB_VALUE;
+    v.offset = blobs.size();
+    v.size = size;
+    char const *p = static_cast<char const *>(value);
+    blobs.insert(blobs.end(), p, p + size);
+  }
+  /**
+   * Binds values of the row-th row to stmt without copying blobs,
+   * which are valid until this instance is modified.
+   */
+  void bind(size_t row, PreparedStatement *stmt) const throw (SQLException) {
+    for (int pos = 1; pos <= nCols; pos++) {
+      Value const &v = values[row * nCols + pos - 1];
+      switch (v.type) {
+      case NULL_VALUE:
+	stmt->setNull(pos);
+	break;
+      case INT_VALUE:
+	stmt->setInt(pos, v.i);
+	break;
+      case DOUBLE_VALUE:
+	stmt->setDouble(pos, v.d);
+	break;
+      case BLOB_VALUE:
+	stmt->setStaticBlob(pos, v.size > 0 ? &blobs[v.offset] : (void const *)DUMMY_AREA,
+			    v.size);
+	break;
+      }
+    }
+  }
+};
+
+/**
+ * Binder is PreparedStatement or StagedRows.
+ */
 template<typename T>
-void bindArrayAsBlob(PreparedStatement *stmt, int pos, Array<T> const &v) throw (SQLException) {
-  Bool deleteIt = false;
-  T const *data = v.getStorage(deleteIt);
-  try {
-    size_t elements = v.nelements();
-    T const *blobData = data;
-    //cout << "data: " << data <<", " << elements << endl;;
-    if (data == NULL) {
-      assert(elements == 0);
-      blobData = (T const *)DUMMY_AREA;
+struct BlobBinder {
+  static size_t const ELEMENT_SIZE = sizeof(T);
+
+  template<typename Binder>
+  static void bind(Binder *stmt, int pos, Array<T> const &v) throw (SQLException) {
+    Bool deleteIt = false;
+    T const *data = v.getStorage(deleteIt);
+    try {
+      size_t elements = v.nelements();
+      T const *blobData = data;
+      //cout << "data: " << data <<", " << elements << endl;;
+      if (data == NULL) {
+	assert(elements == 0);
+	blobData = (T const *)DUMMY_AREA;
+      }
+      stmt->setTransientBlob(pos, blobData, sizeof(T) * elements);
+    } catch (...) {
+      v.freeStorage(data, deleteIt);
+      throw;
     }
-    stmt->setTransientBlob(pos, blobData, sizeof(T) * elements);
-  } catch (...) {
     v.freeStorage(data, deleteIt);
-    throw;
   }
-  v.freeStorage(data, deleteIt);
-}
+};
 
+/*
+ * Complex is stored as float real parts followed by float imaginary parts.
+ */
 template<>
-void bindArrayAsBlob<Complex>(PreparedStatement *stmt, int pos, Array<Complex> const &v) throw (SQLException) {
-  size_t elements = v.nelements();
-  float *const blob = new float[elements * 2];
-  float *real = blob;
-  float *imag = &blob[elements];
-  try {
-    Array<Complex>::const_iterator end = v.end();
-    size_t i = 0;
-    for (Array<Complex>::const_iterator it = v.begin(); it != end; ++it, ++i) {
-      real[i] = it->real();
-      imag[i] = it->imag();
+struct BlobBinder<Complex> {
+  static size_t const ELEMENT_SIZE = sizeof(float);
+
+  template<typename Binder>
+  static void bind(Binder *stmt, int pos, Array<Complex> const &v) throw (SQLException) {
+    size_t elements = v.nelements();
+    float *const blob = new float[elements * 2];
+    float *real = blob;
+    float *imag = &blob[elements];
+    try {
+      Array<Complex>::const_iterator end = v.end();
+      size_t i = 0;
+      for (Array<Complex>::const_iterator it = v.begin(); it != end; ++it, ++i) {
+	real[i] = it->real();
+	imag[i] = it->imag();
+      }
+      stmt->setTransientBlob(pos, blob, 2 * sizeof(float) * elements);
+    } catch (...) {
+      delete [] blob;
+      throw;
     }
-    stmt->setTransientBlob(pos, blob, 2 * sizeof(float) * elements);
-  } catch (...) {
     delete [] blob;
-    throw;
   }
-  delete [] blob;
+};
+
+template<typename T, typename Binder>
+void bindArrayAsBlob(Binder *stmt, int pos, Array<T> const &v) throw (SQLException) {
+  BlobBinder<T>::bind(stmt, pos, v);
+}
+
+/**
+ * Binds blobs to Binder after encoding them by a codec.
+ */
+template<typename Binder>
+class EncodingBinder {
+  Binder *const stmt;
+  blobcodec::Codec const *const codec;
+  size_t const elementSize;
+  vector<char> buf;
+public:
+  EncodingBinder(Binder *stmt, blobcodec::Codec const *codec, size_t elementSize)
+    : stmt(stmt), codec(codec), elementSize(elementSize), buf() {
+  }
+  void setTransientBlob(int pos, void const *value, int size) throw (SQLException) {
+    buf.resize(blobcodec::getMaxEncodedSize(size));
+    size_t encoded = blobcodec::encode(codec, value, size, elementSize, &buf[0]);
+    stmt->setTransientBlob(pos, &buf[0], encoded);
+  }
+};
+
+/**
+ * Same as above but encodes v by codec unless it is NULL.
+ */
+template<typename T, typename Binder>
+void bindArrayAsBlob(Binder *stmt, int pos, Array<T> const &v,
+		     blobcodec::Codec const *codec) throw (SQLException) {
+  if (codec == NULL) {
+    bindArrayAsBlob<T>(stmt, pos, v);
+    return;
+  }
+  EncodingBinder<Binder> binder(stmt, codec, BlobBinder<T>::ELEMENT_SIZE);
+  BlobBinder<T>::bind(&binder, pos, v);
 }
 
 void executeUpdate1(PreparedStatement *stmt) throw (SQLException) {
@@ -92,6 +253,18 @@ void executeUpdate1(PreparedStatement *stmt) throw (SQLException) {
   }
 }
 
+/**
+ * Commits rows inserted so far and begins a new transaction every
+ * BULK_BATCH_ROWS rows in bulk-load mode, so that a huge table is not
+ * loaded in a single transaction.
+ */
+void commitBatch(Connection *con, uInt row) throw (SQLException) {
+  if (bulk_load && (row + 1) % BULK_BATCH_ROWS == 0) {
+    con->execute("COMMIT");
+    con->execute("BEGIN");
+  }
+}
+
 void savePol(Connection *con, MeasurementSet &ms) {
   enter();
   MSPolarization &pol = ms.polarization();
@@ -1187,6 +1360,7 @@ void saveWeather(Connection *con, MeasurementSet &ms) {
 
     assert(pos == stmt->getParameterCount());
     executeUpdate1(stmt.get());
+    commitBatch(con, i);
   }
 }
 
@@ -1275,6 +1449,7 @@ void savePointing(Connection *con, MeasurementSet &ms) {
 
     assert(pos == stmt->getParameterCount());
     executeUpdate1(stmt.get());
+    commitBatch(con, i);
   }
 }
 
@@ -1433,12 +1608,342 @@ void saveSysCal(Connection *con, MeasurementSet &ms) {
 
     assert(pos == stmt->getParameterCount());
     executeUpdate1(stmt.get());
+    commitBatch(con, i);
+  }
+}
+
+/**
+ * Reads the i-th row of MAIN into the last row of row.
+ */
+void readMainRow(ROMSColumns const &cols, uInt i, StagedRows *row) {
+  enum {
+    MAIN_ID = 1,
+    TIME,
+    TIME_EXTRA_PREC,
+    ANTENNA1,
+    ANTENNA2,
+    ANTENNA3,
+    FEED1,
+    FEED2,
+    FEED3,
+    DATA_DESC_ID,
+    PROCESSOR_ID,
+    PHASE_ID,
+    FIELD_ID,
+    INTERVAL,
+    EXPOSURE,
+    TIME_CENTROID,
+    PULSAR_BIN,
+    PULSAR_GATE_ID,
+    SCAN_NUMBER,
+    ARRAY_ID,
+    OBSERVATION_ID,
+    STATE_ID,
+    BASELINE_REF,
+    U,
+    V,
+    W,
+    U2,
+    V2,
+    W2,
+    DATA,
+    FLOAT_DATA,
+    VIDEO_POINT,
+    LAG_DATA,
+    SIGMA,
+    SIGMA_SPECTRUM,
+    WEIGHT,
+    WEIGHT_SPECTRUM,
+    FLAG,
+    FLAG_CATEGORY,
+    FLAG_ROW
+  };
+
+  row->setInt(MAIN_ID, i);
+  row->setDouble(TIME, cols.time()(i));
+  if (cols.timeExtraPrec().isNull()) {
+    row->setNull(TIME_EXTRA_PREC);
+  } else {
+    row->setDouble(TIME_EXTRA_PREC, cols.timeExtraPrec()(i));
+  }
+  row->setInt(ANTENNA1, cols.antenna1()(i));
+  row->setInt(ANTENNA2, cols.antenna2()(i));
+  if (cols.antenna3().isNull()) {
+    row->setNull(ANTENNA3);
+  } else {
+    row->setInt(ANTENNA3, cols.antenna3()(i));
+  }
+  row->setInt(FEED1, cols.feed1()(i));
+  row->setInt(FEED2, cols.feed2()(i));
+  if (cols.feed3().isNull()) {
+    row->setNull(FEED3);
+  } else {
+    row->setInt(FEED3, cols.feed3()(i));
+  }
+  row->setInt(DATA_DESC_ID, cols.dataDescId()(i));
+  row->setInt(PROCESSOR_ID, cols.processorId()(i));
+  if (cols.phaseId().isNull()) {
+    row->setNull(PHASE_ID);
+  } else {
+    row->setInt(PHASE_ID, cols.phaseId()(i));
+  }
+  row->setInt(FIELD_ID, cols.fieldId()(i));
+  row->setDouble(INTERVAL, cols.interval()(i));
+  row->setDouble(EXPOSURE, cols.exposure()(i));
+  row->setDouble(TIME_CENTROID, cols.timeCentroid()(i));
+  if (cols.pulsarBin().isNull()) {
+    row->setNull(PULSAR_BIN);
+  } else {
+    row->setInt(PULSAR_BIN, cols.pulsarBin()(i));
+  }
+  if (cols.pulsarGateId().isNull()) {
+    row->setNull(PULSAR_GATE_ID);
+  } else {
+    row->setInt(PULSAR_GATE_ID, cols.pulsarGateId()(i));
+  }
+  row->setInt(SCAN_NUMBER, cols.scanNumber()(i));
+  row->setInt(ARRAY_ID, cols.arrayId()(i));
+  row->setInt(OBSERVATION_ID, cols.observationId()(i));
+  row->setInt(STATE_ID, cols.stateId()(i));
+  if (cols.baselineRef().isNull()) {
+    row->setNull(BASELINE_REF);
+  } else {
+    row->setInt(BASELINE_REF, cols.baselineRef()(i) ? 1 : 0);
+  }
+  {
+    Array< Double > const &v = cols.uvw()(i);
+    // const IPosition &shape = v.shape();
+    assert(v.nelements() == 3);
+    Double const *data = v.data();
+    row->setDouble(U, data[0]);
+    row->setDouble(V, data[1]);
+    row->setDouble(W, data[2]);
+  }
+  if (cols.uvw2().isNull()) {
+    row->setNull(U2);
+    row->setNull(V2);
+    row->setNull(W2);
+  } else {
+    Array< Double > const &v = cols.uvw2()(i);
+    // const IPosition &shape = v.shape();
+    assert(v.nelements() == 3);
+    Double const *data = v.data();
+    row->setDouble(U2, data[0]);
+    row->setDouble(V2, data[1]);
+    row->setDouble(W2, data[2]);
+  }
+  if (cols.data().isNull()) {
+    row->setNull(DATA);
+  } else {
+    bindArrayAsBlob<Complex>(row, DATA, cols.data()(i), spectrum_codec);
+  }
+  if (cols.floatData().isNull()) {
+    row->setNull(FLOAT_DATA);
+  } else {
+    bindArrayAsBlob<Float>(row, FLOAT_DATA, cols.floatData()(i), spectrum_codec);
+  }
+  if (cols.videoPoint().isNull()) {
+    row->setNull(VIDEO_POINT);
+  } else {
+    bindArrayAsBlob<Complex>(row, VIDEO_POINT, cols.videoPoint()(i),
+			     spectrum_codec);
+  }
+  if (cols.lagData().isNull()) {
+    row->setNull(LAG_DATA);
+  } else {
+    bindArrayAsBlob<Complex>(row, LAG_DATA, cols.lagData()(i), spectrum_codec);
+  }
+  bindArrayAsBlob<Float>(row, SIGMA, cols.sigma()(i));
+  if (cols.sigmaSpectrum().isNull()) {
+    row->setNull(SIGMA_SPECTRUM);
+  } else {
+    bindArrayAsBlob<Float>(row, SIGMA_SPECTRUM, cols.sigmaSpectrum()(i),
+			   spectrum_codec);
+  }
+  bindArrayAsBlob<Float>(row, WEIGHT, cols.weight()(i));
+  if (cols.weightSpectrum().isNull()) {
+    row->setNull(WEIGHT_SPECTRUM);
+  } else {
+    bindArrayAsBlob<Float>(row, WEIGHT_SPECTRUM, cols.weightSpectrum()(i),
+			   spectrum_codec);
+  }
+  bindArrayAsBlob<Bool>(row, FLAG, cols.flag()(i), flag_codec);
+  bindArrayAsBlob<Bool>(row, FLAG_CATEGORY, cols.flagCategory()(i), flag_codec);
+  row->setInt(FLAG_ROW, cols.flagRow()(i) ? 1 : 0);
+}
+
+/**
+ * Staging buffers through which reader threads pass batches of rows of
+ * MAIN to the writer, the thread inserting them into SQLite in order.
+ *
+ * Batch b, rows [b * MAIN_STAGING_ROWS, (b + 1) * MAIN_STAGING_ROWS),
+ * is read by reader (b % nReaders) into slot (b % (2 * nReaders)),
+ * so that each reader can fill a slot while the writer inserts another.
+ */
+class MainStaging {
+  pthread_mutex_t mutex;
+  pthread_cond_t cond;
+  vector<StagedRows *> slots;
+  vector<long> slotBatch; // batch staged in the slot, or -1 if empty
+  bool aborted; // the writer gave up
+  bool failed; // a reader gave up
+
+  class Lock {
+    pthread_mutex_t *mutex;
+  public:
+    Lock(pthread_mutex_t *m) : mutex(m) {
+      pthread_mutex_lock(mutex);
+    }
+    ~Lock() {
+      pthread_mutex_unlock(mutex);
+    }
+  };
+
+public:
+  MeasurementSet *const ms; // used by the reader if nReaders is 1
+  uInt const nrow;
+  int const nReaders;
+  pthread_mutex_t casaMutex; // to open or close another MeasurementSet
+
+  MainStaging(MeasurementSet *ms, int nReaders, int nCols)
+    : slots(), slotBatch(2 * nReaders, -1), aborted(false), failed(false),
+      ms(ms), nrow(ms->nrow()), nReaders(nReaders) {
+    pthread_mutex_init(&mutex, NULL);
+    pthread_cond_init(&cond, NULL);
+    pthread_mutex_init(&casaMutex, NULL);
+    for (int i = 0; i < 2 * nReaders; i++) {
+      slots.push_back(new StagedRows(nCols));
+    }
+  }
+  ~MainStaging() {
+    for (vector<StagedRows *>::iterator i = slots.begin(), end = slots.end();
+	 i != end; ++i) {
+      delete *i;
+    }
+    pthread_mutex_destroy(&casaMutex);
+    pthread_cond_destroy(&cond);
+    pthread_mutex_destroy(&mutex);
+  }
+
+  long getNumberOfBatches() const {
+    return (static_cast<long>(nrow) + MAIN_STAGING_ROWS - 1) / MAIN_STAGING_ROWS;
+  }
+
+  /**
+   * Called by a reader. Returns an empty slot for batch,
+   * or NULL if the writer gave up.
+   */
+  StagedRows *beginFill(long batch) {
+    size_t slot = batch % slots.size();
+    Lock lock(&mutex);
+    while (slotBatch[slot] >= 0 && ! aborted) {
+      pthread_cond_wait(&cond, &mutex);
+    }
+    if (aborted) {
+      return NULL;
+    }
+    slots[slot]->clear();
+    return slots[slot];
+  }
+  void endFill(long batch) {
+    size_t slot = batch % slots.size();
+    Lock lock(&mutex);
+    slotBatch[slot] = batch;
+    pthread_cond_broadcast(&cond);
+  }
+  void fail() {
+    Lock lock(&mutex);
+    failed = true;
+    pthread_cond_broadcast(&cond);
   }
+
+  /**
+   * Called by the writer. Returns rows of batch, or NULL if a reader
+   * gave up.
+   */
+  StagedRows const *waitFull(long batch) {
+    size_t slot = batch % slots.size();
+    Lock lock(&mutex);
+    while (slotBatch[slot] != batch && ! failed) {
+      pthread_cond_wait(&cond, &mutex);
+    }
+    if (slotBatch[slot] != batch) {
+      return NULL;
+    }
+    return slots[slot];
+  }
+  void release(long batch) {
+    size_t slot = batch % slots.size();
+    Lock lock(&mutex);
+    slotBatch[slot] = -1;
+    pthread_cond_broadcast(&cond);
+  }
+  void abort() {
+    Lock lock(&mutex);
+    aborted = true;
+    pthread_cond_broadcast(&cond);
+  }
+};
+
+struct MainReader {
+  MainStaging *staging;
+  int id;
+  pthread_t thread;
+};
+
+void *readMain(void *arg) {
+  MainReader *reader = static_cast<MainReader *>(arg);
+  MainStaging &staging = *reader->staging;
+  MeasurementSet *ms = staging.ms;
+  try {
+    if (staging.nReaders > 1) {
+      pthread_mutex_lock(&staging.casaMutex);
+      try {
+	ms = new MeasurementSet(staging.ms->tableName());
+      } catch (...) {
+	pthread_mutex_unlock(&staging.casaMutex);
+	throw;
+      }
+      pthread_mutex_unlock(&staging.casaMutex);
+    }
+    try {
+      ROMSColumns const cols(*ms);
+      for (long batch = reader->id, end = staging.getNumberOfBatches();
+	   batch < end; batch += staging.nReaders) {
+	StagedRows *rows = staging.beginFill(batch);
+	if (rows == NULL) {
+	  break;
+	}
+	uInt first = batch * MAIN_STAGING_ROWS;
+	uInt last = min(first + MAIN_STAGING_ROWS, staging.nrow);
+	for (uInt i = first; i < last; i++) {
+	  rows->addRow();
+	  readMainRow(cols, i, rows);
+	}
+	staging.endFill(batch);
+      }
+    } catch (...) {
+      if (ms != staging.ms) {
+	pthread_mutex_lock(&staging.casaMutex);
+	delete ms;
+	pthread_mutex_unlock(&staging.casaMutex);
+      }
+      throw;
+    }
+    if (ms != staging.ms) {
+      pthread_mutex_lock(&staging.casaMutex);
+      delete ms;
+      pthread_mutex_unlock(&staging.casaMutex);
+    }
+  } catch (...) {
+    cerr << "Failed to read rows of MAIN.\n";
+    staging.fail();
+  }
+  return NULL;
 }
 
 void saveMain(Connection *con, MeasurementSet &ms) {
   enter();
-  ROMSColumns const cols(ms);
 
   char const *dbcols[] = {
     "MAIN_ID", // INTEGER NOT NULL PRIMARY KEY AUTOINCREMENT,
@@ -1484,165 +1989,52 @@ void saveMain(Connection *con, MeasurementSet &ms) {
     NULL
   };
 
-  enum {
-    MAIN_ID = 1,
-    TIME,
-    TIME_EXTRA_PREC,
-    ANTENNA1,
-    ANTENNA2,
-    ANTENNA3,
-    FEED1,
-    FEED2,
-    FEED3,
-    DATA_DESC_ID,
-    PROCESSOR_ID,
-    PHASE_ID,
-    FIELD_ID,
-    INTERVAL,
-    EXPOSURE,
-    TIME_CENTROID,
-    PULSAR_BIN,
-    PULSAR_GATE_ID,
-    SCAN_NUMBER,
-    ARRAY_ID,
-    OBSERVATION_ID,
-    STATE_ID,
-    BASELINE_REF,
-    U,
-    V,
-    W,
-    U2,
-    V2,
-    W2,
-    DATA,
-    FLOAT_DATA,
-    VIDEO_POINT,
-    LAG_DATA,
-    SIGMA,
-    SIGMA_SPECTRUM,
-    WEIGHT,
-    WEIGHT_SPECTRUM,
-    FLAG,
-    FLAG_CATEGORY,
-    FLAG_ROW
-  };
-
   string sql = "insert into MAIN (";
   sql += SQL::join(dbcols) + ") values (";
   sql += SQL::bindChars(dbcols) + ")";
   unique_ptr<PreparedStatement> stmt(con->prepare(sql.c_str()));
 
-  uInt nrow = ms.nrow();
-  for (uInt i = 0; i < nrow; i++) {
-    stmt->setInt(MAIN_ID, i);
-    stmt->setDouble(TIME, cols.time()(i));
-    if (cols.timeExtraPrec().isNull()) {
-      stmt->setNull(TIME_EXTRA_PREC);
-    } else {
-      stmt->setDouble(TIME_EXTRA_PREC, cols.timeExtraPrec()(i));
-    }
-    stmt->setInt(ANTENNA1, cols.antenna1()(i));
-    stmt->setInt(ANTENNA2, cols.antenna2()(i));
-    if (cols.antenna3().isNull()) {
-      stmt->setNull(ANTENNA3);
-    } else {
-      stmt->setInt(ANTENNA3, cols.antenna3()(i));
-    }
-    stmt->setInt(FEED1, cols.feed1()(i));
-    stmt->setInt(FEED2, cols.feed2()(i));
-    if (cols.feed3().isNull()) {
-      stmt->setNull(FEED3);
-    } else {
-      stmt->setInt(FEED3, cols.feed3()(i));
-    }
-    stmt->setInt(DATA_DESC_ID, cols.dataDescId()(i));
-    stmt->setInt(PROCESSOR_ID, cols.processorId()(i));
-    if (cols.phaseId().isNull()) {
-      stmt->setNull(PHASE_ID);
-    } else {
-      stmt->setInt(PHASE_ID, cols.phaseId()(i));
-    }
-    stmt->setInt(FIELD_ID, cols.fieldId()(i));
-    stmt->setDouble(INTERVAL, cols.interval()(i));
-    stmt->setDouble(EXPOSURE, cols.exposure()(i));
-    stmt->setDouble(TIME_CENTROID, cols.timeCentroid()(i));
-    if (cols.pulsarBin().isNull()) {
-      stmt->setNull(PULSAR_BIN);
-    } else {
-      stmt->setInt(PULSAR_BIN, cols.pulsarBin()(i));
-    }
-    if (cols.pulsarGateId().isNull()) {
-      stmt->setNull(PULSAR_GATE_ID);
-    } else {
-      stmt->setInt(PULSAR_GATE_ID, cols.pulsarGateId()(i));
-    }
-    stmt->setInt(SCAN_NUMBER, cols.scanNumber()(i));
-    stmt->setInt(ARRAY_ID, cols.arrayId()(i));
-    stmt->setInt(OBSERVATION_ID, cols.observationId()(i));
-    stmt->setInt(STATE_ID, cols.stateId()(i));
-    if (cols.baselineRef().isNull()) {
-      stmt->setNull(BASELINE_REF);
-    } else {
-      stmt->setInt(BASELINE_REF, cols.baselineRef()(i) ? 1 : 0);
-    }
-    {
-      Array< Double > const &v = cols.uvw()(i);
-      // const IPosition &shape = v.shape();
-      assert(v.nelements() == 3);
-      Double const *data = v.data();
-      stmt->setDouble(U, data[0]);
-      stmt->setDouble(V, data[1]);
-      stmt->setDouble(W, data[2]);
-    }
-    if (cols.uvw2().isNull()) {
-      stmt->setNull(U2);
-      stmt->setNull(V2);
-      stmt->setNull(W2);
-    } else {
-      Array< Double > const &v = cols.uvw2()(i);
-      // const IPosition &shape = v.shape();
-      assert(v.nelements() == 3);
-      Double const *data = v.data();
-      stmt->setDouble(U2, data[0]);
-      stmt->setDouble(V2, data[1]);
-      stmt->setDouble(W2, data[2]);
-    }
-    if (cols.data().isNull()) {
-      stmt->setNull(DATA);
-    } else {
-      bindArrayAsBlob<Complex>(stmt.get(), DATA, cols.data()(i));
-    }
-    if (cols.floatData().isNull()) {
-      stmt->setNull(FLOAT_DATA);
-    } else {
-      bindArrayAsBlob<Float>(stmt.get(), FLOAT_DATA, cols.floatData()(i));
-    }
-    if (cols.videoPoint().isNull()) {
-      stmt->setNull(VIDEO_POINT);
-    } else {
-      bindArrayAsBlob<Complex>(stmt.get(), VIDEO_POINT, cols.videoPoint()(i));
-    }
-    if (cols.lagData().isNull()) {
-      stmt->setNull(LAG_DATA);
-    } else {
-      bindArrayAsBlob<Complex>(stmt.get(), LAG_DATA, cols.lagData()(i));
+  MainStaging staging(&ms, main_readers, stmt->getParameterCount());
+  vector<MainReader> readers(main_readers);
+  int started = 0;
+  for (; started < main_readers; started++) {
+    readers[started].staging = &staging;
+    readers[started].id = started;
+    if (pthread_create(&readers[started].thread, NULL,
+		       readMain, &readers[started]) != 0) {
+      break;
     }
-    bindArrayAsBlob<Float>(stmt.get(), SIGMA, cols.sigma()(i));
-    if (cols.sigmaSpectrum().isNull()) {
-      stmt->setNull(SIGMA_SPECTRUM);
-    } else {
-      bindArrayAsBlob<Float>(stmt.get(), SIGMA_SPECTRUM, cols.sigmaSpectrum()(i));
+  }
+  bool failed = started < main_readers;
+  try {
+    uInt i = 0;
+    for (long batch = 0, end = staging.getNumberOfBatches();
+	 batch < end && ! failed; batch++) {
+      StagedRows const *rows = staging.waitFull(batch);
+      if (rows == NULL) {
+	failed = true;
+	break;
+      }
+      for (size_t j = 0; j < rows->getNumberOfRows(); j++, i++) {
+	rows->bind(j, stmt.get());
+	executeUpdate1(stmt.get());
+	commitBatch(con, i);
+      }
+      staging.release(batch);
     }
-    bindArrayAsBlob<Float>(stmt.get(), WEIGHT, cols.weight()(i));
-    if (cols.weightSpectrum().isNull()) {
-      stmt->setNull(WEIGHT_SPECTRUM);
-    } else {
-      bindArrayAsBlob<Float>(stmt.get(), WEIGHT_SPECTRUM, cols.weightSpectrum()(i));
+  } catch (...) {
+    staging.abort();
+    for (int j = 0; j < started; j++) {
+      pthread_join(readers[j].thread, NULL);
     }
-    bindArrayAsBlob<Bool>(stmt.get(), FLAG, cols.flag()(i));
-    bindArrayAsBlob<Bool>(stmt.get(), FLAG_CATEGORY, cols.flagCategory()(i));
-    stmt->setInt(FLAG_ROW, cols.flagRow()(i) ? 1 : 0);
-    executeUpdate1(stmt.get());
+    throw;
+  }
+  staging.abort(); // stops readers if they are still running.
+  for (int j = 0; j < started; j++) {
+    pthread_join(readers[j].thread, NULL);
+  }
+  if (failed) {
+    throw "Failed to convert MAIN.";
   }
 }
 
@@ -1882,6 +2274,15 @@ void mssave(Connection *con, char const*filename) {
     NULL
   };
   MeasurementSet ms(filename);
+  if (bulk_load) {
+    // The output is useless anyway if the conversion fails.
+    con->execute("PRAGMA main.synchronous = OFF;"
+		 "PRAGMA main.journal_mode = OFF;"
+		 "PRAGMA main.cache_size = -262144;"
+		 "PRAGMA msm.synchronous = OFF;"
+		 "PRAGMA msm.journal_mode = OFF;"
+		 "PRAGMA msm.cache_size = -262144;");
+  }
   for (size_t i = 0; funcs[i] != NULL; i++) {
     con->execute("BEGIN");
     funcs[i](con, ms);
@@ -1928,6 +2329,43 @@ char *readFileContent(char const *filename) {
   return buf;
 }
 
+/**
+ * Drops indexes in dbfile and returns DDLs to create them again
+ * by createIndexes(). Building an index after loading all rows is faster
+ * than updating it for each row.
+ */
+vector<string> dropIndexes(string const &dbfile) {
+  unique_ptr<Connection> con(Connection::open(dbfile.c_str()));
+  vector<string> names;
+  vector<string> ddls;
+  {
+    unique_ptr<PreparedStatement> stmt(con->prepare("select name, sql from sqlite_master "
+						    "where type = 'index' and sql is not null"));
+    unique_ptr<ResultSet> rs(stmt->executeQuery());
+    while (rs->next()) {
+      int size;
+      names.push_back(rs->getTransientString(1, &size));
+      ddls.push_back(rs->getTransientString(2, &size));
+    }
+  }
+  for (vector<string>::iterator i = names.begin(), end = names.end();
+       i != end; ++i) {
+    string sql = "DROP INDEX \"" + *i + "\"";
+    con->execute(sql.c_str());
+  }
+  return ddls;
+}
+
+void createIndexes(string const &dbfile, vector<string> const &ddls) {
+  unique_ptr<Connection> con(Connection::open(dbfile.c_str()));
+  con->execute("BEGIN");
+  for (vector<string>::const_iterator i = ddls.begin(), end = ddls.end();
+       i != end; ++i) {
+    con->execute(i->c_str());
+  }
+  con->execute("COMMIT");
+}
+
 void conv(char const *prefix, char const *msfile, char const *basename) {
   string msm = basename;
   msm += ".mdb";
@@ -1973,6 +2411,13 @@ void conv(char const *prefix, char const *msfile, char const *basename) {
     delete[] mst_ddl;
   }
 
+  vector<string> msmIndexes;
+  vector<string> mstIndexes;
+  if (bulk_load) {
+    msmIndexes = dropIndexes("file:" + msm);
+    mstIndexes = dropIndexes("file:" + mst);
+  }
+
   // open empty transaction db attached with master db.
   {
     string dbfile = "file:";
@@ -1984,6 +2429,14 @@ void conv(char const *prefix, char const *msfile, char const *basename) {
     stmt->executeUpdate();
     mssave(con.get(), msfile);
   }
+
+  if (bulk_load) {
+    double start = currenttime();
+    createIndexes("file:" + msm, msmIndexes);
+    createIndexes("file:" + mst, mstIndexes);
+    double end = currenttime();
+    cout << "Indexes created: " << end - start << "sec\n";
+  }
 }
 
 char const *progName = "";
@@ -1995,6 +2448,14 @@ void usage() {
   cerr << "\t-p path\n";
   cerr << "\t--force\tIgnore errors.\n";
   cerr << "\t-f\n";
+  cerr << "\t--bulk\tLoad faster at the cost of safety against crashes.\n";
+  cerr << "\t-b\n";
+  cerr << "\t--threads n\tRead MAIN with n threads. More than 1 requires casacore\n"
+       << "\t\t\tbuilt with thread support.\n";
+  cerr << "\t-t n\n";
+  cerr << "\t--compress\tCompress spectra and flags of MAIN. Use blob_decode()\n"
+       << "\t\t\tof libSQLiteFunc.so to read them.\n";
+  cerr << "\t-z\n";
 }
 
 }
@@ -2011,12 +2472,15 @@ int main(int argc, char const * const argv[]) {
   static struct option const long_options[] = {
     {"prefix", 1, NULL, 'p'},
     {"force", 1, NULL, 'f'},
+    {"bulk", 0, NULL, 'b'},
+    {"threads", 1, NULL, 't'},
+    {"compress", 0, NULL, 'z'},
     {0, 0, NULL, 0}
   };
 
   for (;;) {
     int option_index = 0;
-    int optCh = getopt_long (argc, const_cast<char *const *>(argv), "p:f",
+    int optCh = getopt_long (argc, const_cast<char *const *>(argv), "p:fbt:z",
 			     long_options, &option_index);
     if (optCh == -1) {
       break;
@@ -2028,6 +2492,21 @@ int main(int argc, char const * const argv[]) {
     case 'f':
       ignore_error = true;
       break;
+    case 'b':
+      bulk_load = true;
+      break;
+    case 't':
+      main_readers = atoi(optarg);
+      if (main_readers < 1) {
+	usage();
+	return 1;
+      }
+      break;
+    case 'z':
+      spectrum_codec = blobcodec::findCodec("deflate");
+      flag_codec = blobcodec::findCodec("rle");
+      assert(spectrum_codec != NULL && flag_codec != NULL);
+      break;
     case '?':
       usage();
       return 1;
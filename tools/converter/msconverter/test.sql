@@ -1,3 +1,5 @@
 attach database 'sqms.mdb' as msm;
 .load libSQLiteFunc.so
 -- select dump_blob_as_float(float_data, NULL, NULL, NULL, -1, 2) from main where main_id = 0;
+-- when converted with --compress:
+-- select dump_blob_as_float(blob_decode(float_data), NULL, NULL, NULL, -1, 2) from main where main_id = 0;